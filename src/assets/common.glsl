@@ -26,7 +26,8 @@ struct Material {
     int basecolorTextureId;
     int basecolorSamplerId;
     int metallicRoughnessTextureId;
-    int padding;
+    // 0: opaque
+    float alphaCutoff;
     vec4 basecolor;
 };
 
@@ -31,7 +31,7 @@ void main()
       case 0: // texture			
       {
         // create the sampler2D first
-        outFragColor = texture(sampler2D(BindlessImage2D[basecolorTextureId], BindlessSampler), inTexCoord);
+        outFragColor = texture(sampler2D(BindlessImage2D[basecolorTextureId], BindlessSampler[basecolorSamplerId]), inTexCoord);
         break;
       }
       case 1: // flat			
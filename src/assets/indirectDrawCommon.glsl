@@ -13,12 +13,17 @@ layout (set = 0, binding = 0) uniform UBO {
 layout(set = 1, binding = 0) readonly buffer VertexBuffer {
     Vertex vertices[];
 };
+// mesh space -> world, indexed by gl_InstanceIndex (firstInstance of the draw included)
+layout(set = 1, binding = 1) readonly buffer InstanceBuffer {
+    mat4 instanceTransforms[];
+};
 
 layout(set = 2, binding = 0) readonly buffer IndirectDrawBuffer {
     IndirectDrawDef1 indirectDraws[];
 };
+// the bindless heap, see bindlessHeap.h: material ids are heap slots
 layout(set = 3, binding = 0) uniform texture2D BindlessImage2D[];
-layout(set = 3, binding = 1) uniform sampler BindlessSampler;
+layout(set = 3, binding = 1) uniform sampler BindlessSampler[];
 layout(set = 4, binding = 0) readonly buffer MaterialBuffer {
     Material materials[];
 };
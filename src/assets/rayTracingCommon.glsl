@@ -0,0 +1,17 @@
+#ifndef RAY_TRACING_COMMON_GLSL
+#define RAY_TRACING_COMMON_GLSL
+
+// inline data of a hit record, right after the group handle in the shader binding table
+// one record per mesh (instanceShaderBindingTableRecordOffset), no lookup into the material buffer
+// refer to RayTracing::HitRecordData
+layout(shaderRecordEXT, std430) buffer HitRecord
+{
+    vec4 basecolor;
+    // 0: opaque
+    float alphaCutoff;
+    int materialId;
+    uint meshId;
+    uint padding;
+} hitRecord;
+
+#endif
@@ -115,21 +115,59 @@ namespace cudaEngine
     }
 
 #ifdef _WIN64 // For windows
-    HANDLE getVkImageMemoryHandle(VkDevice logicalDevice, VkExternalMemoryHandleTypeFlagsKHR externalMemoryHandleType)
+    HANDLE getVkImageMemoryHandle(VkDevice logicalDevice, VkDeviceMemory memory, VkExternalMemoryHandleTypeFlagsKHR externalMemoryHandleType)
     {
         HANDLE handle;
         VkMemoryGetWin32HandleInfoKHR vkMemoryGetWin32HandleInfoKHR = {};
         vkMemoryGetWin32HandleInfoKHR.sType = VK_STRUCTURE_TYPE_MEMORY_GET_WIN32_HANDLE_INFO_KHR;
         vkMemoryGetWin32HandleInfoKHR.pNext = NULL;
-        // vkMemoryGetWin32HandleInfoKHR.memory = textureImageMemory;
-        // vkMemoryGetWin32HandleInfoKHR.handleType =
-        //     (VkExternalMemoryHandleTypeFlagBitsKHR)externalMemoryHandleType;
+        vkMemoryGetWin32HandleInfoKHR.memory = memory;
+        vkMemoryGetWin32HandleInfoKHR.handleType =
+            (VkExternalMemoryHandleTypeFlagBitsKHR)externalMemoryHandleType;
 
         vkGetMemoryWin32HandleKHR(logicalDevice, &vkMemoryGetWin32HandleInfoKHR, &handle);
         return handle;
     }
+
+    HANDLE getVkSemaphoreHandle(VkDevice logicalDevice, VkExternalSemaphoreHandleTypeFlagBitsKHR externalSemaphoreHandleType, VkSemaphore& semVkCuda)
+    {
+        HANDLE handle;
+        VkSemaphoreGetWin32HandleInfoKHR vkSemaphoreGetWin32HandleInfoKHR = {};
+        vkSemaphoreGetWin32HandleInfoKHR.sType = VK_STRUCTURE_TYPE_SEMAPHORE_GET_WIN32_HANDLE_INFO_KHR;
+        vkSemaphoreGetWin32HandleInfoKHR.pNext = NULL;
+        vkSemaphoreGetWin32HandleInfoKHR.semaphore = semVkCuda;
+        vkSemaphoreGetWin32HandleInfoKHR.handleType = externalSemaphoreHandleType;
+
+        vkGetSemaphoreWin32HandleKHR(logicalDevice, &vkSemaphoreGetWin32HandleInfoKHR, &handle);
+        return handle;
+    }
 #else
+    int getVkImageMemHandle(VkDevice logicalDevice, VkDeviceMemory memory, VkExternalMemoryHandleTypeFlagsKHR externalMemoryHandleType)
+    {
+        int fd = -1;
+        VkMemoryGetFdInfoKHR vkMemoryGetFdInfoKHR = {};
+        vkMemoryGetFdInfoKHR.sType = VK_STRUCTURE_TYPE_MEMORY_GET_FD_INFO_KHR;
+        vkMemoryGetFdInfoKHR.pNext = NULL;
+        vkMemoryGetFdInfoKHR.memory = memory;
+        vkMemoryGetFdInfoKHR.handleType =
+            (VkExternalMemoryHandleTypeFlagBitsKHR)externalMemoryHandleType;
+
+        vkGetMemoryFdKHR(logicalDevice, &vkMemoryGetFdInfoKHR, &fd);
+        return fd;
+    }
 
+    int getVkSemaphoreHandle(VkDevice logicalDevice, VkExternalSemaphoreHandleTypeFlagBitsKHR externalSemaphoreHandleType, VkSemaphore& semVkCuda)
+    {
+        int fd = -1;
+        VkSemaphoreGetFdInfoKHR vkSemaphoreGetFdInfoKHR = {};
+        vkSemaphoreGetFdInfoKHR.sType = VK_STRUCTURE_TYPE_SEMAPHORE_GET_FD_INFO_KHR;
+        vkSemaphoreGetFdInfoKHR.pNext = NULL;
+        vkSemaphoreGetFdInfoKHR.semaphore = semVkCuda;
+        vkSemaphoreGetFdInfoKHR.handleType = externalSemaphoreHandleType;
+
+        vkGetSemaphoreFdKHR(logicalDevice, &vkSemaphoreGetFdInfoKHR, &fd);
+        return fd;
+    }
 #endif
 
 }
\ No newline at end of file
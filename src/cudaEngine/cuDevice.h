@@ -20,11 +20,14 @@ namespace cudaEngine
 {
     void selectDevice();
 
+  // memory: of an exportable image / buffer (VkContext::createExportableImage / createExportableBuffer),
+  // semVkCuda: VkContext::createExportableSemaphore. the handle is owned by the caller:
+  // CloseHandle / close(), or handed over to cudaImportExternal* (fd only), see cuInterop.h
 #ifdef _WIN64  // For windows
-  HANDLE getVkImageMemoryHandle(VkDevice logicalDevice, VkExternalMemoryHandleTypeFlagsKHR externalMemoryHandleType);
-  //HANDLE getVkSemaphoreHandle(VkDevice logicalDevice, VkExternalSemaphoreHandleTypeFlagBitsKHR externalSemaphoreHandleType, VkSemaphore& semVkCuda);
+  HANDLE getVkImageMemoryHandle(VkDevice logicalDevice, VkDeviceMemory memory, VkExternalMemoryHandleTypeFlagsKHR externalMemoryHandleType);
+  HANDLE getVkSemaphoreHandle(VkDevice logicalDevice, VkExternalSemaphoreHandleTypeFlagBitsKHR externalSemaphoreHandleType, VkSemaphore& semVkCuda);
 #else
-  int getVkImageMemHandle(VkDevice logicalDevice, VkExternalMemoryHandleTypeFlagsKHR externalMemoryHandleType);
+  int getVkImageMemHandle(VkDevice logicalDevice, VkDeviceMemory memory, VkExternalMemoryHandleTypeFlagsKHR externalMemoryHandleType);
   int getVkSemaphoreHandle(VkDevice logicalDevice, VkExternalSemaphoreHandleTypeFlagBitsKHR externalSemaphoreHandleType, VkSemaphore& semVkCuda);
 #endif
 }
\ No newline at end of file
@@ -0,0 +1,92 @@
+#include <cuInterop.h>
+#include <cuPredefines.h>
+
+namespace cudaEngine
+{
+    cudaExternalMemory_t importVkMemory(ExternalHandle handle, size_t sizeInBytes)
+    {
+        cudaExternalMemoryHandleDesc memoryHandleDesc{};
+#ifdef _WIN64
+        memoryHandleDesc.type = cudaExternalMemoryHandleTypeOpaqueWin32;
+        memoryHandleDesc.handle.win32.handle = handle;
+#else
+        memoryHandleDesc.type = cudaExternalMemoryHandleTypeOpaqueFd;
+        memoryHandleDesc.handle.fd = handle;
+#endif
+        memoryHandleDesc.size = sizeInBytes;
+        // createExportable* allocate dedicated memory
+        memoryHandleDesc.flags = cudaExternalMemoryDedicated;
+        cudaExternalMemory_t memory{nullptr};
+        CUDA_CHECK(cudaImportExternalMemory(&memory, &memoryHandleDesc));
+        return memory;
+    }
+
+    void *mapVkBuffer(cudaExternalMemory_t memory, size_t offset, size_t sizeInBytes)
+    {
+        cudaExternalMemoryBufferDesc bufferDesc{};
+        bufferDesc.offset = offset;
+        bufferDesc.size = sizeInBytes;
+        bufferDesc.flags = 0;
+        void *devicePtr{nullptr};
+        CUDA_CHECK(cudaExternalMemoryGetMappedBuffer(&devicePtr, memory, &bufferDesc));
+        return devicePtr;
+    }
+
+    cudaSurfaceObject_t mapVkImage(cudaExternalMemory_t memory,
+                                   int width,
+                                   int height,
+                                   const cudaChannelFormatDesc &formatDesc,
+                                   cudaMipmappedArray_t &mipmappedArray)
+    {
+        cudaExternalMemoryMipmappedArrayDesc arrayDesc{};
+        arrayDesc.offset = 0;
+        arrayDesc.formatDesc = formatDesc;
+        arrayDesc.extent = make_cudaExtent(width, height, 0);
+        arrayDesc.flags = cudaArraySurfaceLoadStore;
+        arrayDesc.numLevels = 1;
+        CUDA_CHECK(cudaExternalMemoryGetMappedMipmappedArray(&mipmappedArray, memory, &arrayDesc));
+
+        cudaArray_t level0{nullptr};
+        CUDA_CHECK(cudaGetMipmappedArrayLevel(&level0, mipmappedArray, 0));
+        cudaResourceDesc resourceDesc{};
+        resourceDesc.resType = cudaResourceTypeArray;
+        resourceDesc.res.array.array = level0;
+        cudaSurfaceObject_t surface{0};
+        CUDA_CHECK(cudaCreateSurfaceObject(&surface, &resourceDesc));
+        return surface;
+    }
+
+    cudaExternalSemaphore_t importVkSemaphore(ExternalHandle handle, bool timeline)
+    {
+        cudaExternalSemaphoreHandleDesc semaphoreHandleDesc{};
+#ifdef _WIN64
+        semaphoreHandleDesc.type = timeline ? cudaExternalSemaphoreHandleTypeTimelineSemaphoreWin32
+                                            : cudaExternalSemaphoreHandleTypeOpaqueWin32;
+        semaphoreHandleDesc.handle.win32.handle = handle;
+#else
+        semaphoreHandleDesc.type = timeline ? cudaExternalSemaphoreHandleTypeTimelineSemaphoreFd
+                                            : cudaExternalSemaphoreHandleTypeOpaqueFd;
+        semaphoreHandleDesc.handle.fd = handle;
+#endif
+        semaphoreHandleDesc.flags = 0;
+        cudaExternalSemaphore_t semaphore{nullptr};
+        CUDA_CHECK(cudaImportExternalSemaphore(&semaphore, &semaphoreHandleDesc));
+        return semaphore;
+    }
+
+    void waitVkSemaphore(cudaExternalSemaphore_t semaphore, uint64_t value, cudaStream_t stream)
+    {
+        cudaExternalSemaphoreWaitParams waitParams{};
+        waitParams.params.fence.value = value;
+        waitParams.flags = 0;
+        CUDA_CHECK(cudaWaitExternalSemaphoresAsync(&semaphore, &waitParams, 1, stream));
+    }
+
+    void signalVkSemaphore(cudaExternalSemaphore_t semaphore, uint64_t value, cudaStream_t stream)
+    {
+        cudaExternalSemaphoreSignalParams signalParams{};
+        signalParams.params.fence.value = value;
+        signalParams.flags = 0;
+        CUDA_CHECK(cudaSignalExternalSemaphoresAsync(&semaphore, &signalParams, 1, stream));
+    }
+}
@@ -0,0 +1,41 @@
+#pragma once
+
+#include <cuda.h>
+#include <cuda_runtime.h>
+
+#ifdef _WIN64
+#include <windows.h>
+#endif
+
+namespace cudaEngine
+{
+    // exported by vulkan: opaque win32 handle / opaque fd, see VkContext::createExportable*
+#ifdef _WIN64
+    using ExternalHandle = HANDLE;
+#else
+    using ExternalHandle = int;
+#endif
+
+    // dedicated vulkan allocation of sizeInBytes (VmaAllocationInfo::size). an fd is owned by cuda once imported,
+    // a win32 handle is not (CloseHandle after the import)
+    cudaExternalMemory_t importVkMemory(ExternalHandle handle, size_t sizeInBytes);
+
+    // device pointer over [offset, offset + sizeInBytes) of a vulkan buffer, cudaFree before
+    // cudaDestroyExternalMemory
+    void *mapVkBuffer(cudaExternalMemory_t memory, size_t offset, size_t sizeInBytes);
+
+    // level 0 of a 2d image as a surface (cudaArraySurfaceLoadStore), texels of formatDesc.
+    // cudaDestroySurfaceObject + cudaFreeMipmappedArray before cudaDestroyExternalMemory
+    cudaSurfaceObject_t mapVkImage(cudaExternalMemory_t memory,
+                                   int width,
+                                   int height,
+                                   const cudaChannelFormatDesc &formatDesc,
+                                   cudaMipmappedArray_t &mipmappedArray);
+
+    // VkContext::createExportableSemaphore, same ownership rules as importVkMemory
+    cudaExternalSemaphore_t importVkSemaphore(ExternalHandle handle, bool timeline);
+
+    // async on stream, value ignored for a binary semaphore
+    void waitVkSemaphore(cudaExternalSemaphore_t semaphore, uint64_t value, cudaStream_t stream);
+    void signalVkSemaphore(cudaExternalSemaphore_t semaphore, uint64_t value, cudaStream_t stream);
+}
@@ -0,0 +1,58 @@
+#include <cuJulia.h>
+#include <cuPredefines.h>
+
+namespace cudaEngine
+{
+    // one thread per pixel, 16x16 blocks
+    __global__ void juliaKernel(
+        cudaSurfaceObject_t surface,
+        int width,
+        int height,
+        float scaleFactor,
+        int numIterations,
+        float cr,
+        float ci)
+    {
+        const int x = blockIdx.x * blockDim.x + threadIdx.x;
+        const int y = blockIdx.y * blockDim.y + threadIdx.y;
+        if (x >= width || y >= height)
+        {
+            return;
+        }
+
+        float ar = scaleFactor * (float)(width / 2 - x) / (width / 2);
+        float ai = scaleFactor * (float)(height / 2 - y) / (height / 2);
+        bool inSet = true;
+        for (int i = 0; i < numIterations; i++)
+        {
+            // a * a + c
+            const float r = ar * ar - ai * ai;
+            const float im = ai * ar + ar * ai;
+            ar = r + cr;
+            ai = im + ci;
+            if (ar * ar + ai * ai > 1000)
+            {
+                inSet = false;
+                break;
+            }
+        }
+        // x in bytes for surfaces
+        surf2Dwrite(make_uchar4(inSet ? 255 : 0, 0, 0, 255), surface, x * sizeof(uchar4), y);
+    }
+
+    void launchJuliaKernel(
+        cudaSurfaceObject_t surface,
+        int width,
+        int height,
+        float scaleFactor,
+        int numIterations,
+        float cr,
+        float ci,
+        cudaStream_t stream)
+    {
+        const dim3 blockSize(16, 16);
+        const dim3 gridSize((width + blockSize.x - 1) / blockSize.x, (height + blockSize.y - 1) / blockSize.y);
+        juliaKernel<<<gridSize, blockSize, 0, stream>>>(surface, width, height, scaleFactor, numIterations, cr, ci);
+        CUDA_CHECK(cudaGetLastError());
+    }
+}
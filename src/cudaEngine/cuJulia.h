@@ -0,0 +1,19 @@
+#pragma once
+
+#include <cuda.h>
+#include <cuda_runtime.h>
+
+namespace cudaEngine
+{
+    // rgba8 julia set into level 0 of an imported vulkan image (surface of its cudaArray),
+    // same pixel mapping and escape test as JuliaSet::isInJuliaSet. async on stream
+    void launchJuliaKernel(
+        cudaSurfaceObject_t surface,
+        int width,
+        int height,
+        float scaleFactor,
+        int numIterations,
+        float cr,
+        float ci,
+        cudaStream_t stream);
+}
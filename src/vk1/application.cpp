@@ -14,10 +14,18 @@
 #define VK_NO_PROTOTYPES // for volk
 #define VOLK_IMPLEMENTATION
 
-// triple-buffer
+// triple-buffer at most: the per-frame resources are sized for it, the context cycles
+// through LatencyConfig::framesInFlight (1..3) of them
 static constexpr int MAX_FRAMES_IN_FLIGHT = 3;
 static constexpr int MAX_DESCRIPTOR_SETS = 1 * MAX_FRAMES_IN_FLIGHT + 1 + 4;
 static constexpr int NUM_OBJECTS = 5;
+// the draws of an object are few: one object per secondary command buffer is already enough work
+static constexpr size_t MIN_OBJECTS_PER_RECORDING_JOB = 1;
+// vertices displaced by one job of a simulation step
+static constexpr size_t SIMULATION_VERTICES_PER_JOB = 16 * 1024;
+// both dst and src as mipmap generation, src also for the defragmentation copies
+static constexpr VkImageUsageFlags GLB_TEXTURE_USAGE = VK_IMAGE_USAGE_TRANSFER_DST_BIT | VK_IMAGE_USAGE_SAMPLED_BIT |
+                                                       VK_IMAGE_USAGE_TRANSFER_SRC_BIT;
 
 // static constexpr int MAX_DESCRIPTOR_SETS = 1000;
 //  Default fence timeout in nanoseconds
@@ -25,31 +33,34 @@ static constexpr int NUM_OBJECTS = 5;
 
 void VkApplication::init()
 {
-    const auto handleUploadTextureTask = [this]()
+    // workers exit when teardown requests stop, bpop wakes up on the stop token
+    const auto handleUploadTextureTask = [this](std::stop_token stopToken)
     {
-        while (true)
+        std::packaged_task<uploadTextureFn> task;
+        while (_asyncTaskQueue.bpop(task, stopToken))
         {
-            std::packaged_task<uploadTextureFn> task;
-            _asyncTaskQueue.bpop(task);
             task();
         }
     };
-    _handleUploadTextureTaskFuture = std::async(std::launch::async, handleUploadTextureTask);
-
-    const auto handleTextureGenMipmapTask = [this]()
-    {
-        while (true)
-        {
-            std::packaged_task<void(void)> task;
-            _asyncTaskQueueForGenMipmaps.bpop(task);
-            task();
-        }
-    };
-    _handleTextureGenMipmapTaskFuture = std::async(std::launch::async, handleTextureGenMipmapTask);
+    _uploadTextureWorker = std::jthread(handleUploadTextureTask);
+
+    // coroutines waiting on gpu work are resumed on the job workers
+    _gpuCompletionSource = std::make_unique<VkCompletionSource>(_ctx.getLogicDevice());
+    _gpuWatcher = std::make_unique<GpuCompletionWatcher>(*_gpuCompletionSource, &JobSystem::get());
+    _gpuWatcher->startPolling(GPU_COMPLETION_POLLING_INTERVAL);
+    // texture uploads are batched per tick on the transfer queue
+    _uploadScheduler = std::make_unique<UploadScheduler>(_ctx, &JobSystem::get());
+    _uploadScheduler->startTicking(UPLOAD_SCHEDULER_TICK_INTERVAL);
+    _memoryDefragmenter = std::make_unique<MemoryDefragmenter>(_ctx, _ctx.getMemoryManager());
+    _ctx.getMemoryManager().registerEvictionHandler(TEXTURE_MEMORY, [this](uint32_t heapIndex, VkDeviceSize bytesToFree)
+                                                    { return evictTextures(heapIndex, bytesToFree); });
 
     _ctx.createSwapChain();
     _swapChainRenderPass = _ctx.createSwapChainRenderPass();
     _ctx.initDefaultCommandBuffers();
+    _commandRecorder = std::make_unique<ParallelCommandRecorder>(_ctx, JobSystem::get(), MAX_FRAMES_IN_FLIGHT);
+    // the pipelines mix the heap with regular sets: no descriptor buffer
+    _bindlessHeap = std::make_unique<BindlessHeap>(_ctx, MAX_FRAMES_IN_FLIGHT, BindlessHeap::Config{});
 
     createShaderModules();
     createUniformBuffers();
@@ -59,15 +70,16 @@ void VkApplication::init()
     //
     preloadGLB();
 
-    preHostDeviceIO();
-    loadGLB();
-    postHostDeviceIO();
-
+    // first: the textures bind themselves to the descriptor set as they complete
     createDescriptorSetLayout();
     createDescriptorPool();
     allocateDescriptorSets();
 
-    loadGLBTextureAsync();
+    syncWait(loadSceneAsync());
+    if (_simulationConfig.enabled)
+    {
+        createStreamingGeometry();
+    }
 
     _cullFustrum = std::make_unique<CullFustrum>();
     _cullFustrum->setCamera(&this->_camera);
@@ -75,19 +87,30 @@ void VkApplication::init()
     _cullFustrum->setScene(_scene);
     _cullFustrum->setIndirectDrawBuffer(&_indirectDrawB);
     _cullFustrum->setDescriptorPool(this->_descriptorSetPool);
+    _cullFustrum->setFrameAllocator(_frameAllocator.get());
     _cullFustrum->finalizeInit();
 
-    // renderdoc does not support raytracing
-    // _rt = std::make_unique<RayTracing>();
-    // _rt->setContext(&this->_ctx);
-    // _rt->setCamera(&this->_camera);
-    // _rt->setScene(_scene);
-    // _rt->setCompositeVerticeBuffer(&_compositeVB);
-    // _rt->setCompositeIndicesBuffer(&_compositeIB);
-    // _rt->setCompositeMaterialBuffer(&_compositeMatB);
-    // _rt->setIndirectDrawBuffer(&_indirectDrawB);
-    // _rt->setDescriptorPool(this->_descriptorSetPool);
-    // _rt->finalizeInit();
+    // --rt: renderdoc does not support raytracing, the extensions are requested by main() only then
+    if (_rayTracingConfig.enabled && !_ctx.isRayTracingSupported())
+    {
+        log(Level::Warn, "--rt: the device does not support ray tracing, the pass is skipped");
+    }
+    else if (_rayTracingConfig.enabled)
+    {
+        _rt = std::make_unique<RayTracing>();
+        _rt->setConfig(_rayTracingConfig.pass);
+        _rt->setContext(&this->_ctx);
+        _rt->setCamera(&this->_camera);
+        _rt->setScene(_scene);
+        _rt->setCompositeVerticeBuffer(&_compositeVB);
+        _rt->setCompositeIndicesBuffer(&_compositeIB);
+        _rt->setCompositeMaterialBuffer(&_compositeMatB);
+        _rt->setIndirectDrawBuffer(&_indirectDrawB);
+        _rt->setDescriptorPool(this->_descriptorSetPool);
+        _rt->setFrameAllocator(_frameAllocator.get());
+        _rt->finalizeInit();
+    }
+    createRenderGraph();
 
     createGraphicsPipeline();
     createSwapChainFramebuffers();
@@ -100,24 +123,47 @@ void VkApplication::teardown()
 {
     auto logicalDevice = _ctx.getLogicDevice();
     auto vmaAllocator = _ctx.getVmaAllocator();
+    // nothing is published anymore
+    if (_simulationThread.joinable())
+    {
+        _simulationThread.request_stop();
+        _simulationThread.join();
+    }
+    // drains the upload workers before they are stopped
+    unloadScene();
+    _uploadTextureWorker.request_stop();
+    _uploadTextureWorker.join();
+    {
+        const auto uploadStats = _uploadScheduler->stats();
+        log(Level::Info, "UploadScheduler: ", uploadStats.uploads, " uploads in ", uploadStats.uploadSubmits, " submits (",
+            uploadStats.uploadsPerSubmit, " per submit, ", uploadStats.graphicsSubmits, " graphics submits), ", uploadStats.bytesPerSecond / (1024.0 * 1024.0), " MB/s");
+    }
+    _uploadScheduler.reset();
+    {
+        const auto defragmentationStats = _memoryDefragmenter->stats();
+        log(Level::Info, "MemoryDefragmenter: ", defragmentationStats.passes, " passes, ",
+            defragmentationStats.allocationsMoved, " allocations moved, ", defragmentationStats.bytesFreed, " bytes freed");
+    }
+    _memoryDefragmenter.reset();
+    _ctx.getMemoryManager().dumpStats(VMA_STATS_PATH);
+    // nothing awaits the gpu anymore
+    _gpuWatcher.reset();
+    _gpuCompletionSource.reset();
+
     vkDeviceWaitIdle(logicalDevice);
+    _streamingGeometry.reset();
+    _renderGraph.reset();
+    _rt.reset();
+    _commandRecorder.reset();
+    _bindlessHeap.reset();
     deleteSwapChain();
+    // stop watching before the modules go away
+    _shaderHotReload.reset();
 
     // shader module
     vkDestroyShaderModule(logicalDevice, _vsShaderModule, nullptr);
     vkDestroyShaderModule(logicalDevice, _fsShaderModule, nullptr);
 
-    // glb
-    for (const auto &imageEntity : _glbImageEntities)
-    {
-        const auto image = std::get<0>(imageEntity);
-        const auto imageView = std::get<1>(imageEntity);
-        const auto imageAllocation = std::get<2>(imageEntity);
-
-        vkDestroyImageView(logicalDevice, imageView, nullptr);
-        vmaDestroyImage(vmaAllocator, image, imageAllocation);
-    }
-
     for (const auto &samplerEntity : _glbSamplerEntities)
     {
         const auto sampler = std::get<0>(samplerEntity);
@@ -127,23 +173,20 @@ void VkApplication::teardown()
     vmaDestroyBuffer(vmaAllocator, std::get<0>(_compositeVB), std::get<1>(_compositeVB));
     vmaDestroyBuffer(vmaAllocator, std::get<0>(_compositeIB), std::get<1>(_compositeIB));
     vmaDestroyBuffer(vmaAllocator, std::get<0>(_compositeMatB), std::get<1>(_compositeMatB));
+    vmaDestroyBuffer(vmaAllocator, std::get<0>(_instanceTransformB), std::get<1>(_instanceTransformB));
     vmaDestroyBuffer(vmaAllocator, std::get<0>(_indirectDrawB), std::get<1>(_indirectDrawB));
     // shader data
     vkDestroyDescriptorPool(logicalDevice, _descriptorSetPool, nullptr);
-    for (const auto &descriptorSetLayout : _descriptorSetLayouts)
+    for (size_t i = 0; i < _descriptorSetLayouts.size(); ++i)
     {
-        vkDestroyDescriptorSetLayout(logicalDevice, descriptorSetLayout, nullptr);
+        // already gone with the heap
+        if (i == DESC_LAYOUT_SEMANTIC::BINDLESS)
+            continue;
+        vkDestroyDescriptorSetLayout(logicalDevice, _descriptorSetLayouts[i], nullptr);
     }
 
-    for (size_t i = 0; i < MAX_FRAMES_IN_FLIGHT; i++)
-    {
-        // vma buffer
-        // unmap a buffer not mapped will crash
-        // vmaUnmapMemory(_vmaAllocator, _vmaAllocations[i]);
-        vmaDestroyBuffer(vmaAllocator, std::get<0>(_uniformBuffers[i]), std::get<1>(_uniformBuffers[i]));
-    }
-    vmaDestroyBuffer(vmaAllocator, std::get<0>(_objectDynamicUniformBuffer), std::get<1>(_objectDynamicUniformBuffer));
-    _aligned_free(_comboWorldTransformation);
+    // per-frame uniforms
+    _frameAllocator.reset();
 
     for (const auto &[pipelineType, pipeline] : std::get<0>(_graphicsPipelineEntity))
     {
@@ -152,12 +195,6 @@ void VkApplication::teardown()
 
     vkDestroyPipelineLayout(logicalDevice, std::get<1>(_graphicsPipelineEntity), nullptr);
     vkDestroyRenderPass(logicalDevice, _swapChainRenderPass, nullptr);
-
-    // for async resource transfer and acquire between two queue families
-    for (auto &semaphore : _asyncTransferSemaphorePool)
-    {
-        vkDestroySemaphore(logicalDevice, semaphore, nullptr);
-    }
 }
 
 void VkApplication::renderPerFrame()
@@ -167,6 +204,18 @@ void VkApplication::renderPerFrame()
     auto presentationQueue = _ctx.getPresentationQueue();
     auto swapChain = _ctx.getSwapChain();
 
+#ifdef VK_SHADER_HOT_RELOAD
+    // frame boundary: nothing is being recorded, safe to swap pipelines
+    if (_shaderHotReload && _shaderHotReload->applyPendingReloads() > 0)
+    {
+        reloadGraphicsPipeline();
+    }
+#endif
+
+    // frame boundary: budgets, eviction, and one step of the defragmentation
+    _ctx.getMemoryManager().update(_frameCount++);
+    _memoryDefragmenter->step();
+
     auto [currentFrameId, cmdBuffersForRendering] = _ctx.getCommandBufferForRendering();
 
     // // no timeout set
@@ -174,23 +223,37 @@ void VkApplication::renderPerFrame()
     // // vkWaitForFences ensure the previous command is submitted from the host, now it can be modified.
     // VK_CHECK(vkResetCommandBuffer(cmdToRecord, 0));
     _ctx.BeginRecordCommandBuffer(cmdBuffersForRendering);
+    // the frame's previous submit is done: its transient uniforms can be overwritten
+    _frameAllocator->beginFrame(currentFrameId);
+    _commandRecorder->beginFrame(currentFrameId);
+    _bindlessHeap->beginFrame(currentFrameId);
+    // the textures completed since the last frame, one batched update
+    _bindlessHeap->flush();
+    updateMaterials(cmdBuffersForRendering);
+    // the vertices published by the simulation, ahead of every pass reading them
+    if (_streamingGeometry)
+    {
+        _streamingGeometry->record(cmdBuffersForRendering, currentFrameId);
+    }
 
-    // 1. cull fustrum compute shader pass
-    _cullFustrum->execute(cmdBuffersForRendering, currentFrameId);
+    _swapChainImageIndex = _ctx.getSwapChainImageIndexToRender();
+    updateUniformBuffer(currentFrameId);
+    const auto &swapchainImages = _ctx.getSwapChainImages();
+    const auto &swapchainImageViews = _ctx.getSwapChainImageViews();
+    _renderGraph->updateImportedImage(_swapChainImageResource,
+                                      swapchainImages[_swapChainImageIndex],
+                                      swapchainImageViews[_swapChainImageIndex]);
 
+    // 1. cull fustrum compute shader pass
     // 2. main rendering pass
-    const auto cmdToRecord = std::get<1>(cmdBuffersForRendering);
-    const auto fenceToWait = std::get<2>(cmdBuffersForRendering);
-
-    uint32_t swapChainImageIndex = _ctx.getSwapChainImageIndexToRender();
-    updateUniformBuffer(currentFrameId);
-    recordCommandBuffer(currentFrameId, cmdToRecord, swapChainImageIndex);
+    _renderGraph->execute(cmdBuffersForRendering, currentFrameId);
     _ctx.EndRecordCommandBuffer(cmdBuffersForRendering);
+    _frameAllocator->flush();
     {
         ZoneScopedN("CmdMgr: submit");
         _ctx.submitCommand();
     }
-    _ctx.present(swapChainImageIndex);
+    _ctx.present(_swapChainImageIndex);
     _ctx.advanceCommandBuffer();
 }
 
@@ -223,15 +286,21 @@ void VkApplication::createDescriptorSetLayout()
 
     setBindings[DESC_LAYOUT_SEMANTIC::UBO].resize(1);
     setBindings[DESC_LAYOUT_SEMANTIC::UBO][0].binding = 0; // depends on the shader: set 0, binding = 0
-    setBindings[DESC_LAYOUT_SEMANTIC::UBO][0].descriptorType = VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER;
+    // dynamic: the frame allocator picks the offset every frame
+    setBindings[DESC_LAYOUT_SEMANTIC::UBO][0].descriptorType = VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER_DYNAMIC;
     setBindings[DESC_LAYOUT_SEMANTIC::UBO][0].descriptorCount = 1;
     setBindings[DESC_LAYOUT_SEMANTIC::UBO][0].stageFlags = VK_SHADER_STAGE_VERTEX_BIT;
 
-    setBindings[DESC_LAYOUT_SEMANTIC::COMBO_VERT].resize(1);
+    setBindings[DESC_LAYOUT_SEMANTIC::COMBO_VERT].resize(2);
     setBindings[DESC_LAYOUT_SEMANTIC::COMBO_VERT][0].binding = 0; // depends on the shader: set 0, binding = 0
     setBindings[DESC_LAYOUT_SEMANTIC::COMBO_VERT][0].descriptorType = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER;
     setBindings[DESC_LAYOUT_SEMANTIC::COMBO_VERT][0].descriptorCount = 1;
     setBindings[DESC_LAYOUT_SEMANTIC::COMBO_VERT][0].stageFlags = VK_SHADER_STAGE_VERTEX_BIT | VK_SHADER_STAGE_FRAGMENT_BIT;
+    // instance transforms
+    setBindings[DESC_LAYOUT_SEMANTIC::COMBO_VERT][1].binding = 1;
+    setBindings[DESC_LAYOUT_SEMANTIC::COMBO_VERT][1].descriptorType = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER;
+    setBindings[DESC_LAYOUT_SEMANTIC::COMBO_VERT][1].descriptorCount = 1;
+    setBindings[DESC_LAYOUT_SEMANTIC::COMBO_VERT][1].stageFlags = VK_SHADER_STAGE_VERTEX_BIT | VK_SHADER_STAGE_FRAGMENT_BIT;
 
     setBindings[DESC_LAYOUT_SEMANTIC::COMBO_IDR].resize(1);
     setBindings[DESC_LAYOUT_SEMANTIC::COMBO_IDR][0].binding = 0; // depends on the shader: set 0, binding = 0
@@ -239,17 +308,6 @@ void VkApplication::createDescriptorSetLayout()
     setBindings[DESC_LAYOUT_SEMANTIC::COMBO_IDR][0].descriptorCount = 1;
     setBindings[DESC_LAYOUT_SEMANTIC::COMBO_IDR][0].stageFlags = VK_SHADER_STAGE_VERTEX_BIT | VK_SHADER_STAGE_FRAGMENT_BIT;
 
-    setBindings[DESC_LAYOUT_SEMANTIC::TEX_SAMP].resize(2);
-    setBindings[DESC_LAYOUT_SEMANTIC::TEX_SAMP][0].binding = 0; // depends on the shader: set 0, binding = 0
-    setBindings[DESC_LAYOUT_SEMANTIC::TEX_SAMP][0].descriptorType = VK_DESCRIPTOR_TYPE_SAMPLED_IMAGE;
-    setBindings[DESC_LAYOUT_SEMANTIC::TEX_SAMP][0].descriptorCount = _numTextures;
-    setBindings[DESC_LAYOUT_SEMANTIC::TEX_SAMP][0].stageFlags = VK_SHADER_STAGE_FRAGMENT_BIT;
-
-    setBindings[DESC_LAYOUT_SEMANTIC::TEX_SAMP][1].binding = 1; // depends on the shader: set 0, binding = 0
-    setBindings[DESC_LAYOUT_SEMANTIC::TEX_SAMP][1].descriptorType = VK_DESCRIPTOR_TYPE_SAMPLER;
-    setBindings[DESC_LAYOUT_SEMANTIC::TEX_SAMP][1].descriptorCount = 1;
-    setBindings[DESC_LAYOUT_SEMANTIC::TEX_SAMP][1].stageFlags = VK_SHADER_STAGE_FRAGMENT_BIT;
-
     setBindings[DESC_LAYOUT_SEMANTIC::COMBO_MAT].resize(1);
     setBindings[DESC_LAYOUT_SEMANTIC::COMBO_MAT][0].binding = 0; // depends on the shader: set 0, binding = 0
     setBindings[DESC_LAYOUT_SEMANTIC::COMBO_MAT][0].descriptorType = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER;
@@ -267,7 +325,10 @@ void VkApplication::createDescriptorSetLayout()
     setBindings[DESC_LAYOUT_SEMANTIC::OBJECT_DYNAMIC_UBO][0].descriptorCount = 1;
     setBindings[DESC_LAYOUT_SEMANTIC::OBJECT_DYNAMIC_UBO][0].stageFlags = VK_SHADER_STAGE_VERTEX_BIT;
 
+    // textures and samplers: the heap's layout takes the slot of set 3
+    setBindings.erase(setBindings.begin() + DESC_LAYOUT_SEMANTIC::BINDLESS);
     _descriptorSetLayouts = _ctx.createDescriptorSetLayout(setBindings);
+    _descriptorSetLayouts.insert(_descriptorSetLayouts.begin() + DESC_LAYOUT_SEMANTIC::BINDLESS, _bindlessHeap->layout());
 }
 
 // depends on your glsl
@@ -276,8 +337,10 @@ void VkApplication::createDescriptorPool()
     // for ray tracing
     _descriptorSetPool = _ctx.createDescriptorSetPool({
                                                           {VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER, MAX_FRAMES_IN_FLIGHT},
-                                                          {VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER_DYNAMIC, 10},
-                                                          {VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, 10},
+                                                          // global ubo, object ubo, cull fustrum and the --rt camera, per frame
+                                                          {VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER_DYNAMIC, 4 * MAX_FRAMES_IN_FLIGHT},
+                                                          // COMBO_VERT per frame: streaming vertices
+                                                          {VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, 16},
                                                           {VK_DESCRIPTOR_TYPE_SAMPLED_IMAGE, 10},
                                                           {VK_DESCRIPTOR_TYPE_SAMPLER, 10},
                                                           {VK_DESCRIPTOR_TYPE_ACCELERATION_STRUCTURE_KHR, 10},
@@ -301,58 +364,20 @@ void VkApplication::allocateDescriptorSets()
                                                  {{&_descriptorSetLayouts[DESC_LAYOUT_SEMANTIC::UBO],
                                                    MAX_FRAMES_IN_FLIGHT},
                                                   {&_descriptorSetLayouts[DESC_LAYOUT_SEMANTIC::COMBO_VERT],
-                                                   1},
+                                                   MAX_FRAMES_IN_FLIGHT},
                                                   {&_descriptorSetLayouts[DESC_LAYOUT_SEMANTIC::COMBO_IDR],
                                                    1},
-                                                  {&_descriptorSetLayouts[DESC_LAYOUT_SEMANTIC::TEX_SAMP],
-                                                   1},
                                                   {&_descriptorSetLayouts[DESC_LAYOUT_SEMANTIC::COMBO_MAT],
                                                    1},
                                                   {&_descriptorSetLayouts[DESC_LAYOUT_SEMANTIC::OBJECT_DYNAMIC_UBO],
-                                                   1}});
+                                                   MAX_FRAMES_IN_FLIGHT}});
 }
 
 void VkApplication::createUniformBuffers()
 {
-    // uniform global granularity, camera, etc.
-    VkDeviceSize bufferSize = sizeof(UniformDataDef1);
-    _uniformBuffers.reserve(MAX_FRAMES_IN_FLIGHT);
-
-    for (size_t i = 0; i < MAX_FRAMES_IN_FLIGHT; i++)
-    {
-        // VK_BUFFER_USAGE_SHADER_DEVICE_ADDRESS_BIT is required to fetch the uint64_t shader address
-        _uniformBuffers.emplace_back(_ctx.createPersistentBuffer(
-            "Uniform buffer " + std::to_string(i),
-            bufferSize,
-            VK_BUFFER_USAGE_UNIFORM_BUFFER_BIT | VK_BUFFER_USAGE_SHADER_DEVICE_ADDRESS_BIT,
-            VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT |
-                VK_MEMORY_PROPERTY_HOST_COHERENT_BIT |
-                VK_MEMORY_PROPERTY_HOST_CACHED_BIT,
-            VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT |
-                VK_MEMORY_PROPERTY_HOST_COHERENT_BIT |
-                VK_MEMORY_PROPERTY_HOST_CACHED_BIT));
-    }
-
-    // uniform object granularity
-    size_t minUboAlignment = 64;
-    _dynamicAlignment = sizeof(glm::mat4);
-    if (minUboAlignment > 0)
-    {
-        _dynamicAlignment = (_dynamicAlignment + minUboAlignment - 1) & ~(minUboAlignment - 1);
-    }
-
-    bufferSize = NUM_OBJECTS * _dynamicAlignment;
-    log(Level::Info, "dynamicAlignment: ", _dynamicAlignment);
-
-    _comboWorldTransformation = (glm::mat4 *)aligned_alloc(bufferSize, _dynamicAlignment);
-
-    // Uniform buffer object with per-object matrices
-    _objectDynamicUniformBuffer = _ctx.createPersistentBuffer(
-        "Object Dynamic(combo) buffer",
-        bufferSize,
-        VK_BUFFER_USAGE_UNIFORM_BUFFER_BIT | VK_BUFFER_USAGE_SHADER_DEVICE_ADDRESS_BIT,
-        VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT,
-        VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT);
+    // uniform global and object granularity: sub-ranges of the frame's buffer, see updateUniformBuffer
+    _frameAllocator = std::make_unique<FrameAllocator>(_ctx, MAX_FRAMES_IN_FLIGHT);
+    log(Level::Info, "dynamicAlignment: ", _frameAllocator->alignment());
 
     // set up
 
@@ -369,12 +394,9 @@ void VkApplication::createUniformBuffers()
 
 void VkApplication::updateUniformBuffer(int currentFrameId)
 {
-    ASSERT(currentFrameId >= 0 && currentFrameId < _uniformBuffers.size(), "currentFrameId must be within the range");
-    auto logicalDevice = _ctx.getLogicDevice();
+    ASSERT(currentFrameId >= 0 && currentFrameId < _frameAllocator->numFramesInFlight(), "currentFrameId must be within the range");
+    ASSERT(_frameAllocator->currentFrameId() == currentFrameId, "the frame allocator should be on currentFrameId");
     auto swapChainExtent = _ctx.getSwapChainExtent();
-    auto vmaAllocator = _ctx.getVmaAllocator();
-    auto vmaAllocation = std::get<BUFFER_ENTITY_UID::VMA_ALLOCATION>(_uniformBuffers[currentFrameId]);
-    auto mappedMemory = std::get<BUFFER_ENTITY_UID::MAPPING_ADDRESS>(_uniformBuffers[currentFrameId]);
 
     auto view = _camera.viewTransformLH();
     auto verticalFov = _camera.verticalFov();
@@ -406,57 +428,19 @@ void VkApplication::updateUniformBuffer(int currentFrameId)
     // model = glm::rotate(model, glm::radians(45.0f), glm::vec3(1.0f, 1.0f, 0.0f));
     ubo.mvp = proj * view * model;
 
-    if (mappedMemory)
-    {
-        memcpy(mappedMemory, &ubo, sizeof(UniformDataDef1));
-    }
-    else
-    {
-        // racing condition due to vmaAllocator
-        void *mappedMemory{nullptr};
-        VK_CHECK(vmaMapMemory(vmaAllocator, vmaAllocation, &mappedMemory));
-        memcpy(mappedMemory, &ubo, sizeof(UniformDataDef1));
-        // memcpy(mappedMemory, &ubo, sizeof(ubo));
-        vmaUnmapMemory(vmaAllocator, vmaAllocation);
-    }
+    // no map calls: the frame's buffer stays mapped, flushed once before the submit when not coherent
+    _globalUniform = _frameAllocator->push(ubo);
 
-    // 2. for per-object ubo
+    // 2. for per-object ubo, written in place, one dynamic offset per object
+    _objectUniforms.resize(_rotations.size());
     for (int i = 0; i < _rotations.size(); i++)
     {
-        glm::mat4 *modelMat = (glm::mat4 *)(((uint64_t)_comboWorldTransformation + (i * _dynamicAlignment)));
         glm::mat4 m4(1.0f); // construct identity matrix
                             // three concatanated rotation
-        *modelMat = m4;
-        *modelMat = glm::rotate(*modelMat, _rotations[i].x, glm::vec3(1.0f, 0.0f, 0.0f));
-        // *modelMat = glm::rotate(*modelMat, _rotations[i].y, glm::vec3(0.0f, 1.0f, 0.0f));
-        // *modelMat = glm::rotate(*modelMat, _rotations[i].z, glm::vec3(0.0f, 0.0f, 1.0f));
-
-        // already persistent mapped
-        auto mappedMemory = std::get<BUFFER_ENTITY_UID::MAPPING_ADDRESS>(_objectDynamicUniformBuffer);
-        auto bufferSize = std::get<BUFFER_ENTITY_UID::BUFFER_SIZE>(_objectDynamicUniformBuffer);
-        auto vmaAllocation = std::get<BUFFER_ENTITY_UID::VMA_ALLOCATION>(_objectDynamicUniformBuffer);
-        ASSERT(mappedMemory, "_objectDynamicUniformBuffer should be persistent-mapped");
-        memcpy(mappedMemory, _comboWorldTransformation, bufferSize);
-        // If a memory object does not have the VK_MEMORY_PROPERTY_HOST_COHERENT_BIT property,
-        // then vkFlushMappedMemoryRanges must be called in order to guarantee that writes to the memory object from the host are made available to the host domain,
-        // where they can be further made available to the device domain via a domain operation. Similarly, vkInvalidateMappedMemoryRanges
-        // must be called to guarantee that writes which are available to the host domain are made visible to host operations.
-        // If the memory object does have the VK_MEMORY_PROPERTY_HOST_COHERENT_BIT property flag,
-        // writes to the memory object from the host are automatically made available to the host domain.
-        // Similarly, writes made available to the host domain are automatically made visible to the host.
-
-        // From vma layer
-        // Memory in Vulkan doesn't need to be unmapped before using it on GPU,
-        // but unless a memory types has `VK_MEMORY_PROPERTY_HOST_COHERENT_BIT` flag set,
-        // you need to manually **invalidate** cache before reading of mapped pointer
-        // and **flush** cache after writing to mapped pointer.
-        // Map/unmap operations don't do that automatically.
-        // Vulkan provides following functions for this purpose `vkFlushMappedMemoryRanges()`,
-        // `vkInvalidateMappedMemoryRanges()`, but this library provides more convenient
-        // functions that refer to given allocation object: vmaFlushAllocation(),
-        // vmaInvalidateAllocation(),
-        // or multiple objects at once: vmaFlushAllocations(), vmaInvalidateAllocations().
-        VK_CHECK(vmaFlushAllocation(vmaAllocator, vmaAllocation, 0, bufferSize));
+        m4 = glm::rotate(m4, _rotations[i].x, glm::vec3(1.0f, 0.0f, 0.0f));
+        // m4 = glm::rotate(m4, _rotations[i].y, glm::vec3(0.0f, 1.0f, 0.0f));
+        // m4 = glm::rotate(m4, _rotations[i].z, glm::vec3(0.0f, 0.0f, 1.0f));
+        _objectUniforms[i] = _frameAllocator->push(m4);
     }
 }
 
@@ -471,29 +455,36 @@ void VkApplication::bindResourceToDescriptorSets()
     // 2. ssbo for indirectdraw
     // 3. textures + samplers
     // 4. ssbo for materials
-    for (size_t i = 0; i < MAX_FRAMES_IN_FLIGHT; i++)
-    {
-        _ctx.bindBufferToDescriptorSet(
-            std::get<0>(_uniformBuffers[i]),
-            0,
-            sizeof(UniformDataDef1),
-            _descriptorSets[&_descriptorSetLayouts[DESC_LAYOUT_SEMANTIC::UBO]][i],
-            VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER,
-            0);
-    }
+    _frameAllocator->bindDescriptorSets(_descriptorSets[&_descriptorSetLayouts[DESC_LAYOUT_SEMANTIC::UBO]],
+                                        VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER_DYNAMIC,
+                                        sizeof(UniformDataDef1));
 
-    // for glb's vb
+    // for glb's vb, per frame: the simulation streams one slot per frame in flight
     {
         const auto dstSets = _descriptorSets[&_descriptorSetLayouts[DESC_LAYOUT_SEMANTIC::COMBO_VERT]];
-        ASSERT(dstSets.size() == 1, "COMBO_VERT descriptor set size is 1");
+        ASSERT(dstSets.size() == MAX_FRAMES_IN_FLIGHT, "COMBO_VERT descriptor set has frame_in_flight");
 
-        _ctx.bindBufferToDescriptorSet(
-            std::get<0>(_compositeVB),
-            0,
-            _compositeVBSizeInByte,
-            dstSets[0],
-            VK_DESCRIPTOR_TYPE_STORAGE_BUFFER,
-            0);
+        for (uint32_t i = 0; i < dstSets.size(); ++i)
+        {
+            const auto &vertexBuffer = _streamingGeometry && i < _streamingGeometry->numSlots()
+                                           ? _streamingGeometry->vertexBuffer(i)
+                                           : _compositeVB;
+            _ctx.bindBufferToDescriptorSet(
+                std::get<0>(vertexBuffer),
+                0,
+                _compositeVBSizeInByte,
+                dstSets[i],
+                VK_DESCRIPTOR_TYPE_STORAGE_BUFFER,
+                0);
+
+            _ctx.bindBufferToDescriptorSet(
+                std::get<0>(_instanceTransformB),
+                0,
+                _instanceTransformBSizeInByte,
+                dstSets[i],
+                VK_DESCRIPTOR_TYPE_STORAGE_BUFFER,
+                1);
+        }
     }
 
     // glb indirect draw
@@ -510,51 +501,7 @@ void VkApplication::bindResourceToDescriptorSets()
             0);
     }
 
-    {
-        // for glb textures and samplers
-        const auto dstSets = _descriptorSets[&_descriptorSetLayouts[DESC_LAYOUT_SEMANTIC::TEX_SAMP]];
-        ASSERT(dstSets.size() == 1, "TEX_SAMP descriptor set size is 1");
-
-        // does not work for async io
-        // std::vector<VkImageView> imageViews;
-        // std::transform(_glbImageEntities.begin(), _glbImageEntities.end(),
-        //                std::back_inserter(imageViews),
-        //                [](const auto &imageEntity)
-        //                {
-        //                    return std::get<1>(imageEntity);
-        //                });
-
-        // _ctx.bindTextureToDescriptorSet(
-        //     imageViews,
-        //     dstSets[0],
-        //     VK_DESCRIPTOR_TYPE_SAMPLED_IMAGE,
-        //     0);
-
-        // // mimic asyn-io callback case
-        // uint32_t offset = 0;
-        // for (const auto &imageEntity : _glbImageEntities)
-        // {
-        //     _ctx.bindTextureToDescriptorSet(
-        //         {imageEntity},
-        //         dstSets[0],
-        //         VK_DESCRIPTOR_TYPE_SAMPLED_IMAGE,
-        //         offset++);
-        // }
-
-        // for glb samplers
-        std::vector<VkSampler> imageSamplers;
-        std::transform(_glbSamplerEntities.begin(), _glbSamplerEntities.end(),
-                       std::back_inserter(imageSamplers),
-                       [](const auto &samplerEntity)
-                       {
-                           return std::get<0>(samplerEntity);
-                       });
-        _ctx.bindSamplerToDescriptorSet(
-            imageSamplers,
-            dstSets[0],
-            VK_DESCRIPTOR_TYPE_SAMPLER,
-            1);
-    }
+    // glb textures and samplers: written to the bindless heap by uploadTextureAsync and loadGLB
 
     {
         // for mat
@@ -576,14 +523,9 @@ void VkApplication::bindResourceToDescriptorSets()
     //                        _writeDescriptorSetBundle.data(), 0,
     //                        nullptr);
     {
+        // one world matrix per object in view
         const auto dstSets = _descriptorSets[&_descriptorSetLayouts[DESC_LAYOUT_SEMANTIC::OBJECT_DYNAMIC_UBO]];
-        _ctx.bindBufferToDescriptorSet(
-            std::get<BUFFER_ENTITY_UID::BUFFER>(_objectDynamicUniformBuffer),
-            0,
-            std::get<BUFFER_ENTITY_UID::BUFFER_SIZE>(_objectDynamicUniformBuffer),
-            dstSets[0],
-            VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER_DYNAMIC,
-            0);
+        _frameAllocator->bindDescriptorSets(dstSets, VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER_DYNAMIC, sizeof(glm::mat4));
     }
 }
 
@@ -625,6 +567,28 @@ void VkApplication::createShaderModules()
     const auto fragShaderPath = shadersPath + "/indirectDraw.frag";
     log(Level::Info, "vertexShaderPath: ", vertexShaderPath);
     log(Level::Info, "fragShaderPath: ", fragShaderPath);
+#ifdef VK_SHADER_HOT_RELOAD
+    _shaderHotReload = std::make_unique<ShaderHotReload>(logicalDevice);
+    // the old module is no longer referenced once the pipeline is rebuilt in reloadGraphicsPipeline
+    _vsShaderModule = _shaderHotReload->watch(
+        vertexShaderPath,
+        "main",
+        "indirectDraw.vert",
+        [this, logicalDevice](VkShaderModule shaderModule)
+        {
+            vkDestroyShaderModule(logicalDevice, _vsShaderModule, nullptr);
+            _vsShaderModule = shaderModule;
+        });
+    _fsShaderModule = _shaderHotReload->watch(
+        fragShaderPath,
+        "main",
+        "indirectDraw.frag",
+        [this, logicalDevice](VkShaderModule shaderModule)
+        {
+            vkDestroyShaderModule(logicalDevice, _fsShaderModule, nullptr);
+            _fsShaderModule = shaderModule;
+        });
+#else
     _vsShaderModule = createShaderModule(
         logicalDevice,
         vertexShaderPath,
@@ -635,6 +599,7 @@ void VkApplication::createShaderModules()
         fragShaderPath,
         "main",
         "indirectDraw.frag");
+#endif
     log(Level::Info, "<--initDefaultCommandBuffers");
 }
 
@@ -673,6 +638,25 @@ void VkApplication::createGraphicsPipeline()
         _swapChainRenderPass);
 }
 
+void VkApplication::reloadGraphicsPipeline()
+{
+    ZoneScopedN("reloadGraphicsPipeline");
+    auto logicalDevice = _ctx.getLogicDevice();
+    // frames in flight may still reference the old pipelines: the last frame submitted covers them all
+    const auto &graphicsTimeline = _ctx.getQueueTimeline(_ctx.getGraphicsComputeQueue());
+    if (!graphicsTimeline.wait(graphicsTimeline.lastSubmitted().value, DEFAULT_FENCE_TIMEOUT))
+    {
+        ASSERT(false, "frames in flight somehow Timed out !");
+    }
+
+    for (const auto &[pipelineType, pipeline] : std::get<0>(_graphicsPipelineEntity))
+    {
+        vkDestroyPipeline(logicalDevice, pipeline, nullptr);
+    }
+    vkDestroyPipelineLayout(logicalDevice, std::get<1>(_graphicsPipelineEntity), nullptr);
+    createGraphicsPipeline();
+}
+
 void VkApplication::createSwapChainFramebuffers()
 {
     const auto swapChainImageViews = _ctx.getSwapChainImageViews();
@@ -691,6 +675,90 @@ void VkApplication::createSwapChainFramebuffers()
     }
 }
 
+void VkApplication::createRenderGraph()
+{
+    _renderGraph = std::make_unique<RenderGraph>();
+    // no initial access: the previous frame left them as the graph knows, the WAR against its draws included
+    const auto indirectDraw = _renderGraph->importBuffer("indirect draw", _indirectDrawB);
+    const auto culledIndirectDraw = _renderGraph->importBuffer("culled indirect draw", _cullFustrum->getCulledIDR());
+    const auto culledIndirectDrawCount = _renderGraph->importBuffer("culled indirect draw count", _cullFustrum->getCulledIDRCount());
+    // the acquire semaphore is waited on at COLOR_ATTACHMENT_OUTPUT, the content is discarded
+    _swapChainImageResource = _renderGraph->importImage(
+        "swapchain image",
+        VK_NULL_HANDLE,
+        VK_NULL_HANDLE,
+        {VK_IMAGE_ASPECT_COLOR_BIT, 0, 1, 0, 1},
+        RenderGraphAccess{VK_PIPELINE_STAGE_2_COLOR_ATTACHMENT_OUTPUT_BIT, VK_ACCESS_2_NONE, VK_IMAGE_LAYOUT_UNDEFINED});
+
+    // atomics on the counter: read and write
+    _renderGraph->addPass("cull fustrum", _cullFustrum.get())
+        .read(indirectDraw, COMPUTE_SHADER_READ_ACCESS)
+        .write(culledIndirectDraw, COMPUTE_SHADER_WRITE_ACCESS)
+        .read(culledIndirectDrawCount, COMPUTE_SHADER_READ_ACCESS)
+        .write(culledIndirectDrawCount, COMPUTE_SHADER_WRITE_ACCESS);
+
+    if (_rt)
+    {
+        // --rt: the accumulated image is what gets presented (or read back by --capture), the raster draw is replaced
+        createRayTracingPasses();
+        _renderGraph->realize(_ctx);
+        return;
+    }
+
+    auto mainDraw = _renderGraph->addPass(
+        "main draw",
+        [this](RenderGraph &, CommandBufferEntity &cmd, int frameIndex)
+        {
+            recordCommandBuffer(frameIndex, std::get<COMMAND_BUFFER_ENTITY_OFFSET::COMMAND_BUFFER>(cmd), _swapChainImageIndex);
+        });
+    mainDraw.read(culledIndirectDraw, INDIRECT_COMMAND_READ_ACCESS)
+        .read(culledIndirectDrawCount, INDIRECT_COMMAND_READ_ACCESS);
+#ifdef VK_DYNAMIC_RENDERING
+    mainDraw.write(_swapChainImageResource, COLOR_ATTACHMENT_WRITE_ACCESS);
+    _renderGraph->markOutput(_swapChainImageResource, _ctx.getSwapChainFinalLayout());
+#else
+    // the layouts of the swapchain image are on the render pass (initialLayout/finalLayout)
+    mainDraw.sideEffects();
+#endif
+    _renderGraph->realize(_ctx);
+}
+
+void VkApplication::createRayTracingPasses()
+{
+    // left in GENERAL by RayTracing::finalizeInit, then as the previous execution left it
+    const auto rtOutput = _renderGraph->importImage(
+        "rt output image",
+        _rt->outputImage(),
+        RenderGraphAccess{VK_PIPELINE_STAGE_2_RAY_TRACING_SHADER_BIT_KHR, VK_ACCESS_2_SHADER_STORAGE_WRITE_BIT, VK_IMAGE_LAYOUT_GENERAL});
+    // the tiles of this frame, the accumulation image and its barriers stay inside the pass
+    _renderGraph->addPass("ray tracing", _rt.get())
+        .write(rtOutput, RAY_TRACING_STORAGE_WRITE_ACCESS);
+    // the swapchain may have been resized since the output image was created: scaled
+    auto blit = _renderGraph->addPass(
+        "ray tracing blit",
+        [this, rtOutput](RenderGraph &graph, CommandBufferEntity &cmd, int)
+        {
+            const auto srcExtent = _rt->outputExtent();
+            const auto dstExtent = _ctx.getSwapChainExtent();
+            VkImageBlit imageBlit{};
+            imageBlit.srcSubresource = {VK_IMAGE_ASPECT_COLOR_BIT, 0, 0, 1};
+            imageBlit.srcOffsets[1] = {static_cast<int32_t>(srcExtent.width), static_cast<int32_t>(srcExtent.height), 1};
+            imageBlit.dstSubresource = {VK_IMAGE_ASPECT_COLOR_BIT, 0, 0, 1};
+            imageBlit.dstOffsets[1] = {static_cast<int32_t>(dstExtent.width), static_cast<int32_t>(dstExtent.height), 1};
+            vkCmdBlitImage(std::get<COMMAND_BUFFER_ENTITY_OFFSET::COMMAND_BUFFER>(cmd),
+                           graph.image(rtOutput),
+                           VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL,
+                           graph.image(_swapChainImageResource),
+                           VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL,
+                           1,
+                           &imageBlit,
+                           VK_FILTER_LINEAR);
+        });
+    blit.read(rtOutput, TRANSFER_READ_ACCESS)
+        .write(_swapChainImageResource, TRANSFER_WRITE_ACCESS);
+    _renderGraph->markOutput(_swapChainImageResource, _ctx.getSwapChainFinalLayout());
+}
+
 void VkApplication::recordCommandBuffer(
     uint32_t currentFrameId,
     VkCommandBuffer commandBuffer,
@@ -698,7 +766,6 @@ void VkApplication::recordCommandBuffer(
 {
     auto swapChainExtent = _ctx.getSwapChainExtent();
     const auto tracyCtx = _ctx.getTracyContext();
-    const auto swapchainImages = _ctx.getSwapChainImages();
     const auto swapchainImageViews = _ctx.getSwapChainImageViews();
     TracyPlot("Swapchain image index", (int64_t)swapChainImageIndex);
     // Begin Render Pass, only 1 render pass
@@ -727,21 +794,7 @@ void VkApplication::recordCommandBuffer(
 
 #ifdef VK_DYNAMIC_RENDERING
     // v1.3 dynamic rendering
-    VkImageMemoryBarrier2 acquireBarrier = {
-        .sType = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER_2,
-        .srcStageMask = VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT,
-        .srcAccessMask = VK_ACCESS_NONE,
-        .dstStageMask = VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT,
-        .dstAccessMask = VK_ACCESS_COLOR_ATTACHMENT_WRITE_BIT, // it is for renderpass render into swapchain image
-        .oldLayout = VK_IMAGE_LAYOUT_UNDEFINED,
-        .image = swapchainImages[swapChainImageIndex],
-        .subresourceRange = {VK_IMAGE_ASPECT_COLOR_BIT, 0, 1, 0, 1}};
-    VkDependencyInfo dependencyInfo{
-        .sType = VK_STRUCTURE_TYPE_DEPENDENCY_INFO,
-        .imageMemoryBarrierCount = 1,
-        .pImageMemoryBarriers = &acquireBarrier,
-    };
-    vkCmdPipelineBarrier2(commandBuffer, &dependencyInfo);
+    // UNDEFINED -> COLOR_ATTACHMENT_OPTIMAL ahead of the pass and -> PRESENT_SRC_KHR after it: render graph
 
     // specific struct to dynamic rendering
     VkRenderingAttachmentInfo colorAttachment{VK_STRUCTURE_TYPE_RENDERING_ATTACHMENT_INFO};
@@ -757,6 +810,8 @@ void VkApplication::recordCommandBuffer(
     renderingInfo.layerCount = 1;
     renderingInfo.colorAttachmentCount = 1;
     renderingInfo.pColorAttachments = &colorAttachment;
+    // the draws are in secondaries, see ParallelCommandRecorder
+    renderingInfo.flags = VK_RENDERING_CONTENTS_SECONDARY_COMMAND_BUFFERS_BIT;
 
     // Start a dynamic rendering section
     vkCmdBeginRendering(commandBuffer, &renderingInfo);
@@ -774,78 +829,82 @@ void VkApplication::recordCommandBuffer(
     renderPassInfo.renderArea.extent = swapChainExtent;
     renderPassInfo.clearValueCount = 1;
     renderPassInfo.pClearValues = &clearColor;
-    vkCmdBeginRenderPass(commandBuffer, &renderPassInfo, VK_SUBPASS_CONTENTS_INLINE);
+    vkCmdBeginRenderPass(commandBuffer, &renderPassInfo, VK_SUBPASS_CONTENTS_SECONDARY_COMMAND_BUFFERS);
 #endif
-    // Dynamic States (when create the graphics pipeline, they are not specified)
-    VkViewport viewport{};
-    viewport.width = (float)swapChainExtent.width;
-    viewport.height = (float)swapChainExtent.height;
-    viewport.minDepth = 0.0f;
-    viewport.maxDepth = 1.0f;
-    vkCmdSetViewport(commandBuffer, 0, 1, &viewport);
-
-    VkRect2D scissor{};
-    scissor.extent = swapChainExtent;
-    vkCmdSetScissor(commandBuffer, 0, 1, &scissor);
-    vkCmdSetDepthTestEnable(commandBuffer, VK_TRUE);
-
-    // apply graphics pipeline to the cmd
+    // the objects are recorded in parallel into secondaries, nothing is inherited from the primary:
+    // every range sets the dynamic states and binds the pipeline and the descriptor sets
+    // the handles are looked up here, the ranges only read them
     auto graphicsPipelineLookUpTable = std::get<0>(_graphicsPipelineEntity);
-    auto graphicsPipelineLayout = std::get<1>(_graphicsPipelineEntity);
-    vkCmdBindPipeline(commandBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS, graphicsPipelineLookUpTable[GRAPHICS_PIPELINE_SEMANTIC::WIREFRAME]);
-    // resource and ds to the shaders of this pipeline
-    vkCmdBindDescriptorSets(commandBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS,
-                            graphicsPipelineLayout, 0, 1,
-                            &_descriptorSets[&_descriptorSetLayouts[DESC_LAYOUT_SEMANTIC::UBO]][currentFrameId],
-                            0,
-                            nullptr);
-
-    vkCmdBindDescriptorSets(commandBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS,
-                            graphicsPipelineLayout, 1, 1,
-                            &_descriptorSets[&_descriptorSetLayouts[DESC_LAYOUT_SEMANTIC::COMBO_VERT]][0],
-                            0,
-                            nullptr);
-    vkCmdBindDescriptorSets(commandBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS,
-                            graphicsPipelineLayout, 2, 1,
-                            &_descriptorSets[&_descriptorSetLayouts[DESC_LAYOUT_SEMANTIC::COMBO_IDR]][0],
-                            0,
-                            nullptr);
-    vkCmdBindDescriptorSets(commandBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS,
-                            graphicsPipelineLayout, 3, 1,
-                            &_descriptorSets[&_descriptorSetLayouts[DESC_LAYOUT_SEMANTIC::TEX_SAMP]][0],
-                            0, nullptr);
-    vkCmdBindDescriptorSets(commandBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS,
-                            graphicsPipelineLayout, 4, 1,
-                            &_descriptorSets[&_descriptorSetLayouts[DESC_LAYOUT_SEMANTIC::COMBO_MAT]][0],
-                            0, nullptr);
-
-    const auto dstSets = _descriptorSets[&_descriptorSetLayouts[DESC_LAYOUT_SEMANTIC::OBJECT_DYNAMIC_UBO]];
-    for (uint32_t i = 0; i < NUM_OBJECTS; i++)
+    const auto graphicsPipeline = graphicsPipelineLookUpTable[GRAPHICS_PIPELINE_SEMANTIC::WIREFRAME];
+    const auto graphicsPipelineLayout = std::get<1>(_graphicsPipelineEntity);
+    const std::array<VkDescriptorSet, 5> sharedSets{
+        _descriptorSets[&_descriptorSetLayouts[DESC_LAYOUT_SEMANTIC::UBO]][currentFrameId],
+        _descriptorSets[&_descriptorSetLayouts[DESC_LAYOUT_SEMANTIC::COMBO_VERT]][currentFrameId],
+        _descriptorSets[&_descriptorSetLayouts[DESC_LAYOUT_SEMANTIC::COMBO_IDR]][0],
+        _bindlessHeap->descriptorSet(),
+        _descriptorSets[&_descriptorSetLayouts[DESC_LAYOUT_SEMANTIC::COMBO_MAT]][0],
+    };
+    const auto objectSet = _descriptorSets[&_descriptorSetLayouts[DESC_LAYOUT_SEMANTIC::OBJECT_DYNAMIC_UBO]][currentFrameId];
+    // with gpu culling pass
+    const auto culledIDRHandle = std::get<0>(this->_cullFustrum->getCulledIDR());
+    const auto culledIDRCountHandle = std::get<0>(this->_cullFustrum->getCulledIDRCount());
+
+    const auto recordObjects = [&](VkCommandBuffer cmd, size_t begin, size_t end)
     {
-        // One dynamic offset per dynamic descriptor to offset into the ubo containing all model matrices
-        uint32_t dynamicOffset = i * static_cast<uint32_t>(_dynamicAlignment);
-        // Bind the descriptor set for rendering a mesh using the dynamic offset
-        vkCmdBindDescriptorSets(commandBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS, graphicsPipelineLayout,
-                                5, 1, &dstSets[0], 1, &dynamicOffset);
-        vkCmdPushConstants(commandBuffer, graphicsPipelineLayout, VK_SHADER_STAGE_VERTEX_BIT, 0, sizeof(glm::mat4), &_scales[i]);
-        // auto identity = glm::mat4(1.0f);
-        // // crash
-        // vkCmdPushConstants(commandBuffer, graphicsPipelineLayout, VK_SHADER_STAGE_VERTEX_BIT, 0, sizeof(glm::mat4), &identity);
-        
-        vkCmdBindIndexBuffer(commandBuffer, std::get<0>(_compositeIB), 0, VK_INDEX_TYPE_UINT32);
-
-        // with gpu culling pass
-        const auto culledIDRHandle = std::get<0>(this->_cullFustrum->getCulledIDR());
-        const auto culledIDRCountHandle = std::get<0>(this->_cullFustrum->getCulledIDRCount());
+        // Dynamic States (when create the graphics pipeline, they are not specified)
+        VkViewport viewport{};
+        viewport.width = (float)swapChainExtent.width;
+        viewport.height = (float)swapChainExtent.height;
+        viewport.minDepth = 0.0f;
+        viewport.maxDepth = 1.0f;
+        vkCmdSetViewport(cmd, 0, 1, &viewport);
+
+        VkRect2D scissor{};
+        scissor.extent = swapChainExtent;
+        vkCmdSetScissor(cmd, 0, 1, &scissor);
+        vkCmdSetDepthTestEnable(cmd, VK_TRUE);
+
+        // apply graphics pipeline to the cmd
+        vkCmdBindPipeline(cmd, VK_PIPELINE_BIND_POINT_GRAPHICS, graphicsPipeline);
+        // resource and ds to the shaders of this pipeline, set 0 (ubo) is dynamic
+        vkCmdBindDescriptorSets(cmd, VK_PIPELINE_BIND_POINT_GRAPHICS,
+                                graphicsPipelineLayout, 0, 1,
+                                &sharedSets[0],
+                                1,
+                                &_globalUniform.offset);
+        vkCmdBindDescriptorSets(cmd, VK_PIPELINE_BIND_POINT_GRAPHICS,
+                                graphicsPipelineLayout, 1, (uint32_t)sharedSets.size() - 1,
+                                &sharedSets[1],
+                                0, nullptr);
+        vkCmdBindIndexBuffer(cmd, std::get<0>(_compositeIB), 0, VK_INDEX_TYPE_UINT32);
+
+        for (size_t i = begin; i < end; i++)
         {
-            // extra scope as required by TracyVkZone
-            TracyVkZone(tracyCtx, commandBuffer, "main draw pass");
+            // One dynamic offset per dynamic descriptor to offset into the ubo containing all model matrices
+            uint32_t dynamicOffset = _objectUniforms[i].offset;
+            // Bind the descriptor set for rendering a mesh using the dynamic offset
+            vkCmdBindDescriptorSets(cmd, VK_PIPELINE_BIND_POINT_GRAPHICS, graphicsPipelineLayout,
+                                    5, 1, &objectSet, 1, &dynamicOffset);
+            vkCmdPushConstants(cmd, graphicsPipelineLayout, VK_SHADER_STAGE_VERTEX_BIT, 0, sizeof(glm::mat4), &_scales[i]);
             vkCmdDrawIndexedIndirectCount(
-                commandBuffer,
+                cmd,
                 culledIDRHandle, 0,
                 culledIDRCountHandle, 0,
                 _numMeshes, sizeof(IndirectDrawForVulkan));
         }
+    };
+
+    SecondaryCommandBufferInheritance inheritance;
+#ifdef VK_DYNAMIC_RENDERING
+    inheritance.colorAttachmentFormats = {_ctx.getSwapChainFormat()};
+#else
+    inheritance.renderPass = _swapChainRenderPass;
+    inheritance.framebuffer = _swapChainFramebuffers[swapChainImageIndex];
+#endif
+    {
+        // extra scope as required by TracyVkZone
+        TracyVkZone(tracyCtx, commandBuffer, "main draw pass");
+        _commandRecorder->record(commandBuffer, inheritance, NUM_OBJECTS, MIN_OBJECTS_PER_RECORDING_JOB, recordObjects);
     }
 
     // how many draws are dependent on how many meshes in the scene.
@@ -892,49 +951,26 @@ void VkApplication::preHostDeviceIO()
     _ctx.BeginRecordCommandBuffer(cmdBuffersForIO);
 }
 
-// end recording of buffer.
-// wait for completion using fence
-void VkApplication::postHostDeviceIO()
+// end recording of buffer and submit it
+// returns the point of the graphics timeline signaled once the copies are done
+TimelinePoint VkApplication::submitHostDeviceIO()
 {
-    auto logicalDevice = _ctx.getLogicDevice();
-    auto graphicsQueue = _ctx.getGraphicsComputeQueue();
-    auto vmaAllocator = _ctx.getVmaAllocator();
-
     auto cmdBuffersForIO = _ctx.getCommandBufferForIO();
-    // auto cmdBuffersForIO = _cmdBuffers[COMMAND_SEMANTIC::IO];
-    // ASSERT(cmdBuffersForIO.size() == 1, "Only use 1 cmdBuffer for IO");
-    const auto uploadCmdBuffer = std::get<1>(cmdBuffersForIO);
-    const auto uploadCmdBufferFence = std::get<2>(cmdBuffersForIO);
 
     // collect the timestamps of the command buffer
     const auto tracyCtx = _ctx.getTracyContext();
     TracyVkCollect(tracyCtx, std::get<COMMAND_BUFFER>(cmdBuffersForIO));
     _ctx.EndRecordCommandBuffer(cmdBuffersForIO);
 
-    const VkPipelineStageFlags flags = VK_PIPELINE_STAGE_TRANSFER_BIT;
-
-    VkSubmitInfo submitInfo{};
-    submitInfo.waitSemaphoreCount = 0;
-    submitInfo.pWaitSemaphores = VK_NULL_HANDLE;
-    // only useful when having waitsemaphore
-    submitInfo.pWaitDstStageMask = &flags;
-    submitInfo.sType = VK_STRUCTURE_TYPE_SUBMIT_INFO;
-    submitInfo.commandBufferCount = 1;
-    submitInfo.pCommandBuffers = &uploadCmdBuffer;
-    submitInfo.signalSemaphoreCount = 0;
-    submitInfo.pSignalSemaphores = VK_NULL_HANDLE;
-
-    // must resetfence of waiting
-    VK_CHECK(vkResetFences(logicalDevice, 1, &uploadCmdBufferFence));
-    VK_CHECK(vkQueueSubmit(graphicsQueue, 1, &submitInfo, uploadCmdBufferFence));
-
-    const auto result = vkWaitForFences(logicalDevice, 1, &uploadCmdBufferFence, VK_TRUE,
-                                        DEFAULT_FENCE_TIMEOUT);
-    if (result == VK_TIMEOUT)
-    {
-        vkDeviceWaitIdle(logicalDevice);
-    }
-    // clean all the staging resources
+    return _ctx.submitCommandBuffer(cmdBuffersForIO);
+}
+
+// the copies are done: clean all the staging resources
+void VkApplication::postHostDeviceIO()
+{
+    auto logicalDevice = _ctx.getLogicDevice();
+    auto vmaAllocator = _ctx.getVmaAllocator();
+
     if (_stagingVb != VK_NULL_HANDLE)
         vkDestroyBuffer(logicalDevice, _stagingVb, nullptr);
     if (_stagingIb != VK_NULL_HANDLE)
@@ -944,28 +980,51 @@ void VkApplication::postHostDeviceIO()
     if (_stagingImageBuffer != VK_NULL_HANDLE)
         vkDestroyBuffer(logicalDevice, _stagingImageBuffer, nullptr);
 
-    // for glb Scene
-    for (size_t i = 0; i < _stagingVbForMesh.size(); ++i)
-    {
-        vmaDestroyBuffer(vmaAllocator, std::get<0>(_stagingVbForMesh[i]), std::get<1>(_stagingVbForMesh[i]));
-    }
-    for (size_t i = 0; i < _stagingIbForMesh.size(); ++i)
-    {
-        vmaDestroyBuffer(vmaAllocator, std::get<0>(_stagingIbForMesh[i]), std::get<1>(_stagingIbForMesh[i]));
-    }
-    // for indirectDrawBuffer
+    // the staging regions of the glb scene went back to the staging ring with the submit
+    // for textures in glb
+    for (size_t i = 0; i < _glbImageStagingBuffers.size(); ++i)
     {
-        vmaDestroyBuffer(vmaAllocator, std::get<0>(_stagingIndirectDrawBuffer), std::get<1>(_stagingIndirectDrawBuffer));
+        vmaDestroyBuffer(vmaAllocator, std::get<0>(_glbImageStagingBuffers[i]), std::get<1>(_glbImageStagingBuffers[i]));
     }
-    // for material buffer
+}
+
+// composite vertex/index/material/indirect buffers
+// recorded and submitted before the first suspension, the staging buffers go once the copies are done
+Task<void> VkApplication::uploadGeometryAsync()
+{
+    preHostDeviceIO();
+    loadGLB();
+    const auto ioDone = submitHostDeviceIO();
+    // the ring takes the regions back by itself once the timeline reaches ioDone
+    auto &stagingRing = _ctx.getStagingRing();
+    for (size_t meshId = 0; meshId < _stagingVbForMesh.size(); ++meshId)
     {
-        vmaDestroyBuffer(vmaAllocator, std::get<0>(_stagingMatBuffer), std::get<1>(_stagingMatBuffer));
+        stagingRing.retire(_stagingVbForMesh[meshId], ioDone.semaphore, ioDone.value);
+        stagingRing.retire(_stagingIbForMesh[meshId], ioDone.semaphore, ioDone.value);
     }
-    // for textures in glb
-    for (size_t i = 0; i < _glbImageStagingBuffers.size(); ++i)
+    // filled by loadGLB only when buffer device address is supported
+    if (_stagingMatBuffer.mappedData)
     {
-        vmaDestroyBuffer(vmaAllocator, std::get<0>(_glbImageStagingBuffers[i]), std::get<1>(_glbImageStagingBuffers[i]));
+        stagingRing.retire(_stagingMatBuffer, ioDone.semaphore, ioDone.value);
+        stagingRing.retire(_stagingIndirectDrawBuffer, ioDone.semaphore, ioDone.value);
+        stagingRing.retire(_stagingInstanceTransformBuffer, ioDone.semaphore, ioDone.value);
     }
+    _stagingVbForMesh.clear();
+    _stagingIbForMesh.clear();
+    co_await _gpuWatcher->timeline(ioDone.semaphore, ioDone.value);
+    postHostDeviceIO();
+}
+
+// scene loading as sequential steps, nothing blocks on the gpu:
+// the geometry copy is in flight while the textures are queued to the io strand.
+// completes with the geometry, the textures keep streaming in (_sceneLoadScope)
+// the blas is not part of it: the ray tracing pass is disabled in init
+Task<void> VkApplication::loadSceneAsync()
+{
+    std::vector<Task<void>> uploads;
+    uploads.emplace_back(uploadGeometryAsync());
+    uploads.emplace_back(loadGLBTextureAsync());
+    co_await whenAll(std::move(uploads));
 }
 
 // // cull face be careful
@@ -1464,273 +1523,400 @@ void VkApplication::postHostDeviceIO()
 //     //            VMA_MEMORY_USAGE_GPU_ONLY, "vertex"));
 // }
 
-inline void genTextureMipmaps(VkContext *ctx,
-                              size_t textureId,
-                              ImageEntity &image,
-                              BufferEntity &stagingBuffer,
-                              CommandBufferEntity &cmdBufferForGraphics,
-                              CommandBufferEntity &cmdBufferForTransferOnly,
-                              VkSemaphore semaphoreFromTransfer,
-                              std::vector<VkSemaphore> &interCommunicationSemaphores,
-                              std::function<void(int, ImageEntity)> textureReadyCallback)
+// one texture, as sequential steps
+// 1. io strand: image + staging ring region, texels copied into the region
+// 2. upload scheduler: batched with the other uploads of the tick (copy, ownership transfer, mip chain)
+// 3. gpu done (timeline watched, no thread blocks on it): publish the image
+Task<void> VkApplication::uploadTextureAsync(size_t textureId, std::stop_token cancelToken, size_t reservedBytes)
 {
-    log(Level::Info, "genTextureMipmaps");
-    // semaphore ensures we are safe to release stagingBuffer here
-    auto vmaAllocator = ctx->getVmaAllocator();
-    // vmaDestroyBuffer(
-    //     vmaAllocator,
-    //     std::get<0>(stagingBuffer),
-    //     std::get<1>(stagingBuffer));
-    ctx->BeginRecordCommandBuffer(cmdBufferForGraphics);
-    const auto srcQueueFamilyIndex = std::get<3>(cmdBufferForTransferOnly);
-    const auto graphicsBufferHandle = std::get<1>(cmdBufferForGraphics);
-    const auto graphicsBufferFence = std::get<2>(cmdBufferForGraphics);
-    const auto dstQueueFamilyIndex = std::get<3>(cmdBufferForGraphics);
-    const auto graphicsCmdQueue = std::get<4>(cmdBufferForGraphics);
-
-    // step2: acqure the ownership from transfer queue
-    ctx->acquireQueueFamilyOwnership(
-        cmdBufferForGraphics,
-        image,
-        srcQueueFamilyIndex,
-        dstQueueFamilyIndex);
-    ctx->generateMipmaps(
-        image,
-        cmdBufferForGraphics);
-    ctx->EndRecordCommandBuffer(cmdBufferForGraphics);
-
-    // blit image is done at the stage color_attachment_output(write image)
-    const VkPipelineStageFlags flags = VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT;
-    // uploadTextureToGPU does not need to wait for any previous op
-    // semaphore wait on transfer.
-    VkSubmitInfo submitInfo{};
-    submitInfo.waitSemaphoreCount = 1;
-    submitInfo.pWaitSemaphores = &semaphoreFromTransfer;
-    submitInfo.pWaitDstStageMask = &flags;
-    submitInfo.sType = VK_STRUCTURE_TYPE_SUBMIT_INFO;
-    submitInfo.commandBufferCount = 1;
-    submitInfo.pCommandBuffers = &graphicsBufferHandle;
-    submitInfo.signalSemaphoreCount = 0;
-    submitInfo.pSignalSemaphores = VK_NULL_HANDLE;
-
-    // must resetfence of waiting
-    VK_CHECK(vkResetFences(ctx->getLogicDevice(), 1, &graphicsBufferFence));
-    VK_CHECK(vkQueueSubmit(graphicsCmdQueue, 1, &submitInfo, graphicsBufferFence));
-
-    interCommunicationSemaphores.push_back(semaphoreFromTransfer);
-
-    // callback
-    textureReadyCallback(textureId, image);
-}
+    co_await resumeOn(_asyncTaskQueue);
+    if (cancelToken.stop_requested())
+    {
+        // scene unloaded while queued: nothing created yet
+        log(Level::Info, "uploadTextureAsync cancelled : ", textureId);
+        _stagingBudget.release(reservedBytes);
+        co_return;
+    }
+    log(Level::Info, "uploadTextureAsync : ", textureId);
+    auto logicalDevice = _ctx.getLogicDevice();
+    auto vmaAllocator = _ctx.getVmaAllocator();
+    const auto *texture = _scene->textures[textureId].get();
 
-inline void uploadTextureToGPU(
-    VkContext *ctx,
-    size_t textureId,
-    const std::string &name,
-    Texture *texture,
-    CommandBufferEntity &cmdBufferForGraphics,
-    CommandBufferEntity &cmdBufferForTransferOnly,
-    QueueThreadSafe<std::packaged_task<void(void)>> *queue,
-    std::vector<VkSemaphore> &interCommunicationSemaphores,
-    std::function<void(int, ImageEntity)> textureReadyCallback,
-    std::vector<BufferEntity> &imageBuffers,
-    std::vector<ImageEntity> &imageEntities)
-{
-    log(Level::Info, "uploadTextureToGPU : ", name);
     const auto textureMipLevels = getMipLevelsCount(texture->width(),
                                                     texture->height());
     const uint32_t textureLayoutCount = 1;
     const VkExtent3D textureExtent = {static_cast<uint32_t>(texture->width()),
                                       static_cast<uint32_t>(texture->height()), 1};
     const bool generateMipmaps = true;
-    const auto imageEntity = ctx->createImage("glb_tex_" + std::to_string(textureId),
+    const auto imageEntity = _ctx.createImage("glb_tex_" + std::to_string(textureId),
                                               VK_IMAGE_TYPE_2D,
                                               VK_FORMAT_R8G8B8A8_UNORM,
                                               textureExtent,
                                               textureMipLevels,
                                               textureLayoutCount,
                                               VK_SAMPLE_COUNT_1_BIT,
-                                              // usage here: both dst and src as mipmap generation
-                                              VK_IMAGE_USAGE_TRANSFER_DST_BIT | VK_IMAGE_USAGE_SAMPLED_BIT |
-                                                  VK_IMAGE_USAGE_TRANSFER_SRC_BIT,
-                                              VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT,
-                                              generateMipmaps);
-    imageEntities.emplace_back(imageEntity);
+                                              GLB_TEXTURE_USAGE,
+                                              // filled from the staging ring, never mapped
+                                              VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT,
+                                              generateMipmaps,
+                                              TEXTURE_MEMORY);
 
     // write raw data from cpu to the mipmap level 0 of image
-    const auto stagingBufferSizeForImage = std::get<3>(imageEntity).size;
-
-    // caution: async io race condition from multi-threading
-    // createStagingBuffer must be in the same thread of gpu data uploader
-    auto stagingBuffer = ctx->createStagingBuffer(
-        "Staging Buffer Texture " + std::to_string(textureId),
-        stagingBufferSizeForImage);
-    // data racing hazard
-    imageBuffers.emplace_back(stagingBuffer);
-
-    const auto transferCmdBufferHandle = std::get<1>(cmdBufferForTransferOnly);
-    const auto srcQueueFamilyIndex = std::get<3>(cmdBufferForTransferOnly);
-    const auto dstQueueFamilyIndex = std::get<3>(cmdBufferForGraphics);
-    const auto transferCmdBufferFence = std::get<2>(cmdBufferForTransferOnly);
-    const auto transferCmdQueue = std::get<4>(cmdBufferForTransferOnly);
-    ctx->BeginRecordCommandBuffer(cmdBufferForTransferOnly);
-    // the {} is for tracy zone
-    // always between the Begin* and End*
+    // rgba8 level 0 only, the mip chain is generated on the gpu
+    const auto stagingRegion = _ctx.getStagingRing().allocate(
+        static_cast<VkDeviceSize>(textureExtent.width) * textureExtent.height * 4);
     {
-        ZoneScopedN("uploadTextureToGPU::writeImage");
-        ctx->writeImage(
-            imageEntity,
-            stagingBuffer,
-            cmdBufferForTransferOnly,
-            texture->data());
-        ctx->releaseQueueFamilyOwnership(
-            cmdBufferForTransferOnly,
-            imageEntity,
-            srcQueueFamilyIndex,
-            dstQueueFamilyIndex);
+        ZoneScopedN("uploadTextureAsync::writeImage");
+        memcpy(stagingRegion.mappedData, texture->data(), stagingRegion.size);
     }
-    ctx->EndRecordCommandBuffer(cmdBufferForTransferOnly);
 
-    VkSemaphore semaphore;
-    const VkSemaphoreCreateInfo semaphoreInfo{
-        .sType = VK_STRUCTURE_TYPE_SEMAPHORE_CREATE_INFO,
-    };
-    VK_CHECK(vkCreateSemaphore(ctx->getLogicDevice(), &semaphoreInfo, nullptr, &semaphore));
-
-    const VkPipelineStageFlags flags = VK_PIPELINE_STAGE_TRANSFER_BIT;
-    // uploadTextureToGPU does not need to wait for any previous op
-    // semaphore wait on transfer.
-    VkSubmitInfo submitInfo{};
-    submitInfo.waitSemaphoreCount = 0;
-    submitInfo.pWaitSemaphores = VK_NULL_HANDLE;
-    submitInfo.pWaitDstStageMask = &flags; // ignored here since nothing to wait for
-    submitInfo.sType = VK_STRUCTURE_TYPE_SUBMIT_INFO;
-    submitInfo.commandBufferCount = 1;
-    submitInfo.pCommandBuffers = &transferCmdBufferHandle;
-    submitInfo.signalSemaphoreCount = 1;
-    submitInfo.pSignalSemaphores = &semaphore;
-
-    // must resetfence of waiting
-    VK_CHECK(vkResetFences(ctx->getLogicDevice(), 1, &transferCmdBufferFence));
-    VK_CHECK(vkQueueSubmit(transferCmdQueue, 1, &submitInfo, transferCmdBufferFence));
-
-    std::packaged_task<void(void)> task(std::bind(
-        &genTextureMipmaps,
-        ctx,
-        textureId,
-        imageEntity,
-        stagingBuffer,
-        cmdBufferForGraphics,
-        cmdBufferForTransferOnly,
-        semaphore,
-        interCommunicationSemaphores,
-        textureReadyCallback));
-
-    // std::future futureHandle = task.get_future();
-    // // cache the future for retrieve in the future action.
-    // _asyncUploadTextureTaskFutures.emplace_back(std::move(futureHandle));
-
-    queue->push(std::move(task));
+    // the scheduler retires the region and releases/acquires the image between the queue families;
+    // even when cancelled meanwhile, the upload goes through so that the image is released only once
+    // the gpu is done with it
+    const auto uploaded = co_await _uploadScheduler->upload(ImageUpload{stagingRegion, imageEntity});
+    // no tracy zone across a co_await: the coroutine may resume on another thread
+    co_await _gpuWatcher->timeline(uploaded.semaphore, uploaded.value);
+
+    if (cancelToken.stop_requested())
+    {
+        // scene is being unloaded, nobody takes the image
+        vkDestroyImageView(logicalDevice, std::get<1>(imageEntity), nullptr);
+        vmaDestroyImage(vmaAllocator, std::get<0>(imageEntity), std::get<2>(imageEntity));
+    }
+    else
+    {
+        {
+            std::scoped_lock lock{_glbImageEntitiesMutex};
+            _glbImageEntities.emplace_back(imageEntity);
+            _glbTextureIds.emplace(std::get<IMAGE_ENTITY_OFFSET::IMAGE_VMA_ALLOCATION>(imageEntity), textureId);
+        }
+        _bindlessHeap->writeSampledImage(_textureSlots[textureId],
+                                         std::get<IMAGE_ENTITY_OFFSET::IMAGE_VIEW>(imageEntity));
+        _ctx.getMemoryManager().registerRelocation(std::get<IMAGE_ENTITY_OFFSET::IMAGE_VMA_ALLOCATION>(imageEntity),
+                                                   textureRelocation(textureId, std::get<IMAGE_ENTITY_OFFSET::IMAGE_VMA_ALLOCATION>(imageEntity)));
+        log(Level::Info, "uploadTextureAsync completed : ", textureId);
+    }
+    // last: unloadScene joins the scope before releasing the scene
+    _stagingBudget.release(reservedBytes);
 }
 
-void VkApplication::loadGLBTextureAsync()
+Task<void> VkApplication::loadGLBTextureAsync()
 {
     const auto vk12FeatureCaps = _ctx.getVk12FeatureCaps();
-    auto logicalDevice = _ctx.getLogicDevice();
-
-    auto vmaAllocator = _ctx.getVmaAllocator();
-    const auto selectedPhysicalDevice = _ctx.getSelectedPhysicalDevice();
-    const auto selectedPhysicalDeviceProp = _ctx.getSelectedPhysicalDeviceProp();
-
-    auto cmdBuffersForMipmap = _ctx.getCommandBufferForMipmapOnly();
-    auto cmdBuffersForTransferOnly = _ctx.getCommandBufferForTransferOnly();
 
     // check device feature supported
     if (vk12FeatureCaps.bufferDeviceAddress)
     {
-        // textures
-        // 1. create image
-        // 2. create image view
-        // 3. upload through stage buffer
-        size_t textureId = 0;
-        for (const auto &texture : _scene->textures)
+        for (size_t textureId = 0; textureId < _scene->textures.size(); ++textureId)
         {
-            // // log(Level::Info, "texture: ", textureId);
-
-            // // 1. create Image
-            // const auto textureMipLevels = getMipLevelsCount(texture->width,
-            //                                                 texture->height);
-            // const uint32_t textureLayoutCount = 1;
-            // const VkExtent3D textureExtent = {static_cast<uint32_t>(texture->width),
-            //                                   static_cast<uint32_t>(texture->height), 1};
-            // const bool generateMipmaps = true;
-            // const auto imageEntity = _ctx.createImage("glb_tex_" + std::to_string(textureId),
-            //                                           VK_IMAGE_TYPE_2D,
-            //                                           VK_FORMAT_R8G8B8A8_UNORM,
-            //                                           textureExtent,
-            //                                           textureMipLevels,
-            //                                           textureLayoutCount,
-            //                                           VK_SAMPLE_COUNT_1_BIT,
-            //                                           // usage here: both dst and src as mipmap generation
-            //                                           VK_IMAGE_USAGE_TRANSFER_DST_BIT | VK_IMAGE_USAGE_SAMPLED_BIT | VK_IMAGE_USAGE_TRANSFER_SRC_BIT,
-            //                                           VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT,
-            //                                           generateMipmaps);
-
-            // _glbImageEntities.emplace_back(imageEntity);
-
-            // life cycle should be within uploadGPU scope only
-
-            // // write raw data from cpu to the mipmap level 0 of image
-            // const auto stagingBufferSizeForImage = std::get<3>(imageEntity).size;
-
-            // // caution: async io race condition from multi-threading
-            // // createStagingBuffer must be in the same thread of gpu data uploader
-            // _glbImageStagingBuffers.emplace_back(_ctx.createStagingBuffer(
-            //     "Staging Buffer Texture " + std::to_string(textureId),
-            //     stagingBufferSizeForImage));
-
-            // use case of packaged_task
-            // bind the arguments directly before you construct the task,
-            // in which case the task itself now has a signature that takes no arguments
-            auto textureReadyCB = [this](int textureId, ImageEntity imageEntity)
+            const auto &texture = _scene->textures[textureId];
+            log(Level::Info, "Texture address: ", texture.get());
+
+            // backpressure: bound the staging memory of the queued uploads
+            // rgba8 level 0 plus 1/3 for the mip chain
+            const size_t baseLevelBytes = static_cast<size_t>(texture->width()) * texture->height() * 4;
+            const size_t reservedBytes = baseLevelBytes + baseLevelBytes / 3;
+            const auto cancelToken = _sceneUploadStopSource.get_token();
             {
-                const auto dstSets = _descriptorSets[&_descriptorSetLayouts[DESC_LAYOUT_SEMANTIC::TEX_SAMP]];
-                _ctx.bindTextureToDescriptorSet(
-                    {imageEntity},
-                    dstSets[0],
-                    VK_DESCRIPTOR_TYPE_SAMPLED_IMAGE,
-                    textureId);
-                log(Level::Info, "genTextureMipmaps completed !");
-            };
+                ZoneScopedN("loadGLBTextureAsync::stagingBudget");
+                if (!_stagingBudget.acquire(reservedBytes, cancelToken))
+                {
+                    log(Level::Info, "loadGLBTextureAsync cancelled");
+                    co_return;
+                }
+            }
+            // owned by the scene: keeps streaming once the scene load is done
+            _sceneLoadScope.spawn(uploadTextureAsync(textureId, cancelToken, reservedBytes));
+        }
+    }
+    co_return;
+}
 
-            log(Level::Info, "Texture address: ", texture.get());
+void VkApplication::unloadScene()
+{
+    ZoneScopedN("unloadScene");
+    // queued uploads bail out right away, in-flight ones finish their gpu work but skip the binding
+    _sceneUploadStopSource.request_stop();
+    // every upload releases its reservation when done (or skipped)
+    _sceneLoadScope.join();
+    _stagingBudget.waitIdle();
 
-            std::packaged_task<uploadTextureFn> task(std::bind(
-                &uploadTextureToGPU,
-                &_ctx,
-                textureId,
-                "Staging Buffer Texture " + std::to_string(textureId),
-                texture.get(),
-                cmdBuffersForMipmap,
-                cmdBuffersForTransferOnly,
-                &_asyncTaskQueueForGenMipmaps,
-                _asyncTransferSemaphorePool,
-                textureReadyCB,
-                _glbImageStagingBuffers,
-                _glbImageEntities));
+    auto logicalDevice = _ctx.getLogicDevice();
+    auto vmaAllocator = _ctx.getVmaAllocator();
+    // no texture may be moving while it is destroyed
+    _memoryDefragmenter->finish();
+    // textures might still be sampled by the frames in flight
+    vkDeviceWaitIdle(logicalDevice);
+    {
+        std::scoped_lock lock{_glbImageEntitiesMutex};
+        for (const auto &imageEntity : _glbImageEntities)
+        {
+            const auto image = std::get<0>(imageEntity);
+            const auto imageView = std::get<1>(imageEntity);
+            const auto imageAllocation = std::get<2>(imageEntity);
+            _ctx.getMemoryManager().unregisterRelocation(imageAllocation);
 
-            std::future futureHandle = task.get_future();
-            // cache the future for retrieve in the future action.
-            _asyncUploadTextureTaskFutures.emplace_back(std::move(futureHandle));
+            vkDestroyImageView(logicalDevice, imageView, nullptr);
+            vmaDestroyImage(vmaAllocator, image, imageAllocation);
+        }
+        _glbImageEntities.clear();
+        _glbTextureIds.clear();
+    }
+    // the scene's texture slots, recycled once the frames in flight are done, the evicted ones already are
+    for (const auto slot : _textureSlots)
+    {
+        if (slot != INVALID_BINDLESS_HANDLE)
+        {
+            _bindlessHeap->free(BINDLESS_SAMPLED_IMAGE, slot);
+        }
+    }
+    _textureSlots.clear();
+    if (_samplerSlotBase != INVALID_BINDLESS_HANDLE)
+    {
+        _bindlessHeap->free(BINDLESS_SAMPLER, _samplerSlotBase, static_cast<uint32_t>(_glbSamplerEntities.size()));
+        _samplerSlotBase = INVALID_BINDLESS_HANDLE;
+    }
+    _materials.clear();
+    _dirtyMaterials.clear();
+    // next scene gets a fresh token
+    _sceneUploadStopSource = std::stop_source();
+}
+
+MemoryRelocation VkApplication::textureRelocation(size_t textureId, VmaAllocation allocation)
+{
+    // record -> commit: the new image, commit -> release: the old one
+    auto other = std::make_shared<ImageEntity>();
+    const auto findTexture = [this, allocation]()
+    {
+        return std::find_if(_glbImageEntities.begin(), _glbImageEntities.end(), [allocation](const ImageEntity &imageEntity)
+                            { return std::get<IMAGE_ENTITY_OFFSET::IMAGE_VMA_ALLOCATION>(imageEntity) == allocation; });
+    };
+    return MemoryRelocation{
+        .record = [this, other, findTexture](VmaAllocation dstTmpAllocation, VkCommandBuffer cmd)
+        {
+            std::scoped_lock lock{_glbImageEntitiesMutex};
+            const auto it = findTexture();
+            if (it == _glbImageEntities.end())
+            {
+                return false;
+            }
+            *other = MemoryDefragmenter::relocateImage(_ctx, *it, GLB_TEXTURE_USAGE, dstTmpAllocation, cmd);
+            return true;
+        },
+        .commit = [this, other, findTexture, textureId]()
+        {
+            const auto relocated = *other;
+            {
+                std::scoped_lock lock{_glbImageEntitiesMutex};
+                const auto it = findTexture();
+                ASSERT(it != _glbImageEntities.end(), "a moving texture is released by unloadScene only after finish()");
+                std::swap(*it, *other);
+            }
+            // the frames in flight still sample the old slot: the new view goes to a fresh slot and
+            // the materials are pointed at it, the old slot is recycled once those frames are done
+            const auto oldSlot = _textureSlots[textureId];
+            const auto newSlot = _bindlessHeap->allocate(BINDLESS_SAMPLED_IMAGE);
+            _bindlessHeap->writeSampledImage(newSlot, std::get<IMAGE_ENTITY_OFFSET::IMAGE_VIEW>(relocated));
+            _textureSlots[textureId] = newSlot;
+            for (uint32_t materialId = 0; materialId < _materials.size(); ++materialId)
+            {
+                if (_materials[materialId].basecolorTextureId == static_cast<int>(oldSlot))
+                {
+                    _materials[materialId].basecolorTextureId = static_cast<int>(newSlot);
+                    _dirtyMaterials.push_back(materialId);
+                }
+            }
+            _bindlessHeap->free(BINDLESS_SAMPLED_IMAGE, oldSlot);
+        },
+        .release = [this, other]()
+        {
+            // the memory belongs to vma
+            vkDestroyImageView(_ctx.getLogicDevice(), std::get<IMAGE_ENTITY_OFFSET::IMAGE_VIEW>(*other), nullptr);
+            vkDestroyImage(_ctx.getLogicDevice(), std::get<IMAGE_ENTITY_OFFSET::IMAGE>(*other), nullptr);
+        },
+    };
+}
 
-            log(Level::Info, "_asyncTaskQueue.push");
+VkDeviceSize VkApplication::evictTextures(uint32_t heapIndex, VkDeviceSize bytesToFree)
+{
+    ZoneScopedN("evictTextures");
+    auto vmaAllocator = _ctx.getVmaAllocator();
+    const VkPhysicalDeviceMemoryProperties *memoryProperties = nullptr;
+    vmaGetMemoryProperties(vmaAllocator, &memoryProperties);
 
-            _asyncTaskQueue.push(std::move(task));
+    // the largest textures of the heap first, as few as possible
+    std::vector<std::pair<VkDeviceSize, VmaAllocation>> candidates;
+    {
+        std::scoped_lock lock{_glbImageEntitiesMutex};
+        for (const auto &imageEntity : _glbImageEntities)
+        {
+            const auto allocation = std::get<IMAGE_ENTITY_OFFSET::IMAGE_VMA_ALLOCATION>(imageEntity);
+            VmaAllocationInfo allocationInfo;
+            vmaGetAllocationInfo(vmaAllocator, allocation, &allocationInfo);
+            if (memoryProperties->memoryTypes[allocationInfo.memoryType].heapIndex == heapIndex)
+            {
+                candidates.emplace_back(allocationInfo.size, allocation);
+            }
+        }
+    }
+    if (candidates.empty())
+    {
+        return 0;
+    }
+    std::sort(candidates.begin(), candidates.end(), [](const auto &a, const auto &b)
+              { return a.first > b.first; });
+    VkDeviceSize freed = 0;
+    size_t count = 0;
+    while (count < candidates.size() && freed < bytesToFree)
+    {
+        freed += candidates[count++].first;
+    }
+    candidates.resize(count);
 
-            ++textureId;
+    // no texture may be moving while it is destroyed, and the frames in flight may sample them:
+    // over budget is rare enough to stall for it
+    _memoryDefragmenter->finish();
+    vkDeviceWaitIdle(_ctx.getLogicDevice());
 
-            // std::this_thread::sleep_for(0.01s);
+    std::scoped_lock lock{_glbImageEntitiesMutex};
+    for (const auto &[size, allocation] : candidates)
+    {
+        const auto it = std::find_if(_glbImageEntities.begin(), _glbImageEntities.end(), [allocation](const ImageEntity &imageEntity)
+                                     { return std::get<IMAGE_ENTITY_OFFSET::IMAGE_VMA_ALLOCATION>(imageEntity) == allocation; });
+        const auto textureId = _glbTextureIds.at(allocation);
+        _ctx.getMemoryManager().unregisterRelocation(allocation);
+        vkDestroyImageView(_ctx.getLogicDevice(), std::get<IMAGE_ENTITY_OFFSET::IMAGE_VIEW>(*it), nullptr);
+        vmaDestroyImage(vmaAllocator, std::get<IMAGE_ENTITY_OFFSET::IMAGE>(*it), allocation);
+        _glbImageEntities.erase(it);
+        _glbTextureIds.erase(allocation);
+
+        // -1: untextured, see indirectDraw.frag
+        const auto slot = _textureSlots[textureId];
+        for (uint32_t materialId = 0; materialId < _materials.size(); ++materialId)
+        {
+            if (_materials[materialId].basecolorTextureId == static_cast<int>(slot))
+            {
+                _materials[materialId].basecolorTextureId = -1;
+                _dirtyMaterials.push_back(materialId);
+            }
         }
+        _bindlessHeap->free(BINDLESS_SAMPLED_IMAGE, slot);
+        _textureSlots[textureId] = INVALID_BINDLESS_HANDLE;
+        log(Level::Warn, "evictTextures: texture ", textureId, ", ", size, " bytes");
+    }
+    return freed;
+}
+
+void VkApplication::updateMaterials(CommandBufferEntity &cmdBuffer)
+{
+    if (_dirtyMaterials.empty())
+    {
+        return;
+    }
+    ZoneScopedN("updateMaterials");
+    const auto cmdBufferHandle = std::get<COMMAND_BUFFER_ENTITY_OFFSET::COMMAND_BUFFER>(cmdBuffer);
+    const auto materialBuffer = std::get<BUFFER_ENTITY_UID::BUFFER>(_compositeMatB);
+
+    // the frames before read the materials from any stage, same queue: ordered by the barrier
+    const VkMemoryBarrier2 toTransfer{
+        .sType = VK_STRUCTURE_TYPE_MEMORY_BARRIER_2,
+        .srcStageMask = VK_PIPELINE_STAGE_2_ALL_COMMANDS_BIT,
+        .srcAccessMask = VK_ACCESS_2_NONE,
+        .dstStageMask = VK_PIPELINE_STAGE_2_TRANSFER_BIT,
+        .dstAccessMask = VK_ACCESS_2_TRANSFER_WRITE_BIT,
+    };
+    const VkDependencyInfo toTransferDependency{
+        .sType = VK_STRUCTURE_TYPE_DEPENDENCY_INFO,
+        .memoryBarrierCount = 1,
+        .pMemoryBarriers = &toTransfer,
+    };
+    vkCmdPipelineBarrier2(cmdBufferHandle, &toTransferDependency);
+
+    // a few materials per relocation: inline updates, no staging
+    for (const auto materialId : _dirtyMaterials)
+    {
+        vkCmdUpdateBuffer(cmdBufferHandle, materialBuffer, sizeof(Material) * materialId, sizeof(Material),
+                          &_materials[materialId]);
+    }
+
+    const VkMemoryBarrier2 toShaderRead{
+        .sType = VK_STRUCTURE_TYPE_MEMORY_BARRIER_2,
+        .srcStageMask = VK_PIPELINE_STAGE_2_TRANSFER_BIT,
+        .srcAccessMask = VK_ACCESS_2_TRANSFER_WRITE_BIT,
+        .dstStageMask = VK_PIPELINE_STAGE_2_ALL_COMMANDS_BIT,
+        .dstAccessMask = VK_ACCESS_2_SHADER_STORAGE_READ_BIT,
+    };
+    const VkDependencyInfo toShaderReadDependency{
+        .sType = VK_STRUCTURE_TYPE_DEPENDENCY_INFO,
+        .memoryBarrierCount = 1,
+        .pMemoryBarriers = &toShaderRead,
+    };
+    vkCmdPipelineBarrier2(cmdBufferHandle, &toShaderReadDependency);
+    _dirtyMaterials.clear();
+}
+
+void VkApplication::createStreamingGeometry()
+{
+    // only the vertices move: the indices, the draws and the bounds (culling) stay those of the glb
+    StreamingGeometry::Config config;
+    config.capacityInBytes = {_compositeVBSizeInByte, 0};
+    config.maxDraws = 0;
+    // a step rewrites every vertex, one aligned range per mesh
+    config.uploadBufferSizeInBytes = _compositeVBSizeInByte + 16 * _scene->meshes.size();
+    _streamingGeometry = std::make_unique<StreamingGeometry>(_ctx, config);
+    // the first step is in before the first frame: no frame draws the uninitialized slots
+    const bool published = simulationStep(0.0);
+    ASSERT(published, "the first simulation step has every upload buffer");
+    _simulationThread = std::jthread([this](std::stop_token stopToken)
+                                     { simulate(stopToken); });
+}
+
+bool VkApplication::simulationStep(double time)
+{
+    ZoneScopedN("simulation step");
+    auto *update = _streamingGeometry->beginUpdate();
+    if (!update)
+    {
+        // every upload buffer is queued or in flight: the render loop is behind, the step is dropped
+        return false;
+    }
+    VkDeviceSize dstOffset = 0;
+    for (const auto &mesh : _scene->meshes)
+    {
+        const VkDeviceSize sizeInBytes = sizeof(Vertex) * mesh.vertices.size();
+        auto *vertices = static_cast<Vertex *>(update->write(VERTEX_STREAM, dstOffset, sizeInBytes));
+        ASSERT(vertices, "the upload buffer holds every vertex of the scene");
+        // one wave length across the mesh, along x in mesh space
+        const auto extent = mesh.maxAABB - mesh.minAABB;
+        const float amplitude = _simulationConfig.amplitude * glm::length(extent);
+        const float waveNumber = glm::two_pi<float>() / (std::max)(extent.x, 1e-6f);
+        const float phase = glm::two_pi<float>() * static_cast<float>(time);
+        // straight into the mapped upload buffer, sequential writes
+        JobSystem::get().parallelFor("simulation step", 0, mesh.vertices.size(), SIMULATION_VERTICES_PER_JOB,
+                                     [&](size_t i)
+                                     {
+                                         auto vertex = mesh.vertices[i];
+                                         vertex.vy += amplitude * std::sin(waveNumber * (vertex.vx - mesh.minAABB.x) + phase);
+                                         vertices[i] = vertex;
+                                     });
+        dstOffset += sizeInBytes;
+    }
+    _streamingGeometry->endUpdate(update);
+    return true;
+}
+
+void VkApplication::simulate(std::stop_token stopToken)
+{
+    const auto start = std::chrono::steady_clock::now();
+    const auto period = std::chrono::duration_cast<std::chrono::steady_clock::duration>(
+        std::chrono::duration<double>(1.0 / _simulationConfig.rate));
+    auto next = start;
+    // a dropped step is counted in StreamingGeometry::Stats::updatesRejected
+    while (!stopToken.stop_requested())
+    {
+        next += period;
+        std::this_thread::sleep_until(next);
+        simulationStep(std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count());
     }
 }
 
@@ -1753,6 +1939,10 @@ void VkApplication::preloadGLB()
     _scene = reader.read(glbContent);
     _numMeshes = _scene->meshes.size();
     _numTextures = _scene->textures.size();
+    // the scene's texture ids stay contiguous in the heap
+    _textureSlotBase = _bindlessHeap->allocateRange(BINDLESS_SAMPLED_IMAGE, _numTextures);
+    _textureSlots.resize(_numTextures);
+    std::iota(_textureSlots.begin(), _textureSlots.end(), _textureSlotBase);
 }
 
 //
@@ -1790,8 +1980,8 @@ void VkApplication::loadGLB()
                 VK_BUFFER_USAGE_SHADER_DEVICE_ADDRESS_BIT |
                     VK_BUFFER_USAGE_TRANSFER_DST_BIT |
                     VK_BUFFER_USAGE_STORAGE_BUFFER_BIT |
-                    VK_BUFFER_USAGE_ACCELERATION_STRUCTURE_BUILD_INPUT_READ_ONLY_BIT_KHR // raytracing need
-            );
+                    VK_BUFFER_USAGE_ACCELERATION_STRUCTURE_BUILD_INPUT_READ_ONLY_BIT_KHR, // raytracing need
+                STATIC_GEOMETRY_MEMORY);
         }
 
         {
@@ -1806,8 +1996,8 @@ void VkApplication::loadGLB()
                     VK_BUFFER_USAGE_INDEX_BUFFER_BIT |
                     VK_BUFFER_USAGE_STORAGE_BUFFER_BIT |
                     VK_BUFFER_USAGE_INDIRECT_BUFFER_BIT |
-                    VK_BUFFER_USAGE_ACCELERATION_STRUCTURE_BUILD_INPUT_READ_ONLY_BIT_KHR // raytracing need);
-            );
+                    VK_BUFFER_USAGE_ACCELERATION_STRUCTURE_BUILD_INPUT_READ_ONLY_BIT_KHR, // raytracing need
+                STATIC_GEOMETRY_MEMORY);
         }
 
         // upload data to buffer
@@ -1821,52 +2011,60 @@ void VkApplication::loadGLB()
         indirectDrawParams.reserve(_scene->meshes.size());
         uint32_t deviceCompositeVertexBufferOffsetInBytes = 0u;
         uint32_t deviceCompositeIndicesBufferOffsetInBytes = 0u;
+        // fill the staging regions in parallel: sub-allocation from the staging ring (thread-safe) + memcpy
+        // the ring is host-coherent and persistently mapped, all the copies go in the one io submit
+        auto &stagingRing = _ctx.getStagingRing();
+        _stagingVbForMesh.resize(_scene->meshes.size());
+        _stagingIbForMesh.resize(_scene->meshes.size());
+        JobSystem::get().parallelFor("loadGLB::fillStagingBuffers", 0, _scene->meshes.size(), 1, [this, &stagingRing](size_t meshId)
+                                     {
+            const auto &mesh = _scene->meshes[meshId];
+            auto vertexByteSizeMesh = sizeof(Vertex) * mesh.vertices.size();
+            _stagingVbForMesh[meshId] = stagingRing.allocate(vertexByteSizeMesh);
+            memcpy(_stagingVbForMesh[meshId].mappedData,
+                   mesh.vertices.data(),
+                   vertexByteSizeMesh);
+
+            auto indicesByteSizeMesh = sizeof(uint32_t) * mesh.indices.size();
+            _stagingIbForMesh[meshId] = stagingRing.allocate(indicesByteSizeMesh);
+            memcpy(_stagingIbForMesh[meshId].mappedData,
+                   mesh.indices.data(),
+                   indicesByteSizeMesh); });
+
+        // a command buffer is recorded by one thread at a time
         size_t meshId = 0;
         for (const auto &mesh : _scene->meshes)
         {
             auto vertexByteSizeMesh = sizeof(Vertex) * mesh.vertices.size();
-            auto vertexBufferPtr = reinterpret_cast<const void *>(mesh.vertices.data());
-
-            _stagingVbForMesh.emplace_back(_ctx.createStagingBuffer(
-                "Staging Vertices Buffer Mesh " + std::to_string(meshId),
-                vertexByteSizeMesh));
-
-            _ctx.writeBuffer(
-                _stagingVbForMesh.back(),
+            _ctx.copyBuffer(
+                _stagingVbForMesh[meshId].buffer,
                 _compositeVB,
                 cmdBuffersForIO,
-                vertexBufferPtr,
                 vertexByteSizeMesh,
-                0,
+                _stagingVbForMesh[meshId].offset,
                 deviceCompositeVertexBufferOffsetInBytes);
 
             deviceCompositeVertexBufferOffsetInBytes += vertexByteSizeMesh;
 
             // copy ib from host to device
             auto indicesByteSizeMesh = sizeof(uint32_t) * mesh.indices.size();
-            auto indicesBufferPtr = reinterpret_cast<const void *>(mesh.indices.data());
-
-            _stagingIbForMesh.emplace_back(_ctx.createStagingBuffer(
-                "Staging Indices Buffer Mesh  " + std::to_string(meshId),
-                indicesByteSizeMesh));
-
-            _ctx.writeBuffer(
-                _stagingIbForMesh.back(),
+            _ctx.copyBuffer(
+                _stagingIbForMesh[meshId].buffer,
                 _compositeIB,
                 cmdBuffersForIO,
-                indicesBufferPtr,
                 indicesByteSizeMesh,
-                0,
+                _stagingIbForMesh[meshId].offset,
                 deviceCompositeIndicesBufferOffsetInBytes);
 
             deviceCompositeIndicesBufferOffsetInBytes += indicesByteSizeMesh;
             // reserve still needs push_back/emplace_back
+            // one draw per mesh, gl_InstanceIndex picks the transform of the instance
             indirectDrawParams.emplace_back(IndirectDrawForVulkan{
                 .indexCount = uint32_t(mesh.indices.size()),
-                .instanceCount = 1,
+                .instanceCount = _scene->indirectDraw[meshId].instanceCount,
                 .firstIndex = firstIndex,
                 .vertexOffset = static_cast<int>(vertexOffset),
-                .firstInstance = 0,
+                .firstInstance = _scene->indirectDraw[meshId].firstInstance,
                 .meshId = static_cast<uint32_t>(meshId),
                 .materialIndex = static_cast<uint32_t>(mesh.materialIdx),
             });
@@ -1946,9 +2144,25 @@ void VkApplication::loadGLB()
 
         // sampler
         _glbSamplerEntities.emplace_back(_ctx.createSampler("sampler0"));
+        _samplerSlotBase = _bindlessHeap->allocateRange(BINDLESS_SAMPLER, static_cast<uint32_t>(_glbSamplerEntities.size()));
+        for (uint32_t samplerId = 0; samplerId < _glbSamplerEntities.size(); ++samplerId)
+        {
+            _bindlessHeap->writeSampler(_samplerSlotBase + samplerId, std::get<0>(_glbSamplerEntities[samplerId]));
+        }
+
+        // the glb ids become heap slots
+        auto materials = _scene->materials;
+        for (auto &material : materials)
+        {
+            if (material.basecolorTextureId != -1)
+                material.basecolorTextureId += _textureSlotBase;
+            if (material.basecolorSamplerId != -1)
+                material.basecolorSamplerId += _samplerSlotBase;
+        }
+        _materials = materials;
 
         // packing materials into composite buffer
-        const auto materialByteSize = sizeof(Material) * _scene->materials.size();
+        const auto materialByteSize = sizeof(Material) * materials.size();
         {
             // create device buffer
             auto bufferByteSize = materialByteSize;
@@ -1958,21 +2172,50 @@ void VkApplication::loadGLB()
                 bufferByteSize,
                 VK_BUFFER_USAGE_SHADER_DEVICE_ADDRESS_BIT |
                     VK_BUFFER_USAGE_TRANSFER_DST_BIT |
-                    VK_BUFFER_USAGE_STORAGE_BUFFER_BIT);
+                    VK_BUFFER_USAGE_STORAGE_BUFFER_BIT,
+                STATIC_GEOMETRY_MEMORY);
         }
         {
             // create staging buffer
-            auto materialBufferPtr = reinterpret_cast<const void *>(_scene->materials.data());
+            auto materialBufferPtr = reinterpret_cast<const void *>(materials.data());
 
-            // staging buffer for matBuffer
-            _stagingMatBuffer = _ctx.createStagingBuffer("Staging Material Buffer", materialByteSize);
+            // staging region for matBuffer
+            _stagingMatBuffer = _ctx.getStagingRing().allocate(materialByteSize);
             _ctx.writeBuffer(
-                _stagingMatBuffer,
+                _stagingMatBuffer.buffer,
                 _compositeMatB,
                 cmdBuffersForIO,
                 materialBufferPtr,
                 materialByteSize,
-                0,
+                _stagingMatBuffer.offset,
+                0);
+        }
+
+        // packing instance transforms, grouped by mesh like the draws
+        std::vector<glm::mat4> instanceTransforms;
+        instanceTransforms.reserve(_scene->instances.size());
+        for (const auto &instance : _scene->instances)
+        {
+            instanceTransforms.emplace_back(instance.transform);
+        }
+        const auto instanceTransformByteSize = sizeof(glm::mat4) * instanceTransforms.size();
+        {
+            _instanceTransformBSizeInByte = instanceTransformByteSize;
+            _instanceTransformB = _ctx.createDeviceLocalBuffer(
+                "Device Instance Transform Buffer Combo",
+                instanceTransformByteSize,
+                VK_BUFFER_USAGE_SHADER_DEVICE_ADDRESS_BIT |
+                    VK_BUFFER_USAGE_TRANSFER_DST_BIT |
+                    VK_BUFFER_USAGE_STORAGE_BUFFER_BIT,
+                STATIC_GEOMETRY_MEMORY);
+            _stagingInstanceTransformBuffer = _ctx.getStagingRing().allocate(instanceTransformByteSize);
+            _ctx.writeBuffer(
+                _stagingInstanceTransformBuffer.buffer,
+                _instanceTransformB,
+                cmdBuffersForIO,
+                instanceTransforms.data(),
+                instanceTransformByteSize,
+                _stagingInstanceTransformBuffer.offset,
                 0);
         }
 
@@ -1993,16 +2236,16 @@ void VkApplication::loadGLB()
         {
             // create staging buffer
             auto indirectDrawBufferPtr = reinterpret_cast<const void *>(indirectDrawParams.data());
-            // staging buffer for indirectDrawBuffer
-            _stagingIndirectDrawBuffer = _ctx.createStagingBuffer("Staging Indirect Draw Buffer", indirectDrawBufferByteSize);
+            // staging region for indirectDrawBuffer
+            _stagingIndirectDrawBuffer = _ctx.getStagingRing().allocate(indirectDrawBufferByteSize);
 
             _ctx.writeBuffer(
-                _stagingIndirectDrawBuffer,
+                _stagingIndirectDrawBuffer.buffer,
                 _indirectDrawB,
                 cmdBuffersForIO,
                 indirectDrawBufferPtr,
                 indirectDrawBufferByteSize,
-                0,
+                _stagingIndirectDrawBuffer.offset,
                 0);
         }
     }
@@ -45,10 +45,28 @@
 #include <glb.h>
 #include <context.h>
 #include <queuethreadsafe.h>
+#include <queuelockfree.h>
+#include <stagingBudget.h>
+#include <stagingRing.h>
+#include <jobSystem.h>
+#include <coroutine.h>
+#include <gpuCompletion.h>
+#include <uploadScheduler.h>
+#include <memoryDefragmenter.h>
+#include <frameAllocator.h>
+#include <renderGraph.h>
+#include <parallelCommandRecorder.h>
+#include <bindlessHeap.h>
 #include <future> //packaged_task<>
+#include <thread> // jthread
+#include <stop_token>
+#include <chrono>
+#include <mutex>
 
 #include <cullFustrum.h>
 #include <rayTracing.h>
+#include <shaderHotReload.h>
+#include <streamingGeometry.h>
 
 #if defined(__ANDROID__)
 // functor for custom deleter for unique_ptr
@@ -70,6 +88,37 @@ struct AndroidNativeWindowDeleter
 #endif
 #endif
 
+// queues feeding the async io workers (texture upload, mipmap generation)
+// lock-free ring, a full ring blocks the producer
+using AsyncTaskQueue = QueueLockFree<std::packaged_task<void(void)>, 256>;
+// host-visible memory allowed for texture staging buffers queued or in flight
+// loadGLBTextureAsync blocks once it is exhausted
+static constexpr size_t STAGING_BUDGET_IN_BYTES = 256 * 1024 * 1024;
+// how often the fences/timeline semaphores awaited by the loading coroutines are checked
+static constexpr std::chrono::microseconds GPU_COMPLETION_POLLING_INTERVAL{200};
+// how often the pending uploads are recorded and submitted as one batch
+static constexpr std::chrono::microseconds UPLOAD_SCHEDULER_TICK_INTERVAL{1000};
+// vmaBuildStatsString json written at teardown
+static constexpr const char *VMA_STATS_PATH = "vma_stats.json";
+
+// --simulate: a cpu simulation thread streams the vertices of the scene, see StreamingGeometry
+struct SimulationConfig
+{
+    bool enabled{false};
+    // simulation steps per second, independent of the frame rate
+    float rate{60.0f};
+    // wave height, fraction of the diagonal of the mesh bounding box
+    float amplitude{0.01f};
+};
+
+// --rt: the progressive ray tracing pass runs after the main draw, its output image is not presented
+// off by default: renderdoc does not support the ray tracing extensions
+struct RayTracingConfig
+{
+    bool enabled{false};
+    RayTracing::Config pass;
+};
+
 class Window;
 class CameraBase;
 class VkContext;
@@ -80,7 +129,8 @@ class VkApplication
         UBO = 0,
         COMBO_VERT,
         COMBO_IDR,
-        TEX_SAMP,
+        // set 3: the bindless heap, its layout is owned by _bindlessHeap
+        BINDLESS,
         COMBO_MAT,
         OBJECT_DYNAMIC_UBO,
         DESC_LAYOUT_SEMANTIC_SIZE
@@ -91,8 +141,11 @@ public:
     VkApplication(
         VkContext &ctx,
         const CameraBase &camera,
-        const std::string &model)
-        : _ctx(ctx), _camera(camera), _model(model)
+        const std::string &model,
+        const SimulationConfig &simulationConfig = {},
+        const RayTracingConfig &rayTracingConfig = {})
+        : _ctx(ctx), _camera(camera), _model(model), _simulationConfig(simulationConfig),
+          _rayTracingConfig(rayTracingConfig)
     {
     }
     void init();
@@ -119,6 +172,8 @@ private:
     void bindResourceToDescriptorSets();
     void createShaderModules();
     void createGraphicsPipeline();
+    // shader hot-reload: rebuild graphics pipelines from the swapped shader modules
+    void reloadGraphicsPipeline();
     void createSwapChainFramebuffers();
     void createCommandPool();
     void createCommandBuffer();
@@ -127,6 +182,10 @@ private:
         VkCommandBuffer commandBuffer,
         uint32_t imageIndex);
     void createPerFrameSyncObjects();
+    // passes, the resources they touch, the barriers in between
+    void createRenderGraph();
+    // --rt: the ray tracing pass and the blit of its output into the swapchain image
+    void createRayTracingPasses();
 
     // app-specific
     void preHostDeviceIO();
@@ -136,12 +195,34 @@ private:
     // io reader
     void preloadGLB();
     void loadGLB();
-    void loadGLBTextureAsync();
+    TimelinePoint submitHostDeviceIO();
     void postHostDeviceIO();
+    // coroutines, see gpuCompletion.h and coroutine.h
+    Task<void> loadSceneAsync();
+    Task<void> uploadGeometryAsync();
+    Task<void> loadGLBTextureAsync();
+    Task<void> uploadTextureAsync(size_t textureId, std::stop_token cancelToken, size_t reservedBytes);
+    // cancel the pending texture uploads and release the textures of the scene
+    void unloadScene();
+    // lets the defragmenter move a texture of the scene, the descriptor follows it
+    MemoryRelocation textureRelocation(size_t textureId, VmaAllocation allocation);
+    // MemoryManager eviction handler: the largest textures of the heap go, their materials render untextured
+    // until the scene is loaded again
+    VkDeviceSize evictTextures(uint32_t heapIndex, VkDeviceSize bytesToFree);
+    // the materials whose texture slot moved, ahead of every pass reading the material buffer
+    void updateMaterials(CommandBufferEntity &cmdBuffer);
+
+    // simulation: streaming vertices and the thread producing them
+    void createStreamingGeometry();
+    // false: no free upload buffer, the step is dropped
+    bool simulationStep(double time);
+    void simulate(std::stop_token stopToken);
 
     VkContext &_ctx;
     const CameraBase &_camera;
     std::string _model;
+    const SimulationConfig _simulationConfig;
+    const RayTracingConfig _rayTracingConfig;
 
     // ownership of resource
     // std::vector<VkImageView> _swapChainImageViews;
@@ -161,16 +242,14 @@ private:
     VkDescriptorPool _descriptorSetPool{VK_NULL_HANDLE};
     std::unordered_map<VkDescriptorSetLayout *, std::vector<VkDescriptorSet>> _descriptorSets;
 
-    // uniforms at global granularity
-    std::vector<BufferEntity> _uniformBuffers;
-    // uniforms at object-granularity: combo dynamic ubo
-    BufferEntity _objectDynamicUniformBuffer;
-    // host buffer for dynamic ubo
-    glm::mat4 *_comboWorldTransformation;
+    // transient uniforms, one persistently mapped buffer per frame in flight
+    std::unique_ptr<FrameAllocator> _frameAllocator;
+    // uniforms at global granularity, this frame's sub-range
+    FrameAllocation _globalUniform;
+    // uniforms at object-granularity: dynamic ubo, this frame's sub-ranges
+    std::vector<FrameAllocation> _objectUniforms;
     // different object has different world transformation
     std::vector<glm::vec3> _rotations;
-    // combo ufo has alignment requirement
-    size_t _dynamicAlignment;
     // for push constant
 	std::vector<glm::mat4> _scales;
 
@@ -193,47 +272,96 @@ private:
 
     // glb scene
     std::shared_ptr<Scene> _scene;
-    // a lot of stageBuffers
-    std::vector<BufferEntity> _stagingVbForMesh;
-    std::vector<BufferEntity> _stagingIbForMesh;
-    BufferEntity _stagingIndirectDrawBuffer;
-    BufferEntity _stagingMatBuffer;
+    // regions of the staging ring, retired with the io submit
+    std::vector<StagingRegion> _stagingVbForMesh;
+    std::vector<StagingRegion> _stagingIbForMesh;
+    StagingRegion _stagingIndirectDrawBuffer;
+    StagingRegion _stagingMatBuffer;
+    StagingRegion _stagingInstanceTransformBuffer;
 
     // device buffer
     BufferEntity _compositeVB;
     BufferEntity _compositeIB;
     BufferEntity _compositeMatB;
     BufferEntity _indirectDrawB;
+    // one transform per instance of the scene
+    BufferEntity _instanceTransformB;
 
     // each buffer's size is needed when bindResourceToDescriptorSet
     uint32_t _compositeVBSizeInByte;
     uint32_t _compositeIBSizeInByte;
     uint32_t _compositeMatBSizeInByte;
     uint32_t _indirectDrawBSizeInByte;
+    uint32_t _instanceTransformBSizeInByte;
     // number of meshes in the scene
     uint32_t _numMeshes;
     uint32_t _numTextures;
+    // scene texture i is heap slot _textureSlotBase + i until it is relocated, same for the samplers
+    BindlessHandle _textureSlotBase{INVALID_BINDLESS_HANDLE};
+    BindlessHandle _samplerSlotBase{INVALID_BINDLESS_HANDLE};
+    // [textureId]: its current heap slot, a relocated texture moves to a new one
+    std::vector<BindlessHandle> _textureSlots;
+    // host copy of _compositeMatB (heap slots), render thread only
+    std::vector<Material> _materials;
+    // indices into _materials, rewritten by the next updateMaterials()
+    std::vector<uint32_t> _dirtyMaterials;
 
     // textures in the glb scene
     std::vector<ImageEntity> _glbImageEntities;
+    // image allocation -> textureId, vma keeps the handle across the defragmentation moves
+    std::unordered_map<VmaAllocation, size_t> _glbTextureIds;
+    // filled by the texture coroutines, from the job workers
+    std::mutex _glbImageEntitiesMutex;
     std::vector<BufferEntity> _glbImageStagingBuffers;
 
     // samplers in the glb scene
     std::vector<std::tuple<VkSampler>> _glbSamplerEntities;
 
     using uploadTextureFn = void(void);
-    QueueThreadSafe<std::packaged_task<uploadTextureFn>> _asyncTaskQueue;
-    std::vector<std::future<void>> _asyncUploadTextureTaskFutures;
-    std::future<void> _handleUploadTextureTaskFuture;
+    // io strand: uploadTextureAsync hops onto it with resumeOn
+    AsyncTaskQueue _asyncTaskQueue;
+
+    // resumes the coroutines suspended on fences
+    std::unique_ptr<VkCompletionSource> _gpuCompletionSource;
+    std::unique_ptr<GpuCompletionWatcher> _gpuWatcher;
+    // batches the texture copies, ownership transfers and mip chains of a tick
+    std::unique_ptr<UploadScheduler> _uploadScheduler;
+    // compacts the texture pools at the frame boundaries
+    std::unique_ptr<MemoryDefragmenter> _memoryDefragmenter;
+    // vmaSetCurrentFrameIndex
+    uint32_t _frameCount{0};
+    // texture uploads of the current scene, joined by unloadScene
+    AsyncScope _sceneLoadScope;
 
-    QueueThreadSafe<std::packaged_task<void(void)>> _asyncTaskQueueForGenMipmaps;
-    std::future<void> _handleTextureGenMipmapTaskFuture;
+    // staging memory reserved by loadGLBTextureAsync, released once the mipmap of the texture is done
+    StagingBudget _stagingBudget{STAGING_BUDGET_IN_BYTES};
+    // cancels the uploads of the current scene, renewed by unloadScene
+    std::stop_source _sceneUploadStopSource;
 
-    // a release and acquire pair is performed by a VkSemaphore
-    std::vector<VkSemaphore> _asyncTransferSemaphorePool;
+    // declared after everything the workers touch: destroyed (stop + join) first
+    std::jthread _uploadTextureWorker;
 
     // compare CullFustrum _cullFustrum, cannot compile due to ctor restriction
     // benifits of unique_ptr
     std::unique_ptr<CullFustrum> _cullFustrum;
+    // --rt only
     std::unique_ptr<RayTracing> _rt;
+
+    // the draws of the main pass, recorded on the job workers into secondaries
+    std::unique_ptr<ParallelCommandRecorder> _commandRecorder;
+    // textures and samplers of every pass, written as they complete, flushed once per frame
+    std::unique_ptr<BindlessHeap> _bindlessHeap;
+    // cull -> draw, recorded every frame by execute()
+    std::unique_ptr<RenderGraph> _renderGraph;
+    // re-pointed to the acquired image every frame
+    RenderGraphResource _swapChainImageResource{INVALID_RENDER_GRAPH_RESOURCE};
+    uint32_t _swapChainImageIndex{0};
+
+    // watches the glsl sources and includes, recompiles in the background
+    std::unique_ptr<ShaderHotReload> _shaderHotReload;
+
+    // --simulate: the vertices of COMBO_VERT, one slot per frame in flight
+    std::unique_ptr<StreamingGeometry> _streamingGeometry;
+    // declared after the streaming geometry it writes into: stopped first
+    std::jthread _simulationThread;
 };
\ No newline at end of file
@@ -11,11 +11,13 @@
 #include <iterator>
 #include <numeric>
 #include <array>
+#include <string>
+#include <fstream>
+#include <optional>
+#include <charconv>
+#include <string_view>
 #include <filesystem> // for shader
 
-#include <cuDevice.h>
-#include <cuPredefines.h>
-
 // To do it properly:
 
 // Include "vk_mem_alloc.h" file in each CPP file where you want to use the library. This includes declarations of all members of the library.
@@ -35,8 +37,8 @@
 // #include <camera.h>
 // #include <orbitCamera.h>
 #include <arcballCamera.h>
-
-using namespace cudaEngine;
+#include <cpuRayTracer.h>
+#include <queueBenchmark.h>
 
 bool gRunning = true;
 double gDt{0};
@@ -91,9 +93,214 @@ inline const std::set<std::string> &getInstanceExtensions()
     return instanceExtensions;
 }
 
+// no surface extension: lavapipe in ci, render farm machines without display
+inline const std::set<std::string> &getHeadlessInstanceExtensions()
+{
+    static std::set<std::string> instanceExtensions = {
+        "VK_KHR_get_physical_device_properties2",
+        "VK_KHR_external_memory_capabilities",
+        "VK_KHR_external_semaphore_capabilities",
+        "VK_KHR_external_fence_capabilities",
+        "VK_EXT_debug_utils",
+        "VK_EXT_validation_features",
+    };
+    return instanceExtensions;
+}
+
+// --headless --frames=N --capture=frame.ppm --cpu-rt
+struct BatchConfig
+{
+    bool headless{false};
+    // CpuRayTracer instead of vulkan: benchmarked over numFrames, no device at all
+    bool cpuRayTracing{false};
+    // headless: rendered then exit
+    uint64_t numFrames{300};
+    // the last frame, empty: none
+    std::string capturePath;
+};
+
+// --name=value: the value, std::nullopt and a warning when it is not a number (the default stays)
+template <typename T>
+std::optional<T> parseArgValue(const std::string &arg)
+{
+    const auto value = std::string_view(arg).substr(arg.find('=') + 1);
+    T res{};
+    const auto [end, ec] = std::from_chars(value.data(), value.data() + value.size(), res);
+    if (ec != std::errc() || end != value.data() + value.size())
+    {
+        log(Level::Warn, "ignoring ", arg, ": not a number, the default is kept");
+        return std::nullopt;
+    }
+    return res;
+}
+
+BatchConfig parseBatchConfig(int argc, char **argv)
+{
+    BatchConfig config;
+    for (int i = 1; i < argc; ++i)
+    {
+        const std::string arg = argv[i];
+        if (arg == "--headless")
+        {
+            config.headless = true;
+        }
+        else if (arg == "--cpu-rt")
+        {
+            config.cpuRayTracing = true;
+        }
+        else if (arg.starts_with("--frames="))
+        {
+            if (const auto numFrames = parseArgValue<uint64_t>(arg))
+            {
+                config.numFrames = (std::max)(*numFrames, uint64_t(1));
+            }
+        }
+        else if (arg.starts_with("--capture="))
+        {
+            config.capturePath = arg.substr(arg.find('=') + 1);
+        }
+    }
+    return config;
+}
+
+// bgra8 -> binary ppm
+void writePpm(const std::string &path, uint32_t width, uint32_t height, const uint8_t *data)
+{
+    std::ofstream file(path, std::ios::binary);
+    file << "P6\n"
+         << width << " " << height << "\n255\n";
+    for (size_t i = 0; i < static_cast<size_t>(width) * height * 4; i += 4)
+    {
+        const char rgb[3] = {static_cast<char>(data[i + 2]),
+                             static_cast<char>(data[i + 1]),
+                             static_cast<char>(data[i])};
+        file.write(rgb, sizeof(rgb));
+    }
+}
+
+void writeCapture(const std::string &path, const ReadbackPool::Frame &frame)
+{
+    ASSERT(frame.format == VK_FORMAT_B8G8R8A8_UNORM || frame.format == VK_FORMAT_B8G8R8A8_SRGB,
+           "capture: bgra8 only");
+    writePpm(path, frame.extent.width, frame.extent.height, frame.data);
+    log(Level::Info, "capture: frame ", frame.frameIndex, " written to ", path);
+}
+
+// same scene and camera as the vulkan path, rays/s on the cpu
+void runCpuRayTracing(const BatchConfig &batchConfig, const ArcballCamera &camera, const std::string &model,
+                      uint32_t width, uint32_t height)
+{
+    GltfBinaryIOReader reader;
+    const auto scene = reader.read(readFile(getAssetPath() + "\\" + model, true));
+    CpuRayTracer tracer(*scene, CpuRayTracer::Config{});
+
+    const UniformCameraProp cameraProp{
+        .viewInverse = glm::inverse(camera.viewTransformLH()),
+        .projInverse = glm::inverse(glm::perspective(glm::radians(camera.verticalFov()),
+                                                     static_cast<float>(width) / height,
+                                                     camera.nearPlaneD(),
+                                                     camera.farPlaneD())),
+    };
+    tracer.benchmark(cameraProp, width, height, static_cast<uint32_t>(batchConfig.numFrames));
+    if (!batchConfig.capturePath.empty())
+    {
+        std::vector<uint8_t> image(static_cast<size_t>(width) * height * 4);
+        tracer.trace(cameraProp, width, height, image.data());
+        writePpm(batchConfig.capturePath, width, height, image.data());
+        log(Level::Info, "capture: cpu ray traced image written to ", batchConfig.capturePath);
+    }
+}
+
+// --frames-in-flight=1..3 --present-mode=fifo|mailbox|immediate --pacing
+LatencyConfig parseLatencyConfig(int argc, char **argv)
+{
+    LatencyConfig config;
+    for (int i = 1; i < argc; ++i)
+    {
+        const std::string arg = argv[i];
+        if (arg.starts_with("--frames-in-flight="))
+        {
+            if (const auto framesInFlight = parseArgValue<int>(arg))
+            {
+                config.framesInFlight = std::clamp(*framesInFlight, 1, 3);
+            }
+        }
+        else if (arg == "--present-mode=mailbox")
+        {
+            config.presentMode = VK_PRESENT_MODE_MAILBOX_KHR;
+        }
+        else if (arg == "--present-mode=immediate")
+        {
+            config.presentMode = VK_PRESENT_MODE_IMMEDIATE_KHR;
+        }
+        else if (arg == "--present-mode=fifo")
+        {
+            config.presentMode = VK_PRESENT_MODE_FIFO_KHR;
+        }
+        else if (arg == "--pacing")
+        {
+            config.pacing = true;
+        }
+    }
+    return config;
+}
+
+// --simulate --simulation-rate=Hz
+SimulationConfig parseSimulationConfig(int argc, char **argv)
+{
+    SimulationConfig config;
+    for (int i = 1; i < argc; ++i)
+    {
+        const std::string arg = argv[i];
+        if (arg == "--simulate")
+        {
+            config.enabled = true;
+        }
+        else if (arg.starts_with("--simulation-rate="))
+        {
+            if (const auto rate = parseArgValue<float>(arg))
+            {
+                config.rate = (std::max)(*rate, 1.0f);
+            }
+        }
+    }
+    return config;
+}
+
+// --rt: the progressive ray traced image is presented (or captured) instead of the raster draw
+RayTracingConfig parseRayTracingConfig(int argc, char **argv)
+{
+    RayTracingConfig config;
+    for (int i = 1; i < argc; ++i)
+    {
+        const std::string arg = argv[i];
+        if (arg == "--rt")
+        {
+            config.enabled = true;
+        }
+    }
+    return config;
+}
+
 int main(int argc, char **argv)
 {
-    selectDevice();
+    // --queue-bench: QueueLockFree vs QueueThreadSafe, 1..32 producers and consumers, no window, no vulkan
+    for (int i = 1; i < argc; ++i)
+    {
+        if (std::string(argv[i]) == "--queue-bench")
+        {
+            const auto results = benchmarkQueues({1, 2, 4, 8, 16, 32}, 100000);
+            const bool valid = std::all_of(results.begin(), results.end(), [](const auto &result)
+                                           { return result.valid; });
+            return valid ? 0 : 1;
+        }
+    }
+
+    // the arguments first: vk1 has no cuda path, nothing is initialized before --headless or --cpu-rt is read
+    const auto latencyConfig = parseLatencyConfig(argc, argv);
+    const auto simulationConfig = parseSimulationConfig(argc, argv);
+    const auto rayTracingConfig = parseRayTracingConfig(argc, argv);
+    const auto batchConfig = parseBatchConfig(argc, argv);
 
     // BoxTextured.glb
     // Camera _camera{
@@ -202,8 +409,19 @@ int main(int argc, char **argv)
     //     -97.f                                                    // initial yaw
     // };
     WindowConfig cfg{1280, 720, "demo"};
+    // ahead of sdl, volk and glslang: the fallback is for the machines without any gpu
+    if (batchConfig.cpuRayTracing)
+    {
+        runCpuRayTracing(batchConfig, _orbitCamera, "BarramundiFish.glb", cfg.width, cfg.height);
+        return 0;
+    }
 
-    Window window(&cfg, _orbitCamera);
+    // headless: no sdl window at all
+    std::optional<WindowEntity> window;
+    if (!batchConfig.headless)
+    {
+        window.emplace(&cfg, _orbitCamera);
+    }
 
     VK_CHECK(volkInitialize());
     // c api
@@ -212,8 +430,8 @@ int main(int argc, char **argv)
 
     const std::vector<const char *> instanceValidationLayers = {
         "VK_LAYER_KHRONOS_validation"};
-    const auto &instanceExtensions = getInstanceExtensions();
-    const std::vector<const char *> deviceExtensions = {
+    const auto &instanceExtensions = batchConfig.headless ? getHeadlessInstanceExtensions() : getInstanceExtensions();
+    std::vector<const char *> deviceExtensions = {
         VK_KHR_SWAPCHAIN_EXTENSION_NAME,
         VK_KHR_SHADER_NON_SEMANTIC_INFO_EXTENSION_NAME,
         VK_KHR_DYNAMIC_RENDERING_EXTENSION_NAME,
@@ -238,19 +456,54 @@ int main(int argc, char **argv)
         VK_EXT_CALIBRATED_TIMESTAMPS_EXTENSION_NAME,
         VK_EXT_MEMORY_BUDGET_EXTENSION_NAME,
     };
+    if (rayTracingConfig.enabled)
+    {
+        // the ones commented out above: renderdoc crashes on them
+        deviceExtensions.push_back(VK_KHR_RAY_TRACING_PIPELINE_EXTENSION_NAME);
+        deviceExtensions.push_back(VK_KHR_ACCELERATION_STRUCTURE_EXTENSION_NAME);
+        deviceExtensions.push_back(VK_KHR_DEFERRED_HOST_OPERATIONS_EXTENSION_NAME);
+        deviceExtensions.push_back(VK_KHR_RAY_QUERY_EXTENSION_NAME);
+    }
+    if (latencyConfig.pacing)
+    {
+        // frame pacing on the display, gpu completion otherwise
+        deviceExtensions.push_back(VK_KHR_PRESENT_ID_EXTENSION_NAME);
+        deviceExtensions.push_back(VK_KHR_PRESENT_WAIT_EXTENSION_NAME);
+    }
 
-    VkContext ctx(window,
-                  instanceValidationLayers,
-                  instanceExtensions,
-                  deviceExtensions);
+    // headless: the unsupported device extensions are dropped by the context
+    auto ctx = batchConfig.headless
+                   ? VkContext(HeadlessConfig{cfg.width, cfg.height},
+                               instanceValidationLayers,
+                               instanceExtensions,
+                               deviceExtensions)
+                   : VkContext(*window,
+                               instanceValidationLayers,
+                               instanceExtensions,
+                               deviceExtensions);
+    ctx.setLatencyConfig(latencyConfig);
 
     VkApplication vkApp(
         ctx,
         _orbitCamera,
-        "BarramundiFish.glb");
+        "BarramundiFish.glb",
+        simulationConfig,
+        rayTracingConfig);
     vkApp.init();
+    if (ctx.isHeadless() && !batchConfig.capturePath.empty())
+    {
+        ctx.getReadbackPool().setCallback(
+            [&batchConfig](const ReadbackPool::Frame &frame)
+            {
+                if (frame.frameIndex + 1 == batchConfig.numFrames)
+                {
+                    writeCapture(batchConfig.capturePath, frame);
+                }
+            });
+    }
 
     // init();
+    uint64_t numFramesRendered{0};
     gLastFrame = SDL_GetPerformanceCounter();
     // gLastFrame = SDL_GetTicks();
     while (gRunning)
@@ -262,12 +515,35 @@ int main(int argc, char **argv)
         gDt = static_cast<double>(
             (currTime - gLastFrame) / static_cast<double>(SDL_GetPerformanceFrequency()));
         gLastFrame = currTime;
-        window.pollEvents();
+        // paced before the input is sampled
+        ctx.getFramePacer().beginFrame();
+        if (window)
+        {
+            window->pollEvents();
+        }
         vkApp.renderPerFrame();
+        if (batchConfig.headless && ++numFramesRendered == batchConfig.numFrames)
+        {
+            gRunning = false;
+        }
+    }
+    if (ctx.isHeadless())
+    {
+        // the frames still in flight
+        ctx.getReadbackPool().collect(true);
+        log(Level::Info, "headless: ", ctx.getReadbackPool().framesRead(), " frame(s) read back");
     }
 
+    {
+        const auto &latencyStats = ctx.getFramePacer().stats();
+        log(Level::Info, "FramePacer: ", latencyStats.framesPresented, " frames, input to present avg ",
+            latencyStats.averageLatencyMs, " ms, max ", latencyStats.maxLatencyMs, " ms");
+    }
     vkApp.teardown();
-    window.shutdown();
+    if (window)
+    {
+        window->shutdown();
+    }
     // glslang_finalize_process();
     glslang::FinalizeProcess();
     return 0;
@@ -41,6 +41,7 @@
 #include <fstream>
 #include <algorithm>
 #include <set>
+#include <map>
 
 #include <glslang/Public/ShaderLang.h>
 
@@ -90,6 +91,13 @@ public:
         return includedFiles;
     }
 
+    // includer -> headers it pulls in, as resolved by readLocalPath.
+    // the root shader shows up under the name passed to TShader (or "" if none).
+    virtual std::map<std::string, std::set<std::string>> getIncludeGraph()
+    {
+        return includeGraph;
+    }
+
     virtual ~DirStackFileIncluder() override { }
 
 protected:
@@ -97,6 +105,7 @@ protected:
     std::vector<std::string> directoryStack;
     int externalLocalDirectoryCount;
     std::set<std::string> includedFiles;
+    std::map<std::string, std::set<std::string>> includeGraph;
 
     // Search for a valid "local" path based on combining the stack of include
     // directories and the nominal name of the header.
@@ -116,6 +125,7 @@ protected:
             if (file) {
                 directoryStack.push_back(getDirectory(path));
                 includedFiles.insert(path);
+                includeGraph[includerName ? includerName : ""].insert(path);
                 return newIncludeResult(path, file, (int)file.tellg());
             }
         }
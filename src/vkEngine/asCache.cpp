@@ -0,0 +1,334 @@
+#include <chrono>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <format>
+
+#include <tracy/Tracy.hpp>
+
+#include <asCache.h>
+#include <blasBuilder.h>
+
+// "BLAS"
+static constexpr uint32_t CACHE_MAGIC = 0x53414c42;
+// bump when the file layout or the key changes
+static constexpr uint32_t CACHE_VERSION = 1;
+// the src/dst address of a (de)serialization
+static constexpr VkDeviceSize SERIALIZATION_ALIGNMENT = 256;
+
+struct CacheFileHeader
+{
+    uint32_t magic;
+    uint32_t version;
+    uint64_t key;
+    uint64_t sizeInBytes;
+};
+
+// serialized AS layout: driverUUID, compatibilityUUID, serialized size, deserialized size, handle count
+static constexpr size_t DESERIALIZED_SIZE_OFFSET = 2 * VK_UUID_SIZE + sizeof(uint64_t);
+static constexpr size_t SERIALIZED_HEADER_SIZE = 2 * VK_UUID_SIZE + 3 * sizeof(uint64_t);
+
+static void fnv1a(uint64_t &hash, const void *data, size_t sizeInBytes)
+{
+    const auto *bytes = static_cast<const uint8_t *>(data);
+    for (size_t i = 0; i < sizeInBytes; ++i)
+    {
+        hash ^= bytes[i];
+        hash *= 0x100000001b3ull;
+    }
+}
+
+AccelerationStructureCache::AccelerationStructureCache(VkContext &ctx, const Config &config)
+    : _ctx(ctx), _config(config)
+{
+    std::error_code ec;
+    std::filesystem::create_directories(_config.directory, ec);
+    if (ec)
+    {
+        log(Level::Warn, "AccelerationStructureCache: cannot create ", _config.directory, ": ", ec.message());
+    }
+}
+
+uint64_t AccelerationStructureCache::hashGeometry(const Mesh &mesh, VkBuildAccelerationStructureFlagsKHR flags)
+{
+    uint64_t hash = 0xcbf29ce484222325ull;
+    fnv1a(hash, &CACHE_VERSION, sizeof(CACHE_VERSION));
+    fnv1a(hash, &flags, sizeof(flags));
+    // the build reads the positions only
+    for (const auto &vertex : mesh.vertices)
+    {
+        const float position[3] = {vertex.vx, vertex.vy, vertex.vz};
+        fnv1a(hash, position, sizeof(position));
+    }
+    fnv1a(hash, mesh.indices.data(), mesh.indices.size() * sizeof(uint32_t));
+    return hash;
+}
+
+std::string AccelerationStructureCache::entryPath(uint64_t key) const
+{
+    return (std::filesystem::path(_config.directory) / std::format("{:016x}.blas", key)).string();
+}
+
+std::optional<std::vector<char>> AccelerationStructureCache::readEntry(uint64_t key) const
+{
+    std::ifstream file(entryPath(key), std::ios::binary);
+    if (!file.is_open())
+    {
+        return std::nullopt;
+    }
+    CacheFileHeader header{};
+    file.read(reinterpret_cast<char *>(&header), sizeof(header));
+    if (!file || header.magic != CACHE_MAGIC || header.version != CACHE_VERSION || header.key != key ||
+        header.sizeInBytes < SERIALIZED_HEADER_SIZE)
+    {
+        return std::nullopt;
+    }
+    std::vector<char> data(header.sizeInBytes);
+    file.read(data.data(), data.size());
+    if (!file)
+    {
+        return std::nullopt;
+    }
+    return data;
+}
+
+bool AccelerationStructureCache::isCompatible(const std::vector<char> &data) const
+{
+    const VkAccelerationStructureVersionInfoKHR versionInfo{
+        .sType = VK_STRUCTURE_TYPE_ACCELERATION_STRUCTURE_VERSION_INFO_KHR,
+        .pVersionData = reinterpret_cast<const uint8_t *>(data.data()),
+    };
+    VkAccelerationStructureCompatibilityKHR compatibility{VK_ACCELERATION_STRUCTURE_COMPATIBILITY_INCOMPATIBLE_KHR};
+    vkGetDeviceAccelerationStructureCompatibilityKHR(_ctx.getLogicDevice(), &versionInfo, &compatibility);
+    return compatibility == VK_ACCELERATION_STRUCTURE_COMPATIBILITY_COMPATIBLE_KHR;
+}
+
+BufferEntity AccelerationStructureCache::createStagingBuffer(const std::string &name, VkDeviceSize sizeInBytes) const
+{
+    // the (de)serialization copies address the buffer by device address
+    return _ctx.createPersistentBuffer(
+        name,
+        sizeInBytes + SERIALIZATION_ALIGNMENT,
+        VK_BUFFER_USAGE_ACCELERATION_STRUCTURE_BUILD_INPUT_READ_ONLY_BIT_KHR |
+            VK_BUFFER_USAGE_STORAGE_BUFFER_BIT | VK_BUFFER_USAGE_SHADER_DEVICE_ADDRESS_BIT,
+        VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT,
+        VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT | VK_MEMORY_PROPERTY_HOST_CACHED_BIT,
+        true);
+}
+
+void AccelerationStructureCache::destroyStagingBuffer(const BufferEntity &buffer) const
+{
+    const auto vmaAllocator = _ctx.getVmaAllocator();
+    vmaUnmapMemory(vmaAllocator, std::get<BUFFER_ENTITY_UID::VMA_ALLOCATION>(buffer));
+    vmaDestroyBuffer(vmaAllocator,
+                     std::get<BUFFER_ENTITY_UID::BUFFER>(buffer),
+                     std::get<BUFFER_ENTITY_UID::VMA_ALLOCATION>(buffer));
+}
+
+void AccelerationStructureCache::submitAndWait(CommandBufferEntity &cmdBuffer) const
+{
+    const auto point = _ctx.submitCommandBuffer(cmdBuffer);
+    waitTimelinePoints(_ctx.getLogicDevice(), {point});
+}
+
+std::vector<std::optional<ASEntity>> AccelerationStructureCache::load(const std::vector<uint64_t> &keys)
+{
+    ZoneScopedN("AccelerationStructureCache: load");
+    const auto start = std::chrono::steady_clock::now();
+    std::vector<std::optional<ASEntity>> table(keys.size());
+
+    // 1. read and validate, offsets of the hits in one staging buffer
+    std::vector<std::vector<char>> entries(keys.size());
+    std::vector<VkDeviceSize> offsets(keys.size());
+    VkDeviceSize stagingSize = 0;
+    for (size_t i = 0; i < keys.size(); ++i)
+    {
+        auto entry = readEntry(keys[i]);
+        if (!entry)
+        {
+            ++_stats.numMisses;
+            continue;
+        }
+        if (!isCompatible(*entry))
+        {
+            std::error_code ec;
+            std::filesystem::remove(entryPath(keys[i]), ec);
+            ++_stats.numMisses;
+            ++_stats.numIncompatible;
+            continue;
+        }
+        offsets[i] = stagingSize;
+        stagingSize = alignedSize(stagingSize + entry->size(), SERIALIZATION_ALIGNMENT);
+        entries[i] = std::move(*entry);
+    }
+
+    if (stagingSize > 0)
+    {
+        // 2. upload, then deserialize every hit in one command buffer
+        const auto stagingBuffer = createStagingBuffer("AS cache: load", stagingSize);
+        const auto stagingAddress = alignedSize(std::get<BUFFER_ENTITY_UID::DEVICE_HOST_ADDRESS>(stagingBuffer).deviceAddress,
+                                                SERIALIZATION_ALIGNMENT);
+        auto *mapped = static_cast<uint8_t *>(std::get<BUFFER_ENTITY_UID::MAPPING_ADDRESS>(stagingBuffer)) +
+                       (stagingAddress - std::get<BUFFER_ENTITY_UID::DEVICE_HOST_ADDRESS>(stagingBuffer).deviceAddress);
+
+        auto cmdBuffer = _ctx.getCommandBufferForIO();
+        const auto cmd = std::get<COMMAND_BUFFER_ENTITY_OFFSET::COMMAND_BUFFER>(cmdBuffer);
+        _ctx.BeginRecordCommandBuffer(cmdBuffer);
+        for (size_t i = 0; i < keys.size(); ++i)
+        {
+            const auto &entry = entries[i];
+            if (entry.empty())
+            {
+                continue;
+            }
+            std::memcpy(mapped + offsets[i], entry.data(), entry.size());
+            uint64_t deserializedSize = 0;
+            std::memcpy(&deserializedSize, entry.data() + DESERIALIZED_SIZE_OFFSET, sizeof(deserializedSize));
+            table[i] = BlasBuilder::create(_ctx, std::format("BLAS cached: {:016x}", keys[i]), deserializedSize);
+            const VkCopyMemoryToAccelerationStructureInfoKHR copyInfo{
+                .sType = VK_STRUCTURE_TYPE_COPY_MEMORY_TO_ACCELERATION_STRUCTURE_INFO_KHR,
+                .src = {.deviceAddress = stagingAddress + offsets[i]},
+                .dst = std::get<AS_ENTITY_UID::AS>(*table[i]),
+                .mode = VK_COPY_ACCELERATION_STRUCTURE_MODE_DESERIALIZE_KHR,
+            };
+            vkCmdCopyMemoryToAccelerationStructureKHR(cmd, &copyInfo);
+            ++_stats.numHits;
+            _stats.bytesRead += entry.size();
+        }
+        _ctx.EndRecordCommandBuffer(cmdBuffer);
+        // host writes before the submit are visible to it
+        submitAndWait(cmdBuffer);
+        destroyStagingBuffer(stagingBuffer);
+    }
+
+    _stats.loadMs += std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+    log(Level::Info, "AccelerationStructureCache: ", _stats.numHits, " hit(s), ", _stats.numMisses, " miss(es) (",
+        _stats.numIncompatible, " incompatible), ", _stats.bytesRead, " bytes in ", _stats.loadMs, " ms");
+    return table;
+}
+
+void AccelerationStructureCache::store(const std::vector<uint64_t> &keys, const std::vector<ASEntity> &table)
+{
+    ZoneScopedN("AccelerationStructureCache: store");
+    ASSERT(keys.size() == table.size(), "AccelerationStructureCache: one key per BLAS");
+    if (table.empty())
+    {
+        return;
+    }
+    const auto start = std::chrono::steady_clock::now();
+    const auto logicalDevice = _ctx.getLogicDevice();
+    const auto numAs = static_cast<uint32_t>(table.size());
+    std::vector<VkAccelerationStructureKHR> handles;
+    handles.reserve(numAs);
+    for (const auto &as : table)
+    {
+        handles.push_back(std::get<AS_ENTITY_UID::AS>(as));
+    }
+
+    // 1. serialized sizes
+    const VkQueryPoolCreateInfo queryPoolInfo{
+        .sType = VK_STRUCTURE_TYPE_QUERY_POOL_CREATE_INFO,
+        .queryType = VK_QUERY_TYPE_ACCELERATION_STRUCTURE_SERIALIZATION_SIZE_KHR,
+        .queryCount = numAs,
+    };
+    VkQueryPool queryPool{VK_NULL_HANDLE};
+    VK_CHECK(vkCreateQueryPool(logicalDevice, &queryPoolInfo, nullptr, &queryPool));
+    {
+        auto cmdBuffer = _ctx.getCommandBufferForIO();
+        const auto cmd = std::get<COMMAND_BUFFER_ENTITY_OFFSET::COMMAND_BUFFER>(cmdBuffer);
+        _ctx.BeginRecordCommandBuffer(cmdBuffer);
+        vkCmdResetQueryPool(cmd, queryPool, 0, numAs);
+        vkCmdWriteAccelerationStructuresPropertiesKHR(cmd, numAs, handles.data(),
+                                                      VK_QUERY_TYPE_ACCELERATION_STRUCTURE_SERIALIZATION_SIZE_KHR,
+                                                      queryPool, 0);
+        _ctx.EndRecordCommandBuffer(cmdBuffer);
+        submitAndWait(cmdBuffer);
+    }
+    std::vector<VkDeviceSize> serializedSizes(numAs);
+    VK_CHECK(vkGetQueryPoolResults(logicalDevice, queryPool, 0, numAs,
+                                   serializedSizes.size() * sizeof(VkDeviceSize), serializedSizes.data(),
+                                   sizeof(VkDeviceSize), VK_QUERY_RESULT_64_BIT | VK_QUERY_RESULT_WAIT_BIT));
+    vkDestroyQueryPool(logicalDevice, queryPool, nullptr);
+
+    std::vector<VkDeviceSize> offsets(numAs);
+    VkDeviceSize stagingSize = 0;
+    for (uint32_t i = 0; i < numAs; ++i)
+    {
+        offsets[i] = stagingSize;
+        stagingSize = alignedSize(stagingSize + serializedSizes[i], SERIALIZATION_ALIGNMENT);
+    }
+
+    // 2. serialize every BLAS into one readback buffer
+    const auto stagingBuffer = createStagingBuffer("AS cache: store", stagingSize);
+    const auto stagingAddress = alignedSize(std::get<BUFFER_ENTITY_UID::DEVICE_HOST_ADDRESS>(stagingBuffer).deviceAddress,
+                                            SERIALIZATION_ALIGNMENT);
+    const auto *mapped = static_cast<const uint8_t *>(std::get<BUFFER_ENTITY_UID::MAPPING_ADDRESS>(stagingBuffer)) +
+                         (stagingAddress - std::get<BUFFER_ENTITY_UID::DEVICE_HOST_ADDRESS>(stagingBuffer).deviceAddress);
+    {
+        auto cmdBuffer = _ctx.getCommandBufferForIO();
+        const auto cmd = std::get<COMMAND_BUFFER_ENTITY_OFFSET::COMMAND_BUFFER>(cmdBuffer);
+        _ctx.BeginRecordCommandBuffer(cmdBuffer);
+        for (uint32_t i = 0; i < numAs; ++i)
+        {
+            const VkCopyAccelerationStructureToMemoryInfoKHR copyInfo{
+                .sType = VK_STRUCTURE_TYPE_COPY_ACCELERATION_STRUCTURE_TO_MEMORY_INFO_KHR,
+                .src = handles[i],
+                .dst = {.deviceAddress = stagingAddress + offsets[i]},
+                .mode = VK_COPY_ACCELERATION_STRUCTURE_MODE_SERIALIZE_KHR,
+            };
+            vkCmdCopyAccelerationStructureToMemoryKHR(cmd, &copyInfo);
+        }
+        // the serialized data is read by the host
+        const VkMemoryBarrier2 hostBarrier{
+            .sType = VK_STRUCTURE_TYPE_MEMORY_BARRIER_2,
+            .srcStageMask = VK_PIPELINE_STAGE_2_ACCELERATION_STRUCTURE_BUILD_BIT_KHR,
+            .srcAccessMask = VK_ACCESS_2_TRANSFER_WRITE_BIT,
+            .dstStageMask = VK_PIPELINE_STAGE_2_HOST_BIT,
+            .dstAccessMask = VK_ACCESS_2_HOST_READ_BIT,
+        };
+        const VkDependencyInfo dependency{
+            .sType = VK_STRUCTURE_TYPE_DEPENDENCY_INFO,
+            .memoryBarrierCount = 1,
+            .pMemoryBarriers = &hostBarrier,
+        };
+        vkCmdPipelineBarrier2(cmd, &dependency);
+        _ctx.EndRecordCommandBuffer(cmdBuffer);
+        submitAndWait(cmdBuffer);
+    }
+
+    // 3. one file per BLAS, written next to the entry then renamed: a crash leaves no truncated entry behind
+    for (uint32_t i = 0; i < numAs; ++i)
+    {
+        const auto path = entryPath(keys[i]);
+        const auto tmpPath = path + ".tmp";
+        {
+            std::ofstream file(tmpPath, std::ios::binary | std::ios::trunc);
+            if (!file.is_open())
+            {
+                log(Level::Warn, "AccelerationStructureCache: cannot write ", tmpPath);
+                continue;
+            }
+            const CacheFileHeader header{
+                .magic = CACHE_MAGIC,
+                .version = CACHE_VERSION,
+                .key = keys[i],
+                .sizeInBytes = serializedSizes[i],
+            };
+            file.write(reinterpret_cast<const char *>(&header), sizeof(header));
+            file.write(reinterpret_cast<const char *>(mapped + offsets[i]), serializedSizes[i]);
+        }
+        std::error_code ec;
+        std::filesystem::rename(tmpPath, path, ec);
+        if (ec)
+        {
+            log(Level::Warn, "AccelerationStructureCache: cannot write ", path, ": ", ec.message());
+            continue;
+        }
+        _stats.bytesWritten += serializedSizes[i];
+    }
+    destroyStagingBuffer(stagingBuffer);
+
+    _stats.storeMs += std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+    log(Level::Info, "AccelerationStructureCache: ", numAs, " BLAS stored, ", _stats.bytesWritten, " bytes in ",
+        _stats.storeMs, " ms");
+}
@@ -0,0 +1,72 @@
+#pragma once
+
+#include <vector>
+#include <string>
+#include <cstdint>
+#include <optional>
+
+#include <context.h>
+#include <scene.h>
+
+// on-disk cache of serialized BLAS, one file per geometry: <directory>/<key>.blas
+// 1. the key hashes what the build reads (positions, indices) and the build flags: a mesh edit or a flag change
+//    is a miss, not a stale hit
+// 2. store(): vkCmdCopyAccelerationStructureToMemoryKHR (SERIALIZE) of the freshly built (compacted) BLAS
+// 3. load(): every entry is checked with vkGetDeviceAccelerationStructureCompatibilityKHR against its
+//    VkAccelerationStructureVersionInfoKHR header (driver uuid + compatibility uuid). incompatible entries
+//    (driver update, other gpu) are deleted and reported as misses, the caller rebuilds them.
+//    the compatible ones are deserialized (vkCmdCopyMemoryToAccelerationStructureKHR) in one submit
+// blocking, IO command buffer, render thread only
+class AccelerationStructureCache
+{
+public:
+    struct Config
+    {
+        std::string directory{"asCache"};
+    };
+
+    struct Stats
+    {
+        uint32_t numHits{0};
+        uint32_t numMisses{0};
+        // subset of the misses: found on disk but rejected by the driver
+        uint32_t numIncompatible{0};
+        uint64_t bytesRead{0};
+        uint64_t bytesWritten{0};
+        double loadMs{0.0};
+        double storeMs{0.0};
+    };
+
+    AccelerationStructureCache() = delete;
+    AccelerationStructureCache(VkContext &ctx, const Config &config);
+
+    AccelerationStructureCache(const AccelerationStructureCache &other) = delete;
+    AccelerationStructureCache &operator=(const AccelerationStructureCache &other) = delete;
+
+    // stable across runs and platforms (fnv-1a)
+    static uint64_t hashGeometry(const Mesh &mesh, VkBuildAccelerationStructureFlagsKHR flags);
+
+    // indexed like keys, nullopt: miss
+    std::vector<std::optional<ASEntity>> load(const std::vector<uint64_t> &keys);
+    // table indexed like keys, the BLAS must be built (and waited on)
+    void store(const std::vector<uint64_t> &keys, const std::vector<ASEntity> &table);
+
+    const Stats &stats() const
+    {
+        return _stats;
+    }
+
+private:
+    std::string entryPath(uint64_t key) const;
+    // header checked, nullopt: missing or corrupted
+    std::optional<std::vector<char>> readEntry(uint64_t key) const;
+    bool isCompatible(const std::vector<char> &data) const;
+    // host visible, coherent, mapped
+    BufferEntity createStagingBuffer(const std::string &name, VkDeviceSize sizeInBytes) const;
+    void destroyStagingBuffer(const BufferEntity &buffer) const;
+    void submitAndWait(CommandBufferEntity &cmdBuffer) const;
+
+    VkContext &_ctx;
+    const Config _config;
+    Stats _stats;
+};
@@ -0,0 +1,453 @@
+#include <algorithm>
+
+#include <tracy/Tracy.hpp>
+
+#include <bindlessHeap.h>
+
+static constexpr std::array<VkDescriptorType, BINDLESS_TYPE_SIZE> BINDLESS_DESCRIPTOR_TYPES{
+    VK_DESCRIPTOR_TYPE_SAMPLED_IMAGE,
+    VK_DESCRIPTOR_TYPE_SAMPLER,
+    VK_DESCRIPTOR_TYPE_STORAGE_BUFFER,
+    VK_DESCRIPTOR_TYPE_STORAGE_IMAGE,
+};
+
+BindlessHeap::BindlessHeap(VkContext &ctx, uint32_t numFramesInFlight, const Config &config)
+    : _ctx(ctx), _useDescriptorBuffer(config.preferDescriptorBuffer && ctx.isDescriptorBufferSupported())
+{
+    ASSERT(numFramesInFlight > 0, "BindlessHeap needs at least one frame");
+    const auto logicalDevice = _ctx.getLogicDevice();
+    const auto physicalDevice = _ctx.getSelectedPhysicalDevice();
+
+    VkPhysicalDeviceDescriptorBufferPropertiesEXT descriptorBufferProps{
+        .sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_DESCRIPTOR_BUFFER_PROPERTIES_EXT,
+    };
+    VkPhysicalDeviceVulkan12Properties vk12Props{
+        .sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_VULKAN_1_2_PROPERTIES,
+        .pNext = _useDescriptorBuffer ? &descriptorBufferProps : nullptr,
+    };
+    VkPhysicalDeviceProperties2 props2{
+        .sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_PROPERTIES_2,
+        .pNext = &vk12Props,
+    };
+    vkGetPhysicalDeviceProperties2(physicalDevice, &props2);
+
+    // update-after-bind has its own (larger) limits, the descriptor buffer the regular ones
+    const auto &limits = props2.properties.limits;
+    const std::array<uint32_t, BINDLESS_TYPE_SIZE> deviceLimits = _useDescriptorBuffer
+                                                                      ? std::array<uint32_t, BINDLESS_TYPE_SIZE>{
+                                                                            limits.maxPerStageDescriptorSampledImages,
+                                                                            limits.maxPerStageDescriptorSamplers,
+                                                                            limits.maxPerStageDescriptorStorageBuffers,
+                                                                            limits.maxPerStageDescriptorStorageImages,
+                                                                        }
+                                                                      : std::array<uint32_t, BINDLESS_TYPE_SIZE>{
+                                                                            vk12Props.maxPerStageDescriptorUpdateAfterBindSampledImages,
+                                                                            vk12Props.maxPerStageDescriptorUpdateAfterBindSamplers,
+                                                                            vk12Props.maxPerStageDescriptorUpdateAfterBindStorageBuffers,
+                                                                            vk12Props.maxPerStageDescriptorUpdateAfterBindStorageImages,
+                                                                        };
+
+    std::array<VkDescriptorSetLayoutBinding, BINDLESS_TYPE_SIZE> bindings;
+    std::array<VkDescriptorBindingFlags, BINDLESS_TYPE_SIZE> bindingFlags;
+    for (int type = 0; type < BINDLESS_TYPE_SIZE; ++type)
+    {
+        auto &slots = _slots[type];
+        slots.capacity = (std::max)((std::min)(config.capacity[type], deviceLimits[type]), 1u);
+        if (slots.capacity < config.capacity[type])
+        {
+            log(Level::Warn, "BindlessHeap: binding ", type, " clamped to ", slots.capacity, " descriptors");
+        }
+        slots.retired.resize(numFramesInFlight);
+        bindings[type] = VkDescriptorSetLayoutBinding{
+            .binding = static_cast<uint32_t>(type),
+            .descriptorType = BINDLESS_DESCRIPTOR_TYPES[type],
+            .descriptorCount = slots.capacity,
+            .stageFlags = VK_SHADER_STAGE_ALL,
+        };
+        // descriptor buffer: the memory is host written, no update-after-bind/pending rules to opt into
+        bindingFlags[type] = _useDescriptorBuffer
+                                 ? VK_DESCRIPTOR_BINDING_PARTIALLY_BOUND_BIT
+                                 : VK_DESCRIPTOR_BINDING_PARTIALLY_BOUND_BIT |
+                                       VK_DESCRIPTOR_BINDING_UPDATE_AFTER_BIND_BIT |
+                                       VK_DESCRIPTOR_BINDING_UPDATE_UNUSED_WHILE_PENDING_BIT;
+    }
+
+    const VkDescriptorSetLayoutBindingFlagsCreateInfo bindingFlagsInfo{
+        .sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_LAYOUT_BINDING_FLAGS_CREATE_INFO,
+        .bindingCount = static_cast<uint32_t>(bindingFlags.size()),
+        .pBindingFlags = bindingFlags.data(),
+    };
+    const VkDescriptorSetLayoutCreateInfo layoutInfo{
+        .sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_LAYOUT_CREATE_INFO,
+        .pNext = &bindingFlagsInfo,
+        .flags = _useDescriptorBuffer ? VK_DESCRIPTOR_SET_LAYOUT_CREATE_DESCRIPTOR_BUFFER_BIT_EXT
+                                      : VK_DESCRIPTOR_SET_LAYOUT_CREATE_UPDATE_AFTER_BIND_POOL_BIT,
+        .bindingCount = static_cast<uint32_t>(bindings.size()),
+        .pBindings = bindings.data(),
+    };
+    VK_CHECK(vkCreateDescriptorSetLayout(logicalDevice, &layoutInfo, nullptr, &_layout));
+    setCorrlationId(_layout, logicalDevice, VK_OBJECT_TYPE_DESCRIPTOR_SET_LAYOUT, "Bindless heap layout");
+
+    if (_useDescriptorBuffer)
+    {
+        VkDeviceSize layoutSize{0};
+        vkGetDescriptorSetLayoutSizeEXT(logicalDevice, _layout, &layoutSize);
+        for (int type = 0; type < BINDLESS_TYPE_SIZE; ++type)
+        {
+            vkGetDescriptorSetLayoutBindingOffsetEXT(logicalDevice, _layout, static_cast<uint32_t>(type), &_bindingOffsets[type]);
+        }
+        _descriptorSizes = {
+            descriptorBufferProps.sampledImageDescriptorSize,
+            descriptorBufferProps.samplerDescriptorSize,
+            descriptorBufferProps.storageBufferDescriptorSize,
+            descriptorBufferProps.storageImageDescriptorSize,
+        };
+
+        const VkBufferUsageFlags usage = VK_BUFFER_USAGE_RESOURCE_DESCRIPTOR_BUFFER_BIT_EXT |
+                                         VK_BUFFER_USAGE_SAMPLER_DESCRIPTOR_BUFFER_BIT_EXT |
+                                         VK_BUFFER_USAGE_SHADER_DEVICE_ADDRESS_BIT;
+        // coherent preferred, not required: the writes are flushed otherwise
+        _descriptorBuffer = _ctx.createPersistentBuffer(
+            "Bindless heap descriptor buffer",
+            layoutSize,
+            usage,
+            VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT,
+            VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT);
+        _descriptorBufferData = static_cast<uint8_t *>(std::get<BUFFER_ENTITY_UID::MAPPING_ADDRESS>(_descriptorBuffer));
+        ASSERT(_descriptorBufferData, "descriptor buffer should be persistent-mapped");
+        VkMemoryPropertyFlags memoryProperties{0};
+        vmaGetAllocationMemoryProperties(_ctx.getVmaAllocator(), std::get<BUFFER_ENTITY_UID::VMA_ALLOCATION>(_descriptorBuffer), &memoryProperties);
+        _descriptorBufferCoherent = memoryProperties & VK_MEMORY_PROPERTY_HOST_COHERENT_BIT;
+
+        _descriptorBufferBinding = VkDescriptorBufferBindingInfoEXT{
+            .sType = VK_STRUCTURE_TYPE_DESCRIPTOR_BUFFER_BINDING_INFO_EXT,
+            .address = std::get<BUFFER_ENTITY_UID::DEVICE_HOST_ADDRESS>(_descriptorBuffer).deviceAddress,
+            .usage = usage,
+        };
+        log(Level::Info, "BindlessHeap: descriptor buffer of ", layoutSize, " bytes");
+    }
+    else
+    {
+        std::array<VkDescriptorPoolSize, BINDLESS_TYPE_SIZE> poolSizes;
+        for (int type = 0; type < BINDLESS_TYPE_SIZE; ++type)
+        {
+            poolSizes[type] = VkDescriptorPoolSize{
+                .type = BINDLESS_DESCRIPTOR_TYPES[type],
+                .descriptorCount = _slots[type].capacity,
+            };
+        }
+        // one set for the whole application, never freed
+        const VkDescriptorPoolCreateInfo poolInfo{
+            .sType = VK_STRUCTURE_TYPE_DESCRIPTOR_POOL_CREATE_INFO,
+            .flags = VK_DESCRIPTOR_POOL_CREATE_UPDATE_AFTER_BIND_BIT,
+            .maxSets = 1,
+            .poolSizeCount = static_cast<uint32_t>(poolSizes.size()),
+            .pPoolSizes = poolSizes.data(),
+        };
+        VK_CHECK(vkCreateDescriptorPool(logicalDevice, &poolInfo, nullptr, &_pool));
+        setCorrlationId(_pool, logicalDevice, VK_OBJECT_TYPE_DESCRIPTOR_POOL, "Bindless heap pool");
+
+        const VkDescriptorSetAllocateInfo allocInfo{
+            .sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_ALLOCATE_INFO,
+            .descriptorPool = _pool,
+            .descriptorSetCount = 1,
+            .pSetLayouts = &_layout,
+        };
+        VK_CHECK(vkAllocateDescriptorSets(logicalDevice, &allocInfo, &_set));
+        setCorrlationId(_set, logicalDevice, VK_OBJECT_TYPE_DESCRIPTOR_SET, "Bindless heap set");
+    }
+    log(Level::Info, "BindlessHeap: ", _slots[BINDLESS_SAMPLED_IMAGE].capacity, " sampled images, ",
+        _slots[BINDLESS_SAMPLER].capacity, " samplers, ",
+        _slots[BINDLESS_STORAGE_BUFFER].capacity, " storage buffers, ",
+        _slots[BINDLESS_STORAGE_IMAGE].capacity, " storage images, descriptor buffer: ", _useDescriptorBuffer);
+}
+
+BindlessHeap::~BindlessHeap()
+{
+    const auto logicalDevice = _ctx.getLogicDevice();
+    if (_useDescriptorBuffer)
+    {
+        const auto vmaAllocator = _ctx.getVmaAllocator();
+        const auto allocation = std::get<BUFFER_ENTITY_UID::VMA_ALLOCATION>(_descriptorBuffer);
+        vmaUnmapMemory(vmaAllocator, allocation);
+        vmaDestroyBuffer(vmaAllocator, std::get<BUFFER_ENTITY_UID::BUFFER>(_descriptorBuffer), allocation);
+    }
+    else
+    {
+        // frees the set as well
+        vkDestroyDescriptorPool(logicalDevice, _pool, nullptr);
+    }
+    vkDestroyDescriptorSetLayout(logicalDevice, _layout, nullptr);
+}
+
+void BindlessHeap::beginFrame(uint32_t frameId)
+{
+    std::scoped_lock lock(_mux);
+    ASSERT(frameId < _slots[0].retired.size(), "beginFrame:: frameId should be in a valid range");
+    _currentFrameId = frameId;
+    // freed the last time this frame id was recorded: its submit is done, so are the frames before
+    for (auto &slots : _slots)
+    {
+        auto &retired = slots.retired[_currentFrameId];
+        slots.freeSlots.insert(slots.freeSlots.end(), retired.begin(), retired.end());
+        retired.clear();
+    }
+}
+
+BindlessHandle BindlessHeap::allocate(BINDLESS_TYPE type)
+{
+    std::scoped_lock lock(_mux);
+    auto &slots = _slots[type];
+    if (!slots.freeSlots.empty())
+    {
+        const auto handle = slots.freeSlots.back();
+        slots.freeSlots.pop_back();
+        return handle;
+    }
+    ASSERT(slots.highWater < slots.capacity, "BindlessHeap: out of slots, raise Config::capacity");
+    return slots.highWater++;
+}
+
+BindlessHandle BindlessHeap::allocateRange(BINDLESS_TYPE type, uint32_t count)
+{
+    std::scoped_lock lock(_mux);
+    auto &slots = _slots[type];
+    // first run of count consecutive free slots: an unloaded scene's range goes to the next one
+    auto &freeSlots = slots.freeSlots;
+    std::sort(freeSlots.begin(), freeSlots.end());
+    for (size_t begin = 0, end = 1; count > 0 && end <= freeSlots.size(); ++end)
+    {
+        if (end < freeSlots.size() && freeSlots[end] == freeSlots[end - 1] + 1 && end - begin < count)
+        {
+            continue;
+        }
+        if (end - begin == count)
+        {
+            const auto first = freeSlots[begin];
+            freeSlots.erase(freeSlots.begin() + begin, freeSlots.begin() + end);
+            return first;
+        }
+        begin = end;
+    }
+    ASSERT(slots.highWater + count <= slots.capacity, "BindlessHeap: out of slots, raise Config::capacity");
+    const auto first = slots.highWater;
+    slots.highWater += count;
+    return first;
+}
+
+void BindlessHeap::free(BINDLESS_TYPE type, BindlessHandle first, uint32_t count)
+{
+    std::scoped_lock lock(_mux);
+    auto &slots = _slots[type];
+    ASSERT(first + count <= slots.highWater, "BindlessHeap: freeing a slot never allocated");
+    auto &retired = slots.retired[_currentFrameId];
+    for (uint32_t i = 0; i < count; ++i)
+    {
+        retired.push_back(first + i);
+    }
+}
+
+void BindlessHeap::queue(const PendingWrite &write)
+{
+    std::scoped_lock lock(_mux);
+    ASSERT(write.handle < _slots[write.type].capacity, "BindlessHeap: handle out of range");
+    _pendingWrites.push_back(write);
+}
+
+void BindlessHeap::writeSampledImage(BindlessHandle handle, VkImageView imageView, VkImageLayout imageLayout)
+{
+    queue(PendingWrite{
+        .type = BINDLESS_SAMPLED_IMAGE,
+        .handle = handle,
+        .imageInfo = {
+            .imageView = imageView,
+            .imageLayout = imageLayout,
+        },
+    });
+}
+
+void BindlessHeap::writeSampler(BindlessHandle handle, VkSampler sampler)
+{
+    queue(PendingWrite{
+        .type = BINDLESS_SAMPLER,
+        .handle = handle,
+        .imageInfo = {
+            .sampler = sampler,
+        },
+    });
+}
+
+void BindlessHeap::writeStorageBuffer(BindlessHandle handle, VkBuffer buffer, VkDeviceSize offset, VkDeviceSize range)
+{
+    queue(PendingWrite{
+        .type = BINDLESS_STORAGE_BUFFER,
+        .handle = handle,
+        .bufferInfo = {
+            .buffer = buffer,
+            .offset = offset,
+            .range = range,
+        },
+    });
+}
+
+void BindlessHeap::writeStorageImage(BindlessHandle handle, VkImageView imageView)
+{
+    queue(PendingWrite{
+        .type = BINDLESS_STORAGE_IMAGE,
+        .handle = handle,
+        .imageInfo = {
+            .imageView = imageView,
+            .imageLayout = VK_IMAGE_LAYOUT_GENERAL,
+        },
+    });
+}
+
+void BindlessHeap::flush()
+{
+    ZoneScopedN("BindlessHeap: flush");
+    std::vector<PendingWrite> writes;
+    {
+        std::scoped_lock lock(_mux);
+        writes.swap(_pendingWrites);
+    }
+    TracyPlot("BindlessHeap: descriptor writes per frame", static_cast<int64_t>(writes.size()));
+    if (writes.empty())
+    {
+        return;
+    }
+    // stable: the last write to a slot wins
+    std::stable_sort(writes.begin(), writes.end(), [](const PendingWrite &a, const PendingWrite &b)
+                     { return a.type != b.type ? a.type < b.type : a.handle < b.handle; });
+    if (_useDescriptorBuffer)
+    {
+        flushDescriptorBuffer(writes);
+    }
+    else
+    {
+        flushDescriptorSet(writes);
+    }
+}
+
+void BindlessHeap::flushDescriptorSet(const std::vector<PendingWrite> &writes)
+{
+    // consecutive slots of one type merge into a single VkWriteDescriptorSet
+    // reserved: the writes point into them
+    std::vector<VkDescriptorImageInfo> imageInfos;
+    std::vector<VkDescriptorBufferInfo> bufferInfos;
+    imageInfos.reserve(writes.size());
+    bufferInfos.reserve(writes.size());
+    std::vector<VkWriteDescriptorSet> descriptorWrites;
+    for (const auto &write : writes)
+    {
+        const bool isBuffer = write.type == BINDLESS_STORAGE_BUFFER;
+        if (!descriptorWrites.empty())
+        {
+            auto &last = descriptorWrites.back();
+            const auto lastHandle = last.dstArrayElement + last.descriptorCount - 1;
+            if (last.dstBinding == static_cast<uint32_t>(write.type) && lastHandle == write.handle)
+            {
+                if (isBuffer)
+                    bufferInfos.back() = write.bufferInfo;
+                else
+                    imageInfos.back() = write.imageInfo;
+                continue;
+            }
+            if (last.dstBinding == static_cast<uint32_t>(write.type) && lastHandle + 1 == write.handle)
+            {
+                if (isBuffer)
+                    bufferInfos.push_back(write.bufferInfo);
+                else
+                    imageInfos.push_back(write.imageInfo);
+                ++last.descriptorCount;
+                continue;
+            }
+        }
+        if (isBuffer)
+            bufferInfos.push_back(write.bufferInfo);
+        else
+            imageInfos.push_back(write.imageInfo);
+        descriptorWrites.push_back(VkWriteDescriptorSet{
+            .sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET,
+            .dstSet = _set,
+            .dstBinding = static_cast<uint32_t>(write.type),
+            .dstArrayElement = write.handle,
+            .descriptorCount = 1,
+            .descriptorType = BINDLESS_DESCRIPTOR_TYPES[write.type],
+            .pImageInfo = isBuffer ? nullptr : &imageInfos.back(),
+            .pBufferInfo = isBuffer ? &bufferInfos.back() : nullptr,
+        });
+    }
+    vkUpdateDescriptorSets(_ctx.getLogicDevice(), static_cast<uint32_t>(descriptorWrites.size()), descriptorWrites.data(), 0, nullptr);
+}
+
+void BindlessHeap::flushDescriptorBuffer(const std::vector<PendingWrite> &writes)
+{
+    const auto logicalDevice = _ctx.getLogicDevice();
+    VkDeviceSize minOffset = std::numeric_limits<VkDeviceSize>::max();
+    VkDeviceSize maxOffset = 0;
+    for (const auto &write : writes)
+    {
+        VkDescriptorAddressInfoEXT addressInfo{
+            .sType = VK_STRUCTURE_TYPE_DESCRIPTOR_ADDRESS_INFO_EXT,
+        };
+        VkDescriptorGetInfoEXT getInfo{
+            .sType = VK_STRUCTURE_TYPE_DESCRIPTOR_GET_INFO_EXT,
+            .type = BINDLESS_DESCRIPTOR_TYPES[write.type],
+        };
+        switch (write.type)
+        {
+        case BINDLESS_SAMPLED_IMAGE:
+            getInfo.data.pSampledImage = &write.imageInfo;
+            break;
+        case BINDLESS_SAMPLER:
+            getInfo.data.pSampler = &write.imageInfo.sampler;
+            break;
+        case BINDLESS_STORAGE_BUFFER:
+        {
+            const VkBufferDeviceAddressInfo bufferAddressInfo{
+                .sType = VK_STRUCTURE_TYPE_BUFFER_DEVICE_ADDRESS_INFO,
+                .buffer = write.bufferInfo.buffer,
+            };
+            // no VK_WHOLE_SIZE in a descriptor buffer
+            ASSERT(write.bufferInfo.range != VK_WHOLE_SIZE, "BindlessHeap: descriptor buffer needs the explicit range");
+            addressInfo.address = vkGetBufferDeviceAddress(logicalDevice, &bufferAddressInfo) + write.bufferInfo.offset;
+            addressInfo.range = write.bufferInfo.range;
+            getInfo.data.pStorageBuffer = &addressInfo;
+            break;
+        }
+        case BINDLESS_STORAGE_IMAGE:
+            getInfo.data.pStorageImage = &write.imageInfo;
+            break;
+        default:
+            ASSERT(false, "BindlessHeap: unknown descriptor type");
+        }
+        const auto descriptorSize = _descriptorSizes[write.type];
+        const auto offset = _bindingOffsets[write.type] + write.handle * descriptorSize;
+        vkGetDescriptorEXT(logicalDevice, &getInfo, descriptorSize, _descriptorBufferData + offset);
+        minOffset = (std::min)(minOffset, offset);
+        maxOffset = (std::max)(maxOffset, offset + descriptorSize);
+    }
+    if (!_descriptorBufferCoherent)
+    {
+        VK_CHECK(vmaFlushAllocation(_ctx.getVmaAllocator(), std::get<BUFFER_ENTITY_UID::VMA_ALLOCATION>(_descriptorBuffer),
+                                    minOffset, maxOffset - minOffset));
+    }
+}
+
+void BindlessHeap::bind(VkCommandBuffer cmdBuffer,
+                        VkPipelineBindPoint bindPoint,
+                        VkPipelineLayout pipelineLayout,
+                        uint32_t setIndex) const
+{
+    if (_useDescriptorBuffer)
+    {
+        vkCmdBindDescriptorBuffersEXT(cmdBuffer, 1, &_descriptorBufferBinding);
+        const uint32_t bufferIndex = 0;
+        const VkDeviceSize offset = 0;
+        vkCmdSetDescriptorBufferOffsetsEXT(cmdBuffer, bindPoint, pipelineLayout, setIndex, 1, &bufferIndex, &offset);
+    }
+    else
+    {
+        vkCmdBindDescriptorSets(cmdBuffer, bindPoint, pipelineLayout, setIndex, 1, &_set, 0, nullptr);
+    }
+}
@@ -0,0 +1,137 @@
+#pragma once
+
+#include <mutex>
+#include <vector>
+#include <array>
+#include <limits>
+#include <cstdint>
+
+#include <context.h>
+
+// one binding per descriptor type in the heap, same order as the bindings
+// glsl: layout(set = N, binding = BINDLESS_SAMPLED_IMAGE) uniform texture2D BindlessImage2D[];
+enum BINDLESS_TYPE : int
+{
+    BINDLESS_SAMPLED_IMAGE = 0,
+    BINDLESS_SAMPLER,
+    BINDLESS_STORAGE_BUFFER,
+    BINDLESS_STORAGE_IMAGE,
+    BINDLESS_TYPE_SIZE,
+};
+
+// index into the array of its type, what the shaders get (material, push constant...)
+using BindlessHandle = uint32_t;
+static constexpr BindlessHandle INVALID_BINDLESS_HANDLE = std::numeric_limits<uint32_t>::max();
+
+// one global descriptor set shared by every pass instead of per-pass pools and per-texture sets
+// 1. one partially bound, update-after-bind array per BINDLESS_TYPE, sized once (clamped to the device limits)
+// 2. slots: allocate() from a free list, allocateRange() for contiguous ids (a scene's textures) from a run of
+//    free slots or past the high water mark, free() hands the slots back numFramesInFlight frames later,
+//    the frames in flight may still read them
+// 3. write*() only queue the descriptor, flush() writes all of them in one vkUpdateDescriptorSets,
+//    once per frame before the submit: update-after-bind allows it while the set is bound
+// 4. VK_EXT_descriptor_buffer (requested + supported, preferDescriptorBuffer): the set becomes a host-visible
+//    buffer, flush() writes the descriptors with vkGetDescriptorEXT, bind() binds the buffer
+//    every set of the pipeline must then be a descriptor buffer (VK_PIPELINE_CREATE_DESCRIPTOR_BUFFER_BIT_EXT)
+// allocate()/free()/write*() are thread-safe, beginFrame()/flush()/bind() are render thread only
+class BindlessHeap
+{
+public:
+    struct Config
+    {
+        std::array<uint32_t, BINDLESS_TYPE_SIZE> capacity{4096, 128, 1024, 256};
+        bool preferDescriptorBuffer{false};
+    };
+
+    BindlessHeap() = delete;
+    BindlessHeap(VkContext &ctx, uint32_t numFramesInFlight, const Config &config);
+    ~BindlessHeap();
+
+    BindlessHeap(const BindlessHeap &other) = delete;
+    BindlessHeap &operator=(const BindlessHeap &other) = delete;
+
+    // the previous submit of the frame is done (after BeginRecordCommandBuffer)
+    void beginFrame(uint32_t frameId);
+
+    BindlessHandle allocate(BINDLESS_TYPE type);
+    // [first, first + count), free() them one by one or as a range
+    BindlessHandle allocateRange(BINDLESS_TYPE type, uint32_t count);
+    void free(BINDLESS_TYPE type, BindlessHandle first, uint32_t count = 1);
+
+    void writeSampledImage(BindlessHandle handle, VkImageView imageView,
+                           VkImageLayout imageLayout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL);
+    void writeSampler(BindlessHandle handle, VkSampler sampler);
+    // descriptor buffer: the buffer needs VK_BUFFER_USAGE_SHADER_DEVICE_ADDRESS_BIT and an explicit range
+    void writeStorageBuffer(BindlessHandle handle, VkBuffer buffer,
+                            VkDeviceSize offset = 0, VkDeviceSize range = VK_WHOLE_SIZE);
+    // VK_IMAGE_LAYOUT_GENERAL
+    void writeStorageImage(BindlessHandle handle, VkImageView imageView);
+
+    // the queued writes of the frame, batched
+    void flush();
+
+    void bind(VkCommandBuffer cmdBuffer,
+              VkPipelineBindPoint bindPoint,
+              VkPipelineLayout pipelineLayout,
+              uint32_t setIndex) const;
+
+    VkDescriptorSetLayout layout() const
+    {
+        return _layout;
+    }
+    // VK_NULL_HANDLE with the descriptor buffer
+    VkDescriptorSet descriptorSet() const
+    {
+        return _set;
+    }
+    bool usesDescriptorBuffer() const
+    {
+        return _useDescriptorBuffer;
+    }
+    uint32_t capacity(BINDLESS_TYPE type) const
+    {
+        return _slots[type].capacity;
+    }
+
+private:
+    struct SlotAllocator
+    {
+        uint32_t capacity{0};
+        // never allocated beyond
+        uint32_t highWater{0};
+        std::vector<BindlessHandle> freeSlots;
+        // [frame]: freed while the frame was recorded
+        std::vector<std::vector<BindlessHandle>> retired;
+    };
+
+    struct PendingWrite
+    {
+        BINDLESS_TYPE type;
+        BindlessHandle handle;
+        VkDescriptorImageInfo imageInfo;
+        VkDescriptorBufferInfo bufferInfo;
+    };
+
+    void queue(const PendingWrite &write);
+    void flushDescriptorSet(const std::vector<PendingWrite> &writes);
+    void flushDescriptorBuffer(const std::vector<PendingWrite> &writes);
+
+    VkContext &_ctx;
+    bool _useDescriptorBuffer{false};
+    VkDescriptorSetLayout _layout{VK_NULL_HANDLE};
+    // descriptor set backend
+    VkDescriptorPool _pool{VK_NULL_HANDLE};
+    VkDescriptorSet _set{VK_NULL_HANDLE};
+    // descriptor buffer backend
+    BufferEntity _descriptorBuffer;
+    uint8_t *_descriptorBufferData{nullptr};
+    bool _descriptorBufferCoherent{false};
+    VkDescriptorBufferBindingInfoEXT _descriptorBufferBinding{};
+    std::array<VkDeviceSize, BINDLESS_TYPE_SIZE> _bindingOffsets{};
+    std::array<size_t, BINDLESS_TYPE_SIZE> _descriptorSizes{};
+
+    std::mutex _mux;
+    std::array<SlotAllocator, BINDLESS_TYPE_SIZE> _slots;
+    std::vector<PendingWrite> _pendingWrites;
+    uint32_t _currentFrameId{0};
+};
@@ -0,0 +1,272 @@
+#include <chrono>
+
+#include <tracy/Tracy.hpp>
+
+#include <blasBuilder.h>
+
+BlasBuilder::BlasBuilder(VkContext &ctx, const Config &config)
+    : _ctx(ctx), _config(config)
+{
+    VkPhysicalDeviceAccelerationStructurePropertiesKHR asProperties{
+        .sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_ACCELERATION_STRUCTURE_PROPERTIES_KHR,
+    };
+    VkPhysicalDeviceProperties2 properties{
+        .sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_PROPERTIES_2,
+        .pNext = &asProperties,
+    };
+    vkGetPhysicalDeviceProperties2(_ctx.getSelectedPhysicalDevice(), &properties);
+    _scratchAlignment = (std::max)(VkDeviceSize{asProperties.minAccelerationStructureScratchOffsetAlignment}, VkDeviceSize{1});
+}
+
+ASEntity BlasBuilder::create(VkContext &ctx, const std::string &name, VkDeviceSize sizeInBytes)
+{
+    const auto logicalDevice = ctx.getLogicDevice();
+    const auto asBuffer = ctx.createDeviceLocalBuffer(
+        name,
+        sizeInBytes,
+        VK_BUFFER_USAGE_ACCELERATION_STRUCTURE_STORAGE_BIT_KHR | VK_BUFFER_USAGE_SHADER_DEVICE_ADDRESS_BIT);
+    const VkAccelerationStructureCreateInfoKHR createInfo{
+        .sType = VK_STRUCTURE_TYPE_ACCELERATION_STRUCTURE_CREATE_INFO_KHR,
+        .buffer = std::get<BUFFER_ENTITY_UID::BUFFER>(asBuffer),
+        .size = sizeInBytes,
+        .type = VK_ACCELERATION_STRUCTURE_TYPE_BOTTOM_LEVEL_KHR,
+    };
+    VkAccelerationStructureKHR as{VK_NULL_HANDLE};
+    VK_CHECK(vkCreateAccelerationStructureKHR(logicalDevice, &createInfo, nullptr, &as));
+    setCorrlationId(as, logicalDevice, VK_OBJECT_TYPE_ACCELERATION_STRUCTURE_KHR, name);
+
+    // connection between blas and tlas
+    const VkAccelerationStructureDeviceAddressInfoKHR addressInfo{
+        .sType = VK_STRUCTURE_TYPE_ACCELERATION_STRUCTURE_DEVICE_ADDRESS_INFO_KHR,
+        .accelerationStructure = as,
+    };
+    const auto asAddress = vkGetAccelerationStructureDeviceAddressKHR(logicalDevice, &addressInfo);
+    return std::make_tuple(asBuffer, as, asAddress);
+}
+
+void BlasBuilder::destroy(VkContext &ctx, const ASEntity &as)
+{
+    const auto &asBuffer = std::get<AS_ENTITY_UID::BUFFER_ENTITY>(as);
+    vkDestroyAccelerationStructureKHR(ctx.getLogicDevice(), std::get<AS_ENTITY_UID::AS>(as), nullptr);
+    vmaDestroyBuffer(ctx.getVmaAllocator(),
+                     std::get<BUFFER_ENTITY_UID::BUFFER>(asBuffer),
+                     std::get<BUFFER_ENTITY_UID::VMA_ALLOCATION>(asBuffer));
+}
+
+void BlasBuilder::submitAndWait(CommandBufferEntity &cmdBuffer) const
+{
+    const auto point = _ctx.submitCommandBuffer(cmdBuffer);
+    waitTimelinePoints(_ctx.getLogicDevice(), {point});
+}
+
+std::vector<ASEntity> BlasBuilder::build(const std::vector<BlasGeometry> &geometries)
+{
+    ZoneScopedN("BlasBuilder: build");
+    _stats = Stats{};
+    if (geometries.empty())
+    {
+        return {};
+    }
+    const auto logicalDevice = _ctx.getLogicDevice();
+    const auto numBlas = static_cast<uint32_t>(geometries.size());
+    const VkBuildAccelerationStructureFlagsKHR buildFlags =
+        _config.flags | (_config.compact ? VK_BUILD_ACCELERATION_STRUCTURE_ALLOW_COMPACTION_BIT_KHR : 0);
+
+    // 1. build inputs and sizes, pGeometries point into asGeometries: sized once
+    std::vector<VkAccelerationStructureGeometryKHR> asGeometries(numBlas);
+    std::vector<VkAccelerationStructureBuildGeometryInfoKHR> buildInfos(numBlas);
+    std::vector<VkAccelerationStructureBuildRangeInfoKHR> buildRanges(numBlas);
+    std::vector<VkDeviceSize> scratchSizes(numBlas);
+    std::vector<ASEntity> table(numBlas);
+    for (uint32_t i = 0; i < numBlas; ++i)
+    {
+        const auto &geometry = geometries[i];
+        // VK_GEOMETRY_OPAQUE_BIT_KHR indicates that this geometry does not invoke the any-hit shaders even if present in a hit group.
+        asGeometries[i] = VkAccelerationStructureGeometryKHR{
+            .sType = VK_STRUCTURE_TYPE_ACCELERATION_STRUCTURE_GEOMETRY_KHR,
+            .geometryType = VK_GEOMETRY_TYPE_TRIANGLES_KHR,
+            .geometry = {
+                .triangles = {
+                    .sType = VK_STRUCTURE_TYPE_ACCELERATION_STRUCTURE_GEOMETRY_TRIANGLES_DATA_KHR,
+                    .vertexFormat = VK_FORMAT_R32G32B32_SFLOAT,
+                    .vertexData = {.deviceAddress = geometry.vertexAddress},
+                    .vertexStride = geometry.vertexStride,
+                    .maxVertex = geometry.maxVertex,
+                    .indexType = VK_INDEX_TYPE_UINT32,
+                    .indexData = {.deviceAddress = geometry.indexAddress},
+                    // no per-vertex transform, the vertices are already transformed
+                    .transformData = {.hostAddress = nullptr},
+                },
+            },
+            .flags = VK_GEOMETRY_OPAQUE_BIT_KHR,
+        };
+        buildInfos[i] = VkAccelerationStructureBuildGeometryInfoKHR{
+            .sType = VK_STRUCTURE_TYPE_ACCELERATION_STRUCTURE_BUILD_GEOMETRY_INFO_KHR,
+            .type = VK_ACCELERATION_STRUCTURE_TYPE_BOTTOM_LEVEL_KHR,
+            .flags = buildFlags,
+            .mode = VK_BUILD_ACCELERATION_STRUCTURE_MODE_BUILD_KHR,
+            .geometryCount = 1,
+            .pGeometries = &asGeometries[i],
+        };
+        buildRanges[i] = VkAccelerationStructureBuildRangeInfoKHR{
+            .primitiveCount = geometry.numTriangles,
+        };
+
+        VkAccelerationStructureBuildSizesInfoKHR buildSizes{
+            .sType = VK_STRUCTURE_TYPE_ACCELERATION_STRUCTURE_BUILD_SIZES_INFO_KHR,
+        };
+        vkGetAccelerationStructureBuildSizesKHR(
+            logicalDevice,
+            VK_ACCELERATION_STRUCTURE_BUILD_TYPE_DEVICE_KHR,
+            &buildInfos[i],
+            &geometry.numTriangles,
+            &buildSizes);
+        scratchSizes[i] = alignedSize(buildSizes.buildScratchSize, _scratchAlignment);
+        table[i] = create(_ctx, "BLAS: " + std::to_string(i), buildSizes.accelerationStructureSize);
+        buildInfos[i].dstAccelerationStructure = std::get<AS_ENTITY_UID::AS>(table[i]);
+        _stats.sizeBeforeCompactionInBytes += buildSizes.accelerationStructureSize;
+    }
+
+    // 2. batches [first, last) within the scratch budget
+    std::vector<std::pair<uint32_t, uint32_t>> batches;
+    VkDeviceSize batchScratch = 0;
+    for (uint32_t i = 0; i < numBlas; ++i)
+    {
+        if (batches.empty() || batchScratch + scratchSizes[i] > _config.scratchBudgetInBytes)
+        {
+            batches.emplace_back(i, i);
+            batchScratch = 0;
+        }
+        batchScratch += scratchSizes[i];
+        batches.back().second = i + 1;
+        _stats.scratchSizeInBytes = (std::max)(_stats.scratchSizeInBytes, batchScratch);
+    }
+
+    // the device address of the scratch must be aligned as well
+    const auto scratchBuffer = _ctx.createDeviceLocalBuffer(
+        "BLAS scratch",
+        _stats.scratchSizeInBytes + _scratchAlignment,
+        VK_BUFFER_USAGE_STORAGE_BUFFER_BIT | VK_BUFFER_USAGE_SHADER_DEVICE_ADDRESS_BIT);
+    const auto scratchAddress = alignedSize(std::get<BUFFER_ENTITY_UID::DEVICE_HOST_ADDRESS>(scratchBuffer).deviceAddress,
+                                            _scratchAlignment);
+
+    VkQueryPool queryPool{VK_NULL_HANDLE};
+    if (_config.compact)
+    {
+        const VkQueryPoolCreateInfo queryPoolInfo{
+            .sType = VK_STRUCTURE_TYPE_QUERY_POOL_CREATE_INFO,
+            .queryType = VK_QUERY_TYPE_ACCELERATION_STRUCTURE_COMPACTED_SIZE_KHR,
+            .queryCount = numBlas,
+        };
+        VK_CHECK(vkCreateQueryPool(logicalDevice, &queryPoolInfo, nullptr, &queryPool));
+    }
+
+    // 3. every batch in one command buffer: build, barrier (scratch reuse, compacted size query), query
+    auto cmdBuffer = _ctx.getCommandBufferForIO();
+    const auto cmd = std::get<COMMAND_BUFFER_ENTITY_OFFSET::COMMAND_BUFFER>(cmdBuffer);
+    _ctx.BeginRecordCommandBuffer(cmdBuffer);
+    if (queryPool != VK_NULL_HANDLE)
+    {
+        vkCmdResetQueryPool(cmd, queryPool, 0, numBlas);
+    }
+    const VkMemoryBarrier2 buildBarrier{
+        .sType = VK_STRUCTURE_TYPE_MEMORY_BARRIER_2,
+        .srcStageMask = VK_PIPELINE_STAGE_2_ACCELERATION_STRUCTURE_BUILD_BIT_KHR,
+        .srcAccessMask = VK_ACCESS_2_ACCELERATION_STRUCTURE_WRITE_BIT_KHR,
+        .dstStageMask = VK_PIPELINE_STAGE_2_ACCELERATION_STRUCTURE_BUILD_BIT_KHR,
+        .dstAccessMask = VK_ACCESS_2_ACCELERATION_STRUCTURE_READ_BIT_KHR | VK_ACCESS_2_ACCELERATION_STRUCTURE_WRITE_BIT_KHR,
+    };
+    const VkDependencyInfo buildDependency{
+        .sType = VK_STRUCTURE_TYPE_DEPENDENCY_INFO,
+        .memoryBarrierCount = 1,
+        .pMemoryBarriers = &buildBarrier,
+    };
+    for (const auto &[first, last] : batches)
+    {
+        std::vector<const VkAccelerationStructureBuildRangeInfoKHR *> rangePtrs;
+        std::vector<VkAccelerationStructureKHR> batchAs;
+        VkDeviceSize scratchOffset = 0;
+        for (uint32_t i = first; i < last; ++i)
+        {
+            buildInfos[i].scratchData.deviceAddress = scratchAddress + scratchOffset;
+            scratchOffset += scratchSizes[i];
+            rangePtrs.push_back(&buildRanges[i]);
+            batchAs.push_back(std::get<AS_ENTITY_UID::AS>(table[i]));
+        }
+        vkCmdBuildAccelerationStructuresKHR(cmd, last - first, &buildInfos[first], rangePtrs.data());
+        vkCmdPipelineBarrier2(cmd, &buildDependency);
+        if (queryPool != VK_NULL_HANDLE)
+        {
+            vkCmdWriteAccelerationStructuresPropertiesKHR(cmd,
+                                                          static_cast<uint32_t>(batchAs.size()),
+                                                          batchAs.data(),
+                                                          VK_QUERY_TYPE_ACCELERATION_STRUCTURE_COMPACTED_SIZE_KHR,
+                                                          queryPool,
+                                                          first);
+        }
+    }
+    _ctx.EndRecordCommandBuffer(cmdBuffer);
+
+    const auto buildStart = std::chrono::steady_clock::now();
+    submitAndWait(cmdBuffer);
+    _stats.buildMs = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - buildStart).count();
+    _stats.numBlas = numBlas;
+    _stats.numBatches = static_cast<uint32_t>(batches.size());
+
+    vmaDestroyBuffer(_ctx.getVmaAllocator(),
+                     std::get<BUFFER_ENTITY_UID::BUFFER>(scratchBuffer),
+                     std::get<BUFFER_ENTITY_UID::VMA_ALLOCATION>(scratchBuffer));
+
+    _stats.sizeAfterCompactionInBytes = _stats.sizeBeforeCompactionInBytes;
+    if (queryPool != VK_NULL_HANDLE)
+    {
+        compact(table, queryPool);
+        vkDestroyQueryPool(logicalDevice, queryPool, nullptr);
+    }
+
+    log(Level::Info, "BlasBuilder: ", _stats.numBlas, " BLAS in ", _stats.numBatches, " batch(es), scratch ",
+        _stats.scratchSizeInBytes, " bytes, build ", _stats.buildMs, " ms");
+    log(Level::Info, "BlasBuilder: ", _stats.sizeBeforeCompactionInBytes, " -> ", _stats.sizeAfterCompactionInBytes,
+        " bytes after compaction, ", _stats.compactionMs, " ms");
+    return table;
+}
+
+void BlasBuilder::compact(std::vector<ASEntity> &table, VkQueryPool queryPool)
+{
+    ZoneScopedN("BlasBuilder: compact");
+    const auto numBlas = static_cast<uint32_t>(table.size());
+    std::vector<VkDeviceSize> compactedSizes(numBlas);
+    // the build was waited on: available
+    VK_CHECK(vkGetQueryPoolResults(_ctx.getLogicDevice(), queryPool, 0, numBlas,
+                                   compactedSizes.size() * sizeof(VkDeviceSize), compactedSizes.data(),
+                                   sizeof(VkDeviceSize), VK_QUERY_RESULT_64_BIT | VK_QUERY_RESULT_WAIT_BIT));
+
+    std::vector<ASEntity> compactedTable(numBlas);
+    auto cmdBuffer = _ctx.getCommandBufferForIO();
+    const auto cmd = std::get<COMMAND_BUFFER_ENTITY_OFFSET::COMMAND_BUFFER>(cmdBuffer);
+    _ctx.BeginRecordCommandBuffer(cmdBuffer);
+    _stats.sizeAfterCompactionInBytes = 0;
+    for (uint32_t i = 0; i < numBlas; ++i)
+    {
+        compactedTable[i] = create(_ctx, "BLAS compacted: " + std::to_string(i), compactedSizes[i]);
+        const VkCopyAccelerationStructureInfoKHR copyInfo{
+            .sType = VK_STRUCTURE_TYPE_COPY_ACCELERATION_STRUCTURE_INFO_KHR,
+            .src = std::get<AS_ENTITY_UID::AS>(table[i]),
+            .dst = std::get<AS_ENTITY_UID::AS>(compactedTable[i]),
+            .mode = VK_COPY_ACCELERATION_STRUCTURE_MODE_COMPACT_KHR,
+        };
+        vkCmdCopyAccelerationStructureKHR(cmd, &copyInfo);
+        _stats.sizeAfterCompactionInBytes += compactedSizes[i];
+    }
+    _ctx.EndRecordCommandBuffer(cmdBuffer);
+
+    const auto compactionStart = std::chrono::steady_clock::now();
+    submitAndWait(cmdBuffer);
+    _stats.compactionMs = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - compactionStart).count();
+
+    for (const auto &as : table)
+    {
+        destroy(_ctx, as);
+    }
+    table = std::move(compactedTable);
+}
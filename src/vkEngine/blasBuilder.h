@@ -0,0 +1,76 @@
+#pragma once
+
+#include <vector>
+#include <cstdint>
+
+#include <context.h>
+
+// triangles of one BLAS, already in device memory (e.g. a mesh range of the composite vb/ib)
+struct BlasGeometry
+{
+    VkDeviceAddress vertexAddress{0};
+    VkDeviceSize vertexStride{0};
+    // highest vertex index referenced
+    uint32_t maxVertex{0};
+    // VK_INDEX_TYPE_UINT32
+    VkDeviceAddress indexAddress{0};
+    uint32_t numTriangles{0};
+};
+
+// builds one BLAS per geometry, batched
+// 1. the build sizes of every geometry are queried up front, the geometries are cut into batches whose
+//    scratch fits Config::scratchBudgetInBytes (a larger geometry gets a batch of its own)
+// 2. one scratch buffer sized to the largest batch, suballocated by the builds of a batch and reused by the
+//    next one after a barrier: all the batches are recorded into one command buffer, one submit, one wait
+// 3. compaction: the compacted sizes are written into a query pool after each batch, then every BLAS is
+//    copied (VK_COPY_ACCELERATION_STRUCTURE_MODE_COMPACT_KHR) into a buffer of that size and the original freed
+// the returned table is indexed like the geometries
+class BlasBuilder
+{
+public:
+    struct Config
+    {
+        VkDeviceSize scratchBudgetInBytes{64ull * 1024 * 1024};
+        bool compact{true};
+        VkBuildAccelerationStructureFlagsKHR flags{VK_BUILD_ACCELERATION_STRUCTURE_PREFER_FAST_TRACE_BIT_KHR};
+    };
+
+    struct Stats
+    {
+        uint32_t numBlas{0};
+        uint32_t numBatches{0};
+        VkDeviceSize scratchSizeInBytes{0};
+        // build submit to completion, compaction included in compactionMs only
+        double buildMs{0.0};
+        double compactionMs{0.0};
+        VkDeviceSize sizeBeforeCompactionInBytes{0};
+        VkDeviceSize sizeAfterCompactionInBytes{0};
+    };
+
+    BlasBuilder() = delete;
+    BlasBuilder(VkContext &ctx, const Config &config);
+
+    BlasBuilder(const BlasBuilder &other) = delete;
+    BlasBuilder &operator=(const BlasBuilder &other) = delete;
+
+    // blocks until the BLAS are built (and compacted)
+    std::vector<ASEntity> build(const std::vector<BlasGeometry> &geometries);
+
+    const Stats &stats() const
+    {
+        return _stats;
+    }
+
+    // bottom level, backed by a device local buffer of sizeInBytes
+    static ASEntity create(VkContext &ctx, const std::string &name, VkDeviceSize sizeInBytes);
+    static void destroy(VkContext &ctx, const ASEntity &as);
+
+private:
+    void submitAndWait(CommandBufferEntity &cmdBuffer) const;
+    void compact(std::vector<ASEntity> &table, VkQueryPool queryPool);
+
+    VkContext &_ctx;
+    const Config _config;
+    VkDeviceSize _scratchAlignment{0};
+    Stats _stats;
+};
@@ -8,6 +8,7 @@
 #include <tracy/TracyVulkan.hpp>
 
 #include <queuethreadsafe.h>
+#include <stagingRing.h>
 #include <future> //packaged_task<>
 
 #ifdef _WIN64
@@ -17,12 +18,20 @@
 #define VK_NO_PROTOTYPES // for volk
 #define VOLK_IMPLEMENTATION
 
-// triple-buffer
+// triple-buffer at most, LatencyConfig::framesInFlight picks 1..3 at runtime
 static constexpr int MAX_FRAMES_IN_FLIGHT = 3;
-static constexpr int MAX_DESCRIPTOR_SETS = 1 * MAX_FRAMES_IN_FLIGHT + 1 + 4;
-// static constexpr int MAX_DESCRIPTOR_SETS = 1000;
 //  Default fence timeout in nanoseconds
 #define DEFAULT_FENCE_TIMEOUT 100000000000
+// persistently mapped upload memory shared by all the uploads
+static constexpr VkDeviceSize STAGING_RING_SIZE_IN_BYTES = 64ull * 1024 * 1024;
+// cuda interop
+#ifdef _WIN64
+static constexpr VkExternalMemoryHandleTypeFlagBits EXTERNAL_MEMORY_HANDLE_TYPE = VK_EXTERNAL_MEMORY_HANDLE_TYPE_OPAQUE_WIN32_BIT;
+static constexpr VkExternalSemaphoreHandleTypeFlagBits EXTERNAL_SEMAPHORE_HANDLE_TYPE = VK_EXTERNAL_SEMAPHORE_HANDLE_TYPE_OPAQUE_WIN32_BIT;
+#else
+static constexpr VkExternalMemoryHandleTypeFlagBits EXTERNAL_MEMORY_HANDLE_TYPE = VK_EXTERNAL_MEMORY_HANDLE_TYPE_OPAQUE_FD_BIT;
+static constexpr VkExternalSemaphoreHandleTypeFlagBits EXTERNAL_SEMAPHORE_HANDLE_TYPE = VK_EXTERNAL_SEMAPHORE_HANDLE_TYPE_OPAQUE_FD_BIT;
+#endif
 
 static VKAPI_ATTR VkBool32 VKAPI_CALL debugCallback(VkDebugUtilsMessageSeverityFlagBitsEXT messageSeverity,
                                                     VkDebugUtilsMessageTypeFlagsEXT messageType,
@@ -39,11 +48,13 @@ class VkContext::Impl
 public:
     explicit Impl(
         const VkContext &ctx,
-        const WindowEntity &window,
+        const WindowEntity *window,
+        const HeadlessConfig &headlessConfig,
         const std::vector<const char *> &instanceValidationLayers,
         const std::set<std::string> &instanceExtensions,
         const std::vector<const char *> deviceExtensions)
         : _window(window),
+          _headlessConfig(headlessConfig),
           _instanceValidationLayers(instanceValidationLayers),
           _instanceExtensions(instanceExtensions),
           _deviceExtensions(deviceExtensions)
@@ -53,11 +64,18 @@ public:
         selectPhysicalDevice();
         cacheSupportedSurfaceFormats();
         queryPhysicalDeviceCaps();
+        if (isHeadless())
+        {
+            dropUnsupportedDeviceExtensions();
+        }
         selectQueueFamily();
         selectFeatures();
         createLogicDevice();
         cacheCommandQueue();
+        createQueueTimelines();
         createVMA();
+        _memoryManager = std::make_unique<MemoryManager>(_vmaAllocator, MemoryManager::defaultConfig(), _memoryBudgetSupported);
+        _stagingRing = std::make_unique<StagingRing>(_logicalDevice, _vmaAllocator, STAGING_RING_SIZE_IN_BYTES);
 
         createCommandPool();
         createTracyContext();
@@ -74,31 +92,49 @@ public:
 
         for (const auto &[cmdSemantic, cmdEntity] : cmdBuffers)
         {
-            VkCommandPool p{VK_NULL_HANDLE};
+            // one pool per command buffer
             for (const auto &t : cmdEntity)
             {
                 const auto &cmdPool = std::get<0>(t);
                 const auto &cmdBuffer = std::get<1>(t);
                 const auto &cmdFence = std::get<2>(t);
-                p = cmdPool;
 
                 vkDestroyFence(_logicalDevice, cmdFence, nullptr);
                 vkFreeCommandBuffers(_logicalDevice, cmdPool, 1, &cmdBuffer);
+                vkDestroyCommandPool(_logicalDevice, cmdPool, nullptr);
             }
-            vkDestroyCommandPool(_logicalDevice, p, nullptr);
         }
 
         for (size_t i = 0; i < _swapChainImageViews.size(); i++)
         {
             vkDestroyImageView(_logicalDevice, _swapChainImageViews[i], nullptr);
-            vkDestroySemaphore(_logicalDevice, imageCanAcquireSemaphores[i], nullptr);
-            vkDestroySemaphore(_logicalDevice, imageRendereredSemaphores[i], nullptr);
         }
+        // headless: the ring images, their views are the ones above
+        for (const auto &offscreenImage : _offscreenImages)
+        {
+            vmaDestroyImage(_vmaAllocator,
+                            std::get<IMAGE_ENTITY_OFFSET::IMAGE>(offscreenImage),
+                            std::get<IMAGE_ENTITY_OFFSET::IMAGE_VMA_ALLOCATION>(offscreenImage));
+        }
+        for (const auto semaphore : imageRendereredSemaphores)
+        {
+            vkDestroySemaphore(_logicalDevice, semaphore, nullptr);
+        }
+        for (const auto semaphore : imageCanAcquireSemaphores)
+        {
+            vkDestroySemaphore(_logicalDevice, semaphore, nullptr);
+        }
+        _framePacer.reset();
+        _readbackPool.reset();
+        _queueTimelines.clear();
 
         // image is owned by swap chain
         vkDestroySwapchainKHR(_logicalDevice, _swapChain, nullptr);
 
         // clean vma resource
+        _stagingRing.reset();
+        // the pools go before the allocator
+        _memoryManager.reset();
         for (const auto &[memTypeIndex, pool] : _vmaCustomMemoryPool)
         {
             vmaDestroyPool(_vmaAllocator, pool);
@@ -114,6 +150,8 @@ public:
 
     void createSwapChain();
     void createSwapChainImageView();
+    // headless: the images createSwapChain would get from the swapchain, and their readback
+    void createOffscreenImages();
     void createPerFrameSyncObjects();
 
     VkRenderPass createSwapChainRenderPass();
@@ -156,12 +194,14 @@ public:
 
     BufferEntity createStagingBuffer(
         const std::string &name,
-        VkDeviceSize bufferSizeInBytes);
+        VkDeviceSize bufferSizeInBytes,
+        MEMORY_CATEGORY category);
 
     BufferEntity createDeviceLocalBuffer(
         const std::string &name,
         VkDeviceSize bufferSizeInBytes,
-        VkBufferUsageFlags bufferUsageFlag);
+        VkBufferUsageFlags bufferUsageFlag,
+        MEMORY_CATEGORY category);
 
     std::tuple<BufferEntity, VkStridedDeviceAddressRegionKHR> createShaderBindTableBuffer(
         const std::string &name,
@@ -180,11 +220,11 @@ public:
         VkSampleCountFlagBits textureMultiSampleCount,
         VkImageUsageFlags usage,
         VkMemoryPropertyFlags memoryFlags,
-        bool generateMips);
+        bool generateMips,
+        MEMORY_CATEGORY category);
 
     // for cuda interop
-#ifdef _WIN64
-    void createExportableImage(
+    ImageEntity createExportableImage(
         const std::string &name,
         VkImageType imageType,
         VkFormat format,
@@ -192,7 +232,6 @@ public:
         uint32_t textureMipLevelCount,
         VkSampleCountFlagBits textureMultiSampleCount,
         VkImageUsageFlags usage);
-#endif
 
     std::tuple<VkSampler> createSampler(const std::string &name);
 
@@ -227,17 +266,18 @@ public:
         VkMemoryPropertyFlags requiredMemoryProperties,
         VkMemoryPropertyFlags preferredMemoryProperties,
         VmaMemoryUsage memoryUsage,
-        bool mapping = false);
+        bool mapping = false,
+        MEMORY_CATEGORY category = GENERIC_MEMORY);
 
     // for cuda interop
-#ifdef _WIN64
     BufferEntity createExportableBuffer(
         const std::string &name,
         VkDeviceSize bufferSizeInBytes,
         VkBufferUsageFlags bufferUsageFlag,
         VkSharingMode bufferSharingMode,
         bool mapping = false);
-#endif
+
+    VkSemaphore createExportableSemaphore(VkSemaphoreType type, uint64_t initialValue);
 
     std::unordered_map<VkDescriptorSetLayout *, std::vector<VkDescriptorSet>> allocateDescriptorSet(
         const VkDescriptorPool pool,
@@ -273,12 +313,27 @@ public:
         uint32_t srcOffset = 0,
         uint32_t dstOffset = 0);
 
+    void copyBuffer(
+        const BufferEntity &stagingBuffer,
+        const BufferEntity &deviceLocalBuffer,
+        const CommandBufferEntity &cmdBuffer,
+        uint32_t sizeInBytes,
+        uint32_t srcOffset = 0,
+        uint32_t dstOffset = 0);
+
     // not a complete api, v1
     void writeImage(
         const ImageEntity &image,
         const BufferEntity &stagingBuffer,
         const CommandBufferEntity &cmdBuffer,
-        void *rawData);
+        void *rawData,
+        VkDeviceSize stagingOffset);
+
+    void copyBufferToImage(
+        const ImageEntity &image,
+        const BufferEntity &stagingBuffer,
+        const CommandBufferEntity &cmdBuffer,
+        VkDeviceSize stagingOffset);
 
     // cmdBufferEntity: where to submit the command
     // imageEntity: target of write op
@@ -362,11 +417,20 @@ public:
 
     std::vector<CommandBufferEntity> &getCommandBufferForRenderingForAllSwapChains();
 
-    void submitCommand();
+    void submitCommand(const std::vector<VkSemaphoreSubmitInfo> &extraWaits,
+                       const std::vector<VkSemaphoreSubmitInfo> &extraSignals);
+
+    TimelinePoint submitCommandBuffer(const CommandBufferEntity &cmdBuffer,
+                                      const std::vector<VkSemaphoreSubmitInfo> &waits,
+                                      const std::vector<VkSemaphoreSubmitInfo> &signals);
 
     void present(uint32_t swapChainImageIndex);
 
-    uint32_t getSwapChainImageIndexToRender() const;
+    uint32_t getSwapChainImageIndexToRender();
+
+    void setLatencyConfig(const LatencyConfig &config);
+    // after the swapchain: presentation is observed with vkWaitForPresentKHR when enabled
+    void createFramePacer();
 
     inline auto getLogicDevice() const
     {
@@ -378,6 +442,38 @@ public:
         return _vmaAllocator;
     }
 
+    inline StagingRing &getStagingRing()
+    {
+        return *_stagingRing;
+    }
+
+    inline MemoryManager &getMemoryManager()
+    {
+        return *_memoryManager;
+    }
+
+    inline FramePacer &getFramePacer()
+    {
+        return *_framePacer;
+    }
+
+    inline const auto &getLatencyConfig() const
+    {
+        return _latencyConfig;
+    }
+
+    inline uint32_t getFramesInFlight() const
+    {
+        return _latencyConfig.framesInFlight;
+    }
+
+    QueueTimeline &getQueueTimeline(VkQueue queue)
+    {
+        const auto it = _queueTimelines.find(queue);
+        ASSERT(it != _queueTimelines.end(), "no timeline for this queue");
+        return *it->second;
+    }
+
     inline auto getInstance() const
     {
         return _instance;
@@ -439,6 +535,120 @@ public:
         return _swapChainExtent;
     }
 
+    inline auto getSwapChainFormat() const
+    {
+        return _swapChainFormat;
+    }
+
+    // the ray tracing pipeline, acceleration structure and ray query extensions requested by the application
+    // and supported by the device
+    inline bool isRayTracingSupported() const
+    {
+        return isDeviceExtensionRequested(VK_KHR_RAY_TRACING_PIPELINE_EXTENSION_NAME) &&
+               isDeviceExtensionRequested(VK_KHR_ACCELERATION_STRUCTURE_EXTENSION_NAME) &&
+               isDeviceExtensionRequested(VK_KHR_RAY_QUERY_EXTENSION_NAME) &&
+               checkRayTracingSupport();
+    }
+
+    // VK_EXT_descriptor_buffer requested by the application and supported by the device
+    inline bool isDescriptorBufferSupported() const
+    {
+        return isDeviceExtensionRequested(VK_EXT_DESCRIPTOR_BUFFER_EXTENSION_NAME) &&
+               _descriptorBufferFeature.descriptorBuffer == VK_TRUE;
+    }
+
+    // device local storage buffers, the rgba8 images of JuliaTextureCuda and timeline semaphores exportable with
+    // the handle type of the platform
+    bool isExternalInteropSupported() const
+    {
+#ifdef _WIN64
+        if (!isDeviceExtensionRequested(VK_KHR_EXTERNAL_MEMORY_WIN32_EXTENSION_NAME) ||
+            !isDeviceExtensionRequested(VK_KHR_EXTERNAL_SEMAPHORE_WIN32_EXTENSION_NAME))
+#else
+        if (!isDeviceExtensionRequested(VK_KHR_EXTERNAL_MEMORY_FD_EXTENSION_NAME) ||
+            !isDeviceExtensionRequested(VK_KHR_EXTERNAL_SEMAPHORE_FD_EXTENSION_NAME))
+#endif
+        {
+            return false;
+        }
+        const VkPhysicalDeviceExternalBufferInfo bufferInfo{
+            .sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_EXTERNAL_BUFFER_INFO,
+            .usage = VK_BUFFER_USAGE_STORAGE_BUFFER_BIT | VK_BUFFER_USAGE_VERTEX_BUFFER_BIT,
+            .handleType = EXTERNAL_MEMORY_HANDLE_TYPE,
+        };
+        VkExternalBufferProperties bufferProperties{
+            .sType = VK_STRUCTURE_TYPE_EXTERNAL_BUFFER_PROPERTIES,
+        };
+        vkGetPhysicalDeviceExternalBufferProperties(_selectedPhysicalDevice, &bufferInfo, &bufferProperties);
+
+        // an unsupported combination fails the query: not exportable either
+        VkPhysicalDeviceExternalImageFormatInfo externalImageInfo{
+            .sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_EXTERNAL_IMAGE_FORMAT_INFO,
+            .handleType = EXTERNAL_MEMORY_HANDLE_TYPE,
+        };
+        const VkPhysicalDeviceImageFormatInfo2 imageFormatInfo{
+            .sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_IMAGE_FORMAT_INFO_2,
+            .pNext = &externalImageInfo,
+            .format = VK_FORMAT_R8G8B8A8_UNORM,
+            .type = VK_IMAGE_TYPE_2D,
+            .tiling = VK_IMAGE_TILING_OPTIMAL,
+            .usage = VK_IMAGE_USAGE_SAMPLED_BIT | VK_IMAGE_USAGE_TRANSFER_DST_BIT,
+        };
+        VkExternalImageFormatProperties externalImageProperties{
+            .sType = VK_STRUCTURE_TYPE_EXTERNAL_IMAGE_FORMAT_PROPERTIES,
+        };
+        VkImageFormatProperties2 imageFormatProperties{
+            .sType = VK_STRUCTURE_TYPE_IMAGE_FORMAT_PROPERTIES_2,
+            .pNext = &externalImageProperties,
+        };
+        const bool imageExportable =
+            vkGetPhysicalDeviceImageFormatProperties2(_selectedPhysicalDevice, &imageFormatInfo, &imageFormatProperties) == VK_SUCCESS &&
+            (externalImageProperties.externalMemoryProperties.externalMemoryFeatures & VK_EXTERNAL_MEMORY_FEATURE_EXPORTABLE_BIT);
+
+        VkSemaphoreTypeCreateInfo timelineInfo{
+            .sType = VK_STRUCTURE_TYPE_SEMAPHORE_TYPE_CREATE_INFO,
+            .semaphoreType = VK_SEMAPHORE_TYPE_TIMELINE,
+        };
+        const VkPhysicalDeviceExternalSemaphoreInfo semaphoreInfo{
+            .sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_EXTERNAL_SEMAPHORE_INFO,
+            .pNext = &timelineInfo,
+            .handleType = EXTERNAL_SEMAPHORE_HANDLE_TYPE,
+        };
+        VkExternalSemaphoreProperties semaphoreProperties{
+            .sType = VK_STRUCTURE_TYPE_EXTERNAL_SEMAPHORE_PROPERTIES,
+        };
+        vkGetPhysicalDeviceExternalSemaphoreProperties(_selectedPhysicalDevice, &semaphoreInfo, &semaphoreProperties);
+
+        return (bufferProperties.externalMemoryProperties.externalMemoryFeatures & VK_EXTERNAL_MEMORY_FEATURE_EXPORTABLE_BIT) &&
+               imageExportable &&
+               (semaphoreProperties.externalSemaphoreFeatures & VK_EXTERNAL_SEMAPHORE_FEATURE_EXPORTABLE_BIT);
+    }
+
+    // VK_KHR_present_id + VK_KHR_present_wait requested by the application and supported by the device
+    inline bool isPresentWaitSupported() const
+    {
+        return isDeviceExtensionRequested(VK_KHR_PRESENT_ID_EXTENSION_NAME) &&
+               isDeviceExtensionRequested(VK_KHR_PRESENT_WAIT_EXTENSION_NAME) &&
+               _presentIdFeature.presentId == VK_TRUE && _presentWaitFeature.presentWait == VK_TRUE;
+    }
+
+    inline bool isHeadless() const
+    {
+        return _window == nullptr;
+    }
+
+    // what the rendering leaves the swapchain images in: presented, or read back when headless
+    inline VkImageLayout getSwapChainFinalLayout() const
+    {
+        return isHeadless() ? VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL : VK_IMAGE_LAYOUT_PRESENT_SRC_KHR;
+    }
+
+    inline ReadbackPool &getReadbackPool()
+    {
+        ASSERT(_readbackPool, "the readback pool is created by createSwapChain in headless mode");
+        return *_readbackPool;
+    }
+
     inline const auto &getSwapChainImages() const
     {
         return _swapChainImages;
@@ -460,10 +670,40 @@ public:
     // GPU-CPU SYNC
     std::vector<VkSemaphore> imageCanAcquireSemaphores;
     std::vector<VkSemaphore> imageRendereredSemaphores;
-    // 0, 1, 2, 0, 1, 2, ...
+    // 0, 1, 2, 0, 1, 2, ... up to LatencyConfig::framesInFlight
     uint32_t currentFrameId = 0;
 
 private:
+    inline bool isDeviceExtensionRequested(const char *extensionName) const
+    {
+        return std::find_if(_deviceExtensions.begin(), _deviceExtensions.end(), [extensionName](const char *extension)
+                            { return strcmp(extension, extensionName) == 0; }) != _deviceExtensions.end();
+    }
+
+    // headless: no VK_KHR_swapchain, and a software rasterizer (lavapipe) lacks some of the extensions
+    // requested for the desktop gpus: dropped with a warning instead of failing the device creation
+    void dropUnsupportedDeviceExtensions()
+    {
+        uint32_t extensionPropertyCount{0};
+        VK_CHECK(vkEnumerateDeviceExtensionProperties(_selectedPhysicalDevice, nullptr,
+                                                      &extensionPropertyCount, nullptr));
+        std::vector<VkExtensionProperties> extensionProperties(extensionPropertyCount);
+        VK_CHECK(vkEnumerateDeviceExtensionProperties(_selectedPhysicalDevice, nullptr,
+                                                      &extensionPropertyCount,
+                                                      extensionProperties.data()));
+        std::erase_if(_deviceExtensions, [&extensionProperties](const char *extensionName)
+                      {
+                          const bool supported = strcmp(extensionName, VK_KHR_SWAPCHAIN_EXTENSION_NAME) != 0 &&
+                                                 std::find_if(extensionProperties.begin(), extensionProperties.end(),
+                                                              [extensionName](const VkExtensionProperties &property)
+                                                              { return strcmp(property.extensionName, extensionName) == 0; }) != extensionProperties.end();
+                          if (!supported)
+                          {
+                              log(Level::Warn, "headless: device extension ", extensionName, " is not enabled");
+                          }
+                          return !supported; });
+    }
+
     void createInstance()
     {
         log(Level::Info, "createInstance");
@@ -481,11 +721,12 @@ private:
         }
 
         // SDL2 specific extension supported
+        if (!isHeadless())
         {
             unsigned int extensionCount = 0;
-            SDL_Vulkan_GetInstanceExtensions(_window.nativeHandle(), &extensionCount, nullptr);
+            SDL_Vulkan_GetInstanceExtensions(_window->nativeHandle(), &extensionCount, nullptr);
             std::vector<const char *> extensions(extensionCount);
-            SDL_Vulkan_GetInstanceExtensions(_window.nativeHandle(), &extensionCount, extensions.data());
+            SDL_Vulkan_GetInstanceExtensions(_window->nativeHandle(), &extensionCount, extensions.data());
             log(Level::Info, "SDL2 Found ", extensionCount, " available Instance Extension(s)");
             for (const auto &extension : extensions)
             {
@@ -659,6 +900,11 @@ private:
 
     void createSurface()
     {
+        // headless: nothing to present to
+        if (isHeadless())
+        {
+            return;
+        }
 #if defined(__ANDROID__)
         ASSERT(_osWindow, "_osWindow is needed to create os surface");
         const VkAndroidSurfaceCreateInfoKHR create_info{
@@ -674,8 +920,8 @@ private:
         // Caution:
         // The window must have been created with the SDL_WINDOW_VULKAN flag and instance must have been created
         // with extensions returned by SDL_Vulkan_GetInstanceExtensions() enabled.
-        ASSERT(_window.nativeHandle(), "SDL_window is needed to create os surface");
-        auto sdlWindow = _window.nativeHandle();
+        ASSERT(_window->nativeHandle(), "SDL_window is needed to create os surface");
+        auto sdlWindow = _window->nativeHandle();
         SDL_Vulkan_CreateSurface(sdlWindow, _instance, &_surface);
         ASSERT(_surface != VK_NULL_HANDLE, "Error creating SDL_Vulkan_CreateSurface");
 #endif
@@ -694,91 +940,69 @@ private:
                                                 physicalDevices.data()));
             log(Level::Info, "Found ", physicalDeviceCount, "Vulkan capable device(s)");
 
-            // select physical gpu
-            VkPhysicalDevice discrete_gpu = VK_NULL_HANDLE;
-            VkPhysicalDevice integrated_gpu = VK_NULL_HANDLE;
-
-            VkPhysicalDeviceProperties prop;
-            for (uint32_t i = 0; i < physicalDeviceCount; ++i)
+            // graphics or GPGPU family queue supporting the surface, headless: the first of them
+            const auto findPresentQueueFamily = [this](VkPhysicalDevice physicalDevice)
             {
-                VkPhysicalDevice physicalDevice = physicalDevices[i];
-                vkGetPhysicalDeviceProperties(physicalDevice, &prop);
+                uint32_t queueFamilyCount = 0;
+                vkGetPhysicalDeviceQueueFamilyProperties(physicalDevice, &queueFamilyCount,
+                                                         nullptr);
 
-                if (prop.deviceType == VK_PHYSICAL_DEVICE_TYPE_DISCRETE_GPU)
-                {
-                    uint32_t queueFamilyCount = 0;
-                    vkGetPhysicalDeviceQueueFamilyProperties(physicalDevice, &queueFamilyCount,
-                                                             nullptr);
-
-                    std::vector<VkQueueFamilyProperties> queueFamilies(queueFamilyCount);
-                    vkGetPhysicalDeviceQueueFamilyProperties(physicalDevice, &queueFamilyCount,
-                                                             queueFamilies.data());
+                std::vector<VkQueueFamilyProperties> queueFamilies(queueFamilyCount);
+                vkGetPhysicalDeviceQueueFamilyProperties(physicalDevice, &queueFamilyCount,
+                                                         queueFamilies.data());
 
-                    VkBool32 surfaceSupported;
-                    for (uint32_t familyIndex = 0; familyIndex < queueFamilyCount; ++familyIndex)
+                for (uint32_t familyIndex = 0; familyIndex < queueFamilyCount; ++familyIndex)
+                {
+                    const VkQueueFamilyProperties &queueFamilyProp = queueFamilies[familyIndex];
+                    if (queueFamilyProp.queueCount == 0 || !(queueFamilyProp.queueFlags &
+                                                             (VK_QUEUE_GRAPHICS_BIT |
+                                                              VK_QUEUE_COMPUTE_BIT)))
+                    {
+                        continue;
+                    }
+                    VkBool32 surfaceSupported = VK_TRUE;
+                    if (!isHeadless())
+                    {
+                        vkGetPhysicalDeviceSurfaceSupportKHR(
+                            physicalDevice,
+                            familyIndex,
+                            _surface,
+                            &surfaceSupported);
+                    }
+                    if (surfaceSupported)
                     {
-                        const VkQueueFamilyProperties &queueFamilyProp = queueFamilies[familyIndex];
-                        // graphics or GPGPU family queue
-                        if (queueFamilyProp.queueCount > 0 && (queueFamilyProp.queueFlags &
-                                                               (VK_QUEUE_GRAPHICS_BIT |
-                                                                VK_QUEUE_COMPUTE_BIT)))
-                        {
-                            vkGetPhysicalDeviceSurfaceSupportKHR(
-                                physicalDevice,
-                                familyIndex,
-                                _surface,
-                                &surfaceSupported);
-
-                            if (surfaceSupported)
-                            {
-                                _presentQueueFamilyIndex = familyIndex;
-                                discrete_gpu = physicalDevice;
-                                break;
-                            }
-                        }
+                        return familyIndex;
                     }
-                    continue;
                 }
+                return std::numeric_limits<uint32_t>::max();
+            };
 
-                if (prop.deviceType == VK_PHYSICAL_DEVICE_TYPE_INTEGRATED_GPU)
+            // select physical gpu: discrete, then integrated, then cpu (lavapipe: ci and machines without gpu)
+            constexpr std::array<VkPhysicalDeviceType, 3> preferredDeviceTypes{
+                VK_PHYSICAL_DEVICE_TYPE_DISCRETE_GPU,
+                VK_PHYSICAL_DEVICE_TYPE_INTEGRATED_GPU,
+                VK_PHYSICAL_DEVICE_TYPE_CPU,
+            };
+            VkPhysicalDeviceProperties prop;
+            for (const auto deviceType : preferredDeviceTypes)
+            {
+                for (uint32_t i = 0; i < physicalDeviceCount && !_selectedPhysicalDevice; ++i)
                 {
-                    uint32_t queueFamilyCount = 0;
-                    vkGetPhysicalDeviceQueueFamilyProperties(physicalDevice, &queueFamilyCount,
-                                                             nullptr);
-
-                    std::vector<VkQueueFamilyProperties> queueFamilies(queueFamilyCount);
-                    vkGetPhysicalDeviceQueueFamilyProperties(physicalDevice, &queueFamilyCount,
-                                                             queueFamilies.data());
-
-                    VkBool32 surfaceSupported;
-                    for (uint32_t familyIndex = 0; familyIndex < queueFamilyCount; ++familyIndex)
+                    VkPhysicalDevice physicalDevice = physicalDevices[i];
+                    vkGetPhysicalDeviceProperties(physicalDevice, &prop);
+                    if (prop.deviceType != deviceType)
                     {
-                        const VkQueueFamilyProperties &queueFamilyProp = queueFamilies[familyIndex];
-                        // graphics or GPGPU family queue
-                        if (queueFamilyProp.queueCount > 0 && (queueFamilyProp.queueFlags &
-                                                               (VK_QUEUE_GRAPHICS_BIT |
-                                                                VK_QUEUE_COMPUTE_BIT)))
-                        {
-                            vkGetPhysicalDeviceSurfaceSupportKHR(
-                                physicalDevice,
-                                familyIndex,
-                                _surface,
-                                &surfaceSupported);
-
-                            if (surfaceSupported)
-                            {
-                                _presentQueueFamilyIndex = familyIndex;
-                                integrated_gpu = physicalDevice;
-
-                                break;
-                            }
-                        }
+                        continue;
+                    }
+                    const auto familyIndex = findPresentQueueFamily(physicalDevice);
+                    if (familyIndex != std::numeric_limits<uint32_t>::max())
+                    {
+                        _selectedPhysicalDevice = physicalDevice;
+                        _presentQueueFamilyIndex = familyIndex;
                     }
-                    continue;
                 }
             }
 
-            _selectedPhysicalDevice = discrete_gpu ? discrete_gpu : integrated_gpu;
             ASSERT(_selectedPhysicalDevice, "No Vulkan Physical Devices found");
             ASSERT(_presentQueueFamilyIndex != std::numeric_limits<uint32_t>::max(),
                    "No Queue Family Index supporting surface found");
@@ -862,6 +1086,10 @@ private:
 
     void cacheSupportedSurfaceFormats()
     {
+        if (isHeadless())
+        {
+            return;
+        }
         uint32_t formatCount{0};
         vkGetPhysicalDeviceSurfaceFormatsKHR(_selectedPhysicalDevice, _surface, &formatCount, nullptr);
         _surfaceFormats.resize(formatCount);
@@ -937,6 +1165,7 @@ private:
     void createLogicDevice();
 
     void cacheCommandQueue();
+    void createQueueTimelines();
 
     void createVMA();
 
@@ -992,7 +1221,7 @@ private:
     }
 
     // vkGetPhysicalDeviceFeatures2 + linkedlist to fill in
-    inline bool checkRayTracingSupport()
+    inline bool checkRayTracingSupport() const
     {
         return (_accelStructFeature.accelerationStructure &&
                 _rayTracingFeature.rayTracingPipeline && _rayQueryFeature.rayQuery);
@@ -1007,10 +1236,13 @@ private:
     {
         return _fragmentDensityMapFeature.fragmentDensityMap == VK_TRUE;
     }
-    const WindowEntity &_window;
+    // nullptr: headless
+    const WindowEntity *_window{nullptr};
+    const HeadlessConfig _headlessConfig;
     const std::vector<const char *> _instanceValidationLayers;
     const std::set<std::string> &_instanceExtensions;
-    const std::vector<const char *> _deviceExtensions;
+    // headless: without the ones the device does not support
+    std::vector<const char *> _deviceExtensions;
 
     bool _enableValidationLayers{true};
 
@@ -1061,10 +1293,25 @@ private:
     // VkPhysicalDeviceRayQueryFeaturesKHR
     // nv specific
     // VkPhysicalDeviceMeshShaderFeaturesNV
+    VkPhysicalDevicePresentWaitFeaturesKHR _presentWaitFeature{
+        .sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_PRESENT_WAIT_FEATURES_KHR,
+        .pNext = nullptr,
+    };
+
+    VkPhysicalDevicePresentIdFeaturesKHR _presentIdFeature{
+        .sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_PRESENT_ID_FEATURES_KHR,
+        .pNext = &_presentWaitFeature,
+    };
+
+    VkPhysicalDeviceDescriptorBufferFeaturesEXT _descriptorBufferFeature{
+        .sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_DESCRIPTOR_BUFFER_FEATURES_EXT,
+        .pNext = &_presentIdFeature,
+    };
+
     VkPhysicalDeviceFragmentDensityMapOffsetFeaturesQCOM _fragmentDensityMapOffsetFeature{
         .sType =
             VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_FRAGMENT_DENSITY_MAP_OFFSET_FEATURES_QCOM,
-        .pNext = nullptr,
+        .pNext = &_descriptorBufferFeature,
     };
 
     VkPhysicalDeviceFragmentDensityMapFeaturesEXT _fragmentDensityMapFeature{
@@ -1130,8 +1377,26 @@ private:
     VkQueue _transferQueue{VK_NULL_HANDLE};
     VkQueue _presentationQueue{VK_NULL_HANDLE};
     VkQueue _sparseQueues{VK_NULL_HANDLE};
+    // keyed by queue: several semantic queues may alias the same VkQueue
+    std::unordered_map<VkQueue, std::unique_ptr<QueueTimeline>> _queueTimelines;
+    // last point each command buffer was submitted at, guards re-recording
+    std::mutex _cmdBufferTimelineMux;
+    std::unordered_map<VkCommandBuffer, TimelinePoint> _cmdBufferTimelinePoints;
 
     VmaAllocator _vmaAllocator{VK_NULL_HANDLE};
+    // VK_EXT_memory_budget was requested by the application
+    bool _memoryBudgetSupported{false};
+    std::unique_ptr<MemoryManager> _memoryManager;
+    std::unique_ptr<StagingRing> _stagingRing;
+
+    LatencyConfig _latencyConfig;
+    // present id chained to every present, vkWaitForPresentKHR on it
+    bool _presentWaitEnabled{false};
+    std::unique_ptr<FramePacer> _framePacer;
+    // set by getSwapChainImageIndexToRender, one rendered semaphore per swapchain image
+    uint32_t _acquiredImageIndex{0};
+    // gpu work of the last frame submitted by submitCommand
+    TimelinePoint _lastFrameTimelinePoint;
     // cached and pre-requisite for cuda-vulkan interop
     std::unordered_map<uint32_t, VmaPool> _vmaCustomMemoryPool;
 
@@ -1144,6 +1409,9 @@ private:
     std::vector<VkImageView> _swapChainImageViews;
     // fbo for swapchain
     std::vector<VkFramebuffer> _swapChainFramebuffers;
+    // headless: offscreen ring standing for the swapchain images, one per frame in flight
+    std::vector<ImageEntity> _offscreenImages;
+    std::unique_ptr<ReadbackPool> _readbackPool;
 
     // tracy context
     // so far these are only used for dedicated tracy only
@@ -1199,6 +1467,7 @@ void VkContext::Impl::selectFeatures()
     sEnable12Features.bufferDeviceAddressCaptureReplay = VK_TRUE;
     sEnable12Features.drawIndirectCount = VK_TRUE;
     sEnable12Features.shaderFloat16 = VK_TRUE;
+    sEnable12Features.timelineSemaphore = VK_TRUE;
     // dynamic rendering feature
     sEnable13Features.dynamicRendering = VK_TRUE;
     sEnable13Features.maintenance4 = VK_TRUE;
@@ -1211,7 +1480,8 @@ void VkContext::Impl::selectFeatures()
     _featureChain.push(sEnable12Features);
     _featureChain.push(sEnable13Features);
 
-    if (checkRayTracingSupport())
+    // the features of an extension not enabled are invalid in the chain
+    if (isRayTracingSupported())
     {
         sAccelStructFeatures.accelerationStructure = VK_TRUE;
         // https://registry.khronos.org/vulkan/specs/1.3-extensions/man/html/VkPhysicalDeviceAccelerationStructureFeaturesKHR.html
@@ -1238,6 +1508,20 @@ void VkContext::Impl::selectFeatures()
         sFragmentDensityMapFeatures.fragmentDensityMap = true;
         _featureChain.push(sFragmentDensityMapFeatures);
     }
+
+    if (isDescriptorBufferSupported())
+    {
+        sDescriptorBufferFeatures.descriptorBuffer = VK_TRUE;
+        _featureChain.push(sDescriptorBufferFeatures);
+    }
+
+    if (isPresentWaitSupported())
+    {
+        sPresentIdFeatures.presentId = VK_TRUE;
+        sPresentWaitFeatures.presentWait = VK_TRUE;
+        _featureChain.push(sPresentIdFeatures);
+        _featureChain.push(sPresentWaitFeatures);
+    }
     log(Level::Info, "<--selectFeatures");
 }
 
@@ -1341,6 +1625,18 @@ void VkContext::Impl::cacheCommandQueue()
     ASSERT(_sparseQueues, "Failed to access sparse queue");
 }
 
+void VkContext::Impl::createQueueTimelines()
+{
+    for (const auto queue : {_graphicsComputeQueue, _computeQueue, _transferQueue, _presentationQueue, _sparseQueues})
+    {
+        if (queue != VK_NULL_HANDLE && !_queueTimelines.contains(queue))
+        {
+            _queueTimelines.emplace(queue, std::make_unique<QueueTimeline>(_logicalDevice, queue));
+        }
+    }
+    log(Level::Info, "QueueTimeline: ", _queueTimelines.size(), " distinct queue(s)");
+}
+
 void VkContext::Impl::createCommandPool()
 {
     VkCommandPoolCreateInfo poolInfo{};
@@ -1396,34 +1692,35 @@ void VkContext::Impl::createVMA()
         .vkGetDeviceBufferMemoryRequirements = vkGetDeviceBufferMemoryRequirements,
         .vkGetDeviceImageMemoryRequirements = vkGetDeviceImageMemoryRequirements,
 #endif
-        // extra registeration for cuda interop
+        // extra registeration for cuda interop, vma has no fd counterpart: vkGetMemoryFdKHR on linux
         #ifdef _WIN64
                 .vkGetMemoryWin32HandleKHR = vkGetMemoryWin32HandleKHR,
         #endif
     };
 
-    // VmaAllocatorCreateInfo allocatorInfo = {};
-    // allocatorInfo.flags = VMA_ALLOCATOR_CREATE_BUFFER_DEVICE_ADDRESS_BIT;
-    // allocatorInfo.physicalDevice = _selectedPhysicalDevice;
-    // allocatorInfo.device = _logicalDevice;
-    // allocatorInfo.instance = _instance;
-    // allocatorInfo.pVulkanFunctions = &vulkanFunctions;
-
-    const VkDeviceSize HEAP_SIZE_LIMIT = 100ull * 1024 * 1024; // 100 MB
-    const VkDeviceSize BLOCK_SIZE = 10ull * 1024 * 1024;       // 10 MB
-
-    VkDeviceSize heapSizeLimit[VK_MAX_MEMORY_HEAPS];
-    for (uint32_t i = 0; i < VK_MAX_MEMORY_HEAPS; ++i)
-    {
-        heapSizeLimit[i] = HEAP_SIZE_LIMIT;
-    }
+    // real usage/budget of the heaps (other processes included) instead of the vma estimate
+    _memoryBudgetSupported = std::find_if(_deviceExtensions.begin(), _deviceExtensions.end(), [](const char *extension)
+                                          { return strcmp(extension, VK_EXT_MEMORY_BUDGET_EXTENSION_NAME) == 0; }) != _deviceExtensions.end();
 
     VmaAllocatorCreateInfo allocatorInfo = {};
     allocatorInfo.flags = VMA_ALLOCATOR_CREATE_BUFFER_DEVICE_ADDRESS_BIT;
+    if (_memoryBudgetSupported)
+    {
+        allocatorInfo.flags |= VMA_ALLOCATOR_CREATE_EXT_MEMORY_BUDGET_BIT;
+    }
     allocatorInfo.physicalDevice = _selectedPhysicalDevice;
     allocatorInfo.device = _logicalDevice;
     allocatorInfo.instance = _instance;
-    // allocatorInfo.pHeapSizeLimit = nullptr;
+#ifdef VK_HEAP_SIZE_LIMIT_MB
+    // a small gpu on a big one: the budgets (and the eviction) kick in early
+    const VkDeviceSize HEAP_SIZE_LIMIT = VK_HEAP_SIZE_LIMIT_MB * 1024ull * 1024;
+    VkDeviceSize heapSizeLimit[VK_MAX_MEMORY_HEAPS];
+    for (uint32_t i = 0; i < VK_MAX_MEMORY_HEAPS; ++i)
+    {
+        heapSizeLimit[i] = HEAP_SIZE_LIMIT;
+    }
+    allocatorInfo.pHeapSizeLimit = heapSizeLimit;
+#endif
     allocatorInfo.pVulkanFunctions = &vulkanFunctions;
     vmaCreateAllocator(&allocatorInfo, &_vmaAllocator);
     ASSERT(_vmaAllocator, "Failed to create vma allocator");
@@ -1456,10 +1753,28 @@ void VkContext::Impl::createSwapChain()
 
     std::array<uint32_t, 2> familyIndices{graphicsComputeQueueFamilyIndex,
                                           presentQueueFamilyIndex};
-    const uint32_t swapChainImageCount =
-        std::clamp(surfaceCapabilities.minImageCount + 1,
-                   surfaceCapabilities.minImageCount,
-                   surfaceCapabilities.maxImageCount);
+    // VK_PRESENT_MODE_FIFO_KHR always supported
+    uint32_t presentModeCount{0};
+    VK_CHECK(vkGetPhysicalDeviceSurfacePresentModesKHR(selectedPhysicalDevice, surfaceKHR, &presentModeCount, nullptr));
+    std::vector<VkPresentModeKHR> presentModes(presentModeCount);
+    VK_CHECK(vkGetPhysicalDeviceSurfacePresentModesKHR(selectedPhysicalDevice, surfaceKHR, &presentModeCount, presentModes.data()));
+    VkPresentModeKHR presentMode = _latencyConfig.presentMode;
+    if (std::find(presentModes.begin(), presentModes.end(), presentMode) == presentModes.end())
+    {
+        log(Level::Warn, "present mode ", presentMode, " is not supported, fallback to fifo");
+        presentMode = VK_PRESENT_MODE_FIFO_KHR;
+    }
+
+    // one image more than the minimum: the acquire does not wait on the display
+    // except fifo with a single frame in flight, the shortest queue to the display
+    // maxImageCount 0: no limit
+    const bool shortestQueue = presentMode == VK_PRESENT_MODE_FIFO_KHR && _latencyConfig.framesInFlight == 1;
+    uint32_t swapChainImageCount = (std::max)(surfaceCapabilities.minImageCount + (shortestQueue ? 0 : 1),
+                                              _latencyConfig.framesInFlight);
+    if (surfaceCapabilities.maxImageCount > 0)
+    {
+        swapChainImageCount = (std::min)(swapChainImageCount, surfaceCapabilities.maxImageCount);
+    }
     VkSurfaceTransformFlagBitsKHR pretransformFlag;
 
     uint32_t width = surfaceCapabilities.currentExtent.width;
@@ -1479,6 +1794,7 @@ void VkContext::Impl::createSwapChain()
     log(Level::Info, "w: ", _swapChainExtent.width);
     log(Level::Info, "h: ", _swapChainExtent.height);
     log(Level::Info, "swapChainImageCount: ", swapChainImageCount);
+    log(Level::Info, "presentMode: ", presentMode);
 
     VkSwapchainCreateInfoKHR swapchain = {};
     swapchain.sType = VK_STRUCTURE_TYPE_SWAPCHAIN_CREATE_INFO_KHR;
@@ -1500,10 +1816,11 @@ void VkContext::Impl::createSwapChain()
     // ignore alpha completely
     // not supported: VK_COMPOSITE_ALPHA_OPAQUE_BIT_KHR for this default swapchain surface
     swapchain.compositeAlpha = VK_COMPOSITE_ALPHA_OPAQUE_BIT_KHR;
-    // VK_PRESENT_MODE_FIFO_KHR always supported
     // VK_PRESENT_MODE_FIFO_KHR = Hard Vsync
     // This is always supported on Android phones
-    swapchain.presentMode = VK_PRESENT_MODE_FIFO_KHR;
+    // VK_PRESENT_MODE_MAILBOX_KHR: vsync, the newest frame replaces the queued one
+    // VK_PRESENT_MODE_IMMEDIATE_KHR: no vsync, tearing
+    swapchain.presentMode = presentMode;
     swapchain.oldSwapchain = VK_NULL_HANDLE;
     VK_CHECK(vkCreateSwapchainKHR(logicalDevice, &swapchain, nullptr, &_swapChain));
     setCorrlationId(_swapChain, logicalDevice, VK_OBJECT_TYPE_SWAPCHAIN_KHR, "Swapchain");
@@ -1549,24 +1866,111 @@ void VkContext::Impl::createSwapChainImageView()
     }
 }
 
+void VkContext::Impl::createOffscreenImages()
+{
+    log(Level::Info, "-->createOffscreenImages");
+    _swapChainFormat = _headlessConfig.format;
+    _swapChainExtent = {_headlessConfig.width, _headlessConfig.height};
+    // one image per frame in flight: the frame slot is the image index, nothing to acquire
+    const auto numImages = getFramesInFlight();
+    log(Level::Info, "w: ", _swapChainExtent.width);
+    log(Level::Info, "h: ", _swapChainExtent.height);
+    log(Level::Info, "offscreenImageCount: ", numImages);
+    for (uint32_t i = 0; i < numImages; ++i)
+    {
+        // same usage as the swapchain images, plus the copy out
+        const auto name = "Offscreen image: " + std::to_string(i);
+        const auto offscreenImage = createImage(
+            name,
+            VK_IMAGE_TYPE_2D,
+            _swapChainFormat,
+            VkExtent3D{_swapChainExtent.width, _swapChainExtent.height, 1},
+            1,
+            1,
+            VK_SAMPLE_COUNT_1_BIT,
+            VK_IMAGE_USAGE_COLOR_ATTACHMENT_BIT | VK_IMAGE_USAGE_TRANSFER_DST_BIT | VK_IMAGE_USAGE_TRANSFER_SRC_BIT,
+            VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT,
+            false);
+        _offscreenImages.push_back(offscreenImage);
+        _swapChainImages.push_back(std::get<IMAGE_ENTITY_OFFSET::IMAGE>(offscreenImage));
+        _swapChainImageViews.push_back(std::get<IMAGE_ENTITY_OFFSET::IMAGE_VIEW>(offscreenImage));
+        setCorrlationId(_swapChainImages.back(), _logicalDevice, VK_OBJECT_TYPE_IMAGE, name);
+        setCorrlationId(_swapChainImageViews.back(), _logicalDevice, VK_OBJECT_TYPE_IMAGE_VIEW,
+                        "Offscreen Image view: " + std::to_string(i));
+    }
+    // same queue as the rendering: the copies are ordered after it
+    _readbackPool = std::make_unique<ReadbackPool>(
+        _logicalDevice,
+        _vmaAllocator,
+        getQueueTimeline(_graphicsComputeQueue),
+        _graphicsComputeQueueFamilyIndex,
+        numImages,
+        _swapChainExtent,
+        _swapChainFormat);
+    log(Level::Info, "<--createOffscreenImages");
+}
+
 void VkContext::Impl::createPerFrameSyncObjects()
 {
-    const auto numFramesInFlight = getSwapChainImageViews().size();
+    // headless: nothing is acquired nor presented, the copies are ordered on the graphics queue
+    if (isHeadless())
+    {
+        return;
+    }
+    // acquire: per frame in flight, rendered: per swapchain image, the present of an image
+    // is done before it is acquired again, not before the frame id comes around again
+    const auto numFramesInFlight = getFramesInFlight();
+    const auto numSwapChainImages = getSwapChainImageViews().size();
     imageCanAcquireSemaphores.resize(numFramesInFlight);
-    imageRendereredSemaphores.resize(numFramesInFlight);
+    imageRendereredSemaphores.resize(numSwapChainImages);
 
     VkSemaphoreCreateInfo semaphoreInfo{};
     semaphoreInfo.sType = VK_STRUCTURE_TYPE_SEMAPHORE_CREATE_INFO;
 
-    for (size_t i = 0; i < MAX_FRAMES_IN_FLIGHT; ++i)
+    for (size_t i = 0; i < numFramesInFlight; ++i)
     {
         VK_CHECK(vkCreateSemaphore(_logicalDevice, &semaphoreInfo, nullptr,
                                    &imageCanAcquireSemaphores[i]));
+    }
+    for (size_t i = 0; i < numSwapChainImages; ++i)
+    {
         VK_CHECK(vkCreateSemaphore(_logicalDevice, &semaphoreInfo, nullptr,
                                    &imageRendereredSemaphores[i]));
     }
 }
 
+void VkContext::Impl::setLatencyConfig(const LatencyConfig &config)
+{
+    ASSERT(_swapChainImages.empty(), "setLatencyConfig:: before createSwapChain");
+    ASSERT(config.framesInFlight >= 1 && config.framesInFlight <= MAX_FRAMES_IN_FLIGHT,
+           "setLatencyConfig:: framesInFlight should be in [1, MAX_FRAMES_IN_FLIGHT]");
+    _latencyConfig = config;
+}
+
+void VkContext::Impl::createFramePacer()
+{
+    _presentWaitEnabled = _latencyConfig.pacing && !isHeadless() && isPresentWaitSupported();
+    if (_latencyConfig.pacing && !_presentWaitEnabled)
+    {
+        log(Level::Warn, "VK_KHR_present_wait is not available, frames are paced on their gpu completion");
+    }
+    // present wait: on screen, otherwise: the gpu work of the frame is done (headless: its readback)
+    _framePacer = std::make_unique<FramePacer>(
+        _latencyConfig.framesInFlight,
+        _latencyConfig.pacing,
+        [this](uint64_t presentId, const TimelinePoint &gpuDone, uint64_t timeoutInNs)
+        {
+            if (_presentWaitEnabled)
+            {
+                const auto result = vkWaitForPresentKHR(_logicalDevice, _swapChain, presentId, timeoutInNs);
+                // out of date/surface lost: the frame will never be shown, do not wait on it again
+                return result != VK_TIMEOUT;
+            }
+            return gpuDone.semaphore == VK_NULL_HANDLE ||
+                   waitTimelinePoints(_logicalDevice, {gpuDone}, timeoutInNs);
+        });
+}
+
 VkRenderPass VkContext::Impl::createSwapChainRenderPass()
 {
     log(Level::Info, "-->createSwapChainRenderPass");
@@ -1585,8 +1989,8 @@ VkRenderPass VkContext::Impl::createSwapChainRenderPass()
     colorAttachment.stencilLoadOp = VK_ATTACHMENT_LOAD_OP_DONT_CARE;
     colorAttachment.stencilStoreOp = VK_ATTACHMENT_STORE_OP_DONT_CARE;
     colorAttachment.initialLayout = VK_IMAGE_LAYOUT_UNDEFINED;
-    // swap chain is for presentation
-    colorAttachment.finalLayout = VK_IMAGE_LAYOUT_PRESENT_SRC_KHR;
+    // swap chain is for presentation, headless: read back
+    colorAttachment.finalLayout = getSwapChainFinalLayout();
 
     // VkAttachmentReference is for subpass, how subpass could refer to the color attachment
     // here only 1 color attachement, index is 0;
@@ -1747,26 +2151,32 @@ std::vector<CommandBufferEntity> VkContext::Impl::createCommandBuffers(
 
     std::vector<CommandBufferEntity> res;
 
+    std::vector<VkCommandPool> commandPools;
     std::vector<VkCommandBuffer> commandBuffers;
     std::vector<VkFence> inFlightFences;
 
-    VkCommandPool commandPool{VK_NULL_HANDLE};
+    // one pool per command buffer (per frame in flight): BeginRecordCommandBuffer resets the whole pool,
+    // cheaper than VK_COMMAND_POOL_CREATE_RESET_COMMAND_BUFFER_BIT + vkResetCommandBuffer
+    // transient: re-recorded every time
     VkCommandPoolCreateInfo poolInfo{};
     poolInfo.sType = VK_STRUCTURE_TYPE_COMMAND_POOL_CREATE_INFO;
-    // VK_COMMAND_POOL_CREATE_RESET_COMMAND_BUFFER_BIT
-    // since we want to record a command buffer every frame, so we want to be able to
-    // reset and record over it
-    poolInfo.flags = VK_COMMAND_POOL_CREATE_RESET_COMMAND_BUFFER_BIT;
+    poolInfo.flags = VK_COMMAND_POOL_CREATE_TRANSIENT_BIT;
     poolInfo.queueFamilyIndex = queueFamilyIndex;
-    VK_CHECK(vkCreateCommandPool(_logicalDevice, &poolInfo, nullptr, &commandPool));
 
-    commandBuffers.resize(count);
-    VkCommandBufferAllocateInfo allocInfo{};
-    allocInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO;
-    allocInfo.commandPool = commandPool;
-    allocInfo.level = VK_COMMAND_BUFFER_LEVEL_PRIMARY;
-    allocInfo.commandBufferCount = commandBuffers.size();
-    VK_CHECK(vkAllocateCommandBuffers(_logicalDevice, &allocInfo, commandBuffers.data()));
+    commandPools.resize(count, VK_NULL_HANDLE);
+    commandBuffers.resize(count, VK_NULL_HANDLE);
+    for (size_t i = 0; i < count; ++i)
+    {
+        VK_CHECK(vkCreateCommandPool(_logicalDevice, &poolInfo, nullptr, &commandPools[i]));
+        setCorrlationId(commandPools[i], _logicalDevice, VK_OBJECT_TYPE_COMMAND_POOL, name + " " + std::to_string(i));
+
+        VkCommandBufferAllocateInfo allocInfo{};
+        allocInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO;
+        allocInfo.commandPool = commandPools[i];
+        allocInfo.level = VK_COMMAND_BUFFER_LEVEL_PRIMARY;
+        allocInfo.commandBufferCount = 1;
+        VK_CHECK(vkAllocateCommandBuffers(_logicalDevice, &allocInfo, &commandBuffers[i]));
+    }
 
     inFlightFences.resize(count, VK_NULL_HANDLE);
     VkFenceCreateInfo fenceInfo{};
@@ -1781,20 +2191,35 @@ std::vector<CommandBufferEntity> VkContext::Impl::createCommandBuffers(
     res.reserve(count);
     for (size_t i = 0; i < count; ++i)
     {
-        res.emplace_back(std::make_tuple(commandPool, commandBuffers[i], inFlightFences[i], queueFamilyIndex, queue));
+        res.emplace_back(std::make_tuple(commandPools[i], commandBuffers[i], inFlightFences[i], queueFamilyIndex, queue));
     }
     return res;
 }
 
 void VkContext::Impl::BeginRecordCommandBuffer(CommandBufferEntity &cmdBufferEntity)
 {
+    const auto cmdPoolHandle = std::get<0>(cmdBufferEntity);
     const auto cmdBufferHandle = std::get<1>(cmdBufferEntity);
     const auto fenceHandle = std::get<2>(cmdBufferEntity);
 
+    // submitted through a timeline: wait for that point
+    std::optional<TimelinePoint> lastSubmit;
+    {
+        std::scoped_lock lock{_cmdBufferTimelineMux};
+        if (const auto it = _cmdBufferTimelinePoints.find(cmdBufferHandle); it != _cmdBufferTimelinePoints.end())
+        {
+            lastSubmit = it->second;
+        }
+    }
+    if (lastSubmit.has_value())
+    {
+        waitTimelinePoints(_logicalDevice, {*lastSubmit});
+    }
+    // submitted the legacy way: the fence is still signaled otherwise
     if (fenceHandle)
-        VK_CHECK(vkWaitForFences(_logicalDevice, 1, &fenceHandle, true, UINT32_MAX));
-    // specifies that most or all memory resources currently owned by the command buffer should be returned to the parent command pool
-    VK_CHECK(vkResetCommandBuffer(cmdBufferHandle, VK_COMMAND_BUFFER_RESET_RELEASE_RESOURCES_BIT));
+        VK_CHECK(vkWaitForFences(_logicalDevice, 1, &fenceHandle, true, UINT64_MAX));
+    // the pool owns this command buffer only: one reset per frame, the memory is kept for the next recording
+    VK_CHECK(vkResetCommandPool(_logicalDevice, cmdPoolHandle, 0));
 
     VkCommandBufferBeginInfo cmdBufferBeginInfo{};
     cmdBufferBeginInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO;
@@ -1843,7 +2268,8 @@ BufferEntity VkContext::Impl::createBuffer(
     VkMemoryPropertyFlags requiredMemoryProperties,
     VkMemoryPropertyFlags preferredMemoryProperties,
     VmaMemoryUsage memoryUsage,
-    bool mapping)
+    bool mapping,
+    MEMORY_CATEGORY category)
 {
     VkBuffer buffer{VK_NULL_HANDLE};
     VmaAllocation allocation{VK_NULL_HANDLE};
@@ -1862,12 +2288,14 @@ BufferEntity VkContext::Impl::createBuffer(
     // VK_MEMORY_PROPERTY_HOST_CACHED_BIT,
     // VMA_MEMORY_USAGE_GPU_ONLY);
 
-    const VmaAllocationCreateInfo bufferMemoryAllocationCreateInfo = {
+    VmaAllocationCreateInfo bufferMemoryAllocationCreateInfo = {
         .flags = memoryAllocationFlag,
         .usage = memoryUsage,
         .requiredFlags = requiredMemoryProperties,
         .preferredFlags = preferredMemoryProperties,
     };
+    // VK_NULL_HANDLE for generic: default vma heaps
+    bufferMemoryAllocationCreateInfo.pool = _memoryManager->findPool(category, bufferCreateInfo, bufferMemoryAllocationCreateInfo);
 
     // const VmaAllocationCreateInfo allocCreateInfo = {
     //     .flags = VMA_ALLOCATION_CREATE_DEDICATED_MEMORY_BIT,
@@ -1899,7 +2327,6 @@ BufferEntity VkContext::Impl::createBuffer(
     }
 }
 
-#ifdef _WIN64
 BufferEntity VkContext::Impl::createExportableBuffer(
     const std::string &name,
     VkDeviceSize bufferSizeInBytes,
@@ -1910,17 +2337,12 @@ BufferEntity VkContext::Impl::createExportableBuffer(
     constexpr static VkExportMemoryAllocateInfoKHR exportMemAllocInfo{
         VK_STRUCTURE_TYPE_EXPORT_MEMORY_ALLOCATE_INFO_KHR,
         nullptr,
-        VK_EXTERNAL_MEMORY_HANDLE_TYPE_OPAQUE_WIN32_BIT};
+        EXTERNAL_MEMORY_HANDLE_TYPE};
 
     constexpr static VkExternalMemoryBufferCreateInfoKHR externalMemBufCreateInfo{
         VK_STRUCTURE_TYPE_EXTERNAL_MEMORY_BUFFER_CREATE_INFO_KHR,
         nullptr,
-#ifdef _WIN64
-        VK_EXTERNAL_MEMORY_HANDLE_TYPE_OPAQUE_WIN32_BIT
-#else
-        VK_EXTERNAL_MEMORY_HANDLE_TYPE_OPAQUE_FD_BIT_KHR
-#endif
-    };
+        EXTERNAL_MEMORY_HANDLE_TYPE};
 
     VkBuffer buffer{VK_NULL_HANDLE};
     VmaAllocation allocation{VK_NULL_HANDLE};
@@ -1933,7 +2355,9 @@ BufferEntity VkContext::Impl::createExportableBuffer(
     };
     bufferCreateInfo.pNext = &externalMemBufCreateInfo;
 
+    // dedicated: the importer maps the whole VkDeviceMemory, the buffer at offset 0
     VmaAllocationCreateInfo bufferMemoryAllocationCreateInfo = {
+        .flags = VMA_ALLOCATION_CREATE_DEDICATED_MEMORY_BIT,
         .usage = VMA_MEMORY_USAGE_AUTO,
     };
 
@@ -1960,8 +2384,20 @@ BufferEntity VkContext::Impl::createExportableBuffer(
                              &buffer,
                              &allocation, nullptr));
 
+    vmaGetAllocationInfo(_vmaAllocator, allocation, &allocationInfo);
+#ifdef _WIN64
     HANDLE handle = NULL;
     VK_CHECK(vmaGetMemoryWin32Handle(_vmaAllocator, allocation, nullptr, &handle));
+#else
+    const VkMemoryGetFdInfoKHR getFdInfo{
+        .sType = VK_STRUCTURE_TYPE_MEMORY_GET_FD_INFO_KHR,
+        .memory = allocationInfo.deviceMemory,
+        .handleType = EXTERNAL_MEMORY_HANDLE_TYPE,
+    };
+    int fd{-1};
+    VK_CHECK(vkGetMemoryFdKHR(_logicalDevice, &getFdInfo, &fd));
+    void *handle = reinterpret_cast<void *>(static_cast<intptr_t>(fd));
+#endif
 
     VkBufferDeviceAddressInfoKHR bufferDeviceAI{};
     bufferDeviceAI.sType = VK_STRUCTURE_TYPE_BUFFER_DEVICE_ADDRESS_INFO;
@@ -1969,7 +2405,6 @@ BufferEntity VkContext::Impl::createExportableBuffer(
     VkDeviceOrHostAddressConstKHR da{
         .deviceAddress = vkGetBufferDeviceAddressKHR(_logicalDevice, &bufferDeviceAI),
     };
-    vmaGetAllocationInfo(_vmaAllocator, allocation, &allocationInfo);
     // bufferMemoryAllocationCreateInfo does not have config to allow map
     return std::make_tuple(buffer, allocation, allocationInfo, nullptr, bufferSizeInBytes, da, handle);
     // if (!mapping)
@@ -1981,7 +2416,27 @@ BufferEntity VkContext::Impl::createExportableBuffer(
     //     return std::make_tuple(buffer, allocation, allocationInfo, address, bufferSizeInBytes, da, handle);
     // }
 }
-#endif
+
+VkSemaphore VkContext::Impl::createExportableSemaphore(VkSemaphoreType type, uint64_t initialValue)
+{
+    VkSemaphoreTypeCreateInfo semaphoreTypeInfo{
+        .sType = VK_STRUCTURE_TYPE_SEMAPHORE_TYPE_CREATE_INFO,
+        .semaphoreType = type,
+        .initialValue = type == VK_SEMAPHORE_TYPE_TIMELINE ? initialValue : 0,
+    };
+    VkExportSemaphoreCreateInfo exportSemaphoreInfo{
+        .sType = VK_STRUCTURE_TYPE_EXPORT_SEMAPHORE_CREATE_INFO,
+        .pNext = &semaphoreTypeInfo,
+        .handleTypes = EXTERNAL_SEMAPHORE_HANDLE_TYPE,
+    };
+    const VkSemaphoreCreateInfo semaphoreInfo{
+        .sType = VK_STRUCTURE_TYPE_SEMAPHORE_CREATE_INFO,
+        .pNext = &exportSemaphoreInfo,
+    };
+    VkSemaphore semaphore{VK_NULL_HANDLE};
+    VK_CHECK(vkCreateSemaphore(_logicalDevice, &semaphoreInfo, nullptr, &semaphore));
+    return semaphore;
+}
 
 BufferEntity VkContext::Impl::createPersistentBuffer(
     const std::string &name,
@@ -2007,10 +2462,11 @@ BufferEntity VkContext::Impl::createPersistentBuffer(
         //     VK_MEMORY_PROPERTY_HOST_COHERENT_BIT |
         //     VK_MEMORY_PROPERTY_HOST_CACHED_BIT,
         VMA_MEMORY_USAGE_CPU_TO_GPU,
-        mapping);
+        mapping,
+        DYNAMIC_MEMORY);
 }
 
-BufferEntity VkContext::Impl::createStagingBuffer(const std::string &name, VkDeviceSize bufferSizeInBytes)
+BufferEntity VkContext::Impl::createStagingBuffer(const std::string &name, VkDeviceSize bufferSizeInBytes, MEMORY_CATEGORY category)
 {
     // VMA_MEMORY_USAGE_CPU_ONLY is obosolete
     return createBuffer(
@@ -2024,13 +2480,16 @@ BufferEntity VkContext::Impl::createStagingBuffer(const std::string &name, VkDev
             VK_MEMORY_PROPERTY_HOST_COHERENT_BIT,
         VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT |
             VK_MEMORY_PROPERTY_HOST_COHERENT_BIT,
-        VMA_MEMORY_USAGE_AUTO_PREFER_HOST);
+        VMA_MEMORY_USAGE_AUTO_PREFER_HOST,
+        false,
+        category);
 }
 
 BufferEntity VkContext::Impl::createDeviceLocalBuffer(
     const std::string &name,
     VkDeviceSize bufferSizeInBytes,
-    VkBufferUsageFlags bufferUsageFlag)
+    VkBufferUsageFlags bufferUsageFlag,
+    MEMORY_CATEGORY category)
 {
     // VMA_MEMORY_USAGE_GPU_ONLY is deprecated
     return createBuffer(
@@ -2041,7 +2500,9 @@ BufferEntity VkContext::Impl::createDeviceLocalBuffer(
         VMA_ALLOCATION_CREATE_HOST_ACCESS_RANDOM_BIT | VMA_ALLOCATION_CREATE_MAPPED_BIT,
         VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT,
         VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT,
-        VMA_MEMORY_USAGE_AUTO_PREFER_DEVICE);
+        VMA_MEMORY_USAGE_AUTO_PREFER_DEVICE,
+        false,
+        category);
 }
 
 std::tuple<BufferEntity, VkStridedDeviceAddressRegionKHR> VkContext::Impl::createShaderBindTableBuffer(
@@ -2086,7 +2547,8 @@ ImageEntity VkContext::Impl::createImage(
     VkSampleCountFlagBits textureMultiSampleCount,
     VkImageUsageFlags usage,
     VkMemoryPropertyFlags memoryFlags,
-    bool generateMips)
+    bool generateMips,
+    MEMORY_CATEGORY category)
 {
     if (generateMips)
     {
@@ -2111,13 +2573,15 @@ ImageEntity VkContext::Impl::createImage(
     // Consider creating them as dedicated allocations using VMA_ALLOCATION_CREATE_DEDICATED_MEMORY_BIT, especially if they are large or if you plan to destroy and recreate them with different sizes
     // e.g. when display resolution changes.
 
-    const VmaAllocationCreateInfo allocCreateInfo = {
-        .flags = VMA_ALLOCATION_CREATE_DEDICATED_MEMORY_BIT,
+    // pooled images share blocks: no dedicated memory, or they could not be defragmented
+    VmaAllocationCreateInfo allocCreateInfo = {
+        .flags = category == GENERIC_MEMORY ? VMA_ALLOCATION_CREATE_DEDICATED_MEMORY_BIT : VmaAllocationCreateFlags{0},
         .usage = memoryFlags & VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT
                      ? VMA_MEMORY_USAGE_AUTO_PREFER_HOST
                      : VMA_MEMORY_USAGE_AUTO_PREFER_DEVICE,
         .priority = 1.0f,
     };
+    allocCreateInfo.pool = _memoryManager->findPool(category, imageCreateInfo, allocCreateInfo);
 
     VkImage image;
     VmaAllocation imageAllocation;
@@ -2143,11 +2607,10 @@ ImageEntity VkContext::Impl::createImage(
     VK_CHECK(vkCreateImageView(_logicalDevice, &imageViewInfo, nullptr, &imageView));
 
     return std::make_tuple(image, imageView, imageAllocation, imageAllocationInfo, textureMipLevelCount,
-                           extent, format);
+                           extent, format, textureLayersCount);
 }
 
-#ifdef _WIN64
-void VkContext::Impl::createExportableImage(
+ImageEntity VkContext::Impl::createExportableImage(
     const std::string &name,
     VkImageType imageType,
     VkFormat format,
@@ -2160,17 +2623,12 @@ void VkContext::Impl::createExportableImage(
     constexpr static VkExportMemoryAllocateInfoKHR exportMemAllocInfo{
         VK_STRUCTURE_TYPE_EXPORT_MEMORY_ALLOCATE_INFO_KHR,
         nullptr,
-        VK_EXTERNAL_MEMORY_HANDLE_TYPE_OPAQUE_WIN32_BIT};
+        EXTERNAL_MEMORY_HANDLE_TYPE};
 
     constexpr static VkExternalMemoryImageCreateInfo vkExternalMemImageCreateInfo = {
         VK_STRUCTURE_TYPE_EXTERNAL_MEMORY_IMAGE_CREATE_INFO,
         nullptr,
-#ifdef _WIN64
-        VK_EXTERNAL_MEMORY_HANDLE_TYPE_OPAQUE_WIN32_BIT
-#else
-        VK_EXTERNAL_MEMORY_HANDLE_TYPE_OPAQUE_FD_BIT_KHR
-#endif
-    };
+        EXTERNAL_MEMORY_HANDLE_TYPE};
 
     // igonore mipmap to begin with
     VkImageCreateInfo imageCreateInfo{};
@@ -2187,7 +2645,9 @@ void VkContext::Impl::createExportableImage(
     imageCreateInfo.extent = extent;
     imageCreateInfo.pNext = &vkExternalMemImageCreateInfo;
 
+    // dedicated: the importer maps the whole VkDeviceMemory, the image at offset 0
     VmaAllocationCreateInfo imageMemoryAllocationCreateInfo = {
+        .flags = VMA_ALLOCATION_CREATE_DEDICATED_MEMORY_BIT,
         .usage = VMA_MEMORY_USAGE_AUTO,
     };
 
@@ -2215,9 +2675,6 @@ void VkContext::Impl::createExportableImage(
     VkImageView imageView;
     VK_CHECK(vmaCreateImage(_vmaAllocator, &imageCreateInfo, &imageMemoryAllocationCreateInfo, &image,
                             &imageAllocation, nullptr));
-
-    HANDLE handle = NULL;
-    VK_CHECK(vmaGetMemoryWin32Handle(_vmaAllocator, imageAllocation, nullptr, &handle));
     vmaGetAllocationInfo(_vmaAllocator, imageAllocation, &imageAllocationInfo);
 
     // image view
@@ -2233,8 +2690,10 @@ void VkContext::Impl::createExportableImage(
     imageViewInfo.subresourceRange.levelCount = textureMipLevelCount;
     imageViewInfo.image = image;
     VK_CHECK(vkCreateImageView(_logicalDevice, &imageViewInfo, nullptr, &imageView));
+
+    return std::make_tuple(image, imageView, imageAllocation, imageAllocationInfo, textureMipLevelCount,
+                           extent, format, 1u);
 }
-#endif
 
 std::tuple<VkSampler> VkContext::Impl::createSampler(const std::string &name)
 {
@@ -2746,6 +3205,18 @@ void VkContext::Impl::bindSamplerToDescriptorSet(
     vkUpdateDescriptorSets(_logicalDevice, 1, &bindResToDsPayload, 0, nullptr);
 }
 
+// staging buffers are created with VMA_ALLOCATION_CREATE_MAPPED_BIT, other host buffers by createBuffer(mapping = true)
+static void *getStagingMappedAddress(const BufferEntity &stagingBuffer)
+{
+    void *address = std::get<BUFFER_ENTITY_UID::VMA_ALLOCATION_INFO>(stagingBuffer).pMappedData;
+    if (!address)
+    {
+        address = std::get<BUFFER_ENTITY_UID::MAPPING_ADDRESS>(stagingBuffer);
+    }
+    ASSERT(address, "staging buffer must be persistently mapped");
+    return address;
+}
+
 void VkContext::Impl::writeBuffer(
     const BufferEntity &stagingBuffer,
     const BufferEntity &deviceLocalBuffer,
@@ -2754,21 +3225,26 @@ void VkContext::Impl::writeBuffer(
     uint32_t sizeInBytes,
     uint32_t srcOffset,
     uint32_t dstOffset)
+{
+    // staging buffers are persistently mapped (VMA_ALLOCATION_CREATE_MAPPED_BIT): no map/unmap per write
+    // the data goes where the copy reads it from
+    auto *mappedMemory = static_cast<uint8_t *>(getStagingMappedAddress(stagingBuffer));
+    memcpy(mappedMemory + srcOffset, rawData, sizeInBytes);
+    // cmd to copy from staging to device
+    copyBuffer(stagingBuffer, deviceLocalBuffer, cmdBuffer, sizeInBytes, srcOffset, dstOffset);
+}
+
+void VkContext::Impl::copyBuffer(
+    const BufferEntity &stagingBuffer,
+    const BufferEntity &deviceLocalBuffer,
+    const CommandBufferEntity &cmdBuffer,
+    uint32_t sizeInBytes,
+    uint32_t srcOffset,
+    uint32_t dstOffset)
 {
     const auto stagingBufferHandle = std::get<0>(stagingBuffer);
     const auto deviceLocalBufferHandle = std::get<0>(deviceLocalBuffer);
-    // https://gpuopen-librariesandsdks.github.io/VulkanMemoryAllocator/html/general_considerations.html
-    // vmaStagingImageBufferAllocation is not thread-safe
-    const auto vmaStagingImageBufferAllocation = std::get<1>(stagingBuffer);
     const auto cmdBufferHandle = std::get<1>(cmdBuffer);
-
-    // copy vb from host to device, region
-    void *mappedMemory{nullptr};
-    // log(Level::Info, "vmaMapMemory:", std::this_thread::get_id());
-    VK_CHECK(vmaMapMemory(_vmaAllocator, vmaStagingImageBufferAllocation, &mappedMemory));
-    memcpy(mappedMemory, rawData, sizeInBytes);
-    vmaUnmapMemory(_vmaAllocator, vmaStagingImageBufferAllocation);
-    // cmd to copy from staging to device
     VkBufferCopy region{.srcOffset = srcOffset,
                         .dstOffset = dstOffset,
                         .size = sizeInBytes};
@@ -2779,22 +3255,29 @@ void VkContext::Impl::writeImage(
     const ImageEntity &image,
     const BufferEntity &stagingBuffer,
     const CommandBufferEntity &cmdBuffer,
-    void *rawData)
+    void *rawData,
+    VkDeviceSize stagingOffset)
+{
+    const auto extent = std::get<5>(image);
+    // format: VK_FORMAT_R8G8B8A8_UNORM took 4 bytes
+    const auto imageDataSizeInBytes = get3DImageSizeInBytes(extent, VK_FORMAT_R8G8B8A8_UNORM);
+    auto *imageDataPtr = static_cast<uint8_t *>(getStagingMappedAddress(stagingBuffer));
+    memcpy(imageDataPtr + stagingOffset, rawData, imageDataSizeInBytes);
+    copyBufferToImage(image, stagingBuffer, cmdBuffer, stagingOffset);
+}
+
+void VkContext::Impl::copyBufferToImage(
+    const ImageEntity &image,
+    const BufferEntity &stagingBuffer,
+    const CommandBufferEntity &cmdBuffer,
+    VkDeviceSize stagingOffset)
 {
     const auto imageHandle = std::get<0>(image);
     const auto textureMipLevelCount = std::get<4>(image);
     const auto extent = std::get<5>(image);
     const auto stagingBufferHandle = std::get<0>(stagingBuffer);
-    const auto vmaStagingImageBufferAllocation = std::get<1>(stagingBuffer);
     const auto cmdBufferHandle = std::get<1>(cmdBuffer);
 
-    void *imageDataPtr{nullptr};
-    // format: VK_FORMAT_R8G8B8A8_UNORM took 4 bytes
-    const auto imageDataSizeInBytes = get3DImageSizeInBytes(extent, VK_FORMAT_R8G8B8A8_UNORM);
-    // log(Level::Info, "vmaMapMemory:", std::this_thread::get_id());
-    VK_CHECK(vmaMapMemory(_vmaAllocator, vmaStagingImageBufferAllocation, &imageDataPtr));
-    memcpy(imageDataPtr, rawData, imageDataSizeInBytes);
-    vmaUnmapMemory(_vmaAllocator, vmaStagingImageBufferAllocation);
     // image layout from undefined to write dst
     // transition layout
     // barrier based on mip level, array layers
@@ -2829,7 +3312,7 @@ void VkContext::Impl::writeImage(
     // staging buffer to device-local(image is device local memory)
     VkBufferImageCopy bufferCopyRegion = {};
     // mipmap level0: original copy
-    bufferCopyRegion.bufferOffset = 0;
+    bufferCopyRegion.bufferOffset = stagingOffset;
     // could be depth, stencil and color
     bufferCopyRegion.imageSubresource.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
     bufferCopyRegion.imageSubresource.mipLevel = 0;
@@ -2863,39 +3346,34 @@ void VkContext::Impl::submitWriteImageCommand(
     BeginRecordCommandBuffer(cmdBuffer);
     {
         ZoneScopedN("submitWriteImageCommand::writeImage");
-        writeImage(image, stagingBuffer, cmdBuffer, rawData);
+        writeImage(image, stagingBuffer, cmdBuffer, rawData, 0);
     }
     EndRecordCommandBuffer(cmdBuffer);
 
-    const auto commandBuffer = std::get<COMMAND_BUFFER_ENTITY_OFFSET::COMMAND_BUFFER>(cmdBuffer);
-    const auto fence = std::get<COMMAND_BUFFER_ENTITY_OFFSET::FENCE>(cmdBuffer);
-    const auto cmdQueue = std::get<COMMAND_BUFFER_ENTITY_OFFSET::QUEUE>(cmdBuffer);
-
-    VkSubmitInfo submitInfo{};
-    submitInfo.waitSemaphoreCount = semaphoresToWait.size();
-    submitInfo.pWaitSemaphores = semaphoresToWait.size() ? semaphoresToWait.data() : VK_NULL_HANDLE;
+    // binary semaphores of the caller, next to the value the queue timeline signals
+    std::vector<VkSemaphoreSubmitInfo> waits;
     if (semaphoresToWait.size())
     {
         ASSERT(waitStage.has_value(), "waitStage must be set when you wait for semaphores");
-        submitInfo.pWaitDstStageMask = &waitStage.value();
+        // the legacy stage bits are the low bits of the sync2 ones
+        for (auto semaphore : semaphoresToWait)
+        {
+            waits.push_back(binarySemaphore(semaphore, static_cast<VkPipelineStageFlags2>(waitStage.value())));
+        }
+    }
+    std::vector<VkSemaphoreSubmitInfo> signals;
+    for (auto semaphore : semaphoresToSignal)
+    {
+        signals.push_back(binarySemaphore(semaphore, VK_PIPELINE_STAGE_2_ALL_COMMANDS_BIT));
     }
 
-    submitInfo.sType = VK_STRUCTURE_TYPE_SUBMIT_INFO;
-    submitInfo.commandBufferCount = 1;
-    submitInfo.pCommandBuffers = &commandBuffer;
-    submitInfo.signalSemaphoreCount = semaphoresToSignal.size();
-    submitInfo.pSignalSemaphores = semaphoresToSignal.size() ? semaphoresToSignal.data() : VK_NULL_HANDLE;
-
-    // must reset fence of waiting (Signal -> not signal, due to initally fence is created with state "signaled")
-    VK_CHECK(vkResetFences(_logicalDevice, 1, &fence));
-    // This will change state of fence to signaled
-    VK_CHECK(vkQueueSubmit(cmdQueue, 1, &submitInfo, fence));
-    // this manifest a sync point, the command is submitted not necessary executed by the devices
-    const auto result = vkWaitForFences(_logicalDevice, 1, &fence, VK_TRUE, DEFAULT_FENCE_TIMEOUT);
-    if (result == VK_TIMEOUT)
+    // through the queue timeline: serialized with the upload workers, ordered on the queue's values
+    const auto point = submitCommandBuffer(cmdBuffer, waits, signals);
+    // sync io: the caller reuses the staging buffer right away
+    if (!waitTimelinePoints(_logicalDevice, {point}, DEFAULT_FENCE_TIMEOUT))
     {
         // should not happen
-        ASSERT(false, "vkWaitForFences somehow Timed out !");
+        ASSERT(false, "submitWriteImageCommand: timeline wait somehow timed out !");
         vkDeviceWaitIdle(_logicalDevice);
     }
 }
@@ -3075,45 +3553,66 @@ std::vector<CommandBufferEntity> &VkContext::Impl::getCommandBufferForRenderingF
     return cmdBuffers[COMMAND_SEMANTIC::RENDERING];
 }
 
-void VkContext::Impl::submitCommand()
+void VkContext::Impl::submitCommand(const std::vector<VkSemaphoreSubmitInfo> &extraWaits,
+                                    const std::vector<VkSemaphoreSubmitInfo> &extraSignals)
 {
     auto [currentFrameId, cmdBuffersForRendering] = getCommandBufferForRendering();
-    const auto cmdToRecord = std::get<1>(cmdBuffersForRendering);
-    const auto fenceToWait = std::get<2>(cmdBuffersForRendering);
-    // submit command
-    VkSubmitInfo submitInfo{};
-    submitInfo.sType = VK_STRUCTURE_TYPE_SUBMIT_INFO;
-
-    VkSemaphore waitSemaphores[] = {imageCanAcquireSemaphores[currentFrameId]};
-    // pipeline stages
+    if (isHeadless())
+    {
+        // the readback of the previous frame of this image is ahead on the same queue, see ReadbackPool
+        _lastFrameTimelinePoint = submitCommandBuffer(cmdBuffersForRendering, extraWaits, extraSignals);
+        return;
+    }
+    // swapchain acquire/present only speak binary semaphores
     // specifies the stage of the pipeline after blending where the final color values are output from the pipeline
-    // basically wait for the previous rendering finished
-    VkPipelineStageFlags waitStages[] = {VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT};
-
-    submitInfo.waitSemaphoreCount = 1;
-    submitInfo.pWaitSemaphores = waitSemaphores;
-    submitInfo.pWaitDstStageMask = waitStages;
-    submitInfo.commandBufferCount = 1;
-    submitInfo.pCommandBuffers = &cmdToRecord;
-
-    // signal semaphore
-    VkSemaphore signalRenderedSemaphores[] = {imageRendereredSemaphores[currentFrameId]};
-    submitInfo.signalSemaphoreCount = 1;
-    submitInfo.pSignalSemaphores = signalRenderedSemaphores;
+    std::vector<VkSemaphoreSubmitInfo> waits{
+        binarySemaphore(imageCanAcquireSemaphores[currentFrameId], VK_PIPELINE_STAGE_2_COLOR_ATTACHMENT_OUTPUT_BIT)};
+    std::vector<VkSemaphoreSubmitInfo> signals{
+        binarySemaphore(imageRendereredSemaphores[_acquiredImageIndex], VK_PIPELINE_STAGE_2_ALL_COMMANDS_BIT)};
+    waits.insert(waits.end(), extraWaits.begin(), extraWaits.end());
+    signals.insert(signals.end(), extraSignals.begin(), extraSignals.end());
+    // the frame value on the graphics timeline bounds the frames in flight:
+    // BeginRecordCommandBuffer of the same slot waits on it
+    _lastFrameTimelinePoint = submitCommandBuffer(cmdBuffersForRendering, waits, signals);
+}
 
-    // vkWaitForFences and reset pattern
-    VK_CHECK(vkResetFences(_logicalDevice, 1, &fenceToWait));
-    // signal fence+
-    VK_CHECK(vkQueueSubmit(_graphicsComputeQueue, 1, &submitInfo, fenceToWait));
+TimelinePoint VkContext::Impl::submitCommandBuffer(const CommandBufferEntity &cmdBuffer,
+                                                   const std::vector<VkSemaphoreSubmitInfo> &waits,
+                                                   const std::vector<VkSemaphoreSubmitInfo> &signals)
+{
+    const auto cmdBufferHandle = std::get<COMMAND_BUFFER_ENTITY_OFFSET::COMMAND_BUFFER>(cmdBuffer);
+    const auto queue = std::get<COMMAND_BUFFER_ENTITY_OFFSET::QUEUE>(cmdBuffer);
+    const auto point = getQueueTimeline(queue).submit(cmdBufferHandle, waits, signals);
+    std::scoped_lock lock{_cmdBufferTimelineMux};
+    _cmdBufferTimelinePoints[cmdBufferHandle] = point;
+    return point;
 }
 
 void VkContext::Impl::present(uint32_t swapChainImageIndex)
 {
+    if (isHeadless())
+    {
+        // the copy is the presentation: paced on it, handed to the callback once done
+        const auto copied = _readbackPool->readback(swapChainImageIndex, _swapChainImages[swapChainImageIndex],
+                                                    getSwapChainFinalLayout());
+        _framePacer->presented(copied);
+        _readbackPool->collect();
+        return;
+    }
     // present after rendering is done
-    VkSemaphore signalRenderedSemaphores[] = {imageRendereredSemaphores[currentFrameId]};
+    VkSemaphore signalRenderedSemaphores[] = {imageRendereredSemaphores[swapChainImageIndex]};
+
+    // the id vkWaitForPresentKHR waits on
+    const uint64_t presentId = _framePacer->presentId();
+    const VkPresentIdKHR presentIdInfo{
+        .sType = VK_STRUCTURE_TYPE_PRESENT_ID_KHR,
+        .swapchainCount = 1,
+        .pPresentIds = &presentId,
+    };
 
     VkPresentInfoKHR presentInfo{};
     presentInfo.sType = VK_STRUCTURE_TYPE_PRESENT_INFO_KHR;
+    presentInfo.pNext = _presentWaitEnabled ? &presentIdInfo : nullptr;
     presentInfo.waitSemaphoreCount = 1;
     presentInfo.pWaitSemaphores = signalRenderedSemaphores;
 
@@ -3122,12 +3621,19 @@ void VkContext::Impl::present(uint32_t swapChainImageIndex)
     presentInfo.pSwapchains = swapChains;
     presentInfo.pImageIndices = &swapChainImageIndex;
     presentInfo.pResults = nullptr;
-    VK_CHECK(vkQueuePresentKHR(_presentationQueue, &presentInfo));
+    // same lock as the submissions to that queue
+    VK_CHECK(getQueueTimeline(_presentationQueue).present(presentInfo));
+    _framePacer->presented(_lastFrameTimelinePoint);
 }
 
-uint32_t VkContext::Impl::getSwapChainImageIndexToRender() const
+uint32_t VkContext::Impl::getSwapChainImageIndexToRender()
 {
     ZoneScopedN("getSwapChainImageIndexToRender");
+    if (isHeadless())
+    {
+        _acquiredImageIndex = currentFrameId;
+        return _acquiredImageIndex;
+    }
     uint32_t swapChainImageIndex;
     VkResult result = vkAcquireNextImageKHR(
         _logicalDevice, _swapChain, UINT64_MAX, imageCanAcquireSemaphores[currentFrameId],
@@ -3138,6 +3644,7 @@ uint32_t VkContext::Impl::getSwapChainImageIndexToRender() const
         return swapChainImageIndex;
     }
     assert(result == VK_SUCCESS || result == VK_SUBOPTIMAL_KHR); // failed to acquire swap chain image
+    _acquiredImageIndex = swapChainImageIndex;
     return swapChainImageIndex;
 }
 
@@ -3178,6 +3685,18 @@ VkPhysicalDeviceFragmentDensityMapFeaturesEXT VkContext::sFragmentDensityMapFeat
     .sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_FRAGMENT_DENSITY_MAP_FEATURES_EXT,
 };
 
+VkPhysicalDeviceDescriptorBufferFeaturesEXT VkContext::sDescriptorBufferFeatures = {
+    .sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_DESCRIPTOR_BUFFER_FEATURES_EXT,
+};
+
+VkPhysicalDevicePresentIdFeaturesKHR VkContext::sPresentIdFeatures = {
+    .sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_PRESENT_ID_FEATURES_KHR,
+};
+
+VkPhysicalDevicePresentWaitFeaturesKHR VkContext::sPresentWaitFeatures = {
+    .sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_PRESENT_WAIT_FEATURES_KHR,
+};
+
 VkContext::VkContext(const WindowEntity &window,
                      const std::vector<const char *> &instanceValidationLayers,
                      const std::set<std::string> &instanceExtensions,
@@ -3185,7 +3704,22 @@ VkContext::VkContext(const WindowEntity &window,
 {
     _pimpl = std::make_unique<Impl>(
         *this,
-        window,
+        &window,
+        HeadlessConfig{},
+        instanceValidationLayers,
+        instanceExtensions,
+        deviceExtensions);
+}
+
+VkContext::VkContext(const HeadlessConfig &headless,
+                     const std::vector<const char *> &instanceValidationLayers,
+                     const std::set<std::string> &instanceExtensions,
+                     const std::vector<const char *> deviceExtensions)
+{
+    _pimpl = std::make_unique<Impl>(
+        *this,
+        nullptr,
+        headless,
         instanceValidationLayers,
         instanceExtensions,
         deviceExtensions);
@@ -3197,9 +3731,17 @@ VkContext::~VkContext()
 
 void VkContext::createSwapChain()
 {
-    _pimpl->createSwapChain();
-    _pimpl->createSwapChainImageView();
+    if (_pimpl->isHeadless())
+    {
+        _pimpl->createOffscreenImages();
+    }
+    else
+    {
+        _pimpl->createSwapChain();
+        _pimpl->createSwapChainImageView();
+    }
     _pimpl->createPerFrameSyncObjects();
+    _pimpl->createFramePacer();
 }
 
 VkRenderPass VkContext::createSwapChainRenderPass()
@@ -3222,7 +3764,7 @@ VkFramebuffer VkContext::createFramebuffer(
 void VkContext::initDefaultCommandBuffers()
 {
     log(Level::Info, "-->initDefaultCommandBuffers");
-    const auto numFramesInFlight = getSwapChainImageViews().size();
+    const auto numFramesInFlight = getFramesInFlight();
     _pimpl->cmdBuffers.insert(std::make_pair(COMMAND_SEMANTIC::RENDERING,
                                              _pimpl->createGraphicsCommandBuffers("rendering", numFramesInFlight,
                                                                                   numFramesInFlight, VK_FENCE_CREATE_SIGNALED_BIT)));
@@ -3270,17 +3812,19 @@ BufferEntity VkContext::createPersistentBuffer(
 
 BufferEntity VkContext::createStagingBuffer(
     const std::string &name,
-    VkDeviceSize bufferSizeInBytes)
+    VkDeviceSize bufferSizeInBytes,
+    MEMORY_CATEGORY category)
 {
-    return _pimpl->createStagingBuffer(name, bufferSizeInBytes);
+    return _pimpl->createStagingBuffer(name, bufferSizeInBytes, category);
 }
 
 BufferEntity VkContext::createDeviceLocalBuffer(
     const std::string &name,
     VkDeviceSize bufferSizeInBytes,
-    VkBufferUsageFlags bufferUsageFlag)
+    VkBufferUsageFlags bufferUsageFlag,
+    MEMORY_CATEGORY category)
 {
-    return _pimpl->createDeviceLocalBuffer(name, bufferSizeInBytes, bufferUsageFlag);
+    return _pimpl->createDeviceLocalBuffer(name, bufferSizeInBytes, bufferUsageFlag, category);
 }
 
 std::tuple<BufferEntity, VkStridedDeviceAddressRegionKHR> VkContext::createShaderBindTableBuffer(
@@ -3302,7 +3846,8 @@ BufferEntity VkContext::createBuffer(
     VkMemoryPropertyFlags requiredMemoryProperties,
     VkMemoryPropertyFlags preferredMemoryProperties,
     VmaMemoryUsage memoryUsage,
-    bool mapping)
+    bool mapping,
+    MEMORY_CATEGORY category)
 {
     return _pimpl->createBuffer(
         name,
@@ -3313,10 +3858,10 @@ BufferEntity VkContext::createBuffer(
         requiredMemoryProperties,
         preferredMemoryProperties,
         memoryUsage,
-        mapping);
+        mapping,
+        category);
 }
 
-#ifdef _WIN64
 BufferEntity VkContext::createExportableBuffer(
     const std::string &name,
     VkDeviceSize bufferSizeInBytes,
@@ -3331,7 +3876,6 @@ BufferEntity VkContext::createExportableBuffer(
         bufferSharingMode,
         mapping);
 }
-#endif
 
 ImageEntity VkContext::createImage(
     const std::string &name,
@@ -3343,14 +3887,14 @@ ImageEntity VkContext::createImage(
     VkSampleCountFlagBits textureMultiSampleCount,
     VkImageUsageFlags usage,
     VkMemoryPropertyFlags memoryFlags,
-    bool generateMips)
+    bool generateMips,
+    MEMORY_CATEGORY category)
 {
     return _pimpl->createImage(name, imageType, format, extent, textureMipLevelCount,
-                               textureLayersCount, textureMultiSampleCount, usage, memoryFlags, generateMips);
+                               textureLayersCount, textureMultiSampleCount, usage, memoryFlags, generateMips, category);
 }
 
-#ifdef _WIN64
-void VkContext::createExportableImage(
+ImageEntity VkContext::createExportableImage(
     const std::string &name,
     VkImageType imageType,
     VkFormat format,
@@ -3361,7 +3905,11 @@ void VkContext::createExportableImage(
 {
     return _pimpl->createExportableImage(name, imageType, format, extent, textureMipLevelCount, textureMultiSampleCount, usage);
 }
-#endif
+
+VkSemaphore VkContext::createExportableSemaphore(VkSemaphoreType type, uint64_t initialValue)
+{
+    return _pimpl->createExportableSemaphore(type, initialValue);
+}
 
 std::tuple<VkSampler> VkContext::createSampler(const std::string &name)
 {
@@ -3467,13 +4015,34 @@ void VkContext::writeBuffer(
     return _pimpl->writeBuffer(stagingBuffer, deviceLocalBuffer, cmdBuffer, rawData, sizeInBytes, srcOffset, dstOffset);
 }
 
+void VkContext::copyBuffer(
+    const BufferEntity &stagingBuffer,
+    const BufferEntity &deviceLocalBuffer,
+    const CommandBufferEntity &cmdBuffer,
+    uint32_t sizeInBytes,
+    uint32_t srcOffset,
+    uint32_t dstOffset)
+{
+    return _pimpl->copyBuffer(stagingBuffer, deviceLocalBuffer, cmdBuffer, sizeInBytes, srcOffset, dstOffset);
+}
+
 void VkContext::writeImage(
     const ImageEntity &image,
     const BufferEntity &stagingBuffer,
     const CommandBufferEntity &cmdBuffer,
-    void *rawData)
+    void *rawData,
+    VkDeviceSize stagingOffset)
 {
-    return _pimpl->writeImage(image, stagingBuffer, cmdBuffer, rawData);
+    return _pimpl->writeImage(image, stagingBuffer, cmdBuffer, rawData, stagingOffset);
+}
+
+void VkContext::copyBufferToImage(
+    const ImageEntity &image,
+    const BufferEntity &stagingBuffer,
+    const CommandBufferEntity &cmdBuffer,
+    VkDeviceSize stagingOffset)
+{
+    return _pimpl->copyBufferToImage(image, stagingBuffer, cmdBuffer, stagingOffset);
 }
 
 void VkContext::submitWriteImageCommand(
@@ -3519,6 +4088,41 @@ VmaAllocator VkContext::getVmaAllocator() const
     return _pimpl->getVmaAllocator();
 }
 
+StagingRing &VkContext::getStagingRing()
+{
+    return _pimpl->getStagingRing();
+}
+
+MemoryManager &VkContext::getMemoryManager()
+{
+    return _pimpl->getMemoryManager();
+}
+
+void VkContext::setLatencyConfig(const LatencyConfig &config)
+{
+    _pimpl->setLatencyConfig(config);
+}
+
+const LatencyConfig &VkContext::getLatencyConfig() const
+{
+    return _pimpl->getLatencyConfig();
+}
+
+uint32_t VkContext::getFramesInFlight() const
+{
+    return _pimpl->getFramesInFlight();
+}
+
+FramePacer &VkContext::getFramePacer()
+{
+    return _pimpl->getFramePacer();
+}
+
+QueueTimeline &VkContext::getQueueTimeline(VkQueue queue)
+{
+    return _pimpl->getQueueTimeline(queue);
+}
+
 VkQueue VkContext::getGraphicsComputeQueue() const
 {
     return _pimpl->getGraphicsComputeQueue();
@@ -3574,6 +4178,41 @@ VkExtent2D VkContext::getSwapChainExtent() const
     return _pimpl->getSwapChainExtent();
 }
 
+VkFormat VkContext::getSwapChainFormat() const
+{
+    return _pimpl->getSwapChainFormat();
+}
+
+bool VkContext::isDescriptorBufferSupported() const
+{
+    return _pimpl->isDescriptorBufferSupported();
+}
+
+bool VkContext::isRayTracingSupported() const
+{
+    return _pimpl->isRayTracingSupported();
+}
+
+bool VkContext::isExternalInteropSupported() const
+{
+    return _pimpl->isExternalInteropSupported();
+}
+
+bool VkContext::isHeadless() const
+{
+    return _pimpl->isHeadless();
+}
+
+VkImageLayout VkContext::getSwapChainFinalLayout() const
+{
+    return _pimpl->getSwapChainFinalLayout();
+}
+
+ReadbackPool &VkContext::getReadbackPool()
+{
+    return _pimpl->getReadbackPool();
+}
+
 const std::vector<VkImage> &VkContext::getSwapChainImages() const
 {
     return _pimpl->getSwapChainImages();
@@ -3616,13 +4255,21 @@ TracyVkCtx VkContext::getTracyContext() const
 
 void VkContext::advanceCommandBuffer()
 {
-    const auto numFramesInFlight = getSwapChainImageViews().size();
+    const auto numFramesInFlight = getFramesInFlight();
     _pimpl->currentFrameId = (_pimpl->currentFrameId + 1) % numFramesInFlight;
 }
 
-void VkContext::submitCommand()
+void VkContext::submitCommand(const std::vector<VkSemaphoreSubmitInfo> &extraWaits,
+                              const std::vector<VkSemaphoreSubmitInfo> &extraSignals)
+{
+    return _pimpl->submitCommand(extraWaits, extraSignals);
+}
+
+TimelinePoint VkContext::submitCommandBuffer(const CommandBufferEntity &cmdBuffer,
+                                             const std::vector<VkSemaphoreSubmitInfo> &waits,
+                                             const std::vector<VkSemaphoreSubmitInfo> &signals)
 {
-    return _pimpl->submitCommand();
+    return _pimpl->submitCommandBuffer(cmdBuffer, waits, signals);
 }
 
 void VkContext::present(uint32_t swapChainImageIndex)
@@ -3640,26 +4287,61 @@ void VkContext::releaseQueueFamilyOwnership(
     const ImageEntity &image,
     uint32_t srcQueueFamilyIndex,
     uint32_t dstQueueFamilyIndex)
+{
+    releaseQueueFamilyOwnership(cmdBuffer, std::vector<ImageEntity>{image}, {}, srcQueueFamilyIndex, dstQueueFamilyIndex);
+}
+
+void VkContext::releaseQueueFamilyOwnership(
+    const CommandBufferEntity &cmdBuffer,
+    const std::vector<ImageEntity> &images,
+    const std::vector<BufferEntity> &buffers,
+    uint32_t srcQueueFamilyIndex,
+    uint32_t dstQueueFamilyIndex)
 {
     // diff: VkImageMemoryBarrier2 vs VkImageMemoryBarrier is the srcStageMask and dstStageMast
     // vkCmdPipelineBarrier2 is easier to use than vkCmdPipelineBarrier
-    const auto mipLevels = std::get<4>(image);
-    VkImageMemoryBarrier2 releaseBarrier = {
-        .sType = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER_2,
-        .srcStageMask = VK_PIPELINE_STAGE_2_TRANSFER_BIT,
-        .srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT,
-        .dstStageMask = VK_PIPELINE_STAGE_2_ALL_COMMANDS_BIT,
-        .dstAccessMask = VK_ACCESS_SHADER_READ_BIT,
-        .srcQueueFamilyIndex = srcQueueFamilyIndex,
-        .dstQueueFamilyIndex = dstQueueFamilyIndex,
-        .image = std::get<0>(image),
-        .subresourceRange = {VK_IMAGE_ASPECT_COLOR_BIT, 0, mipLevels, 0, 1},
-    };
+    std::vector<VkImageMemoryBarrier2> imageBarriers;
+    imageBarriers.reserve(images.size());
+    for (const auto &image : images)
+    {
+        const auto mipLevels = std::get<4>(image);
+        imageBarriers.emplace_back(VkImageMemoryBarrier2{
+            .sType = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER_2,
+            .srcStageMask = VK_PIPELINE_STAGE_2_TRANSFER_BIT,
+            .srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT,
+            .dstStageMask = VK_PIPELINE_STAGE_2_ALL_COMMANDS_BIT,
+            .dstAccessMask = VK_ACCESS_SHADER_READ_BIT,
+            .srcQueueFamilyIndex = srcQueueFamilyIndex,
+            .dstQueueFamilyIndex = dstQueueFamilyIndex,
+            .image = std::get<0>(image),
+            .subresourceRange = {VK_IMAGE_ASPECT_COLOR_BIT, 0, mipLevels, 0, 1},
+        });
+    }
+    std::vector<VkBufferMemoryBarrier2> bufferBarriers;
+    bufferBarriers.reserve(buffers.size());
+    for (const auto &buffer : buffers)
+    {
+        bufferBarriers.emplace_back(VkBufferMemoryBarrier2{
+            .sType = VK_STRUCTURE_TYPE_BUFFER_MEMORY_BARRIER_2,
+            .srcStageMask = VK_PIPELINE_STAGE_2_TRANSFER_BIT,
+            .srcAccessMask = VK_ACCESS_2_TRANSFER_WRITE_BIT,
+            .dstStageMask = VK_PIPELINE_STAGE_2_ALL_COMMANDS_BIT,
+            .dstAccessMask = VK_ACCESS_2_MEMORY_READ_BIT,
+            .srcQueueFamilyIndex = srcQueueFamilyIndex,
+            .dstQueueFamilyIndex = dstQueueFamilyIndex,
+            .buffer = std::get<BUFFER_ENTITY_UID::BUFFER>(buffer),
+            .offset = 0,
+            .size = VK_WHOLE_SIZE,
+        });
+    }
 
+    // one barrier command for the whole batch
     VkDependencyInfo dependencyInfo{
         .sType = VK_STRUCTURE_TYPE_DEPENDENCY_INFO,
-        .imageMemoryBarrierCount = 1,
-        .pImageMemoryBarriers = &releaseBarrier,
+        .bufferMemoryBarrierCount = static_cast<uint32_t>(bufferBarriers.size()),
+        .pBufferMemoryBarriers = bufferBarriers.data(),
+        .imageMemoryBarrierCount = static_cast<uint32_t>(imageBarriers.size()),
+        .pImageMemoryBarriers = imageBarriers.data(),
     };
 
     const auto cmdBufferHandle = std::get<1>(cmdBuffer);
@@ -3682,21 +4364,54 @@ void VkContext::acquireQueueFamilyOwnership(
     uint32_t srcQueueFamilyIndex,
     uint32_t dstQueueFamilyIndex)
 {
-    const auto mipLevels = std::get<4>(image);
-    VkImageMemoryBarrier2 acquireBarrier = {
-        .sType = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER_2,
-        .dstStageMask = VK_PIPELINE_STAGE_2_FRAGMENT_SHADER_BIT,
-        .dstAccessMask = VK_ACCESS_2_MEMORY_READ_BIT,
-        .srcQueueFamilyIndex = srcQueueFamilyIndex,
-        .dstQueueFamilyIndex = dstQueueFamilyIndex,
-        .image = std::get<0>(image),
-        .subresourceRange = {VK_IMAGE_ASPECT_COLOR_BIT, 0, mipLevels, 0, 1},
-    };
+    acquireQueueFamilyOwnership(cmdBuffer, std::vector<ImageEntity>{image}, {}, srcQueueFamilyIndex, dstQueueFamilyIndex);
+}
+
+void VkContext::acquireQueueFamilyOwnership(
+    const CommandBufferEntity &cmdBuffer,
+    const std::vector<ImageEntity> &images,
+    const std::vector<BufferEntity> &buffers,
+    uint32_t srcQueueFamilyIndex,
+    uint32_t dstQueueFamilyIndex)
+{
+    std::vector<VkImageMemoryBarrier2> imageBarriers;
+    imageBarriers.reserve(images.size());
+    for (const auto &image : images)
+    {
+        const auto mipLevels = std::get<4>(image);
+        // transfer: the mip chain is blitted right after the acquire
+        imageBarriers.emplace_back(VkImageMemoryBarrier2{
+            .sType = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER_2,
+            .dstStageMask = VK_PIPELINE_STAGE_2_TRANSFER_BIT | VK_PIPELINE_STAGE_2_FRAGMENT_SHADER_BIT,
+            .dstAccessMask = VK_ACCESS_2_MEMORY_READ_BIT,
+            .srcQueueFamilyIndex = srcQueueFamilyIndex,
+            .dstQueueFamilyIndex = dstQueueFamilyIndex,
+            .image = std::get<0>(image),
+            .subresourceRange = {VK_IMAGE_ASPECT_COLOR_BIT, 0, mipLevels, 0, 1},
+        });
+    }
+    std::vector<VkBufferMemoryBarrier2> bufferBarriers;
+    bufferBarriers.reserve(buffers.size());
+    for (const auto &buffer : buffers)
+    {
+        bufferBarriers.emplace_back(VkBufferMemoryBarrier2{
+            .sType = VK_STRUCTURE_TYPE_BUFFER_MEMORY_BARRIER_2,
+            .dstStageMask = VK_PIPELINE_STAGE_2_ALL_COMMANDS_BIT,
+            .dstAccessMask = VK_ACCESS_2_MEMORY_READ_BIT,
+            .srcQueueFamilyIndex = srcQueueFamilyIndex,
+            .dstQueueFamilyIndex = dstQueueFamilyIndex,
+            .buffer = std::get<BUFFER_ENTITY_UID::BUFFER>(buffer),
+            .offset = 0,
+            .size = VK_WHOLE_SIZE,
+        });
+    }
 
     VkDependencyInfo dependencyInfo{
         .sType = VK_STRUCTURE_TYPE_DEPENDENCY_INFO,
-        .imageMemoryBarrierCount = 1,
-        .pImageMemoryBarriers = &acquireBarrier,
+        .bufferMemoryBarrierCount = static_cast<uint32_t>(bufferBarriers.size()),
+        .pBufferMemoryBarriers = bufferBarriers.data(),
+        .imageMemoryBarrierCount = static_cast<uint32_t>(imageBarriers.size()),
+        .pImageMemoryBarriers = imageBarriers.data(),
     };
     const auto cmdBufferHandle = std::get<1>(cmdBuffer);
     vkCmdPipelineBarrier2(cmdBufferHandle, &dependencyInfo);
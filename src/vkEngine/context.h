@@ -44,6 +44,10 @@
 // In exactly one CPP file define following macro before this include. It enables also internal definitions.
 #include <vk_mem_alloc.h>
 #include <misc.h>
+#include <queueTimeline.h>
+#include <framePacer.h>
+#include <readbackPool.h>
+#include <memoryManager.h>
 
 #include <tracy/Tracy.hpp>
 #include <tracy/TracyVulkan.hpp>
@@ -78,6 +82,7 @@ enum COMMAND_SEMANTIC : int
 };
 
 class WindowEntity;
+class StagingRing;
 
 using CommandBufferEntity = std::tuple<VkCommandPool, VkCommandBuffer, VkFence, uint32_t, VkQueue>;
 enum COMMAND_BUFFER_ENTITY_OFFSET : int
@@ -89,7 +94,7 @@ enum COMMAND_BUFFER_ENTITY_OFFSET : int
     QUEUE
 };
 
-using ImageEntity = std::tuple<VkImage, VkImageView, VmaAllocation, VmaAllocationInfo, uint32_t, VkExtent3D, VkFormat>;
+using ImageEntity = std::tuple<VkImage, VkImageView, VmaAllocation, VmaAllocationInfo, uint32_t, VkExtent3D, VkFormat, uint32_t>;
 enum IMAGE_ENTITY_OFFSET : int
 {
     IMAGE = 0,
@@ -98,7 +103,8 @@ enum IMAGE_ENTITY_OFFSET : int
     IMAGE_VMA_ALLOCATION_INFO,
     MIPMAP_COUNT = 4,
     IMAGE_EXTENT,
-    IMAGE_FORMAT
+    IMAGE_FORMAT,
+    IMAGE_ARRAY_LAYERS
 };
 
 using MappingAddressType = void *;
@@ -146,6 +152,12 @@ public:
         const std::vector<const char *> &instanceValidationLayers,
         const std::set<std::string> &instanceExtensions,
         const std::vector<const char *> deviceExtensions);
+    // headless: no window, surface nor swapchain, see readbackPool.h
+    VkContext(
+        const HeadlessConfig &headless,
+        const std::vector<const char *> &instanceValidationLayers,
+        const std::set<std::string> &instanceExtensions,
+        const std::vector<const char *> deviceExtensions);
     VkContext(const VkContext &) = delete;
     VkContext &operator=(const VkContext &) = delete;
     VkContext(VkContext &&) noexcept = default;
@@ -153,6 +165,12 @@ public:
 
     ~VkContext();
 
+    // before createSwapChain: frames in flight, present mode and pacing
+    void setLatencyConfig(const LatencyConfig &config);
+    const LatencyConfig &getLatencyConfig() const;
+    uint32_t getFramesInFlight() const;
+
+    // headless: an offscreen image ring of framesInFlight images and its ReadbackPool
     void createSwapChain();
 
     // generic to swapchain image and non-swapchain images
@@ -192,15 +210,18 @@ public:
         VkMemoryPropertyFlags preferredMemoryProperties,
         bool mapping = true);
 
+    // category: GENERIC_MEMORY for the long-lived ones bigger than a staging block
     BufferEntity createStagingBuffer(
         const std::string &name,
-        VkDeviceSize bufferSizeInBytes);
+        VkDeviceSize bufferSizeInBytes,
+        MEMORY_CATEGORY category = STAGING_MEMORY);
 
     // device local buffer
     BufferEntity createDeviceLocalBuffer(
         const std::string &name,
         VkDeviceSize bufferSizeInBytes,
-        VkBufferUsageFlags bufferUsageFlag);
+        VkBufferUsageFlags bufferUsageFlag,
+        MEMORY_CATEGORY category = GENERIC_MEMORY);
 
     // buffer specially for SBT
     std::tuple<BufferEntity, VkStridedDeviceAddressRegionKHR> createShaderBindTableBuffer(
@@ -220,16 +241,17 @@ public:
         VkMemoryPropertyFlags requiredMemoryProperties,
         VkMemoryPropertyFlags preferredMemoryProperties,
         VmaMemoryUsage memoryUsage,
-        bool mapping = false);
+        bool mapping = false,
+        MEMORY_CATEGORY category = GENERIC_MEMORY);
 
-#ifdef _WIN64
+    // for cuda interop: dedicated allocation (offset 0), EXPORT_HANDLE is the exported opaque win32 handle /
+    // opaque fd (stored as intptr_t) of the VkDeviceMemory, owned by the caller, see cudaEngine::importVkMemory
     BufferEntity createExportableBuffer(
         const std::string &name,
         VkDeviceSize bufferSizeInBytes,
         VkBufferUsageFlags bufferUsageFlag,
         VkSharingMode bufferSharingMode,
         bool mapping = false);
-#endif
 
     ImageEntity createImage(
         const std::string &name,
@@ -241,10 +263,12 @@ public:
         VkSampleCountFlagBits textureMultiSampleCount,
         VkImageUsageFlags usage,
         VkMemoryPropertyFlags memoryFlags,
-        bool generateMips);
+        bool generateMips,
+        MEMORY_CATEGORY category = GENERIC_MEMORY);
 
-#ifdef _WIN64
-    void createExportableImage(
+    // for cuda interop: dedicated allocation (offset 0), exportable as an opaque win32 handle / opaque fd
+    // of IMAGE_VMA_ALLOCATION_INFO.deviceMemory, see cudaEngine::getVkImageMemoryHandle
+    ImageEntity createExportableImage(
         const std::string &name,
         VkImageType imageType,
         VkFormat format,
@@ -252,7 +276,11 @@ public:
         uint32_t textureMipLevelCount,
         VkSampleCountFlagBits textureMultiSampleCount,
         VkImageUsageFlags usage);
-#endif
+
+    // for cuda interop: exportable as an opaque win32 handle / opaque fd, see cudaEngine::getVkSemaphoreHandle
+    // destroyed by the caller
+    VkSemaphore createExportableSemaphore(VkSemaphoreType type = VK_SEMAPHORE_TYPE_TIMELINE,
+                                          uint64_t initialValue = 0);
     std::tuple<VkSampler> createSampler(const std::string &name);
 
     // uint32_t: set id
@@ -325,11 +353,29 @@ public:
         uint32_t srcOffset = 0,
         uint32_t dstOffset = 0);
 
+    // record the copy only, the staging buffer is already filled (e.g. from a job)
+    void copyBuffer(
+        const BufferEntity &stagingBuffer,
+        const BufferEntity &deviceLocalBuffer,
+        const CommandBufferEntity &cmdBuffer,
+        uint32_t sizeInBytes,
+        uint32_t srcOffset = 0,
+        uint32_t dstOffset = 0);
+
+    // stagingOffset: where the texels go in the staging buffer (StagingRegion::offset)
     void writeImage(
         const ImageEntity &image,
         const BufferEntity &stagingBuffer,
         const CommandBufferEntity &cmdBuffer,
-        void *rawData);
+        void *rawData,
+        VkDeviceSize stagingOffset = 0);
+
+    // record the layout transition and the copy only, the texels are already in the staging buffer
+    void copyBufferToImage(
+        const ImageEntity &image,
+        const BufferEntity &stagingBuffer,
+        const CommandBufferEntity &cmdBuffer,
+        VkDeviceSize stagingOffset = 0);
 
     void submitWriteImageCommand(
         ImageEntity &image,
@@ -350,6 +396,14 @@ public:
     VkInstance getInstance() const;
     VkDevice getLogicDevice() const;
     VmaAllocator getVmaAllocator() const;
+    // shared upload memory, see stagingRing.h
+    StagingRing &getStagingRing();
+    // pools per MEMORY_CATEGORY, budgets and stats, see memoryManager.h
+    MemoryManager &getMemoryManager();
+    // once per frame before the input is sampled, see framePacer.h
+    FramePacer &getFramePacer();
+    // one timeline semaphore per distinct queue, see queueTimeline.h
+    QueueTimeline &getQueueTimeline(VkQueue queue);
     VkQueue getGraphicsComputeQueue() const;
     VkQueue getPresentationQueue() const;
 
@@ -366,6 +420,21 @@ public:
 
     VkSwapchainKHR getSwapChain() const;
     VkExtent2D getSwapChainExtent() const;
+    VkFormat getSwapChainFormat() const;
+
+    // VK_EXT_descriptor_buffer: requested in the device extensions and supported
+    bool isDescriptorBufferSupported() const;
+    // VK_KHR_ray_tracing_pipeline, VK_KHR_acceleration_structure, VK_KHR_ray_query: requested and supported
+    bool isRayTracingSupported() const;
+    // cuda interop: the external memory/semaphore extensions of the platform (win32 / fd) are requested and
+    // the device exports device local buffers, optimal rgba8 images and timeline semaphores with the platform handle type
+    bool isExternalInteropSupported() const;
+
+    bool isHeadless() const;
+    // VK_IMAGE_LAYOUT_PRESENT_SRC_KHR, headless: VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL
+    VkImageLayout getSwapChainFinalLayout() const;
+    // headless only, the frames rendered into the swapchain images, see readbackPool.h
+    ReadbackPool &getReadbackPool();
 
     // per-frame rendering op
     const std::vector<VkImage> &getSwapChainImages() const;
@@ -385,7 +454,15 @@ public:
 
     void advanceCommandBuffer();
 
-    void submitCommand();
+    // extra waits/signals: semaphores shared with other apis (cuda) for the frame
+    void submitCommand(const std::vector<VkSemaphoreSubmitInfo> &extraWaits = {},
+                       const std::vector<VkSemaphoreSubmitInfo> &extraSignals = {});
+
+    // submits to the queue of the entity and signals its timeline, the fence of the entity is left alone;
+    // BeginRecordCommandBuffer waits on the returned point before recording into cmdBuffer again
+    TimelinePoint submitCommandBuffer(const CommandBufferEntity &cmdBuffer,
+                                      const std::vector<VkSemaphoreSubmitInfo> &waits = {},
+                                      const std::vector<VkSemaphoreSubmitInfo> &signals = {});
 
     void present(uint32_t swapChainImageIndex);
 
@@ -438,6 +515,14 @@ public:
         uint32_t srcQueueFamilyIndex,
         uint32_t dstQueueFamilyIndex);
 
+    // batched: a single vkCmdPipelineBarrier2 for every image and buffer
+    void releaseQueueFamilyOwnership(
+        const CommandBufferEntity &cmdBuffer,
+        const std::vector<ImageEntity> &images,
+        const std::vector<BufferEntity> &buffers,
+        uint32_t srcQueueFamilyIndex,
+        uint32_t dstQueueFamilyIndex);
+
     // step2: acquire part of queue family ownership transfer
     void acquireQueueFamilyOwnership(
         const CommandBufferEntity &cmdBuffer,
@@ -445,6 +530,13 @@ public:
         uint32_t srcQueueFamilyIndex,
         uint32_t dstQueueFamilyIndex);
 
+    void acquireQueueFamilyOwnership(
+        const CommandBufferEntity &cmdBuffer,
+        const std::vector<ImageEntity> &images,
+        const std::vector<BufferEntity> &buffers,
+        uint32_t srcQueueFamilyIndex,
+        uint32_t dstQueueFamilyIndex);
+
     // features chains
     // now is to toggle features selectively
     // enable features
@@ -455,6 +547,9 @@ public:
     static VkPhysicalDeviceVulkan12Features sEnable12Features;
     static VkPhysicalDeviceVulkan13Features sEnable13Features;
     static VkPhysicalDeviceFragmentDensityMapFeaturesEXT sFragmentDensityMapFeatures;
+    static VkPhysicalDeviceDescriptorBufferFeaturesEXT sDescriptorBufferFeatures;
+    static VkPhysicalDevicePresentIdFeaturesKHR sPresentIdFeatures;
+    static VkPhysicalDevicePresentWaitFeaturesKHR sPresentWaitFeatures;
     // for ray-tracing
     static VkPhysicalDeviceAccelerationStructureFeaturesKHR sAccelStructFeatures;
     static VkPhysicalDeviceRayTracingPipelineFeaturesKHR sRayTracingPipelineFeatures;
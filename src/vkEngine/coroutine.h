@@ -0,0 +1,423 @@
+#pragma once
+
+#include <coroutine>
+#include <exception>
+#include <optional>
+#include <utility>
+#include <atomic>
+#include <vector>
+#include <mutex>
+#include <condition_variable>
+#include <future> // packaged_task<>
+#include <type_traits>
+
+#include <jobSystem.h>
+
+// C++20 coroutine layer for async resource loading
+// Task<T>         : lazy coroutine, starts when awaited, resumes its awaiter when done (symmetric transfer)
+// resumeOn(exec)  : hop to another executor (JobSystem, or any queue of packaged_task<void()>)
+// whenAll(tasks)  : run tasks concurrently, resume when every one is done
+// syncWait(task)  : block a non-coroutine thread on a task
+// AsyncScope      : fire tasks and join them later (e.g. textures streaming in while rendering)
+// gpu completion (fence/timeline semaphore) awaitables live in gpuCompletion.h
+
+template <typename T = void>
+class Task;
+
+struct TaskPromiseBase
+{
+    // who to resume once the task is done, nobody by default
+    std::coroutine_handle<> continuation{std::noop_coroutine()};
+    std::exception_ptr exception;
+
+    struct FinalAwaiter
+    {
+        bool await_ready() noexcept
+        {
+            return false;
+        }
+
+        template <typename Promise>
+        std::coroutine_handle<> await_suspend(std::coroutine_handle<Promise> h) noexcept
+        {
+            return h.promise().continuation;
+        }
+
+        void await_resume() noexcept
+        {
+        }
+    };
+
+    std::suspend_always initial_suspend() noexcept
+    {
+        return {};
+    }
+
+    FinalAwaiter final_suspend() noexcept
+    {
+        return {};
+    }
+
+    void unhandled_exception() noexcept
+    {
+        exception = std::current_exception();
+    }
+};
+
+template <typename T>
+struct TaskPromise : TaskPromiseBase
+{
+    std::optional<T> value;
+
+    Task<T> get_return_object() noexcept;
+
+    void return_value(T v)
+    {
+        value.emplace(std::move(v));
+    }
+
+    T result()
+    {
+        if (exception)
+        {
+            std::rethrow_exception(exception);
+        }
+        return std::move(*value);
+    }
+};
+
+template <>
+struct TaskPromise<void> : TaskPromiseBase
+{
+    Task<void> get_return_object() noexcept;
+
+    void return_void() noexcept
+    {
+    }
+
+    void result()
+    {
+        if (exception)
+        {
+            std::rethrow_exception(exception);
+        }
+    }
+};
+
+template <typename T>
+class Task
+{
+public:
+    using promise_type = TaskPromise<T>;
+
+    Task() = default;
+    explicit Task(std::coroutine_handle<promise_type> h) : _handle(h)
+    {
+    }
+
+    Task(Task &&other) noexcept : _handle(std::exchange(other._handle, nullptr))
+    {
+    }
+
+    Task &operator=(Task &&other) noexcept
+    {
+        if (this != &other)
+        {
+            if (_handle)
+            {
+                _handle.destroy();
+            }
+            _handle = std::exchange(other._handle, nullptr);
+        }
+        return *this;
+    }
+
+    Task(const Task &other) = delete;
+    Task &operator=(const Task &other) = delete;
+
+    ~Task()
+    {
+        if (_handle)
+        {
+            _handle.destroy();
+        }
+    }
+
+    bool valid() const
+    {
+        return _handle != nullptr;
+    }
+
+    auto operator co_await() && noexcept
+    {
+        struct Awaiter
+        {
+            std::coroutine_handle<promise_type> handle;
+
+            bool await_ready() noexcept
+            {
+                return !handle || handle.done();
+            }
+
+            std::coroutine_handle<> await_suspend(std::coroutine_handle<> awaiting) noexcept
+            {
+                handle.promise().continuation = awaiting;
+                // start the lazy task right away on this thread
+                return handle;
+            }
+
+            T await_resume()
+            {
+                return handle.promise().result();
+            }
+        };
+        return Awaiter{_handle};
+    }
+
+private:
+    std::coroutine_handle<promise_type> _handle{nullptr};
+};
+
+template <typename T>
+Task<T> TaskPromise<T>::get_return_object() noexcept
+{
+    return Task<T>{std::coroutine_handle<TaskPromise<T>>::from_promise(*this)};
+}
+
+inline Task<void> TaskPromise<void>::get_return_object() noexcept
+{
+    return Task<void>{std::coroutine_handle<TaskPromise<void>>::from_promise(*this)};
+}
+
+// eager coroutine owning itself, the frame is freed when it runs to the end
+// only used to drive Tasks from non-coroutine code
+struct DetachedCoroutine
+{
+    struct promise_type
+    {
+        DetachedCoroutine get_return_object() noexcept
+        {
+            return {};
+        }
+
+        std::suspend_never initial_suspend() noexcept
+        {
+            return {};
+        }
+
+        std::suspend_never final_suspend() noexcept
+        {
+            return {};
+        }
+
+        void return_void() noexcept
+        {
+        }
+
+        void unhandled_exception() noexcept
+        {
+            std::terminate();
+        }
+    };
+};
+
+// executors: how a coroutine handle is resumed on them
+inline void scheduleResume(JobSystem &jobSystem, std::coroutine_handle<> h)
+{
+    jobSystem.run("coroutine", [h]()
+                  { h.resume(); });
+}
+
+// single-threaded io workers fed by a queue (QueueLockFree/QueueThreadSafe of packaged_task)
+template <typename Queue>
+    requires requires(Queue &queue, std::packaged_task<void(void)> task) { queue.push(std::move(task)); }
+void scheduleResume(Queue &queue, std::coroutine_handle<> h)
+{
+    queue.push(std::packaged_task<void(void)>([h]()
+                                              { h.resume(); }));
+}
+
+template <typename Executor>
+struct ResumeOnAwaiter
+{
+    Executor &executor;
+
+    bool await_ready() noexcept
+    {
+        return false;
+    }
+
+    void await_suspend(std::coroutine_handle<> h)
+    {
+        scheduleResume(executor, h);
+    }
+
+    void await_resume() noexcept
+    {
+    }
+};
+
+// co_await resumeOn(JobSystem::get()); the rest of the coroutine runs on a job worker
+template <typename Executor>
+ResumeOnAwaiter<Executor> resumeOn(Executor &executor)
+{
+    return ResumeOnAwaiter<Executor>{executor};
+}
+
+// the tasks start on the awaiting thread and run until their first hop/suspension,
+// the awaiting coroutine is resumed by whichever task completes last
+inline Task<void> whenAll(std::vector<Task<void>> tasks)
+{
+    struct WhenAllAwaiter
+    {
+        std::vector<Task<void>> &tasks;
+        // +1 held by await_suspend itself, so that no child resumes us before we are suspended
+        std::atomic<size_t> remaining{0};
+        std::coroutine_handle<> continuation;
+        std::mutex exceptionMux;
+        std::exception_ptr exception;
+
+        static DetachedCoroutine runChild(Task<void> &task, WhenAllAwaiter *self)
+        {
+            try
+            {
+                co_await std::move(task);
+            }
+            catch (...)
+            {
+                std::scoped_lock lock{self->exceptionMux};
+                self->exception = std::current_exception();
+            }
+            if (self->remaining.fetch_sub(1, std::memory_order_acq_rel) == 1)
+            {
+                self->continuation.resume();
+            }
+        }
+
+        bool await_ready() noexcept
+        {
+            return tasks.empty();
+        }
+
+        bool await_suspend(std::coroutine_handle<> h)
+        {
+            continuation = h;
+            remaining.store(tasks.size() + 1, std::memory_order_relaxed);
+            for (auto &task : tasks)
+            {
+                runChild(task, this);
+            }
+            // false: every child completed synchronously, keep going without suspending
+            return remaining.fetch_sub(1, std::memory_order_acq_rel) != 1;
+        }
+
+        void await_resume()
+        {
+            if (exception)
+            {
+                std::rethrow_exception(exception);
+            }
+        }
+    };
+
+    co_await WhenAllAwaiter{tasks};
+}
+
+// blocking, never call it from a job worker that the task needs
+template <typename T>
+T syncWait(Task<T> task)
+{
+    struct SyncState
+    {
+        std::mutex mux;
+        std::condition_variable cv;
+        bool done{false};
+        std::optional<std::conditional_t<std::is_void_v<T>, bool, T>> result;
+        std::exception_ptr exception;
+    };
+    SyncState state;
+    [](Task<T> &task, SyncState &state) -> DetachedCoroutine
+    {
+        try
+        {
+            if constexpr (std::is_void_v<T>)
+            {
+                co_await std::move(task);
+                state.result.emplace(true);
+            }
+            else
+            {
+                state.result.emplace(co_await std::move(task));
+            }
+        }
+        catch (...)
+        {
+            state.exception = std::current_exception();
+        }
+        // notify under the lock: state lives on the stack of the waiting thread
+        std::scoped_lock lock{state.mux};
+        state.done = true;
+        state.cv.notify_one();
+    }(task, state);
+
+    {
+        std::unique_lock lock{state.mux};
+        state.cv.wait(lock, [&state]()
+                      { return state.done; });
+    }
+    if (state.exception)
+    {
+        std::rethrow_exception(state.exception);
+    }
+    if constexpr (!std::is_void_v<T>)
+    {
+        return std::move(*state.result);
+    }
+}
+
+// owns fire-and-forget tasks; join() blocks until every spawned task is done
+class AsyncScope
+{
+public:
+    AsyncScope() = default;
+    AsyncScope(const AsyncScope &other) = delete;
+    AsyncScope &operator=(const AsyncScope &other) = delete;
+
+    ~AsyncScope()
+    {
+        join();
+    }
+
+    // runs on the calling thread until the first suspension
+    void spawn(Task<void> task)
+    {
+        {
+            std::scoped_lock lock{_mux};
+            ++_pending;
+        }
+        run(std::move(task), this);
+    }
+
+    void join()
+    {
+        std::unique_lock lock{_mux};
+        _cv.wait(lock, [this]()
+                 { return _pending == 0; });
+    }
+
+private:
+    static DetachedCoroutine run(Task<void> task, AsyncScope *scope)
+    {
+        co_await std::move(task);
+        // notify under the lock: join() may destroy the scope as soon as it can take the lock
+        std::scoped_lock lock{scope->_mux};
+        if (--scope->_pending == 0)
+        {
+            scope->_cv.notify_all();
+        }
+    }
+
+    std::mutex _mux;
+    std::condition_variable _cv;
+    size_t _pending{0};
+};
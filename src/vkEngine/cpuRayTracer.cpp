@@ -0,0 +1,648 @@
+#include <algorithm>
+#include <chrono>
+#include <limits>
+
+#include <tracy/Tracy.hpp>
+
+#include <cpuRayTracer.h>
+#include <jobSystem.h>
+
+// lanes of a ray packet: avx2 8, sse2 4, plain loops 4 elsewhere (arm: the compiler vectorizes them)
+// avx2, not avx: maskFromBits needs the 256-bit integer ops, see VKENGINE_SIMD_ISA
+#if defined(__AVX2__)
+#include <immintrin.h>
+
+static constexpr uint32_t SIMD_WIDTH = 8;
+
+struct SimdMask
+{
+    __m256 v;
+};
+
+struct SimdFloat
+{
+    __m256 v;
+    static SimdFloat broadcast(float f)
+    {
+        return {_mm256_set1_ps(f)};
+    }
+    static SimdFloat load(const float *p)
+    {
+        return {_mm256_loadu_ps(p)};
+    }
+    void store(float *p) const
+    {
+        _mm256_storeu_ps(p, v);
+    }
+};
+
+static inline SimdFloat operator+(SimdFloat a, SimdFloat b) { return {_mm256_add_ps(a.v, b.v)}; }
+static inline SimdFloat operator-(SimdFloat a, SimdFloat b) { return {_mm256_sub_ps(a.v, b.v)}; }
+static inline SimdFloat operator*(SimdFloat a, SimdFloat b) { return {_mm256_mul_ps(a.v, b.v)}; }
+static inline SimdFloat operator/(SimdFloat a, SimdFloat b) { return {_mm256_div_ps(a.v, b.v)}; }
+static inline SimdFloat simdMin(SimdFloat a, SimdFloat b) { return {_mm256_min_ps(a.v, b.v)}; }
+static inline SimdFloat simdMax(SimdFloat a, SimdFloat b) { return {_mm256_max_ps(a.v, b.v)}; }
+static inline SimdMask operator<(SimdFloat a, SimdFloat b) { return {_mm256_cmp_ps(a.v, b.v, _CMP_LT_OQ)}; }
+static inline SimdMask operator<=(SimdFloat a, SimdFloat b) { return {_mm256_cmp_ps(a.v, b.v, _CMP_LE_OQ)}; }
+static inline SimdMask operator>(SimdFloat a, SimdFloat b) { return {_mm256_cmp_ps(a.v, b.v, _CMP_GT_OQ)}; }
+static inline SimdMask operator>=(SimdFloat a, SimdFloat b) { return {_mm256_cmp_ps(a.v, b.v, _CMP_GE_OQ)}; }
+static inline SimdMask operator&(SimdMask a, SimdMask b) { return {_mm256_and_ps(a.v, b.v)}; }
+static inline SimdFloat select(SimdMask m, SimdFloat a, SimdFloat b) { return {_mm256_blendv_ps(b.v, a.v, m.v)}; }
+// bit i: lane i
+static inline uint32_t laneBits(SimdMask m) { return static_cast<uint32_t>(_mm256_movemask_ps(m.v)); }
+static inline SimdMask maskFromBits(uint32_t bits)
+{
+    const __m256i lanes = _mm256_setr_epi32(1, 2, 4, 8, 16, 32, 64, 128);
+    const __m256i selected = _mm256_and_si256(_mm256_set1_epi32(static_cast<int>(bits)), lanes);
+    return {_mm256_castsi256_ps(_mm256_cmpeq_epi32(selected, lanes))};
+}
+
+#elif defined(__SSE2__) || defined(_M_X64)
+#include <emmintrin.h>
+
+static constexpr uint32_t SIMD_WIDTH = 4;
+
+struct SimdMask
+{
+    __m128 v;
+};
+
+struct SimdFloat
+{
+    __m128 v;
+    static SimdFloat broadcast(float f)
+    {
+        return {_mm_set1_ps(f)};
+    }
+    static SimdFloat load(const float *p)
+    {
+        return {_mm_loadu_ps(p)};
+    }
+    void store(float *p) const
+    {
+        _mm_storeu_ps(p, v);
+    }
+};
+
+static inline SimdFloat operator+(SimdFloat a, SimdFloat b) { return {_mm_add_ps(a.v, b.v)}; }
+static inline SimdFloat operator-(SimdFloat a, SimdFloat b) { return {_mm_sub_ps(a.v, b.v)}; }
+static inline SimdFloat operator*(SimdFloat a, SimdFloat b) { return {_mm_mul_ps(a.v, b.v)}; }
+static inline SimdFloat operator/(SimdFloat a, SimdFloat b) { return {_mm_div_ps(a.v, b.v)}; }
+static inline SimdFloat simdMin(SimdFloat a, SimdFloat b) { return {_mm_min_ps(a.v, b.v)}; }
+static inline SimdFloat simdMax(SimdFloat a, SimdFloat b) { return {_mm_max_ps(a.v, b.v)}; }
+static inline SimdMask operator<(SimdFloat a, SimdFloat b) { return {_mm_cmplt_ps(a.v, b.v)}; }
+static inline SimdMask operator<=(SimdFloat a, SimdFloat b) { return {_mm_cmple_ps(a.v, b.v)}; }
+static inline SimdMask operator>(SimdFloat a, SimdFloat b) { return {_mm_cmpgt_ps(a.v, b.v)}; }
+static inline SimdMask operator>=(SimdFloat a, SimdFloat b) { return {_mm_cmpge_ps(a.v, b.v)}; }
+static inline SimdMask operator&(SimdMask a, SimdMask b) { return {_mm_and_ps(a.v, b.v)}; }
+// no blendv before sse4.1
+static inline SimdFloat select(SimdMask m, SimdFloat a, SimdFloat b) { return {_mm_or_ps(_mm_and_ps(m.v, a.v), _mm_andnot_ps(m.v, b.v))}; }
+static inline uint32_t laneBits(SimdMask m) { return static_cast<uint32_t>(_mm_movemask_ps(m.v)); }
+static inline SimdMask maskFromBits(uint32_t bits)
+{
+    const __m128i lanes = _mm_setr_epi32(1, 2, 4, 8);
+    const __m128i selected = _mm_and_si128(_mm_set1_epi32(static_cast<int>(bits)), lanes);
+    return {_mm_castsi128_ps(_mm_cmpeq_epi32(selected, lanes))};
+}
+
+#else
+
+static constexpr uint32_t SIMD_WIDTH = 4;
+
+struct SimdMask
+{
+    bool v[SIMD_WIDTH];
+};
+
+struct SimdFloat
+{
+    float v[SIMD_WIDTH];
+    static SimdFloat broadcast(float f)
+    {
+        return {{f, f, f, f}};
+    }
+    static SimdFloat load(const float *p)
+    {
+        return {{p[0], p[1], p[2], p[3]}};
+    }
+    void store(float *p) const
+    {
+        std::copy(v, v + SIMD_WIDTH, p);
+    }
+};
+
+template <typename Op>
+static inline SimdFloat lanewise(SimdFloat a, SimdFloat b, Op op)
+{
+    SimdFloat res;
+    for (uint32_t i = 0; i < SIMD_WIDTH; ++i)
+        res.v[i] = op(a.v[i], b.v[i]);
+    return res;
+}
+template <typename Op>
+static inline SimdMask compare(SimdFloat a, SimdFloat b, Op op)
+{
+    SimdMask res;
+    for (uint32_t i = 0; i < SIMD_WIDTH; ++i)
+        res.v[i] = op(a.v[i], b.v[i]);
+    return res;
+}
+
+static inline SimdFloat operator+(SimdFloat a, SimdFloat b) { return lanewise(a, b, [](float x, float y) { return x + y; }); }
+static inline SimdFloat operator-(SimdFloat a, SimdFloat b) { return lanewise(a, b, [](float x, float y) { return x - y; }); }
+static inline SimdFloat operator*(SimdFloat a, SimdFloat b) { return lanewise(a, b, [](float x, float y) { return x * y; }); }
+static inline SimdFloat operator/(SimdFloat a, SimdFloat b) { return lanewise(a, b, [](float x, float y) { return x / y; }); }
+static inline SimdFloat simdMin(SimdFloat a, SimdFloat b) { return lanewise(a, b, [](float x, float y) { return x < y ? x : y; }); }
+static inline SimdFloat simdMax(SimdFloat a, SimdFloat b) { return lanewise(a, b, [](float x, float y) { return x > y ? x : y; }); }
+static inline SimdMask operator<(SimdFloat a, SimdFloat b) { return compare(a, b, [](float x, float y) { return x < y; }); }
+static inline SimdMask operator<=(SimdFloat a, SimdFloat b) { return compare(a, b, [](float x, float y) { return x <= y; }); }
+static inline SimdMask operator>(SimdFloat a, SimdFloat b) { return compare(a, b, [](float x, float y) { return x > y; }); }
+static inline SimdMask operator>=(SimdFloat a, SimdFloat b) { return compare(a, b, [](float x, float y) { return x >= y; }); }
+static inline SimdMask operator&(SimdMask a, SimdMask b)
+{
+    SimdMask res;
+    for (uint32_t i = 0; i < SIMD_WIDTH; ++i)
+        res.v[i] = a.v[i] && b.v[i];
+    return res;
+}
+static inline SimdFloat select(SimdMask m, SimdFloat a, SimdFloat b)
+{
+    SimdFloat res;
+    for (uint32_t i = 0; i < SIMD_WIDTH; ++i)
+        res.v[i] = m.v[i] ? a.v[i] : b.v[i];
+    return res;
+}
+static inline uint32_t laneBits(SimdMask m)
+{
+    uint32_t bits = 0;
+    for (uint32_t i = 0; i < SIMD_WIDTH; ++i)
+        bits |= m.v[i] ? (1u << i) : 0u;
+    return bits;
+}
+static inline SimdMask maskFromBits(uint32_t bits)
+{
+    SimdMask res;
+    for (uint32_t i = 0; i < SIMD_WIDTH; ++i)
+        res.v[i] = (bits >> i) & 1u;
+    return res;
+}
+
+#endif
+
+// a packet covers PACKET_WIDTH x PACKET_HEIGHT pixels
+static constexpr uint32_t PACKET_HEIGHT = 2;
+static constexpr uint32_t PACKET_WIDTH = SIMD_WIDTH / PACKET_HEIGHT;
+static constexpr uint32_t INVALID_TRIANGLE = ~0u;
+// the traversal stack holds at most depth + 1 nodes
+static constexpr uint32_t MAX_TRAVERSAL_DEPTH = 128;
+// past it the nodes are split at the object median: the count halves every level, the tree stays under
+// MAX_SAH_DEPTH + 32 levels however degenerate the SAH splits get (one triangle peeled off per level)
+static constexpr uint32_t MAX_SAH_DEPTH = MAX_TRAVERSAL_DEPTH / 2;
+// rayGeneration.rgen
+static constexpr float RAY_TMIN = 0.001f;
+static constexpr float RAY_TMAX = 10000.0f;
+
+struct SimdVec3
+{
+    SimdFloat x, y, z;
+    static SimdVec3 broadcast(const glm::vec3 &v)
+    {
+        return {SimdFloat::broadcast(v.x), SimdFloat::broadcast(v.y), SimdFloat::broadcast(v.z)};
+    }
+};
+
+static inline SimdVec3 operator-(const SimdVec3 &a, const SimdVec3 &b) { return {a.x - b.x, a.y - b.y, a.z - b.z}; }
+static inline SimdFloat dot(const SimdVec3 &a, const SimdVec3 &b) { return a.x * b.x + a.y * b.y + a.z * b.z; }
+static inline SimdVec3 cross(const SimdVec3 &a, const SimdVec3 &b)
+{
+    return {a.y * b.z - a.z * b.y, a.z * b.x - a.x * b.z, a.x * b.y - a.y * b.x};
+}
+
+struct RayPacket
+{
+    SimdVec3 origin;
+    SimdVec3 direction;
+    SimdVec3 invDirection;
+    // closest hit so far, RAY_TMAX: none
+    SimdFloat t;
+    SimdFloat u;
+    SimdFloat v;
+    // lanes of the pixels inside the image
+    SimdMask active;
+    uint32_t triangleIds[SIMD_WIDTH];
+    // picks the near child
+    bool negativeDirection[3];
+};
+
+static float surfaceArea(const glm::vec3 &minAABB, const glm::vec3 &maxAABB)
+{
+    const auto e = maxAABB - minAABB;
+    return 2.0f * (e.x * e.y + e.y * e.z + e.z * e.x);
+}
+
+static uint8_t toUnorm8(float f)
+{
+    return static_cast<uint8_t>(std::clamp(f, 0.0f, 1.0f) * 255.0f + 0.5f);
+}
+
+CpuRayTracer::CpuRayTracer(const Scene &scene, const Config &config)
+    : _config(config)
+{
+    ZoneScopedN("CpuRayTracer: build");
+    ASSERT(_config.tileSize % PACKET_WIDTH == 0 && _config.tileSize % PACKET_HEIGHT == 0,
+           "CpuRayTracer: the tile size must be a multiple of the packet size");
+    const auto start = std::chrono::steady_clock::now();
+
+    for (const auto &mesh : scene.meshes)
+    {
+        _meshBasecolors.emplace_back(mesh.materialIdx >= 0 && mesh.materialIdx < static_cast<int32_t>(scene.materials.size())
+                                         ? scene.materials[mesh.materialIdx].basecolor
+                                         : glm::vec4(1.0f));
+    }
+
+    // the merged vb/ib in world space
+    size_t numTriangles = 0;
+    for (const auto &instance : scene.instances)
+    {
+        numTriangles += scene.meshes[instance.meshId].indices.size() / 3;
+    }
+    _triangles.reserve(numTriangles);
+    _triangleMeshIds.reserve(numTriangles);
+    for (const auto &instance : scene.instances)
+    {
+        const auto &mesh = scene.meshes[instance.meshId];
+        const auto position = [&](uint32_t index)
+        {
+            const auto &vertex = mesh.vertices[index];
+            return glm::vec3(instance.transform * glm::vec4(vertex.vx, vertex.vy, vertex.vz, 1.0f));
+        };
+        for (size_t i = 0; i + 2 < mesh.indices.size(); i += 3)
+        {
+            const auto v0 = position(mesh.indices[i]);
+            _triangles.emplace_back(Triangle{
+                .v0 = v0,
+                .e1 = position(mesh.indices[i + 1]) - v0,
+                .e2 = position(mesh.indices[i + 2]) - v0,
+            });
+            _triangleMeshIds.push_back(instance.meshId);
+        }
+    }
+    buildBvh();
+
+    const auto buildMs = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+    log(Level::Info, "CpuRayTracer: ", _triangles.size(), " triangles, ", _nodes.size(), " bvh nodes, ",
+        SIMD_WIDTH, " rays per packet, built in ", buildMs, " ms");
+}
+
+void CpuRayTracer::buildBvh()
+{
+    _nodes.clear();
+    if (_triangles.empty())
+    {
+        return;
+    }
+    const auto numTriangles = static_cast<uint32_t>(_triangles.size());
+    std::vector<glm::vec3> centroids(numTriangles);
+    std::vector<uint32_t> order(numTriangles);
+    for (uint32_t i = 0; i < numTriangles; ++i)
+    {
+        const auto &tri = _triangles[i];
+        centroids[i] = tri.v0 + (tri.e1 + tri.e2) * (1.0f / 3.0f);
+        order[i] = i;
+    }
+    // at most 2n - 1 nodes
+    _nodes.reserve(2 * numTriangles);
+    _nodes.emplace_back();
+    subdivide(0, 0, numTriangles, 0, centroids, order);
+
+    // the leaves address contiguous triangles
+    std::vector<Triangle> triangles(numTriangles);
+    std::vector<uint32_t> triangleMeshIds(numTriangles);
+    for (uint32_t i = 0; i < numTriangles; ++i)
+    {
+        triangles[i] = _triangles[order[i]];
+        triangleMeshIds[i] = _triangleMeshIds[order[i]];
+    }
+    _triangles = std::move(triangles);
+    _triangleMeshIds = std::move(triangleMeshIds);
+}
+
+void CpuRayTracer::subdivide(uint32_t nodeId, uint32_t first, uint32_t count, uint32_t depth,
+                             const std::vector<glm::vec3> &centroids, std::vector<uint32_t> &order)
+{
+    glm::vec3 minAABB{(std::numeric_limits<float>::max)()};
+    glm::vec3 maxAABB{-(std::numeric_limits<float>::max)()};
+    glm::vec3 minCentroid = minAABB;
+    glm::vec3 maxCentroid = maxAABB;
+    for (uint32_t i = first; i < first + count; ++i)
+    {
+        const auto &tri = _triangles[order[i]];
+        for (const auto &p : {tri.v0, tri.v0 + tri.e1, tri.v0 + tri.e2})
+        {
+            minAABB = glm::min(minAABB, p);
+            maxAABB = glm::max(maxAABB, p);
+        }
+        minCentroid = glm::min(minCentroid, centroids[order[i]]);
+        maxCentroid = glm::max(maxCentroid, centroids[order[i]]);
+    }
+    auto &node = _nodes[nodeId];
+    node.minAABB = minAABB;
+    node.maxAABB = maxAABB;
+    node.leftOrFirst = first;
+    node.count = static_cast<uint16_t>((std::min)(count, 0xffffu));
+    node.axis = 0;
+    if (count <= _config.maxLeafSize)
+    {
+        return;
+    }
+    if (depth >= MAX_SAH_DEPTH)
+    {
+        splitAtMedian(nodeId, first, count, depth, minCentroid, maxCentroid, centroids, order);
+        return;
+    }
+
+    // binned SAH: cost = area(left) * count(left) + area(right) * count(right)
+    struct Bin
+    {
+        glm::vec3 minAABB{(std::numeric_limits<float>::max)()};
+        glm::vec3 maxAABB{-(std::numeric_limits<float>::max)()};
+        uint32_t count{0};
+    };
+    const uint32_t numBins = (std::max)(_config.numSahBins, 2u);
+    std::vector<Bin> bins(numBins);
+    std::vector<float> rightCosts(numBins);
+    float bestCost = (std::numeric_limits<float>::max)();
+    int bestAxis = -1;
+    uint32_t bestSplit = 0;
+    for (int axis = 0; axis < 3; ++axis)
+    {
+        const float extent = maxCentroid[axis] - minCentroid[axis];
+        if (extent <= 0.0f)
+        {
+            continue;
+        }
+        std::fill(bins.begin(), bins.end(), Bin{});
+        const float scale = numBins / extent;
+        for (uint32_t i = first; i < first + count; ++i)
+        {
+            const auto binId = (std::min)(static_cast<uint32_t>((centroids[order[i]][axis] - minCentroid[axis]) * scale), numBins - 1);
+            const auto &tri = _triangles[order[i]];
+            for (const auto &p : {tri.v0, tri.v0 + tri.e1, tri.v0 + tri.e2})
+            {
+                bins[binId].minAABB = glm::min(bins[binId].minAABB, p);
+                bins[binId].maxAABB = glm::max(bins[binId].maxAABB, p);
+            }
+            ++bins[binId].count;
+        }
+        // sweep from the right, then from the left: split s puts bins [0, s) on the left
+        Bin right;
+        for (uint32_t s = numBins - 1; s > 0; --s)
+        {
+            right.minAABB = glm::min(right.minAABB, bins[s].minAABB);
+            right.maxAABB = glm::max(right.maxAABB, bins[s].maxAABB);
+            right.count += bins[s].count;
+            rightCosts[s] = right.count ? surfaceArea(right.minAABB, right.maxAABB) * right.count : 0.0f;
+        }
+        Bin left;
+        for (uint32_t s = 1; s < numBins; ++s)
+        {
+            left.minAABB = glm::min(left.minAABB, bins[s - 1].minAABB);
+            left.maxAABB = glm::max(left.maxAABB, bins[s - 1].maxAABB);
+            left.count += bins[s - 1].count;
+            if (left.count == 0 || left.count == count)
+            {
+                continue;
+            }
+            const float cost = surfaceArea(left.minAABB, left.maxAABB) * left.count + rightCosts[s];
+            if (cost < bestCost)
+            {
+                bestCost = cost;
+                bestAxis = axis;
+                bestSplit = s;
+            }
+        }
+    }
+    // all the centroids in one point, or splitting costs more than intersecting them all (small nodes only)
+    const float leafCost = surfaceArea(minAABB, maxAABB) * count;
+    if (bestAxis < 0 && count > 0xffff)
+    {
+        // one point, but too many triangles for a leaf
+        splitAtMedian(nodeId, first, count, depth, minCentroid, maxCentroid, centroids, order);
+        return;
+    }
+    if (bestAxis < 0 || (bestCost >= leafCost && count <= 4 * _config.maxLeafSize))
+    {
+        return;
+    }
+
+    const float scale = numBins / (maxCentroid[bestAxis] - minCentroid[bestAxis]);
+    const auto middle = std::partition(order.begin() + first, order.begin() + first + count, [&](uint32_t triangleId)
+                                       { return (std::min)(static_cast<uint32_t>((centroids[triangleId][bestAxis] - minCentroid[bestAxis]) * scale), numBins - 1) < bestSplit; });
+    const auto leftCount = static_cast<uint32_t>(middle - (order.begin() + first));
+
+    const auto leftId = static_cast<uint32_t>(_nodes.size());
+    _nodes.emplace_back();
+    _nodes.emplace_back();
+    // emplace_back might have moved the nodes
+    _nodes[nodeId].leftOrFirst = leftId;
+    _nodes[nodeId].count = 0;
+    _nodes[nodeId].axis = static_cast<uint16_t>(bestAxis);
+    subdivide(leftId, first, leftCount, depth + 1, centroids, order);
+    subdivide(leftId + 1, first + leftCount, count - leftCount, depth + 1, centroids, order);
+}
+
+void CpuRayTracer::splitAtMedian(uint32_t nodeId, uint32_t first, uint32_t count, uint32_t depth,
+                                 const glm::vec3 &minCentroid, const glm::vec3 &maxCentroid,
+                                 const std::vector<glm::vec3> &centroids, std::vector<uint32_t> &order)
+{
+    // the widest centroid axis, halves by count
+    const auto extent = maxCentroid - minCentroid;
+    const int axis = extent.x >= extent.y && extent.x >= extent.z ? 0 : (extent.y >= extent.z ? 1 : 2);
+    const uint32_t leftCount = count / 2;
+    std::nth_element(order.begin() + first, order.begin() + first + leftCount, order.begin() + first + count,
+                     [&](uint32_t a, uint32_t b)
+                     { return centroids[a][axis] < centroids[b][axis]; });
+
+    const auto leftId = static_cast<uint32_t>(_nodes.size());
+    _nodes.emplace_back();
+    _nodes.emplace_back();
+    _nodes[nodeId].leftOrFirst = leftId;
+    _nodes[nodeId].count = 0;
+    _nodes[nodeId].axis = static_cast<uint16_t>(axis);
+    subdivide(leftId, first, leftCount, depth + 1, centroids, order);
+    subdivide(leftId + 1, first + leftCount, count - leftCount, depth + 1, centroids, order);
+}
+
+void CpuRayTracer::trace(const UniformCameraProp &camera, uint32_t width, uint32_t height, uint8_t *output) const
+{
+    ZoneScopedN("CpuRayTracer: trace");
+    const uint32_t numTilesX = (width + _config.tileSize - 1) / _config.tileSize;
+    const uint32_t numTilesY = (height + _config.tileSize - 1) / _config.tileSize;
+    JobSystem::get().parallelFor("CpuRayTracer::traceTile", 0, numTilesX * numTilesY, 1, [&](size_t tileId)
+                                 { traceTile(camera, width, height,
+                                             static_cast<uint32_t>(tileId % numTilesX) * _config.tileSize,
+                                             static_cast<uint32_t>(tileId / numTilesX) * _config.tileSize,
+                                             output); });
+}
+
+void CpuRayTracer::traceTile(const UniformCameraProp &camera, uint32_t width, uint32_t height,
+                             uint32_t tileX, uint32_t tileY, uint8_t *output) const
+{
+    const glm::vec3 origin(camera.viewInverse * glm::vec4(0, 0, 0, 1));
+    const uint32_t tileEndX = (std::min)(tileX + _config.tileSize, width);
+    const uint32_t tileEndY = (std::min)(tileY + _config.tileSize, height);
+    uint32_t stack[MAX_TRAVERSAL_DEPTH];
+
+    for (uint32_t packetY = tileY; packetY < tileEndY; packetY += PACKET_HEIGHT)
+    {
+        for (uint32_t packetX = tileX; packetX < tileEndX; packetX += PACKET_WIDTH)
+        {
+            // 1. primary rays, rayGeneration.rgen
+            float dx[SIMD_WIDTH], dy[SIMD_WIDTH], dz[SIMD_WIDTH];
+            uint32_t activeBits = 0;
+            for (uint32_t lane = 0; lane < SIMD_WIDTH; ++lane)
+            {
+                const uint32_t x = packetX + lane % PACKET_WIDTH;
+                const uint32_t y = packetY + lane / PACKET_WIDTH;
+                activeBits |= (x < tileEndX && y < tileEndY) ? (1u << lane) : 0u;
+                const glm::vec2 inUV = (glm::vec2(x, y) + glm::vec2(0.5f)) / glm::vec2(width, height);
+                const glm::vec2 d = inUV * 2.0f - 1.0f;
+                const glm::vec4 target = camera.projInverse * glm::vec4(d.x, d.y, 1, 1);
+                const glm::vec3 direction(camera.viewInverse * glm::vec4(glm::normalize(glm::vec3(target)), 0));
+                dx[lane] = direction.x;
+                dy[lane] = direction.y;
+                dz[lane] = direction.z;
+            }
+            RayPacket packet;
+            packet.origin = SimdVec3::broadcast(origin);
+            packet.direction = {SimdFloat::load(dx), SimdFloat::load(dy), SimdFloat::load(dz)};
+            const auto one = SimdFloat::broadcast(1.0f);
+            packet.invDirection = {one / packet.direction.x, one / packet.direction.y, one / packet.direction.z};
+            packet.t = SimdFloat::broadcast(RAY_TMAX);
+            packet.u = SimdFloat::broadcast(0.0f);
+            packet.v = SimdFloat::broadcast(0.0f);
+            packet.active = maskFromBits(activeBits);
+            std::fill(packet.triangleIds, packet.triangleIds + SIMD_WIDTH, INVALID_TRIANGLE);
+            packet.negativeDirection[0] = dx[0] < 0.0f;
+            packet.negativeDirection[1] = dy[0] < 0.0f;
+            packet.negativeDirection[2] = dz[0] < 0.0f;
+
+            // 2. closest hit, the lanes share the traversal
+            const auto tmin = SimdFloat::broadcast(RAY_TMIN);
+            uint32_t stackSize = 0;
+            if (!_nodes.empty())
+            {
+                stack[stackSize++] = 0;
+            }
+            while (stackSize > 0)
+            {
+                const auto &node = _nodes[stack[--stackSize]];
+                // slab test
+                const auto t0x = (SimdFloat::broadcast(node.minAABB.x) - packet.origin.x) * packet.invDirection.x;
+                const auto t1x = (SimdFloat::broadcast(node.maxAABB.x) - packet.origin.x) * packet.invDirection.x;
+                const auto t0y = (SimdFloat::broadcast(node.minAABB.y) - packet.origin.y) * packet.invDirection.y;
+                const auto t1y = (SimdFloat::broadcast(node.maxAABB.y) - packet.origin.y) * packet.invDirection.y;
+                const auto t0z = (SimdFloat::broadcast(node.minAABB.z) - packet.origin.z) * packet.invDirection.z;
+                const auto t1z = (SimdFloat::broadcast(node.maxAABB.z) - packet.origin.z) * packet.invDirection.z;
+                const auto tNear = simdMax(simdMax(simdMin(t0x, t1x), simdMin(t0y, t1y)), simdMax(simdMin(t0z, t1z), tmin));
+                const auto tFar = simdMin(simdMin(simdMax(t0x, t1x), simdMax(t0y, t1y)), simdMin(simdMax(t0z, t1z), packet.t));
+                if (laneBits((tNear <= tFar) & packet.active) == 0)
+                {
+                    continue;
+                }
+
+                if (node.count == 0)
+                {
+                    // near child on top
+                    const bool rightFirst = packet.negativeDirection[node.axis];
+                    ASSERT(stackSize + 2 <= MAX_TRAVERSAL_DEPTH, "CpuRayTracer: traversal stack overflow");
+                    stack[stackSize++] = rightFirst ? node.leftOrFirst : node.leftOrFirst + 1;
+                    stack[stackSize++] = rightFirst ? node.leftOrFirst + 1 : node.leftOrFirst;
+                    continue;
+                }
+
+                // Moller-Trumbore, every lane against one triangle at a time
+                for (uint32_t triangleId = node.leftOrFirst; triangleId < node.leftOrFirst + node.count; ++triangleId)
+                {
+                    const auto &tri = _triangles[triangleId];
+                    const auto e1 = SimdVec3::broadcast(tri.e1);
+                    const auto e2 = SimdVec3::broadcast(tri.e2);
+                    const auto pvec = cross(packet.direction, e2);
+                    const auto det = dot(e1, pvec);
+                    const auto invDet = one / det;
+                    const auto tvec = packet.origin - SimdVec3::broadcast(tri.v0);
+                    const auto u = dot(tvec, pvec) * invDet;
+                    const auto qvec = cross(tvec, e1);
+                    const auto v = dot(packet.direction, qvec) * invDet;
+                    const auto t = dot(e2, qvec) * invDet;
+                    const auto zero = SimdFloat::broadcast(0.0f);
+                    const auto hit = (det * det > SimdFloat::broadcast(1e-16f)) &
+                                     (u >= zero) & (v >= zero) & (u + v <= one) &
+                                     (t > tmin) & (t < packet.t) & packet.active;
+                    const auto hitBits = laneBits(hit);
+                    if (hitBits == 0)
+                    {
+                        continue;
+                    }
+                    packet.t = select(hit, t, packet.t);
+                    packet.u = select(hit, u, packet.u);
+                    packet.v = select(hit, v, packet.v);
+                    for (uint32_t lane = 0; lane < SIMD_WIDTH; ++lane)
+                    {
+                        if (hitBits & (1u << lane))
+                        {
+                            packet.triangleIds[lane] = triangleId;
+                        }
+                    }
+                }
+            }
+
+            // 3. rayClosestHit.rchit / rayMiss.rmiss, imageStore(vec4(hitValue, 0.0)) into bgra8
+            float us[SIMD_WIDTH], vs[SIMD_WIDTH];
+            packet.u.store(us);
+            packet.v.store(vs);
+            for (uint32_t lane = 0; lane < SIMD_WIDTH; ++lane)
+            {
+                if ((activeBits & (1u << lane)) == 0)
+                {
+                    continue;
+                }
+                glm::vec3 hitValue{0.0f, 0.0f, 0.2f};
+                const auto triangleId = packet.triangleIds[lane];
+                if (triangleId != INVALID_TRIANGLE)
+                {
+                    hitValue = _config.shading == BARYCENTRIC_SHADING
+                                   ? glm::vec3(1.0f - us[lane] - vs[lane], us[lane], vs[lane]) * glm::vec3(_meshBasecolors[_triangleMeshIds[triangleId]])
+                                   : glm::vec3(_meshBasecolors[_triangleMeshIds[triangleId]]);
+                }
+                const uint32_t x = packetX + lane % PACKET_WIDTH;
+                const uint32_t y = packetY + lane / PACKET_WIDTH;
+                auto *texel = output + (static_cast<size_t>(y) * width + x) * 4;
+                texel[0] = toUnorm8(hitValue.z);
+                texel[1] = toUnorm8(hitValue.y);
+                texel[2] = toUnorm8(hitValue.x);
+                texel[3] = 0;
+            }
+        }
+    }
+}
+
+CpuRayTracer::BenchmarkResult CpuRayTracer::benchmark(const UniformCameraProp &camera, uint32_t width, uint32_t height, uint32_t numFrames) const
+{
+    std::vector<uint8_t> image(static_cast<size_t>(width) * height * 4);
+    // warm-up: caches, job workers
+    trace(camera, width, height, image.data());
+
+    const auto start = std::chrono::steady_clock::now();
+    for (uint32_t frame = 0; frame < numFrames; ++frame)
+    {
+        trace(camera, width, height, image.data());
+    }
+    BenchmarkResult result;
+    result.seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    result.numRays = static_cast<uint64_t>(width) * height * numFrames;
+    result.raysPerSecond = result.seconds > 0.0 ? result.numRays / result.seconds : 0.0;
+    log(Level::Info, "CpuRayTracer: ", result.numRays, " rays in ", result.seconds, " s, ",
+        result.raysPerSecond / 1e6, " Mrays/s");
+    return result;
+}
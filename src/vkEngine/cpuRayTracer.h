@@ -0,0 +1,104 @@
+#pragma once
+
+#include <vector>
+#include <cstdint>
+
+#include <scene.h>
+
+// software fallback of RayTracing, for the render nodes without VK_KHR_ray_tracing_pipeline
+// same contract as rayGeneration.rgen / rayClosestHit.rchit / rayMiss.rmiss: one primary ray per pixel from
+// UniformCameraProp, closest hit -> barycentrics * basecolor (or the basecolor alone), miss -> (0, 0, 0.2)
+// the alpha test of the any hit shader is not replicated: every triangle is opaque
+// 1. the instances are flattened into world space triangles: the merged vb/ib, one copy per instance
+// 2. binned SAH BVH over the triangles, the two children of a node next to each other
+// 3. packets of coherent rays (a 4x2 block of pixels with avx2, 2x2 otherwise) traverse the BVH together,
+//    one SIMD lane per ray: a node is visited while any active lane overlaps it
+// 4. the image is cut into tiles, one job per tile
+// the scene is read by the ctor only
+class CpuRayTracer
+{
+public:
+    enum SHADING_MODE
+    {
+        // rayClosestHit.rchit: barycentrics * Material::basecolor
+        BARYCENTRIC_SHADING,
+        // Material::basecolor of the mesh
+        BASECOLOR_SHADING,
+    };
+
+    struct Config
+    {
+        // multiple of the packet size
+        uint32_t tileSize{32};
+        uint32_t maxLeafSize{4};
+        uint32_t numSahBins{16};
+        SHADING_MODE shading{BARYCENTRIC_SHADING};
+    };
+
+    struct BenchmarkResult
+    {
+        uint64_t numRays{0};
+        double seconds{0.0};
+        double raysPerSecond{0.0};
+    };
+
+    CpuRayTracer() = delete;
+    CpuRayTracer(const Scene &scene, const Config &config);
+
+    CpuRayTracer(const CpuRayTracer &other) = delete;
+    CpuRayTracer &operator=(const CpuRayTracer &other) = delete;
+
+    // output: width * height texels, the layout of the rt output image (VK_FORMAT_B8G8R8A8_UNORM, tightly packed)
+    void trace(const UniformCameraProp &camera, uint32_t width, uint32_t height, uint8_t *output) const;
+    // traces numFrames images of width * height primary rays
+    BenchmarkResult benchmark(const UniformCameraProp &camera, uint32_t width, uint32_t height, uint32_t numFrames) const;
+
+    size_t numTriangles() const
+    {
+        return _triangles.size();
+    }
+    size_t numNodes() const
+    {
+        return _nodes.size();
+    }
+
+private:
+    struct Triangle
+    {
+        glm::vec3 v0;
+        // v1 - v0, v2 - v0
+        glm::vec3 e1;
+        glm::vec3 e2;
+    };
+
+    // 32 bytes
+    struct BvhNode
+    {
+        glm::vec3 minAABB;
+        // interior: left child, the right one follows. leaf: first triangle
+        uint32_t leftOrFirst;
+        glm::vec3 maxAABB;
+        // 0: interior
+        uint16_t count;
+        // split axis of an interior node, picks the near child
+        uint16_t axis;
+    };
+
+    void buildBvh();
+    void subdivide(uint32_t nodeId, uint32_t first, uint32_t count, uint32_t depth,
+                   const std::vector<glm::vec3> &centroids, std::vector<uint32_t> &order);
+    // object median on the widest centroid axis, bounds the depth of degenerate trees
+    void splitAtMedian(uint32_t nodeId, uint32_t first, uint32_t count, uint32_t depth,
+                       const glm::vec3 &minCentroid, const glm::vec3 &maxCentroid,
+                       const std::vector<glm::vec3> &centroids, std::vector<uint32_t> &order);
+    void traceTile(const UniformCameraProp &camera, uint32_t width, uint32_t height,
+                   uint32_t tileX, uint32_t tileY, uint8_t *output) const;
+
+    const Config _config;
+    std::vector<Triangle> _triangles;
+    // per triangle
+    std::vector<uint32_t> _triangleMeshIds;
+    // per mesh, BASECOLOR_SHADING
+    std::vector<glm::vec4> _meshBasecolors;
+    std::vector<BvhNode> _nodes;
+};
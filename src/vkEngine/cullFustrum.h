@@ -15,7 +15,8 @@ class CullFustrum : public RenderPassBase,
                     public VkContextAccessor,
                     public SceneAccessor,
                     public CameraAccessor,
-                    public DescriptorPoolAccessor
+                    public DescriptorPoolAccessor,
+                    public FrameAllocatorAccessor
 {
 public:
     CullFustrum()
@@ -66,6 +67,16 @@ public:
         return _dsPool;
     }
 
+    virtual void setFrameAllocator(FrameAllocator *frameAllocator) override
+    {
+        _frameAllocator = frameAllocator;
+    }
+
+    virtual const FrameAllocator &frameAllocator() const override
+    {
+        return *_frameAllocator;
+    }
+
     // algorithm specific
     // indirectDrawBuffer to be cull against
     inline void setIndirectDrawBuffer(BufferEntity *idb)
@@ -80,7 +91,6 @@ public:
         initComputePipeline();
         allocateDescriptorSets();
 
-        initFustrumBuffer();
         initMeshBoundingBoxBuffer();
         initCulledIndirectDrawBuffer();
         // step1: bind res to ds, then later on bind ds to the compute pipeline
@@ -102,36 +112,15 @@ public:
     virtual void execute(CommandBufferEntity cmd, int currentFrameId) override
     {
         auto commandBufferHandle = std::get<1>(cmd);
-        // for buffer memory barrier (two idr which shader writes into)
-        // shared compute/graphics queue family
-        auto commandQueueFamilyIndex = std::get<3>(cmd);
         auto computePipelineHandle = std::get<0>(_computePipelineEntity);
         auto computePipelineLayout = std::get<1>(_computePipelineEntity);
-        auto vmaAllocator = _ctx->getVmaAllocator();
-
-        const auto &fustrumBuffers = std::get<0>(_fustrumBuffers);
         ASSERT(
-            currentFrameId >= 0 && currentFrameId < fustrumBuffers.size(),
-            "execute:: currentFrameId should be in a valid range");
+            _frameAllocator->currentFrameId() == currentFrameId,
+            "execute:: the frame allocator should be on currentFrameId");
 
-        auto vmaAllocation = std::get<1>(fustrumBuffers[currentFrameId]);
-        auto mappedMemory = std::get<3>(fustrumBuffers[currentFrameId]);
-
-        // update uniform buffer
+        // update uniform buffer: transient, one dynamic offset into this frame's buffer
         auto frustrum = _camera->fustrumPlanes();
-        if (mappedMemory)
-        {
-            memcpy(mappedMemory, &frustrum, sizeof(Fustrum));
-        }
-        else
-        {
-            // racing condition due to vmaAllocator
-            void *mappedMemory{nullptr};
-            VK_CHECK(vmaMapMemory(vmaAllocator, vmaAllocation, &mappedMemory));
-            memcpy(mappedMemory, &frustrum, sizeof(Fustrum));
-            // memcpy(mappedMemory, &ubo, sizeof(ubo));
-            vmaUnmapMemory(vmaAllocator, vmaAllocation);
-        }
+        const auto fustrumAllocation = _frameAllocator->push(frustrum);
         // update push constants
         const auto numMeshesToCull = uint32_t(_bb.size());
         vkCmdBindPipeline(commandBufferHandle, VK_PIPELINE_BIND_POINT_COMPUTE, computePipelineHandle);
@@ -160,8 +149,8 @@ public:
                                 VK_PIPELINE_BIND_POINT_COMPUTE,
                                 computePipelineLayout, 2, 1,
                                 &_descriptorSets[&_descriptorSetLayouts[DESC_LAYOUT_SEMANTIC::FUSTRUMS]][currentFrameId],
-                                0,
-                                nullptr);
+                                1,
+                                &fustrumAllocation.offset);
         vkCmdBindDescriptorSets(commandBufferHandle,
                                 VK_PIPELINE_BIND_POINT_COMPUTE,
                                 computePipelineLayout, 3, 1,
@@ -177,42 +166,8 @@ public:
         // thread group x,y,z
         vkCmdDispatch(commandBufferHandle, (numMeshesToCull / 64) + 1, 1, 1);
 
-        const auto culledIDRBufferHandle = std::get<0>(_culledIndirectDrawBuffer);
-        const auto culledIDRBufferSizeInBytes = std::get<4>(_culledIndirectDrawBuffer);
-        const auto culledIDRCountBufferHandle = std::get<0>(_culledIndirectDrawCountBuffer);
-        const auto culledIDRCountBufferSizeInBytes = std::get<4>(_culledIndirectDrawCountBuffer);
-
-        // from shader write to idr buffer read
-        std::array<VkBufferMemoryBarrier, 2> bufferMemoryBarriers{
-            VkBufferMemoryBarrier{
-                .sType = VK_STRUCTURE_TYPE_BUFFER_MEMORY_BARRIER,
-                .srcAccessMask = VK_ACCESS_SHADER_WRITE_BIT,
-                .dstAccessMask = VK_ACCESS_INDIRECT_COMMAND_READ_BIT,
-                .srcQueueFamilyIndex = commandQueueFamilyIndex,
-                .dstQueueFamilyIndex = commandQueueFamilyIndex,
-                .buffer = culledIDRBufferHandle,
-                .size = culledIDRBufferSizeInBytes,
-            },
-            VkBufferMemoryBarrier{
-                .sType = VK_STRUCTURE_TYPE_BUFFER_MEMORY_BARRIER,
-                .srcAccessMask = VK_ACCESS_SHADER_WRITE_BIT,
-                .dstAccessMask = VK_ACCESS_INDIRECT_COMMAND_READ_BIT,
-                .srcQueueFamilyIndex = commandQueueFamilyIndex,
-                .dstQueueFamilyIndex = commandQueueFamilyIndex,
-                .buffer = culledIDRCountBufferHandle,
-                .size = culledIDRCountBufferSizeInBytes,
-            },
-        };
-
-        vkCmdPipelineBarrier(
-            commandBufferHandle,
-            VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT,
-            VK_PIPELINE_STAGE_DRAW_INDIRECT_BIT,
-            0,
-            0, nullptr,                                                         // memory
-            (uint32_t)bufferMemoryBarriers.size(), bufferMemoryBarriers.data(), // buffer
-            0, nullptr                                                          // image
-        );
+        // the culled idr/count: compute write -> indirect read, and the WAR against the draws of
+        // the previous frame, are on the render graph (see the pass declaration in the app)
 
         // cpu testing
         for (const auto &bb : _bb)
@@ -251,32 +206,6 @@ private:
             "cullFustrum.comp");
     }
 
-    void initFustrumBuffer()
-    {
-        ASSERT(_ctx, "vk context should be defined");
-        const auto numFramesInFlight = _ctx->getSwapChainImageViews().size();
-
-        // sizeof(Fustrum) * numFramesInFlight
-        std::vector<BufferEntity> buffers;
-        buffers.reserve(numFramesInFlight);
-
-        for (size_t i = 0; i < numFramesInFlight; ++i)
-        {
-            buffers.emplace_back(_ctx->createPersistentBuffer(
-                "Uniform Fustrum Buffer" + std::to_string(i),
-                numFramesInFlight * sizeof(Fustrum),
-                VK_BUFFER_USAGE_UNIFORM_BUFFER_BIT | VK_BUFFER_USAGE_SHADER_DEVICE_ADDRESS_BIT,
-                VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT |
-                    VK_MEMORY_PROPERTY_HOST_COHERENT_BIT |
-                    VK_MEMORY_PROPERTY_HOST_CACHED_BIT,
-                VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT |
-                    VK_MEMORY_PROPERTY_HOST_COHERENT_BIT |
-                    VK_MEMORY_PROPERTY_HOST_CACHED_BIT));
-        }
-
-        _fustrumBuffers = std::make_tuple(buffers, numFramesInFlight);
-    }
-
     void initMeshBoundingBoxBuffer()
     {
         ASSERT(_ctx, "vk context should be defined");
@@ -377,7 +306,7 @@ private:
 
         setBindings[DESC_LAYOUT_SEMANTIC::FUSTRUMS].resize(1);
         setBindings[DESC_LAYOUT_SEMANTIC::FUSTRUMS][0].binding = 0; // depends on the shader: set 0, binding = 0
-        setBindings[DESC_LAYOUT_SEMANTIC::FUSTRUMS][0].descriptorType = VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER;
+        setBindings[DESC_LAYOUT_SEMANTIC::FUSTRUMS][0].descriptorType = VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER_DYNAMIC;
         setBindings[DESC_LAYOUT_SEMANTIC::FUSTRUMS][0].descriptorCount = 1;
         setBindings[DESC_LAYOUT_SEMANTIC::FUSTRUMS][0].stageFlags = VK_SHADER_STAGE_COMPUTE_BIT;
 
@@ -417,7 +346,8 @@ private:
     {
         ASSERT(_ctx, "vk context should be defined");
         ASSERT(_dsPool, "descriptorset pool should be defined");
-        const auto numFramesInFlight = _ctx->getSwapChainImageViews().size();
+        ASSERT(_frameAllocator, "frame allocator should be defined");
+        const auto numFramesInFlight = _frameAllocator->numFramesInFlight();
         _descriptorSets = _ctx->allocateDescriptorSet(_dsPool,
                                                       {{&_descriptorSetLayouts[DESC_LAYOUT_SEMANTIC::IDR],
                                                         1},
@@ -435,7 +365,7 @@ private:
     {
         ASSERT(_ctx, "vk context should be defined");
         auto logicalDevice = _ctx->getLogicDevice();
-        const auto numFramesInFlight = _ctx->getSwapChainImageViews().size();
+        const auto numFramesInFlight = _frameAllocator->numFramesInFlight();
 
         // idr as input (readonly)
         {
@@ -469,20 +399,8 @@ private:
         {
             const auto &dstSets = _descriptorSets[&_descriptorSetLayouts[DESC_LAYOUT_SEMANTIC::FUSTRUMS]];
             ASSERT(dstSets.size() == numFramesInFlight, "FUSTRUMS descriptor set size should equal # of frames in flight");
-            const auto &fustrumBuffers = std::get<0>(_fustrumBuffers);
-            ASSERT(fustrumBuffers.size() == numFramesInFlight, "fustrumBuffers' size should equal # of frames in flight");
-
-            for (size_t i = 0; i < numFramesInFlight; i++)
-            {
-                const auto bufferSizeInBytes = std::get<4>(fustrumBuffers[i]);
-                _ctx->bindBufferToDescriptorSet(
-                    std::get<0>(fustrumBuffers[i]),
-                    0,
-                    bufferSizeInBytes,
-                    _descriptorSets[&_descriptorSetLayouts[DESC_LAYOUT_SEMANTIC::FUSTRUMS]][i],
-                    VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER,
-                    0);
-            }
+            // the frame's buffer, the fustrum of the frame is picked by the dynamic offset
+            _frameAllocator->bindDescriptorSets(dstSets, VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER_DYNAMIC, sizeof(Fustrum));
         }
 
         // culled idr buffer (writable)
@@ -520,7 +438,6 @@ private:
         auto logicalDevice = _ctx->getLogicDevice();
         // this io belongs to the graphics queue, so no explict ownership acq and release needed
         auto cmdBuffersForIO = _ctx->getCommandBufferForIO();
-        auto graphicsComputeQueue = _ctx->getGraphicsComputeQueue();
         _ctx->BeginRecordCommandBuffer(cmdBuffersForIO);
         _ctx->writeBuffer(
             _meshBoundBoxComboStagingBuffer,
@@ -532,29 +449,10 @@ private:
             0);
         _ctx->EndRecordCommandBuffer(cmdBuffersForIO);
 
-        const auto uploadCmdBuffer = std::get<1>(cmdBuffersForIO);
-        const auto uploadCmdBufferFence = std::get<2>(cmdBuffersForIO);
-
-        const VkPipelineStageFlags flags = VK_PIPELINE_STAGE_TRANSFER_BIT;
-        // wait for no body
-        VkSubmitInfo submitInfo{};
-        submitInfo.waitSemaphoreCount = 0;
-        submitInfo.pWaitSemaphores = VK_NULL_HANDLE;
-        // only useful when having waitsemaphore
-        submitInfo.pWaitDstStageMask = &flags;
-        submitInfo.sType = VK_STRUCTURE_TYPE_SUBMIT_INFO;
-        submitInfo.commandBufferCount = 1;
-        submitInfo.pCommandBuffers = &uploadCmdBuffer;
-        // no body needs to be notified
-        submitInfo.signalSemaphoreCount = 0;
-        submitInfo.pSignalSemaphores = VK_NULL_HANDLE;
-
-        VK_CHECK(vkResetFences(logicalDevice, 1, &uploadCmdBufferFence));
-        VK_CHECK(vkQueueSubmit(graphicsComputeQueue, 1, &submitInfo, uploadCmdBufferFence));
+        // through the graphics queue timeline: serialized with the upload workers, no fence
+        const auto uploaded = _ctx->submitCommandBuffer(cmdBuffersForIO);
         // sync io
-        const auto result = vkWaitForFences(logicalDevice, 1, &uploadCmdBufferFence, VK_TRUE,
-                                            100000000000);
-        if (result == VK_TIMEOUT)
+        if (!waitTimelinePoints(logicalDevice, {uploaded}, 100000000000))
         {
             vkDeviceWaitIdle(logicalDevice);
         }
@@ -565,8 +463,6 @@ private:
     // vkCmdDrawIndexedIndirectCount vs vkCmdDrawIndexedIndirect
     // vkCmdDrawIndexedIndirectCount: extra buffer for draw counter, which is filled in in the gpu
     BufferEntity _culledIndirectDrawCountBuffer;
-    // refer to frame in fight
-    std::tuple<std::vector<BufferEntity>, size_t> _fustrumBuffers;
     // interleave all the bounding box of meshes into one big buffer.
     BufferEntity _meshBoundBoxComboDeviceBuffer;
     BufferEntity _meshBoundBoxComboStagingBuffer;
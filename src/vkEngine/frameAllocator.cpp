@@ -0,0 +1,117 @@
+#include <algorithm>
+
+#include <tracy/Tracy.hpp>
+
+#include <frameAllocator.h>
+
+FrameAllocator::FrameAllocator(VkContext &ctx, uint32_t numFramesInFlight, VkDeviceSize capacityPerFrame)
+    : _ctx(ctx), _capacityPerFrame(capacityPerFrame)
+{
+    ASSERT(numFramesInFlight > 0, "FrameAllocator needs at least one frame");
+    // one alignment for every sub-range: the buffer serves both uniform and storage descriptors
+    const auto limits = _ctx.getSelectedPhysicalDeviceProp().limits;
+    _alignment = (std::max)(limits.minUniformBufferOffsetAlignment, limits.minStorageBufferOffsetAlignment);
+    _alignment = (std::max)(_alignment, VkDeviceSize(16));
+    ASSERT((_alignment & (_alignment - 1)) == 0, "buffer offset alignment should be a power of two");
+
+    const auto vmaAllocator = _ctx.getVmaAllocator();
+    _frames.reserve(numFramesInFlight);
+    for (uint32_t i = 0; i < numFramesInFlight; ++i)
+    {
+        // coherent preferred, not required: the writes are flushed otherwise
+        auto buffer = _ctx.createPersistentBuffer(
+            "Frame allocator buffer " + std::to_string(i),
+            _capacityPerFrame,
+            VK_BUFFER_USAGE_UNIFORM_BUFFER_BIT | VK_BUFFER_USAGE_STORAGE_BUFFER_BIT |
+                VK_BUFFER_USAGE_SHADER_DEVICE_ADDRESS_BIT,
+            VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT,
+            VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT);
+        auto *mappedData = static_cast<uint8_t *>(std::get<BUFFER_ENTITY_UID::MAPPING_ADDRESS>(buffer));
+        ASSERT(mappedData, "frame allocator buffer should be persistent-mapped");
+
+        VkMemoryPropertyFlags memoryProperties{0};
+        vmaGetAllocationMemoryProperties(vmaAllocator, std::get<BUFFER_ENTITY_UID::VMA_ALLOCATION>(buffer), &memoryProperties);
+        _coherent = _coherent && (memoryProperties & VK_MEMORY_PROPERTY_HOST_COHERENT_BIT);
+
+        _frames.emplace_back(Frame{buffer, mappedData, std::make_unique<std::atomic<VkDeviceSize>>(0)});
+    }
+    log(Level::Info, "FrameAllocator: ", numFramesInFlight, " x ", _capacityPerFrame, " bytes, alignment ", _alignment,
+        ", coherent: ", _coherent);
+}
+
+FrameAllocator::~FrameAllocator()
+{
+    log(Level::Info, "FrameAllocator: peak ", _peakUsedBytes, " of ", _capacityPerFrame, " bytes per frame");
+    const auto vmaAllocator = _ctx.getVmaAllocator();
+    for (const auto &frame : _frames)
+    {
+        const auto allocation = std::get<BUFFER_ENTITY_UID::VMA_ALLOCATION>(frame.buffer);
+        vmaUnmapMemory(vmaAllocator, allocation);
+        vmaDestroyBuffer(vmaAllocator, std::get<BUFFER_ENTITY_UID::BUFFER>(frame.buffer), allocation);
+    }
+}
+
+void FrameAllocator::beginFrame(uint32_t frameId)
+{
+    ASSERT(frameId < _frames.size(), "beginFrame:: frameId should be in a valid range");
+    // the gpu is done with this frame: the whole buffer is free again
+    _peakUsedBytes = (std::max)(_peakUsedBytes, _frames[_currentFrameId].head->load(std::memory_order_relaxed));
+    TracyPlot("FrameAllocator: bytes per frame", static_cast<int64_t>(_frames[_currentFrameId].head->load(std::memory_order_relaxed)));
+    _currentFrameId = frameId;
+    _frames[_currentFrameId].head->store(0, std::memory_order_relaxed);
+}
+
+FrameAllocation FrameAllocator::allocate(VkDeviceSize sizeInBytes)
+{
+    ASSERT(sizeInBytes > 0, "FrameAllocator: empty allocation");
+    // every size is a multiple of the alignment, so is every offset
+    const auto alignedSize = (sizeInBytes + _alignment - 1) & ~(_alignment - 1);
+    auto &frame = _frames[_currentFrameId];
+    const auto offset = frame.head->fetch_add(alignedSize, std::memory_order_relaxed);
+    ASSERT(offset + alignedSize <= _capacityPerFrame, "FrameAllocator: out of memory for this frame, raise capacityPerFrame");
+    return FrameAllocation{
+        .buffer = std::get<BUFFER_ENTITY_UID::BUFFER>(frame.buffer),
+        .offset = static_cast<uint32_t>(offset),
+        .size = sizeInBytes,
+        .mappedData = frame.mappedData + offset,
+    };
+}
+
+void FrameAllocator::flush()
+{
+    if (_coherent)
+    {
+        return;
+    }
+    const auto &frame = _frames[_currentFrameId];
+    const auto usedBytes = frame.head->load(std::memory_order_acquire);
+    if (usedBytes > 0)
+    {
+        // vma rounds the range to nonCoherentAtomSize
+        VK_CHECK(vmaFlushAllocation(_ctx.getVmaAllocator(), std::get<BUFFER_ENTITY_UID::VMA_ALLOCATION>(frame.buffer), 0, usedBytes));
+    }
+}
+
+void FrameAllocator::bindDescriptorSets(const std::vector<VkDescriptorSet> &dstSets,
+                                        VkDescriptorType descriptorType,
+                                        VkDeviceSize range,
+                                        uint32_t dstBinding) const
+{
+    ASSERT(dstSets.size() == _frames.size(), "one descriptor set per frame in flight");
+    ASSERT(range <= _capacityPerFrame, "the descriptor range should fit in one frame");
+    for (size_t i = 0; i < _frames.size(); ++i)
+    {
+        _ctx.bindBufferToDescriptorSet(
+            std::get<BUFFER_ENTITY_UID::BUFFER>(_frames[i].buffer),
+            0,
+            range,
+            dstSets[i],
+            descriptorType,
+            dstBinding);
+    }
+}
+
+VkDeviceSize FrameAllocator::usedBytes() const
+{
+    return _frames[_currentFrameId].head->load(std::memory_order_relaxed);
+}
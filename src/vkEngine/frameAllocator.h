@@ -0,0 +1,103 @@
+#pragma once
+
+#include <atomic>
+#include <memory>
+#include <vector>
+#include <cstdint>
+#include <cstring>
+
+#include <context.h>
+
+// one sub-range handed out by FrameAllocator for the current frame, already mapped
+// bind with the dynamic offset: vkCmdBindDescriptorSets(..., 1, &allocation.offset)
+struct FrameAllocation
+{
+    VkBuffer buffer{VK_NULL_HANDLE};
+    uint32_t offset{0};
+    VkDeviceSize size{0};
+    // already offset
+    void *mappedData{nullptr};
+};
+
+// linear (bump) allocator for the transient per-frame data: uniforms, dynamic constants
+// one persistently mapped buffer per frame in flight
+// 1. beginFrame() once the frame's command buffer is free again (after BeginRecordCommandBuffer),
+//    everything allocated the last time this frame id was used is given back at once
+// 2. allocate()/push(): aligned to minUniformBufferOffsetAlignment (and the storage one),
+//    the offset goes straight into the dynamic offsets, no map calls, no per-object buffers
+// 3. flush() before the submit, a no-op on host-coherent memory
+// the descriptors are bound once per frame with UNIFORM_BUFFER_DYNAMIC/STORAGE_BUFFER_DYNAMIC and
+// range = the size of one element, see bindDescriptorSets()
+// allocate() is thread-safe, beginFrame()/flush() are render thread only
+class FrameAllocator
+{
+public:
+    static constexpr VkDeviceSize DEFAULT_CAPACITY_PER_FRAME = 1024 * 1024; // 1 MB
+
+    FrameAllocator() = delete;
+    FrameAllocator(VkContext &ctx, uint32_t numFramesInFlight,
+                   VkDeviceSize capacityPerFrame = DEFAULT_CAPACITY_PER_FRAME);
+    ~FrameAllocator();
+
+    FrameAllocator(const FrameAllocator &other) = delete;
+    FrameAllocator &operator=(const FrameAllocator &other) = delete;
+
+    void beginFrame(uint32_t frameId);
+    // sizeInBytes rounded up to alignment()
+    FrameAllocation allocate(VkDeviceSize sizeInBytes);
+    template <typename T>
+    FrameAllocation push(const T &data)
+    {
+        const auto allocation = allocate(sizeof(T));
+        memcpy(allocation.mappedData, &data, sizeof(T));
+        return allocation;
+    }
+    // makes the writes of the current frame visible to the device on non-coherent memory
+    void flush();
+
+    // dstSets[i] -> the buffer of frame i, [0, range)
+    void bindDescriptorSets(const std::vector<VkDescriptorSet> &dstSets,
+                            VkDescriptorType descriptorType,
+                            VkDeviceSize range,
+                            uint32_t dstBinding = 0) const;
+
+    VkBuffer buffer(uint32_t frameId) const
+    {
+        return std::get<BUFFER_ENTITY_UID::BUFFER>(_frames[frameId].buffer);
+    }
+    uint32_t currentFrameId() const
+    {
+        return _currentFrameId;
+    }
+    uint32_t numFramesInFlight() const
+    {
+        return static_cast<uint32_t>(_frames.size());
+    }
+    VkDeviceSize alignment() const
+    {
+        return _alignment;
+    }
+    VkDeviceSize capacityPerFrame() const
+    {
+        return _capacityPerFrame;
+    }
+    // of the current frame
+    VkDeviceSize usedBytes() const;
+
+private:
+    struct Frame
+    {
+        BufferEntity buffer;
+        uint8_t *mappedData{nullptr};
+        // bump pointer, only grows within a frame
+        std::unique_ptr<std::atomic<VkDeviceSize>> head;
+    };
+
+    VkContext &_ctx;
+    const VkDeviceSize _capacityPerFrame;
+    VkDeviceSize _alignment{0};
+    bool _coherent{true};
+    std::vector<Frame> _frames;
+    uint32_t _currentFrameId{0};
+    VkDeviceSize _peakUsedBytes{0};
+};
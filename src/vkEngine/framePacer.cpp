@@ -0,0 +1,59 @@
+#include <algorithm>
+
+#include <tracy/Tracy.hpp>
+
+#include <framePacer.h>
+
+FramePacer::FramePacer(uint32_t framesInFlight, bool pacing, WaitPresentFn waitPresent)
+    : _framesInFlight(framesInFlight), _pacing(pacing), _waitPresent(std::move(waitPresent))
+{
+    ASSERT(_framesInFlight > 0, "FramePacer needs at least one frame in flight");
+    ASSERT(_waitPresent, "FramePacer needs a way to observe the presentation");
+    log(Level::Info, "FramePacer: ", _framesInFlight, " frames in flight, pacing: ", _pacing);
+}
+
+void FramePacer::beginFrame()
+{
+    ZoneScopedN("FramePacer: beginFrame");
+    const auto waitStart = Clock::now();
+    // the frame about to begin would be the (framesInFlight + 1)-th one ahead of the display
+    while (_pacing && _pendingFrames.size() >= _framesInFlight)
+    {
+        const auto frame = _pendingFrames.front();
+        _pendingFrames.pop_front();
+        _waitPresent(frame.presentId, frame.gpuDone, UINT64_MAX);
+        retire(frame, Clock::now());
+    }
+    const auto polled = Clock::now();
+    _stats.pacingWaitMs = std::chrono::duration<double, std::milli>(polled - waitStart).count();
+    TracyPlot("FramePacer: pacing wait (ms)", _stats.pacingWaitMs);
+
+    // presentation is in order: stop at the first frame not presented yet
+    while (!_pendingFrames.empty() && _waitPresent(_pendingFrames.front().presentId, _pendingFrames.front().gpuDone, 0))
+    {
+        retire(_pendingFrames.front(), polled);
+        _pendingFrames.pop_front();
+    }
+
+    ++_presentId;
+    _inputSampled = Clock::now();
+}
+
+void FramePacer::presented(const TimelinePoint &gpuDone)
+{
+    _pendingFrames.emplace_back(PendingFrame{
+        .presentId = _presentId,
+        .gpuDone = gpuDone,
+        .inputSampled = _inputSampled,
+    });
+}
+
+void FramePacer::retire(const PendingFrame &frame, Clock::time_point presentedAt)
+{
+    const double latencyMs = std::chrono::duration<double, std::milli>(presentedAt - frame.inputSampled).count();
+    ++_stats.framesPresented;
+    _stats.lastLatencyMs = latencyMs;
+    _stats.maxLatencyMs = (std::max)(_stats.maxLatencyMs, latencyMs);
+    _stats.averageLatencyMs += (latencyMs - _stats.averageLatencyMs) / static_cast<double>(_stats.framesPresented);
+    TracyPlot("FramePacer: input to present (ms)", latencyMs);
+}
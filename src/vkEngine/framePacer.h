@@ -0,0 +1,89 @@
+#pragma once
+
+#include <chrono>
+#include <deque>
+#include <functional>
+#include <cstdint>
+
+#include <queueTimeline.h>
+
+// runtime latency vs throughput trade-off, see VkContext::setLatencyConfig
+struct LatencyConfig
+{
+    // 1: the cpu waits for the previous frame, lowest latency; 3: most throughput
+    uint32_t framesInFlight{3};
+    // unsupported modes fall back to VK_PRESENT_MODE_FIFO_KHR, always supported
+    VkPresentModeKHR presentMode{VK_PRESENT_MODE_FIFO_KHR};
+    // pace the frames on their presentation: VK_KHR_present_id + VK_KHR_present_wait when requested and supported,
+    // otherwise on the gpu completion of the frame
+    bool pacing{false};
+};
+
+// frame pacing and input-to-present latency
+// 1. beginFrame() before the input is sampled: with pacing, blocks until the frame framesInFlight back
+//    is presented, at most framesInFlight frames are queued ahead of the display
+// 2. presented() once the frame is queued for presentation, with the timeline point of its gpu work
+// 3. the frames are polled on every beginFrame(): input-to-present latency = presentation observed - input sampled
+// "presented" is what the WaitPresentFn says: vkWaitForPresentKHR with a swapchain, the gpu work otherwise
+// (offscreen/headless), the pacing logic is the same
+// render thread only
+class FramePacer
+{
+public:
+    // true once the frame of presentId is presented, false on timeout
+    using WaitPresentFn = std::function<bool(uint64_t presentId, const TimelinePoint &gpuDone, uint64_t timeoutInNs)>;
+
+    struct Stats
+    {
+        uint64_t framesPresented{0};
+        double lastLatencyMs{0.0};
+        double averageLatencyMs{0.0};
+        double maxLatencyMs{0.0};
+        // time blocked in beginFrame()
+        double pacingWaitMs{0.0};
+    };
+
+    FramePacer() = delete;
+    FramePacer(uint32_t framesInFlight, bool pacing, WaitPresentFn waitPresent);
+
+    FramePacer(const FramePacer &other) = delete;
+    FramePacer &operator=(const FramePacer &other) = delete;
+
+    void beginFrame();
+    // id of the frame begun last, > 0, chained to the present with VkPresentIdKHR
+    uint64_t presentId() const
+    {
+        return _presentId;
+    }
+    void presented(const TimelinePoint &gpuDone);
+
+    bool pacing() const
+    {
+        return _pacing;
+    }
+    const Stats &stats() const
+    {
+        return _stats;
+    }
+
+private:
+    using Clock = std::chrono::steady_clock;
+
+    struct PendingFrame
+    {
+        uint64_t presentId{0};
+        TimelinePoint gpuDone;
+        Clock::time_point inputSampled;
+    };
+
+    void retire(const PendingFrame &frame, Clock::time_point presentedAt);
+
+    const uint32_t _framesInFlight;
+    const bool _pacing;
+    WaitPresentFn _waitPresent;
+    uint64_t _presentId{0};
+    Clock::time_point _inputSampled;
+    // queued for presentation, not seen presented yet, oldest first
+    std::deque<PendingFrame> _pendingFrames;
+    Stats _stats;
+};
@@ -1,4 +1,5 @@
 #include <sstream>
+#include <mutex>
 #include <GLTFSDK/GLTF.h>
 #include <GLTFSDK/GLTFResourceReader.h>
 #include <GLTFSDK/GLBResourceReader.h>
@@ -7,6 +8,9 @@
 #include <glb.h>
 
 #include <misc.h>
+#include <jobSystem.h>
+
+#include <tracy/Tracy.hpp>
 
 std::shared_ptr<Scene> GltfBinaryIOReader::read(const std::string &filePath)
 {
@@ -137,249 +141,338 @@ void PrintResourceInfo(const Microsoft::glTF::Document &document,
     }
 }
 
-void readMeshes(const Microsoft::glTF::Document &document,
-                const Microsoft::glTF::GLTFResourceReader &resourceReader,
-                Scene &outputScene)
+// GLBResourceReader seeks and reads one shared stream, reads are serialized
+// everything else of a node (vertex assembly, transform, bounds) runs in parallel
+template <typename T, typename... ARGS>
+std::vector<T> readBinaryDataLocked(std::mutex &readerMutex,
+                                    const Microsoft::glTF::GLTFResourceReader &resourceReader,
+                                    ARGS &&...args)
 {
-    // node: // https://github.com/KhronosGroup/glTF/blob/master/specification/2.0/schema/node.schema.json
-    // every mesh's index and instance offset
-    // while read every mesh, update firstIndex and vertexOffset, bundle into larger buffer
-    uint32_t firstIndex = 0;
-    uint32_t vertexOffset = 0;
-    for (size_t i = 0; i < document.nodes.Size(); ++i)
+    std::scoped_lock lock{readerMutex};
+    return resourceReader.ReadBinaryData<T>(std::forward<ARGS>(args)...);
+}
+
+// nodes's local transformation matrix
+glm::mat4 nodeLocalTransform(const Microsoft::glTF::Node &node)
+{
+    glm::mat4 m(1.0f);
+
+    // HasIdentityTRS
+    //           return translation == Vector3::ZERO
+    //                    && rotation == Quaternion::IDENTITY
+    //                    && scale == Vector3::ONE;
+
+    if (node.matrix != Microsoft::glTF::Matrix4::IDENTITY)
     {
-        // nodes of scene graph could not have mesh
-        if (document.nodes[i].meshId.empty())
-        {
-            continue;
-        }
-        // string to uint
-        uint32_t meshId = std::stoul(document.nodes[i].meshId);
-        const Microsoft::glTF::Mesh &mesh = document.meshes[meshId];
-        // goal to fill in this internal mesh entity
-        Mesh currMesh;
-        // step1: node's local transform
-        glm::mat4 m(1.0f);
-
-        // nodes's local transformation matrix
-        // HasIdentityTRS
-        //           return translation == Vector3::ZERO
-        //                    && rotation == Quaternion::IDENTITY
-        //                    && scale == Vector3::ONE;
-
-        if (document.nodes[i].matrix != Microsoft::glTF::Matrix4::IDENTITY)
+        // row-major
+        for (int i = 0; i < 4; i++)
         {
-            // row-major
-            for (int i = 0; i < 4; i++)
+            for (int j = 0; j < 4; j++)
             {
-                for (int j = 0; j < 4; j++)
-                {
-                    m[i][j] = document.nodes[i].matrix.values[i * 4 + j];
-                }
+                m[i][j] = node.matrix.values[i * 4 + j];
             }
         }
-        else if (!document.nodes[i].HasIdentityTRS())
+    }
+    else if (!node.HasIdentityTRS())
+    {
+        auto matScale = glm::scale(glm::mat4(1.0f), glm::vec3(node.scale.x, node.scale.y, node.scale.z));
+        glm::quat q(node.rotation.w, node.rotation.x, node.rotation.y, node.rotation.z);
+        auto matRot = glm::mat4_cast(q);
+        glm::mat4 matTranslate =
+            glm::translate(glm::mat4(1.0f), glm::vec3(node.translation.x,
+                node.translation.y,
+                node.translation.z));
+        m = matTranslate * (matRot * matScale);
+    }
+    return m;
+}
+
+// world transform of every node: parent's world * local, from the roots down
+std::vector<glm::mat4> nodeWorldTransforms(const Microsoft::glTF::Document &document)
+{
+    const auto numNodes = document.nodes.Size();
+    std::vector<glm::mat4> worldTransforms(numNodes, glm::mat4(1.0f));
+    std::vector<bool> isChild(numNodes, false);
+    for (size_t i = 0; i < numNodes; ++i)
+    {
+        for (const auto &childId : document.nodes[i].children)
         {
-            auto matScale = glm::scale(glm::mat4(1.0f), glm::vec3(document.nodes[i].scale.x, document.nodes[i].scale.y, document.nodes[i].scale.z));
-            glm::quat q(document.nodes[i].rotation.w, document.nodes[i].rotation.x, document.nodes[i].rotation.y, document.nodes[i].rotation.z);
-            auto matRot = glm::mat4_cast(q);
-            glm::mat4 matTranslate =
-                glm::translate(glm::mat4(1.0f), glm::vec3(document.nodes[i].translation.x,
-                    document.nodes[i].translation.y,
-                    document.nodes[i].translation.z));
-            m = matTranslate * (matRot * matScale);
+            isChild[std::stoul(childId)] = true;
         }
-        // 2.
-        for (auto &primitive : mesh.primitives)
+    }
+    std::vector<size_t> nodesToVisit;
+    for (size_t i = 0; i < numNodes; ++i)
+    {
+        if (!isChild[i])
         {
-            // use Accessor to access all the data buffers
-            std::string positionAccessorID;
-            std::string normalAccessorID;
-            std::string tangentAccessorID;
-            // multiple pairs of uv coordinates
-            std::string uvAccessorID;
-            std::string uvAccessorID2;
-
-            if (primitive.materialId != "")
-            {
-                currMesh.materialIdx = document.materials.GetIndex(primitive.materialId);
-            }
-            // get accessorId first
-            // assume normal is included in the glb
-            if (primitive.TryGetAttributeAccessorId(Microsoft::glTF::ACCESSOR_POSITION,
-                                                    positionAccessorID) &&
-                primitive.TryGetAttributeAccessorId(Microsoft::glTF::ACCESSOR_NORMAL,
-                                                    normalAccessorID))
+            worldTransforms[i] = nodeLocalTransform(document.nodes[i]);
+            nodesToVisit.push_back(i);
+        }
+    }
+    while (!nodesToVisit.empty())
+    {
+        const auto parent = nodesToVisit.back();
+        nodesToVisit.pop_back();
+        for (const auto &childId : document.nodes[parent].children)
+        {
+            const auto child = std::stoul(childId);
+            worldTransforms[child] = worldTransforms[parent] * nodeLocalTransform(document.nodes[child]);
+            nodesToVisit.push_back(child);
+        }
+    }
+    return worldTransforms;
+}
+
+// one mesh of the document to an internal mesh, in mesh space: the nodes referencing it are its instances
+Mesh readMesh(const Microsoft::glTF::Document &document,
+              const Microsoft::glTF::GLTFResourceReader &resourceReader,
+              const Microsoft::glTF::Mesh &mesh,
+              std::mutex &readerMutex)
+{
+    // goal to fill in this internal mesh entity
+    Mesh currMesh;
+    for (auto &primitive : mesh.primitives)
+    {
+        // use Accessor to access all the data buffers
+        std::string positionAccessorID;
+        std::string normalAccessorID;
+        std::string tangentAccessorID;
+        // multiple pairs of uv coordinates
+        std::string uvAccessorID;
+        std::string uvAccessorID2;
+
+        if (primitive.materialId != "")
+        {
+            currMesh.materialIdx = document.materials.GetIndex(primitive.materialId);
+        }
+        // get accessorId first
+        // assume normal is included in the glb
+        if (primitive.TryGetAttributeAccessorId(Microsoft::glTF::ACCESSOR_POSITION,
+                                                positionAccessorID) &&
+            primitive.TryGetAttributeAccessorId(Microsoft::glTF::ACCESSOR_NORMAL,
+                                                normalAccessorID))
+        {
+            // tangent and uv could be optional
+            bool hasTangent = primitive.TryGetAttributeAccessorId(
+                Microsoft::glTF::ACCESSOR_TANGENT, tangentAccessorID);
+            bool hasUV = primitive.TryGetAttributeAccessorId(
+                Microsoft::glTF::ACCESSOR_TEXCOORD_0, uvAccessorID);
+            bool hasUV2 = primitive.TryGetAttributeAccessorId(
+                Microsoft::glTF::ACCESSOR_TEXCOORD_1, uvAccessorID2);
+            // indicesAccessorId is for element buffer
+            if (document.accessors.Has(primitive.indicesAccessorId) &&
+                document.accessors.Has(positionAccessorID) &&
+                document.accessors.Has(normalAccessorID))
             {
-                // tangent and uv could be optional
-                bool hasTangent = primitive.TryGetAttributeAccessorId(
-                    Microsoft::glTF::ACCESSOR_TANGENT, tangentAccessorID);
-                bool hasUV = primitive.TryGetAttributeAccessorId(
-                    Microsoft::glTF::ACCESSOR_TEXCOORD_0, uvAccessorID);
-                bool hasUV2 = primitive.TryGetAttributeAccessorId(
-                    Microsoft::glTF::ACCESSOR_TEXCOORD_1, uvAccessorID2);
-                // indicesAccessorId is for element buffer
-                if (document.accessors.Has(primitive.indicesAccessorId) &&
-                    document.accessors.Has(positionAccessorID) &&
-                    document.accessors.Has(normalAccessorID))
+                // get three buffers: ebo, position and normal
+                // interleave or separate ?
+                const Microsoft::glTF::Accessor &positionAccessor =
+                    document.accessors[positionAccessorID];
+                const Microsoft::glTF::Accessor &normalAccessor =
+                    document.accessors[normalAccessorID];
+                const Microsoft::glTF::Accessor &indicesAccessor =
+                    document.accessors[primitive.indicesAccessorId];
+                // index could be u16_t or u32_t
+                // store indices to the currMesh
+                if (indicesAccessor.componentType == Microsoft::glTF::COMPONENT_UNSIGNED_INT)
                 {
-                    // get three buffers: ebo, position and normal
-                    // interleave or separate ?
-                    const Microsoft::glTF::Accessor &positionAccessor =
-                        document.accessors[positionAccessorID];
-                    const Microsoft::glTF::Accessor &normalAccessor =
-                        document.accessors[normalAccessorID];
-                    const Microsoft::glTF::Accessor &indicesAccessor =
-                        document.accessors[primitive.indicesAccessorId];
-                    // index could be u16_t or u32_t
-                    // store indices to the currMesh
-                    if (indicesAccessor.componentType == Microsoft::glTF::COMPONENT_UNSIGNED_INT)
+                    std::vector<unsigned int> indices =
+                        readBinaryDataLocked<unsigned int>(readerMutex, resourceReader, document, indicesAccessor);
+                    for (auto &index : indices)
                     {
-                        std::vector<unsigned int> indices =
-                            resourceReader.ReadBinaryData<unsigned int>(document,
-                                                                        indicesAccessor);
-                        for (auto &index : indices)
-                        {
-                            // LOGI("Indices: %d", index);
-                            currMesh.indices.push_back(index);
-                        }
+                        // LOGI("Indices: %d", index);
+                        currMesh.indices.push_back(index);
                     }
-                    else if (indicesAccessor.componentType ==
-                             Microsoft::glTF::COMPONENT_UNSIGNED_SHORT)
+                }
+                else if (indicesAccessor.componentType ==
+                         Microsoft::glTF::COMPONENT_UNSIGNED_SHORT)
+                {
+                    std::vector<unsigned short> indices =
+                        readBinaryDataLocked<unsigned short>(readerMutex, resourceReader, document, indicesAccessor);
+                    for (auto &index : indices)
                     {
-                        std::vector<unsigned short> indices =
-                            resourceReader.ReadBinaryData<unsigned short>(document,
-                                                                          indicesAccessor);
-                        for (auto &index : indices)
-                        {
-                            // LOGI("Indices: %d", index);
-                            currMesh.indices.push_back(index);
-                        }
+                        // LOGI("Indices: %d", index);
+                        currMesh.indices.push_back(index);
                     }
-                    // store the vertices into currMesh
-                    if (positionAccessor.componentType == Microsoft::glTF::COMPONENT_FLOAT &&
-                        normalAccessor.componentType == Microsoft::glTF::COMPONENT_FLOAT)
+                }
+                // store the vertices into currMesh
+                if (positionAccessor.componentType == Microsoft::glTF::COMPONENT_FLOAT &&
+                    normalAccessor.componentType == Microsoft::glTF::COMPONENT_FLOAT)
+                {
+                    std::vector<float> positionBuffer =
+                        readBinaryDataLocked<float>(readerMutex, resourceReader, document, positionAccessor);
+                    std::vector<float> normalBuffer =
+                        readBinaryDataLocked<float>(readerMutex, resourceReader, document, normalAccessor);
+
+                    auto verticesCount = positionAccessor.count;
+                    // vec4f
+                    std::vector<float> tangentBuffer(verticesCount * 4, 0.0);
+                    // vec2f
+                    std::vector<float> uvBuffer(verticesCount * 2, 0.0);
+                    // vec2f
+                    std::vector<float> uv2Buffer(verticesCount * 2, 0.0);
+                    if (hasTangent)
+                    {
+                        const auto &tangentAccessor = document.accessors[tangentAccessorID];
+                        tangentBuffer = readBinaryDataLocked<float>(readerMutex, resourceReader, document, tangentAccessor);
+                    }
+
+                    if (hasUV)
+                    {
+                        const auto &uvAccessor = document.accessors[uvAccessorID];
+                        uvBuffer = readBinaryDataLocked<float>(readerMutex, resourceReader, document, uvAccessor);
+                    }
+
+                    if (hasUV2)
+                    {
+                        const auto &uv2Accessor = document.accessors[uvAccessorID2];
+                        uv2Buffer = readBinaryDataLocked<float>(readerMutex, resourceReader, document, uv2Accessor);
+                    }
+
+                    for (uint64_t i = 0; i < verticesCount; i++)
                     {
-                        std::vector<float> positionBuffer =
-                            resourceReader.ReadBinaryData<float>(document, positionAccessor);
-                        std::vector<float> normalBuffer =
-                            resourceReader.ReadBinaryData<float>(document, normalAccessor);
-
-                        auto verticesCount = positionAccessor.count;
-                        // vec4f
-                        std::vector<float> tangentBuffer(verticesCount * 4, 0.0);
-                        // vec2f
-                        std::vector<float> uvBuffer(verticesCount * 2, 0.0);
-                        // vec2f
-                        std::vector<float> uv2Buffer(verticesCount * 2, 0.0);
-                        if (hasTangent)
+                        const std::array<uint64_t, 4> vec4Offset = {4 * i, 4 * i + 1,
+                                                                    4 * i + 2, 4 * i + 3};
+                        const std::array<uint64_t, 3> vec3Offset = {3 * i, 3 * i + 1,
+                                                                    3 * i + 2};
+                        const std::array<uint64_t, 2> vec2Offset = {2 * i, 2 * i + 1};
+
+                        // to begin with, keep it simple
+                        //  vec3f(std::array{0.0f, 1.0f, 0.0f}),
+                        //                            Vertex vertex{
+                        //                                    .pos = vec3f(std::array{positionBuffer[vec3Offset[0]],
+                        //                                                            positionBuffer[vec3Offset[1]],
+                        //                                                            positionBuffer[vec3Offset[2]]}),
+                        //                                    .texCoord = vec2f(std::array{uvBuffer[vec2Offset[0]],
+                        //                                                                 uvBuffer[vec2Offset[1]]}),
+                        //                                    .material = uint32_t(currMesh.materialIdx),
+                        //                            };
+
+                        Vertex vertex;
+                        vertex.vx = positionBuffer[vec3Offset[0]];
+                        vertex.vy = positionBuffer[vec3Offset[1]];
+                        vertex.vz = positionBuffer[vec3Offset[2]];
+
+                        vertex.ux = uvBuffer[vec2Offset[0]];
+                        vertex.uy = uvBuffer[vec2Offset[1]];
+                        vertex.material = uint32_t(currMesh.materialIdx);
+
+                        // no transform: the instances carry it
+                        currMesh.vertices.emplace_back(vertex);
+                        // To Do: calculating Bounding Volumes
+                        if (vertex.vx < currMesh.minAABB[0])
                         {
-                            const auto &tangentAccessor = document.accessors[tangentAccessorID];
-                            tangentBuffer = resourceReader.ReadBinaryData<float>(document,
-                                                                                 tangentAccessor);
+                            currMesh.minAABB[0] = vertex.vx;
                         }
-
-                        if (hasUV)
+                        if (vertex.vy < currMesh.minAABB[1])
                         {
-                            const auto &uvAccessor = document.accessors[uvAccessorID];
-                            uvBuffer = resourceReader.ReadBinaryData<float>(document, uvAccessor);
+                            currMesh.minAABB[1] = vertex.vy;
                         }
-
-                        if (hasUV2)
+                        if (vertex.vz < currMesh.minAABB[2])
                         {
-                            const auto &uv2Accessor = document.accessors[uvAccessorID2];
-                            uv2Buffer = resourceReader.ReadBinaryData<float>(document, uv2Accessor);
+                            currMesh.minAABB[2] = vertex.vz;
                         }
-
-                        for (uint64_t i = 0; i < verticesCount; i++)
+                        if (vertex.vx > currMesh.maxAABB[0])
+                        {
+                            currMesh.maxAABB[0] = vertex.vx;
+                        }
+                        if (vertex.vy > currMesh.maxAABB[1])
+                        {
+                            currMesh.maxAABB[1] = vertex.vy;
+                        }
+                        if (vertex.vz > currMesh.maxAABB[2])
                         {
-                            const std::array<uint64_t, 4> vec4Offset = {4 * i, 4 * i + 1,
-                                                                        4 * i + 2, 4 * i + 3};
-                            const std::array<uint64_t, 3> vec3Offset = {3 * i, 3 * i + 1,
-                                                                        3 * i + 2};
-                            const std::array<uint64_t, 2> vec2Offset = {2 * i, 2 * i + 1};
-
-                            // to begin with, keep it simple
-                            //  vec3f(std::array{0.0f, 1.0f, 0.0f}),
-                            //                            Vertex vertex{
-                            //                                    .pos = vec3f(std::array{positionBuffer[vec3Offset[0]],
-                            //                                                            positionBuffer[vec3Offset[1]],
-                            //                                                            positionBuffer[vec3Offset[2]]}),
-                            //                                    .texCoord = vec2f(std::array{uvBuffer[vec2Offset[0]],
-                            //                                                                 uvBuffer[vec2Offset[1]]}),
-                            //                                    .material = uint32_t(currMesh.materialIdx),
-                            //                            };
-
-                            Vertex vertex;
-                            vertex.vx = positionBuffer[vec3Offset[0]];
-                            vertex.vy = positionBuffer[vec3Offset[1]];
-                            vertex.vz = positionBuffer[vec3Offset[2]];
-
-                            vertex.ux = uvBuffer[vec2Offset[0]];
-                            vertex.uy = uvBuffer[vec2Offset[1]];
-                            vertex.material = uint32_t(currMesh.materialIdx);
-
-                            // apply local transform for all the positions and normals (if exists)
-                            //                            LOGI("Before Transform: [%d %f, %f, %f]",
-                            //                                 i,
-                            //                                 vertex.vx,
-                            //                                 vertex.vy,
-                            //                                 vertex.vz);
-                            vertex.transform(m);
-
-                            // log(Level::Info, "After Transform:", vertex.vx, ",", vertex.vy,
-                            //     ",", vertex.vz);
-
-                            currMesh.vertices.emplace_back(vertex);
-                            // To Do: calculating Bounding Volumes
-                            if (vertex.vx < currMesh.minAABB[0])
-                            {
-                                currMesh.minAABB[0] = vertex.vx;
-                            }
-                            if (vertex.vy < currMesh.minAABB[1])
-                            {
-                                currMesh.minAABB[1] = vertex.vy;
-                            }
-                            if (vertex.vz < currMesh.minAABB[2])
-                            {
-                                currMesh.minAABB[2] = vertex.vz;
-                            }
-                            if (vertex.vx > currMesh.maxAABB[0])
-                            {
-                                currMesh.maxAABB[0] = vertex.vx;
-                            }
-                            if (vertex.vy > currMesh.maxAABB[1])
-                            {
-                                currMesh.maxAABB[1] = vertex.vy;
-                            }
-                            if (vertex.vz > currMesh.maxAABB[2])
-                            {
-                                currMesh.maxAABB[2] = vertex.vz;
-                            }
+                            currMesh.maxAABB[2] = vertex.vz;
                         }
                     }
                 }
             }
         }
+    }
+    return currMesh;
+}
+
+void readMeshes(const Microsoft::glTF::Document &document,
+                const Microsoft::glTF::GLTFResourceReader &resourceReader,
+                Scene &outputScene)
+{
+    ZoneScopedN("readMeshes");
+    // node: // https://github.com/KhronosGroup/glTF/blob/master/specification/2.0/schema/node.schema.json
+    // nodes of scene graph could not have mesh, several nodes could share one mesh
+    std::vector<std::vector<size_t>> nodesOfMesh(document.meshes.Size());
+    for (size_t i = 0; i < document.nodes.Size(); ++i)
+    {
+        if (!document.nodes[i].meshId.empty())
+        {
+            nodesOfMesh[std::stoul(document.nodes[i].meshId)].push_back(i);
+        }
+    }
+    std::vector<size_t> referencedMeshes;
+    for (size_t i = 0; i < nodesOfMesh.size(); ++i)
+    {
+        if (!nodesOfMesh[i].empty())
+        {
+            referencedMeshes.push_back(i);
+        }
+    }
+
+    // every referenced mesh is read once, one job per mesh, mesh sizes vary too much for a larger grain
+    std::mutex readerMutex;
+    std::vector<Mesh> documentMeshes(referencedMeshes.size());
+    JobSystem::get().parallelFor("readMesh", 0, referencedMeshes.size(), 1, [&](size_t k)
+                                 { documentMeshes[k] = readMesh(document, resourceReader, document.meshes[referencedMeshes[k]], readerMutex); });
+    const auto worldTransforms = nodeWorldTransforms(document);
 
+    // every mesh's index and instance offset
+    // while read every mesh, update firstIndex and vertexOffset, bundle into larger buffer
+    // serial and in mesh order: offsets and meshId do not depend on the scheduling
+    uint32_t firstIndex = 0;
+    uint32_t vertexOffset = 0;
+    size_t numInstancedVertices = 0;
+    for (size_t k = 0; k < documentMeshes.size(); ++k)
+    {
+        auto &currMesh = documentMeshes[k];
         // indirect draw buffer
         if (!currMesh.indices.empty() && !currMesh.vertices.empty())
         {
+            const auto meshId = static_cast<uint32_t>(outputScene.meshes.size());
+            const auto &nodes = nodesOfMesh[referencedMeshes[k]];
             IndirectDrawDef1 indirectDraw{
                 .indexCount = static_cast<uint32_t>(currMesh.indices.size()),
-                .instanceCount = 1,
+                .instanceCount = static_cast<uint32_t>(nodes.size()),
                 .firstIndex = firstIndex,
                 .vertexOffset = vertexOffset,
-                .firstInstance = 0,
-                .meshId = static_cast<uint32_t>(outputScene.meshes.size()),
+                .firstInstance = static_cast<uint32_t>(outputScene.instances.size()),
+                .meshId = meshId,
                 .materialIndex = currMesh.materialIdx,
             };
 
             firstIndex += currMesh.indices.size();
             vertexOffset += currMesh.vertices.size();
+            numInstancedVertices += currMesh.vertices.size() * nodes.size();
 
-            currMesh.extents = (currMesh.maxAABB - currMesh.minAABB);
-            currMesh.center = currMesh.minAABB + currMesh.extents * 0.5f;
+            // the draw's bounds: the 8 corners of the mesh space box, for every instance
+            glm::vec3 worldMin{(std::numeric_limits<float>::max)()};
+            glm::vec3 worldMax{-(std::numeric_limits<float>::max)()};
+            for (const auto nodeId : nodes)
+            {
+                const auto &transform = worldTransforms[nodeId];
+                outputScene.instances.emplace_back(MeshInstance{
+                    .meshId = meshId,
+                    .transform = transform,
+                });
+                for (int corner = 0; corner < 8; ++corner)
+                {
+                    const glm::vec3 p((corner & 1) ? currMesh.maxAABB.x : currMesh.minAABB.x,
+                                      (corner & 2) ? currMesh.maxAABB.y : currMesh.minAABB.y,
+                                      (corner & 4) ? currMesh.maxAABB.z : currMesh.minAABB.z);
+                    const auto q = glm::vec3(transform * glm::vec4(p, 1.0f));
+                    worldMin = glm::min(worldMin, q);
+                    worldMax = glm::max(worldMax, q);
+                }
+            }
+            currMesh.extents = (worldMax - worldMin);
+            currMesh.center = worldMin + currMesh.extents * 0.5f;
 
             log(Level::Info,
                 "Extents:", currMesh.extents[0],
@@ -392,7 +485,7 @@ void readMeshes(const Microsoft::glTF::Document &document,
 
             log(Level::Info, indirectDraw);
 
-            outputScene.meshes.emplace_back(currMesh);
+            outputScene.meshes.emplace_back(std::move(currMesh));
             outputScene.indirectDraw.emplace_back(indirectDraw);
             outputScene.totalVerticesByteSize +=
                 sizeof(Vertex) * outputScene.meshes.back().vertices.size();
@@ -400,6 +493,8 @@ void readMeshes(const Microsoft::glTF::Document &document,
                 sizeof(uint32_t) * outputScene.meshes.back().indices.size();
         }
     }
+    log(Level::Info, "readMeshes: ", outputScene.instances.size(), " instance(s) of ", outputScene.meshes.size(),
+        " mesh(es), ", vertexOffset, " vertices stored instead of ", numInstancedVertices);
 }
 
 std::vector<uint8_t> readTextureRawBuffer(
@@ -417,11 +512,19 @@ void readTextures(const Microsoft::glTF::Document &document,
                   const Microsoft::glTF::GLTFResourceReader &resourceReader,
                   Scene &outputScene)
 {
+    ZoneScopedN("readTextures");
+    // the reader is not thread-safe: pull the encoded bytes first
+    std::vector<std::vector<uint8_t>> rawBuffers;
+    rawBuffers.reserve(document.textures.Size());
     for (int i = 0; i < document.textures.Size(); ++i)
     {
-        outputScene.textures.emplace_back(std::move(std::make_unique<Texture>(
-            readTextureRawBuffer(document, resourceReader, document.textures[i].imageId))));
+        rawBuffers.emplace_back(readTextureRawBuffer(document, resourceReader, document.textures[i].imageId));
     }
+
+    // decoding (png/jpg) dominates the import, one job per texture
+    outputScene.textures.resize(rawBuffers.size());
+    JobSystem::get().parallelFor("decodeTexture", 0, rawBuffers.size(), 1, [&](size_t i)
+                                 { outputScene.textures[i] = std::make_unique<Texture>(rawBuffers[i]); });
 }
 
 void readMaterials(const Microsoft::glTF::Document &document, Scene &outputScene)
@@ -443,6 +546,10 @@ void readMaterials(const Microsoft::glTF::Document &document, Scene &outputScene
         curr.basecolor = glm::vec4(
             mat.metallicRoughness.baseColorFactor.r, mat.metallicRoughness.baseColorFactor.g,
             mat.metallicRoughness.baseColorFactor.b, mat.metallicRoughness.baseColorFactor.a);
+        if (mat.alphaMode == Microsoft::glTF::AlphaMode::ALPHA_MASK)
+        {
+            curr.alphaCutoff = mat.alphaCutoff;
+        }
         outputScene.materials.emplace_back(curr);
     }
 }
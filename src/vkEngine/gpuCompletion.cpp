@@ -0,0 +1,111 @@
+#include <algorithm>
+
+#include <tracy/Tracy.hpp>
+
+#include <gpuCompletion.h>
+
+bool VkCompletionSource::isFenceSignaled(VkFence fence)
+{
+    return vkGetFenceStatus(_logicalDevice, fence) == VK_SUCCESS;
+}
+
+uint64_t VkCompletionSource::timelineValue(VkSemaphore semaphore)
+{
+    uint64_t value = 0;
+    VK_CHECK(vkGetSemaphoreCounterValue(_logicalDevice, semaphore, &value));
+    return value;
+}
+
+GpuCompletionWatcher::GpuCompletionWatcher(ICompletionSource &source, JobSystem *resumeOn)
+    : _source(source), _resumeOn(resumeOn)
+{
+}
+
+GpuCompletionWatcher::~GpuCompletionWatcher()
+{
+    stopPolling();
+    ASSERT(_waiters.empty(), "coroutines still suspended on gpu work, they would leak");
+}
+
+GpuCompletionWatcher::Awaiter GpuCompletionWatcher::fence(VkFence fence)
+{
+    return Awaiter{*this, [this, fence]()
+                   { return _source.isFenceSignaled(fence); }};
+}
+
+GpuCompletionWatcher::Awaiter GpuCompletionWatcher::timeline(VkSemaphore semaphore, uint64_t value)
+{
+    return Awaiter{*this, [this, semaphore, value]()
+                   { return _source.timelineValue(semaphore) >= value; }};
+}
+
+void GpuCompletionWatcher::enqueue(ReadyFn ready, std::coroutine_handle<> h)
+{
+    std::scoped_lock lock{_mux};
+    _waiters.emplace_back(std::move(ready), h);
+}
+
+size_t GpuCompletionWatcher::poll()
+{
+    std::vector<std::coroutine_handle<>> ready;
+    {
+        std::scoped_lock lock{_mux};
+        // stable partition keeps the waiters in submission order
+        auto it = std::stable_partition(_waiters.begin(), _waiters.end(), [](auto &waiter)
+                                        { return !waiter.first(); });
+        for (auto curr = it; curr != _waiters.end(); ++curr)
+        {
+            ready.push_back(curr->second);
+        }
+        _waiters.erase(it, _waiters.end());
+    }
+
+    // resume outside the lock, a resumed coroutine may await again right away
+    for (auto h : ready)
+    {
+        if (_resumeOn)
+        {
+            _resumeOn->run("GpuCompletionWatcher: resume", [h]()
+                           { h.resume(); });
+        }
+        else
+        {
+            h.resume();
+        }
+    }
+    return ready.size();
+}
+
+size_t GpuCompletionWatcher::pendingCount() const
+{
+    std::scoped_lock lock{_mux};
+    return _waiters.size();
+}
+
+void GpuCompletionWatcher::startPolling(std::chrono::microseconds interval)
+{
+    ASSERT(!_pollingThread.joinable(), "already polling");
+    _pollingThread = std::jthread([this, interval](std::stop_token stopToken)
+                                  {
+        std::mutex sleepMux;
+        while (!stopToken.stop_requested())
+        {
+            {
+                ZoneScopedN("GpuCompletionWatcher: poll");
+                poll();
+            }
+            std::unique_lock lock{sleepMux};
+            // wakes up early on stop
+            _pollingCv.wait_for(lock, stopToken, interval, []()
+                                { return false; });
+        } });
+}
+
+void GpuCompletionWatcher::stopPolling()
+{
+    if (_pollingThread.joinable())
+    {
+        _pollingThread.request_stop();
+        _pollingThread.join();
+    }
+}
@@ -0,0 +1,99 @@
+#pragma once
+
+#include <coroutine>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+#include <chrono>
+#include <condition_variable>
+
+#include <misc.h>
+#include <jobSystem.h>
+
+// where gpu completion is read from
+// the vulkan implementation queries the device, a fake one (tests) flips the state by hand
+class ICompletionSource
+{
+public:
+    virtual ~ICompletionSource() = default;
+    virtual bool isFenceSignaled(VkFence fence) = 0;
+    virtual uint64_t timelineValue(VkSemaphore semaphore) = 0;
+};
+
+class VkCompletionSource : public ICompletionSource
+{
+public:
+    VkCompletionSource() = delete;
+    explicit VkCompletionSource(VkDevice logicalDevice) : _logicalDevice(logicalDevice)
+    {
+    }
+
+    bool isFenceSignaled(VkFence fence) override;
+    uint64_t timelineValue(VkSemaphore semaphore) override;
+
+private:
+    VkDevice _logicalDevice{VK_NULL_HANDLE};
+};
+
+// coroutines suspended on gpu work
+// co_await watcher.fence(fence) / co_await watcher.timeline(semaphore, value)
+// the watcher polls the source (poll() by hand, or its own polling thread) and resumes the ready
+// coroutines on the JobSystem, or inline on the polling thread when no JobSystem is given
+// no thread ever blocks in vkWaitForFences for a load
+class GpuCompletionWatcher
+{
+public:
+    using ReadyFn = std::function<bool()>;
+
+    struct Awaiter
+    {
+        GpuCompletionWatcher &watcher;
+        ReadyFn ready;
+
+        bool await_ready()
+        {
+            // already done: no suspension at all
+            return ready();
+        }
+
+        void await_suspend(std::coroutine_handle<> h)
+        {
+            watcher.enqueue(std::move(ready), h);
+        }
+
+        void await_resume() noexcept
+        {
+        }
+    };
+
+    GpuCompletionWatcher() = delete;
+    explicit GpuCompletionWatcher(ICompletionSource &source, JobSystem *resumeOn = nullptr);
+    ~GpuCompletionWatcher();
+
+    GpuCompletionWatcher(const GpuCompletionWatcher &other) = delete;
+    GpuCompletionWatcher &operator=(const GpuCompletionWatcher &other) = delete;
+
+    Awaiter fence(VkFence fence);
+    Awaiter timeline(VkSemaphore semaphore, uint64_t value);
+
+    // resume every waiter whose work is done, returns how many
+    size_t poll();
+    size_t pendingCount() const;
+
+    // background polling, stopped by stopPolling() or the destructor
+    void startPolling(std::chrono::microseconds interval);
+    void stopPolling();
+
+private:
+    void enqueue(ReadyFn ready, std::coroutine_handle<> h);
+
+    ICompletionSource &_source;
+    JobSystem *_resumeOn{nullptr};
+
+    mutable std::mutex _mux;
+    std::vector<std::pair<ReadyFn, std::coroutine_handle<>>> _waiters;
+
+    std::condition_variable_any _pollingCv;
+    std::jthread _pollingThread;
+};
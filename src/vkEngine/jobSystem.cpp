@@ -0,0 +1,256 @@
+#include <cstring>
+#include <random>
+#include <string>
+
+#include <tracy/Tracy.hpp>
+
+#include <jobSystem.h>
+#include <misc.h>
+
+// which scheduler and deque the current thread owns, nullptr/-1 for non-worker threads
+static thread_local JobSystem *sWorkerOwner = nullptr;
+static thread_local size_t sWorkerIdx = static_cast<size_t>(-1);
+
+JobSystem &JobSystem::get()
+{
+    // the caller (main thread) helps in wait(), leave it one hardware thread
+    static JobSystem sJobSystem((std::max)(std::thread::hardware_concurrency(), 2u) - 1);
+    return sJobSystem;
+}
+
+JobSystem::JobSystem(size_t numWorkers)
+{
+    _deques.reserve(numWorkers);
+    for (size_t i = 0; i < numWorkers; ++i)
+    {
+        _deques.emplace_back(std::make_unique<WorkStealingDeque<Job *>>());
+    }
+    // deques first: a worker can steal from any of them as soon as it starts
+    _workers.reserve(numWorkers);
+    for (size_t i = 0; i < numWorkers; ++i)
+    {
+        _workers.emplace_back([this, i](std::stop_token stopToken)
+                              { workerLoop(stopToken, i); });
+    }
+    log(Level::Info, "JobSystem: ", numWorkers, " workers");
+}
+
+JobSystem::~JobSystem()
+{
+    for (auto &worker : _workers)
+    {
+        worker.request_stop();
+    }
+    _epoch.fetch_add(1, std::memory_order_seq_cst);
+    _epoch.notify_all();
+    _workers.clear();
+
+    // never run, the owner did not wait on them
+    std::optional<Job *> job;
+    do
+    {
+        job.reset();
+        _injected.pop(job);
+        delete job.value_or(nullptr);
+    } while (job.has_value());
+    for (auto &deque : _deques)
+    {
+        Job *stale = nullptr;
+        while (deque->take(stale))
+        {
+            delete stale;
+        }
+    }
+}
+
+void JobSystem::run(const char *name, JobFn fn, JobCounter *counter)
+{
+    if (counter)
+    {
+        counter->_pending.fetch_add(1, std::memory_order_relaxed);
+    }
+    schedule(new Job{name, std::move(fn), counter});
+}
+
+void JobSystem::runAfter(JobCounter &dependency, const char *name, JobFn fn, JobCounter *counter)
+{
+    if (counter)
+    {
+        counter->_pending.fetch_add(1, std::memory_order_relaxed);
+    }
+    auto *job = new Job{name, std::move(fn), counter};
+    {
+        std::scoped_lock lock{dependency._mux};
+        if (dependency._pending.load(std::memory_order_acquire) > 0)
+        {
+            // finish() of the last job of dependency schedules it
+            dependency._continuations.push_back(job);
+            return;
+        }
+    }
+    schedule(job);
+}
+
+void JobSystem::wait(JobCounter &counter)
+{
+    ZoneScopedN("JobSystem: wait");
+    while (!counter.done())
+    {
+        if (Job *job = findJob())
+        {
+            execute(job);
+            continue;
+        }
+        // everything left is being run by other threads
+        // sleep until a job is scheduled or a counter drops to zero, both bump the epoch
+        _sleepers.fetch_add(1, std::memory_order_seq_cst);
+        const uint32_t observed = _epoch.load(std::memory_order_seq_cst);
+        Job *job = counter.done() ? nullptr : findJob();
+        if (!job && !counter.done())
+        {
+            _epoch.wait(observed, std::memory_order_seq_cst);
+        }
+        _sleepers.fetch_sub(1, std::memory_order_seq_cst);
+        if (job)
+        {
+            execute(job);
+        }
+    }
+    // finish() may still be inside the lock after dropping the counter to zero,
+    // the counter usually lives on the stack of the caller
+    std::scoped_lock lock{counter._mux};
+}
+
+void JobSystem::schedule(Job *job)
+{
+    if (sWorkerOwner == this)
+    {
+        _deques[sWorkerIdx]->push(job);
+    }
+    else
+    {
+        _injected.push(job);
+    }
+    _epoch.fetch_add(1, std::memory_order_seq_cst);
+    if (_sleepers.load(std::memory_order_seq_cst) > 0)
+    {
+        _epoch.notify_one();
+    }
+}
+
+JobSystem::Job *JobSystem::findJob()
+{
+    Job *job = nullptr;
+    const bool isWorker = sWorkerOwner == this;
+    if (isWorker && _deques[sWorkerIdx]->take(job))
+    {
+        return job;
+    }
+
+    std::optional<Job *> injected;
+    _injected.pop(injected);
+    if (injected.has_value())
+    {
+        return *injected;
+    }
+
+    // random victim so thieves do not pile up on the same deque
+    static thread_local std::minstd_rand sRng{std::random_device{}()};
+    const size_t numDeques = _deques.size();
+    if (numDeques == 0)
+    {
+        return nullptr;
+    }
+    const size_t start = sRng() % numDeques;
+    for (size_t i = 0; i < numDeques; ++i)
+    {
+        const size_t victim = (start + i) % numDeques;
+        if (isWorker && victim == sWorkerIdx)
+        {
+            continue;
+        }
+        if (_deques[victim]->steal(job))
+        {
+            return job;
+        }
+    }
+    return nullptr;
+}
+
+void JobSystem::execute(Job *job)
+{
+    {
+        ZoneScopedN("Job");
+        ZoneName(job->name, strlen(job->name));
+        job->fn();
+    }
+    if (job->counter)
+    {
+        finish(*job->counter);
+    }
+    delete job;
+}
+
+void JobSystem::finish(JobCounter &counter)
+{
+    // fast path: not the last job
+    uint32_t pending = counter._pending.load(std::memory_order_relaxed);
+    while (pending > 1)
+    {
+        if (counter._pending.compare_exchange_weak(pending, pending - 1, std::memory_order_acq_rel))
+        {
+            return;
+        }
+    }
+
+    std::vector<void *> continuations;
+    {
+        std::scoped_lock lock{counter._mux};
+        if (counter._pending.fetch_sub(1, std::memory_order_acq_rel) != 1)
+        {
+            // a job was added against the counter meanwhile
+            return;
+        }
+        continuations.swap(counter._continuations);
+    }
+    // wake up the threads sleeping in wait()
+    _epoch.fetch_add(1, std::memory_order_seq_cst);
+    if (_sleepers.load(std::memory_order_seq_cst) > 0)
+    {
+        _epoch.notify_all();
+    }
+    for (auto *continuation : continuations)
+    {
+        schedule(static_cast<Job *>(continuation));
+    }
+}
+
+void JobSystem::workerLoop(std::stop_token stopToken, size_t workerIdx)
+{
+    sWorkerOwner = this;
+    sWorkerIdx = workerIdx;
+    const auto threadName = "JobWorker " + std::to_string(workerIdx);
+    tracy::SetThreadName(threadName.c_str());
+
+    while (!stopToken.stop_requested())
+    {
+        if (Job *job = findJob())
+        {
+            execute(job);
+            continue;
+        }
+        // register as sleeper, snapshot, retry once, then sleep until something is scheduled
+        _sleepers.fetch_add(1, std::memory_order_seq_cst);
+        const uint32_t observed = _epoch.load(std::memory_order_seq_cst);
+        Job *job = findJob();
+        if (!job && !stopToken.stop_requested())
+        {
+            _epoch.wait(observed, std::memory_order_seq_cst);
+        }
+        _sleepers.fetch_sub(1, std::memory_order_seq_cst);
+        if (job)
+        {
+            execute(job);
+        }
+    }
+}
@@ -0,0 +1,146 @@
+#pragma once
+
+#include <atomic>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+
+#include <queuethreadsafe.h>
+#include <workStealingDeque.h>
+
+class JobSystem;
+
+// dependency primitive: number of jobs still to run
+// incremented when a job is submitted against it, decremented once the job has run.
+// jobs can be chained behind a counter with JobSystem::runAfter.
+// the counter must outlive the jobs counted on it (JobSystem::wait guarantees that)
+class JobCounter
+{
+public:
+    JobCounter() = default;
+    JobCounter(const JobCounter &other) = delete;
+    JobCounter &operator=(const JobCounter &other) = delete;
+
+    bool done() const
+    {
+        return _pending.load(std::memory_order_acquire) == 0;
+    }
+
+private:
+    friend class JobSystem;
+    std::atomic<uint32_t> _pending{0};
+    // guards _continuations and the transition to zero
+    std::mutex _mux;
+    std::vector<void *> _continuations;
+};
+
+// work-stealing job scheduler for engine-wide cpu work
+// 1. one worker per hardware thread minus the caller, each owns a Chase-Lev deque
+// 2. a job spawned on a worker goes to its own deque, from any other thread to a shared injection queue
+// 3. an idle worker takes from its own deque, then the injection queue, then steals from a random victim
+// 4. wait() never blocks a worker idle: the waiting thread runs other jobs until the counter drops to zero
+// every job runs inside a tracy zone named after the job
+class JobSystem
+{
+public:
+    using JobFn = std::function<void()>;
+
+    // process-wide scheduler, created on first use
+    static JobSystem &get();
+
+    JobSystem() = delete;
+    explicit JobSystem(size_t numWorkers);
+    ~JobSystem();
+
+    JobSystem(const JobSystem &other) = delete;
+    JobSystem &operator=(const JobSystem &other) = delete;
+
+    size_t numWorkers() const
+    {
+        return _workers.size();
+    }
+
+    // counter is optional
+    void run(const char *name, JobFn fn, JobCounter *counter = nullptr);
+    // held back until dependency drops to zero
+    void runAfter(JobCounter &dependency, const char *name, JobFn fn, JobCounter *counter = nullptr);
+    // the calling thread helps with other jobs in the meantime
+    void wait(JobCounter &counter);
+
+    // fn(i) for i in [begin, end), split in chunks of grainSize
+    // returns when every chunk is done
+    template <typename Fn>
+    void parallelFor(const char *name, size_t begin, size_t end, size_t grainSize, Fn &&fn)
+    {
+        if (begin >= end)
+        {
+            return;
+        }
+        grainSize = (std::max)(grainSize, size_t(1));
+        JobCounter counter;
+        for (size_t chunkBegin = begin; chunkBegin < end; chunkBegin += grainSize)
+        {
+            const size_t chunkEnd = (std::min)(chunkBegin + grainSize, end);
+            run(name, [&fn, chunkBegin, chunkEnd]()
+                {
+                for (size_t i = chunkBegin; i < chunkEnd; ++i)
+                {
+                    fn(i);
+                } }, &counter);
+        }
+        wait(counter);
+    }
+
+    // map(chunkBegin, chunkEnd) -> T per chunk, then reduce(T, T) -> T over the chunks in order,
+    // the result does not depend on the scheduling
+    template <typename T, typename MapFn, typename ReduceFn>
+    T parallelReduce(const char *name, size_t begin, size_t end, size_t grainSize,
+                     T identity, MapFn &&map, ReduceFn &&reduce)
+    {
+        if (begin >= end)
+        {
+            return identity;
+        }
+        grainSize = (std::max)(grainSize, size_t(1));
+        const size_t numChunks = (end - begin + grainSize - 1) / grainSize;
+        std::vector<T> partials(numChunks, identity);
+        parallelFor(name, 0, numChunks, 1, [&](size_t chunk)
+                    {
+            const size_t chunkBegin = begin + chunk * grainSize;
+            const size_t chunkEnd = (std::min)(chunkBegin + grainSize, end);
+            partials[chunk] = map(chunkBegin, chunkEnd); });
+        T res = identity;
+        for (auto &partial : partials)
+        {
+            res = reduce(res, partial);
+        }
+        return res;
+    }
+
+private:
+    struct Job
+    {
+        const char *name;
+        JobFn fn;
+        JobCounter *counter;
+    };
+
+    void schedule(Job *job);
+    Job *findJob();
+    void execute(Job *job);
+    void finish(JobCounter &counter);
+    void workerLoop(std::stop_token stopToken, size_t workerIdx);
+
+    std::vector<std::unique_ptr<WorkStealingDeque<Job *>>> _deques;
+    // jobs submitted from threads which are not workers
+    QueueThreadSafe<Job *> _injected;
+    // idle workers sleep on the epoch, bumped on every schedule
+    std::atomic<uint32_t> _epoch{0};
+    std::atomic<uint32_t> _sleepers{0};
+    std::vector<std::jthread> _workers;
+};
@@ -0,0 +1,400 @@
+#include <tracy/Tracy.hpp>
+
+#include <memoryDefragmenter.h>
+
+MemoryDefragmenter::MemoryDefragmenter(VkContext &ctx, MemoryManager &memoryManager,
+                                       VkDeviceSize maxBytesPerPass, uint32_t maxAllocationsPerPass)
+    : _ctx(ctx), _memoryManager(memoryManager), _maxBytesPerPass(maxBytesPerPass), _maxAllocationsPerPass(maxAllocationsPerPass)
+{
+    // no fence: the pass is tracked on the graphics timeline
+    _cmdBuffer = _ctx.createGraphicsCommandBuffers("defragmentation", 1, 0, 0)[0];
+}
+
+MemoryDefragmenter::~MemoryDefragmenter()
+{
+    finish();
+    auto logicalDevice = _ctx.getLogicDevice();
+    const auto cmdBufferHandle = std::get<COMMAND_BUFFER_ENTITY_OFFSET::COMMAND_BUFFER>(_cmdBuffer);
+    const auto cmdPool = std::get<COMMAND_BUFFER_ENTITY_OFFSET::COMMAND_POOL>(_cmdBuffer);
+    vkFreeCommandBuffers(logicalDevice, cmdPool, 1, &cmdBufferHandle);
+    vkDestroyCommandPool(logicalDevice, cmdPool, nullptr);
+}
+
+void MemoryDefragmenter::step()
+{
+    ZoneScopedN("MemoryDefragmenter: step");
+    std::scoped_lock lock{_mux};
+    const auto &graphicsTimeline = _ctx.getQueueTimeline(_ctx.getGraphicsComputeQueue());
+    switch (_state)
+    {
+    case State::IDLE:
+        if (beginDefragmentation())
+        {
+            beginPass();
+        }
+        break;
+    case State::READY:
+        beginPass();
+        break;
+    case State::COPYING:
+        if (graphicsTimeline.isCompleted(_copied.value))
+        {
+            commitPass();
+        }
+        break;
+    case State::RETIRING:
+        if (graphicsTimeline.isCompleted(_retired.value))
+        {
+            endPass();
+        }
+        break;
+    }
+}
+
+void MemoryDefragmenter::finish()
+{
+    std::scoped_lock lock{_mux};
+    const auto &graphicsTimeline = _ctx.getQueueTimeline(_ctx.getGraphicsComputeQueue());
+    if (_state == State::COPYING)
+    {
+        graphicsTimeline.wait(_copied.value);
+        commitPass();
+    }
+    if (_state == State::RETIRING)
+    {
+        graphicsTimeline.wait(_retired.value);
+        endPass();
+    }
+    if (_state == State::READY)
+    {
+        endDefragmentation();
+    }
+}
+
+MemoryDefragmenter::Stats MemoryDefragmenter::stats() const
+{
+    std::scoped_lock lock{_mux};
+    return _stats;
+}
+
+bool MemoryDefragmenter::beginDefragmentation()
+{
+    std::vector<VmaPool> pools;
+    for (int category = GENERIC_MEMORY; category < MEMORY_CATEGORY_SIZE; ++category)
+    {
+        if (_memoryManager.categoryConfig(static_cast<MEMORY_CATEGORY>(category)).defragmentable)
+        {
+            const auto categoryPools = _memoryManager.pools(static_cast<MEMORY_CATEGORY>(category));
+            pools.insert(pools.end(), categoryPools.begin(), categoryPools.end());
+        }
+    }
+    if (pools.empty())
+    {
+        return false;
+    }
+
+    // one pool per step
+    const auto pool = pools[_nextPool % pools.size()];
+    _nextPool = (_nextPool + 1) % pools.size();
+    auto vmaAllocator = _memoryManager.getVmaAllocator();
+    VmaDetailedStatistics poolStats{};
+    vmaCalculatePoolStatistics(vmaAllocator, pool, &poolStats);
+    const auto &statistics = poolStats.statistics;
+    // worth it once the free space adds up to a whole block
+    if (statistics.blockCount < 2 ||
+        statistics.blockBytes - statistics.allocationBytes < statistics.blockBytes / statistics.blockCount)
+    {
+        return false;
+    }
+
+    const VmaDefragmentationInfo defragmentationInfo{
+        .flags = VMA_DEFRAGMENTATION_FLAG_ALGORITHM_BALANCED_BIT,
+        .pool = pool,
+        .maxBytesPerPass = _maxBytesPerPass,
+        .maxAllocationsPerPass = _maxAllocationsPerPass,
+    };
+    VK_CHECK(vmaBeginDefragmentation(vmaAllocator, &defragmentationInfo, &_defragmentationCtx));
+    _state = State::READY;
+    ++_stats.defragmentations;
+    return true;
+}
+
+void MemoryDefragmenter::beginPass()
+{
+    auto vmaAllocator = _memoryManager.getVmaAllocator();
+    _pass = {};
+    if (vmaBeginDefragmentationPass(vmaAllocator, _defragmentationCtx, &_pass) == VK_SUCCESS)
+    {
+        // nothing left to move
+        endDefragmentation();
+        return;
+    }
+
+    ZoneScopedN("MemoryDefragmenter: record");
+    const auto cmdBufferHandle = std::get<COMMAND_BUFFER_ENTITY_OFFSET::COMMAND_BUFFER>(_cmdBuffer);
+    _relocations.clear();
+    bool recording = false;
+    for (uint32_t i = 0; i < _pass.moveCount; ++i)
+    {
+        auto &move = _pass.pMoves[i];
+        auto relocation = _memoryManager.findRelocation(move.srcAllocation);
+        if (!relocation)
+        {
+            // nobody knows how to rebind it
+            move.operation = VMA_DEFRAGMENTATION_MOVE_OPERATION_IGNORE;
+            continue;
+        }
+        if (!recording)
+        {
+            _ctx.BeginRecordCommandBuffer(_cmdBuffer);
+            recording = true;
+        }
+        if (!relocation->record(move.dstTmpAllocation, cmdBufferHandle))
+        {
+            move.operation = VMA_DEFRAGMENTATION_MOVE_OPERATION_IGNORE;
+            continue;
+        }
+        _relocations.emplace_back(std::move(*relocation));
+    }
+
+    if (recording && _relocations.empty())
+    {
+        // never submitted, reset by the next BeginRecordCommandBuffer
+        _ctx.EndRecordCommandBuffer(_cmdBuffer);
+    }
+    if (_relocations.empty())
+    {
+        // every move ignored, another pass would pick the same allocations
+        vmaEndDefragmentationPass(vmaAllocator, _defragmentationCtx, &_pass);
+        endDefragmentation();
+        return;
+    }
+    _ctx.EndRecordCommandBuffer(_cmdBuffer);
+    _copied = _ctx.submitCommandBuffer(_cmdBuffer);
+    _state = State::COPYING;
+    ++_stats.passes;
+}
+
+void MemoryDefragmenter::commitPass()
+{
+    for (const auto &relocation : _relocations)
+    {
+        relocation.commit();
+    }
+    // frames recorded before the commit still use the old resources
+    _retired = _ctx.getQueueTimeline(_ctx.getGraphicsComputeQueue()).lastSubmitted();
+    _state = State::RETIRING;
+}
+
+void MemoryDefragmenter::endPass()
+{
+    for (const auto &relocation : _relocations)
+    {
+        relocation.release();
+    }
+    _relocations.clear();
+    // the moved allocations now point at the new memory
+    if (vmaEndDefragmentationPass(_memoryManager.getVmaAllocator(), _defragmentationCtx, &_pass) == VK_SUCCESS)
+    {
+        endDefragmentation();
+        return;
+    }
+    _state = State::READY;
+}
+
+void MemoryDefragmenter::endDefragmentation()
+{
+    VmaDefragmentationStats defragmentationStats{};
+    vmaEndDefragmentation(_memoryManager.getVmaAllocator(), _defragmentationCtx, &defragmentationStats);
+    _defragmentationCtx = VK_NULL_HANDLE;
+    _state = State::IDLE;
+    _stats.bytesMoved += defragmentationStats.bytesMoved;
+    _stats.bytesFreed += defragmentationStats.bytesFreed;
+    _stats.allocationsMoved += defragmentationStats.allocationsMoved;
+    _stats.deviceMemoryBlocksFreed += defragmentationStats.deviceMemoryBlocksFreed;
+    TracyPlot("MemoryDefragmenter bytes moved", static_cast<int64_t>(_stats.bytesMoved));
+    TracyPlot("MemoryDefragmenter bytes freed", static_cast<int64_t>(_stats.bytesFreed));
+}
+
+ImageEntity MemoryDefragmenter::relocateImage(VkContext &ctx, const ImageEntity &image, VkImageUsageFlags usage,
+                                              VmaAllocation dstTmpAllocation, VkCommandBuffer cmd)
+{
+    auto logicalDevice = ctx.getLogicDevice();
+    auto vmaAllocator = ctx.getVmaAllocator();
+    const auto srcImage = std::get<IMAGE_ENTITY_OFFSET::IMAGE>(image);
+    const auto mipLevels = std::get<IMAGE_ENTITY_OFFSET::MIPMAP_COUNT>(image);
+    const auto extent = std::get<IMAGE_ENTITY_OFFSET::IMAGE_EXTENT>(image);
+    const auto format = std::get<IMAGE_ENTITY_OFFSET::IMAGE_FORMAT>(image);
+    const auto arrayLayers = std::get<IMAGE_ENTITY_OFFSET::IMAGE_ARRAY_LAYERS>(image);
+    const auto imageType = extent.depth > 1 ? VK_IMAGE_TYPE_3D : VK_IMAGE_TYPE_2D;
+    ASSERT(usage & VK_IMAGE_USAGE_TRANSFER_SRC_BIT, "a relocatable image is copied from");
+
+    VkImageCreateInfo imageCreateInfo{};
+    imageCreateInfo.sType = VK_STRUCTURE_TYPE_IMAGE_CREATE_INFO;
+    imageCreateInfo.imageType = imageType;
+    imageCreateInfo.format = format;
+    imageCreateInfo.mipLevels = mipLevels;
+    imageCreateInfo.arrayLayers = arrayLayers;
+    imageCreateInfo.samples = VK_SAMPLE_COUNT_1_BIT;
+    imageCreateInfo.tiling = VK_IMAGE_TILING_OPTIMAL;
+    imageCreateInfo.usage = usage | VK_IMAGE_USAGE_TRANSFER_DST_BIT;
+    imageCreateInfo.sharingMode = VK_SHARING_MODE_EXCLUSIVE;
+    imageCreateInfo.initialLayout = VK_IMAGE_LAYOUT_UNDEFINED;
+    imageCreateInfo.extent = extent;
+    VkImage dstImage{VK_NULL_HANDLE};
+    VK_CHECK(vkCreateImage(logicalDevice, &imageCreateInfo, nullptr, &dstImage));
+    VK_CHECK(vmaBindImageMemory(vmaAllocator, dstTmpAllocation, dstImage));
+
+    const VkImageSubresourceRange subresourceRange{VK_IMAGE_ASPECT_COLOR_BIT, 0, mipLevels, 0, arrayLayers};
+    // read by the frames in flight, same queue: ordered by the barriers
+    // any stage may sample it (graphics, compute, ray tracing)
+    std::array<VkImageMemoryBarrier2, 2> toTransfer{
+        VkImageMemoryBarrier2{
+            .sType = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER_2,
+            .srcStageMask = VK_PIPELINE_STAGE_2_ALL_COMMANDS_BIT,
+            .srcAccessMask = VK_ACCESS_2_NONE,
+            .dstStageMask = VK_PIPELINE_STAGE_2_TRANSFER_BIT,
+            .dstAccessMask = VK_ACCESS_2_TRANSFER_READ_BIT,
+            .oldLayout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL,
+            .newLayout = VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL,
+            .srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED,
+            .dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED,
+            .image = srcImage,
+            .subresourceRange = subresourceRange,
+        },
+        VkImageMemoryBarrier2{
+            .sType = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER_2,
+            .srcStageMask = VK_PIPELINE_STAGE_2_NONE,
+            .srcAccessMask = VK_ACCESS_2_NONE,
+            .dstStageMask = VK_PIPELINE_STAGE_2_TRANSFER_BIT,
+            .dstAccessMask = VK_ACCESS_2_TRANSFER_WRITE_BIT,
+            .oldLayout = VK_IMAGE_LAYOUT_UNDEFINED,
+            .newLayout = VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL,
+            .srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED,
+            .dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED,
+            .image = dstImage,
+            .subresourceRange = subresourceRange,
+        },
+    };
+    const VkDependencyInfo toTransferDependency{
+        .sType = VK_STRUCTURE_TYPE_DEPENDENCY_INFO,
+        .imageMemoryBarrierCount = static_cast<uint32_t>(toTransfer.size()),
+        .pImageMemoryBarriers = toTransfer.data(),
+    };
+    vkCmdPipelineBarrier2(cmd, &toTransferDependency);
+
+    std::vector<VkImageCopy> regions(mipLevels);
+    for (uint32_t mipLevel = 0; mipLevel < mipLevels; ++mipLevel)
+    {
+        const VkExtent3D mipExtent{
+            (std::max)(extent.width >> mipLevel, 1u),
+            (std::max)(extent.height >> mipLevel, 1u),
+            (std::max)(extent.depth >> mipLevel, 1u),
+        };
+        regions[mipLevel] = VkImageCopy{
+            .srcSubresource = {VK_IMAGE_ASPECT_COLOR_BIT, mipLevel, 0, arrayLayers},
+            .dstSubresource = {VK_IMAGE_ASPECT_COLOR_BIT, mipLevel, 0, arrayLayers},
+            .extent = mipExtent,
+        };
+    }
+    vkCmdCopyImage(cmd, srcImage, VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL, dstImage,
+                   VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, static_cast<uint32_t>(regions.size()), regions.data());
+
+    // back to sampled: the old one until the commit, the new one after
+    std::array<VkImageMemoryBarrier2, 2> toShaderRead{toTransfer};
+    for (auto &barrier : toShaderRead)
+    {
+        barrier.srcStageMask = VK_PIPELINE_STAGE_2_TRANSFER_BIT;
+        barrier.srcAccessMask = barrier.dstAccessMask;
+        barrier.dstStageMask = VK_PIPELINE_STAGE_2_ALL_COMMANDS_BIT;
+        barrier.dstAccessMask = VK_ACCESS_2_SHADER_SAMPLED_READ_BIT;
+        barrier.oldLayout = barrier.newLayout;
+        barrier.newLayout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL;
+    }
+    const VkDependencyInfo toShaderReadDependency{
+        .sType = VK_STRUCTURE_TYPE_DEPENDENCY_INFO,
+        .imageMemoryBarrierCount = static_cast<uint32_t>(toShaderRead.size()),
+        .pImageMemoryBarriers = toShaderRead.data(),
+    };
+    vkCmdPipelineBarrier2(cmd, &toShaderReadDependency);
+
+    VkImageViewCreateInfo imageViewInfo = {};
+    imageViewInfo.sType = VK_STRUCTURE_TYPE_IMAGE_VIEW_CREATE_INFO;
+    imageViewInfo.viewType = arrayLayers > 1 ? VK_IMAGE_VIEW_TYPE_2D_ARRAY : getImageViewType(imageType);
+    imageViewInfo.format = format;
+    imageViewInfo.subresourceRange = subresourceRange;
+    imageViewInfo.image = dstImage;
+    VkImageView dstImageView{VK_NULL_HANDLE};
+    VK_CHECK(vkCreateImageView(logicalDevice, &imageViewInfo, nullptr, &dstImageView));
+
+    // same VmaAllocation handle: vma moves it to the new memory at the end of the pass
+    auto relocated = image;
+    std::get<IMAGE_ENTITY_OFFSET::IMAGE>(relocated) = dstImage;
+    std::get<IMAGE_ENTITY_OFFSET::IMAGE_VIEW>(relocated) = dstImageView;
+    return relocated;
+}
+
+BufferEntity MemoryDefragmenter::relocateBuffer(VkContext &ctx, const BufferEntity &buffer, VkBufferUsageFlags usage,
+                                                VmaAllocation dstTmpAllocation, VkCommandBuffer cmd)
+{
+    auto logicalDevice = ctx.getLogicDevice();
+    auto vmaAllocator = ctx.getVmaAllocator();
+    ASSERT(usage & VK_BUFFER_USAGE_TRANSFER_SRC_BIT, "a relocatable buffer is copied from");
+    const auto srcBuffer = std::get<BUFFER_ENTITY_UID::BUFFER>(buffer);
+    const auto sizeInBytes = std::get<BUFFER_ENTITY_UID::BUFFER_SIZE>(buffer);
+
+    const VkBufferCreateInfo bufferCreateInfo{
+        .sType = VK_STRUCTURE_TYPE_BUFFER_CREATE_INFO,
+        .size = sizeInBytes,
+        .usage = usage | VK_BUFFER_USAGE_TRANSFER_DST_BIT,
+        .sharingMode = VK_SHARING_MODE_EXCLUSIVE,
+    };
+    VkBuffer dstBuffer{VK_NULL_HANDLE};
+    VK_CHECK(vkCreateBuffer(logicalDevice, &bufferCreateInfo, nullptr, &dstBuffer));
+    VK_CHECK(vmaBindBufferMemory(vmaAllocator, dstTmpAllocation, dstBuffer));
+
+    // previous reads/writes of any stage on this queue
+    const VkMemoryBarrier2 toTransfer{
+        .sType = VK_STRUCTURE_TYPE_MEMORY_BARRIER_2,
+        .srcStageMask = VK_PIPELINE_STAGE_2_ALL_COMMANDS_BIT,
+        .srcAccessMask = VK_ACCESS_2_MEMORY_WRITE_BIT,
+        .dstStageMask = VK_PIPELINE_STAGE_2_TRANSFER_BIT,
+        .dstAccessMask = VK_ACCESS_2_TRANSFER_READ_BIT | VK_ACCESS_2_TRANSFER_WRITE_BIT,
+    };
+    const VkDependencyInfo toTransferDependency{
+        .sType = VK_STRUCTURE_TYPE_DEPENDENCY_INFO,
+        .memoryBarrierCount = 1,
+        .pMemoryBarriers = &toTransfer,
+    };
+    vkCmdPipelineBarrier2(cmd, &toTransferDependency);
+
+    const VkBufferCopy region{.srcOffset = 0, .dstOffset = 0, .size = sizeInBytes};
+    vkCmdCopyBuffer(cmd, srcBuffer, dstBuffer, 1, &region);
+
+    const VkMemoryBarrier2 toAnyRead{
+        .sType = VK_STRUCTURE_TYPE_MEMORY_BARRIER_2,
+        .srcStageMask = VK_PIPELINE_STAGE_2_TRANSFER_BIT,
+        .srcAccessMask = VK_ACCESS_2_TRANSFER_WRITE_BIT,
+        .dstStageMask = VK_PIPELINE_STAGE_2_ALL_COMMANDS_BIT,
+        .dstAccessMask = VK_ACCESS_2_MEMORY_READ_BIT | VK_ACCESS_2_MEMORY_WRITE_BIT,
+    };
+    const VkDependencyInfo toAnyReadDependency{
+        .sType = VK_STRUCTURE_TYPE_DEPENDENCY_INFO,
+        .memoryBarrierCount = 1,
+        .pMemoryBarriers = &toAnyRead,
+    };
+    vkCmdPipelineBarrier2(cmd, &toAnyReadDependency);
+
+    auto relocated = buffer;
+    std::get<BUFFER_ENTITY_UID::BUFFER>(relocated) = dstBuffer;
+    std::get<BUFFER_ENTITY_UID::MAPPING_ADDRESS>(relocated) = nullptr;
+    if (usage & VK_BUFFER_USAGE_SHADER_DEVICE_ADDRESS_BIT)
+    {
+        VkBufferDeviceAddressInfoKHR bufferDeviceAI{};
+        bufferDeviceAI.sType = VK_STRUCTURE_TYPE_BUFFER_DEVICE_ADDRESS_INFO;
+        bufferDeviceAI.buffer = dstBuffer;
+        std::get<BUFFER_ENTITY_UID::DEVICE_HOST_ADDRESS>(relocated).deviceAddress =
+            vkGetBufferDeviceAddressKHR(logicalDevice, &bufferDeviceAI);
+    }
+    return relocated;
+}
@@ -0,0 +1,91 @@
+#pragma once
+
+#include <mutex>
+#include <vector>
+#include <cstdint>
+
+#include <context.h>
+#include <memoryManager.h>
+
+// incremental vma defragmentation of the defragmentable pools (see MemoryCategoryConfig), one pass in flight
+// step() at every frame boundary moves it along without blocking:
+// 1. a pool worth it (at least one block could be freed) begins a defragmentation
+// 2. begin pass: every move with a registered MemoryRelocation records its copy into a graphics command
+//    buffer, the others are ignored (left in place), then one submit
+// 3. the copies are done: commit, the users switch to the new resources
+// 4. the frames submitted before the commit are done: release the old resources, end the pass
+// render thread only; finish() before destroying a resource that has a relocation
+class MemoryDefragmenter
+{
+public:
+    static constexpr VkDeviceSize DEFAULT_MAX_BYTES_PER_PASS = 16ull * 1024 * 1024; // 16 MB
+    static constexpr uint32_t DEFAULT_MAX_ALLOCATIONS_PER_PASS = 16;
+
+    struct Stats
+    {
+        uint64_t defragmentations{0};
+        uint64_t passes{0};
+        uint64_t bytesMoved{0};
+        uint64_t bytesFreed{0};
+        uint64_t allocationsMoved{0};
+        uint64_t deviceMemoryBlocksFreed{0};
+    };
+
+    MemoryDefragmenter() = delete;
+    MemoryDefragmenter(VkContext &ctx, MemoryManager &memoryManager,
+                       VkDeviceSize maxBytesPerPass = DEFAULT_MAX_BYTES_PER_PASS,
+                       uint32_t maxAllocationsPerPass = DEFAULT_MAX_ALLOCATIONS_PER_PASS);
+    ~MemoryDefragmenter();
+
+    MemoryDefragmenter(const MemoryDefragmenter &other) = delete;
+    MemoryDefragmenter &operator=(const MemoryDefragmenter &other) = delete;
+
+    void step();
+    // blocks until the pass in flight is over, then ends the defragmentation
+    void finish();
+
+    Stats stats() const;
+
+    // for MemoryRelocation::record, usage: the one the resource was created with, including TRANSFER_SRC
+    // a copy of image bound to dstTmpAllocation, every mip level and array layer copied on cmd,
+    // both images in SHADER_READ_ONLY_OPTIMAL before and after
+    static ImageEntity relocateImage(VkContext &ctx, const ImageEntity &image, VkImageUsageFlags usage,
+                                     VmaAllocation dstTmpAllocation, VkCommandBuffer cmd);
+    // a copy of buffer bound to dstTmpAllocation, the content is copied on cmd
+    // the device address changes, the mapping is not carried over
+    static BufferEntity relocateBuffer(VkContext &ctx, const BufferEntity &buffer, VkBufferUsageFlags usage,
+                                       VmaAllocation dstTmpAllocation, VkCommandBuffer cmd);
+
+private:
+    enum class State
+    {
+        IDLE,      // no defragmentation
+        READY,     // between passes
+        COPYING,   // pass submitted
+        RETIRING,  // committed, the old resources may still be in use
+    };
+
+    bool beginDefragmentation();
+    void beginPass();
+    void commitPass();
+    void endPass();
+    void endDefragmentation();
+
+    VkContext &_ctx;
+    MemoryManager &_memoryManager;
+    const VkDeviceSize _maxBytesPerPass;
+    const uint32_t _maxAllocationsPerPass;
+
+    mutable std::mutex _mux;
+    State _state{State::IDLE};
+    CommandBufferEntity _cmdBuffer;
+    // round robin over the pools
+    size_t _nextPool{0};
+    VmaDefragmentationContext _defragmentationCtx{VK_NULL_HANDLE};
+    VmaDefragmentationPassMoveInfo _pass{};
+    // the moves recorded in this pass
+    std::vector<MemoryRelocation> _relocations;
+    TimelinePoint _copied{};
+    TimelinePoint _retired{};
+    Stats _stats;
+};
@@ -0,0 +1,296 @@
+#include <algorithm>
+#include <format>
+#include <fstream>
+
+#include <tracy/Tracy.hpp>
+
+#include <memoryManager.h>
+
+// the pools grow by blocks, one VkDeviceMemory each
+static constexpr VkDeviceSize STATIC_GEOMETRY_BLOCK_SIZE = 64ull * 1024 * 1024; // 64 MB
+static constexpr VkDeviceSize TEXTURE_BLOCK_SIZE = 64ull * 1024 * 1024;         // 64 MB
+static constexpr VkDeviceSize DYNAMIC_BLOCK_SIZE = 16ull * 1024 * 1024;         // 16 MB
+static constexpr VkDeviceSize STAGING_BLOCK_SIZE = 32ull * 1024 * 1024;         // 32 MB
+
+static const char *categoryName(MEMORY_CATEGORY category)
+{
+    switch (category)
+    {
+    case STATIC_GEOMETRY_MEMORY:
+        return "static geometry";
+    case TEXTURE_MEMORY:
+        return "texture";
+    case DYNAMIC_MEMORY:
+        return "dynamic";
+    case STAGING_MEMORY:
+        return "staging";
+    default:
+        return "generic";
+    }
+}
+
+MemoryManager::Config MemoryManager::defaultConfig()
+{
+    Config config;
+    // no geometry buffer registers a MemoryRelocation yet: every move would be skipped
+    config.categories[STATIC_GEOMETRY_MEMORY] = {.blockSize = STATIC_GEOMETRY_BLOCK_SIZE};
+    config.categories[TEXTURE_MEMORY] = {.blockSize = TEXTURE_BLOCK_SIZE, .defragmentable = true};
+    config.categories[DYNAMIC_MEMORY] = {.blockSize = DYNAMIC_BLOCK_SIZE};
+    config.categories[STAGING_MEMORY] = {.blockSize = STAGING_BLOCK_SIZE};
+    return config;
+}
+
+MemoryManager::MemoryManager(VmaAllocator vmaAllocator, const Config &config, bool memoryBudgetSupported)
+    : _vmaAllocator(vmaAllocator), _config(config), _memoryBudgetSupported(memoryBudgetSupported)
+{
+    ASSERT(_vmaAllocator, "MemoryManager needs a vma allocator");
+    ASSERT(_config.targetBudgetRatio <= _config.overBudgetRatio, "target budget must be under the eviction threshold");
+    VmaAllocatorInfo allocatorInfo{};
+    vmaGetAllocatorInfo(_vmaAllocator, &allocatorInfo);
+    _logicalDevice = allocatorInfo.device;
+    const VkPhysicalDeviceMemoryProperties *memoryProperties = nullptr;
+    vmaGetMemoryProperties(_vmaAllocator, &memoryProperties);
+    _memoryHeapCount = memoryProperties->memoryHeapCount;
+    _memoryTypeCount = memoryProperties->memoryTypeCount;
+    _budgets.resize(_memoryHeapCount);
+    _heapOverBudget.resize(_memoryHeapCount, false);
+    for (uint32_t i = 0; i < _memoryHeapCount; ++i)
+    {
+        _usagePlotNames.emplace_back("vma heap " + std::to_string(i) + " usage");
+        _budgetPlotNames.emplace_back("vma heap " + std::to_string(i) + " budget");
+    }
+    log(Level::Info, "MemoryManager: ", _memoryHeapCount, " heaps, VK_EXT_memory_budget: ", _memoryBudgetSupported);
+}
+
+MemoryManager::~MemoryManager()
+{
+    for (const auto &[key, pool] : _pools)
+    {
+        vmaDestroyPool(_vmaAllocator, pool);
+    }
+}
+
+VmaPool MemoryManager::findPool(MEMORY_CATEGORY category,
+                                const VkBufferCreateInfo &bufferCreateInfo,
+                                const VmaAllocationCreateInfo &allocCreateInfo)
+{
+    if (category == GENERIC_MEMORY)
+    {
+        return VK_NULL_HANDLE;
+    }
+    const VkDeviceBufferMemoryRequirements bufferRequirementsInfo{
+        .sType = VK_STRUCTURE_TYPE_DEVICE_BUFFER_MEMORY_REQUIREMENTS,
+        .pCreateInfo = &bufferCreateInfo,
+    };
+    VkMemoryRequirements2 memoryRequirements{.sType = VK_STRUCTURE_TYPE_MEMORY_REQUIREMENTS_2};
+    vkGetDeviceBufferMemoryRequirements(_logicalDevice, &bufferRequirementsInfo, &memoryRequirements);
+    if (!fitsPool(category, memoryRequirements.memoryRequirements.size, allocCreateInfo))
+    {
+        return VK_NULL_HANDLE;
+    }
+    uint32_t memTypeIndex = UINT32_MAX;
+    VK_CHECK(vmaFindMemoryTypeIndexForBufferInfo(_vmaAllocator, &bufferCreateInfo, &allocCreateInfo, &memTypeIndex));
+    std::scoped_lock lock{_mux};
+    return findPoolLocked(category, memTypeIndex);
+}
+
+VmaPool MemoryManager::findPool(MEMORY_CATEGORY category,
+                                const VkImageCreateInfo &imageCreateInfo,
+                                const VmaAllocationCreateInfo &allocCreateInfo)
+{
+    if (category == GENERIC_MEMORY)
+    {
+        return VK_NULL_HANDLE;
+    }
+    const VkDeviceImageMemoryRequirements imageRequirementsInfo{
+        .sType = VK_STRUCTURE_TYPE_DEVICE_IMAGE_MEMORY_REQUIREMENTS,
+        .pCreateInfo = &imageCreateInfo,
+    };
+    VkMemoryRequirements2 memoryRequirements{.sType = VK_STRUCTURE_TYPE_MEMORY_REQUIREMENTS_2};
+    vkGetDeviceImageMemoryRequirements(_logicalDevice, &imageRequirementsInfo, &memoryRequirements);
+    if (!fitsPool(category, memoryRequirements.memoryRequirements.size, allocCreateInfo))
+    {
+        return VK_NULL_HANDLE;
+    }
+    uint32_t memTypeIndex = UINT32_MAX;
+    VK_CHECK(vmaFindMemoryTypeIndexForImageInfo(_vmaAllocator, &imageCreateInfo, &allocCreateInfo, &memTypeIndex));
+    std::scoped_lock lock{_mux};
+    return findPoolLocked(category, memTypeIndex);
+}
+
+bool MemoryManager::fitsPool(MEMORY_CATEGORY category,
+                             VkDeviceSize sizeInBytes,
+                             const VmaAllocationCreateInfo &allocCreateInfo) const
+{
+    // a pool with an explicit block size neither spans blocks nor hands out dedicated memory
+    const auto blockSize = _config.categories[category].blockSize;
+    if ((allocCreateInfo.flags & VMA_ALLOCATION_CREATE_DEDICATED_MEMORY_BIT) != 0 ||
+        (blockSize != 0 && sizeInBytes > blockSize))
+    {
+        log(Level::Info, "MemoryManager: ", sizeInBytes, " bytes of ", categoryName(category),
+            " memory from the default heaps");
+        return false;
+    }
+    return true;
+}
+
+VmaPool MemoryManager::findPoolLocked(MEMORY_CATEGORY category, uint32_t memTypeIndex)
+{
+    const auto key = std::make_pair(category, memTypeIndex);
+    if (const auto it = _pools.find(key); it != _pools.end())
+    {
+        return it->second;
+    }
+    const auto &categoryConfig = _config.categories[category];
+    VmaPoolCreateInfo poolCreateInfo = {};
+    poolCreateInfo.memoryTypeIndex = memTypeIndex;
+    poolCreateInfo.blockSize = categoryConfig.blockSize;
+    poolCreateInfo.maxBlockCount = categoryConfig.maxBlockCount;
+
+    VmaPool pool{VK_NULL_HANDLE};
+    VK_CHECK(vmaCreatePool(_vmaAllocator, &poolCreateInfo, &pool));
+    // shows up in vmaBuildStatsString
+    const auto poolName = std::string(categoryName(category)) + " (memory type " + std::to_string(memTypeIndex) + ")";
+    vmaSetPoolName(_vmaAllocator, pool, poolName.c_str());
+    _pools.emplace(key, pool);
+    log(Level::Info, "MemoryManager: pool ", poolName);
+    return pool;
+}
+
+std::vector<VmaPool> MemoryManager::pools(MEMORY_CATEGORY category) const
+{
+    std::scoped_lock lock{_mux};
+    std::vector<VmaPool> res;
+    for (const auto &[key, pool] : _pools)
+    {
+        if (key.first == category)
+        {
+            res.push_back(pool);
+        }
+    }
+    return res;
+}
+
+void MemoryManager::registerEvictionHandler(MEMORY_CATEGORY category, EvictionHandler handler)
+{
+    std::scoped_lock lock{_mux};
+    _evictionHandlers[category].emplace_back(std::move(handler));
+}
+
+void MemoryManager::registerRelocation(VmaAllocation allocation, MemoryRelocation relocation)
+{
+    std::scoped_lock lock{_mux};
+    _relocations.insert_or_assign(allocation, std::move(relocation));
+}
+
+void MemoryManager::unregisterRelocation(VmaAllocation allocation)
+{
+    std::scoped_lock lock{_mux};
+    _relocations.erase(allocation);
+}
+
+std::optional<MemoryRelocation> MemoryManager::findRelocation(VmaAllocation allocation) const
+{
+    std::scoped_lock lock{_mux};
+    if (const auto it = _relocations.find(allocation); it != _relocations.end())
+    {
+        return it->second;
+    }
+    return std::nullopt;
+}
+
+void MemoryManager::update(uint32_t frameIndex)
+{
+    ZoneScopedN("MemoryManager: update");
+    // lost/used-in-frame bookkeeping of vma, and refreshes the budgets
+    vmaSetCurrentFrameIndex(_vmaAllocator, frameIndex);
+    std::vector<VmaBudget> budgets(_memoryHeapCount);
+    vmaGetHeapBudgets(_vmaAllocator, budgets.data());
+    {
+        std::scoped_lock lock{_mux};
+        _budgets = budgets;
+    }
+
+    for (uint32_t heapIndex = 0; heapIndex < _memoryHeapCount; ++heapIndex)
+    {
+        const auto &budget = budgets[heapIndex];
+        TracyPlot(_usagePlotNames[heapIndex].c_str(), static_cast<int64_t>(budget.usage));
+        TracyPlot(_budgetPlotNames[heapIndex].c_str(), static_cast<int64_t>(budget.budget));
+
+        const auto overBudget = static_cast<VkDeviceSize>(static_cast<double>(budget.budget) * _config.overBudgetRatio);
+        if (budget.budget == 0 || budget.usage <= overBudget)
+        {
+            _heapOverBudget[heapIndex] = false;
+            continue;
+        }
+        if (!_heapOverBudget[heapIndex])
+        {
+            // once per crossing, the eviction keeps going every frame until back under budget
+            log(Level::Warn, "MemoryManager: heap ", heapIndex, " over budget, usage ", budget.usage,
+                " budget ", budget.budget);
+            _heapOverBudget[heapIndex] = true;
+        }
+        const auto target = static_cast<VkDeviceSize>(static_cast<double>(budget.budget) * _config.targetBudgetRatio);
+        evict(heapIndex, budget.usage - target);
+    }
+}
+
+void MemoryManager::evict(uint32_t heapIndex, VkDeviceSize bytesToFree)
+{
+    ZoneScopedN("MemoryManager: evict");
+    // cheapest to bring back first
+    static constexpr std::array<MEMORY_CATEGORY, 4> EVICTION_ORDER{
+        TEXTURE_MEMORY, STATIC_GEOMETRY_MEMORY, GENERIC_MEMORY, DYNAMIC_MEMORY};
+
+    std::array<std::vector<EvictionHandler>, MEMORY_CATEGORY_SIZE> handlers;
+    {
+        // outside the lock: the handlers free allocations and unregister their relocations
+        std::scoped_lock lock{_mux};
+        handlers = _evictionHandlers;
+    }
+
+    const VkDeviceSize requested = bytesToFree;
+    for (const auto category : EVICTION_ORDER)
+    {
+        for (const auto &handler : handlers[category])
+        {
+            if (bytesToFree == 0)
+            {
+                break;
+            }
+            const auto freed = handler(heapIndex, bytesToFree);
+            bytesToFree -= (std::min)(freed, bytesToFree);
+        }
+    }
+    const auto message = std::format("MemoryManager: heap {} over budget, evicted {} of {} bytes",
+                                     heapIndex, requested - bytesToFree, requested);
+    TracyMessage(message.c_str(), message.size());
+}
+
+std::vector<VmaBudget> MemoryManager::budgets() const
+{
+    std::scoped_lock lock{_mux};
+    return _budgets;
+}
+
+std::string MemoryManager::statsString(bool detailed) const
+{
+    char *stats = nullptr;
+    vmaBuildStatsString(_vmaAllocator, &stats, detailed ? VK_TRUE : VK_FALSE);
+    std::string res{stats};
+    vmaFreeStatsString(_vmaAllocator, stats);
+    return res;
+}
+
+void MemoryManager::dumpStats(const std::string &path, bool detailed) const
+{
+    std::ofstream file(path, std::ios::out | std::ios::trunc);
+    if (!file)
+    {
+        log(Level::Warn, "MemoryManager: cannot write ", path);
+        return;
+    }
+    // open with VmaDumpVis.py (vma repo, tools/) for a picture of the blocks
+    file << statsString(detailed);
+    log(Level::Info, "MemoryManager: stats written to ", path);
+}
@@ -0,0 +1,146 @@
+#pragma once
+
+#include <array>
+#include <functional>
+#include <map>
+#include <mutex>
+#include <optional>
+#include <string>
+#include <unordered_map>
+#include <vector>
+#include <cstdint>
+
+// must ahead of <vk_mem_alloc.h>, see context.h
+#include <misc.h>
+#include <vk_mem_alloc.h>
+
+// which vma pool an allocation comes from
+// GENERIC_MEMORY: the default vma heaps, no custom pool
+enum MEMORY_CATEGORY : int
+{
+    GENERIC_MEMORY = 0,
+    STATIC_GEOMETRY_MEMORY,
+    TEXTURE_MEMORY,
+    DYNAMIC_MEMORY,
+    STAGING_MEMORY,
+    MEMORY_CATEGORY_SIZE
+};
+
+struct MemoryCategoryConfig
+{
+    // bytes per VkDeviceMemory block of the pool, 0: vma default (256 MB, smaller for small heaps)
+    // requests bigger than an explicit block go to the default heaps, see MemoryManager::findPool
+    VkDeviceSize blockSize{0};
+    // 0: no limit, allocations past it fail with VK_ERROR_OUT_OF_DEVICE_MEMORY
+    size_t maxBlockCount{0};
+    // only moves out of these pools
+    bool defragmentable{false};
+};
+
+// moves one allocation to the memory picked by the defragmenter, see MemoryDefragmenter
+// record: bind a new resource to dstTmpAllocation and record the copy, false to leave the allocation alone
+// commit: the copy is done, switch the users to the new resource (handles, descriptors, ...)
+// release: the gpu is done with the old resource, destroy it (vkDestroyBuffer/vkDestroyImage, not vma)
+struct MemoryRelocation
+{
+    std::function<bool(VmaAllocation dstTmpAllocation, VkCommandBuffer cmd)> record;
+    std::function<void()> commit;
+    std::function<void()> release;
+};
+
+// per-category vma pools, VK_EXT_memory_budget tracking and eviction hooks
+// 1. the pools are created lazily, one per (category, memory type)
+// 2. update() once per frame: vmaSetCurrentFrameIndex, heap budgets to tracy, and when a heap goes over
+//    overBudgetRatio of its budget the eviction handlers are called, textures first, then geometry,
+//    until usage is back under targetBudgetRatio
+// thread-safe
+class MemoryManager
+{
+public:
+    // bytesToFree on heapIndex, returns how many bytes were freed
+    using EvictionHandler = std::function<VkDeviceSize(uint32_t heapIndex, VkDeviceSize bytesToFree)>;
+
+    struct Config
+    {
+        std::array<MemoryCategoryConfig, MEMORY_CATEGORY_SIZE> categories{};
+        float overBudgetRatio{0.95f};
+        float targetBudgetRatio{0.85f};
+    };
+
+    static Config defaultConfig();
+
+    MemoryManager() = delete;
+    // memoryBudgetSupported: the allocator was created with VMA_ALLOCATOR_CREATE_EXT_MEMORY_BUDGET_BIT,
+    // otherwise vma estimates the budgets (80% of the heaps)
+    MemoryManager(VmaAllocator vmaAllocator, const Config &config, bool memoryBudgetSupported);
+    ~MemoryManager();
+
+    MemoryManager(const MemoryManager &other) = delete;
+    MemoryManager &operator=(const MemoryManager &other) = delete;
+
+    // VK_NULL_HANDLE for GENERIC_MEMORY, and for the requests the pool cannot take: dedicated ones and the
+    // ones bigger than the category block (vma fails those with VK_ERROR_OUT_OF_DEVICE_MEMORY)
+    // the memory type comes from the create infos, the pool ignores usage/requiredFlags afterwards
+    VmaPool findPool(MEMORY_CATEGORY category,
+                     const VkBufferCreateInfo &bufferCreateInfo,
+                     const VmaAllocationCreateInfo &allocCreateInfo);
+    VmaPool findPool(MEMORY_CATEGORY category,
+                     const VkImageCreateInfo &imageCreateInfo,
+                     const VmaAllocationCreateInfo &allocCreateInfo);
+    std::vector<VmaPool> pools(MEMORY_CATEGORY category) const;
+    const MemoryCategoryConfig &categoryConfig(MEMORY_CATEGORY category) const
+    {
+        return _config.categories[category];
+    }
+
+    void registerEvictionHandler(MEMORY_CATEGORY category, EvictionHandler handler);
+
+    // the defragmenter only moves allocations with a relocation
+    void registerRelocation(VmaAllocation allocation, MemoryRelocation relocation);
+    void unregisterRelocation(VmaAllocation allocation);
+    std::optional<MemoryRelocation> findRelocation(VmaAllocation allocation) const;
+
+    // once per frame, from the render thread
+    void update(uint32_t frameIndex);
+
+    // one per memory heap, as of the last update()
+    std::vector<VmaBudget> budgets() const;
+    bool memoryBudgetSupported() const
+    {
+        return _memoryBudgetSupported;
+    }
+
+    // vmaBuildStatsString json, detailed: every allocation
+    std::string statsString(bool detailed = false) const;
+    void dumpStats(const std::string &path, bool detailed = true) const;
+
+    VmaAllocator getVmaAllocator() const
+    {
+        return _vmaAllocator;
+    }
+
+private:
+    VmaPool findPoolLocked(MEMORY_CATEGORY category, uint32_t memTypeIndex);
+    bool fitsPool(MEMORY_CATEGORY category, VkDeviceSize sizeInBytes, const VmaAllocationCreateInfo &allocCreateInfo) const;
+    void evict(uint32_t heapIndex, VkDeviceSize bytesToFree);
+
+    VmaAllocator _vmaAllocator{VK_NULL_HANDLE};
+    VkDevice _logicalDevice{VK_NULL_HANDLE};
+    const Config _config;
+    const bool _memoryBudgetSupported;
+    uint32_t _memoryHeapCount{0};
+    uint32_t _memoryTypeCount{0};
+
+    mutable std::mutex _mux;
+    // (category, memTypeIndex) -> pool
+    std::map<std::pair<MEMORY_CATEGORY, uint32_t>, VmaPool> _pools;
+    std::unordered_map<VmaAllocation, MemoryRelocation> _relocations;
+    std::array<std::vector<EvictionHandler>, MEMORY_CATEGORY_SIZE> _evictionHandlers;
+    std::vector<VmaBudget> _budgets;
+    // render thread only
+    std::vector<bool> _heapOverBudget;
+
+    // tracy keeps the plot names by pointer
+    std::vector<std::string> _usagePlotNames;
+    std::vector<std::string> _budgetPlotNames;
+};
@@ -1,5 +1,7 @@
 #include <filesystem>
 #include <fstream>
+#include <map>
+#include <set>
 
 #include <glslang/Include/glslang_c_interface.h>
 #include <glslang/Public/resource_limits_c.h> //c
@@ -90,15 +92,23 @@ EShLanguage shaderStageFromFileName(const std::filesystem::path &path)
 // shaderDir for include
 // entryPoint: main()
 // std::vector<char>: binary array
+// sourceName: reported to the includer as the root of the include graph
+// includeGraph: optional, receives includer -> included headers
+// abortOnError: false for hot-reload, a typo in the shader should not kill the app
 std::vector<char> glslToSpirv(const std::vector<char> &shaderText,
                               EShLanguage shaderStage,
                               const std::string &shaderDir,
-                              const char *entryPoint)
+                              const char *entryPoint,
+                              const std::string &sourceName = "",
+                              std::map<std::string, std::set<std::string>> *includeGraph = nullptr,
+                              bool abortOnError = true)
 {
     glslang::TShader tmp(shaderStage);
     const char *data = shaderText.data();
+    const char *name = sourceName.c_str();
+    const int length = -1; // null-terminated
     // c style: array + size
-    tmp.setStrings(&data, 1);
+    tmp.setStringsWithLengthsAndNames(&data, &length, &name, 1);
 
     glslang::EshTargetClientVersion clientVersion = glslang::EShTargetVulkan_1_3;
     glslang::EShTargetLanguageVersion langVersion = glslang::EShTargetSpv_1_6;
@@ -141,10 +151,18 @@ std::vector<char> glslToSpirv(const std::vector<char> &shaderText,
         std::cout << std::endl;
         std::cout << tmp.getInfoLog() << std::endl;
         std::cout << tmp.getInfoDebugLog() << std::endl;
-        ASSERT(false, "Error occured");
+        if (abortOnError)
+        {
+            ASSERT(false, "Error occured");
+        }
         return std::vector<char>();
     }
 
+    if (includeGraph)
+    {
+        *includeGraph = includer.getIncludeGraph();
+    }
+
     // preprocessedGLSL = removeUnnecessaryLines(preprocessedGLSL);
 
     const char *preprocessedGLSLStr = preprocessedGLSL.c_str();
@@ -165,7 +183,10 @@ std::vector<char> glslToSpirv(const std::vector<char> &shaderText,
         std::cout << std::endl;
         std::cout << tshader.getInfoLog() << std::endl;
         std::cout << tshader.getInfoDebugLog() << std::endl;
-        ASSERT(false, "parse failed");
+        if (abortOnError)
+        {
+            ASSERT(false, "parse failed");
+        }
         return std::vector<char>();
     }
 
@@ -187,7 +208,11 @@ std::vector<char> glslToSpirv(const std::vector<char> &shaderText,
         std::cout << "Parsing failed for shader " << std::endl;
         std::cout << program.getInfoLog() << std::endl;
         std::cout << program.getInfoDebugLog() << std::endl;
-        ASSERT(false, "Failed to link shader stage to program");
+        if (abortOnError)
+        {
+            ASSERT(false, "Failed to link shader stage to program");
+        }
+        return std::vector<char>();
     }
 
     std::vector<uint32_t> spirvArtifacts;
@@ -211,7 +236,6 @@ VkShaderModule createShaderModule(
     const std::string &entryPoint,
     const std::string &correlationId)
 {
-    VkShaderModule res;
     const auto path = std::filesystem::path(filePath);
     const bool isBinary = path.extension().string() == ".spv";
     std::vector<char> data = readFile(filePath, isBinary);
@@ -220,17 +244,53 @@ VkShaderModule createShaderModule(
         data = glslToSpirv(data,
                            shaderStageFromFileName(path),
                            path.parent_path().string(),
-                           entryPoint.c_str());
+                           entryPoint.c_str(),
+                           path.string());
     }
+    return createShaderModule(logicalDevice, data, correlationId);
+}
+
+VkShaderModule createShaderModule(
+    VkDevice logicalDevice,
+    const std::vector<char> &spirv,
+    const std::string &correlationId)
+{
+    VkShaderModule res;
     const VkShaderModuleCreateInfo shaderModule = {
         .sType = VK_STRUCTURE_TYPE_SHADER_MODULE_CREATE_INFO,
-        .codeSize = data.size(),
-        .pCode = (const uint32_t *)data.data(),
+        .codeSize = spirv.size(),
+        .pCode = (const uint32_t *)spirv.data(),
     };
     VK_CHECK(vkCreateShaderModule(logicalDevice, &shaderModule, nullptr, &res));
     return res;
 }
 
+std::vector<char> compileGlslToSpirv(
+    const std::string &filePath,
+    const std::string &entryPoint,
+    std::map<std::string, std::set<std::string>> &includeGraph)
+{
+    const auto path = std::filesystem::path(filePath);
+    std::vector<char> data;
+    try
+    {
+        data = readFile(filePath, false);
+    }
+    catch (const std::runtime_error &)
+    {
+        // editors may replace the file (rename-on-save), it can be gone for a moment
+        log(Level::Warn, "compileGlslToSpirv: cannot read ", filePath);
+        return std::vector<char>();
+    }
+    return glslToSpirv(data,
+                       shaderStageFromFileName(path),
+                       path.parent_path().string(),
+                       entryPoint.c_str(),
+                       path.string(),
+                       &includeGraph,
+                       false);
+}
+
 // input: shaderModule Meta
 // output: to meet the vk api
 std::vector<VkPipelineShaderStageCreateInfo> gatherPipelineShaderStageCreateInfos(
@@ -6,6 +6,8 @@
 #include <iostream>
 #include <array>
 #include <unordered_map>
+#include <map>
+#include <set>
 #include <utility>
 #include <any>
 #if defined(__ANDROID__)
@@ -196,6 +198,10 @@ inline uint32_t alignedSize(uint32_t value, uint32_t alignment)
 {
     return (value + alignment - 1) & ~(alignment - 1);
 }
+inline VkDeviceSize alignedSize(VkDeviceSize value, VkDeviceSize alignment)
+{
+    return (value + alignment - 1) & ~(alignment - 1);
+}
 
 VkShaderModule createShaderModule(
     VkDevice logicalDevice,
@@ -203,6 +209,20 @@ VkShaderModule createShaderModule(
     const std::string &entryPoint,
     const std::string &correlationId);
 
+// from spirv already in memory, e.g. the hot-reload cache
+VkShaderModule createShaderModule(
+    VkDevice logicalDevice,
+    const std::vector<char> &spirv,
+    const std::string &correlationId);
+
+// runtime glsl -> spirv for shader hot-reload
+// compile errors are logged instead of asserted; an empty result means failure
+// includeGraph receives includer -> included headers seen by the preprocessor
+std::vector<char> compileGlslToSpirv(
+    const std::string &filePath,
+    const std::string &entryPoint,
+    std::map<std::string, std::set<std::string>> &includeGraph);
+
 std::vector<VkPipelineShaderStageCreateInfo> gatherPipelineShaderStageCreateInfos(const std::unordered_map<VkShaderStageFlagBits, std::tuple<VkShaderModule, const char *, const VkSpecializationInfo *>> &shaderModuleEntities);
 uint32_t findShaderStageIndex(const std::vector<VkPipelineShaderStageCreateInfo> &shaderStages, const VkShaderModule shaderModule);
 
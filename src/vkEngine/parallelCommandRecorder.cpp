@@ -0,0 +1,141 @@
+#include <algorithm>
+
+#include <tracy/Tracy.hpp>
+
+#include <parallelCommandRecorder.h>
+
+ParallelCommandRecorder::ParallelCommandRecorder(VkContext &ctx, JobSystem &jobSystem, uint32_t numFramesInFlight)
+    : _ctx(ctx), _jobSystem(jobSystem), _numSlots(static_cast<uint32_t>(jobSystem.numWorkers() + 1))
+{
+    ASSERT(numFramesInFlight > 0, "ParallelCommandRecorder needs at least one frame");
+    const auto logicalDevice = _ctx.getLogicDevice();
+    // no VK_COMMAND_POOL_CREATE_RESET_COMMAND_BUFFER_BIT: reset per frame, never per buffer
+    const VkCommandPoolCreateInfo poolInfo{
+        .sType = VK_STRUCTURE_TYPE_COMMAND_POOL_CREATE_INFO,
+        .flags = VK_COMMAND_POOL_CREATE_TRANSIENT_BIT,
+        .queueFamilyIndex = _ctx.getGraphicsComputeQueueFamilyIndex(),
+    };
+    _frames.resize(numFramesInFlight);
+    for (uint32_t frameId = 0; frameId < numFramesInFlight; ++frameId)
+    {
+        _frames[frameId].resize(_numSlots);
+        for (uint32_t slotId = 0; slotId < _numSlots; ++slotId)
+        {
+            auto &slot = _frames[frameId][slotId];
+            VK_CHECK(vkCreateCommandPool(logicalDevice, &poolInfo, nullptr, &slot.pool));
+            setCorrlationId(slot.pool, logicalDevice, VK_OBJECT_TYPE_COMMAND_POOL,
+                            "secondary: frame " + std::to_string(frameId) + " slot " + std::to_string(slotId));
+        }
+    }
+    log(Level::Info, "ParallelCommandRecorder: ", _numSlots, " slots x ", numFramesInFlight, " frames");
+}
+
+ParallelCommandRecorder::~ParallelCommandRecorder()
+{
+    const auto logicalDevice = _ctx.getLogicDevice();
+    for (const auto &frame : _frames)
+    {
+        for (const auto &slot : frame)
+        {
+            // frees the secondaries as well
+            vkDestroyCommandPool(logicalDevice, slot.pool, nullptr);
+        }
+    }
+}
+
+void ParallelCommandRecorder::beginFrame(uint32_t frameId)
+{
+    ASSERT(frameId < _frames.size(), "beginFrame:: frameId should be in a valid range");
+    TracyPlot("ParallelCommandRecorder: secondaries per frame", static_cast<int64_t>(numRecorded()));
+    _currentFrameId = frameId;
+    const auto logicalDevice = _ctx.getLogicDevice();
+    for (auto &slot : _frames[_currentFrameId])
+    {
+        if (slot.used == 0)
+        {
+            continue;
+        }
+        VK_CHECK(vkResetCommandPool(logicalDevice, slot.pool, 0));
+        slot.used = 0;
+    }
+}
+
+VkCommandBuffer ParallelCommandRecorder::acquire(Slot &slot)
+{
+    if (slot.used == slot.cmdBuffers.size())
+    {
+        const VkCommandBufferAllocateInfo allocInfo{
+            .sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO,
+            .commandPool = slot.pool,
+            .level = VK_COMMAND_BUFFER_LEVEL_SECONDARY,
+            .commandBufferCount = 1,
+        };
+        VkCommandBuffer cmdBuffer{VK_NULL_HANDLE};
+        VK_CHECK(vkAllocateCommandBuffers(_ctx.getLogicDevice(), &allocInfo, &cmdBuffer));
+        slot.cmdBuffers.push_back(cmdBuffer);
+    }
+    return slot.cmdBuffers[slot.used++];
+}
+
+void ParallelCommandRecorder::record(VkCommandBuffer primary,
+                                     const SecondaryCommandBufferInheritance &inheritance,
+                                     size_t count,
+                                     size_t minRangeSize,
+                                     const RecordRangeFn &recordRange)
+{
+    ZoneScopedN("ParallelCommandRecorder: record");
+    if (count == 0)
+    {
+        return;
+    }
+    minRangeSize = (std::max)(minRangeSize, size_t(1));
+    const size_t numRanges = (std::min)(size_t(_numSlots), (count + minRangeSize - 1) / minRangeSize);
+
+    const VkCommandBufferInheritanceRenderingInfo renderingInfo{
+        .sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_INHERITANCE_RENDERING_INFO,
+        .colorAttachmentCount = static_cast<uint32_t>(inheritance.colorAttachmentFormats.size()),
+        .pColorAttachmentFormats = inheritance.colorAttachmentFormats.data(),
+        .depthAttachmentFormat = inheritance.depthAttachmentFormat,
+        .stencilAttachmentFormat = inheritance.stencilAttachmentFormat,
+        .rasterizationSamples = inheritance.rasterizationSamples,
+    };
+    const bool dynamicRendering = inheritance.renderPass == VK_NULL_HANDLE;
+    const VkCommandBufferInheritanceInfo inheritanceInfo{
+        .sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_INHERITANCE_INFO,
+        .pNext = dynamicRendering ? &renderingInfo : nullptr,
+        .renderPass = inheritance.renderPass,
+        .subpass = inheritance.subpass,
+        .framebuffer = inheritance.framebuffer,
+    };
+    const VkCommandBufferBeginInfo beginInfo{
+        .sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO,
+        .flags = VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT | VK_COMMAND_BUFFER_USAGE_RENDER_PASS_CONTINUE_BIT,
+        .pInheritanceInfo = &inheritanceInfo,
+    };
+
+    // range r always goes to slot r: one job per pool
+    std::vector<VkCommandBuffer> secondaries(numRanges, VK_NULL_HANDLE);
+    auto &slots = _frames[_currentFrameId];
+    _jobSystem.parallelFor("ParallelCommandRecorder: range", 0, numRanges, 1, [&](size_t r)
+                           {
+        const size_t begin = count * r / numRanges;
+        const size_t end = count * (r + 1) / numRanges;
+        const auto cmdBuffer = acquire(slots[r]);
+        VK_CHECK(vkBeginCommandBuffer(cmdBuffer, &beginInfo));
+        recordRange(cmdBuffer, begin, end);
+        VK_CHECK(vkEndCommandBuffer(cmdBuffer));
+        secondaries[r] = cmdBuffer; });
+
+    // submission order = range order
+    vkCmdExecuteCommands(primary, static_cast<uint32_t>(secondaries.size()), secondaries.data());
+}
+
+size_t ParallelCommandRecorder::numRecorded() const
+{
+    size_t res = 0;
+    for (const auto &slot : _frames[_currentFrameId])
+    {
+        res += slot.used;
+    }
+    return res;
+}
@@ -0,0 +1,81 @@
+#pragma once
+
+#include <functional>
+#include <vector>
+#include <cstdint>
+
+#include <context.h>
+#include <jobSystem.h>
+
+// what the secondary command buffers continue, see VkCommandBufferInheritanceInfo
+// renderPass set: inside vkCmdBeginRenderPass(..., VK_SUBPASS_CONTENTS_SECONDARY_COMMAND_BUFFERS)
+// otherwise: inside vkCmdBeginRendering with VK_RENDERING_CONTENTS_SECONDARY_COMMAND_BUFFERS_BIT
+struct SecondaryCommandBufferInheritance
+{
+    // render pass
+    VkRenderPass renderPass{VK_NULL_HANDLE};
+    uint32_t subpass{0};
+    // optional, may help the driver
+    VkFramebuffer framebuffer{VK_NULL_HANDLE};
+    // dynamic rendering
+    std::vector<VkFormat> colorAttachmentFormats;
+    VkFormat depthAttachmentFormat{VK_FORMAT_UNDEFINED};
+    VkFormat stencilAttachmentFormat{VK_FORMAT_UNDEFINED};
+    VkSampleCountFlagBits rasterizationSamples{VK_SAMPLE_COUNT_1_BIT};
+};
+
+// records a draw list on the job system into secondary command buffers, executed by the primary in order
+// 1. one command pool per recording slot per frame in flight, slots = job workers + the calling thread
+//    a pool is only touched by the job recording the range of its slot: no lock
+// 2. beginFrame() resets the pools of the frame at once, the secondaries are reused
+// 3. record(): [0, count) split in contiguous ranges, one secondary each, then vkCmdExecuteCommands
+//    in range order: the same commands as a serial recording
+// the secondaries inherit no state: every range binds its pipeline, descriptor sets and dynamic states
+// render thread only, the RecordRangeFn runs on the job workers
+class ParallelCommandRecorder
+{
+public:
+    using RecordRangeFn = std::function<void(VkCommandBuffer cmd, size_t begin, size_t end)>;
+
+    ParallelCommandRecorder() = delete;
+    ParallelCommandRecorder(VkContext &ctx, JobSystem &jobSystem, uint32_t numFramesInFlight);
+    ~ParallelCommandRecorder();
+
+    ParallelCommandRecorder(const ParallelCommandRecorder &other) = delete;
+    ParallelCommandRecorder &operator=(const ParallelCommandRecorder &other) = delete;
+
+    // the previous submit of the frame is done (after BeginRecordCommandBuffer)
+    void beginFrame(uint32_t frameId);
+    // inside the render pass/rendering begun on primary
+    // minRangeSize: fewer items are not worth a job of their own
+    void record(VkCommandBuffer primary,
+                const SecondaryCommandBufferInheritance &inheritance,
+                size_t count,
+                size_t minRangeSize,
+                const RecordRangeFn &recordRange);
+
+    uint32_t numSlots() const
+    {
+        return _numSlots;
+    }
+    // secondaries recorded in the current frame
+    size_t numRecorded() const;
+
+private:
+    struct Slot
+    {
+        VkCommandPool pool{VK_NULL_HANDLE};
+        // allocated on demand, reused once the pool is reset
+        std::vector<VkCommandBuffer> cmdBuffers;
+        size_t used{0};
+    };
+
+    VkCommandBuffer acquire(Slot &slot);
+
+    VkContext &_ctx;
+    JobSystem &_jobSystem;
+    const uint32_t _numSlots;
+    // [frame][slot]
+    std::vector<std::vector<Slot>> _frames;
+    uint32_t _currentFrameId{0};
+};
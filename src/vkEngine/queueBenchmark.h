@@ -0,0 +1,96 @@
+#pragma once
+
+#include <vector>
+#include <thread>
+#include <chrono>
+#include <atomic>
+#include <cstdint>
+
+#include <queuelockfree.h>
+#include <queuethreadsafe.h>
+#include <misc.h>
+
+// contention of the async task queues: n producers push, n consumers bpop, every item is counted once
+// QueueLockFree (one CAS per side, futex wake) vs QueueThreadSafe (one mutex, condition_variable)
+struct QueueBenchmarkResult
+{
+    uint32_t numThreads{0};
+    uint64_t numItems{0};
+    double lockFreeMs{0.0};
+    double threadSafeMs{0.0};
+    // sum of the popped items == sum of the pushed items, both queues
+    bool valid{false};
+};
+
+namespace detail
+{
+    // ms from the start of the producers to the last pop, false: an item was lost or duplicated
+    template <typename Queue>
+    bool runQueueContention(Queue &queue, uint32_t numThreads, uint64_t itemsPerThread, double &elapsedMs)
+    {
+        using Clock = std::chrono::steady_clock;
+        std::atomic<uint64_t> poppedSum{0};
+        std::vector<std::thread> threads;
+        threads.reserve(2 * numThreads);
+
+        const auto start = Clock::now();
+        for (uint32_t t = 0; t < numThreads; ++t)
+        {
+            threads.emplace_back([&queue, t, itemsPerThread]()
+                                 {
+                // item values 1..numThreads * itemsPerThread, disjoint per producer
+                const uint64_t first = t * itemsPerThread + 1;
+                for (uint64_t i = 0; i < itemsPerThread; ++i)
+                {
+                    queue.push(first + i);
+                } });
+            // as many pops as pushes per pair: every consumer terminates
+            threads.emplace_back([&queue, &poppedSum, itemsPerThread]()
+                                 {
+                uint64_t sum = 0;
+                for (uint64_t i = 0; i < itemsPerThread; ++i)
+                {
+                    uint64_t v = 0;
+                    queue.bpop(v);
+                    sum += v;
+                }
+                poppedSum.fetch_add(sum, std::memory_order_relaxed); });
+        }
+        for (auto &thread : threads)
+        {
+            thread.join();
+        }
+        elapsedMs = std::chrono::duration<double, std::milli>(Clock::now() - start).count();
+
+        const uint64_t numItems = numThreads * itemsPerThread;
+        return poppedSum.load() == numItems * (numItems + 1) / 2 && queue.empty();
+    }
+}
+
+// one result per thread count, numThreads producers + numThreads consumers
+inline std::vector<QueueBenchmarkResult> benchmarkQueues(
+    const std::vector<uint32_t> &threadCounts,
+    uint64_t itemsPerThread)
+{
+    std::vector<QueueBenchmarkResult> results;
+    for (auto numThreads : threadCounts)
+    {
+        QueueBenchmarkResult result{numThreads, numThreads * itemsPerThread};
+        // same capacity as AsyncTaskQueue: producers hit the backpressure path as well
+        QueueLockFree<uint64_t, 256> lockFree;
+        QueueThreadSafe<uint64_t> threadSafe;
+        const bool lockFreeValid = detail::runQueueContention(lockFree, numThreads, itemsPerThread, result.lockFreeMs);
+        const bool threadSafeValid = detail::runQueueContention(threadSafe, numThreads, itemsPerThread, result.threadSafeMs);
+        result.valid = lockFreeValid && threadSafeValid;
+
+        log(Level::Info, "queue benchmark: ", numThreads, " producers x ", numThreads, " consumers, ",
+            result.numItems, " items: lock-free ", result.lockFreeMs, " ms, thread-safe ", result.threadSafeMs,
+            " ms, ", result.lockFreeMs > 0.0 ? result.threadSafeMs / result.lockFreeMs : 0.0, "x");
+        if (!result.valid)
+        {
+            log(Level::Error, "queue benchmark: an item was lost or duplicated");
+        }
+        results.push_back(result);
+    }
+    return results;
+}
@@ -0,0 +1,120 @@
+#include <tracy/Tracy.hpp>
+
+#include <queueTimeline.h>
+
+QueueTimeline::QueueTimeline(VkDevice logicalDevice, VkQueue queue)
+    : _logicalDevice(logicalDevice), _queue(queue)
+{
+    const VkSemaphoreTypeCreateInfo semaphoreTypeInfo{
+        .sType = VK_STRUCTURE_TYPE_SEMAPHORE_TYPE_CREATE_INFO,
+        .semaphoreType = VK_SEMAPHORE_TYPE_TIMELINE,
+        .initialValue = 0,
+    };
+    const VkSemaphoreCreateInfo semaphoreInfo{
+        .sType = VK_STRUCTURE_TYPE_SEMAPHORE_CREATE_INFO,
+        .pNext = &semaphoreTypeInfo,
+    };
+    VK_CHECK(vkCreateSemaphore(_logicalDevice, &semaphoreInfo, nullptr, &_semaphore));
+}
+
+QueueTimeline::~QueueTimeline()
+{
+    vkDestroySemaphore(_logicalDevice, _semaphore, nullptr);
+}
+
+TimelinePoint QueueTimeline::submit(VkCommandBuffer commandBuffer,
+                                    const std::vector<VkSemaphoreSubmitInfo> &waits,
+                                    const std::vector<VkSemaphoreSubmitInfo> &extraSignals,
+                                    VkFence fence)
+{
+    ZoneScopedN("QueueTimeline: submit");
+    const VkCommandBufferSubmitInfo commandBufferInfo{
+        .sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_SUBMIT_INFO,
+        .commandBuffer = commandBuffer,
+    };
+
+    std::scoped_lock lock{_submitMux};
+    const uint64_t value = _lastSubmittedValue.load(std::memory_order_relaxed) + 1;
+    std::vector<VkSemaphoreSubmitInfo> signals = extraSignals;
+    signals.emplace_back(VkSemaphoreSubmitInfo{
+        .sType = VK_STRUCTURE_TYPE_SEMAPHORE_SUBMIT_INFO,
+        .semaphore = _semaphore,
+        .value = value,
+        .stageMask = VK_PIPELINE_STAGE_2_ALL_COMMANDS_BIT,
+    });
+    const VkSubmitInfo2 submitInfo{
+        .sType = VK_STRUCTURE_TYPE_SUBMIT_INFO_2,
+        .waitSemaphoreInfoCount = static_cast<uint32_t>(waits.size()),
+        .pWaitSemaphoreInfos = waits.data(),
+        .commandBufferInfoCount = 1,
+        .pCommandBufferInfos = &commandBufferInfo,
+        .signalSemaphoreInfoCount = static_cast<uint32_t>(signals.size()),
+        .pSignalSemaphoreInfos = signals.data(),
+    };
+    VK_CHECK(vkQueueSubmit2(_queue, 1, &submitInfo, fence));
+    _lastSubmittedValue.store(value, std::memory_order_release);
+    return TimelinePoint{_semaphore, value};
+}
+
+VkResult QueueTimeline::present(const VkPresentInfoKHR &presentInfo)
+{
+    std::scoped_lock lock{_submitMux};
+    return vkQueuePresentKHR(_queue, &presentInfo);
+}
+
+TimelinePoint QueueTimeline::lastSubmitted() const
+{
+    return TimelinePoint{_semaphore, _lastSubmittedValue.load(std::memory_order_acquire)};
+}
+
+uint64_t QueueTimeline::completedValue() const
+{
+    uint64_t value = 0;
+    VK_CHECK(vkGetSemaphoreCounterValue(_logicalDevice, _semaphore, &value));
+    return value;
+}
+
+bool QueueTimeline::isCompleted(uint64_t value) const
+{
+    return completedValue() >= value;
+}
+
+bool QueueTimeline::wait(uint64_t value, uint64_t timeoutInNs) const
+{
+    return waitTimelinePoints(_logicalDevice, {TimelinePoint{_semaphore, value}}, timeoutInNs);
+}
+
+bool waitTimelinePoints(VkDevice logicalDevice, const std::vector<TimelinePoint> &points, uint64_t timeoutInNs)
+{
+    ZoneScopedN("waitTimelinePoints");
+    std::vector<VkSemaphore> semaphores;
+    std::vector<uint64_t> values;
+    semaphores.reserve(points.size());
+    values.reserve(points.size());
+    for (const auto &point : points)
+    {
+        // value 0: nothing was submitted
+        if (point.semaphore != VK_NULL_HANDLE && point.value > 0)
+        {
+            semaphores.push_back(point.semaphore);
+            values.push_back(point.value);
+        }
+    }
+    if (semaphores.empty())
+    {
+        return true;
+    }
+    const VkSemaphoreWaitInfo waitInfo{
+        .sType = VK_STRUCTURE_TYPE_SEMAPHORE_WAIT_INFO,
+        .semaphoreCount = static_cast<uint32_t>(semaphores.size()),
+        .pSemaphores = semaphores.data(),
+        .pValues = values.data(),
+    };
+    const auto result = vkWaitSemaphores(logicalDevice, &waitInfo, timeoutInNs);
+    if (result == VK_TIMEOUT)
+    {
+        return false;
+    }
+    VK_CHECK(result);
+    return true;
+}
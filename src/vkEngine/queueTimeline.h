@@ -0,0 +1,95 @@
+#pragma once
+
+#include <atomic>
+#include <mutex>
+#include <vector>
+#include <cstdint>
+
+#include <misc.h>
+
+// a point on a timeline: done once semaphore >= value
+struct TimelinePoint
+{
+    VkSemaphore semaphore{VK_NULL_HANDLE};
+    uint64_t value{0};
+};
+
+// wait on a timeline point from a submission
+inline VkSemaphoreSubmitInfo timelineWait(const TimelinePoint &point, VkPipelineStageFlags2 stageMask)
+{
+    return VkSemaphoreSubmitInfo{
+        .sType = VK_STRUCTURE_TYPE_SEMAPHORE_SUBMIT_INFO,
+        .semaphore = point.semaphore,
+        .value = point.value,
+        .stageMask = stageMask,
+    };
+}
+
+// signal a timeline point from a submission: timelines shared with another api (cuda), the queue timelines
+// are signaled by QueueTimeline::submit
+inline VkSemaphoreSubmitInfo timelineSignal(const TimelinePoint &point, VkPipelineStageFlags2 stageMask)
+{
+    return timelineWait(point, stageMask);
+}
+
+// binary semaphores are still needed by the swapchain (acquire/present)
+inline VkSemaphoreSubmitInfo binarySemaphore(VkSemaphore semaphore, VkPipelineStageFlags2 stageMask)
+{
+    return VkSemaphoreSubmitInfo{
+        .sType = VK_STRUCTURE_TYPE_SEMAPHORE_SUBMIT_INFO,
+        .semaphore = semaphore,
+        .stageMask = stageMask,
+    };
+}
+
+// one monotonic timeline semaphore per VkQueue
+// every submission through it signals the next value: uploads, mip generation and frames are ordered
+// by plain integers, and the host polls/waits on them (vkGetSemaphoreCounterValue/vkWaitSemaphores)
+// instead of one fence + one binary semaphore per operation.
+// submissions (and presentation) are serialized by a lock: the queue needs external synchronization
+// and the signaled values must increase in submission order
+class QueueTimeline
+{
+public:
+    QueueTimeline() = delete;
+    QueueTimeline(VkDevice logicalDevice, VkQueue queue);
+    ~QueueTimeline();
+
+    QueueTimeline(const QueueTimeline &other) = delete;
+    QueueTimeline &operator=(const QueueTimeline &other) = delete;
+
+    VkSemaphore semaphore() const
+    {
+        return _semaphore;
+    }
+
+    VkQueue queue() const
+    {
+        return _queue;
+    }
+
+    // submits commandBuffer, signals the next value of the timeline (plus extraSignals, e.g. binary for present)
+    TimelinePoint submit(VkCommandBuffer commandBuffer,
+                         const std::vector<VkSemaphoreSubmitInfo> &waits = {},
+                         const std::vector<VkSemaphoreSubmitInfo> &extraSignals = {},
+                         VkFence fence = VK_NULL_HANDLE);
+
+    VkResult present(const VkPresentInfoKHR &presentInfo);
+
+    // highest value handed out so far
+    TimelinePoint lastSubmitted() const;
+    uint64_t completedValue() const;
+    bool isCompleted(uint64_t value) const;
+    // false on timeout
+    bool wait(uint64_t value, uint64_t timeoutInNs = UINT64_MAX) const;
+
+private:
+    VkDevice _logicalDevice{VK_NULL_HANDLE};
+    VkQueue _queue{VK_NULL_HANDLE};
+    VkSemaphore _semaphore{VK_NULL_HANDLE};
+    std::mutex _submitMux;
+    std::atomic<uint64_t> _lastSubmittedValue{0};
+};
+
+// host wait on several timelines at once (e.g. every queue before releasing a resource)
+bool waitTimelinePoints(VkDevice logicalDevice, const std::vector<TimelinePoint> &points, uint64_t timeoutInNs = UINT64_MAX);
@@ -0,0 +1,230 @@
+#pragma once
+
+#include <optional>
+#include <memory>
+#include <atomic>
+#include <new>
+#include <cstddef>
+#include <cstdint>
+#include <utility>
+#include <stop_token>
+
+// bounded multi-producer multi-consumer ring, Dmitry Vyukov's design
+// https://www.1024cores.net/home/lock-free-algorithms/queues/bounded-mpmc-queue
+// every cell carries a sequence number:
+//   sequence == pos      : cell is free for the producer claiming pos
+//   sequence == pos + 1  : cell holds data for the consumer claiming pos
+// producers and consumers only contend on their own cursor (one CAS each),
+// never on a shared lock.
+//
+// same interface as QueueThreadSafe: push/pop/bpop/empty
+// push blocks when the ring is full (backpressure), bpop blocks when empty.
+// blocking uses std::atomic::wait (futex on linux), no mutex/condition_variable.
+template <typename T, size_t Capacity = 1024>
+class QueueLockFree
+{
+    static_assert(Capacity >= 2 && (Capacity & (Capacity - 1)) == 0, "Capacity must be a power of 2");
+
+public:
+    QueueLockFree()
+    {
+        for (size_t i = 0; i < Capacity; ++i)
+        {
+            _cells[i].sequence.store(i, std::memory_order_relaxed);
+        }
+    }
+
+    ~QueueLockFree()
+    {
+        // drain whatever is left so T's destructor runs
+        std::optional<T> v;
+        do
+        {
+            v.reset();
+            pop(v);
+        } while (v.has_value());
+    }
+
+    QueueLockFree(const QueueLockFree &other) = delete;
+    QueueLockFree &operator=(const QueueLockFree &other) = delete;
+
+    void push(const T &v)
+    {
+        T copy(v);
+        push(std::move(copy));
+    }
+
+    // for only-movable object
+    void push(T &&v)
+    {
+        if (tryPush(std::move(v)))
+        {
+            return;
+        }
+        // full: wait until a consumer frees a cell
+        waitFor(_popCount, [this, &v]()
+                { return tryPush(std::move(v)); });
+    }
+
+    // non-blocking, false when the ring is full; v is untouched in that case
+    bool tryPush(T &&v)
+    {
+        Cell *cell = nullptr;
+        size_t pos = _enqueuePos.load(std::memory_order_relaxed);
+        while (true)
+        {
+            cell = &_cells[pos & MASK];
+            const size_t seq = cell->sequence.load(std::memory_order_acquire);
+            const intptr_t diff = static_cast<intptr_t>(seq) - static_cast<intptr_t>(pos);
+            if (diff == 0)
+            {
+                if (_enqueuePos.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed))
+                {
+                    break;
+                }
+            }
+            else if (diff < 0)
+            {
+                return false;
+            }
+            else
+            {
+                pos = _enqueuePos.load(std::memory_order_relaxed);
+            }
+        }
+        new (cell->storage) T(std::move(v));
+        cell->sequence.store(pos + 1, std::memory_order_release);
+        signal(_pushCount);
+        return true;
+    }
+
+    bool empty() const
+    {
+        // snapshot, may be stale by the time the caller looks at it
+        return _dequeuePos.load(std::memory_order_acquire) >= _enqueuePos.load(std::memory_order_acquire);
+    }
+
+    // caller pass in
+    void pop(std::optional<T> &v)
+    {
+        Cell *cell = nullptr;
+        size_t pos = _dequeuePos.load(std::memory_order_relaxed);
+        while (true)
+        {
+            cell = &_cells[pos & MASK];
+            const size_t seq = cell->sequence.load(std::memory_order_acquire);
+            const intptr_t diff = static_cast<intptr_t>(seq) - static_cast<intptr_t>(pos + 1);
+            if (diff == 0)
+            {
+                if (_dequeuePos.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed))
+                {
+                    break;
+                }
+            }
+            else if (diff < 0)
+            {
+                // empty
+                return;
+            }
+            else
+            {
+                pos = _dequeuePos.load(std::memory_order_relaxed);
+            }
+        }
+        T *data = std::launder(reinterpret_cast<T *>(cell->storage));
+        v.emplace(std::move(*data));
+        data->~T();
+        cell->sequence.store(pos + MASK + 1, std::memory_order_release);
+        signal(_popCount);
+    }
+
+    // blocking pop, no need optional
+    // one off. caller needs to do while(true)
+    void bpop(T &v)
+    {
+        std::optional<T> res;
+        pop(res);
+        if (!res.has_value())
+        {
+            waitFor(_pushCount, [this, &res]()
+                    { pop(res); return res.has_value(); });
+        }
+        v = std::move(*res);
+    }
+
+    // blocking pop which gives up once stop is requested
+    // returns false when woken by the stop token without an item
+    bool bpop(T &v, std::stop_token stopToken)
+    {
+        std::optional<T> res;
+        pop(res);
+        if (!res.has_value())
+        {
+            // bump the counter so a sleeping waitFor re-evaluates
+            std::stop_callback wakeUp(stopToken, [this]()
+                                      {
+                _pushCount.counter.fetch_add(1, std::memory_order_seq_cst);
+                _pushCount.counter.notify_all(); });
+            waitFor(_pushCount, [this, &res, &stopToken]()
+                    { pop(res); return res.has_value() || stopToken.stop_requested(); });
+        }
+        if (!res.has_value())
+        {
+            return false;
+        }
+        v = std::move(*res);
+        return true;
+    }
+
+private:
+    static constexpr size_t MASK = Capacity - 1;
+    // avoid false sharing between the producer and consumer cursors
+    static constexpr size_t CACHE_LINE_SIZE = 64;
+
+    struct Cell
+    {
+        std::atomic<size_t> sequence;
+        alignas(T) std::byte storage[sizeof(T)];
+    };
+
+    // wake-up channel: counter bumped after every commit
+    struct Signal
+    {
+        std::atomic<uint32_t> counter{0};
+        std::atomic<uint32_t> waiters{0};
+    };
+
+    // only pay for the futex wake when someone sleeps
+    static void signal(Signal &s)
+    {
+        s.counter.fetch_add(1, std::memory_order_seq_cst);
+        if (s.waiters.load(std::memory_order_seq_cst) > 0)
+        {
+            s.counter.notify_one();
+        }
+    }
+
+    // register as waiter, snapshot the counter, retry, sleep until the counter moves
+    // the counter is bumped after the cell is committed, so a retry after wake-up cannot miss it
+    template <typename Fn>
+    static void waitFor(Signal &s, Fn &&attempt)
+    {
+        s.waiters.fetch_add(1, std::memory_order_seq_cst);
+        while (true)
+        {
+            const uint32_t observed = s.counter.load(std::memory_order_seq_cst);
+            if (attempt())
+            {
+                break;
+            }
+            s.counter.wait(observed, std::memory_order_seq_cst);
+        }
+        s.waiters.fetch_sub(1, std::memory_order_seq_cst);
+    }
+
+    alignas(CACHE_LINE_SIZE) Cell _cells[Capacity];
+    alignas(CACHE_LINE_SIZE) std::atomic<size_t> _enqueuePos{0};
+    alignas(CACHE_LINE_SIZE) std::atomic<size_t> _dequeuePos{0};
+    alignas(CACHE_LINE_SIZE) Signal _pushCount;
+    alignas(CACHE_LINE_SIZE) Signal _popCount;
+};
@@ -32,18 +32,24 @@ public:
 
     void push(const T &v)
     {
-        std::scoped_lock lock{_mux};
-        _container.push(v);
+        {
+            std::scoped_lock lock{_mux};
+            _container.push(v);
+        }
         // any waiting thread of multiple threads
+        // notify after unlock, the woken thread does not block on _mux right away
         _cv.notify_one();
     }
 
     // for only-movable object
     void push(T &&v)
     {
-        std::scoped_lock lock{_mux};
-        _container.push(std::move(v));
+        {
+            std::scoped_lock lock{_mux};
+            _container.push(std::move(v));
+        }
         // any waiting thread of multiple threads
+        // notify after unlock, the woken thread does not block on _mux right away
         _cv.notify_one();
     }
 
@@ -4,22 +4,65 @@
 #include <glm/glm.hpp>
 #include <glm/gtx/transform.hpp>
 
+#include <cstring>
+
 #include <misc.h>
 #include <renderPassBase.h>
-
+#include <asCache.h>
+#include <blasBuilder.h>
+#include <sbtBuilder.h>
+#include <topLevelAS.h>
+
+// progressive path: every frame traces as many tiles of the image as fit Config::frameBudgetMs (measured with
+// gpu timestamps), one vkCmdTraceRaysKHR per tile. a full pass over the tiles adds one sample per pixel to
+// the rgba32f accumulation image, the output image holds the average. the accumulation restarts when the
+// UniformCameraProp or an instance changes and stops at Config::maxSamplesPerPixel
 class RayTracing : public RenderPassBase,
                    public VkContextAccessor,
                    public SceneAccessor,
                    public DescriptorPoolAccessor,
-                   public CameraAccessor
+                   public CameraAccessor,
+                   public FrameAllocatorAccessor
 {
 public:
+    struct Config
+    {
+        // gpu time of the tiles of one frame, the ui stays interactive
+        float frameBudgetMs{4.0f};
+        uint32_t tileSize{256};
+        uint32_t maxSamplesPerPixel{1024};
+    };
+
     RayTracing()
     {
     }
 
     ~RayTracing()
     {
+        _tlas.reset();
+        _sbt.reset();
+        if (_ctx)
+        {
+            const auto logicalDevice = _ctx->getLogicDevice();
+            if (_timestampQueryPool != VK_NULL_HANDLE)
+            {
+                vkDestroyQueryPool(logicalDevice, _timestampQueryPool, nullptr);
+            }
+            for (const auto *image : {&_rtOutputImage, &_accumulationImage})
+            {
+                if (std::get<IMAGE_ENTITY_OFFSET::IMAGE>(*image) != VK_NULL_HANDLE)
+                {
+                    vkDestroyImageView(logicalDevice, std::get<IMAGE_ENTITY_OFFSET::IMAGE_VIEW>(*image), nullptr);
+                    vmaDestroyImage(_ctx->getVmaAllocator(),
+                                    std::get<IMAGE_ENTITY_OFFSET::IMAGE>(*image),
+                                    std::get<IMAGE_ENTITY_OFFSET::IMAGE_VMA_ALLOCATION>(*image));
+                }
+            }
+            for (const auto &blas : _blasTable)
+            {
+                BlasBuilder::destroy(*_ctx, blas);
+            }
+        }
     }
 
     virtual void setContext(VkContext *ctx) override
@@ -62,6 +105,45 @@ public:
         return _dsPool;
     }
 
+    virtual void setFrameAllocator(FrameAllocator *frameAllocator) override
+    {
+        _frameAllocator = frameAllocator;
+    }
+
+    virtual const FrameAllocator &frameAllocator() const override
+    {
+        return *_frameAllocator;
+    }
+
+    // before finalizeInit()
+    inline void setConfig(const Config &config)
+    {
+        _config = config;
+    }
+
+    // the next frame starts over from sample 0
+    inline void resetAccumulation()
+    {
+        _resetAccumulation = true;
+    }
+
+    // complete passes over the image
+    inline uint32_t samplesPerPixel() const
+    {
+        return _samplesPerPixel;
+    }
+
+    // the average of the samples, VK_IMAGE_LAYOUT_GENERAL after finalizeInit()
+    inline const ImageEntity &outputImage() const
+    {
+        return _rtOutputImage;
+    }
+
+    inline VkExtent2D outputExtent() const
+    {
+        return _imageExtent;
+    }
+
     // algorithm specific
     inline void setCompositeVerticeBuffer(BufferEntity *vb)
     {
@@ -91,7 +173,7 @@ public:
         allocateDescriptorSets();
         createSBT();
         initRTOutputImage();
-        initUniformCameraPropBuffer();
+        initTimestampQueries();
         initBLAS();
         initTLAS();
 
@@ -125,6 +207,13 @@ public:
             rayClosestHitShaderPath,
             "main",
             "rayClosestHit.rchit");
+        // alpha test of the MASK materials
+        const auto rayAnyHitShaderPath = shadersPath + "/rayAnyHit.rahit";
+        _rtRayAnyHitShaderModule = createShaderModule(
+            logicalDevice,
+            rayAnyHitShaderPath,
+            "main",
+            "rayAnyHit.rahit");
     }
 
     enum DESC_LAYOUT_SEMANTIC : int
@@ -138,7 +227,8 @@ public:
     // layout(set = 0, binding = 0) uniform accelerationStructureEXT as;
     // // write to
     // layout(set = 1, binding = 0, rgba8) uniform image2D image;
-    // // input
+    // layout(set = 1, binding = 1, rgba32f) uniform image2D accumulationImage;
+    // // input, one dynamic offset per frame
     // layout(set = 2, binding = 0) uniform CameraProperties
     void createDescriptorSetLayout()
     {
@@ -152,15 +242,19 @@ public:
         setBindings[DESC_LAYOUT_SEMANTIC::AS][0].descriptorCount = 1;
         setBindings[DESC_LAYOUT_SEMANTIC::AS][0].stageFlags = VK_SHADER_STAGE_RAYGEN_BIT_KHR;
 
-        setBindings[DESC_LAYOUT_SEMANTIC::OUTPUT_IMAGE].resize(1);
+        setBindings[DESC_LAYOUT_SEMANTIC::OUTPUT_IMAGE].resize(2);
         setBindings[DESC_LAYOUT_SEMANTIC::OUTPUT_IMAGE][0].binding = 0; // depends on the shader: set 0, binding = 0
         setBindings[DESC_LAYOUT_SEMANTIC::OUTPUT_IMAGE][0].descriptorType = VK_DESCRIPTOR_TYPE_STORAGE_IMAGE;
         setBindings[DESC_LAYOUT_SEMANTIC::OUTPUT_IMAGE][0].descriptorCount = 1;
         setBindings[DESC_LAYOUT_SEMANTIC::OUTPUT_IMAGE][0].stageFlags = VK_SHADER_STAGE_RAYGEN_BIT_KHR;
+        setBindings[DESC_LAYOUT_SEMANTIC::OUTPUT_IMAGE][1].binding = 1;
+        setBindings[DESC_LAYOUT_SEMANTIC::OUTPUT_IMAGE][1].descriptorType = VK_DESCRIPTOR_TYPE_STORAGE_IMAGE;
+        setBindings[DESC_LAYOUT_SEMANTIC::OUTPUT_IMAGE][1].descriptorCount = 1;
+        setBindings[DESC_LAYOUT_SEMANTIC::OUTPUT_IMAGE][1].stageFlags = VK_SHADER_STAGE_RAYGEN_BIT_KHR;
 
         setBindings[DESC_LAYOUT_SEMANTIC::CAMERA_PROP].resize(1);
         setBindings[DESC_LAYOUT_SEMANTIC::CAMERA_PROP][0].binding = 0; // depends on the shader: set 0, binding = 0
-        setBindings[DESC_LAYOUT_SEMANTIC::CAMERA_PROP][0].descriptorType = VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER;
+        setBindings[DESC_LAYOUT_SEMANTIC::CAMERA_PROP][0].descriptorType = VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER_DYNAMIC;
         setBindings[DESC_LAYOUT_SEMANTIC::CAMERA_PROP][0].descriptorCount = 1;
         setBindings[DESC_LAYOUT_SEMANTIC::CAMERA_PROP][0].stageFlags = VK_SHADER_STAGE_RAYGEN_BIT_KHR;
 
@@ -173,29 +267,36 @@ public:
         ASSERT(_rtRayGenShaderModule, "ray gen shader module should be defined");
         ASSERT(_rtRayMissShaderModule, "ray miss shader module should be defined");
         ASSERT(_rtRayClosestHitShaderModule, "ray closest hit shader module should be defined");
-
-        const std::string entryPoint{"main"};
-        _rtPipelineEntity = _ctx->createRayTracingPipeline(
-            {
-                {VK_SHADER_STAGE_RAYGEN_BIT_KHR, std::make_tuple(_rtRayGenShaderModule, entryPoint.c_str(), nullptr)},
-                {VK_SHADER_STAGE_MISS_BIT_KHR, std::make_tuple(_rtRayMissShaderModule, entryPoint.c_str(), nullptr)},
-                {VK_SHADER_STAGE_CLOSEST_HIT_BIT_KHR, std::make_tuple(_rtRayClosestHitShaderModule, entryPoint.c_str(), nullptr)},
-            },
-            _descriptorSetLayouts,
-            {});
+        ASSERT(_rtRayAnyHitShaderModule, "ray any hit shader module should be defined");
+
+        // one hit group per material class
+        _sbt = std::make_unique<SbtBuilder>(*_ctx);
+        _rayGenGroupId = _sbt->addRayGenGroup(_rtRayGenShaderModule);
+        _rayMissGroupId = _sbt->addMissGroup(_rtRayMissShaderModule);
+        _hitGroupIds[OPAQUE_MATERIAL] = _sbt->addHitGroup(_rtRayClosestHitShaderModule, VK_NULL_HANDLE);
+        _hitGroupIds[ALPHA_TESTED_MATERIAL] = _sbt->addHitGroup(_rtRayClosestHitShaderModule, _rtRayAnyHitShaderModule);
+        // layout(push_constant) uniform ProgressiveProperties
+        _rtPipelineEntity = _sbt->createPipeline(_descriptorSetLayouts,
+                                                 {VkPushConstantRange{
+                                                     .stageFlags = VK_SHADER_STAGE_RAYGEN_BIT_KHR,
+                                                     .offset = 0,
+                                                     .size = sizeof(ProgressivePushConstants),
+                                                 }});
     }
 
     void allocateDescriptorSets()
     {
         ASSERT(_ctx, "vk context should be defined");
         ASSERT(_dsPool, "descriptorset pool should be defined");
+        ASSERT(_frameAllocator, "frame allocator should be defined");
+        const auto numFramesInFlight = _frameAllocator->numFramesInFlight();
         _descriptorSets = _ctx->allocateDescriptorSet(_dsPool,
                                                       {{&_descriptorSetLayouts[DESC_LAYOUT_SEMANTIC::AS],
                                                         1},
                                                        {&_descriptorSetLayouts[DESC_LAYOUT_SEMANTIC::OUTPUT_IMAGE],
                                                         1},
                                                        {&_descriptorSetLayouts[DESC_LAYOUT_SEMANTIC::CAMERA_PROP],
-                                                        1}});
+                                                        numFramesInFlight}});
     }
 
     // Shader Binding Table:
@@ -205,59 +306,28 @@ public:
     void createSBT()
     {
         ASSERT(_ctx, "vk context should be defined");
-        auto logicalDevice = _ctx->getLogicDevice();
-
-        const auto &rtProperties = _ctx->getSelectedPhysicalDeviceRayTracingProperties();
-        const uint32_t handleSizeInBytes = rtProperties.shaderGroupHandleSize;
-        const uint32_t handleSizeAligned = alignedSize(handleSizeInBytes, rtProperties.shaderGroupHandleAlignment);
-
-        const auto rtPipeline = std::get<0>(_rtPipelineEntity);
-        const auto shaderGroupCount = std::get<2>(_rtPipelineEntity).size();
-        const uint32_t sbtSizeInBytes = shaderGroupCount * handleSizeAligned;
-        std::vector<uint8_t> shaderGroupHandles(sbtSizeInBytes);
-        // filling the shaderGroupHandles buffer
-        VK_CHECK(vkGetRayTracingShaderGroupHandlesKHR(
-            logicalDevice,
-            rtPipeline,
-            0, // first Shader Group
-            shaderGroupCount,
-            sbtSizeInBytes,
-            shaderGroupHandles.data()));
-        {
-            //  buffer is suitable for use as a Shader Binding Table.
-            _rayGenSTBBuffer = _ctx->createShaderBindTableBuffer(
-                "Ray Gen STB Buffer",
-                handleSizeInBytes * 1, // 1 ray gen shader stage,
-                handleSizeAligned * 1, // buffer size considering alignment
-                handleSizeAligned,
-                true // mapping
-            );
-            // copy into _rayGenSTBBuffer
-            auto &dst = std::get<BUFFER_ENTITY_UID::MAPPING_ADDRESS>(std::get<0>(_rayGenSTBBuffer));
-            memcpy(dst, shaderGroupHandles.data(), handleSizeInBytes);
-        }
-
-        {
-            _rayMissSTBBuffer = _ctx->createShaderBindTableBuffer(
-                "Ray Miss STB Buffer",
-                handleSizeInBytes * 1,
-                handleSizeAligned * 1, // buffer size considering alignment
-                handleSizeAligned,
-                true);
-            auto &dst = std::get<BUFFER_ENTITY_UID::MAPPING_ADDRESS>(std::get<0>(_rayMissSTBBuffer));
-            memcpy(dst, shaderGroupHandles.data() + handleSizeInBytes, handleSizeInBytes);
-        }
+        ASSERT(_scene, "scene should be defined");
+        ASSERT(_sbt, "rt pipeline should be created");
 
+        _sbt->setRayGenRecord(_rayGenGroupId);
+        _sbt->addMissRecord(_rayMissGroupId);
+        // one hit record per mesh: the record index is the instanceShaderBindingTableRecordOffset of its instances
+        for (uint32_t meshId = 0; meshId < _scene->meshes.size(); ++meshId)
         {
-            _rayClosestHitSTBBuffer = _ctx->createShaderBindTableBuffer(
-                "Ray Closest Hit STB Buffer",
-                handleSizeInBytes * 1,
-                handleSizeAligned * 1, // buffer size considering alignment
-                handleSizeAligned,
-                true);
-            auto &dst = std::get<BUFFER_ENTITY_UID::MAPPING_ADDRESS>(std::get<0>(_rayClosestHitSTBBuffer));
-            memcpy(dst, shaderGroupHandles.data() + handleSizeInBytes * 2, handleSizeInBytes);
+            const auto materialIdx = _scene->meshes[meshId].materialIdx;
+            const Material *material = materialIdx >= 0 && materialIdx < static_cast<int32_t>(_scene->materials.size())
+                                           ? &_scene->materials[materialIdx]
+                                           : nullptr;
+            const HitRecordData data{
+                .basecolor = material ? material->basecolor : glm::vec4(1.0f),
+                .alphaCutoff = material ? material->alphaCutoff : 0.0f,
+                .materialId = materialIdx,
+                .meshId = meshId,
+            };
+            const auto recordId = _sbt->addHitRecord(_hitGroupIds[materialClass(meshId)], &data, sizeof(data));
+            ASSERT(recordId == meshId, "hit record per mesh");
         }
+        _sbt->build();
     }
 
     void initRTOutputImage()
@@ -283,22 +353,91 @@ public:
                                            VK_IMAGE_USAGE_TRANSFER_DST_BIT | VK_IMAGE_USAGE_SAMPLED_BIT | VK_IMAGE_USAGE_TRANSFER_SRC_BIT | VK_IMAGE_USAGE_STORAGE_BIT | VK_IMAGE_USAGE_COLOR_ATTACHMENT_BIT,
                                            VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT,
                                            generateMipmaps);
+        // sum of the samples, full precision: 8 bits would band after a few samples
+        _accumulationImage = _ctx->createImage("rt accumulation image",
+                                               VK_IMAGE_TYPE_2D,
+                                               VK_FORMAT_R32G32B32A32_SFLOAT,
+                                               {
+                                                   .width = extents.width,
+                                                   .height = extents.height,
+                                                   .depth = 1,
+                                               },
+                                               textureMipLevels,
+                                               textureLayoutCount,
+                                               VK_SAMPLE_COUNT_1_BIT,
+                                               VK_IMAGE_USAGE_STORAGE_BIT,
+                                               VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT,
+                                               generateMipmaps);
+        _imageExtent = extents;
+
+        // storage images stay in VK_IMAGE_LAYOUT_GENERAL, the output is black until the first pass reaches a tile
+        auto cmdBuffer = _ctx->getCommandBufferForIO();
+        const auto cmd = std::get<COMMAND_BUFFER_ENTITY_OFFSET::COMMAND_BUFFER>(cmdBuffer);
+        _ctx->BeginRecordCommandBuffer(cmdBuffer);
+        std::vector<VkImageMemoryBarrier2> barriers;
+        for (const auto *image : {&_rtOutputImage, &_accumulationImage})
+        {
+            barriers.push_back(VkImageMemoryBarrier2{
+                .sType = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER_2,
+                .srcStageMask = VK_PIPELINE_STAGE_2_NONE,
+                .srcAccessMask = VK_ACCESS_2_NONE,
+                .dstStageMask = VK_PIPELINE_STAGE_2_CLEAR_BIT | VK_PIPELINE_STAGE_2_RAY_TRACING_SHADER_BIT_KHR,
+                .dstAccessMask = VK_ACCESS_2_TRANSFER_WRITE_BIT | VK_ACCESS_2_SHADER_STORAGE_READ_BIT | VK_ACCESS_2_SHADER_STORAGE_WRITE_BIT,
+                .oldLayout = VK_IMAGE_LAYOUT_UNDEFINED,
+                .newLayout = VK_IMAGE_LAYOUT_GENERAL,
+                .srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED,
+                .dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED,
+                .image = std::get<IMAGE_ENTITY_OFFSET::IMAGE>(*image),
+                .subresourceRange = {
+                    .aspectMask = VK_IMAGE_ASPECT_COLOR_BIT,
+                    .baseMipLevel = 0,
+                    .levelCount = 1,
+                    .baseArrayLayer = 0,
+                    .layerCount = 1,
+                },
+            });
+        }
+        const VkDependencyInfo dependency{
+            .sType = VK_STRUCTURE_TYPE_DEPENDENCY_INFO,
+            .imageMemoryBarrierCount = static_cast<uint32_t>(barriers.size()),
+            .pImageMemoryBarriers = barriers.data(),
+        };
+        vkCmdPipelineBarrier2(cmd, &dependency);
+        const VkClearColorValue black{};
+        const VkImageSubresourceRange range{VK_IMAGE_ASPECT_COLOR_BIT, 0, 1, 0, 1};
+        vkCmdClearColorImage(cmd, std::get<IMAGE_ENTITY_OFFSET::IMAGE>(_rtOutputImage), VK_IMAGE_LAYOUT_GENERAL, &black, 1, &range);
+        // clear -> the tiles of the first frame
+        const VkMemoryBarrier2 clearBarrier{
+            .sType = VK_STRUCTURE_TYPE_MEMORY_BARRIER_2,
+            .srcStageMask = VK_PIPELINE_STAGE_2_CLEAR_BIT,
+            .srcAccessMask = VK_ACCESS_2_TRANSFER_WRITE_BIT,
+            .dstStageMask = VK_PIPELINE_STAGE_2_RAY_TRACING_SHADER_BIT_KHR,
+            .dstAccessMask = VK_ACCESS_2_SHADER_STORAGE_READ_BIT | VK_ACCESS_2_SHADER_STORAGE_WRITE_BIT,
+        };
+        const VkDependencyInfo clearDependency{
+            .sType = VK_STRUCTURE_TYPE_DEPENDENCY_INFO,
+            .memoryBarrierCount = 1,
+            .pMemoryBarriers = &clearBarrier,
+        };
+        vkCmdPipelineBarrier2(cmd, &clearDependency);
+        _ctx->EndRecordCommandBuffer(cmdBuffer);
+        waitTimelinePoints(_ctx->getLogicDevice(), {_ctx->submitCommandBuffer(cmdBuffer)});
     }
 
-    void initUniformCameraPropBuffer()
+    // two timestamps per frame in flight around its tiles: the gpu cost of a tile for the next frames
+    void initTimestampQueries()
     {
         ASSERT(_ctx, "vk context should be defined");
-
-        _uniformCameraPropBuffer = _ctx->createPersistentBuffer(
-            "Uniform Camera Prop Buffer",
-            sizeof(UniformCameraProp),
-            VK_BUFFER_USAGE_UNIFORM_BUFFER_BIT | VK_BUFFER_USAGE_SHADER_DEVICE_ADDRESS_BIT,
-            VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT |
-                VK_MEMORY_PROPERTY_HOST_COHERENT_BIT |
-                VK_MEMORY_PROPERTY_HOST_CACHED_BIT,
-            VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT |
-                VK_MEMORY_PROPERTY_HOST_COHERENT_BIT |
-                VK_MEMORY_PROPERTY_HOST_CACHED_BIT);
+        ASSERT(_frameAllocator, "frame allocator should be defined");
+        const auto numFramesInFlight = _frameAllocator->numFramesInFlight();
+        const VkQueryPoolCreateInfo queryPoolInfo{
+            .sType = VK_STRUCTURE_TYPE_QUERY_POOL_CREATE_INFO,
+            .queryType = VK_QUERY_TYPE_TIMESTAMP,
+            .queryCount = 2 * numFramesInFlight,
+        };
+        VK_CHECK(vkCreateQueryPool(_ctx->getLogicDevice(), &queryPoolInfo, nullptr, &_timestampQueryPool));
+        _tilesInFlight.assign(numFramesInFlight, 0);
+        _timestampPeriodNs = _ctx->getSelectedPhysicalDeviceProp().limits.timestampPeriod;
     }
 
     void initBLAS()
@@ -306,160 +445,65 @@ public:
         // real geometry data
         ASSERT(_ctx, "vk context should be defined");
         ASSERT(_scene, "scene should be defined");
-        auto logicalDevice = _ctx->getLogicDevice();
-        // a graphics command buffer is needed for build AS
-        auto cmdBuffersForIO = _ctx->getCommandBufferForIO();
-        // where the command buffer submitted to.
-        auto graphicsComputeQueue = _ctx->getGraphicsComputeQueue();
 
+        // from the composite vb and composite ib, the range of vb and ib of every mesh
+        const auto vbDeviceStartingAddress = std::get<BUFFER_ENTITY_UID::DEVICE_HOST_ADDRESS>(*_compositeVB).deviceAddress;
+        const auto ibDeviceStartingAddress = std::get<BUFFER_ENTITY_UID::DEVICE_HOST_ADDRESS>(*_compositeIB).deviceAddress;
+        std::vector<BlasGeometry> geometries;
+        geometries.reserve(_scene->meshes.size());
         size_t meshId = 0;
         for (const auto &mesh : _scene->meshes)
         {
-            // from the composite vb and composite ib, I need to fetch the range of vb and ib for this mesh
-            // auto vertexByteSizeMesh = sizeof(Vertex) * mesh.vertices.size();
-            // auto vertexBufferPtr = reinterpret_cast<const void *>(mesh.vertices.data());
-            // auto indicesByteSizeMesh = sizeof(uint32_t) * mesh.indices.size();
-            // auto indicesBufferPtr = reinterpret_cast<const void *>(mesh.indices.data());
-
-            auto vbDeviceStartingAddress = std::get<BUFFER_ENTITY_UID::DEVICE_HOST_ADDRESS>(*_compositeVB).deviceAddress;
-            auto vbOffsetInByteForMesh = _scene->indirectDraw[meshId].vertexOffset * sizeof(Vertex);
-            VkDeviceOrHostAddressConstKHR vbDeviceAddressForMesh{
-                .deviceAddress = vbDeviceStartingAddress + vbOffsetInByteForMesh,
-            };
-
-            const auto numVertices = mesh.vertices.size();
+            // mesh space, shared by all the instances of the mesh: the transforms go to the tlas
+            geometries.emplace_back(BlasGeometry{
+                .vertexAddress = vbDeviceStartingAddress + _scene->indirectDraw[meshId].vertexOffset * sizeof(Vertex),
+                .vertexStride = sizeof(Vertex),
+                .maxVertex = static_cast<uint32_t>(mesh.vertices.size()),
+                .indexAddress = ibDeviceStartingAddress + _scene->indirectDraw[meshId].firstIndex * sizeof(uint32_t),
+                .numTriangles = static_cast<uint32_t>(mesh.indices.size() / 3),
+            });
+            ++meshId;
+        }
 
-            auto ibDeviceStartingAddress = std::get<BUFFER_ENTITY_UID::DEVICE_HOST_ADDRESS>(*_compositeIB).deviceAddress;
-            auto ibOffsetInByteForMesh = _scene->indirectDraw[meshId].firstIndex * sizeof(uint32_t);
-            VkDeviceOrHostAddressConstKHR ibDeviceAddressForMesh{
-                .deviceAddress = ibDeviceStartingAddress + ibOffsetInByteForMesh,
-            };
+        // the serialized BLAS of a previous run when the driver still accepts them, built otherwise
+        const BlasBuilder::Config builderConfig{};
+        AccelerationStructureCache cache(*_ctx, AccelerationStructureCache::Config{});
+        std::vector<uint64_t> keys;
+        keys.reserve(_scene->meshes.size());
+        for (const auto &mesh : _scene->meshes)
+        {
+            keys.push_back(AccelerationStructureCache::hashGeometry(mesh, builderConfig.flags));
+        }
+        const auto cached = cache.load(keys);
 
-            VkAccelerationStructureGeometryKHR accelerationStructureGeometry{};
-            accelerationStructureGeometry.sType = VK_STRUCTURE_TYPE_ACCELERATION_STRUCTURE_GEOMETRY_KHR;
-            // VK_GEOMETRY_OPAQUE_BIT_KHR indicates that this geometry does not invoke the any-hit shaders even if present in a hit group.
-            accelerationStructureGeometry.flags = VK_GEOMETRY_OPAQUE_BIT_KHR;
-            accelerationStructureGeometry.geometryType = VK_GEOMETRY_TYPE_TRIANGLES_KHR;
-            accelerationStructureGeometry.geometry.triangles.sType = VK_STRUCTURE_TYPE_ACCELERATION_STRUCTURE_GEOMETRY_TRIANGLES_DATA_KHR;
-            accelerationStructureGeometry.geometry.triangles.vertexFormat = VK_FORMAT_R32G32B32_SFLOAT;
-            accelerationStructureGeometry.geometry.triangles.vertexData = vbDeviceAddressForMesh;
-            accelerationStructureGeometry.geometry.triangles.maxVertex = numVertices;
-            accelerationStructureGeometry.geometry.triangles.vertexStride = sizeof(Vertex);
-            accelerationStructureGeometry.geometry.triangles.indexType = VK_INDEX_TYPE_UINT32;
-            accelerationStructureGeometry.geometry.triangles.indexData = ibDeviceAddressForMesh;
-            // no per-vertex transform needed here, done in the glb.cpp, see line334. vertex.transform(m);
-            accelerationStructureGeometry.geometry.triangles.transformData.hostAddress = nullptr;
-
-            // 1. geometry (mesh, triangle), step1, just to get the size
-            VkAccelerationStructureBuildGeometryInfoKHR accelerationStructureBuildGeometryInfo{};
-            accelerationStructureBuildGeometryInfo.sType = VK_STRUCTURE_TYPE_ACCELERATION_STRUCTURE_BUILD_GEOMETRY_INFO_KHR;
-            // BLAS
-            accelerationStructureBuildGeometryInfo.type = VK_ACCELERATION_STRUCTURE_TYPE_BOTTOM_LEVEL_KHR;
-            accelerationStructureBuildGeometryInfo.flags = VK_BUILD_ACCELERATION_STRUCTURE_PREFER_FAST_TRACE_BIT_KHR;
-            accelerationStructureBuildGeometryInfo.geometryCount = 1;
-            accelerationStructureBuildGeometryInfo.pGeometries = &accelerationStructureGeometry;
-
-            auto numTriangles = static_cast<uint32_t>(mesh.indices.size() / 3);
-            // fill in this structure, scratch buffer: pre-allocated memory
-            VkAccelerationStructureBuildSizesInfoKHR accelerationStructureBuildSizesInfo{};
-            accelerationStructureBuildSizesInfo.sType = VK_STRUCTURE_TYPE_ACCELERATION_STRUCTURE_BUILD_SIZES_INFO_KHR;
-            vkGetAccelerationStructureBuildSizesKHR(
-                logicalDevice,
-                VK_ACCELERATION_STRUCTURE_BUILD_TYPE_DEVICE_KHR,
-                &accelerationStructureBuildGeometryInfo,
-                &numTriangles,
-                &accelerationStructureBuildSizesInfo);
-
-            // VK_BUFFER_USAGE_ACCELERATION_STRUCTURE_STORAGE_BIT_KHR specifies that the buffer is suitable for storage space for a VkAccelerationStructureKHR.
-            // device local buffer
-            // for build operation: requires two buffers. 1. for as, 2. for build op itself
-            // for update operation:
-            const auto blasBufferSizeInBytes = accelerationStructureBuildSizesInfo.accelerationStructureSize;
-            const auto blasBuildBufferSizeInBytes = accelerationStructureBuildSizesInfo.buildScratchSize;
-            const auto blasBuffer = _ctx->createDeviceLocalBuffer(
-                "BLAS Buffer",
-                blasBufferSizeInBytes,
-                VK_BUFFER_USAGE_ACCELERATION_STRUCTURE_STORAGE_BIT_KHR | VK_BUFFER_USAGE_SHADER_DEVICE_ADDRESS_BIT);
-            const auto blasBuildBuffer = _ctx->createDeviceLocalBuffer(
-                "BLAS Buffer for build op",
-                blasBuildBufferSizeInBytes,
-                VK_BUFFER_USAGE_STORAGE_BUFFER_BIT | VK_BUFFER_USAGE_SHADER_DEVICE_ADDRESS_BIT);
-
-            // once the buffer is ready, you can create the actual AS
-            // a bottom-level acceleration structure containing a set of triangles.
-            VkAccelerationStructureKHR blasForTriangles;
-            VkAccelerationStructureCreateInfoKHR accelerationStructureCreateInfo{};
-            accelerationStructureCreateInfo.sType = VK_STRUCTURE_TYPE_ACCELERATION_STRUCTURE_CREATE_INFO_KHR;
-            accelerationStructureCreateInfo.buffer = std::get<BUFFER_ENTITY_UID::BUFFER>(blasBuffer);
-            accelerationStructureCreateInfo.size = blasBufferSizeInBytes;
-            accelerationStructureCreateInfo.type = VK_ACCELERATION_STRUCTURE_TYPE_BOTTOM_LEVEL_KHR;
-            vkCreateAccelerationStructureKHR(logicalDevice, &accelerationStructureCreateInfo, nullptr, &blasForTriangles);
-
-            // step2: ready to build, blas here for the geometry (triangles)
-            VkAccelerationStructureBuildGeometryInfoKHR accelerationBuildGeometryInfo{};
-            accelerationBuildGeometryInfo.sType = VK_STRUCTURE_TYPE_ACCELERATION_STRUCTURE_BUILD_GEOMETRY_INFO_KHR;
-            accelerationBuildGeometryInfo.type = VK_ACCELERATION_STRUCTURE_TYPE_BOTTOM_LEVEL_KHR;
-            accelerationBuildGeometryInfo.flags = VK_BUILD_ACCELERATION_STRUCTURE_PREFER_FAST_TRACE_BIT_KHR;
-            accelerationBuildGeometryInfo.mode = VK_BUILD_ACCELERATION_STRUCTURE_MODE_BUILD_KHR;
-            accelerationBuildGeometryInfo.dstAccelerationStructure = blasForTriangles;
-            accelerationBuildGeometryInfo.geometryCount = 1;
-            accelerationBuildGeometryInfo.pGeometries = &accelerationStructureGeometry;
-            accelerationBuildGeometryInfo.scratchData.deviceAddress = std::get<BUFFER_ENTITY_UID::DEVICE_HOST_ADDRESS>(blasBuildBuffer).deviceAddress;
-
-            VkAccelerationStructureBuildRangeInfoKHR accelerationStructureBuildRangeInfo{};
-            accelerationStructureBuildRangeInfo.primitiveCount = numTriangles;
-            accelerationStructureBuildRangeInfo.primitiveOffset = 0;
-            accelerationStructureBuildRangeInfo.firstVertex = 0;
-            accelerationStructureBuildRangeInfo.transformOffset = 0;
-            std::vector<VkAccelerationStructureBuildRangeInfoKHR *> accelerationBuildStructureRangeInfos = {&accelerationStructureBuildRangeInfo};
-
-            // submit command to gpu to build the blas
-            const auto commandBufferToBuildAS = std::get<COMMAND_BUFFER_ENTITY_OFFSET::COMMAND_BUFFER>(cmdBuffersForIO);
-            const auto fenceToBuildAS = std::get<COMMAND_BUFFER_ENTITY_OFFSET::FENCE>(cmdBuffersForIO);
-            _ctx->BeginRecordCommandBuffer(cmdBuffersForIO);
-            vkCmdBuildAccelerationStructuresKHR(commandBufferToBuildAS,
-                                                1, &accelerationBuildGeometryInfo,
-                                                accelerationBuildStructureRangeInfos.data());
-            _ctx->EndRecordCommandBuffer(cmdBuffersForIO);
-
-            // wait for no body
-            VkSubmitInfo submitInfo{};
-            submitInfo.waitSemaphoreCount = 0;
-            submitInfo.pWaitSemaphores = VK_NULL_HANDLE;
-            // only useful when having waitsemaphore
-            submitInfo.pWaitDstStageMask = VK_NULL_HANDLE;
-            submitInfo.sType = VK_STRUCTURE_TYPE_SUBMIT_INFO;
-            submitInfo.commandBufferCount = 1;
-            submitInfo.pCommandBuffers = &commandBufferToBuildAS;
-            // no body needs to be notified
-            submitInfo.signalSemaphoreCount = 0;
-            submitInfo.pSignalSemaphores = VK_NULL_HANDLE;
-
-            VK_CHECK(vkResetFences(logicalDevice, 1, &fenceToBuildAS));
-            VK_CHECK(vkQueueSubmit(graphicsComputeQueue, 1, &submitInfo, fenceToBuildAS));
-            const auto result = vkWaitForFences(logicalDevice, 1, &fenceToBuildAS, VK_TRUE,
-                                                100000000000);
-            if (result == VK_TIMEOUT)
+        _blasTable.resize(geometries.size());
+        std::vector<BlasGeometry> missedGeometries;
+        std::vector<uint64_t> missedKeys;
+        std::vector<size_t> missedMeshIds;
+        for (size_t i = 0; i < geometries.size(); ++i)
+        {
+            if (cached[i])
             {
-                vkDeviceWaitIdle(logicalDevice);
+                _blasTable[i] = *cached[i];
+                continue;
             }
+            missedGeometries.push_back(geometries[i]);
+            missedKeys.push_back(keys[i]);
+            missedMeshIds.push_back(i);
+        }
+        if (missedGeometries.empty())
+        {
+            return;
+        }
 
-            // connection between blas and tlas
-            // 64-bit address: which can be used for device and shader operations
-            VkAccelerationStructureDeviceAddressInfoKHR accelerationDeviceAddressInfo{};
-            accelerationDeviceAddressInfo.sType = VK_STRUCTURE_TYPE_ACCELERATION_STRUCTURE_DEVICE_ADDRESS_INFO_KHR;
-            accelerationDeviceAddressInfo.accelerationStructure = blasForTriangles;
-            const VkDeviceAddress blasAddress = vkGetAccelerationStructureDeviceAddressKHR(logicalDevice, &accelerationDeviceAddressInfo);
-            const auto blasAddress2 = std::get<BUFFER_ENTITY_UID::DEVICE_HOST_ADDRESS>(blasBuffer).deviceAddress;
-            ASSERT(blasAddress == blasAddress2, "Two different ways to fetch the 64bit address of blas");
-
-            // be done with the scratch buffer that used in the previous build process
-            auto vmaAllocator = _ctx->getVmaAllocator();
-            vmaDestroyBuffer(vmaAllocator, std::get<BUFFER_ENTITY_UID::BUFFER>(blasBuildBuffer), std::get<BUFFER_ENTITY_UID::VMA_ALLOCATION>(blasBuildBuffer));
-
-            _blasEntity = std::make_tuple(blasBuffer, blasForTriangles, blasAddress);
-            ++meshId;
+        // one submit for all the missed meshes, scratch shared, compacted
+        BlasBuilder builder(*_ctx, builderConfig);
+        const auto built = builder.build(missedGeometries);
+        for (size_t i = 0; i < built.size(); ++i)
+        {
+            _blasTable[missedMeshIds[i]] = built[i];
         }
+        cache.store(missedKeys, built);
     }
 
     // about the instancing
@@ -467,122 +511,337 @@ public:
     // Multiple instances can point to the same bottom level acceleration structure
     void initTLAS()
     {
-        auto logicalDevice = _ctx->getLogicDevice();
-        const auto blasDeviceAddress = std::get<AS_ENTITY_UID::DEVICE_ADDRESS>(_blasEntity);
-        ASSERT(blasDeviceAddress, "blas 64bit device address must be valid");
-
-        size_t meshId = 0;
-        // transformation is done in the glb reader
-        VkTransformMatrixKHR transformMatrix = {
-            1.0f, 0.0f, 0.0f, 0.0f,
-            0.0f, 1.0f, 0.0f, 0.0f,
-            0.0f, 0.0f, 1.0f, 0.0f};
+        ASSERT(_blasTable.size() == _scene->meshes.size(), "one blas per mesh");
 
         std::vector<VkAccelerationStructureInstanceKHR> accelarationInstances;
-        accelarationInstances.reserve(_scene->meshes.size());
+        accelarationInstances.reserve(_scene->instances.size());
 
-        for (const auto &mesh : _scene->meshes)
+        for (const auto &meshInstance : _scene->instances)
         {
             VkAccelerationStructureInstanceKHR instance{};
-            instance.transform = transformMatrix;
+            // node transforms kept by the glb reader
+            instance.transform = toTransformMatrix(meshInstance.transform);
             // 24-bit application-specified index value accessible to ray shaders
-            // in the rt shader: meshIDR[gl_InstanceID] or meshIDR[gl_InstanceCustomIndexEXT]
-            // uniqueness
-            instance.instanceCustomIndex = meshId;
+            // in the rt shader: meshIDR[gl_InstanceCustomIndexEXT], gl_InstanceID for the instance itself
+            instance.instanceCustomIndex = meshInstance.meshId;
             instance.mask = 0xFF;
-            instance.instanceShaderBindingTableRecordOffset = 0;
+            // hit record of the mesh, one geometry per blas
+            instance.instanceShaderBindingTableRecordOffset = meshInstance.meshId;
             // disables face culling for this instance.
-            instance.flags = VK_GEOMETRY_INSTANCE_TRIANGLE_FACING_CULL_DISABLE_BIT_KHR;
+            // the blas geometries are opaque: the alpha-tested instances opt back into the any hit shader
+            instance.flags = VK_GEOMETRY_INSTANCE_TRIANGLE_FACING_CULL_DISABLE_BIT_KHR |
+                             (materialClass(meshInstance.meshId) == ALPHA_TESTED_MATERIAL
+                                  ? VK_GEOMETRY_INSTANCE_FORCE_NO_OPAQUE_BIT_KHR
+                                  : VK_GEOMETRY_INSTANCE_FORCE_OPAQUE_BIT_KHR);
             // connection between blas and tlas
-            instance.accelerationStructureReference = blasDeviceAddress;
+            instance.accelerationStructureReference = std::get<AS_ENTITY_UID::DEVICE_ADDRESS>(_blasTable[meshInstance.meshId]);
+            ASSERT(instance.accelerationStructureReference, "blas 64bit device address must be valid");
 
             accelarationInstances.emplace_back(instance);
         }
-        const auto aiStagingBufferSizeInByte = sizeof(VkAccelerationStructureInstanceKHR) * accelarationInstances.size();
-        const auto aiStagingBuffer = _ctx->createBuffer(
-            "TLAS staging buffer",
-            aiStagingBufferSizeInByte,
-            // read-only input to an acceleration structure build.
-            VK_BUFFER_USAGE_ACCELERATION_STRUCTURE_BUILD_INPUT_READ_ONLY_BIT_KHR | VK_BUFFER_USAGE_SHADER_DEVICE_ADDRESS_BIT,
-            VK_SHARING_MODE_EXCLUSIVE,
-            VMA_ALLOCATION_CREATE_HOST_ACCESS_RANDOM_BIT | VMA_ALLOCATION_CREATE_MAPPED_BIT,
-            VK_MEMORY_PROPERTY_HOST_CACHED_BIT,
-            VK_MEMORY_PROPERTY_HOST_CACHED_BIT,
-            VMA_MEMORY_USAGE_CPU_ONLY,
-            true); // mapping when createBuffer
-
-        auto &dst = std::get<BUFFER_ENTITY_UID::MAPPING_ADDRESS>(aiStagingBuffer);
-        memcpy(dst, accelarationInstances.data(), aiStagingBufferSizeInByte);
-
-        // refer to this in the blas build for comparison
-        VkAccelerationStructureGeometryKHR accelerationStructureGeometry{};
-        accelerationStructureGeometry.sType = VK_STRUCTURE_TYPE_ACCELERATION_STRUCTURE_GEOMETRY_KHR;
-        // instance vs triangles
-        accelerationStructureGeometry.geometryType = VK_GEOMETRY_TYPE_INSTANCES_KHR;
-        accelerationStructureGeometry.flags = VK_GEOMETRY_OPAQUE_BIT_KHR;
-        accelerationStructureGeometry.geometry.instances.sType = VK_STRUCTURE_TYPE_ACCELERATION_STRUCTURE_GEOMETRY_INSTANCES_DATA_KHR;
-        // VK_TRUE means: packed motion instance information as described in motion instances
-        accelerationStructureGeometry.geometry.instances.arrayOfPointers = VK_FALSE;
-        // data is either the address of an array of device or host addresses referencing individual VkAccelerationStructureInstanceKHR structures
-        VkDeviceOrHostAddressConstKHR instanceDataDeviceAddress{};
-        instanceDataDeviceAddress.deviceAddress = std::get<BUFFER_ENTITY_UID::DEVICE_HOST_ADDRESS>(aiStagingBuffer).deviceAddress;
-        accelerationStructureGeometry.geometry.instances.data = instanceDataDeviceAddress;
-
-        VkAccelerationStructureBuildGeometryInfoKHR accelerationStructureBuildGeometryInfo{};
-        accelerationStructureBuildGeometryInfo.sType = VK_STRUCTURE_TYPE_ACCELERATION_STRUCTURE_BUILD_GEOMETRY_INFO_KHR;
-        accelerationStructureBuildGeometryInfo.type = VK_ACCELERATION_STRUCTURE_TYPE_TOP_LEVEL_KHR;
-        // VK_BUILD_ACCELERATION_STRUCTURE_ALLOW_UPDATE_BIT_KHR: specified acceleration structure can be updated
-        accelerationStructureBuildGeometryInfo.flags = VK_BUILD_ACCELERATION_STRUCTURE_PREFER_FAST_TRACE_BIT_KHR | VK_BUILD_ACCELERATION_STRUCTURE_ALLOW_UPDATE_BIT_KHR;
-        accelerationStructureBuildGeometryInfo.geometryCount = 1;
-        accelerationStructureBuildGeometryInfo.pGeometries = &accelerationStructureGeometry;
-
-        // measure the AS build size, same step as blas process
-        uint32_t instanceCount = static_cast<uint32_t>(accelarationInstances.size());
-        VkAccelerationStructureBuildSizesInfoKHR accelerationStructureBuildSizesInfo{};
-        accelerationStructureBuildSizesInfo.sType = VK_STRUCTURE_TYPE_ACCELERATION_STRUCTURE_BUILD_SIZES_INFO_KHR;
-        vkGetAccelerationStructureBuildSizesKHR(
-            logicalDevice,
-            VK_ACCELERATION_STRUCTURE_BUILD_TYPE_DEVICE_KHR,
-            &accelerationStructureBuildGeometryInfo,
-            &instanceCount,
-            &accelerationStructureBuildSizesInfo);
-
-        const auto tlasBufferSizeInBytes = accelerationStructureBuildSizesInfo.accelerationStructureSize;
-        // TO DO
-        // tLAS_.buffer = context_->createBuffer(
-        //     accelerationStructureBuildSizesInfo.accelerationStructureSize,
-        //     VK_BUFFER_USAGE_ACCELERATION_STRUCTURE_STORAGE_BIT_KHR |
-        //         VK_BUFFER_USAGE_SHADER_DEVICE_ADDRESS_BIT,
-        //     VMA_MEMORY_USAGE_GPU_ONLY, "Top Level accel struct buffer");
+        _tlas = std::make_unique<TopLevelAS>(*_ctx, accelarationInstances, _ctx->getFramesInFlight(), TopLevelAS::Config{});
     };
 
+    // moving instances: picked up by the refit (or rebuild) of the next execute()
+    void setInstanceTransform(uint32_t instanceId, const glm::mat4 &transform)
+    {
+        ASSERT(_tlas, "tlas should be built");
+        _tlas->setTransform(instanceId, transform);
+        _resetAccumulation = true;
+    }
+
     void bindResourceToDescriptorSets()
     {
         ASSERT(_ctx, "vk context should be defined");
+        ASSERT(_tlas, "tlas should be built");
+        auto logicalDevice = _ctx->getLogicDevice();
+
+        // tlas, refit and rebuilt in place: bound once
+        {
+            const auto &dstSets = _descriptorSets[&_descriptorSetLayouts[DESC_LAYOUT_SEMANTIC::AS]];
+            ASSERT(dstSets.size() == 1, "AS descriptor set size is 1");
+            const auto tlas = _tlas->handle();
+            const VkWriteDescriptorSetAccelerationStructureKHR asInfo{
+                .sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET_ACCELERATION_STRUCTURE_KHR,
+                .accelerationStructureCount = 1,
+                .pAccelerationStructures = &tlas,
+            };
+            const VkWriteDescriptorSet write{
+                .sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET,
+                .pNext = &asInfo,
+                .dstSet = dstSets[0],
+                .dstBinding = 0,
+                .dstArrayElement = 0,
+                .descriptorCount = 1,
+                .descriptorType = VK_DESCRIPTOR_TYPE_ACCELERATION_STRUCTURE_KHR,
+            };
+            vkUpdateDescriptorSets(logicalDevice, 1, &write, 0, nullptr);
+        }
+
+        // output and accumulation images
+        {
+            const auto &dstSets = _descriptorSets[&_descriptorSetLayouts[DESC_LAYOUT_SEMANTIC::OUTPUT_IMAGE]];
+            ASSERT(dstSets.size() == 1, "output image descriptor set size is 1");
+            const VkDescriptorImageInfo imageInfos[2] = {
+                {
+                    .sampler = VK_NULL_HANDLE,
+                    .imageView = std::get<IMAGE_ENTITY_OFFSET::IMAGE_VIEW>(_rtOutputImage),
+                    .imageLayout = VK_IMAGE_LAYOUT_GENERAL,
+                },
+                {
+                    .sampler = VK_NULL_HANDLE,
+                    .imageView = std::get<IMAGE_ENTITY_OFFSET::IMAGE_VIEW>(_accumulationImage),
+                    .imageLayout = VK_IMAGE_LAYOUT_GENERAL,
+                },
+            };
+            VkWriteDescriptorSet writes[2];
+            for (uint32_t binding = 0; binding < 2; ++binding)
+            {
+                writes[binding] = VkWriteDescriptorSet{
+                    .sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET,
+                    .dstSet = dstSets[0],
+                    .dstBinding = binding,
+                    .dstArrayElement = 0,
+                    .descriptorCount = 1,
+                    .descriptorType = VK_DESCRIPTOR_TYPE_STORAGE_IMAGE,
+                    .pImageInfo = &imageInfos[binding],
+                };
+            }
+            vkUpdateDescriptorSets(logicalDevice, 2, writes, 0, nullptr);
+        }
+
+        // camera uniform buffer
+        {
+            const auto &dstSets = _descriptorSets[&_descriptorSetLayouts[DESC_LAYOUT_SEMANTIC::CAMERA_PROP]];
+            ASSERT(dstSets.size() == _frameAllocator->numFramesInFlight(), "CAMERA_PROP descriptor set size should equal # of frames in flight");
+            _frameAllocator->bindDescriptorSets(dstSets, VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER_DYNAMIC, sizeof(UniformCameraProp));
+        }
     }
 
     virtual void execute(CommandBufferEntity cmd, int currentFrameId) override
     {
+        const auto cmdBuffer = std::get<COMMAND_BUFFER_ENTITY_OFFSET::COMMAND_BUFFER>(cmd);
+        ASSERT(
+            _frameAllocator->currentFrameId() == currentFrameId,
+            "execute:: the frame allocator should be on currentFrameId");
+        if (_tlas)
+        {
+            _tlas->record(cmdBuffer, currentFrameId);
+        }
+
+        // 1. the frame slot is free again: its timestamps are the cost of its tiles
+        updateTileCost(currentFrameId);
+
+        // 2. a new view restarts the accumulation
+        const auto cameraProp = currentCameraProp();
+        if (_resetAccumulation || std::memcmp(&cameraProp, &_lastCameraProp, sizeof(cameraProp)) != 0)
+        {
+            _lastCameraProp = cameraProp;
+            _samplesPerPixel = 0;
+            _nextTileId = 0;
+            _resetAccumulation = false;
+        }
+        const auto cameraAllocation = _frameAllocator->push(cameraProp);
+
+        const uint32_t numTilesX = (_imageExtent.width + _config.tileSize - 1) / _config.tileSize;
+        const uint32_t numTilesY = (_imageExtent.height + _config.tileSize - 1) / _config.tileSize;
+        const uint32_t numTiles = numTilesX * numTilesY;
+        // the current pass counts as a fraction of a sample
+        const double progress = _samplesPerPixel + static_cast<double>(_nextTileId) / numTiles;
+        TracyPlot("RayTracing: samples per pixel", progress);
+        TracyPlot("RayTracing: convergence (%)", 100.0 * progress / _config.maxSamplesPerPixel);
+        _tilesInFlight[currentFrameId] = 0;
+        if (_samplesPerPixel >= _config.maxSamplesPerPixel)
+        {
+            // converged, the output image is final
+            TracyPlot("RayTracing: tiles per frame", int64_t(0));
+            return;
+        }
+
+        // 3. as many tiles as the budget allows, at least one: the image always makes progress
+        const uint32_t numTilesThisFrame = _msPerTile > 0.0
+                                               ? std::clamp(static_cast<uint32_t>(_config.frameBudgetMs / _msPerTile), 1u, numTiles)
+                                               : 1u;
+
+        const auto rtPipeline = std::get<0>(_rtPipelineEntity);
+        const auto rtPipelineLayout = std::get<1>(_rtPipelineEntity);
+        vkCmdBindPipeline(cmdBuffer, VK_PIPELINE_BIND_POINT_RAY_TRACING_KHR, rtPipeline);
+        vkCmdBindDescriptorSets(cmdBuffer,
+                                VK_PIPELINE_BIND_POINT_RAY_TRACING_KHR,
+                                rtPipelineLayout, 0, 1,
+                                &_descriptorSets[&_descriptorSetLayouts[DESC_LAYOUT_SEMANTIC::AS]][0],
+                                0,
+                                nullptr);
+        vkCmdBindDescriptorSets(cmdBuffer,
+                                VK_PIPELINE_BIND_POINT_RAY_TRACING_KHR,
+                                rtPipelineLayout, 1, 1,
+                                &_descriptorSets[&_descriptorSetLayouts[DESC_LAYOUT_SEMANTIC::OUTPUT_IMAGE]][0],
+                                0,
+                                nullptr);
+        vkCmdBindDescriptorSets(cmdBuffer,
+                                VK_PIPELINE_BIND_POINT_RAY_TRACING_KHR,
+                                rtPipelineLayout, 2, 1,
+                                &_descriptorSets[&_descriptorSetLayouts[DESC_LAYOUT_SEMANTIC::CAMERA_PROP]][currentFrameId],
+                                1,
+                                &cameraAllocation.offset);
+
+        const uint32_t firstQuery = 2 * currentFrameId;
+        vkCmdResetQueryPool(cmdBuffer, _timestampQueryPool, firstQuery, 2);
+        vkCmdWriteTimestamp2(cmdBuffer, VK_PIPELINE_STAGE_2_TOP_OF_PIPE_BIT, _timestampQueryPool, firstQuery);
+        // the samples of the previous frames are read back
+        recordAccumulationBarrier(cmdBuffer);
+        uint32_t numTilesTraced = 0;
+        for (; numTilesTraced < numTilesThisFrame && _samplesPerPixel < _config.maxSamplesPerPixel; ++numTilesTraced)
+        {
+            const uint32_t tileX = (_nextTileId % numTilesX) * _config.tileSize;
+            const uint32_t tileY = (_nextTileId / numTilesX) * _config.tileSize;
+            const ProgressivePushConstants pushConstants{
+                .tileOffset = glm::uvec2(tileX, tileY),
+                .sampleIndex = _samplesPerPixel,
+            };
+            vkCmdPushConstants(cmdBuffer, rtPipelineLayout, VK_SHADER_STAGE_RAYGEN_BIT_KHR, 0, sizeof(pushConstants), &pushConstants);
+            vkCmdTraceRaysKHR(cmdBuffer,
+                              &_sbt->raygenRegion(),
+                              &_sbt->missRegion(),
+                              &_sbt->hitRegion(),
+                              &_sbt->callableRegion(),
+                              (std::min)(_config.tileSize, _imageExtent.width - tileX),
+                              (std::min)(_config.tileSize, _imageExtent.height - tileY),
+                              1);
+            if (++_nextTileId == numTiles)
+            {
+                // one more sample for every pixel, the next pass reads this one
+                _nextTileId = 0;
+                ++_samplesPerPixel;
+                recordAccumulationBarrier(cmdBuffer);
+            }
+        }
+        vkCmdWriteTimestamp2(cmdBuffer, VK_PIPELINE_STAGE_2_RAY_TRACING_SHADER_BIT_KHR, _timestampQueryPool, firstQuery + 1);
+        _tilesInFlight[currentFrameId] = numTilesTraced;
+        TracyPlot("RayTracing: tiles per frame", static_cast<int64_t>(numTilesTraced));
     }
 
 private:
+    enum MATERIAL_CLASS : int
+    {
+        OPAQUE_MATERIAL = 0,
+        // closest hit + any hit
+        ALPHA_TESTED_MATERIAL = 1,
+        MATERIAL_CLASS_SIZE
+    };
+
+    // shaderRecordEXT of the hit records, refer to rayTracingCommon.glsl
+    struct HitRecordData
+    {
+        glm::vec4 basecolor{1.0f};
+        float alphaCutoff{0.0f};
+        int32_t materialId{-1};
+        uint32_t meshId{0};
+        uint32_t padding{0};
+    };
+
+    // layout(push_constant) uniform ProgressiveProperties in rayGeneration.rgen
+    struct ProgressivePushConstants
+    {
+        glm::uvec2 tileOffset{0};
+        uint32_t sampleIndex{0};
+        uint32_t padding{0};
+    };
+
+    // rayGeneration.rgen unprojects through the inverses, same projection as the raster path
+    UniformCameraProp currentCameraProp() const
+    {
+        ASSERT(_camera, "camera should be defined");
+        return UniformCameraProp{
+            .viewInverse = glm::inverse(_camera->viewTransformLH()),
+            .projInverse = glm::inverse(glm::perspective(glm::radians(_camera->verticalFov()),
+                                                         static_cast<float>(_imageExtent.width) / _imageExtent.height,
+                                                         _camera->nearPlaneD(),
+                                                         _camera->farPlaneD())),
+        };
+    }
+
+    // ray generation writes -> ray generation reads and writes of the same pixels
+    void recordAccumulationBarrier(VkCommandBuffer cmdBuffer) const
+    {
+        const VkMemoryBarrier2 barrier{
+            .sType = VK_STRUCTURE_TYPE_MEMORY_BARRIER_2,
+            .srcStageMask = VK_PIPELINE_STAGE_2_RAY_TRACING_SHADER_BIT_KHR,
+            .srcAccessMask = VK_ACCESS_2_SHADER_STORAGE_WRITE_BIT,
+            .dstStageMask = VK_PIPELINE_STAGE_2_RAY_TRACING_SHADER_BIT_KHR,
+            .dstAccessMask = VK_ACCESS_2_SHADER_STORAGE_READ_BIT | VK_ACCESS_2_SHADER_STORAGE_WRITE_BIT,
+        };
+        const VkDependencyInfo dependency{
+            .sType = VK_STRUCTURE_TYPE_DEPENDENCY_INFO,
+            .memoryBarrierCount = 1,
+            .pMemoryBarriers = &barrier,
+        };
+        vkCmdPipelineBarrier2(cmdBuffer, &dependency);
+    }
+
+    // moving average of the gpu time of one tile
+    void updateTileCost(uint32_t frameId)
+    {
+        const auto numTiles = _tilesInFlight[frameId];
+        if (numTiles == 0)
+        {
+            return;
+        }
+        uint64_t timestamps[2]{};
+        // the frame was waited on, VK_NOT_READY only if the queries were never written
+        if (vkGetQueryPoolResults(_ctx->getLogicDevice(), _timestampQueryPool, 2 * frameId, 2,
+                                  sizeof(timestamps), timestamps, sizeof(uint64_t),
+                                  VK_QUERY_RESULT_64_BIT) != VK_SUCCESS)
+        {
+            return;
+        }
+        const double tileMs = (timestamps[1] - timestamps[0]) * _timestampPeriodNs / 1e6 / numTiles;
+        _msPerTile = _msPerTile > 0.0 ? 0.8 * _msPerTile + 0.2 * tileMs : tileMs;
+    }
+
+    MATERIAL_CLASS materialClass(uint32_t meshId) const
+    {
+        const auto materialIdx = _scene->meshes[meshId].materialIdx;
+        return materialIdx >= 0 && materialIdx < static_cast<int32_t>(_scene->materials.size()) &&
+                       _scene->materials[materialIdx].isAlphaTested()
+                   ? ALPHA_TESTED_MATERIAL
+                   : OPAQUE_MATERIAL;
+    }
+
     // for pipeline and binding resource
     std::vector<VkDescriptorSetLayout> _descriptorSetLayouts;
     VkShaderModule _rtRayGenShaderModule{VK_NULL_HANDLE};
     VkShaderModule _rtRayMissShaderModule{VK_NULL_HANDLE};
     VkShaderModule _rtRayClosestHitShaderModule{VK_NULL_HANDLE};
+    VkShaderModule _rtRayAnyHitShaderModule{VK_NULL_HANDLE};
     std::tuple<VkPipeline, VkPipelineLayout, std::vector<VkRayTracingShaderGroupCreateInfoKHR>> _rtPipelineEntity;
     std::unordered_map<VkDescriptorSetLayout *, std::vector<VkDescriptorSet>> _descriptorSets;
 
-    // buffers for stb
-    std::tuple<BufferEntity, VkStridedDeviceAddressRegionKHR> _rayGenSTBBuffer;
-    std::tuple<BufferEntity, VkStridedDeviceAddressRegionKHR> _rayMissSTBBuffer;
-    std::tuple<BufferEntity, VkStridedDeviceAddressRegionKHR> _rayClosestHitSTBBuffer;
+    // shader groups and the shader binding table over them
+    std::unique_ptr<SbtBuilder> _sbt;
+    uint32_t _rayGenGroupId{0};
+    uint32_t _rayMissGroupId{0};
+    uint32_t _hitGroupIds[MATERIAL_CLASS_SIZE]{};
 
     // image which rt output to
     // input/output of rt shaders
-    ImageEntity _rtOutputImage;
-    BufferEntity _uniformCameraPropBuffer;
+    ImageEntity _rtOutputImage{};
+    // rgba32f, rgb: sum of the samples, a: their count
+    ImageEntity _accumulationImage{};
+    VkExtent2D _imageExtent{};
+
+    // progressive accumulation
+    Config _config;
+    uint32_t _samplesPerPixel{0};
+    // next tile of the current pass, row-major
+    uint32_t _nextTileId{0};
+    bool _resetAccumulation{true};
+    UniformCameraProp _lastCameraProp{};
+    // 2 timestamps per frame in flight, the tiles traced between them
+    VkQueryPool _timestampQueryPool{VK_NULL_HANDLE};
+    std::vector<uint32_t> _tilesInFlight;
+    float _timestampPeriodNs{1.0f};
+    double _msPerTile{0.0};
 
     // to build blas, it needs following:
     BufferEntity *_compositeVB;
@@ -590,5 +849,7 @@ private:
     BufferEntity *_compositeMatB;
     BufferEntity *_indirectDrawB;
 
-    ASEntity _blasEntity;
+    // indexed by mesh id
+    std::vector<ASEntity> _blasTable;
+    std::unique_ptr<TopLevelAS> _tlas;
 };
\ No newline at end of file
@@ -0,0 +1,218 @@
+#include <tracy/Tracy.hpp>
+
+#include <readbackPool.h>
+
+// the formats an offscreen ring is created with
+static VkDeviceSize bytesPerTexel(VkFormat format)
+{
+    switch (format)
+    {
+    case VK_FORMAT_R8G8B8A8_UNORM:
+    case VK_FORMAT_R8G8B8A8_SRGB:
+    case VK_FORMAT_B8G8R8A8_UNORM:
+    case VK_FORMAT_B8G8R8A8_SRGB:
+    case VK_FORMAT_A2B10G10R10_UNORM_PACK32:
+        return 4;
+    case VK_FORMAT_R16G16B16A16_SFLOAT:
+        return 8;
+    case VK_FORMAT_R32G32B32A32_SFLOAT:
+        return 16;
+    default:
+        ASSERT(false, "ReadbackPool: unsupported format");
+        return 0;
+    }
+}
+
+ReadbackPool::ReadbackPool(VkDevice logicalDevice,
+                           VmaAllocator vmaAllocator,
+                           QueueTimeline &timeline,
+                           uint32_t queueFamilyIndex,
+                           uint32_t numSlots,
+                           VkExtent2D extent,
+                           VkFormat format)
+    : _logicalDevice(logicalDevice), _vmaAllocator(vmaAllocator), _timeline(timeline), _extent(extent), _format(format)
+{
+    ASSERT(numSlots > 0, "ReadbackPool needs at least one slot");
+    const auto texelSize = bytesPerTexel(format);
+    _frameSizeInBytes = static_cast<VkDeviceSize>(extent.width) * extent.height * texelSize;
+    // 256: a multiple of every texel size above and of the usual optimalBufferCopyOffsetAlignment
+    _slotStride = (_frameSizeInBytes + 255) & ~VkDeviceSize{255};
+
+    const VkBufferCreateInfo bufferCreateInfo{
+        .sType = VK_STRUCTURE_TYPE_BUFFER_CREATE_INFO,
+        .size = _slotStride * numSlots,
+        .usage = VK_BUFFER_USAGE_TRANSFER_DST_BIT,
+        .sharingMode = VK_SHARING_MODE_EXCLUSIVE,
+    };
+    // the cpu reads every byte back: host cached, mapped once for its whole lifetime
+    const VmaAllocationCreateInfo allocationCreateInfo = {
+        .flags = VMA_ALLOCATION_CREATE_HOST_ACCESS_RANDOM_BIT |
+                 VMA_ALLOCATION_CREATE_MAPPED_BIT,
+        .usage = VMA_MEMORY_USAGE_AUTO_PREFER_HOST,
+    };
+    VmaAllocationInfo allocationInfo;
+    VK_CHECK(vmaCreateBuffer(_vmaAllocator, &bufferCreateInfo, &allocationCreateInfo,
+                             &_buffer, &_allocation, &allocationInfo));
+    _mappedData = static_cast<uint8_t *>(allocationInfo.pMappedData);
+    ASSERT(_mappedData, "readback buffer must be persistently mapped");
+    setCorrlationId(_buffer, _logicalDevice, VK_OBJECT_TYPE_BUFFER, "Buffer: readback pool");
+
+    const VkCommandPoolCreateInfo cmdPoolInfo{
+        .sType = VK_STRUCTURE_TYPE_COMMAND_POOL_CREATE_INFO,
+        .flags = VK_COMMAND_POOL_CREATE_RESET_COMMAND_BUFFER_BIT,
+        .queueFamilyIndex = queueFamilyIndex,
+    };
+    VK_CHECK(vkCreateCommandPool(_logicalDevice, &cmdPoolInfo, nullptr, &_cmdPool));
+    _cmdBuffers.resize(numSlots);
+    const VkCommandBufferAllocateInfo cmdBufferAllocateInfo{
+        .sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO,
+        .commandPool = _cmdPool,
+        .level = VK_COMMAND_BUFFER_LEVEL_PRIMARY,
+        .commandBufferCount = numSlots,
+    };
+    VK_CHECK(vkAllocateCommandBuffers(_logicalDevice, &cmdBufferAllocateInfo, _cmdBuffers.data()));
+    _slotBusy.resize(numSlots, false);
+
+    log(Level::Info, "ReadbackPool: ", numSlots, " slot(s) of ", _frameSizeInBytes, " bytes");
+}
+
+ReadbackPool::~ReadbackPool()
+{
+    // the owner waited for the device to be idle
+    vkFreeCommandBuffers(_logicalDevice, _cmdPool, static_cast<uint32_t>(_cmdBuffers.size()), _cmdBuffers.data());
+    vkDestroyCommandPool(_logicalDevice, _cmdPool, nullptr);
+    vmaDestroyBuffer(_vmaAllocator, _buffer, _allocation);
+}
+
+void ReadbackPool::setCallback(FrameCallback callback)
+{
+    _callback = std::move(callback);
+}
+
+TimelinePoint ReadbackPool::readback(uint32_t slot, VkImage image, VkImageLayout layout)
+{
+    ZoneScopedN("ReadbackPool: readback");
+    ASSERT(slot < _cmdBuffers.size(), "ReadbackPool: slot out of range");
+    // the previous frame of the slot is collected first, in order
+    while (_slotBusy[slot])
+    {
+        deliver(_pendingFrames.front());
+        _pendingFrames.pop_front();
+    }
+
+    const auto cmdBuffer = _cmdBuffers[slot];
+    VK_CHECK(vkResetCommandBuffer(cmdBuffer, 0));
+    const VkCommandBufferBeginInfo beginInfo{
+        .sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO,
+        .flags = VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT,
+    };
+    VK_CHECK(vkBeginCommandBuffer(cmdBuffer, &beginInfo));
+
+    // the rendering was submitted before on the same queue
+    const VkImageMemoryBarrier2 toTransferSrc{
+        .sType = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER_2,
+        .srcStageMask = VK_PIPELINE_STAGE_2_COLOR_ATTACHMENT_OUTPUT_BIT | VK_PIPELINE_STAGE_2_ALL_TRANSFER_BIT,
+        .srcAccessMask = VK_ACCESS_2_COLOR_ATTACHMENT_WRITE_BIT | VK_ACCESS_2_TRANSFER_WRITE_BIT,
+        .dstStageMask = VK_PIPELINE_STAGE_2_COPY_BIT,
+        .dstAccessMask = VK_ACCESS_2_TRANSFER_READ_BIT,
+        .oldLayout = layout,
+        .newLayout = VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL,
+        .srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED,
+        .dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED,
+        .image = image,
+        .subresourceRange = {VK_IMAGE_ASPECT_COLOR_BIT, 0, 1, 0, 1},
+    };
+    const VkDependencyInfo toTransferSrcDependency{
+        .sType = VK_STRUCTURE_TYPE_DEPENDENCY_INFO,
+        .imageMemoryBarrierCount = 1,
+        .pImageMemoryBarriers = &toTransferSrc,
+    };
+    vkCmdPipelineBarrier2(cmdBuffer, &toTransferSrcDependency);
+
+    const VkBufferImageCopy region{
+        .bufferOffset = _slotStride * slot,
+        // tightly packed
+        .bufferRowLength = 0,
+        .bufferImageHeight = 0,
+        .imageSubresource = {VK_IMAGE_ASPECT_COLOR_BIT, 0, 0, 1},
+        .imageOffset = {0, 0, 0},
+        .imageExtent = {_extent.width, _extent.height, 1},
+    };
+    vkCmdCopyImageToBuffer(cmdBuffer, image, VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL, _buffer, 1, &region);
+
+    // the host reads the copy after waiting on the timeline; whatever renders into the image next,
+    // later on the same queue, starts after the copy read it (write-after-read: execution dependency only)
+    const VkImageMemoryBarrier2 releaseImage{
+        .sType = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER_2,
+        .srcStageMask = VK_PIPELINE_STAGE_2_COPY_BIT,
+        .srcAccessMask = VK_ACCESS_2_NONE,
+        .dstStageMask = VK_PIPELINE_STAGE_2_ALL_COMMANDS_BIT,
+        .dstAccessMask = VK_ACCESS_2_NONE,
+        .oldLayout = VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL,
+        .newLayout = VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL,
+        .srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED,
+        .dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED,
+        .image = image,
+        .subresourceRange = {VK_IMAGE_ASPECT_COLOR_BIT, 0, 1, 0, 1},
+    };
+    const VkBufferMemoryBarrier2 toHost{
+        .sType = VK_STRUCTURE_TYPE_BUFFER_MEMORY_BARRIER_2,
+        .srcStageMask = VK_PIPELINE_STAGE_2_COPY_BIT,
+        .srcAccessMask = VK_ACCESS_2_TRANSFER_WRITE_BIT,
+        .dstStageMask = VK_PIPELINE_STAGE_2_HOST_BIT,
+        .dstAccessMask = VK_ACCESS_2_HOST_READ_BIT,
+        .srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED,
+        .dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED,
+        .buffer = _buffer,
+        .offset = _slotStride * slot,
+        .size = _frameSizeInBytes,
+    };
+    const VkDependencyInfo releaseDependency{
+        .sType = VK_STRUCTURE_TYPE_DEPENDENCY_INFO,
+        .bufferMemoryBarrierCount = 1,
+        .pBufferMemoryBarriers = &toHost,
+        .imageMemoryBarrierCount = 1,
+        .pImageMemoryBarriers = &releaseImage,
+    };
+    vkCmdPipelineBarrier2(cmdBuffer, &releaseDependency);
+    VK_CHECK(vkEndCommandBuffer(cmdBuffer));
+
+    const auto copied = _timeline.submit(cmdBuffer);
+    _slotBusy[slot] = true;
+    _pendingFrames.emplace_back(PendingFrame{slot, _nextFrameIndex++, copied});
+    return copied;
+}
+
+size_t ReadbackPool::collect(bool wait)
+{
+    size_t count = 0;
+    while (!_pendingFrames.empty() &&
+           (wait || _timeline.isCompleted(_pendingFrames.front().copied.value)))
+    {
+        deliver(_pendingFrames.front());
+        _pendingFrames.pop_front();
+        ++count;
+    }
+    return count;
+}
+
+void ReadbackPool::deliver(const PendingFrame &frame)
+{
+    ZoneScopedN("ReadbackPool: deliver");
+    _timeline.wait(frame.copied.value);
+    const VkDeviceSize offset = _slotStride * frame.slot;
+    // no-op on host-coherent memory
+    VK_CHECK(vmaInvalidateAllocation(_vmaAllocator, _allocation, offset, _frameSizeInBytes));
+    if (_callback)
+    {
+        _callback(Frame{
+            .frameIndex = frame.frameIndex,
+            .extent = _extent,
+            .format = _format,
+            .data = _mappedData + offset,
+            .sizeInBytes = _frameSizeInBytes,
+        });
+    }
+    _slotBusy[frame.slot] = false;
+    ++_framesRead;
+}
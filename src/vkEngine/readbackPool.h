@@ -0,0 +1,109 @@
+#pragma once
+
+#include <deque>
+#include <functional>
+#include <vector>
+#include <cstdint>
+
+// must ahead of <vk_mem_alloc.h>, see context.h
+#include <misc.h>
+#include <vk_mem_alloc.h>
+#include <queueTimeline.h>
+
+// VkContext without window, surface nor swapchain: createSwapChain() creates an offscreen image ring instead,
+// the frames are read back through ReadbackPool (lavapipe in ci, render farm without display)
+struct HeadlessConfig
+{
+    uint32_t width{1280};
+    uint32_t height{720};
+    VkFormat format{VK_FORMAT_B8G8R8A8_UNORM};
+};
+
+// gpu -> cpu copies of the rendered frames, the output of the headless backend
+// one slot per image of the offscreen ring, every slot sub-allocated out of one persistently mapped,
+// host-cached readback buffer, one command buffer per slot
+// 1. readback(): copies the image into the slot of its ring index, submitted on the queue timeline after
+//    the rendering, the next render into that image (same queue) is ordered after the copy by a barrier
+// 2. the frames go to the callback in submission order once their copy is done: collect() polls,
+//    a slot reused before it was collected waits for it (a slow consumer stalls the gpu, no frame is dropped)
+// collect(true) before the teardown, or the last frames in flight never reach the callback
+// render thread only
+class ReadbackPool
+{
+public:
+    struct Frame
+    {
+        // 0, 1, 2, ... in submission order
+        uint64_t frameIndex{0};
+        VkExtent2D extent{};
+        VkFormat format{VK_FORMAT_UNDEFINED};
+        // tightly packed rows, valid during the callback only
+        const uint8_t *data{nullptr};
+        VkDeviceSize sizeInBytes{0};
+    };
+    using FrameCallback = std::function<void(const Frame &frame)>;
+
+    ReadbackPool() = delete;
+    ReadbackPool(VkDevice logicalDevice,
+                 VmaAllocator vmaAllocator,
+                 QueueTimeline &timeline,
+                 uint32_t queueFamilyIndex,
+                 uint32_t numSlots,
+                 VkExtent2D extent,
+                 VkFormat format);
+    ~ReadbackPool();
+
+    ReadbackPool(const ReadbackPool &other) = delete;
+    ReadbackPool &operator=(const ReadbackPool &other) = delete;
+
+    // no callback: the frames are still copied and waited on, the benchmark only needs the timings
+    void setCallback(FrameCallback callback);
+
+    // layout: the one the rendering left the image in, it is left in VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL
+    // returns the point of the copy, the "presentation" of the frame
+    TimelinePoint readback(uint32_t slot, VkImage image, VkImageLayout layout);
+    // hands the frames whose copy is done to the callback, wait: all of them, returns how many
+    size_t collect(bool wait = false);
+
+    uint64_t framesRead() const
+    {
+        return _framesRead;
+    }
+    VkDeviceSize frameSizeInBytes() const
+    {
+        return _frameSizeInBytes;
+    }
+
+private:
+    struct PendingFrame
+    {
+        uint32_t slot;
+        uint64_t frameIndex;
+        TimelinePoint copied;
+    };
+
+    void deliver(const PendingFrame &frame);
+
+    VkDevice _logicalDevice{VK_NULL_HANDLE};
+    VmaAllocator _vmaAllocator{VK_NULL_HANDLE};
+    QueueTimeline &_timeline;
+    const VkExtent2D _extent;
+    const VkFormat _format;
+    VkDeviceSize _frameSizeInBytes{0};
+    // slots are _slotStride apart, the copy offset must be a multiple of the texel size
+    VkDeviceSize _slotStride{0};
+
+    VkBuffer _buffer{VK_NULL_HANDLE};
+    VmaAllocation _allocation{VK_NULL_HANDLE};
+    uint8_t *_mappedData{nullptr};
+    VkCommandPool _cmdPool{VK_NULL_HANDLE};
+    std::vector<VkCommandBuffer> _cmdBuffers;
+    // slot -> copy not collected yet
+    std::vector<bool> _slotBusy;
+
+    FrameCallback _callback;
+    uint64_t _nextFrameIndex{0};
+    uint64_t _framesRead{0};
+    // submission order
+    std::deque<PendingFrame> _pendingFrames;
+};
@@ -0,0 +1,827 @@
+#include <algorithm>
+
+#include <tracy/Tracy.hpp>
+
+#include <renderGraph.h>
+
+static constexpr VkAccessFlags2 WRITE_ACCESS_MASK =
+    VK_ACCESS_2_SHADER_WRITE_BIT |
+    VK_ACCESS_2_SHADER_STORAGE_WRITE_BIT |
+    VK_ACCESS_2_COLOR_ATTACHMENT_WRITE_BIT |
+    VK_ACCESS_2_DEPTH_STENCIL_ATTACHMENT_WRITE_BIT |
+    VK_ACCESS_2_TRANSFER_WRITE_BIT |
+    VK_ACCESS_2_HOST_WRITE_BIT |
+    VK_ACCESS_2_MEMORY_WRITE_BIT |
+    VK_ACCESS_2_ACCELERATION_STRUCTURE_WRITE_BIT_KHR;
+
+static VkDeviceSize alignUp(VkDeviceSize value, VkDeviceSize alignment)
+{
+    return (value + alignment - 1) / alignment * alignment;
+}
+
+static VkImageCreateInfo imageCreateInfo(const RenderGraphImageDesc &desc)
+{
+    return VkImageCreateInfo{
+        .sType = VK_STRUCTURE_TYPE_IMAGE_CREATE_INFO,
+        .imageType = desc.extent.depth > 1 ? VK_IMAGE_TYPE_3D : VK_IMAGE_TYPE_2D,
+        .format = desc.format,
+        .extent = desc.extent,
+        .mipLevels = desc.mipLevels,
+        .arrayLayers = 1,
+        .samples = VK_SAMPLE_COUNT_1_BIT,
+        .tiling = VK_IMAGE_TILING_OPTIMAL,
+        .usage = desc.usage,
+        .sharingMode = VK_SHARING_MODE_EXCLUSIVE,
+        .initialLayout = VK_IMAGE_LAYOUT_UNDEFINED,
+    };
+}
+
+static VkBufferCreateInfo bufferCreateInfo(const RenderGraphBufferDesc &desc)
+{
+    return VkBufferCreateInfo{
+        .sType = VK_STRUCTURE_TYPE_BUFFER_CREATE_INFO,
+        .size = desc.size,
+        .usage = desc.usage,
+        .sharingMode = VK_SHARING_MODE_EXCLUSIVE,
+    };
+}
+
+size_t CompiledRenderGraph::barrierBatchCount() const
+{
+    size_t res = finalBarriers.empty() ? 0 : 1;
+    for (const auto &pass : passes)
+    {
+        res += pass.barriers.empty() ? 0 : 1;
+    }
+    return res;
+}
+
+size_t CompiledRenderGraph::barrierCount() const
+{
+    // the buffers of a batch share one VkMemoryBarrier2, see RenderGraph::recordBarriers
+    const auto batchBarrierCount = [](const std::vector<RenderGraphBarrier> &barriers)
+    {
+        size_t images = 0;
+        bool buffers = false;
+        for (const auto &barrier : barriers)
+        {
+            if (barrier.image)
+            {
+                ++images;
+            }
+            else
+            {
+                buffers = true;
+            }
+        }
+        return images + (buffers ? 1 : 0);
+    };
+    size_t res = batchBarrierCount(finalBarriers);
+    for (const auto &pass : passes)
+    {
+        res += batchBarrierCount(pass.barriers);
+    }
+    return res;
+}
+
+VkDeviceSize CompiledRenderGraph::transientBytes() const
+{
+    VkDeviceSize res = 0;
+    for (const auto &heap : heaps)
+    {
+        res += heap.size;
+    }
+    return res;
+}
+
+VkDeviceSize CompiledRenderGraph::transientBytesWithoutAliasing() const
+{
+    VkDeviceSize res = 0;
+    for (const auto &placement : placements)
+    {
+        if (placement.has_value())
+        {
+            res += placement->size;
+        }
+    }
+    return res;
+}
+
+RenderGraph::PassBuilder &RenderGraph::PassBuilder::read(RenderGraphResource resource, const RenderGraphAccess &access)
+{
+    _graph.addUse(_pass, resource, access, false);
+    return *this;
+}
+
+RenderGraph::PassBuilder &RenderGraph::PassBuilder::write(RenderGraphResource resource, const RenderGraphAccess &access)
+{
+    _graph.addUse(_pass, resource, access, true);
+    return *this;
+}
+
+RenderGraph::PassBuilder &RenderGraph::PassBuilder::sideEffects()
+{
+    _graph._passes[_pass].sideEffects = true;
+    _graph.invalidate();
+    return *this;
+}
+
+RenderGraph::~RenderGraph()
+{
+    release();
+}
+
+RenderGraphResource RenderGraph::addResource(Resource resource)
+{
+    invalidate();
+    _resources.emplace_back(std::move(resource));
+    return static_cast<RenderGraphResource>(_resources.size() - 1);
+}
+
+RenderGraphResource RenderGraph::importImage(const std::string &name, VkImage image, VkImageView imageView,
+                                             const VkImageSubresourceRange &range,
+                                             std::optional<RenderGraphAccess> initial)
+{
+    Resource resource{
+        .name = name,
+        .type = ResourceType::IMAGE,
+        .imported = true,
+        .initial = initial,
+        .image = image,
+        .imageView = imageView,
+        .range = range,
+    };
+    return addResource(std::move(resource));
+}
+
+RenderGraphResource RenderGraph::importImage(const std::string &name, const ImageEntity &image,
+                                             std::optional<RenderGraphAccess> initial)
+{
+    return importImage(name,
+                       std::get<IMAGE_ENTITY_OFFSET::IMAGE>(image),
+                       std::get<IMAGE_ENTITY_OFFSET::IMAGE_VIEW>(image),
+                       {VK_IMAGE_ASPECT_COLOR_BIT, 0, std::get<IMAGE_ENTITY_OFFSET::MIPMAP_COUNT>(image), 0, 1},
+                       initial);
+}
+
+RenderGraphResource RenderGraph::importBuffer(const std::string &name, VkBuffer buffer,
+                                              std::optional<RenderGraphAccess> initial)
+{
+    Resource resource{
+        .name = name,
+        .type = ResourceType::BUFFER,
+        .imported = true,
+        .initial = initial,
+        .buffer = buffer,
+    };
+    return addResource(std::move(resource));
+}
+
+RenderGraphResource RenderGraph::importBuffer(const std::string &name, const BufferEntity &buffer,
+                                              std::optional<RenderGraphAccess> initial)
+{
+    return importBuffer(name, std::get<BUFFER_ENTITY_UID::BUFFER>(buffer), initial);
+}
+
+RenderGraphResource RenderGraph::createImage(const std::string &name, const RenderGraphImageDesc &desc)
+{
+    ASSERT(desc.extent.width > 0 && desc.extent.height > 0, "createImage:: empty image");
+    Resource resource{
+        .name = name,
+        .type = ResourceType::IMAGE,
+        .range = {desc.aspect, 0, desc.mipLevels, 0, 1},
+        .imageDesc = desc,
+    };
+    return addResource(std::move(resource));
+}
+
+RenderGraphResource RenderGraph::createBuffer(const std::string &name, const RenderGraphBufferDesc &desc)
+{
+    ASSERT(desc.size > 0, "createBuffer:: empty buffer");
+    Resource resource{
+        .name = name,
+        .type = ResourceType::BUFFER,
+        .bufferDesc = desc,
+    };
+    return addResource(std::move(resource));
+}
+
+void RenderGraph::markOutput(RenderGraphResource resource, std::optional<VkImageLayout> finalLayout)
+{
+    ASSERT(resource < _resources.size(), "markOutput:: unknown resource");
+    auto &res = _resources[resource];
+    ASSERT(!finalLayout.has_value() || (res.imported && res.type == ResourceType::IMAGE),
+           "markOutput:: a final layout only applies to imported images");
+    invalidate();
+    res.output = true;
+    res.finalLayout = finalLayout;
+}
+
+RenderGraph::PassBuilder RenderGraph::addPass(const std::string &name, RecordFn record)
+{
+    invalidate();
+    _passes.emplace_back(Pass{.name = name, .record = std::move(record)});
+    return PassBuilder(*this, static_cast<uint32_t>(_passes.size() - 1));
+}
+
+RenderGraph::PassBuilder RenderGraph::addPass(const std::string &name, RenderPassBase *pass)
+{
+    ASSERT(pass, "addPass:: null render pass");
+    return addPass(name, [pass](RenderGraph &, CommandBufferEntity &cmd, int frameIndex)
+                   { pass->execute(cmd, frameIndex); });
+}
+
+void RenderGraph::addUse(uint32_t pass, RenderGraphResource resource, const RenderGraphAccess &access, bool write)
+{
+    ASSERT(resource < _resources.size(), "addUse:: unknown resource");
+    invalidate();
+    auto &uses = _passes[pass].uses;
+    const auto it = std::find_if(uses.begin(), uses.end(), [resource](const ResourceUse &use)
+                                 { return use.resource == resource; });
+    if (it == uses.end())
+    {
+        uses.emplace_back(ResourceUse{resource, access, write});
+        return;
+    }
+    // read and write by the same pass: one access, one barrier
+    ASSERT(_resources[resource].type == ResourceType::BUFFER || it->access.layout == access.layout,
+           "a pass uses an image in one layout");
+    it->access.stages |= access.stages;
+    it->access.access |= access.access;
+    it->write = it->write || write;
+}
+
+void RenderGraph::invalidate()
+{
+    if (!_isCompiled)
+    {
+        return;
+    }
+    // the placements change: the aliased resources go
+    release();
+    _isCompiled = false;
+}
+
+std::vector<uint32_t> RenderGraph::cullPasses(std::vector<uint32_t> &culled) const
+{
+    // backwards from the outputs: a pass lives if it writes something read later by a living pass
+    std::vector<bool> needed(_resources.size(), false);
+    for (size_t i = 0; i < _resources.size(); ++i)
+    {
+        needed[i] = _resources[i].output;
+    }
+    std::vector<bool> alive(_passes.size(), false);
+    for (size_t p = _passes.size(); p-- > 0;)
+    {
+        const auto &pass = _passes[p];
+        alive[p] = pass.sideEffects ||
+                   std::any_of(pass.uses.begin(), pass.uses.end(), [&needed](const ResourceUse &use)
+                               { return use.write && needed[use.resource]; });
+        if (!alive[p])
+        {
+            continue;
+        }
+        // overwritten: what the earlier passes wrote is dead, unless read here as well
+        for (const auto &use : pass.uses)
+        {
+            if (use.write)
+            {
+                needed[use.resource] = false;
+            }
+        }
+        for (const auto &use : pass.uses)
+        {
+            if (!use.write || (use.access.access & ~WRITE_ACCESS_MASK))
+            {
+                needed[use.resource] = true;
+            }
+        }
+    }
+
+    std::vector<uint32_t> res;
+    for (uint32_t p = 0; p < _passes.size(); ++p)
+    {
+        (alive[p] ? res : culled).push_back(p);
+    }
+    return res;
+}
+
+void RenderGraph::placeTransients(const MemoryRequirementsFn &memoryRequirements)
+{
+    auto &placements = _compiled.placements;
+    placements.assign(_resources.size(), std::nullopt);
+    for (uint32_t i = 0; i < _compiled.passes.size(); ++i)
+    {
+        for (const auto &use : _passes[_compiled.passes[i].pass].uses)
+        {
+            if (_resources[use.resource].imported)
+            {
+                continue;
+            }
+            auto &placement = placements[use.resource];
+            if (!placement.has_value())
+            {
+                placement = CompiledRenderGraph::Placement{.firstUse = i, .lastUse = i};
+            }
+            placement->lastUse = i;
+        }
+    }
+
+    std::vector<RenderGraphResource> transients;
+    for (RenderGraphResource r = 0; r < _resources.size(); ++r)
+    {
+        if (placements[r].has_value())
+        {
+            transients.push_back(r);
+        }
+    }
+    if (transients.empty())
+    {
+        return;
+    }
+    ASSERT(memoryRequirements, "compile:: transient resources need the memory requirements");
+
+    std::vector<VkMemoryRequirements> requirements(_resources.size());
+    for (const auto r : transients)
+    {
+        requirements[r] = memoryRequirements(r);
+        placements[r]->size = requirements[r].size;
+    }
+    // largest first: the small ones fill the gaps
+    std::stable_sort(transients.begin(), transients.end(), [&requirements](RenderGraphResource a, RenderGraphResource b)
+                     { return requirements[a].size > requirements[b].size; });
+
+    // images and buffers in separate heaps: no bufferImageGranularity to care about
+    std::vector<ResourceType> heapTypes;
+    std::vector<std::vector<RenderGraphResource>> heapResources;
+    for (const auto r : transients)
+    {
+        const auto &requirement = requirements[r];
+        auto &placement = *placements[r];
+        uint32_t heapIndex = 0;
+        for (; heapIndex < _compiled.heaps.size(); ++heapIndex)
+        {
+            if (heapTypes[heapIndex] == _resources[r].type &&
+                (_compiled.heaps[heapIndex].memoryTypeBits & requirement.memoryTypeBits) != 0)
+            {
+                break;
+            }
+        }
+        if (heapIndex == _compiled.heaps.size())
+        {
+            _compiled.heaps.emplace_back();
+            heapTypes.push_back(_resources[r].type);
+            heapResources.emplace_back();
+        }
+
+        // first fit between the resources alive at the same time
+        std::vector<std::pair<VkDeviceSize, VkDeviceSize>> occupied;
+        for (const auto other : heapResources[heapIndex])
+        {
+            const auto &otherPlacement = *placements[other];
+            if (otherPlacement.firstUse <= placement.lastUse && placement.firstUse <= otherPlacement.lastUse)
+            {
+                occupied.emplace_back(otherPlacement.offset, otherPlacement.offset + otherPlacement.size);
+            }
+        }
+        std::sort(occupied.begin(), occupied.end());
+        VkDeviceSize offset = 0;
+        for (const auto &[begin, end] : occupied)
+        {
+            if (alignUp(offset, requirement.alignment) + requirement.size <= begin)
+            {
+                break;
+            }
+            offset = (std::max)(offset, end);
+        }
+        offset = alignUp(offset, requirement.alignment);
+
+        auto &heap = _compiled.heaps[heapIndex];
+        heap.size = (std::max)(heap.size, offset + requirement.size);
+        heap.alignment = (std::max)(heap.alignment, requirement.alignment);
+        heap.memoryTypeBits &= requirement.memoryTypeBits;
+        placement.heap = heapIndex;
+        placement.offset = offset;
+        heapResources[heapIndex].push_back(r);
+    }
+}
+
+std::vector<RenderGraph::ResourceState> RenderGraph::initialStates(
+    const std::vector<std::optional<ResourceState>> &carriedOver) const
+{
+    // stages and writes of every transient, for the aliasing barriers
+    std::vector<RenderGraphAccess> transientUses(_resources.size());
+    for (const auto &compiledPass : _compiled.passes)
+    {
+        for (const auto &use : _passes[compiledPass.pass].uses)
+        {
+            transientUses[use.resource].stages |= use.access.stages;
+            transientUses[use.resource].access |= use.access.access & WRITE_ACCESS_MASK;
+        }
+    }
+
+    std::vector<ResourceState> states(_resources.size());
+    for (RenderGraphResource r = 0; r < _resources.size(); ++r)
+    {
+        const auto &resource = _resources[r];
+        auto &state = states[r];
+        if (resource.imported)
+        {
+            if (resource.initial.has_value())
+            {
+                const auto &initial = *resource.initial;
+                if (initial.access & WRITE_ACCESS_MASK)
+                {
+                    state.writeStages = initial.stages;
+                    state.writeAccess = initial.access & WRITE_ACCESS_MASK;
+                }
+                else
+                {
+                    state.readStages = initial.stages;
+                    state.readAccess = initial.access;
+                }
+                state.layout = initial.layout;
+            }
+            else if (r < carriedOver.size() && carriedOver[r].has_value())
+            {
+                state = *carriedOver[r];
+            }
+            continue;
+        }
+        if (!_compiled.placements[r].has_value())
+        {
+            continue;
+        }
+        // the memory was last used by whatever overlaps it: earlier in the frame, or the previous frame
+        const auto &placement = *_compiled.placements[r];
+        for (RenderGraphResource other = 0; other < _resources.size(); ++other)
+        {
+            const auto &otherPlacement = _compiled.placements[other];
+            if (!otherPlacement.has_value() || otherPlacement->heap != placement.heap ||
+                otherPlacement->offset >= placement.offset + placement.size ||
+                placement.offset >= otherPlacement->offset + otherPlacement->size)
+            {
+                continue;
+            }
+            state.writeStages |= transientUses[other].stages;
+            state.writeAccess |= transientUses[other].access;
+        }
+        state.layout = VK_IMAGE_LAYOUT_UNDEFINED;
+    }
+    return states;
+}
+
+std::optional<RenderGraphBarrier> RenderGraph::transition(RenderGraphResource resource, bool isImage,
+                                                          ResourceState &state, const RenderGraphAccess &access,
+                                                          bool write)
+{
+    const bool layoutChange = isImage && access.layout != VK_IMAGE_LAYOUT_UNDEFINED && access.layout != state.layout;
+    const auto newLayout = isImage && access.layout != VK_IMAGE_LAYOUT_UNDEFINED ? access.layout : state.layout;
+
+    if (write || layoutChange)
+    {
+        // RAW/WAW on the writes, WAR on the reads (execution only), or a layout transition
+        RenderGraphBarrier barrier{
+            .resource = resource,
+            .image = isImage,
+            .srcStages = state.writeStages | state.readStages,
+            .srcAccess = state.writeAccess,
+            .dstStages = access.stages,
+            .dstAccess = access.access,
+            .oldLayout = isImage ? state.layout : VK_IMAGE_LAYOUT_UNDEFINED,
+            .newLayout = isImage ? newLayout : VK_IMAGE_LAYOUT_UNDEFINED,
+        };
+        // a transition is a write: the later readers sync on these stages
+        state.writeStages = access.stages;
+        state.writeAccess = write ? (access.access & WRITE_ACCESS_MASK) : VK_ACCESS_2_NONE;
+        state.readStages = write ? VK_PIPELINE_STAGE_2_NONE : access.stages;
+        state.readAccess = write ? VK_ACCESS_2_NONE : access.access;
+        state.layout = newLayout;
+        if (!layoutChange && barrier.srcStages == VK_PIPELINE_STAGE_2_NONE)
+        {
+            // first touch of the resource
+            return std::nullopt;
+        }
+        return barrier;
+    }
+
+    // read after read in the same layout, or read of what is already visible to these stages
+    const auto missingStages = access.stages & ~state.readStages;
+    const auto missingAccess = access.access & ~state.readAccess;
+    state.readStages |= access.stages;
+    state.readAccess |= access.access;
+    if (state.writeStages == VK_PIPELINE_STAGE_2_NONE || (missingStages == 0 && missingAccess == 0))
+    {
+        return std::nullopt;
+    }
+    return RenderGraphBarrier{
+        .resource = resource,
+        .image = isImage,
+        .srcStages = state.writeStages,
+        .srcAccess = state.writeAccess,
+        .dstStages = access.stages,
+        .dstAccess = access.access,
+        .oldLayout = isImage ? state.layout : VK_IMAGE_LAYOUT_UNDEFINED,
+        .newLayout = isImage ? state.layout : VK_IMAGE_LAYOUT_UNDEFINED,
+    };
+}
+
+std::vector<RenderGraph::ResourceState> RenderGraph::computeBarriers(std::vector<ResourceState> states)
+{
+    for (auto &compiledPass : _compiled.passes)
+    {
+        compiledPass.barriers.clear();
+        for (const auto &use : _passes[compiledPass.pass].uses)
+        {
+            const bool isImage = _resources[use.resource].type == ResourceType::IMAGE;
+            if (const auto barrier = transition(use.resource, isImage, states[use.resource], use.access, use.write))
+            {
+                compiledPass.barriers.push_back(*barrier);
+            }
+        }
+    }
+
+    _compiled.finalBarriers.clear();
+    for (RenderGraphResource r = 0; r < _resources.size(); ++r)
+    {
+        const auto &resource = _resources[r];
+        auto &state = states[r];
+        if (!resource.finalLayout.has_value() || state.layout == *resource.finalLayout)
+        {
+            continue;
+        }
+        // presents and other queues sync through semaphores, nothing to wait for on this queue
+        _compiled.finalBarriers.emplace_back(RenderGraphBarrier{
+            .resource = r,
+            .image = true,
+            .srcStages = state.writeStages | state.readStages,
+            .srcAccess = state.writeAccess,
+            .dstStages = VK_PIPELINE_STAGE_2_NONE,
+            .dstAccess = VK_ACCESS_2_NONE,
+            .oldLayout = state.layout,
+            .newLayout = *resource.finalLayout,
+        });
+        state = ResourceState{
+            .writeStages = VK_PIPELINE_STAGE_2_ALL_COMMANDS_BIT,
+            .layout = *resource.finalLayout,
+        };
+    }
+    return states;
+}
+
+const CompiledRenderGraph &RenderGraph::compile(const MemoryRequirementsFn &memoryRequirements)
+{
+    ZoneScopedN("RenderGraph: compile");
+    release();
+    _compiled = CompiledRenderGraph{};
+
+    for (const auto p : cullPasses(_compiled.culledPasses))
+    {
+        _compiled.passes.emplace_back(CompiledRenderGraph::Pass{.pass = p});
+    }
+    for (const auto p : _compiled.culledPasses)
+    {
+        log(Level::Info, "RenderGraph: pass ", _passes[p].name, " culled");
+    }
+    placeTransients(memoryRequirements);
+
+    // 1st walk: the state the graph leaves the resources in, the starting state of the next execution
+    const auto lastStates = computeBarriers(initialStates({}));
+    std::vector<std::optional<ResourceState>> carriedOver(_resources.size());
+    for (RenderGraphResource r = 0; r < _resources.size(); ++r)
+    {
+        if (_resources[r].imported && !_resources[r].initial.has_value())
+        {
+            carriedOver[r] = lastStates[r];
+        }
+    }
+    // 2nd walk: the barriers of a steady-state frame
+    computeBarriers(initialStates(carriedOver));
+    _isCompiled = true;
+
+    log(Level::Info, "RenderGraph: ", _compiled.passes.size(), " passes (", _compiled.culledPasses.size(), " culled), ",
+        _compiled.barrierCount(), " barriers in ", _compiled.barrierBatchCount(), " batches, transient memory ",
+        _compiled.transientBytes(), " bytes (", _compiled.transientBytesWithoutAliasing(), " without aliasing)");
+    return _compiled;
+}
+
+void RenderGraph::realize(VkContext &ctx)
+{
+    ZoneScopedN("RenderGraph: realize");
+    const auto logicalDevice = ctx.getLogicDevice();
+    if (!_isCompiled)
+    {
+        compile([this, logicalDevice](RenderGraphResource r)
+                {
+            // vk1.3: the requirements without creating the resource
+            VkMemoryRequirements2 requirements{.sType = VK_STRUCTURE_TYPE_MEMORY_REQUIREMENTS_2};
+            const auto &resource = _resources[r];
+            if (resource.type == ResourceType::IMAGE)
+            {
+                const auto createInfo = imageCreateInfo(resource.imageDesc);
+                const VkDeviceImageMemoryRequirements info{
+                    .sType = VK_STRUCTURE_TYPE_DEVICE_IMAGE_MEMORY_REQUIREMENTS,
+                    .pCreateInfo = &createInfo,
+                };
+                vkGetDeviceImageMemoryRequirements(logicalDevice, &info, &requirements);
+            }
+            else
+            {
+                const auto createInfo = bufferCreateInfo(resource.bufferDesc);
+                const VkDeviceBufferMemoryRequirements info{
+                    .sType = VK_STRUCTURE_TYPE_DEVICE_BUFFER_MEMORY_REQUIREMENTS,
+                    .pCreateInfo = &createInfo,
+                };
+                vkGetDeviceBufferMemoryRequirements(logicalDevice, &info, &requirements);
+            }
+            return requirements.memoryRequirements; });
+    }
+    release();
+    _ctx = &ctx;
+
+    const auto vmaAllocator = ctx.getVmaAllocator();
+    for (size_t i = 0; i < _compiled.heaps.size(); ++i)
+    {
+        const auto &heap = _compiled.heaps[i];
+        const VkMemoryRequirements requirements{
+            .size = heap.size,
+            .alignment = heap.alignment,
+            .memoryTypeBits = heap.memoryTypeBits,
+        };
+        const VmaAllocationCreateInfo allocCreateInfo{
+            .preferredFlags = VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT,
+        };
+        VmaAllocation allocation{VK_NULL_HANDLE};
+        VK_CHECK(vmaAllocateMemory(vmaAllocator, &requirements, &allocCreateInfo, &allocation, nullptr));
+        vmaSetAllocationName(vmaAllocator, allocation, ("render graph heap " + std::to_string(i)).c_str());
+        _heapAllocations.push_back(allocation);
+    }
+
+    for (RenderGraphResource r = 0; r < _resources.size(); ++r)
+    {
+        auto &resource = _resources[r];
+        const auto &placement = _compiled.placements[r];
+        if (resource.imported || !placement.has_value())
+        {
+            continue;
+        }
+        const auto heapAllocation = _heapAllocations[placement->heap];
+        if (resource.type == ResourceType::IMAGE)
+        {
+            const auto createInfo = imageCreateInfo(resource.imageDesc);
+            VK_CHECK(vmaCreateAliasingImage2(vmaAllocator, heapAllocation, placement->offset, &createInfo, &resource.image));
+            const VkImageViewCreateInfo viewCreateInfo{
+                .sType = VK_STRUCTURE_TYPE_IMAGE_VIEW_CREATE_INFO,
+                .image = resource.image,
+                .viewType = getImageViewType(createInfo.imageType),
+                .format = createInfo.format,
+                .subresourceRange = resource.range,
+            };
+            VK_CHECK(vkCreateImageView(logicalDevice, &viewCreateInfo, nullptr, &resource.imageView));
+            setCorrlationId(resource.image, logicalDevice, VK_OBJECT_TYPE_IMAGE, "render graph: " + resource.name);
+        }
+        else
+        {
+            const auto createInfo = bufferCreateInfo(resource.bufferDesc);
+            VK_CHECK(vmaCreateAliasingBuffer2(vmaAllocator, heapAllocation, placement->offset, &createInfo, &resource.buffer));
+            setCorrlationId(resource.buffer, logicalDevice, VK_OBJECT_TYPE_BUFFER, "render graph: " + resource.name);
+        }
+    }
+}
+
+void RenderGraph::release()
+{
+    if (!_ctx)
+    {
+        return;
+    }
+    const auto logicalDevice = _ctx->getLogicDevice();
+    for (auto &resource : _resources)
+    {
+        if (resource.imported)
+        {
+            continue;
+        }
+        if (resource.imageView)
+        {
+            vkDestroyImageView(logicalDevice, resource.imageView, nullptr);
+        }
+        if (resource.image)
+        {
+            vkDestroyImage(logicalDevice, resource.image, nullptr);
+        }
+        if (resource.buffer)
+        {
+            vkDestroyBuffer(logicalDevice, resource.buffer, nullptr);
+        }
+        resource.image = VK_NULL_HANDLE;
+        resource.imageView = VK_NULL_HANDLE;
+        resource.buffer = VK_NULL_HANDLE;
+    }
+    for (const auto allocation : _heapAllocations)
+    {
+        vmaFreeMemory(_ctx->getVmaAllocator(), allocation);
+    }
+    _heapAllocations.clear();
+    _ctx = nullptr;
+}
+
+void RenderGraph::recordBarriers(VkCommandBuffer cmd, const std::vector<RenderGraphBarrier> &barriers) const
+{
+    std::vector<VkImageMemoryBarrier2> imageBarriers;
+    // global: cheaper than one VkBufferMemoryBarrier2 per buffer, the drivers ignore the ranges anyway
+    VkMemoryBarrier2 memoryBarrier{.sType = VK_STRUCTURE_TYPE_MEMORY_BARRIER_2};
+    for (const auto &barrier : barriers)
+    {
+        const auto &resource = _resources[barrier.resource];
+        if (barrier.image)
+        {
+            ASSERT(resource.image, "the image of the render graph should be realized");
+            imageBarriers.emplace_back(VkImageMemoryBarrier2{
+                .sType = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER_2,
+                .srcStageMask = barrier.srcStages,
+                .srcAccessMask = barrier.srcAccess,
+                .dstStageMask = barrier.dstStages,
+                .dstAccessMask = barrier.dstAccess,
+                .oldLayout = barrier.oldLayout,
+                .newLayout = barrier.newLayout,
+                .srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED,
+                .dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED,
+                .image = resource.image,
+                .subresourceRange = resource.range,
+            });
+        }
+        else
+        {
+            memoryBarrier.srcStageMask |= barrier.srcStages;
+            memoryBarrier.srcAccessMask |= barrier.srcAccess;
+            memoryBarrier.dstStageMask |= barrier.dstStages;
+            memoryBarrier.dstAccessMask |= barrier.dstAccess;
+        }
+    }
+    const bool hasMemoryBarrier = memoryBarrier.srcStageMask != VK_PIPELINE_STAGE_2_NONE ||
+                                  memoryBarrier.dstStageMask != VK_PIPELINE_STAGE_2_NONE;
+    const VkDependencyInfo dependencyInfo{
+        .sType = VK_STRUCTURE_TYPE_DEPENDENCY_INFO,
+        .memoryBarrierCount = hasMemoryBarrier ? 1u : 0u,
+        .pMemoryBarriers = &memoryBarrier,
+        .imageMemoryBarrierCount = static_cast<uint32_t>(imageBarriers.size()),
+        .pImageMemoryBarriers = imageBarriers.data(),
+    };
+    vkCmdPipelineBarrier2(cmd, &dependencyInfo);
+}
+
+void RenderGraph::execute(CommandBufferEntity &cmd, int frameIndex)
+{
+    ZoneScopedN("RenderGraph: execute");
+    ASSERT(_isCompiled, "execute:: compile() or realize() the render graph first");
+    ASSERT(_compiled.heaps.empty() || _ctx, "execute:: realize() the transient resources first");
+    const auto cmdBufferHandle = std::get<COMMAND_BUFFER_ENTITY_OFFSET::COMMAND_BUFFER>(cmd);
+    for (const auto &compiledPass : _compiled.passes)
+    {
+        if (!compiledPass.barriers.empty())
+        {
+            recordBarriers(cmdBufferHandle, compiledPass.barriers);
+        }
+        _passes[compiledPass.pass].record(*this, cmd, frameIndex);
+    }
+    if (!_compiled.finalBarriers.empty())
+    {
+        recordBarriers(cmdBufferHandle, _compiled.finalBarriers);
+    }
+}
+
+void RenderGraph::updateImportedImage(RenderGraphResource resource, VkImage image, VkImageView imageView)
+{
+    ASSERT(resource < _resources.size() && _resources[resource].imported &&
+               _resources[resource].type == ResourceType::IMAGE,
+           "updateImportedImage:: not an imported image");
+    _resources[resource].image = image;
+    _resources[resource].imageView = imageView;
+}
+
+void RenderGraph::updateImportedBuffer(RenderGraphResource resource, VkBuffer buffer)
+{
+    ASSERT(resource < _resources.size() && _resources[resource].imported &&
+               _resources[resource].type == ResourceType::BUFFER,
+           "updateImportedBuffer:: not an imported buffer");
+    _resources[resource].buffer = buffer;
+}
+
+VkImage RenderGraph::image(RenderGraphResource resource) const
+{
+    ASSERT(resource < _resources.size() && _resources[resource].type == ResourceType::IMAGE, "image:: not an image");
+    return _resources[resource].image;
+}
+
+VkImageView RenderGraph::imageView(RenderGraphResource resource) const
+{
+    ASSERT(resource < _resources.size() && _resources[resource].type == ResourceType::IMAGE, "imageView:: not an image");
+    return _resources[resource].imageView;
+}
+
+VkBuffer RenderGraph::buffer(RenderGraphResource resource) const
+{
+    ASSERT(resource < _resources.size() && _resources[resource].type == ResourceType::BUFFER, "buffer:: not a buffer");
+    return _resources[resource].buffer;
+}
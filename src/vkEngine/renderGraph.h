@@ -0,0 +1,284 @@
+#pragma once
+
+#include <functional>
+#include <optional>
+#include <string>
+#include <vector>
+#include <cstdint>
+
+#include <renderPassBase.h>
+
+// handle of a resource declared on a RenderGraph
+using RenderGraphResource = uint32_t;
+static constexpr RenderGraphResource INVALID_RENDER_GRAPH_RESOURCE = UINT32_MAX;
+
+// how a pass touches a resource, sync2 flags
+// layout: images only, the layout the pass expects
+struct RenderGraphAccess
+{
+    VkPipelineStageFlags2 stages{VK_PIPELINE_STAGE_2_NONE};
+    VkAccessFlags2 access{VK_ACCESS_2_NONE};
+    VkImageLayout layout{VK_IMAGE_LAYOUT_UNDEFINED};
+};
+
+// the usual ones
+inline constexpr RenderGraphAccess COMPUTE_SHADER_READ_ACCESS{
+    VK_PIPELINE_STAGE_2_COMPUTE_SHADER_BIT, VK_ACCESS_2_SHADER_STORAGE_READ_BIT, VK_IMAGE_LAYOUT_GENERAL};
+inline constexpr RenderGraphAccess COMPUTE_SHADER_WRITE_ACCESS{
+    VK_PIPELINE_STAGE_2_COMPUTE_SHADER_BIT, VK_ACCESS_2_SHADER_STORAGE_WRITE_BIT, VK_IMAGE_LAYOUT_GENERAL};
+inline constexpr RenderGraphAccess INDIRECT_COMMAND_READ_ACCESS{
+    VK_PIPELINE_STAGE_2_DRAW_INDIRECT_BIT, VK_ACCESS_2_INDIRECT_COMMAND_READ_BIT};
+inline constexpr RenderGraphAccess VERTEX_SHADER_READ_ACCESS{
+    VK_PIPELINE_STAGE_2_VERTEX_SHADER_BIT, VK_ACCESS_2_SHADER_STORAGE_READ_BIT};
+inline constexpr RenderGraphAccess FRAGMENT_SHADER_SAMPLED_ACCESS{
+    VK_PIPELINE_STAGE_2_FRAGMENT_SHADER_BIT, VK_ACCESS_2_SHADER_SAMPLED_READ_BIT, VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL};
+inline constexpr RenderGraphAccess COLOR_ATTACHMENT_WRITE_ACCESS{
+    VK_PIPELINE_STAGE_2_COLOR_ATTACHMENT_OUTPUT_BIT, VK_ACCESS_2_COLOR_ATTACHMENT_WRITE_BIT, VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL};
+inline constexpr RenderGraphAccess DEPTH_ATTACHMENT_WRITE_ACCESS{
+    VK_PIPELINE_STAGE_2_EARLY_FRAGMENT_TESTS_BIT | VK_PIPELINE_STAGE_2_LATE_FRAGMENT_TESTS_BIT,
+    VK_ACCESS_2_DEPTH_STENCIL_ATTACHMENT_READ_BIT | VK_ACCESS_2_DEPTH_STENCIL_ATTACHMENT_WRITE_BIT,
+    VK_IMAGE_LAYOUT_DEPTH_ATTACHMENT_OPTIMAL};
+inline constexpr RenderGraphAccess RAY_TRACING_STORAGE_WRITE_ACCESS{
+    VK_PIPELINE_STAGE_2_RAY_TRACING_SHADER_BIT_KHR, VK_ACCESS_2_SHADER_STORAGE_WRITE_BIT, VK_IMAGE_LAYOUT_GENERAL};
+inline constexpr RenderGraphAccess TRANSFER_READ_ACCESS{
+    VK_PIPELINE_STAGE_2_TRANSFER_BIT, VK_ACCESS_2_TRANSFER_READ_BIT, VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL};
+inline constexpr RenderGraphAccess TRANSFER_WRITE_ACCESS{
+    VK_PIPELINE_STAGE_2_TRANSFER_BIT, VK_ACCESS_2_TRANSFER_WRITE_BIT, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL};
+
+// transient resources, created (and aliased) by the graph
+struct RenderGraphImageDesc
+{
+    VkFormat format{VK_FORMAT_UNDEFINED};
+    VkExtent3D extent{0, 0, 1};
+    VkImageUsageFlags usage{0};
+    uint32_t mipLevels{1};
+    VkImageAspectFlags aspect{VK_IMAGE_ASPECT_COLOR_BIT};
+};
+
+struct RenderGraphBufferDesc
+{
+    VkDeviceSize size{0};
+    VkBufferUsageFlags usage{0};
+};
+
+// one image barrier, or one share of the memory barrier of the batch (buffers)
+struct RenderGraphBarrier
+{
+    RenderGraphResource resource{INVALID_RENDER_GRAPH_RESOURCE};
+    bool image{false};
+    VkPipelineStageFlags2 srcStages{VK_PIPELINE_STAGE_2_NONE};
+    VkAccessFlags2 srcAccess{VK_ACCESS_2_NONE};
+    VkPipelineStageFlags2 dstStages{VK_PIPELINE_STAGE_2_NONE};
+    VkAccessFlags2 dstAccess{VK_ACCESS_2_NONE};
+    VkImageLayout oldLayout{VK_IMAGE_LAYOUT_UNDEFINED};
+    VkImageLayout newLayout{VK_IMAGE_LAYOUT_UNDEFINED};
+};
+
+// the output of RenderGraph::compile(), no vulkan object involved
+struct CompiledRenderGraph
+{
+    struct Pass
+    {
+        uint32_t pass{0};
+        // one vkCmdPipelineBarrier2 ahead of the pass, none if empty
+        std::vector<RenderGraphBarrier> barriers;
+    };
+
+    // transient memory shared by the resources whose lifetimes do not overlap
+    struct Heap
+    {
+        VkDeviceSize size{0};
+        VkDeviceSize alignment{1};
+        uint32_t memoryTypeBits{~0u};
+    };
+
+    struct Placement
+    {
+        uint32_t heap{0};
+        VkDeviceSize offset{0};
+        VkDeviceSize size{0};
+        // indices of the alive passes, inclusive
+        uint32_t firstUse{0};
+        uint32_t lastUse{0};
+    };
+
+    // alive passes in declaration order
+    std::vector<Pass> passes;
+    std::vector<uint32_t> culledPasses;
+    // imported images back to their final layout, after the last pass
+    std::vector<RenderGraphBarrier> finalBarriers;
+    std::vector<Heap> heaps;
+    // per resource, transient and used only
+    std::vector<std::optional<Placement>> placements;
+
+    // vkCmdPipelineBarrier2 calls per execution
+    size_t barrierBatchCount() const;
+    // image barriers + one memory barrier per batch with buffers
+    size_t barrierCount() const;
+    VkDeviceSize transientBytes() const;
+    // what the transient resources would take without aliasing
+    VkDeviceSize transientBytesWithoutAliasing() const;
+};
+
+// frame graph over RenderPassBase-like passes
+// 1. declare: import the external resources, create the transient ones, add the passes with what they
+//    read and write, mark the outputs
+// 2. compile(): pure cpu, headless-testable
+//    - passes contributing to no output (nor flagged with side effects) are culled
+//    - one barrier batch per pass at most: layout transitions, RAW/WAW/WAR, buffers merged into a
+//      single memory barrier
+//    - transient resources with disjoint lifetimes share memory (first fit per heap)
+// 3. realize(): the heaps, aliasing images/buffers and views (vma)
+// 4. execute() every frame, the imported handles may change in between (swapchain images)
+// imported resources without an initial access start each execution in the state the previous one
+// left them: frames in flight on the same queue are synchronized too
+// render thread only
+class RenderGraph
+{
+public:
+    using RecordFn = std::function<void(RenderGraph &graph, CommandBufferEntity &cmd, int frameIndex)>;
+    using MemoryRequirementsFn = std::function<VkMemoryRequirements(RenderGraphResource resource)>;
+
+    class PassBuilder
+    {
+    public:
+        PassBuilder &read(RenderGraphResource resource, const RenderGraphAccess &access);
+        PassBuilder &write(RenderGraphResource resource, const RenderGraphAccess &access);
+        // never culled: presents, readbacks, anything the graph does not see
+        PassBuilder &sideEffects();
+
+    private:
+        friend class RenderGraph;
+        PassBuilder(RenderGraph &graph, uint32_t pass) : _graph(graph), _pass(pass) {}
+        RenderGraph &_graph;
+        const uint32_t _pass;
+    };
+
+    RenderGraph() = default;
+    ~RenderGraph();
+
+    RenderGraph(const RenderGraph &other) = delete;
+    RenderGraph &operator=(const RenderGraph &other) = delete;
+
+    // initial: the state before the first pass, std::nullopt: as left by the previous execution
+    RenderGraphResource importImage(const std::string &name, VkImage image, VkImageView imageView,
+                                    const VkImageSubresourceRange &range,
+                                    std::optional<RenderGraphAccess> initial = std::nullopt);
+    RenderGraphResource importImage(const std::string &name, const ImageEntity &image,
+                                    std::optional<RenderGraphAccess> initial = std::nullopt);
+    RenderGraphResource importBuffer(const std::string &name, VkBuffer buffer,
+                                     std::optional<RenderGraphAccess> initial = std::nullopt);
+    RenderGraphResource importBuffer(const std::string &name, const BufferEntity &buffer,
+                                     std::optional<RenderGraphAccess> initial = std::nullopt);
+    RenderGraphResource createImage(const std::string &name, const RenderGraphImageDesc &desc);
+    RenderGraphResource createBuffer(const std::string &name, const RenderGraphBufferDesc &desc);
+
+    // culling roots, finalLayout: imported images only, transitioned to after the last pass
+    void markOutput(RenderGraphResource resource, std::optional<VkImageLayout> finalLayout = std::nullopt);
+
+    PassBuilder addPass(const std::string &name, RecordFn record);
+    // pass->execute(cmd, frameIndex)
+    PassBuilder addPass(const std::string &name, RenderPassBase *pass);
+
+    // memoryRequirements: transient resources only, not called when there are none
+    const CompiledRenderGraph &compile(const MemoryRequirementsFn &memoryRequirements = {});
+    // compiles if needed, with the requirements of the device
+    void realize(VkContext &ctx);
+    // the barriers and the passes, on the command buffer being recorded
+    void execute(CommandBufferEntity &cmd, int frameIndex);
+    // destroys the transient resources, realize() again to use the graph
+    void release();
+
+    // between two executions: swapchain images, recreated resources
+    void updateImportedImage(RenderGraphResource resource, VkImage image, VkImageView imageView);
+    void updateImportedBuffer(RenderGraphResource resource, VkBuffer buffer);
+
+    // inside the RecordFns
+    VkImage image(RenderGraphResource resource) const;
+    VkImageView imageView(RenderGraphResource resource) const;
+    VkBuffer buffer(RenderGraphResource resource) const;
+
+    const std::string &passName(uint32_t pass) const
+    {
+        return _passes[pass].name;
+    }
+    const CompiledRenderGraph &compiled() const
+    {
+        return _compiled;
+    }
+
+private:
+    enum class ResourceType
+    {
+        IMAGE,
+        BUFFER,
+    };
+
+    struct Resource
+    {
+        std::string name;
+        ResourceType type{ResourceType::BUFFER};
+        bool imported{false};
+        std::optional<RenderGraphAccess> initial;
+        bool output{false};
+        std::optional<VkImageLayout> finalLayout;
+        // imported or realized
+        VkImage image{VK_NULL_HANDLE};
+        VkImageView imageView{VK_NULL_HANDLE};
+        VkImageSubresourceRange range{VK_IMAGE_ASPECT_COLOR_BIT, 0, 1, 0, 1};
+        VkBuffer buffer{VK_NULL_HANDLE};
+        // transient
+        RenderGraphImageDesc imageDesc;
+        RenderGraphBufferDesc bufferDesc;
+    };
+
+    struct ResourceUse
+    {
+        RenderGraphResource resource{INVALID_RENDER_GRAPH_RESOURCE};
+        RenderGraphAccess access;
+        bool write{false};
+    };
+
+    struct Pass
+    {
+        std::string name;
+        RecordFn record;
+        std::vector<ResourceUse> uses;
+        bool sideEffects{false};
+    };
+
+    // sync state of a resource while walking the passes
+    struct ResourceState
+    {
+        VkPipelineStageFlags2 writeStages{VK_PIPELINE_STAGE_2_NONE};
+        VkAccessFlags2 writeAccess{VK_ACCESS_2_NONE};
+        // since the last write
+        VkPipelineStageFlags2 readStages{VK_PIPELINE_STAGE_2_NONE};
+        VkAccessFlags2 readAccess{VK_ACCESS_2_NONE};
+        VkImageLayout layout{VK_IMAGE_LAYOUT_UNDEFINED};
+    };
+
+    RenderGraphResource addResource(Resource resource);
+    void addUse(uint32_t pass, RenderGraphResource resource, const RenderGraphAccess &access, bool write);
+    void invalidate();
+
+    std::vector<uint32_t> cullPasses(std::vector<uint32_t> &culled) const;
+    void placeTransients(const MemoryRequirementsFn &memoryRequirements);
+    std::vector<ResourceState> initialStates(const std::vector<std::optional<ResourceState>> &carriedOver) const;
+    // barriers of every alive pass, returns the states after the last pass and the final barriers
+    std::vector<ResourceState> computeBarriers(std::vector<ResourceState> states);
+    static std::optional<RenderGraphBarrier> transition(RenderGraphResource resource, bool isImage,
+                                                        ResourceState &state, const RenderGraphAccess &access,
+                                                        bool write);
+
+    void recordBarriers(VkCommandBuffer cmd, const std::vector<RenderGraphBarrier> &barriers) const;
+
+    std::vector<Resource> _resources;
+    std::vector<Pass> _passes;
+    bool _isCompiled{false};
+    CompiledRenderGraph _compiled;
+
+    // realized
+    VkContext *_ctx{nullptr};
+    std::vector<VmaAllocation> _heapAllocations;
+};
@@ -3,6 +3,7 @@
 #include <context.h>
 #include <scene.h>      // for scene accessor
 #include <cameraBase.h> // for camera accessor
+#include <frameAllocator.h> // for transient per-frame data
 
 class RenderPassBase
 {
@@ -18,6 +19,8 @@ protected:
     const CameraBase *_camera{nullptr};
     // descriptorset pool, every render pass needs to allocate ds from it
     VkDescriptorPool _dsPool{VK_NULL_HANDLE};
+    // per-frame constants, shared by all the passes of the frame
+    FrameAllocator *_frameAllocator{nullptr};
 };
 
 class VkContextAccessor
@@ -48,4 +51,12 @@ class DescriptorPoolAccessor
 public:
     virtual void setDescriptorPool(const VkDescriptorPool) = 0;
     virtual const VkDescriptorPool descriptorPool() const = 0;
+};
+
+// shared per-frame linear allocator
+class FrameAllocatorAccessor
+{
+public:
+    virtual void setFrameAllocator(FrameAllocator *) = 0;
+    virtual const FrameAllocator &frameAllocator() const = 0;
 };
\ No newline at end of file
@@ -0,0 +1,221 @@
+#include <cstring>
+
+#include <sbtBuilder.h>
+
+SbtBuilder::SbtBuilder(VkContext &ctx)
+    : _ctx(ctx)
+{
+}
+
+SbtBuilder::~SbtBuilder()
+{
+    const auto buffer = std::get<BUFFER_ENTITY_UID::BUFFER>(_buffer);
+    if (buffer != VK_NULL_HANDLE)
+    {
+        const auto vmaAllocator = _ctx.getVmaAllocator();
+        vmaUnmapMemory(vmaAllocator, std::get<BUFFER_ENTITY_UID::VMA_ALLOCATION>(_buffer));
+        vmaDestroyBuffer(vmaAllocator, buffer, std::get<BUFFER_ENTITY_UID::VMA_ALLOCATION>(_buffer));
+    }
+}
+
+SbtBuilder::Layout SbtBuilder::computeLayout(const VkPhysicalDeviceRayTracingPipelinePropertiesKHR &properties,
+                                             uint32_t numMissRecords,
+                                             uint32_t numHitRecords,
+                                             uint32_t missRecordDataSize,
+                                             uint32_t hitRecordDataSize)
+{
+    const VkDeviceSize handleSize = properties.shaderGroupHandleSize;
+    const VkDeviceSize handleAlignment = (std::max)(properties.shaderGroupHandleAlignment, 1u);
+    const VkDeviceSize baseAlignment = (std::max)(properties.shaderGroupBaseAlignment, 1u);
+
+    Layout layout;
+    // the raygen record is read through its stride
+    layout.raygen.stride = alignedSize(handleSize, baseAlignment);
+    layout.raygen.size = layout.raygen.stride;
+
+    layout.miss.offset = alignedSize(layout.raygen.offset + layout.raygen.size, baseAlignment);
+    layout.miss.stride = alignedSize(handleSize + missRecordDataSize, handleAlignment);
+    layout.miss.size = alignedSize(layout.miss.stride * numMissRecords, baseAlignment);
+
+    layout.hit.offset = alignedSize(layout.miss.offset + layout.miss.size, baseAlignment);
+    layout.hit.stride = alignedSize(handleSize + hitRecordDataSize, handleAlignment);
+    layout.hit.size = alignedSize(layout.hit.stride * numHitRecords, baseAlignment);
+
+    layout.sizeInBytes = layout.hit.offset + layout.hit.size;
+    ASSERT(layout.miss.stride <= properties.maxShaderGroupStride && layout.hit.stride <= properties.maxShaderGroupStride,
+           "SbtBuilder: record exceeds maxShaderGroupStride");
+    return layout;
+}
+
+uint32_t SbtBuilder::addStage(VkShaderStageFlagBits stage, VkShaderModule module)
+{
+    if (auto it = _stageIndices.find(module); it != _stageIndices.end())
+    {
+        return it->second;
+    }
+    const auto stageIndex = static_cast<uint32_t>(_stages.size());
+    _stages.push_back(VkPipelineShaderStageCreateInfo{
+        .sType = VK_STRUCTURE_TYPE_PIPELINE_SHADER_STAGE_CREATE_INFO,
+        .stage = stage,
+        .module = module,
+        .pName = "main",
+    });
+    _stageIndices.emplace(module, stageIndex);
+    return stageIndex;
+}
+
+uint32_t SbtBuilder::addRayGenGroup(VkShaderModule module)
+{
+    ASSERT(module != VK_NULL_HANDLE, "SbtBuilder: ray gen shader module should be defined");
+    _groups.push_back({.sType = VK_STRUCTURE_TYPE_RAY_TRACING_SHADER_GROUP_CREATE_INFO_KHR,
+                       .type = VK_RAY_TRACING_SHADER_GROUP_TYPE_GENERAL_KHR,
+                       .generalShader = addStage(VK_SHADER_STAGE_RAYGEN_BIT_KHR, module),
+                       .closestHitShader = VK_SHADER_UNUSED_KHR,
+                       .anyHitShader = VK_SHADER_UNUSED_KHR,
+                       .intersectionShader = VK_SHADER_UNUSED_KHR});
+    return static_cast<uint32_t>(_groups.size() - 1);
+}
+
+uint32_t SbtBuilder::addMissGroup(VkShaderModule module)
+{
+    ASSERT(module != VK_NULL_HANDLE, "SbtBuilder: ray miss shader module should be defined");
+    _groups.push_back({.sType = VK_STRUCTURE_TYPE_RAY_TRACING_SHADER_GROUP_CREATE_INFO_KHR,
+                       .type = VK_RAY_TRACING_SHADER_GROUP_TYPE_GENERAL_KHR,
+                       .generalShader = addStage(VK_SHADER_STAGE_MISS_BIT_KHR, module),
+                       .closestHitShader = VK_SHADER_UNUSED_KHR,
+                       .anyHitShader = VK_SHADER_UNUSED_KHR,
+                       .intersectionShader = VK_SHADER_UNUSED_KHR});
+    return static_cast<uint32_t>(_groups.size() - 1);
+}
+
+uint32_t SbtBuilder::addHitGroup(VkShaderModule closestHit, VkShaderModule anyHit)
+{
+    ASSERT(closestHit != VK_NULL_HANDLE, "SbtBuilder: ray closest hit shader module should be defined");
+    _groups.push_back({.sType = VK_STRUCTURE_TYPE_RAY_TRACING_SHADER_GROUP_CREATE_INFO_KHR,
+                       .type = VK_RAY_TRACING_SHADER_GROUP_TYPE_TRIANGLES_HIT_GROUP_KHR,
+                       .generalShader = VK_SHADER_UNUSED_KHR,
+                       .closestHitShader = addStage(VK_SHADER_STAGE_CLOSEST_HIT_BIT_KHR, closestHit),
+                       .anyHitShader = anyHit != VK_NULL_HANDLE ? addStage(VK_SHADER_STAGE_ANY_HIT_BIT_KHR, anyHit)
+                                                                : VK_SHADER_UNUSED_KHR,
+                       .intersectionShader = VK_SHADER_UNUSED_KHR});
+    return static_cast<uint32_t>(_groups.size() - 1);
+}
+
+std::tuple<VkPipeline, VkPipelineLayout, std::vector<VkRayTracingShaderGroupCreateInfoKHR>> SbtBuilder::createPipeline(
+    const std::vector<VkDescriptorSetLayout> &dsLayouts,
+    const std::vector<VkPushConstantRange> &pushConstants,
+    uint32_t maxRecursionDepth)
+{
+    ASSERT(_pipeline == VK_NULL_HANDLE, "SbtBuilder: one pipeline per builder");
+    const auto logicalDevice = _ctx.getLogicDevice();
+    const VkPipelineLayoutCreateInfo pipelineLayoutInfo{
+        .sType = VK_STRUCTURE_TYPE_PIPELINE_LAYOUT_CREATE_INFO,
+        .setLayoutCount = static_cast<uint32_t>(dsLayouts.size()),
+        .pSetLayouts = dsLayouts.data(),
+        .pushConstantRangeCount = static_cast<uint32_t>(pushConstants.size()),
+        .pPushConstantRanges = pushConstants.data(),
+    };
+    VkPipelineLayout pipelineLayout{VK_NULL_HANDLE};
+    VK_CHECK(vkCreatePipelineLayout(logicalDevice, &pipelineLayoutInfo, nullptr, &pipelineLayout));
+
+    const VkRayTracingPipelineCreateInfoKHR rayTracingPipelineCI{
+        .sType = VK_STRUCTURE_TYPE_RAY_TRACING_PIPELINE_CREATE_INFO_KHR,
+        .stageCount = static_cast<uint32_t>(_stages.size()),
+        .pStages = _stages.data(),
+        .groupCount = static_cast<uint32_t>(_groups.size()),
+        .pGroups = _groups.data(),
+        .maxPipelineRayRecursionDepth = maxRecursionDepth,
+        .layout = pipelineLayout,
+    };
+    VK_CHECK(vkCreateRayTracingPipelinesKHR(logicalDevice, VK_NULL_HANDLE, VK_NULL_HANDLE, 1, &rayTracingPipelineCI, nullptr, &_pipeline));
+    return std::make_tuple(_pipeline, pipelineLayout, _groups);
+}
+
+void SbtBuilder::setRayGenRecord(uint32_t groupIndex)
+{
+    ASSERT(groupIndex < _groups.size(), "SbtBuilder: unknown group");
+    _raygenRecord = Record{.groupIndex = groupIndex};
+}
+
+void SbtBuilder::addMissRecord(uint32_t groupIndex)
+{
+    ASSERT(groupIndex < _groups.size(), "SbtBuilder: unknown group");
+    _missRecords.push_back(Record{.groupIndex = groupIndex});
+}
+
+uint32_t SbtBuilder::addHitRecord(uint32_t groupIndex, const void *data, uint32_t sizeInBytes)
+{
+    ASSERT(groupIndex < _groups.size() && _groups[groupIndex].type != VK_RAY_TRACING_SHADER_GROUP_TYPE_GENERAL_KHR,
+           "SbtBuilder: hit records need a hit group");
+    const auto *bytes = static_cast<const uint8_t *>(data);
+    _hitRecords.push_back(Record{.groupIndex = groupIndex, .data = std::vector<uint8_t>(bytes, bytes + sizeInBytes)});
+    _hitRecordDataSize = (std::max)(_hitRecordDataSize, sizeInBytes);
+    return static_cast<uint32_t>(_hitRecords.size() - 1);
+}
+
+VkStridedDeviceAddressRegionKHR SbtBuilder::toDeviceRegion(const Region &region, VkDeviceAddress base) const
+{
+    if (region.size == 0)
+    {
+        return {};
+    }
+    return {
+        .deviceAddress = base + region.offset,
+        .stride = region.stride,
+        .size = region.size,
+    };
+}
+
+void SbtBuilder::build()
+{
+    ASSERT(_pipeline != VK_NULL_HANDLE, "SbtBuilder: createPipeline() first");
+    ASSERT(_raygenRecord, "SbtBuilder: a ray gen record is required");
+    ASSERT(std::get<BUFFER_ENTITY_UID::BUFFER>(_buffer) == VK_NULL_HANDLE, "SbtBuilder: built once");
+    const auto &properties = _ctx.getSelectedPhysicalDeviceRayTracingProperties();
+    const uint32_t handleSize = properties.shaderGroupHandleSize;
+    const VkDeviceSize baseAlignment = (std::max)(properties.shaderGroupBaseAlignment, 1u);
+
+    _layout = computeLayout(properties,
+                            static_cast<uint32_t>(_missRecords.size()),
+                            static_cast<uint32_t>(_hitRecords.size()),
+                            0,
+                            _hitRecordDataSize);
+
+    // handles are tightly packed by the driver
+    const auto numGroups = static_cast<uint32_t>(_groups.size());
+    std::vector<uint8_t> handles(static_cast<size_t>(numGroups) * handleSize);
+    VK_CHECK(vkGetRayTracingShaderGroupHandlesKHR(_ctx.getLogicDevice(), _pipeline, 0, numGroups, handles.size(), handles.data()));
+
+    // vma only aligns the allocation to the buffer requirements: room to align the base by hand
+    const auto sizeInBytes = _layout.sizeInBytes + baseAlignment;
+    _buffer = std::get<0>(_ctx.createShaderBindTableBuffer("Shader Binding Table", sizeInBytes, sizeInBytes, 0, true));
+    const auto bufferAddress = std::get<BUFFER_ENTITY_UID::DEVICE_HOST_ADDRESS>(_buffer).deviceAddress;
+    const auto baseAddress = alignedSize(bufferAddress, baseAlignment);
+    auto *base = static_cast<uint8_t *>(std::get<BUFFER_ENTITY_UID::MAPPING_ADDRESS>(_buffer)) + (baseAddress - bufferAddress);
+    std::memset(base, 0, _layout.sizeInBytes);
+
+    const auto writeRecord = [&](const Record &record, const Region &region, size_t recordIndex)
+    {
+        auto *dst = base + region.offset + region.stride * recordIndex;
+        std::memcpy(dst, handles.data() + static_cast<size_t>(record.groupIndex) * handleSize, handleSize);
+        if (!record.data.empty())
+        {
+            std::memcpy(dst + handleSize, record.data.data(), record.data.size());
+        }
+    };
+    writeRecord(*_raygenRecord, _layout.raygen, 0);
+    for (size_t i = 0; i < _missRecords.size(); ++i)
+    {
+        writeRecord(_missRecords[i], _layout.miss, i);
+    }
+    for (size_t i = 0; i < _hitRecords.size(); ++i)
+    {
+        writeRecord(_hitRecords[i], _layout.hit, i);
+    }
+
+    _raygenRegion = toDeviceRegion(_layout.raygen, baseAddress);
+    _missRegion = toDeviceRegion(_layout.miss, baseAddress);
+    _hitRegion = toDeviceRegion(_layout.hit, baseAddress);
+    log(Level::Info, "SbtBuilder: ", numGroups, " group(s), ", _missRecords.size(), " miss / ", _hitRecords.size(),
+        " hit record(s), hit stride ", _layout.hit.stride, ", ", _layout.sizeInBytes, " bytes");
+}
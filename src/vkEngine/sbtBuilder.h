@@ -0,0 +1,122 @@
+#pragma once
+
+#include <vector>
+#include <tuple>
+#include <optional>
+#include <unordered_map>
+#include <cstdint>
+
+#include <context.h>
+
+// shader groups of a ray tracing pipeline and the shader binding table over them
+// 1. add*Group(): one group per raygen / miss shader, one hit group per material class
+//    (closest hit only, or closest hit + any hit), then createPipeline()
+// 2. set/add*Record(): the records, each one a group handle followed by inline data (shaderRecordEXT),
+//    a hit record is indexed by instanceShaderBindingTableRecordOffset
+// 3. build(): one mapped buffer, regions laid out by computeLayout()
+class SbtBuilder
+{
+public:
+    // offset from the start of the table
+    struct Region
+    {
+        VkDeviceSize offset{0};
+        VkDeviceSize stride{0};
+        VkDeviceSize size{0};
+    };
+
+    struct Layout
+    {
+        Region raygen;
+        Region miss;
+        Region hit;
+        VkDeviceSize sizeInBytes{0};
+    };
+
+    SbtBuilder() = delete;
+    explicit SbtBuilder(VkContext &ctx);
+    ~SbtBuilder();
+
+    SbtBuilder(const SbtBuilder &other) = delete;
+    SbtBuilder &operator=(const SbtBuilder &other) = delete;
+
+    // device independent, only the properties are read:
+    // stride of a record = handle + inline data aligned to shaderGroupHandleAlignment,
+    // every region starts at shaderGroupBaseAlignment, the raygen region is one record (size == stride)
+    static Layout computeLayout(const VkPhysicalDeviceRayTracingPipelinePropertiesKHR &properties,
+                                uint32_t numMissRecords,
+                                uint32_t numHitRecords,
+                                uint32_t missRecordDataSize,
+                                uint32_t hitRecordDataSize);
+
+    // group index
+    uint32_t addRayGenGroup(VkShaderModule module);
+    uint32_t addMissGroup(VkShaderModule module);
+    // anyHit: VK_NULL_HANDLE for the opaque groups
+    uint32_t addHitGroup(VkShaderModule closestHit, VkShaderModule anyHit);
+
+    std::tuple<VkPipeline, VkPipelineLayout, std::vector<VkRayTracingShaderGroupCreateInfoKHR>> createPipeline(
+        const std::vector<VkDescriptorSetLayout> &dsLayouts,
+        const std::vector<VkPushConstantRange> &pushConstants,
+        uint32_t maxRecursionDepth = 1);
+
+    void setRayGenRecord(uint32_t groupIndex);
+    void addMissRecord(uint32_t groupIndex);
+    // record index, the data is copied
+    uint32_t addHitRecord(uint32_t groupIndex, const void *data, uint32_t sizeInBytes);
+
+    // once, after createPipeline()
+    void build();
+
+    // vkCmdTraceRaysKHR
+    const VkStridedDeviceAddressRegionKHR &raygenRegion() const
+    {
+        return _raygenRegion;
+    }
+    const VkStridedDeviceAddressRegionKHR &missRegion() const
+    {
+        return _missRegion;
+    }
+    const VkStridedDeviceAddressRegionKHR &hitRegion() const
+    {
+        return _hitRegion;
+    }
+    // no callable shaders
+    const VkStridedDeviceAddressRegionKHR &callableRegion() const
+    {
+        return _callableRegion;
+    }
+    const Layout &layout() const
+    {
+        return _layout;
+    }
+
+private:
+    struct Record
+    {
+        uint32_t groupIndex{0};
+        std::vector<uint8_t> data;
+    };
+
+    uint32_t addStage(VkShaderStageFlagBits stage, VkShaderModule module);
+    VkStridedDeviceAddressRegionKHR toDeviceRegion(const Region &region, VkDeviceAddress base) const;
+
+    VkContext &_ctx;
+    std::vector<VkPipelineShaderStageCreateInfo> _stages;
+    // a module shared by several groups is one stage
+    std::unordered_map<VkShaderModule, uint32_t> _stageIndices;
+    std::vector<VkRayTracingShaderGroupCreateInfoKHR> _groups;
+    VkPipeline _pipeline{VK_NULL_HANDLE};
+
+    std::optional<Record> _raygenRecord;
+    std::vector<Record> _missRecords;
+    std::vector<Record> _hitRecords;
+    uint32_t _hitRecordDataSize{0};
+
+    Layout _layout;
+    BufferEntity _buffer{};
+    VkStridedDeviceAddressRegionKHR _raygenRegion{};
+    VkStridedDeviceAddressRegionKHR _missRegion{};
+    VkStridedDeviceAddressRegionKHR _hitRegion{};
+    VkStridedDeviceAddressRegionKHR _callableRegion{};
+};
@@ -89,17 +89,27 @@ struct BoundingBox
     glm::vec4 extents;
 };
 
+// vertices in mesh space, shared by all the instances of the mesh
 struct Mesh
 {
     std::vector<Vertex> vertices{};
     std::vector<uint32_t> indices{};
     int32_t materialIdx{-1};
+    // mesh space
     glm::vec3 minAABB{(std::numeric_limits<float>::max)(), (std::numeric_limits<float>::max)(), (std::numeric_limits<float>::max)()};
     glm::vec3 maxAABB{-(std::numeric_limits<float>::max)(), -(std::numeric_limits<float>::max)(), -(std::numeric_limits<float>::max)()};
+    // world space, around all the instances: the bounds of the mesh's draw
     glm::vec3 extents;
     glm::vec3 center;
 };
 
+// one placement of a mesh: a node of the scene graph, parent transforms included
+struct MeshInstance
+{
+    uint32_t meshId{0};
+    glm::mat4 transform{1.0f};
+};
+
 // https://github.com/KhronosGroup/glTF/blob/2.0/specification/2.0/schema/material.schema.json
 // struct Material : glTFChildOfRootProperty
 // struct PBRMetallicRoughness : glTFProperty
@@ -109,7 +119,14 @@ struct Material
     int basecolorTextureId{-1};
     int basecolorSamplerId{-1};
     int metallicRoughnessTextureId{-1};
+    // alphaMode MASK: alpha < alphaCutoff is discarded. 0: opaque (OPAQUE and BLEND), never discards
+    float alphaCutoff{0.0f};
     glm::vec4 basecolor;
+
+    bool isAlphaTested() const
+    {
+        return alphaCutoff > 0.0f;
+    }
 };
 
 #include <ktx.h>
@@ -178,6 +195,9 @@ struct Scene
     std::vector<Mesh> meshes;
     std::vector<Material> materials;
     std::vector<std::unique_ptr<Texture>> textures;
+    // grouped by mesh: the instances of indirectDraw[i] are [firstInstance, firstInstance + instanceCount)
+    std::vector<MeshInstance> instances;
+    // one per mesh
     std::vector<IndirectDrawDef1> indirectDraw;
     uint32_t totalVerticesByteSize{0};
     uint32_t totalIndexByteSize{0};
@@ -0,0 +1,314 @@
+#include <filesystem>
+#include <fstream>
+#include <sstream>
+#include <algorithm>
+
+#ifdef __linux__
+#include <sys/inotify.h>
+#include <poll.h>
+#include <unistd.h>
+#endif
+
+#include <tracy/Tracy.hpp>
+
+#include <shaderHotReload.h>
+
+ShaderHotReload::ShaderHotReload(VkDevice logicalDevice)
+    : _logicalDevice(logicalDevice)
+{
+    startWatcher();
+}
+
+ShaderHotReload::~ShaderHotReload()
+{
+    stopWatcher();
+}
+
+VkShaderModule ShaderHotReload::watch(const std::string &filePath,
+                                      const std::string &entryPoint,
+                                      const std::string &correlationId,
+                                      ReloadCallback onReload)
+{
+    const auto stagePath = normalizePath(filePath);
+    std::map<std::string, std::set<std::string>> includeGraph;
+    auto spirv = compileGlslToSpirv(stagePath, entryPoint, includeGraph);
+    ASSERT(!spirv.empty(), "initial shader compile must succeed");
+
+    WatchedStage stage{
+        .filePath = stagePath,
+        .entryPoint = entryPoint,
+        .correlationId = correlationId,
+        .onReload = onReload,
+        .dependencies = collectDependencies(stagePath, includeGraph),
+    };
+    stage.sourceHash = hashSources(stage.dependencies);
+
+    for (const auto &dependency : stage.dependencies)
+    {
+        watchDirectoryOf(dependency);
+    }
+
+    {
+        std::lock_guard<std::mutex> lock(_mutex);
+        _spirvCache[stage.sourceHash] = std::make_tuple(spirv, stage.dependencies);
+        _stages[stagePath] = std::move(stage);
+    }
+    log(Level::Info, "ShaderHotReload: watching ", stagePath);
+    return createShaderModule(_logicalDevice, spirv, correlationId);
+}
+
+size_t ShaderHotReload::applyPendingReloads()
+{
+    std::unordered_map<std::string, std::vector<char>> pending;
+    {
+        std::lock_guard<std::mutex> lock(_mutex);
+        if (_pendingSpirv.empty())
+        {
+            return 0;
+        }
+        pending.swap(_pendingSpirv);
+    }
+
+    ZoneScopedN("ShaderHotReload: apply");
+    size_t swapped = 0;
+    for (const auto &[stagePath, spirv] : pending)
+    {
+        ReloadCallback onReload;
+        std::string correlationId;
+        {
+            std::lock_guard<std::mutex> lock(_mutex);
+            const auto &stage = _stages.at(stagePath);
+            onReload = stage.onReload;
+            correlationId = stage.correlationId;
+        }
+        onReload(createShaderModule(_logicalDevice, spirv, correlationId));
+        ++swapped;
+        log(Level::Info, "ShaderHotReload: swapped ", stagePath);
+    }
+    return swapped;
+}
+
+void ShaderHotReload::onFileModified(const std::string &filePath)
+{
+    // snapshot the affected stages, glslang runs without holding the lock
+    std::vector<WatchedStage> affected;
+    {
+        std::lock_guard<std::mutex> lock(_mutex);
+        for (const auto &[stagePath, stage] : _stages)
+        {
+            if (stage.dependencies.contains(filePath))
+            {
+                affected.push_back(stage);
+            }
+        }
+    }
+    for (auto &stage : affected)
+    {
+        recompile(stage);
+    }
+}
+
+void ShaderHotReload::recompile(WatchedStage &stage)
+{
+    ZoneScopedN("ShaderHotReload: recompile");
+    const auto sourceHash = hashSources(stage.dependencies);
+    if (sourceHash == stage.sourceHash)
+    {
+        // touched but not changed
+        return;
+    }
+
+    std::vector<char> spirv;
+    std::set<std::string> dependencies = stage.dependencies;
+    {
+        std::lock_guard<std::mutex> lock(_mutex);
+        if (auto it = _spirvCache.find(sourceHash); it != _spirvCache.end())
+        {
+            std::tie(spirv, dependencies) = it->second;
+        }
+    }
+
+    if (spirv.empty())
+    {
+        std::map<std::string, std::set<std::string>> includeGraph;
+        spirv = compileGlslToSpirv(stage.filePath, stage.entryPoint, includeGraph);
+        if (spirv.empty())
+        {
+            // keep running with the last good pipeline
+            log(Level::Error, "ShaderHotReload: failed to recompile ", stage.filePath);
+            return;
+        }
+        // includes may have been added or removed by the edit
+        dependencies = collectDependencies(stage.filePath, includeGraph);
+        for (const auto &dependency : dependencies)
+        {
+            watchDirectoryOf(dependency);
+        }
+    }
+    else
+    {
+        log(Level::Info, "ShaderHotReload: spirv cache hit ", stage.filePath);
+    }
+
+    std::lock_guard<std::mutex> lock(_mutex);
+    auto &watched = _stages.at(stage.filePath);
+    watched.dependencies = dependencies;
+    watched.sourceHash = hashSources(dependencies);
+    _spirvCache[watched.sourceHash] = std::make_tuple(spirv, dependencies);
+    _pendingSpirv[stage.filePath] = std::move(spirv);
+}
+
+std::string ShaderHotReload::normalizePath(const std::string &filePath)
+{
+    auto path = std::filesystem::path(filePath);
+    std::error_code ec;
+    const auto canonical = std::filesystem::weakly_canonical(path, ec);
+    auto res = (ec ? path.lexically_normal() : canonical).string();
+    std::replace(res.begin(), res.end(), '\\', '/');
+    return res;
+}
+
+std::set<std::string> ShaderHotReload::collectDependencies(const std::string &root,
+                                                           const std::map<std::string, std::set<std::string>> &includeGraph)
+{
+    // graph keys are whatever the includer saw, normalize before walking
+    std::map<std::string, std::set<std::string>> graph;
+    for (const auto &[includer, headers] : includeGraph)
+    {
+        auto &edges = graph[normalizePath(includer)];
+        for (const auto &header : headers)
+        {
+            edges.insert(normalizePath(header));
+        }
+    }
+
+    std::set<std::string> res{root};
+    std::vector<std::string> toVisit{root};
+    while (!toVisit.empty())
+    {
+        const auto curr = toVisit.back();
+        toVisit.pop_back();
+        if (auto it = graph.find(curr); it != graph.end())
+        {
+            for (const auto &header : it->second)
+            {
+                if (res.insert(header).second)
+                {
+                    toVisit.push_back(header);
+                }
+            }
+        }
+    }
+    return res;
+}
+
+size_t ShaderHotReload::hashSources(const std::set<std::string> &files)
+{
+    std::string combined;
+    for (const auto &file : files)
+    {
+        std::ifstream in(file, std::ios::binary);
+        std::stringstream ss;
+        ss << in.rdbuf();
+        combined += file;
+        combined += ss.str();
+    }
+    return std::hash<std::string>{}(combined);
+}
+
+#ifdef __linux__
+void ShaderHotReload::startWatcher()
+{
+    _inotifyFd = inotify_init1(IN_NONBLOCK | IN_CLOEXEC);
+    if (_inotifyFd < 0)
+    {
+        log(Level::Warn, "ShaderHotReload: inotify_init1 failed, hot-reload disabled");
+        return;
+    }
+
+    _watcherThread = std::jthread([this](std::stop_token stopToken)
+                                  {
+        // editors emit a burst of events per save, collect them before recompiling
+        constexpr int POLL_TIMEOUT_MS = 100;
+        alignas(inotify_event) char buffer[4096];
+        std::set<std::string> modified;
+        while (!stopToken.stop_requested())
+        {
+            pollfd pfd{.fd = _inotifyFd, .events = POLLIN};
+            const int ready = poll(&pfd, 1, POLL_TIMEOUT_MS);
+            if (ready > 0)
+            {
+                ssize_t len = 0;
+                while ((len = read(_inotifyFd, buffer, sizeof(buffer))) > 0)
+                {
+                    for (char *ptr = buffer; ptr < buffer + len;)
+                    {
+                        const auto *event = reinterpret_cast<const inotify_event *>(ptr);
+                        if (event->len > 0)
+                        {
+                            std::lock_guard<std::mutex> lock(_mutex);
+                            if (auto it = _watchDescriptors.find(event->wd); it != _watchDescriptors.end())
+                            {
+                                modified.insert(it->second + "/" + event->name);
+                            }
+                        }
+                        ptr += sizeof(inotify_event) + event->len;
+                    }
+                }
+                continue;
+            }
+            // quiet for one poll period: flush
+            for (const auto &filePath : modified)
+            {
+                onFileModified(normalizePath(filePath));
+            }
+            modified.clear();
+        } });
+}
+
+void ShaderHotReload::stopWatcher()
+{
+    if (_watcherThread.joinable())
+    {
+        _watcherThread.request_stop();
+        _watcherThread.join();
+    }
+    if (_inotifyFd >= 0)
+    {
+        close(_inotifyFd);
+        _inotifyFd = -1;
+    }
+}
+
+void ShaderHotReload::watchDirectoryOf(const std::string &filePath)
+{
+    if (_inotifyFd < 0)
+    {
+        return;
+    }
+    const auto dir = std::filesystem::path(filePath).parent_path().string();
+    // IN_MOVED_TO: editors writing a temp file then renaming it over the original
+    const int wd = inotify_add_watch(_inotifyFd, dir.c_str(), IN_CLOSE_WRITE | IN_MOVED_TO);
+    if (wd < 0)
+    {
+        log(Level::Warn, "ShaderHotReload: cannot watch ", dir);
+        return;
+    }
+    // adding the same directory twice returns the same wd
+    std::lock_guard<std::mutex> lock(_mutex);
+    _watchDescriptors[wd] = dir;
+}
+#else
+void ShaderHotReload::startWatcher()
+{
+    log(Level::Warn, "ShaderHotReload: file watching is only implemented with inotify (linux)");
+}
+
+void ShaderHotReload::stopWatcher()
+{
+}
+
+void ShaderHotReload::watchDirectoryOf(const std::string &filePath)
+{
+}
+#endif
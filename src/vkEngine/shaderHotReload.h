@@ -0,0 +1,82 @@
+#pragma once
+
+#include <string>
+#include <vector>
+#include <map>
+#include <set>
+#include <unordered_map>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <tuple>
+
+#include <misc.h>
+
+// Shader hot-reload
+// 1. every watched stage is compiled once through DirStackFileIncluder, which records the include graph
+// 2. inotify watches the directories of the stages and all their headers (linux only)
+// 3. a background thread recompiles only the stages whose include closure contains the modified file
+//    spirv is cached by source hash, saving a file without a real change does not recompile
+// 4. the render thread calls applyPendingReloads() at the frame boundary, new modules are created there
+//    and handed to the owner, who swaps its pipelines in one go
+class ShaderHotReload
+{
+public:
+    // the owner takes the ownership of the new shader module (and has to destroy the old one)
+    using ReloadCallback = std::function<void(VkShaderModule)>;
+
+    ShaderHotReload() = delete;
+    explicit ShaderHotReload(VkDevice logicalDevice);
+    ~ShaderHotReload();
+
+    // compile the glsl stage and start tracking it and its includes
+    // returns the initial shader module, the owner destroys it
+    VkShaderModule watch(const std::string &filePath,
+                         const std::string &entryPoint,
+                         const std::string &correlationId,
+                         ReloadCallback onReload);
+
+    // call on the render thread between two frames
+    // all stages recompiled since the last call are swapped together, so a vert/frag pair which
+    // share a header never ends up half-updated
+    // returns number of stages swapped
+    size_t applyPendingReloads();
+
+private:
+    struct WatchedStage
+    {
+        std::string filePath;
+        std::string entryPoint;
+        std::string correlationId;
+        ReloadCallback onReload;
+        // transitive closure: stage itself + all the headers it includes
+        std::set<std::string> dependencies;
+        size_t sourceHash{0};
+    };
+
+    void startWatcher();
+    void stopWatcher();
+    void watchDirectoryOf(const std::string &filePath);
+    void onFileModified(const std::string &filePath);
+    void recompile(WatchedStage &stage);
+
+    static std::string normalizePath(const std::string &filePath);
+    static std::set<std::string> collectDependencies(const std::string &root,
+                                                     const std::map<std::string, std::set<std::string>> &includeGraph);
+    static size_t hashSources(const std::set<std::string> &files);
+
+    VkDevice _logicalDevice{VK_NULL_HANDLE};
+
+    // guards _stages, _spirvCache and _pendingSpirv
+    std::mutex _mutex;
+    std::unordered_map<std::string, WatchedStage> _stages;
+    // source hash -> (spirv, include closure), reverting an edit does not hit glslang again
+    std::unordered_map<size_t, std::tuple<std::vector<char>, std::set<std::string>>> _spirvCache;
+    // stage path -> freshly compiled spirv waiting for the frame boundary
+    std::unordered_map<std::string, std::vector<char>> _pendingSpirv;
+
+    // inotify
+    int _inotifyFd{-1};
+    std::unordered_map<int, std::string> _watchDescriptors;
+    std::jthread _watcherThread;
+};
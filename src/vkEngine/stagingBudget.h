@@ -0,0 +1,65 @@
+#pragma once
+
+#include <mutex>
+#include <condition_variable>
+#include <stop_token>
+#include <cstddef>
+
+// byte budget for host-visible staging memory used by in-flight uploads
+// the producer reserves before queueing an upload, the worker releases once the staging buffer is freed
+// acquire blocks (backpressure) while the budget is exhausted
+class StagingBudget
+{
+public:
+    StagingBudget() = delete;
+    explicit StagingBudget(size_t budgetInBytes) : _budgetInBytes(budgetInBytes)
+    {
+    }
+
+    StagingBudget(const StagingBudget &other) = delete;
+    StagingBudget &operator=(const StagingBudget &other) = delete;
+
+    // a single request larger than the whole budget goes through once nothing else is in flight
+    // returns false if stop is requested while waiting, nothing is reserved then
+    bool acquire(size_t bytes, std::stop_token stopToken)
+    {
+        std::unique_lock lock{_mux};
+        const bool granted = _cv.wait(lock, stopToken, [this, bytes]()
+                                      { return _inflightBytes == 0 || _inflightBytes + bytes <= _budgetInBytes; });
+        if (!granted)
+        {
+            return false;
+        }
+        _inflightBytes += bytes;
+        return true;
+    }
+
+    void release(size_t bytes)
+    {
+        {
+            std::scoped_lock lock{_mux};
+            _inflightBytes -= bytes;
+        }
+        _cv.notify_all();
+    }
+
+    // block until every reservation is released
+    void waitIdle()
+    {
+        std::unique_lock lock{_mux};
+        _cv.wait(lock, [this]()
+                 { return _inflightBytes == 0; });
+    }
+
+    size_t inflightBytes() const
+    {
+        std::scoped_lock lock{_mux};
+        return _inflightBytes;
+    }
+
+private:
+    const size_t _budgetInBytes;
+    size_t _inflightBytes{0};
+    mutable std::mutex _mux;
+    std::condition_variable_any _cv;
+};
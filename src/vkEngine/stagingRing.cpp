@@ -0,0 +1,194 @@
+#include <tracy/Tracy.hpp>
+
+#include <stagingRing.h>
+
+StagingRing::StagingRing(VkDevice logicalDevice, VmaAllocator vmaAllocator, VkDeviceSize capacity)
+    : _logicalDevice(logicalDevice), _vmaAllocator(vmaAllocator), _capacity(capacity)
+{
+    _ringBuffer = createBuffer(capacity);
+    _ringMappedData = static_cast<uint8_t *>(std::get<BUFFER_ENTITY_UID::VMA_ALLOCATION_INFO>(_ringBuffer).pMappedData);
+    ASSERT(_ringMappedData, "staging ring must be persistently mapped");
+    log(Level::Info, "StagingRing: ", capacity, " bytes");
+}
+
+StagingRing::~StagingRing()
+{
+    // the owner waited for the device to be idle
+    for (const auto &slot : _slots)
+    {
+        if (slot.dedicated.has_value())
+        {
+            destroyBuffer(*slot.dedicated);
+        }
+    }
+    destroyBuffer(_ringBuffer);
+}
+
+BufferEntity StagingRing::createBuffer(VkDeviceSize sizeInBytes)
+{
+    VkBuffer buffer{VK_NULL_HANDLE};
+    VmaAllocation allocation{VK_NULL_HANDLE};
+    VmaAllocationInfo allocationInfo;
+    const VkBufferCreateInfo bufferCreateInfo{
+        .sType = VK_STRUCTURE_TYPE_BUFFER_CREATE_INFO,
+        .size = sizeInBytes,
+        .usage = VK_BUFFER_USAGE_TRANSFER_SRC_BIT,
+        .sharingMode = VK_SHARING_MODE_EXCLUSIVE,
+    };
+    // same memory as createStagingBuffer, mapped once for its whole lifetime
+    const VmaAllocationCreateInfo bufferMemoryAllocationCreateInfo = {
+        .flags = VMA_ALLOCATION_CREATE_HOST_ACCESS_SEQUENTIAL_WRITE_BIT |
+                 VMA_ALLOCATION_CREATE_MAPPED_BIT,
+        .usage = VMA_MEMORY_USAGE_AUTO_PREFER_HOST,
+        .requiredFlags = VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT |
+                         VK_MEMORY_PROPERTY_HOST_COHERENT_BIT,
+    };
+    VK_CHECK(vmaCreateBuffer(_vmaAllocator, &bufferCreateInfo,
+                             &bufferMemoryAllocationCreateInfo,
+                             &buffer,
+                             &allocation, &allocationInfo));
+    return std::make_tuple(buffer, allocation, allocationInfo, nullptr, sizeInBytes, VkDeviceOrHostAddressConstKHR{}, nullptr);
+}
+
+void StagingRing::destroyBuffer(const BufferEntity &buffer)
+{
+    vmaDestroyBuffer(_vmaAllocator,
+                     std::get<BUFFER_ENTITY_UID::BUFFER>(buffer),
+                     std::get<BUFFER_ENTITY_UID::VMA_ALLOCATION>(buffer));
+}
+
+bool StagingRing::isDone(const Completion &completion) const
+{
+    if (completion.fence != VK_NULL_HANDLE)
+    {
+        return vkGetFenceStatus(_logicalDevice, completion.fence) == VK_SUCCESS;
+    }
+    uint64_t value = 0;
+    VK_CHECK(vkGetSemaphoreCounterValue(_logicalDevice, completion.timeline, &value));
+    return value >= completion.value;
+}
+
+void StagingRing::waitFor(const Completion &completion) const
+{
+    ZoneScopedN("StagingRing: wait");
+    if (completion.fence != VK_NULL_HANDLE)
+    {
+        VK_CHECK(vkWaitForFences(_logicalDevice, 1, &completion.fence, VK_TRUE, UINT64_MAX));
+        return;
+    }
+    const VkSemaphoreWaitInfo waitInfo{
+        .sType = VK_STRUCTURE_TYPE_SEMAPHORE_WAIT_INFO,
+        .semaphoreCount = 1,
+        .pSemaphores = &completion.timeline,
+        .pValues = &completion.value,
+    };
+    VK_CHECK(vkWaitSemaphores(_logicalDevice, &waitInfo, UINT64_MAX));
+}
+
+StagingRegion StagingRing::allocateDedicatedLocked(VkDeviceSize sizeInBytes)
+{
+    auto buffer = createBuffer(sizeInBytes);
+    auto *mappedData = std::get<BUFFER_ENTITY_UID::VMA_ALLOCATION_INFO>(buffer).pMappedData;
+    // does not move _head, reclaimed in order with the ring slots
+    _slots.push_back(Slot{_nextId, _head, std::nullopt, buffer});
+    ++_dedicatedCount;
+    return StagingRegion{buffer, 0, sizeInBytes, mappedData, _nextId++};
+}
+
+StagingRegion StagingRing::allocate(VkDeviceSize sizeInBytes, VkDeviceSize alignment)
+{
+    ASSERT(alignment > 0 && (alignment & (alignment - 1)) == 0, "alignment must be a power of two");
+    ASSERT(_capacity % alignment == 0, "the ring capacity must be a multiple of the alignment");
+    std::unique_lock lock{_mux};
+    if (sizeInBytes > _capacity)
+    {
+        return allocateDedicatedLocked(sizeInBytes);
+    }
+    while (true)
+    {
+        reclaimLocked();
+        uint64_t offset = (_head + alignment - 1) & ~(alignment - 1);
+        const uint64_t ringOffset = offset % _capacity;
+        if (ringOffset + sizeInBytes > _capacity)
+        {
+            // never straddle the end: skip to the start of the ring, the padding goes with this slot
+            offset += _capacity - ringOffset;
+        }
+        if (offset + sizeInBytes - _tail <= _capacity)
+        {
+            _head = offset + sizeInBytes;
+            _slots.push_back(Slot{_nextId, _head, std::nullopt, std::nullopt});
+            TracyPlot("StagingRing used", static_cast<int64_t>(_head - _tail));
+            return StagingRegion{_ringBuffer,
+                                 offset % _capacity,
+                                 sizeInBytes,
+                                 _ringMappedData + offset % _capacity,
+                                 _nextId++};
+        }
+        if (_slots.empty() || !_slots.front().completion.has_value())
+        {
+            // the oldest region is still being filled/recorded
+            return allocateDedicatedLocked(sizeInBytes);
+        }
+        // full: wait for the oldest submission outside the lock
+        const auto completion = *_slots.front().completion;
+        lock.unlock();
+        waitFor(completion);
+        lock.lock();
+    }
+}
+
+void StagingRing::retire(const StagingRegion &region, VkFence fence)
+{
+    retire(region, Completion{.fence = fence});
+}
+
+void StagingRing::retire(const StagingRegion &region, VkSemaphore timeline, uint64_t value)
+{
+    retire(region, Completion{.timeline = timeline, .value = value});
+}
+
+void StagingRing::retire(const StagingRegion &region, Completion completion)
+{
+    std::scoped_lock lock{_mux};
+    ASSERT(!_slots.empty() && region.id >= _slots.front().id, "staging region already reclaimed");
+    auto &slot = _slots[region.id - _slots.front().id];
+    ASSERT(slot.id == region.id, "staging ring slots out of order");
+    ASSERT(!slot.completion.has_value(), "staging region retired twice");
+    slot.completion = completion;
+}
+
+size_t StagingRing::reclaim()
+{
+    std::scoped_lock lock{_mux};
+    return reclaimLocked();
+}
+
+size_t StagingRing::reclaimLocked()
+{
+    size_t count = 0;
+    while (!_slots.empty() && _slots.front().completion.has_value() && isDone(*_slots.front().completion))
+    {
+        auto &slot = _slots.front();
+        if (slot.dedicated.has_value())
+        {
+            destroyBuffer(*slot.dedicated);
+        }
+        _tail = slot.end;
+        _slots.pop_front();
+        ++count;
+    }
+    return count;
+}
+
+VkDeviceSize StagingRing::usedBytes() const
+{
+    std::scoped_lock lock{_mux};
+    return _head - _tail;
+}
+
+uint64_t StagingRing::dedicatedCount() const
+{
+    std::scoped_lock lock{_mux};
+    return _dedicatedCount;
+}
@@ -0,0 +1,99 @@
+#pragma once
+
+#include <deque>
+#include <mutex>
+#include <optional>
+#include <cstdint>
+
+#include <context.h>
+
+// one upload region handed out by StagingRing, already mapped
+// the copies read from buffer at offset: copyBuffer(region.buffer, dst, cmd, size, region.offset, ...)
+struct StagingRegion
+{
+    BufferEntity buffer;
+    VkDeviceSize offset{0};
+    VkDeviceSize size{0};
+    // already offset
+    void *mappedData{nullptr};
+    uint64_t id{0};
+};
+
+// sub-allocates upload memory out of one persistently mapped, host-coherent staging buffer
+// 1. allocate(): [offset, offset + size) of the ring, memcpy into mappedData and record the copies
+// 2. retire(): ties the region to the submission reading it, a fence or a timeline semaphore value
+// 3. regions go back to the ring in allocation order once their submission is done,
+//    a region retired late holds back the ones allocated after it
+// a full ring waits for the oldest retired region. a request larger than the ring, or made while the
+// oldest region is not retired yet (possibly by the caller itself), gets a dedicated buffer instead:
+// allocate() never deadlocks its own caller
+// fences are the ones of the command buffers, reused only after BeginRecordCommandBuffer waited them:
+// signaled means this submission or a later one is done
+// thread-safe
+class StagingRing
+{
+public:
+    static constexpr VkDeviceSize DEFAULT_ALIGNMENT = 16;
+
+    StagingRing() = delete;
+    StagingRing(VkDevice logicalDevice, VmaAllocator vmaAllocator, VkDeviceSize capacity);
+    ~StagingRing();
+
+    StagingRing(const StagingRing &other) = delete;
+    StagingRing &operator=(const StagingRing &other) = delete;
+
+    // alignment: power of two
+    StagingRegion allocate(VkDeviceSize sizeInBytes, VkDeviceSize alignment = DEFAULT_ALIGNMENT);
+    void retire(const StagingRegion &region, VkFence fence);
+    void retire(const StagingRegion &region, VkSemaphore timeline, uint64_t value);
+    // give back the regions whose submission is done, returns how many
+    size_t reclaim();
+
+    VkDeviceSize capacity() const
+    {
+        return _capacity;
+    }
+    VkDeviceSize usedBytes() const;
+    // allocations which did not fit in the ring so far
+    uint64_t dedicatedCount() const;
+
+private:
+    struct Completion
+    {
+        VkFence fence{VK_NULL_HANDLE};
+        VkSemaphore timeline{VK_NULL_HANDLE};
+        uint64_t value{0};
+    };
+
+    struct Slot
+    {
+        uint64_t id;
+        // _head once this slot was allocated, _tail moves there when it is reclaimed
+        uint64_t end;
+        std::optional<Completion> completion;
+        std::optional<BufferEntity> dedicated;
+    };
+
+    BufferEntity createBuffer(VkDeviceSize sizeInBytes);
+    void destroyBuffer(const BufferEntity &buffer);
+    bool isDone(const Completion &completion) const;
+    void waitFor(const Completion &completion) const;
+    void retire(const StagingRegion &region, Completion completion);
+    size_t reclaimLocked();
+    StagingRegion allocateDedicatedLocked(VkDeviceSize sizeInBytes);
+
+    VkDevice _logicalDevice{VK_NULL_HANDLE};
+    VmaAllocator _vmaAllocator{VK_NULL_HANDLE};
+    VkDeviceSize _capacity{0};
+    BufferEntity _ringBuffer;
+    uint8_t *_ringMappedData{nullptr};
+
+    mutable std::mutex _mux;
+    // monotonic byte counters, the offset in the ring is counter % _capacity
+    uint64_t _head{0};
+    uint64_t _tail{0};
+    uint64_t _nextId{0};
+    uint64_t _dedicatedCount{0};
+    // allocation order, ids are consecutive
+    std::deque<Slot> _slots;
+};
@@ -0,0 +1,426 @@
+#include <algorithm>
+#include <cstring>
+
+#include <tracy/Tracy.hpp>
+
+#include <streamingGeometry.h>
+
+// vkCmdCopyBuffer has no alignment requirement, 16 keeps the simd / cuda writes aligned
+static constexpr VkDeviceSize UPLOAD_ALIGNMENT = 16;
+
+void StreamingGeometry::Update::reset()
+{
+    _head = 0;
+    for (auto &ranges : _ranges)
+    {
+        ranges.clear();
+    }
+    _draws.reset();
+    _numDraws = 0;
+}
+
+std::optional<VkDeviceSize> StreamingGeometry::Update::reserve(GEOMETRY_STREAM stream, VkDeviceSize dstOffset, VkDeviceSize sizeInBytes)
+{
+    ASSERT(dstOffset + sizeInBytes <= _capacityInBytes[stream], "StreamingGeometry::reserve: range out of the stream");
+    const auto srcOffset = alignedSize(_head, UPLOAD_ALIGNMENT);
+    if (srcOffset + sizeInBytes > _sizeInBytes)
+    {
+        return std::nullopt;
+    }
+    _head = srcOffset + sizeInBytes;
+    _ranges[stream].push_back(Range{srcOffset, dstOffset, sizeInBytes});
+    return srcOffset;
+}
+
+void *StreamingGeometry::Update::write(GEOMETRY_STREAM stream, VkDeviceSize dstOffset, VkDeviceSize sizeInBytes)
+{
+    ASSERT(_mappedData, "StreamingGeometry::write: exported upload buffers have no host address, reserve() instead");
+    const auto srcOffset = reserve(stream, dstOffset, sizeInBytes);
+    return srcOffset ? _mappedData + *srcOffset : nullptr;
+}
+
+bool StreamingGeometry::Update::setDraws(const std::vector<IndirectDrawDef1> &draws)
+{
+    ASSERT(draws.size() <= _maxDraws, "StreamingGeometry::setDraws: more draws than Config::maxDraws");
+    ASSERT(_mappedData, "StreamingGeometry::setDraws: exported upload buffers have no host address");
+    const VkDeviceSize sizeInBytes = sizeof(IndirectDrawDef1) * draws.size();
+    const auto srcOffset = alignedSize(_head, UPLOAD_ALIGNMENT);
+    if (srcOffset + sizeInBytes > _sizeInBytes)
+    {
+        return false;
+    }
+    _head = srcOffset + sizeInBytes;
+    memcpy(_mappedData + srcOffset, draws.data(), sizeInBytes);
+    _draws = Range{srcOffset, 0, sizeInBytes};
+    _numDraws = static_cast<uint32_t>(draws.size());
+    return true;
+}
+
+StreamingGeometry::StreamingGeometry(VkContext &ctx, const Config &config)
+    : _ctx(ctx), _config(config), _numSlots(ctx.getFramesInFlight())
+{
+    constexpr std::array<VkBufferUsageFlags, GEOMETRY_STREAM_SIZE> streamUsages{
+        VK_BUFFER_USAGE_VERTEX_BUFFER_BIT,
+        VK_BUFFER_USAGE_INDEX_BUFFER_BIT,
+    };
+    constexpr std::array<const char *, GEOMETRY_STREAM_SIZE> streamNames{"vertices", "indices"};
+    // the slots, draw and upload buffers are scene-sized: the default heaps, the category pools cannot
+    // hold anything bigger than one of their blocks
+    for (int stream = 0; stream < GEOMETRY_STREAM_SIZE; ++stream)
+    {
+        _staleRanges[stream].resize(_numSlots);
+        if (_config.capacityInBytes[stream] == 0)
+        {
+            continue;
+        }
+        for (uint32_t slot = 0; slot < _numSlots; ++slot)
+        {
+            // storage: vertex pulling, src: the catch-up copies of the other slots
+            _slots[stream].push_back(_ctx.createDeviceLocalBuffer(
+                std::format("Streaming {} slot {}", streamNames[stream], slot),
+                _config.capacityInBytes[stream],
+                streamUsages[stream] |
+                    VK_BUFFER_USAGE_STORAGE_BUFFER_BIT |
+                    VK_BUFFER_USAGE_SHADER_DEVICE_ADDRESS_BIT |
+                    VK_BUFFER_USAGE_TRANSFER_SRC_BIT |
+                    VK_BUFFER_USAGE_TRANSFER_DST_BIT,
+                GENERIC_MEMORY));
+        }
+    }
+    if (_config.maxDraws > 0)
+    {
+        for (size_t i = 0; i < _drawBuffers.size(); ++i)
+        {
+            _drawBuffers[i] = _ctx.createDeviceLocalBuffer(
+                "Streaming draws " + std::to_string(i),
+                sizeof(IndirectDrawDef1) * _config.maxDraws,
+                VK_BUFFER_USAGE_INDIRECT_BUFFER_BIT |
+                    VK_BUFFER_USAGE_STORAGE_BUFFER_BIT |
+                    VK_BUFFER_USAGE_TRANSFER_DST_BIT,
+                GENERIC_MEMORY);
+        }
+    }
+
+    const auto numUploadBuffers = _config.numUploadBuffers > 0 ? _config.numUploadBuffers : _numSlots + 2;
+    for (uint32_t i = 0; i < numUploadBuffers; ++i)
+    {
+        auto update = std::make_unique<Update>();
+        const auto name = "Streaming upload " + std::to_string(i);
+        update->_uploadBuffer = _config.exportableUploadBuffers
+                                    ? _ctx.createExportableBuffer(name,
+                                                                  _config.uploadBufferSizeInBytes,
+                                                                  VK_BUFFER_USAGE_TRANSFER_SRC_BIT | VK_BUFFER_USAGE_STORAGE_BUFFER_BIT,
+                                                                  VK_SHARING_MODE_EXCLUSIVE)
+                                    : _ctx.createStagingBuffer(name, _config.uploadBufferSizeInBytes, GENERIC_MEMORY);
+        // staging buffers are persistently mapped and coherent
+        update->_mappedData = _config.exportableUploadBuffers
+                                  ? nullptr
+                                  : static_cast<uint8_t *>(std::get<BUFFER_ENTITY_UID::VMA_ALLOCATION_INFO>(update->_uploadBuffer).pMappedData);
+        update->_sizeInBytes = _config.uploadBufferSizeInBytes;
+        update->_capacityInBytes = _config.capacityInBytes;
+        update->_maxDraws = _config.maxDraws;
+        _freeUpdates.push_back(update.get());
+        _updates.push_back(std::move(update));
+    }
+    _inFlightUpdates.resize(_numSlots);
+    log(Level::Info, "StreamingGeometry: ", _numSlots, " slots, ", numUploadBuffers, " x ",
+        _config.uploadBufferSizeInBytes, " bytes upload buffers, exported: ", _config.exportableUploadBuffers);
+}
+
+StreamingGeometry::~StreamingGeometry()
+{
+    const auto stats = this->stats();
+    log(Level::Info, "StreamingGeometry: ", stats.updatesApplied, " updates applied, ", stats.updatesRejected,
+        " rejected, ", stats.bytesUploaded, " bytes uploaded, ", stats.bytesCaughtUp, " bytes caught up");
+    const auto vmaAllocator = _ctx.getVmaAllocator();
+    const auto destroyBuffer = [vmaAllocator](const BufferEntity &buffer)
+    {
+        vmaDestroyBuffer(vmaAllocator,
+                         std::get<BUFFER_ENTITY_UID::BUFFER>(buffer),
+                         std::get<BUFFER_ENTITY_UID::VMA_ALLOCATION>(buffer));
+    };
+    for (const auto &slots : _slots)
+    {
+        std::for_each(slots.begin(), slots.end(), destroyBuffer);
+    }
+    if (_config.maxDraws > 0)
+    {
+        std::for_each(_drawBuffers.begin(), _drawBuffers.end(), destroyBuffer);
+    }
+    for (const auto &update : _updates)
+    {
+        destroyBuffer(update->_uploadBuffer);
+    }
+}
+
+StreamingGeometry::Update *StreamingGeometry::beginUpdate()
+{
+    std::scoped_lock lock{_mutex};
+    if (_freeUpdates.empty())
+    {
+        _updatesRejected.fetch_add(1, std::memory_order_relaxed);
+        return nullptr;
+    }
+    auto *update = _freeUpdates.back();
+    _freeUpdates.pop_back();
+    return update;
+}
+
+void StreamingGeometry::endUpdate(Update *update)
+{
+    ASSERT(update, "StreamingGeometry::endUpdate: no update");
+    std::scoped_lock lock{_mutex};
+    _publishedUpdates.push_back(update);
+}
+
+StreamingGeometry::Stats StreamingGeometry::stats() const
+{
+    auto stats = _stats;
+    stats.updatesRejected = _updatesRejected.load(std::memory_order_relaxed);
+    return stats;
+}
+
+void StreamingGeometry::mergeRanges(std::vector<StaleRange> &ranges)
+{
+    if (ranges.size() < 2)
+    {
+        return;
+    }
+    std::sort(ranges.begin(), ranges.end(), [](const StaleRange &a, const StaleRange &b)
+              { return a.offset < b.offset; });
+    size_t last = 0;
+    for (size_t i = 1; i < ranges.size(); ++i)
+    {
+        auto &merged = ranges[last];
+        const auto mergedEnd = merged.offset + merged.size;
+        if (ranges[i].offset <= mergedEnd)
+        {
+            merged.size = (std::max)(mergedEnd, ranges[i].offset + ranges[i].size) - merged.offset;
+        }
+        else
+        {
+            ranges[++last] = ranges[i];
+        }
+    }
+    ranges.resize(last + 1);
+}
+
+void StreamingGeometry::subtractRanges(std::vector<StaleRange> &ranges, const std::vector<StaleRange> &covered)
+{
+    if (ranges.empty() || covered.empty())
+    {
+        return;
+    }
+    std::vector<StaleRange> res;
+    size_t c = 0;
+    for (const auto &range : ranges)
+    {
+        auto offset = range.offset;
+        const auto end = range.offset + range.size;
+        // the covered ranges ending before this one cannot overlap the next ones either
+        while (c < covered.size() && covered[c].offset + covered[c].size <= offset)
+        {
+            ++c;
+        }
+        for (size_t i = c; i < covered.size() && covered[i].offset < end; ++i)
+        {
+            if (covered[i].offset > offset)
+            {
+                res.push_back(StaleRange{offset, covered[i].offset - offset});
+            }
+            offset = (std::max)(offset, covered[i].offset + covered[i].size);
+        }
+        if (offset < end)
+        {
+            res.push_back(StaleRange{offset, end - offset});
+        }
+    }
+    ranges.swap(res);
+}
+
+void StreamingGeometry::copyBarrier(VkCommandBuffer commandBuffer, VkPipelineStageFlags2 srcStageMask, VkAccessFlags2 srcAccessMask) const
+{
+    const VkMemoryBarrier2 barrier{
+        .sType = VK_STRUCTURE_TYPE_MEMORY_BARRIER_2,
+        .srcStageMask = srcStageMask,
+        .srcAccessMask = srcAccessMask,
+        .dstStageMask = VK_PIPELINE_STAGE_2_COPY_BIT,
+        .dstAccessMask = VK_ACCESS_2_TRANSFER_READ_BIT | VK_ACCESS_2_TRANSFER_WRITE_BIT,
+    };
+    const VkDependencyInfo dependency{
+        .sType = VK_STRUCTURE_TYPE_DEPENDENCY_INFO,
+        .memoryBarrierCount = 1,
+        .pMemoryBarriers = &barrier,
+    };
+    vkCmdPipelineBarrier2(commandBuffer, &dependency);
+}
+
+void StreamingGeometry::record(CommandBufferEntity &cmdBuffer, uint32_t currentFrameId)
+{
+    ZoneScopedN("StreamingGeometry::record");
+    ASSERT(currentFrameId < _numSlots, "StreamingGeometry::record: one slot per frame in flight");
+    const auto commandBuffer = std::get<COMMAND_BUFFER_ENTITY_OFFSET::COMMAND_BUFFER>(cmdBuffer);
+    const uint32_t slot = currentFrameId;
+    ++_frameCount;
+
+    // the previous submission of this frame is done: its upload buffers are free again
+    std::vector<Update *> updates;
+    {
+        std::scoped_lock lock{_mutex};
+        for (auto *update : _inFlightUpdates[currentFrameId])
+        {
+            update->reset();
+            _freeUpdates.push_back(update);
+        }
+        _inFlightUpdates[currentFrameId].clear();
+        updates.swap(_publishedUpdates);
+    }
+
+    bool stale = false;
+    for (int stream = 0; stream < GEOMETRY_STREAM_SIZE; ++stream)
+    {
+        stale = stale || !_staleRanges[stream][slot].empty();
+    }
+    if (!stale && updates.empty())
+    {
+        _lastSlot = slot;
+        _drawBufferLastFrame[_frontDrawBuffer] = _frameCount;
+        return;
+    }
+
+    // the draw lists replace each other: the last one of the frame only
+    const Update *drawUpdate{nullptr};
+    for (const auto *update : updates)
+    {
+        drawUpdate = update->_draws ? update : drawUpdate;
+    }
+
+    // RAW: the previous slot was written by the copies of the last frame. the WAR against the frame that
+    // read this slot is done (the host waited for it), the back draw buffer may still be read by a frame in flight
+    VkPipelineStageFlags2 srcStageMask = VK_PIPELINE_STAGE_2_COPY_BIT;
+    const uint32_t backDrawBuffer = 1 - _frontDrawBuffer;
+    if (drawUpdate && _drawBufferLastFrame[backDrawBuffer] + _numSlots > _frameCount)
+    {
+        srcStageMask |= VK_PIPELINE_STAGE_2_DRAW_INDIRECT_BIT | VK_PIPELINE_STAGE_2_COMPUTE_SHADER_BIT |
+                        VK_PIPELINE_STAGE_2_VERTEX_SHADER_BIT;
+    }
+    copyBarrier(commandBuffer, srcStageMask, VK_ACCESS_2_TRANSFER_WRITE_BIT);
+
+    // 1. catch up: the ranges written into the other slots since this one was used, from the previous slot
+    // minus what this frame's updates overwrite anyway
+    std::vector<VkBufferCopy> regions;
+    std::vector<StaleRange> updatedRanges;
+    bool caughtUp = false;
+    for (int stream = 0; stream < GEOMETRY_STREAM_SIZE; ++stream)
+    {
+        auto &staleRanges = _staleRanges[stream][slot];
+        if (staleRanges.empty())
+        {
+            continue;
+        }
+        ASSERT(_lastSlot && *_lastSlot != slot, "StreamingGeometry: stale ranges come from another slot");
+        mergeRanges(staleRanges);
+        updatedRanges.clear();
+        for (const auto *update : updates)
+        {
+            for (const auto &range : update->_ranges[stream])
+            {
+                updatedRanges.push_back(StaleRange{range.dstOffset, range.size});
+            }
+        }
+        mergeRanges(updatedRanges);
+        subtractRanges(staleRanges, updatedRanges);
+        if (staleRanges.empty())
+        {
+            continue;
+        }
+        regions.clear();
+        for (const auto &range : staleRanges)
+        {
+            regions.push_back(VkBufferCopy{range.offset, range.offset, range.size});
+            _stats.bytesCaughtUp += range.size;
+        }
+        vkCmdCopyBuffer(commandBuffer,
+                        std::get<BUFFER_ENTITY_UID::BUFFER>(_slots[stream][*_lastSlot]),
+                        std::get<BUFFER_ENTITY_UID::BUFFER>(_slots[stream][slot]),
+                        static_cast<uint32_t>(regions.size()),
+                        regions.data());
+        staleRanges.clear();
+        caughtUp = true;
+    }
+
+    // 2. the updates in publication order, a later range overwrites an earlier one (WAW between the copies)
+    for (size_t i = 0; i < updates.size(); ++i)
+    {
+        const auto *update = updates[i];
+        if (caughtUp || i > 0)
+        {
+            copyBarrier(commandBuffer, VK_PIPELINE_STAGE_2_COPY_BIT, VK_ACCESS_2_TRANSFER_WRITE_BIT);
+        }
+        const auto uploadBuffer = std::get<BUFFER_ENTITY_UID::BUFFER>(update->_uploadBuffer);
+        for (int stream = 0; stream < GEOMETRY_STREAM_SIZE; ++stream)
+        {
+            const auto &ranges = update->_ranges[stream];
+            if (ranges.empty())
+            {
+                continue;
+            }
+            regions.clear();
+            for (const auto &range : ranges)
+            {
+                regions.push_back(VkBufferCopy{range.srcOffset, range.dstOffset, range.size});
+                _stats.bytesUploaded += range.size;
+                // the other slots miss the range until their next frame
+                for (uint32_t otherSlot = 0; otherSlot < _numSlots; ++otherSlot)
+                {
+                    if (otherSlot != slot)
+                    {
+                        _staleRanges[stream][otherSlot].push_back(StaleRange{range.dstOffset, range.size});
+                    }
+                }
+            }
+            vkCmdCopyBuffer(commandBuffer,
+                            uploadBuffer,
+                            std::get<BUFFER_ENTITY_UID::BUFFER>(_slots[stream][slot]),
+                            static_cast<uint32_t>(regions.size()),
+                            regions.data());
+        }
+        if (update == drawUpdate)
+        {
+            const VkBufferCopy region{drawUpdate->_draws->srcOffset, 0, drawUpdate->_draws->size};
+            vkCmdCopyBuffer(commandBuffer,
+                            uploadBuffer,
+                            std::get<BUFFER_ENTITY_UID::BUFFER>(_drawBuffers[backDrawBuffer]),
+                            1,
+                            &region);
+            _stats.bytesUploaded += region.size;
+            _frontDrawBuffer = backDrawBuffer;
+            _numDraws = drawUpdate->_numDraws;
+        }
+    }
+    _stats.updatesApplied += updates.size();
+    TracyPlot("StreamingGeometry: updates per frame", static_cast<int64_t>(updates.size()));
+
+    // the streams and the draws are read by the passes of the frame
+    const VkMemoryBarrier2 barrier{
+        .sType = VK_STRUCTURE_TYPE_MEMORY_BARRIER_2,
+        .srcStageMask = VK_PIPELINE_STAGE_2_COPY_BIT,
+        .srcAccessMask = VK_ACCESS_2_TRANSFER_WRITE_BIT,
+        .dstStageMask = VK_PIPELINE_STAGE_2_DRAW_INDIRECT_BIT | VK_PIPELINE_STAGE_2_INDEX_INPUT_BIT |
+                        VK_PIPELINE_STAGE_2_VERTEX_ATTRIBUTE_INPUT_BIT | VK_PIPELINE_STAGE_2_VERTEX_SHADER_BIT |
+                        VK_PIPELINE_STAGE_2_COMPUTE_SHADER_BIT,
+        .dstAccessMask = VK_ACCESS_2_INDIRECT_COMMAND_READ_BIT | VK_ACCESS_2_INDEX_READ_BIT |
+                         VK_ACCESS_2_VERTEX_ATTRIBUTE_READ_BIT | VK_ACCESS_2_SHADER_STORAGE_READ_BIT,
+    };
+    const VkDependencyInfo dependency{
+        .sType = VK_STRUCTURE_TYPE_DEPENDENCY_INFO,
+        .memoryBarrierCount = 1,
+        .pMemoryBarriers = &barrier,
+    };
+    vkCmdPipelineBarrier2(commandBuffer, &dependency);
+
+    _lastSlot = slot;
+    _drawBufferLastFrame[_frontDrawBuffer] = _frameCount;
+    std::scoped_lock lock{_mutex};
+    _inFlightUpdates[currentFrameId] = std::move(updates);
+}
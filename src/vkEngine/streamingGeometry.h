@@ -0,0 +1,189 @@
+#pragma once
+
+#include <array>
+#include <atomic>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <vector>
+#include <cstdint>
+
+#include <context.h>
+#include <scene.h>
+
+enum GEOMETRY_STREAM : int
+{
+    VERTEX_STREAM = 0,
+    INDEX_STREAM,
+    GEOMETRY_STREAM_SIZE
+};
+
+// time-varying geometry written by a simulation thread (cpu or cuda), drawn by the render thread
+// 1. the streams (vertices, indices) are N-buffered device local buffers, one slot per frame in flight:
+//    the frame recorded into slot s never races the frames still reading the other slots
+// 2. producer: beginUpdate() -> write()/reserve() the changed byte ranges of a stream -> endUpdate().
+//    never blocks: beginUpdate() returns nullptr when every upload buffer is queued or in flight
+// 3. record() once per frame (render thread), after BeginRecordCommandBuffer and ahead of the passes reading
+//    the streams: the ranges another slot got in the last frames are copied from the previous slot (device to
+//    device), then the published updates from their upload buffers. partial updates only move what changed
+// 4. the draws (IndirectDrawDef1) are double buffered: an update carrying a draw list replaces the whole list
+// sizing: 10M vertices (24 bytes) per frame is 240 MB per upload buffer and ~14.4 GB/s at 60 Hz. host visible
+// upload buffers are bound by pcie, Config::exportableUploadBuffers keeps the upload in vram: a cuda producer
+// writes the device memory (cudaEngine::mapVkBuffer) and the copy is device to device
+class StreamingGeometry
+{
+public:
+    struct Config
+    {
+        // 0: no buffers for the stream
+        std::array<VkDeviceSize, GEOMETRY_STREAM_SIZE> capacityInBytes{64ull * 1024 * 1024, 16ull * 1024 * 1024};
+        uint32_t maxDraws{4096};
+        // bytes one update can carry, draws included
+        VkDeviceSize uploadBufferSizeInBytes{64ull * 1024 * 1024};
+        // updates queued or in flight at most, 0: frames in flight + 2
+        uint32_t numUploadBuffers{0};
+        // device local upload buffers exported to cuda (VkContext::createExportableBuffer), no host address:
+        // reserve() instead of write()
+        bool exportableUploadBuffers{false};
+    };
+
+    struct Stats
+    {
+        uint64_t updatesApplied{0};
+        // beginUpdate() without a free upload buffer
+        uint64_t updatesRejected{0};
+        uint64_t bytesUploaded{0};
+        // slot to slot, ranges the slot missed while the other frames were recorded
+        uint64_t bytesCaughtUp{0};
+    };
+
+    // one update of the producer, filled between beginUpdate() and endUpdate() by one thread
+    class Update
+    {
+    public:
+        // host address of [dstOffset, dstOffset + sizeInBytes) of the stream, nullptr: the upload buffer is full
+        void *write(GEOMETRY_STREAM stream, VkDeviceSize dstOffset, VkDeviceSize sizeInBytes);
+        // offset in uploadBuffer() of the same range, nullopt: the upload buffer is full
+        std::optional<VkDeviceSize> reserve(GEOMETRY_STREAM stream, VkDeviceSize dstOffset, VkDeviceSize sizeInBytes);
+        // replaces the draw list, false: the upload buffer is full
+        bool setDraws(const std::vector<IndirectDrawDef1> &draws);
+
+        // EXPORT_HANDLE with Config::exportableUploadBuffers
+        const BufferEntity &uploadBuffer() const
+        {
+            return _uploadBuffer;
+        }
+
+    private:
+        friend class StreamingGeometry;
+
+        struct Range
+        {
+            VkDeviceSize srcOffset{0};
+            VkDeviceSize dstOffset{0};
+            VkDeviceSize size{0};
+        };
+
+        void reset();
+
+        BufferEntity _uploadBuffer{};
+        // nullptr when exported
+        uint8_t *_mappedData{nullptr};
+        VkDeviceSize _sizeInBytes{0};
+        std::array<VkDeviceSize, GEOMETRY_STREAM_SIZE> _capacityInBytes{};
+        uint32_t _maxDraws{0};
+        // bump pointer
+        VkDeviceSize _head{0};
+        std::array<std::vector<Range>, GEOMETRY_STREAM_SIZE> _ranges;
+        std::optional<Range> _draws;
+        uint32_t _numDraws{0};
+    };
+
+    StreamingGeometry() = delete;
+    StreamingGeometry(VkContext &ctx, const Config &config);
+    ~StreamingGeometry();
+
+    StreamingGeometry(const StreamingGeometry &other) = delete;
+    StreamingGeometry &operator=(const StreamingGeometry &other) = delete;
+
+    // producer side, thread-safe
+    Update *beginUpdate();
+    // published, applied by the next record(). a cuda producer has finished writing (stream synchronized)
+    void endUpdate(Update *update);
+
+    // render thread only, the previous submission of currentFrameId is done
+    void record(CommandBufferEntity &cmdBuffer, uint32_t currentFrameId);
+
+    // the slot of the frame, current once record() of the frame is done
+    const BufferEntity &buffer(GEOMETRY_STREAM stream, uint32_t frameId) const
+    {
+        return _slots[stream][frameId];
+    }
+    const BufferEntity &vertexBuffer(uint32_t frameId) const
+    {
+        return buffer(VERTEX_STREAM, frameId);
+    }
+    const BufferEntity &indexBuffer(uint32_t frameId) const
+    {
+        return buffer(INDEX_STREAM, frameId);
+    }
+    // front of the double buffered draws
+    const BufferEntity &drawBuffer() const
+    {
+        return _drawBuffers[_frontDrawBuffer];
+    }
+    uint32_t numDraws() const
+    {
+        return _numDraws;
+    }
+    uint32_t numSlots() const
+    {
+        return _numSlots;
+    }
+    const Config &config() const
+    {
+        return _config;
+    }
+    Stats stats() const;
+
+private:
+    // the ranges a slot missed, same offset in every slot
+    struct StaleRange
+    {
+        VkDeviceSize offset{0};
+        VkDeviceSize size{0};
+    };
+
+    // sorted, overlapping and adjacent ranges merged
+    static void mergeRanges(std::vector<StaleRange> &ranges);
+    // ranges minus covered, both merged
+    static void subtractRanges(std::vector<StaleRange> &ranges, const std::vector<StaleRange> &covered);
+    void copyBarrier(VkCommandBuffer commandBuffer, VkPipelineStageFlags2 srcStageMask, VkAccessFlags2 srcAccessMask) const;
+
+    VkContext &_ctx;
+    const Config _config;
+    const uint32_t _numSlots;
+
+    // [stream][slot]
+    std::array<std::vector<BufferEntity>, GEOMETRY_STREAM_SIZE> _slots;
+    std::array<std::vector<std::vector<StaleRange>>, GEOMETRY_STREAM_SIZE> _staleRanges;
+    std::optional<uint32_t> _lastSlot;
+
+    std::array<BufferEntity, 2> _drawBuffers{};
+    uint32_t _frontDrawBuffer{0};
+    uint32_t _numDraws{0};
+    // the last frame reading each draw buffer: the back one may still be read by the frames in flight
+    std::array<uint64_t, 2> _drawBufferLastFrame{0, 0};
+    uint64_t _frameCount{0};
+
+    std::vector<std::unique_ptr<Update>> _updates;
+    // guards the lists below, held for a few pointer moves only
+    std::mutex _mutex;
+    std::vector<Update *> _freeUpdates;
+    std::vector<Update *> _publishedUpdates;
+    // [frameId], given back once the frame comes around again
+    std::vector<std::vector<Update *>> _inFlightUpdates;
+
+    Stats _stats;
+    std::atomic<uint64_t> _updatesRejected{0};
+};
@@ -0,0 +1,234 @@
+#include <tracy/Tracy.hpp>
+
+#include <blasBuilder.h>
+#include <topLevelAS.h>
+
+static constexpr VkBuildAccelerationStructureFlagsKHR TLAS_BUILD_FLAGS =
+    VK_BUILD_ACCELERATION_STRUCTURE_PREFER_FAST_TRACE_BIT_KHR | VK_BUILD_ACCELERATION_STRUCTURE_ALLOW_UPDATE_BIT_KHR;
+
+TopLevelAS::TopLevelAS(VkContext &ctx,
+                       const std::vector<VkAccelerationStructureInstanceKHR> &instances,
+                       uint32_t numFramesInFlight,
+                       const Config &config)
+    : _ctx(ctx), _config(config), _numFramesInFlight(numFramesInFlight), _instances(instances)
+{
+    ZoneScopedN("TopLevelAS: init");
+    ASSERT(!_instances.empty(), "TopLevelAS needs at least one instance");
+    ASSERT(_numFramesInFlight > 0, "TopLevelAS needs at least one frame in flight");
+    const auto logicalDevice = _ctx.getLogicDevice();
+    const auto numInstances = static_cast<uint32_t>(_instances.size());
+    _moved.resize(numInstances, false);
+
+    // 64 bytes per instance: every slice keeps the 16 bytes alignment of the instance data
+    const VkDeviceSize sliceSizeInBytes = sizeof(VkAccelerationStructureInstanceKHR) * numInstances;
+    _instanceBuffer = _ctx.createPersistentBuffer(
+        "TLAS instances",
+        sliceSizeInBytes * _numFramesInFlight,
+        // read-only input to an acceleration structure build.
+        VK_BUFFER_USAGE_ACCELERATION_STRUCTURE_BUILD_INPUT_READ_ONLY_BIT_KHR | VK_BUFFER_USAGE_SHADER_DEVICE_ADDRESS_BIT,
+        VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT,
+        VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT);
+
+    // measure the AS build size, same step as blas process, the instance data is not read
+    const VkAccelerationStructureGeometryKHR geometry{
+        .sType = VK_STRUCTURE_TYPE_ACCELERATION_STRUCTURE_GEOMETRY_KHR,
+        .geometryType = VK_GEOMETRY_TYPE_INSTANCES_KHR,
+        .geometry = {
+            .instances = {
+                .sType = VK_STRUCTURE_TYPE_ACCELERATION_STRUCTURE_GEOMETRY_INSTANCES_DATA_KHR,
+                .arrayOfPointers = VK_FALSE,
+            },
+        },
+        .flags = VK_GEOMETRY_OPAQUE_BIT_KHR,
+    };
+    const VkAccelerationStructureBuildGeometryInfoKHR buildInfo{
+        .sType = VK_STRUCTURE_TYPE_ACCELERATION_STRUCTURE_BUILD_GEOMETRY_INFO_KHR,
+        .type = VK_ACCELERATION_STRUCTURE_TYPE_TOP_LEVEL_KHR,
+        .flags = TLAS_BUILD_FLAGS,
+        .mode = VK_BUILD_ACCELERATION_STRUCTURE_MODE_BUILD_KHR,
+        .geometryCount = 1,
+        .pGeometries = &geometry,
+    };
+    VkAccelerationStructureBuildSizesInfoKHR buildSizes{
+        .sType = VK_STRUCTURE_TYPE_ACCELERATION_STRUCTURE_BUILD_SIZES_INFO_KHR,
+    };
+    vkGetAccelerationStructureBuildSizesKHR(
+        logicalDevice,
+        VK_ACCELERATION_STRUCTURE_BUILD_TYPE_DEVICE_KHR,
+        &buildInfo,
+        &numInstances,
+        &buildSizes);
+
+    const auto tlasBuffer = _ctx.createDeviceLocalBuffer(
+        "TLAS Buffer",
+        buildSizes.accelerationStructureSize,
+        VK_BUFFER_USAGE_ACCELERATION_STRUCTURE_STORAGE_BIT_KHR | VK_BUFFER_USAGE_SHADER_DEVICE_ADDRESS_BIT);
+    const VkAccelerationStructureCreateInfoKHR createInfo{
+        .sType = VK_STRUCTURE_TYPE_ACCELERATION_STRUCTURE_CREATE_INFO_KHR,
+        .buffer = std::get<BUFFER_ENTITY_UID::BUFFER>(tlasBuffer),
+        .size = buildSizes.accelerationStructureSize,
+        .type = VK_ACCELERATION_STRUCTURE_TYPE_TOP_LEVEL_KHR,
+    };
+    VkAccelerationStructureKHR tlas{VK_NULL_HANDLE};
+    VK_CHECK(vkCreateAccelerationStructureKHR(logicalDevice, &createInfo, nullptr, &tlas));
+    setCorrlationId(tlas, logicalDevice, VK_OBJECT_TYPE_ACCELERATION_STRUCTURE_KHR, "TLAS");
+    const VkAccelerationStructureDeviceAddressInfoKHR addressInfo{
+        .sType = VK_STRUCTURE_TYPE_ACCELERATION_STRUCTURE_DEVICE_ADDRESS_INFO_KHR,
+        .accelerationStructure = tlas,
+    };
+    _tlas = std::make_tuple(tlasBuffer, tlas, vkGetAccelerationStructureDeviceAddressKHR(logicalDevice, &addressInfo));
+
+    // one scratch for builds and refits: they never overlap, see recordBuild
+    VkPhysicalDeviceAccelerationStructurePropertiesKHR asProperties{
+        .sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_ACCELERATION_STRUCTURE_PROPERTIES_KHR,
+    };
+    VkPhysicalDeviceProperties2 properties{
+        .sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_PROPERTIES_2,
+        .pNext = &asProperties,
+    };
+    vkGetPhysicalDeviceProperties2(_ctx.getSelectedPhysicalDevice(), &properties);
+    const VkDeviceSize scratchAlignment = (std::max)(VkDeviceSize{asProperties.minAccelerationStructureScratchOffsetAlignment}, VkDeviceSize{1});
+    _stats.scratchSizeInBytes = (std::max)(buildSizes.buildScratchSize, buildSizes.updateScratchSize);
+    _scratchBuffer = _ctx.createDeviceLocalBuffer(
+        "TLAS scratch",
+        _stats.scratchSizeInBytes + scratchAlignment,
+        VK_BUFFER_USAGE_STORAGE_BUFFER_BIT | VK_BUFFER_USAGE_SHADER_DEVICE_ADDRESS_BIT);
+    _scratchAddress = alignedSize(std::get<BUFFER_ENTITY_UID::DEVICE_HOST_ADDRESS>(_scratchBuffer).deviceAddress, scratchAlignment);
+
+    _stats.numInstances = numInstances;
+    _stats.sizeInBytes = buildSizes.accelerationStructureSize;
+
+    // initial build: blocking, on the io command buffer
+    auto cmdBuffer = _ctx.getCommandBufferForIO();
+    _ctx.BeginRecordCommandBuffer(cmdBuffer);
+    recordBuild(std::get<COMMAND_BUFFER_ENTITY_OFFSET::COMMAND_BUFFER>(cmdBuffer), 0, VK_BUILD_ACCELERATION_STRUCTURE_MODE_BUILD_KHR);
+    _ctx.EndRecordCommandBuffer(cmdBuffer);
+    waitTimelinePoints(logicalDevice, {_ctx.submitCommandBuffer(cmdBuffer)});
+    ++_stats.numBuilds;
+
+    log(Level::Info, "TopLevelAS: ", numInstances, " instance(s), ", _stats.sizeInBytes, " bytes, scratch ",
+        _stats.scratchSizeInBytes, " bytes");
+}
+
+TopLevelAS::~TopLevelAS()
+{
+    // the owner waited for the device to be idle
+    const auto vmaAllocator = _ctx.getVmaAllocator();
+    BlasBuilder::destroy(_ctx, _tlas);
+    vmaDestroyBuffer(vmaAllocator,
+                     std::get<BUFFER_ENTITY_UID::BUFFER>(_scratchBuffer),
+                     std::get<BUFFER_ENTITY_UID::VMA_ALLOCATION>(_scratchBuffer));
+    vmaUnmapMemory(vmaAllocator, std::get<BUFFER_ENTITY_UID::VMA_ALLOCATION>(_instanceBuffer));
+    vmaDestroyBuffer(vmaAllocator,
+                     std::get<BUFFER_ENTITY_UID::BUFFER>(_instanceBuffer),
+                     std::get<BUFFER_ENTITY_UID::VMA_ALLOCATION>(_instanceBuffer));
+}
+
+void TopLevelAS::setTransform(uint32_t instanceId, const glm::mat4 &transform)
+{
+    ASSERT(instanceId < _instances.size(), "TopLevelAS: instance out of range");
+    _instances[instanceId].transform = toTransformMatrix(transform);
+    if (!_moved[instanceId])
+    {
+        _moved[instanceId] = true;
+        ++_numMoved;
+    }
+    _dirty = true;
+}
+
+void TopLevelAS::record(VkCommandBuffer cmdBuffer, uint32_t frameId)
+{
+    if (!_dirty)
+    {
+        return;
+    }
+    ZoneScopedN("TopLevelAS: record");
+    const bool rebuild = _numMoved > _config.rebuildThreshold * _instances.size() ||
+                         _updatesSinceBuild >= _config.maxUpdatesBeforeRebuild;
+    if (rebuild)
+    {
+        recordBuild(cmdBuffer, frameId, VK_BUILD_ACCELERATION_STRUCTURE_MODE_BUILD_KHR);
+        std::fill(_moved.begin(), _moved.end(), false);
+        _numMoved = 0;
+        _updatesSinceBuild = 0;
+        ++_stats.numBuilds;
+    }
+    else
+    {
+        recordBuild(cmdBuffer, frameId, VK_BUILD_ACCELERATION_STRUCTURE_MODE_UPDATE_KHR);
+        ++_updatesSinceBuild;
+        ++_stats.numUpdates;
+    }
+    _dirty = false;
+}
+
+void TopLevelAS::recordBuild(VkCommandBuffer cmdBuffer, uint32_t frameId, VkBuildAccelerationStructureModeKHR mode)
+{
+    ASSERT(frameId < _numFramesInFlight, "TopLevelAS: frame out of range");
+    // the slice of this frame: the frame's previous submit is done, host writes are visible at submit
+    const auto numInstances = static_cast<uint32_t>(_instances.size());
+    const VkDeviceSize sliceSizeInBytes = sizeof(VkAccelerationStructureInstanceKHR) * numInstances;
+    auto *dst = static_cast<uint8_t *>(std::get<BUFFER_ENTITY_UID::MAPPING_ADDRESS>(_instanceBuffer)) + sliceSizeInBytes * frameId;
+    memcpy(dst, _instances.data(), sliceSizeInBytes);
+
+    const VkAccelerationStructureGeometryKHR geometry{
+        .sType = VK_STRUCTURE_TYPE_ACCELERATION_STRUCTURE_GEOMETRY_KHR,
+        .geometryType = VK_GEOMETRY_TYPE_INSTANCES_KHR,
+        .geometry = {
+            .instances = {
+                .sType = VK_STRUCTURE_TYPE_ACCELERATION_STRUCTURE_GEOMETRY_INSTANCES_DATA_KHR,
+                .arrayOfPointers = VK_FALSE,
+                .data = {.deviceAddress = std::get<BUFFER_ENTITY_UID::DEVICE_HOST_ADDRESS>(_instanceBuffer).deviceAddress + sliceSizeInBytes * frameId},
+            },
+        },
+        .flags = VK_GEOMETRY_OPAQUE_BIT_KHR,
+    };
+    const auto tlas = handle();
+    const VkAccelerationStructureBuildGeometryInfoKHR buildInfo{
+        .sType = VK_STRUCTURE_TYPE_ACCELERATION_STRUCTURE_BUILD_GEOMETRY_INFO_KHR,
+        .type = VK_ACCELERATION_STRUCTURE_TYPE_TOP_LEVEL_KHR,
+        .flags = TLAS_BUILD_FLAGS,
+        .mode = mode,
+        // refit in place
+        .srcAccelerationStructure = mode == VK_BUILD_ACCELERATION_STRUCTURE_MODE_UPDATE_KHR ? tlas : VK_NULL_HANDLE,
+        .dstAccelerationStructure = tlas,
+        .geometryCount = 1,
+        .pGeometries = &geometry,
+        .scratchData = {.deviceAddress = _scratchAddress},
+    };
+    const VkAccelerationStructureBuildRangeInfoKHR range{
+        .primitiveCount = numInstances,
+    };
+    const VkAccelerationStructureBuildRangeInfoKHR *ranges[] = {&range};
+
+    // the previous frames trace against the TLAS and the previous build used the scratch (same queue)
+    const VkMemoryBarrier2 beforeBuild{
+        .sType = VK_STRUCTURE_TYPE_MEMORY_BARRIER_2,
+        .srcStageMask = VK_PIPELINE_STAGE_2_ACCELERATION_STRUCTURE_BUILD_BIT_KHR | VK_PIPELINE_STAGE_2_RAY_TRACING_SHADER_BIT_KHR,
+        .srcAccessMask = VK_ACCESS_2_ACCELERATION_STRUCTURE_WRITE_BIT_KHR,
+        .dstStageMask = VK_PIPELINE_STAGE_2_ACCELERATION_STRUCTURE_BUILD_BIT_KHR,
+        .dstAccessMask = VK_ACCESS_2_ACCELERATION_STRUCTURE_READ_BIT_KHR | VK_ACCESS_2_ACCELERATION_STRUCTURE_WRITE_BIT_KHR,
+    };
+    const VkDependencyInfo beforeDependency{
+        .sType = VK_STRUCTURE_TYPE_DEPENDENCY_INFO,
+        .memoryBarrierCount = 1,
+        .pMemoryBarriers = &beforeBuild,
+    };
+    vkCmdPipelineBarrier2(cmdBuffer, &beforeDependency);
+
+    vkCmdBuildAccelerationStructuresKHR(cmdBuffer, 1, &buildInfo, ranges);
+
+    const VkMemoryBarrier2 afterBuild{
+        .sType = VK_STRUCTURE_TYPE_MEMORY_BARRIER_2,
+        .srcStageMask = VK_PIPELINE_STAGE_2_ACCELERATION_STRUCTURE_BUILD_BIT_KHR,
+        .srcAccessMask = VK_ACCESS_2_ACCELERATION_STRUCTURE_WRITE_BIT_KHR,
+        .dstStageMask = VK_PIPELINE_STAGE_2_RAY_TRACING_SHADER_BIT_KHR,
+        .dstAccessMask = VK_ACCESS_2_ACCELERATION_STRUCTURE_READ_BIT_KHR,
+    };
+    const VkDependencyInfo afterDependency{
+        .sType = VK_STRUCTURE_TYPE_DEPENDENCY_INFO,
+        .memoryBarrierCount = 1,
+        .pMemoryBarriers = &afterBuild,
+    };
+    vkCmdPipelineBarrier2(cmdBuffer, &afterDependency);
+}
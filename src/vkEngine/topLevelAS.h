@@ -0,0 +1,98 @@
+#pragma once
+
+#include <vector>
+#include <cstdint>
+
+#include <context.h>
+
+// glm is column-major, VkTransformMatrixKHR the top 3 rows, row-major
+inline VkTransformMatrixKHR toTransformMatrix(const glm::mat4 &m)
+{
+    VkTransformMatrixKHR transform;
+    for (int row = 0; row < 3; ++row)
+    {
+        for (int col = 0; col < 4; ++col)
+        {
+            transform.matrix[row][col] = m[col][row];
+        }
+    }
+    return transform;
+}
+
+// TLAS over the instances of a scene, one instance per placement of a BLAS (mesh reuse = instancing)
+// 1. built once, blocking, by the ctor (ALLOW_UPDATE)
+// 2. setTransform() moves instances on the host, record() then updates the TLAS in the frame's command buffer:
+//    a refit (VK_BUILD_ACCELERATION_STRUCTURE_MODE_UPDATE_KHR, in place) while the instances moved since the last
+//    build stay under Config::rebuildThreshold, a full rebuild past it or after maxUpdatesBeforeRebuild refits
+//    (a refit keeps the topology of the bvh, its quality degrades as the instances drift apart)
+// the instances are copied into a per frame in flight slice of one mapped buffer: the previous frames may still
+// read theirs. the instance count is fixed, render thread only
+class TopLevelAS
+{
+public:
+    struct Config
+    {
+        // fraction of the instances
+        float rebuildThreshold{0.25f};
+        uint32_t maxUpdatesBeforeRebuild{128};
+    };
+
+    struct Stats
+    {
+        uint32_t numInstances{0};
+        uint64_t numBuilds{0};
+        uint64_t numUpdates{0};
+        VkDeviceSize sizeInBytes{0};
+        VkDeviceSize scratchSizeInBytes{0};
+    };
+
+    TopLevelAS() = delete;
+    // instances: accelerationStructureReference already set (BLAS device address)
+    TopLevelAS(VkContext &ctx,
+               const std::vector<VkAccelerationStructureInstanceKHR> &instances,
+               uint32_t numFramesInFlight,
+               const Config &config);
+    ~TopLevelAS();
+
+    TopLevelAS(const TopLevelAS &other) = delete;
+    TopLevelAS &operator=(const TopLevelAS &other) = delete;
+
+    void setTransform(uint32_t instanceId, const glm::mat4 &transform);
+    // nothing moved: nothing recorded. otherwise refit or rebuild, followed by a barrier to the ray tracing stage
+    void record(VkCommandBuffer cmdBuffer, uint32_t frameId);
+
+    VkAccelerationStructureKHR handle() const
+    {
+        return std::get<AS_ENTITY_UID::AS>(_tlas);
+    }
+    VkDeviceAddress deviceAddress() const
+    {
+        return std::get<AS_ENTITY_UID::DEVICE_ADDRESS>(_tlas);
+    }
+    const Stats &stats() const
+    {
+        return _stats;
+    }
+
+private:
+    void recordBuild(VkCommandBuffer cmdBuffer, uint32_t frameId, VkBuildAccelerationStructureModeKHR mode);
+
+    VkContext &_ctx;
+    const Config _config;
+    const uint32_t _numFramesInFlight;
+
+    std::vector<VkAccelerationStructureInstanceKHR> _instances;
+    // instance -> moved since the last full build
+    std::vector<bool> _moved;
+    uint32_t _numMoved{0};
+    uint32_t _updatesSinceBuild{0};
+    bool _dirty{false};
+
+    // _numFramesInFlight slices of _instances.size() instances, persistently mapped
+    BufferEntity _instanceBuffer;
+    // max(build, update) scratch, aligned
+    BufferEntity _scratchBuffer;
+    VkDeviceAddress _scratchAddress{0};
+    ASEntity _tlas;
+    Stats _stats;
+};
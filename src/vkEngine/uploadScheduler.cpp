@@ -0,0 +1,274 @@
+#include <algorithm>
+
+#include <tracy/Tracy.hpp>
+
+#include <uploadScheduler.h>
+
+UploadScheduler::UploadScheduler(VkContext &ctx, JobSystem *resumeOn,
+                                 uint32_t numBatchesInFlight, size_t maxUploadsPerBatch)
+    : _ctx(ctx), _resumeOn(resumeOn), _maxUploadsPerBatch((std::max)(maxUploadsPerBatch, size_t(1)))
+{
+    ASSERT(numBatchesInFlight > 0, "UploadScheduler needs at least one batch");
+    // no fence: the batches are tracked on the queue timelines
+    const auto transferCmdBuffers = _ctx.createTransferCommandBuffers("upload: transfer", numBatchesInFlight, 0, 0);
+    const auto graphicsCmdBuffers = _ctx.createGraphicsCommandBuffers("upload: graphics", numBatchesInFlight, 0, 0);
+    _batches.reserve(numBatchesInFlight);
+    for (uint32_t i = 0; i < numBatchesInFlight; ++i)
+    {
+        _batches.emplace_back(Batch{transferCmdBuffers[i], graphicsCmdBuffers[i]});
+    }
+}
+
+UploadScheduler::~UploadScheduler()
+{
+    stopTicking();
+    // nobody may stay suspended on an upload
+    while (flush() > 0)
+    {
+    }
+
+    auto logicalDevice = _ctx.getLogicDevice();
+    std::vector<TimelinePoint> inFlight;
+    for (const auto &batch : _batches)
+    {
+        inFlight.push_back(batch.done);
+    }
+    waitTimelinePoints(logicalDevice, inFlight);
+
+    for (auto &batch : _batches)
+    {
+        for (const auto &cmdBuffer : {batch.transfer, batch.graphics})
+        {
+            const auto cmdBufferHandle = std::get<COMMAND_BUFFER_ENTITY_OFFSET::COMMAND_BUFFER>(cmdBuffer);
+            const auto cmdPool = std::get<COMMAND_BUFFER_ENTITY_OFFSET::COMMAND_POOL>(cmdBuffer);
+            vkFreeCommandBuffers(logicalDevice, cmdPool, 1, &cmdBufferHandle);
+            // one pool per command buffer
+            vkDestroyCommandPool(logicalDevice, cmdPool, nullptr);
+        }
+    }
+}
+
+UploadScheduler::Awaiter UploadScheduler::upload(const BufferUpload &upload)
+{
+    return Awaiter{*this, upload};
+}
+
+UploadScheduler::Awaiter UploadScheduler::upload(const ImageUpload &upload)
+{
+    return Awaiter{*this, upload};
+}
+
+void UploadScheduler::enqueue(Awaiter *awaiter, std::coroutine_handle<> h)
+{
+    std::scoped_lock lock{_mux};
+    _pending.emplace_back(awaiter, h);
+}
+
+size_t UploadScheduler::pendingCount() const
+{
+    std::scoped_lock lock{_mux};
+    return _pending.size();
+}
+
+size_t UploadScheduler::flush()
+{
+    std::unique_lock flushLock{_flushMux};
+    collectCompletedLocked();
+
+    std::vector<std::pair<Awaiter *, std::coroutine_handle<>>> uploads;
+    {
+        std::scoped_lock lock{_mux};
+        const auto count = static_cast<std::ptrdiff_t>((std::min)(_pending.size(), _maxUploadsPerBatch));
+        uploads.assign(_pending.begin(), _pending.begin() + count);
+        _pending.erase(_pending.begin(), _pending.begin() + count);
+    }
+    if (uploads.empty())
+    {
+        return 0;
+    }
+    ZoneScopedN("UploadScheduler: flush");
+
+    auto &batch = _batches[_nextBatch];
+    _nextBatch = (_nextBatch + 1) % _batches.size();
+    if (batch.inFlight)
+    {
+        // every command buffer of the pool is in flight
+        ZoneScopedN("UploadScheduler: wait batch");
+        waitTimelinePoints(_ctx.getLogicDevice(), {batch.done});
+        collectCompletedLocked();
+    }
+
+    const auto srcQueueFamilyIndex = std::get<COMMAND_BUFFER_ENTITY_OFFSET::QUEUE_FAMILY_INDEX>(batch.transfer);
+    const auto dstQueueFamilyIndex = std::get<COMMAND_BUFFER_ENTITY_OFFSET::QUEUE_FAMILY_INDEX>(batch.graphics);
+    const bool ownershipTransfer = srcQueueFamilyIndex != dstQueueFamilyIndex;
+
+    std::vector<BufferEntity> buffers;
+    std::vector<ImageEntity> images;
+    uint64_t bytes = 0;
+    _ctx.BeginRecordCommandBuffer(batch.transfer);
+    for (const auto &[awaiter, h] : uploads)
+    {
+        if (const auto *bufferUpload = std::get_if<BufferUpload>(&awaiter->upload))
+        {
+            _ctx.copyBuffer(bufferUpload->src.buffer, bufferUpload->dst, batch.transfer,
+                            static_cast<uint32_t>(bufferUpload->src.size),
+                            static_cast<uint32_t>(bufferUpload->src.offset),
+                            static_cast<uint32_t>(bufferUpload->dstOffset));
+            buffers.push_back(bufferUpload->dst);
+            bytes += bufferUpload->src.size;
+        }
+        else
+        {
+            const auto &imageUpload = std::get<ImageUpload>(awaiter->upload);
+            _ctx.copyBufferToImage(imageUpload.image, imageUpload.src.buffer, batch.transfer, imageUpload.src.offset);
+            images.push_back(imageUpload.image);
+            bytes += imageUpload.src.size;
+        }
+    }
+    if (ownershipTransfer)
+    {
+        _ctx.releaseQueueFamilyOwnership(batch.transfer, images, buffers, srcQueueFamilyIndex, dstQueueFamilyIndex);
+    }
+    _ctx.EndRecordCommandBuffer(batch.transfer);
+    const auto transferDone = _ctx.submitCommandBuffer(batch.transfer);
+    ++_uploadSubmits;
+
+    // back to the ring once the copies are done
+    auto &stagingRing = _ctx.getStagingRing();
+    for (const auto &[awaiter, h] : uploads)
+    {
+        std::visit([&stagingRing, &transferDone](const auto &upload)
+                   { stagingRing.retire(upload.src, transferDone.semaphore, transferDone.value); },
+                   awaiter->upload);
+    }
+
+    // the graphics side is only needed for the ownership acquire and the mip chains
+    auto done = transferDone;
+    if (ownershipTransfer || !images.empty())
+    {
+        _ctx.BeginRecordCommandBuffer(batch.graphics);
+        if (ownershipTransfer)
+        {
+            _ctx.acquireQueueFamilyOwnership(batch.graphics, images, buffers, srcQueueFamilyIndex, dstQueueFamilyIndex);
+        }
+        for (const auto &image : images)
+        {
+            _ctx.generateMipmaps(image, batch.graphics);
+        }
+        _ctx.EndRecordCommandBuffer(batch.graphics);
+        // the acquire must wait on ALL_COMMANDS, see acquireQueueFamilyOwnership
+        done = _ctx.submitCommandBuffer(batch.graphics, {timelineWait(transferDone, VK_PIPELINE_STAGE_2_ALL_COMMANDS_BIT)});
+        ++_graphicsSubmits;
+    }
+
+    accumulateBusyTimeLocked(std::chrono::steady_clock::now());
+    ++_numInFlight;
+    batch.done = done;
+    batch.bytes = bytes;
+    batch.inFlight = true;
+    _uploads += uploads.size();
+    _bytes += bytes;
+    TracyPlot("UploadScheduler: uploads per batch", static_cast<int64_t>(uploads.size()));
+    TracyPlot("UploadScheduler: bytes per batch", static_cast<int64_t>(bytes));
+
+    for (const auto &[awaiter, h] : uploads)
+    {
+        awaiter->done = done;
+    }
+    // resume outside the lock, a resumed coroutine may upload (or flush) again right away
+    flushLock.unlock();
+    for (const auto &[awaiter, h] : uploads)
+    {
+        if (_resumeOn)
+        {
+            _resumeOn->run("UploadScheduler: resume", [h]()
+                           { h.resume(); });
+        }
+        else
+        {
+            h.resume();
+        }
+    }
+    return uploads.size();
+}
+
+void UploadScheduler::collectCompletedLocked()
+{
+    for (auto &batch : _batches)
+    {
+        if (!batch.inFlight)
+        {
+            continue;
+        }
+        uint64_t value = 0;
+        VK_CHECK(vkGetSemaphoreCounterValue(_ctx.getLogicDevice(), batch.done.semaphore, &value));
+        if (value < batch.done.value)
+        {
+            continue;
+        }
+        batch.inFlight = false;
+        _completedBytes += batch.bytes;
+        // polling granularity: the flush interval
+        accumulateBusyTimeLocked(std::chrono::steady_clock::now());
+        --_numInFlight;
+    }
+}
+
+void UploadScheduler::accumulateBusyTimeLocked(std::chrono::steady_clock::time_point now)
+{
+    if (_numInFlight > 0)
+    {
+        _busyTime += now - _busySince;
+    }
+    _busySince = now;
+}
+
+UploadScheduler::Stats UploadScheduler::stats()
+{
+    std::scoped_lock flushLock{_flushMux};
+    collectCompletedLocked();
+    // the batches still in flight count up to now
+    accumulateBusyTimeLocked(std::chrono::steady_clock::now());
+    Stats res{
+        .uploadSubmits = _uploadSubmits,
+        .graphicsSubmits = _graphicsSubmits,
+        .uploads = _uploads,
+        .bytes = _bytes,
+    };
+    if (_uploadSubmits > 0)
+    {
+        res.uploadsPerSubmit = static_cast<double>(_uploads) / static_cast<double>(_uploadSubmits);
+    }
+    const double busySeconds = std::chrono::duration<double>(_busyTime).count();
+    if (busySeconds > 0.0)
+    {
+        res.bytesPerSecond = static_cast<double>(_completedBytes) / busySeconds;
+    }
+    return res;
+}
+
+void UploadScheduler::startTicking(std::chrono::microseconds interval)
+{
+    ASSERT(!_tickingThread.joinable(), "already ticking");
+    _tickingThread = std::jthread([this, interval](std::stop_token stopToken)
+                                  {
+        tracy::SetThreadName("UploadScheduler");
+        std::mutex sleepMux;
+        while (!stopToken.stop_requested())
+        {
+            flush();
+            std::unique_lock lock{sleepMux};
+            // wakes up early on stop
+            _tickingCv.wait_for(lock, stopToken, interval, []()
+                                { return false; });
+        } });
+}
+
+void UploadScheduler::stopTicking()
+{
+    if (_tickingThread.joinable())
+    {
+        _tickingThread.request_stop();
+        _tickingThread.join();
+    }
+}
@@ -0,0 +1,141 @@
+#pragma once
+
+#include <coroutine>
+#include <chrono>
+#include <condition_variable>
+#include <mutex>
+#include <thread>
+#include <variant>
+#include <vector>
+#include <cstdint>
+
+#include <context.h>
+#include <stagingRing.h>
+#include <jobSystem.h>
+
+// the source region is already filled on the host
+struct BufferUpload
+{
+    StagingRegion src;
+    BufferEntity dst;
+    VkDeviceSize dstOffset{0};
+};
+
+// rgba8 level 0 from the region, the rest of the mip chain is blitted on the graphics queue,
+// which also leaves the image in SHADER_READ_ONLY_OPTIMAL
+struct ImageUpload
+{
+    StagingRegion src;
+    ImageEntity image;
+};
+
+// batches the uploads of a tick into a single transfer submission
+// 1. producers fill their staging region, then co_await scheduler.upload(...)
+// 2. flush() (by hand or from the ticking thread) records every pending copy into the next transfer
+//    command buffer of a small pool, releases the ownership of all of them with one barrier, submits once
+// 3. the paired graphics command buffer waits on the transfer timeline value, acquires everything with
+//    one barrier, generates the mip chains, submits once
+// 4. the staging regions retire on the transfer value, and each awaiter resumes with the point its upload
+//    is complete at: co_await watcher.timeline(point.semaphore, point.value)
+class UploadScheduler
+{
+public:
+    struct Stats
+    {
+        // one transfer submission per batch
+        uint64_t uploadSubmits{0};
+        // acquire + mip chains, only for the batches needing them
+        uint64_t graphicsSubmits{0};
+        uint64_t uploads{0};
+        uint64_t bytes{0};
+        // over the upload submits
+        double uploadsPerSubmit{0.0};
+        // completed bytes over the wall time at least one batch was in flight
+        double bytesPerSecond{0.0};
+    };
+
+    struct Awaiter
+    {
+        UploadScheduler &scheduler;
+        std::variant<BufferUpload, ImageUpload> upload;
+        TimelinePoint done{};
+
+        bool await_ready() noexcept
+        {
+            return false;
+        }
+
+        void await_suspend(std::coroutine_handle<> h)
+        {
+            scheduler.enqueue(this, h);
+        }
+
+        TimelinePoint await_resume() noexcept
+        {
+            return done;
+        }
+    };
+
+    UploadScheduler() = delete;
+    // numBatchesInFlight: size of the command buffer pool, flush() blocks when all of them are in flight
+    UploadScheduler(VkContext &ctx, JobSystem *resumeOn = nullptr,
+                    uint32_t numBatchesInFlight = 3, size_t maxUploadsPerBatch = 64);
+    ~UploadScheduler();
+
+    UploadScheduler(const UploadScheduler &other) = delete;
+    UploadScheduler &operator=(const UploadScheduler &other) = delete;
+
+    Awaiter upload(const BufferUpload &upload);
+    Awaiter upload(const ImageUpload &upload);
+
+    // records and submits what is pending (at most maxUploadsPerBatch), returns the number of uploads
+    size_t flush();
+    size_t pendingCount() const;
+
+    // background flush every interval, stopped by stopTicking() or the destructor
+    void startTicking(std::chrono::microseconds interval);
+    void stopTicking();
+
+    Stats stats();
+
+private:
+    struct Batch
+    {
+        CommandBufferEntity transfer;
+        CommandBufferEntity graphics;
+        TimelinePoint done{};
+        uint64_t bytes{0};
+        bool inFlight{false};
+    };
+
+    void enqueue(Awaiter *awaiter, std::coroutine_handle<> h);
+    // under _flushMux
+    void collectCompletedLocked();
+    // under _flushMux, before _numInFlight changes: the time since the last change counts when batches are in flight
+    void accumulateBusyTimeLocked(std::chrono::steady_clock::time_point now);
+
+    VkContext &_ctx;
+    JobSystem *_resumeOn{nullptr};
+    const size_t _maxUploadsPerBatch;
+
+    mutable std::mutex _mux;
+    std::vector<std::pair<Awaiter *, std::coroutine_handle<>>> _pending;
+
+    // one flush at a time: owns the batches and the stats
+    std::mutex _flushMux;
+    std::vector<Batch> _batches;
+    size_t _nextBatch{0};
+
+    uint64_t _uploadSubmits{0};
+    uint64_t _graphicsSubmits{0};
+    uint64_t _uploads{0};
+    uint64_t _bytes{0};
+    uint64_t _completedBytes{0};
+    uint32_t _numInFlight{0};
+    // last change of _numInFlight
+    std::chrono::steady_clock::time_point _busySince;
+    std::chrono::steady_clock::duration _busyTime{0};
+
+    std::condition_variable_any _tickingCv;
+    std::jthread _tickingThread;
+};
@@ -0,0 +1,138 @@
+#pragma once
+
+#include <atomic>
+#include <memory>
+#include <vector>
+#include <cstddef>
+#include <cstdint>
+
+// Chase-Lev work-stealing deque
+// https://www.di.ens.fr/~zappa/readings/ppopp13.pdf (C11 version, Le et al.)
+// the owner thread pushes and takes at the bottom (LIFO, cache friendly),
+// any other thread steals at the top (FIFO, oldest = usually the largest piece of work).
+// only the last element is contended between the owner and the thieves (one CAS on _top).
+//
+// T must be trivially copyable, the JobSystem stores raw Job pointers.
+// the ring grows when full; retired rings are kept alive until destruction since a thief
+// may still read from one
+template <typename T>
+class WorkStealingDeque
+{
+public:
+    explicit WorkStealingDeque(size_t capacity = 1024)
+    {
+        _rings.emplace_back(std::make_unique<Ring>(capacity));
+        _ring.store(_rings.back().get(), std::memory_order_relaxed);
+    }
+
+    WorkStealingDeque(const WorkStealingDeque &other) = delete;
+    WorkStealingDeque &operator=(const WorkStealingDeque &other) = delete;
+
+    // owner only
+    void push(T v)
+    {
+        const int64_t b = _bottom.load(std::memory_order_relaxed);
+        const int64_t t = _top.load(std::memory_order_acquire);
+        Ring *ring = _ring.load(std::memory_order_relaxed);
+        if (b - t > static_cast<int64_t>(ring->capacity) - 1)
+        {
+            ring = grow(ring, b, t);
+        }
+        ring->put(b, v);
+        std::atomic_thread_fence(std::memory_order_release);
+        _bottom.store(b + 1, std::memory_order_relaxed);
+    }
+
+    // owner only, false when empty
+    bool take(T &v)
+    {
+        const int64_t b = _bottom.load(std::memory_order_relaxed) - 1;
+        Ring *ring = _ring.load(std::memory_order_relaxed);
+        _bottom.store(b, std::memory_order_relaxed);
+        std::atomic_thread_fence(std::memory_order_seq_cst);
+        int64_t t = _top.load(std::memory_order_relaxed);
+        if (t > b)
+        {
+            // empty
+            _bottom.store(b + 1, std::memory_order_relaxed);
+            return false;
+        }
+        v = ring->get(b);
+        if (t == b)
+        {
+            // last element: race against the thieves
+            const bool won = _top.compare_exchange_strong(t, t + 1,
+                                                          std::memory_order_seq_cst,
+                                                          std::memory_order_relaxed);
+            _bottom.store(b + 1, std::memory_order_relaxed);
+            return won;
+        }
+        return true;
+    }
+
+    // any thread, false when empty or when losing the race to another thief/the owner
+    bool steal(T &v)
+    {
+        int64_t t = _top.load(std::memory_order_acquire);
+        std::atomic_thread_fence(std::memory_order_seq_cst);
+        const int64_t b = _bottom.load(std::memory_order_acquire);
+        if (t >= b)
+        {
+            return false;
+        }
+        Ring *ring = _ring.load(std::memory_order_acquire);
+        v = ring->get(t);
+        return _top.compare_exchange_strong(t, t + 1,
+                                            std::memory_order_seq_cst,
+                                            std::memory_order_relaxed);
+    }
+
+    // snapshot, may be stale by the time the caller looks at it
+    bool empty() const
+    {
+        return _bottom.load(std::memory_order_relaxed) <= _top.load(std::memory_order_relaxed);
+    }
+
+private:
+    struct Ring
+    {
+        explicit Ring(size_t cap) : capacity(cap), mask(cap - 1), cells(new std::atomic<T>[cap])
+        {
+        }
+
+        T get(int64_t i) const
+        {
+            return cells[i & mask].load(std::memory_order_relaxed);
+        }
+
+        void put(int64_t i, T v)
+        {
+            cells[i & mask].store(v, std::memory_order_relaxed);
+        }
+
+        const size_t capacity;
+        const size_t mask;
+        std::unique_ptr<std::atomic<T>[]> cells;
+    };
+
+    Ring *grow(Ring *ring, int64_t b, int64_t t)
+    {
+        _rings.emplace_back(std::make_unique<Ring>(ring->capacity * 2));
+        Ring *bigger = _rings.back().get();
+        for (int64_t i = t; i < b; ++i)
+        {
+            bigger->put(i, ring->get(i));
+        }
+        _ring.store(bigger, std::memory_order_release);
+        return bigger;
+    }
+
+    // avoid false sharing between the owner end and the thief end
+    static constexpr size_t CACHE_LINE_SIZE = 64;
+
+    alignas(CACHE_LINE_SIZE) std::atomic<int64_t> _top{0};
+    alignas(CACHE_LINE_SIZE) std::atomic<int64_t> _bottom{0};
+    alignas(CACHE_LINE_SIZE) std::atomic<Ring *> _ring{nullptr};
+    // owner only
+    std::vector<std::unique_ptr<Ring>> _rings;
+};
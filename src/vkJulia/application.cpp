@@ -77,6 +77,8 @@ void VkApplication::teardown()
     vkDeviceWaitIdle(logicalDevice);
     deleteSwapChain();
 
+    _texture.reset();
+
     // shader module
     vkDestroyShaderModule(logicalDevice, _vsShaderModule, nullptr);
     vkDestroyShaderModule(logicalDevice, _fsShaderModule, nullptr);
@@ -220,8 +222,15 @@ void VkApplication::bindResourceToDescriptorSets()
         const auto dstSets = _descriptorSets[&_descriptorSetLayouts[DESC_LAYOUT_SEMANTIC::TEX_SAMP]];
         ASSERT(dstSets.size() == 1, "TEX_SAMP descriptor set size is 1");
 
+        // BindlessImage2D[0]: the procedural texture, sampled in place
+        _ctx.bindTextureToDescriptorSet(
+            {_texture->image()},
+            dstSets[0],
+            VK_DESCRIPTOR_TYPE_SAMPLED_IMAGE,
+            0);
+
         // mimic asyn-io callback case
-        uint32_t offset = 0;
+        uint32_t offset = 1;
         for (const auto &imageEntity : _imageEntities)
         {
             _ctx.bindTextureToDescriptorSet(
@@ -271,6 +280,9 @@ void VkApplication::renderPerFrame()
     // // vkWaitForFences ensure the previous command is submitted from the host, now it can be modified.
     // VK_CHECK(vkResetCommandBuffer(cmdToRecord, 0));
     _ctx.BeginRecordCommandBuffer(cmdBuffersForRendering);
+    // 1. procedural texture, regenerated on the device when its parameters changed
+    updateTextures();
+    _texture->record(cmdBuffersForRendering, currentFrameId);
     // 2. main rendering pass
     const auto cmdToRecord = std::get<COMMAND_BUFFER_ENTITY_OFFSET::COMMAND_BUFFER>(cmdBuffersForRendering);
     recordCommandBufferForOneSwapChainImage(currentFrameId, cmdToRecord, swapChainImageIndex);
@@ -279,7 +291,11 @@ void VkApplication::renderPerFrame()
 #endif
     {
         ZoneScopedN("CmdMgr: submit");
-        _ctx.submitCommand();
+        // the semaphores shared with the texture generator (cuda)
+        std::vector<VkSemaphoreSubmitInfo> waits;
+        std::vector<VkSemaphoreSubmitInfo> signals;
+        _texture->appendSubmitSemaphores(waits, signals);
+        _ctx.submitCommand(waits, signals);
     }
     _ctx.present(swapChainImageIndex);
     _ctx.advanceCommandBuffer();
@@ -296,7 +312,8 @@ void VkApplication::recordCommandBuffersForAllSwapChainImage()
     // VK_CHECK(vkResetCommandBuffer(cmdToRecord, 0));
 
     // currtFrameId == swapchainIndex
-    for (int i = 0; i < swapchainImages.size(); i++)
+    // one command buffer per frame in flight, not per swapchain image
+    for (int i = 0; i < cmdBuffersForRendering.size(); i++)
     {
         _ctx.BeginRecordCommandBuffer(cmdBuffersForRendering[i]);
 
@@ -434,65 +451,27 @@ void VkApplication::recordCommandBufferForOneSwapChainImage(
 
 void VkApplication::loadTextures()
 {
-    std::string filename = getAssetPath() + "/lavaplanet_color_rgba.ktx";
-    VkFormat format = VK_FORMAT_R8G8B8A8_UNORM;
-#if defined(__ANDROID__)
-#else
-    cuComplexf c(-0.88f, 0.18f);
-
-    // // _texture = std::make_unique<TextureKtx>(filename);
-    _texture = std::make_unique<JuliaSet>(512, 1.5f, 200, c);
-#endif
-
-    const auto textureMipLevels = getMipLevelsCount(_texture->width(),
-                                                    _texture->height());
-    const uint32_t textureLayoutCount = 1;
-    const VkExtent3D textureExtent = {static_cast<uint32_t>(_texture->width()),
-                                      static_cast<uint32_t>(_texture->height()), 1};
-    const bool generateMipmaps = true;
-    const auto imageEntity = _ctx.createImage("texuture_0",
-                                              VK_IMAGE_TYPE_2D,
-                                              VK_FORMAT_R8G8B8A8_UNORM,
-                                              textureExtent,
-                                              textureMipLevels,
-                                              textureLayoutCount,
-                                              VK_SAMPLE_COUNT_1_BIT,
-                                              // usage here: both dst and src as mipmap generation
-                                              VK_IMAGE_USAGE_TRANSFER_DST_BIT | VK_IMAGE_USAGE_SAMPLED_BIT |
-                                                  VK_IMAGE_USAGE_TRANSFER_SRC_BIT,
-                                              VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT,
-                                              generateMipmaps);
-
-    _imageEntities.emplace_back(std::move(imageEntity));
-
-    // write raw data from cpu to the mipmap level 0 of image
-    const auto stagingBufferSizeForImage = std::get<IMAGE_ENTITY_OFFSET::IMAGE_VMA_ALLOCATION_INFO>(imageEntity).size;
-    _imageStagingBuffers.emplace_back(_ctx.createStagingBuffer(
-        "Staging Buffer Texture_0",
-        stagingBufferSizeForImage));
-    auto cmdBuffersForIO = _ctx.getCommandBufferForIO();
-    _ctx.submitWriteImageCommand(
-        _imageEntities.back(),
-        _imageStagingBuffers.back(),
-        cmdBuffersForIO,
-        _texture->data(),
-        {},
-        std::nullopt,
-        {});
+    // std::string filename = getAssetPath() + "/lavaplanet_color_rgba.ktx";
+    // _texture = std::make_unique<TextureKtx>(filename);
+    _texture = JuliaTexture::create(_ctx, _juliaConfig.backend, _juliaConfig.dim, JuliaParams{});
+    // first content before any frame, prerecorded command buffers sample this one
+    _texture->generateNow();
+    _startTime = std::chrono::steady_clock::now();
 
-    //_ctx.testTemplate(&VkContext::test, &_ctx, 0, 1);
+    _samplerEntities.emplace_back(_ctx.createSampler("sampler0"));
+}
 
-    // staging (pinned buffer in host is not needed anymore, clean)
-    auto vmaAllocator = _ctx.getVmaAllocator();
-    for (size_t i = 0; i < _imageStagingBuffers.size(); ++i)
+void VkApplication::updateTextures()
+{
+    if (!_juliaConfig.animate)
     {
-        vmaDestroyBuffer(
-            vmaAllocator,
-            std::get<BUFFER_ENTITY_UID::BUFFER>(_imageStagingBuffers[i]),
-            std::get<BUFFER_ENTITY_UID::VMA_ALLOCATION>(_imageStagingBuffers[i]));
+        return;
     }
-
-    _samplerEntities.emplace_back(_ctx.createSampler("sampler0"));
+    const float t = std::chrono::duration<float>(std::chrono::steady_clock::now() - _startTime).count();
+    auto params = _texture->params();
+    params.c = cuComplexf(_juliaConfig.radius * std::cos(_juliaConfig.speed * t),
+                          _juliaConfig.radius * std::sin(_juliaConfig.speed * t));
+    _texture->setParams(params);
 }
 
 void VkApplication::initCudaInterop()
@@ -29,6 +29,7 @@
 #include <numeric>
 #include <array>
 #include <filesystem> // for shader
+#include <chrono>
 
 // must ahead of <vk_mem_alloc.h>, or else it will crash on vk functions
 #ifndef __ANDROID__
@@ -52,6 +53,7 @@
 #include <misc.h>
 #include <context.h>
 #include <scene.h>
+#include <juliaTexture.h>
 
 #if defined(__ANDROID__)
 // functor for custom deleter for unique_ptr
@@ -77,12 +79,23 @@ class WindowEntity;
 class CameraBase;
 class VkContext;
 
+// --julia-backend=cpu|compute|cuda --julia-dim=N --julia-animate
+struct JuliaConfig
+{
+    JULIA_BACKEND backend{CPU_SIMD_BACKEND};
+    int dim{512};
+    // c(t) = radius * e^(i * speed * t), regenerated every frame (needs per-frame recording, no VK_PRERECORD_COMMANDS)
+    bool animate{false};
+    float radius{0.7885f};
+    float speed{0.25f};
+};
+
 class VkApplication
 {
 public:
     VkApplication() = delete;
-    VkApplication(VkContext &ctx)
-        : _ctx(ctx)
+    VkApplication(VkContext &ctx, const JuliaConfig &juliaConfig = {})
+        : _ctx(ctx), _juliaConfig(juliaConfig)
     {
     }
     void init();
@@ -126,11 +139,15 @@ private:
     void postHostDeviceIO();
 
     void loadTextures();
+    // animated julia parameters of this frame
+    void updateTextures();
 
     void initCudaInterop();
     void teardownCudaInterop();
     
     VkContext &_ctx;
+    const JuliaConfig _juliaConfig;
+    std::chrono::steady_clock::time_point _startTime;
 
     // ownership of resource
     // std::vector<VkImageView> _swapChainImageViews;
@@ -155,9 +172,9 @@ private:
     std::tuple<std::unordered_map<GRAPHICS_PIPELINE_SEMANTIC, VkPipeline>, VkPipelineLayout> _graphicsPipelineEntity;
 
     // all the textures
-    std::unique_ptr<ITexture> _texture;
+    // procedural, element 0 of BindlessImage2D
+    std::unique_ptr<JuliaTexture> _texture;
     std::vector<ImageEntity> _imageEntities;
-    std::vector<BufferEntity> _imageStagingBuffers;
     // samplers in the glb scene
     std::vector<std::tuple<VkSampler>> _samplerEntities;
 
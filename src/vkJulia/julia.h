@@ -1,7 +1,26 @@
 #pragma once
 #include <memory>
+#include <vector>
+#include <chrono>
+#include <cstring>
 #include <mathUtils.h>
 #include <scene.h>
+#include <jobSystem.h>
+#include <misc.h>
+
+// sse2 is the x64 baseline, the wider lane groups are compiled in by JULIA_SIMD_ISA (see CMakeLists.txt)
+// and picked at runtime: the rest of vkJulia keeps the baseline isa
+#if defined(__SSE2__) || defined(_M_X64)
+#include <immintrin.h>
+#define JULIA_SIMD
+#if defined(_MSC_VER) && !defined(__clang__)
+#include <intrin.h>
+// msvc takes every intrinsic without /arch
+#define JULIA_TARGET(isa)
+#else
+#define JULIA_TARGET(isa) __attribute__((target(isa)))
+#endif
+#endif
 
 // struct Foo // object to manage
 // {
@@ -20,23 +39,101 @@
 
 using namespace vkEngine::math;
 
+#if defined(JULIA_SIMD) && (defined(JULIA_SIMD_AVX2) || defined(JULIA_SIMD_AVX512))
+// the os saves the ymm (avx) or the zmm/opmask (avx-512) registers: xcr0 bits
+inline bool juliaOsSavesRegisters(unsigned long long xcr0Mask)
+{
+#if defined(_MSC_VER) && !defined(__clang__)
+    return (_xgetbv(0) & xcr0Mask) == xcr0Mask;
+#else
+    uint32_t eax = 0, edx = 0;
+    __asm__("xgetbv" : "=a"(eax), "=d"(edx) : "c"(0));
+    return ((static_cast<unsigned long long>(edx) << 32 | eax) & xcr0Mask) == xcr0Mask;
+#endif
+}
+#endif
+
+// pixels per lane group of the simd kernel: the widest group compiled in that the cpu runs
+inline int juliaSimdWidth()
+{
+#if defined(JULIA_SIMD) && defined(JULIA_SIMD_AVX512)
+    {
+#if defined(_MSC_VER) && !defined(__clang__)
+        int info[4];
+        __cpuidex(info, 7, 0);
+        const bool avx512f = (info[1] & (1 << 16)) != 0;
+#else
+        const bool avx512f = __builtin_cpu_supports("avx512f");
+#endif
+        if (avx512f && juliaOsSavesRegisters(0xe6))
+        {
+            return 16;
+        }
+    }
+#endif
+#if defined(JULIA_SIMD) && (defined(JULIA_SIMD_AVX2) || defined(JULIA_SIMD_AVX512))
+    {
+#if defined(_MSC_VER) && !defined(__clang__)
+        int info[4];
+        __cpuid(info, 1);
+        // avx and osxsave
+        const bool avx = (info[2] & (1 << 28)) != 0 && (info[2] & (1 << 27)) != 0;
+#else
+        const bool avx = __builtin_cpu_supports("avx");
+#endif
+        if (avx && juliaOsSavesRegisters(0x6))
+        {
+            return 8;
+        }
+    }
+#endif
+#if defined(JULIA_SIMD)
+    return 4;
+#else
+    return 1;
+#endif
+}
+
+// rows of one job of the simd kernel
+constexpr size_t JULIA_ROWS_PER_JOB = 8;
+
+enum JULIA_KERNEL
+{
+    // reference: one pixel at a time, calling thread
+    SCALAR_KERNEL,
+    // juliaSimdWidth() pixels at a time, bands of rows across the job system
+    SIMD_KERNEL,
+};
+
+// bit-identical kernels: the simd one does the float operations of cuComplexf in the same order.
+// requires no fp contraction (fma) of the scalar path: -ffp-contract=off, msvc /fp:precise
 class JuliaSet : public ITexture
 {
 public:
+    struct BenchmarkResult
+    {
+        int dim{0};
+        int numIterations{0};
+        double scalarMs{0.0};
+        double simdMs{0.0};
+        bool identical{false};
+    };
+
     JuliaSet() = delete;
     explicit JuliaSet(
         int dim,
         float scaleFactor,
         int numIterations,
-        cuComplexf c)
+        cuComplexf c,
+        JULIA_KERNEL kernelType = SIMD_KERNEL)
         : _scaleFactor{scaleFactor}, _numIterations{numIterations},
-          _c{c}
+          _c{c}, _simdWidth{juliaSimdWidth()}
     {
         _width = dim;
         _height = dim; 
         _channels = 4;
-        _buffer.reset(new unsigned char[_width * _height * _channels]);
-        kernel(_buffer.get());
+        _buffer.reset(new unsigned char[(size_t)_width * _height * _channels]);
+        generate(kernelType);
     }
     ~JuliaSet() = default;
 
@@ -45,25 +142,115 @@ public:
         return (void*)_buffer.get();
     }
 
+    // taken by the next generate()
+    void setParams(float scaleFactor, int numIterations, cuComplexf c)
+    {
+        _scaleFactor = scaleFactor;
+        _numIterations = numIterations;
+        _c = c;
+    }
+
+    // refills the texture
+    void generate(JULIA_KERNEL kernelType)
+    {
+        if (kernelType == SCALAR_KERNEL)
+        {
+            kernelScalar(_buffer.get());
+        }
+        else
+        {
+            kernel(_buffer.get());
+        }
+    }
+
+    // scalar vs simd kernel for every (dim, numIterations), the two images are compared byte by byte
+    static std::vector<BenchmarkResult> benchmark(
+        const std::vector<int> &dims,
+        const std::vector<int> &iterationCounts,
+        float scaleFactor,
+        cuComplexf c)
+    {
+        using Clock = std::chrono::steady_clock;
+        std::vector<BenchmarkResult> results;
+        for (auto dim : dims)
+        {
+            for (auto numIterations : iterationCounts)
+            {
+                // warm-up: pages of the buffer, job workers
+                JuliaSet julia(dim, scaleFactor, numIterations, c, SIMD_KERNEL);
+                const size_t sizeInBytes = (size_t)dim * dim * julia._channels;
+
+                BenchmarkResult result{dim, numIterations};
+                auto start = Clock::now();
+                julia.generate(SIMD_KERNEL);
+                result.simdMs = std::chrono::duration<double, std::milli>(Clock::now() - start).count();
+                std::vector<unsigned char> simdImage(julia._buffer.get(), julia._buffer.get() + sizeInBytes);
+
+                start = Clock::now();
+                julia.generate(SCALAR_KERNEL);
+                result.scalarMs = std::chrono::duration<double, std::milli>(Clock::now() - start).count();
+                result.identical = std::memcmp(simdImage.data(), julia._buffer.get(), sizeInBytes) == 0;
+
+                log(Level::Info, "JuliaSet: ", dim, "x", dim, ", ", numIterations, " iterations: scalar ",
+                    result.scalarMs, " ms, simd (", julia._simdWidth, " lanes, ", JobSystem::get().numWorkers() + 1,
+                    " threads) ", result.simdMs, " ms, ",
+                    result.simdMs > 0.0 ? result.scalarMs / result.simdMs : 0.0, "x");
+                if (!result.identical)
+                {
+                    log(Level::Error, "JuliaSet: simd output differs from the scalar output");
+                }
+                results.push_back(result);
+            }
+        }
+        return results;
+    }
+
 protected:
-    void kernel(unsigned char *ptr)
+    void kernelScalar(unsigned char *ptr)
     {
         for (int j = 0; j < _height; j++)
         {
             for (int i = 0; i < _width; i++)
             {
                 // linear access, to let cpu cache friendly
-                int index = i + j * _width;
-
-                // rgba
-                ptr[index * _channels] = 255 * (isInJuliaSet(i, j) ? 1 : 0);
-                ptr[index * _channels + 1] = 0;
-                ptr[index * _channels + 2] = 0;
-                ptr[index * _channels + 3] = 255;
+                writePixel(ptr, i, j, isInJuliaSet(i, j));
             }
         }
     }
 
+    // a job per JULIA_ROWS_PER_JOB rows, a row in lane groups, the tail of the row (width % _simdWidth)
+    // through isInJuliaSet
+    void kernel(unsigned char *ptr)
+    {
+        JobSystem::get().parallelFor("JuliaSet::kernel", 0, _height, JULIA_ROWS_PER_JOB, [this, ptr](size_t row)
+                                     {
+            const int j = static_cast<int>(row);
+            int i = 0;
+            for (; i + _simdWidth <= _width; i += _simdWidth)
+            {
+                const uint32_t inSet = inJuliaSetLanes(i, j);
+                for (int lane = 0; lane < _simdWidth; ++lane)
+                {
+                    writePixel(ptr, i + lane, j, (inSet >> lane) & 1u);
+                }
+            }
+            for (; i < _width; i++)
+            {
+                writePixel(ptr, i, j, isInJuliaSet(i, j));
+            } });
+    }
+
+    void writePixel(unsigned char *ptr, int x, int y, bool inSet)
+    {
+        const size_t index = (size_t)x + (size_t)y * _width;
+
+        // rgba
+        ptr[index * _channels] = 255 * (inSet ? 1 : 0);
+        ptr[index * _channels + 1] = 0;
+        ptr[index * _channels + 2] = 0;
+        ptr[index * _channels + 3] = 255;
+    }
+
     bool isInJuliaSet(int x, int y)
     {
         float jx = _scaleFactor * (float)(_width / 2 - x) / (_width / 2);
@@ -81,9 +268,123 @@ protected:
         return true;
     }
 
+    // bit l: pixel (x + l, y) is in the set
+    // an escaped lane keeps iterating (its bit is sticky), the group exits once every lane escaped
+    uint32_t inJuliaSetLanes(int x, int y)
+    {
+        switch (_simdWidth)
+        {
+#if defined(JULIA_SIMD) && defined(JULIA_SIMD_AVX512)
+        case 16:
+            return inJuliaSetLanes16(x, y);
+#endif
+#if defined(JULIA_SIMD) && (defined(JULIA_SIMD_AVX2) || defined(JULIA_SIMD_AVX512))
+        case 8:
+            return inJuliaSetLanes8(x, y);
+#endif
+#if defined(JULIA_SIMD)
+        case 4:
+            return inJuliaSetLanes4(x, y);
+#endif
+        default:
+            return isInJuliaSet(x, y) ? 1u : 0u;
+        }
+    }
+
+#if defined(JULIA_SIMD) && defined(JULIA_SIMD_AVX512)
+    JULIA_TARGET("avx512f")
+    uint32_t inJuliaSetLanes16(int x, int y)
+    {
+        // (float)(_width / 2 - x - l): the difference of two floats below 2^24 is exact
+        const float px = (float)(_width / 2 - x);
+        const float halfWidth = (float)(_width / 2);
+        const float jy = _scaleFactor * (float)(_height / 2 - y) / (_height / 2);
+        const __m512 lanes = _mm512_setr_ps(0.f, 1.f, 2.f, 3.f, 4.f, 5.f, 6.f, 7.f,
+                                            8.f, 9.f, 10.f, 11.f, 12.f, 13.f, 14.f, 15.f);
+        const __m512 cr = _mm512_set1_ps(_c.r);
+        const __m512 ci = _mm512_set1_ps(_c.i);
+        const __m512 threshold = _mm512_set1_ps(1000.f);
+        __m512 ar = _mm512_div_ps(_mm512_mul_ps(_mm512_set1_ps(_scaleFactor), _mm512_sub_ps(_mm512_set1_ps(px), lanes)),
+                                  _mm512_set1_ps(halfWidth));
+        __m512 ai = _mm512_set1_ps(jy);
+        __mmask16 escaped = 0;
+        for (int i = 0; i < _numIterations && escaped != 0xffff; i++)
+        {
+            // a * a + c
+            const __m512 r = _mm512_sub_ps(_mm512_mul_ps(ar, ar), _mm512_mul_ps(ai, ai));
+            const __m512 im = _mm512_add_ps(_mm512_mul_ps(ai, ar), _mm512_mul_ps(ar, ai));
+            ar = _mm512_add_ps(r, cr);
+            ai = _mm512_add_ps(im, ci);
+            const __m512 magnitude2 = _mm512_add_ps(_mm512_mul_ps(ar, ar), _mm512_mul_ps(ai, ai));
+            escaped |= _mm512_cmp_ps_mask(magnitude2, threshold, _CMP_GT_OQ);
+        }
+        return ~static_cast<uint32_t>(escaped) & 0xffffu;
+    }
+#endif
+
+#if defined(JULIA_SIMD) && (defined(JULIA_SIMD_AVX2) || defined(JULIA_SIMD_AVX512))
+    // avx is enough for these
+    JULIA_TARGET("avx")
+    uint32_t inJuliaSetLanes8(int x, int y)
+    {
+        const float px = (float)(_width / 2 - x);
+        const float halfWidth = (float)(_width / 2);
+        const float jy = _scaleFactor * (float)(_height / 2 - y) / (_height / 2);
+        const __m256 lanes = _mm256_setr_ps(0.f, 1.f, 2.f, 3.f, 4.f, 5.f, 6.f, 7.f);
+        const __m256 cr = _mm256_set1_ps(_c.r);
+        const __m256 ci = _mm256_set1_ps(_c.i);
+        const __m256 threshold = _mm256_set1_ps(1000.f);
+        __m256 ar = _mm256_div_ps(_mm256_mul_ps(_mm256_set1_ps(_scaleFactor), _mm256_sub_ps(_mm256_set1_ps(px), lanes)),
+                                  _mm256_set1_ps(halfWidth));
+        __m256 ai = _mm256_set1_ps(jy);
+        __m256 escaped = _mm256_setzero_ps();
+        for (int i = 0; i < _numIterations && _mm256_movemask_ps(escaped) != 0xff; i++)
+        {
+            // a * a + c
+            const __m256 r = _mm256_sub_ps(_mm256_mul_ps(ar, ar), _mm256_mul_ps(ai, ai));
+            const __m256 im = _mm256_add_ps(_mm256_mul_ps(ai, ar), _mm256_mul_ps(ar, ai));
+            ar = _mm256_add_ps(r, cr);
+            ai = _mm256_add_ps(im, ci);
+            const __m256 magnitude2 = _mm256_add_ps(_mm256_mul_ps(ar, ar), _mm256_mul_ps(ai, ai));
+            escaped = _mm256_or_ps(escaped, _mm256_cmp_ps(magnitude2, threshold, _CMP_GT_OQ));
+        }
+        return ~static_cast<uint32_t>(_mm256_movemask_ps(escaped)) & 0xffu;
+    }
+#endif
+
+#if defined(JULIA_SIMD)
+    uint32_t inJuliaSetLanes4(int x, int y)
+    {
+        const float px = (float)(_width / 2 - x);
+        const float halfWidth = (float)(_width / 2);
+        const float jy = _scaleFactor * (float)(_height / 2 - y) / (_height / 2);
+        const __m128 lanes = _mm_setr_ps(0.f, 1.f, 2.f, 3.f);
+        const __m128 cr = _mm_set1_ps(_c.r);
+        const __m128 ci = _mm_set1_ps(_c.i);
+        const __m128 threshold = _mm_set1_ps(1000.f);
+        __m128 ar = _mm_div_ps(_mm_mul_ps(_mm_set1_ps(_scaleFactor), _mm_sub_ps(_mm_set1_ps(px), lanes)),
+                               _mm_set1_ps(halfWidth));
+        __m128 ai = _mm_set1_ps(jy);
+        __m128 escaped = _mm_setzero_ps();
+        for (int i = 0; i < _numIterations && _mm_movemask_ps(escaped) != 0xf; i++)
+        {
+            // a * a + c
+            const __m128 r = _mm_sub_ps(_mm_mul_ps(ar, ar), _mm_mul_ps(ai, ai));
+            const __m128 im = _mm_add_ps(_mm_mul_ps(ai, ar), _mm_mul_ps(ar, ai));
+            ar = _mm_add_ps(r, cr);
+            ai = _mm_add_ps(im, ci);
+            const __m128 magnitude2 = _mm_add_ps(_mm_mul_ps(ar, ar), _mm_mul_ps(ai, ai));
+            escaped = _mm_or_ps(escaped, _mm_cmpgt_ps(magnitude2, threshold));
+        }
+        return ~static_cast<uint32_t>(_mm_movemask_ps(escaped)) & 0xfu;
+    }
+#endif
+
 private:
     float _scaleFactor;
     int _numIterations;
     cuComplexf _c;
+    // pixels per lane group, see juliaSimdWidth
+    int _simdWidth;
     std::unique_ptr<unsigned char[]> _buffer;
-};
\ No newline at end of file
+};
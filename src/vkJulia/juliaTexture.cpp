@@ -0,0 +1,293 @@
+#include <cstring>
+
+#include <juliaTexture.h>
+#include <queueTimeline.h>
+#include <cuDevice.h>
+#include <cuInterop.h>
+#include <cuJulia.h>
+#include <cuPredefines.h>
+
+#include <tracy/Tracy.hpp>
+
+std::unique_ptr<JuliaTexture> JuliaTexture::create(VkContext &ctx, JULIA_BACKEND backend, int dim, const JuliaParams &params)
+{
+    switch (backend)
+    {
+    case VULKAN_COMPUTE_BACKEND:
+        return std::make_unique<JuliaTextureCompute>(ctx, dim, params);
+    case CUDA_INTEROP_BACKEND:
+        if (!ctx.isExternalInteropSupported())
+        {
+            log(Level::Warn, "JuliaTexture: no external memory/semaphore export, vulkan compute instead of cuda");
+            return std::make_unique<JuliaTextureCompute>(ctx, dim, params);
+        }
+        return std::make_unique<JuliaTextureCuda>(ctx, dim, params);
+    default:
+        return std::make_unique<JuliaTextureCpu>(ctx, dim, params);
+    }
+}
+
+JuliaTextureCpu::JuliaTextureCpu(VkContext &ctx, int dim, const JuliaParams &params)
+    : JuliaTexture(ctx, dim, params)
+{
+    _julia = std::make_unique<JuliaSet>(dim, params.scaleFactor, params.numIterations, params.c, SIMD_KERNEL);
+    _image = _ctx.createImage("julia texture (cpu)",
+                              VK_IMAGE_TYPE_2D,
+                              VK_FORMAT_R8G8B8A8_UNORM,
+                              {static_cast<uint32_t>(dim), static_cast<uint32_t>(dim), 1},
+                              1,
+                              1,
+                              VK_SAMPLE_COUNT_1_BIT,
+                              VK_IMAGE_USAGE_TRANSFER_DST_BIT | VK_IMAGE_USAGE_SAMPLED_BIT,
+                              0,
+                              false);
+    const VkDeviceSize sizeInBytes = static_cast<VkDeviceSize>(_width) * _height * _channels;
+    for (uint32_t i = 0; i < _ctx.getFramesInFlight(); ++i)
+    {
+        _stagingBuffers.push_back(_ctx.createStagingBuffer("julia texture staging " + std::to_string(i), sizeInBytes));
+    }
+}
+
+JuliaTextureCpu::~JuliaTextureCpu()
+{
+    for (const auto &stagingBuffer : _stagingBuffers)
+    {
+        vmaDestroyBuffer(_ctx.getVmaAllocator(),
+                         std::get<BUFFER_ENTITY_UID::BUFFER>(stagingBuffer),
+                         std::get<BUFFER_ENTITY_UID::VMA_ALLOCATION>(stagingBuffer));
+    }
+}
+
+void JuliaTextureCpu::generate(VkCommandBuffer commandBuffer, uint32_t currentFrameId)
+{
+    ZoneScopedN("JuliaTextureCpu::generate");
+    ASSERT(currentFrameId < _stagingBuffers.size(), "JuliaTextureCpu: one staging buffer per frame in flight");
+    _julia->setParams(_params.scaleFactor, _params.numIterations, _params.c);
+    _julia->generate(SIMD_KERNEL);
+
+    // the previous submission of this frame is done: its staging buffer is free
+    const auto &stagingBuffer = _stagingBuffers[currentFrameId];
+    const size_t sizeInBytes = static_cast<size_t>(_width) * _height * _channels;
+    memcpy(std::get<BUFFER_ENTITY_UID::VMA_ALLOCATION_INFO>(stagingBuffer).pMappedData, _julia->data(), sizeInBytes);
+
+    // WAR against the sampling of the previous frames, the old texels are discarded
+    imageBarrier(commandBuffer,
+                 VK_PIPELINE_STAGE_2_FRAGMENT_SHADER_BIT, VK_ACCESS_2_SHADER_SAMPLED_READ_BIT,
+                 VK_PIPELINE_STAGE_2_COPY_BIT, VK_ACCESS_2_TRANSFER_WRITE_BIT,
+                 VK_IMAGE_LAYOUT_UNDEFINED, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL);
+    const VkBufferImageCopy region{
+        .bufferOffset = 0,
+        .bufferRowLength = 0,
+        .bufferImageHeight = 0,
+        .imageSubresource = {
+            .aspectMask = VK_IMAGE_ASPECT_COLOR_BIT,
+            .mipLevel = 0,
+            .baseArrayLayer = 0,
+            .layerCount = 1,
+        },
+        .imageOffset = {0, 0, 0},
+        .imageExtent = std::get<IMAGE_ENTITY_OFFSET::IMAGE_EXTENT>(_image),
+    };
+    vkCmdCopyBufferToImage(commandBuffer,
+                           std::get<BUFFER_ENTITY_UID::BUFFER>(stagingBuffer),
+                           std::get<IMAGE_ENTITY_OFFSET::IMAGE>(_image),
+                           VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL,
+                           1,
+                           &region);
+    imageBarrier(commandBuffer,
+                 VK_PIPELINE_STAGE_2_COPY_BIT, VK_ACCESS_2_TRANSFER_WRITE_BIT,
+                 VK_PIPELINE_STAGE_2_FRAGMENT_SHADER_BIT, VK_ACCESS_2_SHADER_SAMPLED_READ_BIT,
+                 VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL);
+}
+
+JuliaTextureCompute::JuliaTextureCompute(VkContext &ctx, int dim, const JuliaParams &params)
+    : JuliaTexture(ctx, dim, params)
+{
+    auto logicalDevice = _ctx.getLogicDevice();
+    _image = _ctx.createImage("julia texture (compute)",
+                              VK_IMAGE_TYPE_2D,
+                              VK_FORMAT_R8G8B8A8_UNORM,
+                              {static_cast<uint32_t>(dim), static_cast<uint32_t>(dim), 1},
+                              1,
+                              1,
+                              VK_SAMPLE_COUNT_1_BIT,
+                              VK_IMAGE_USAGE_STORAGE_BIT | VK_IMAGE_USAGE_SAMPLED_BIT,
+                              0,
+                              false);
+
+    const auto computeShaderPath = getAssetPath() + "/julia.comp";
+    _csShaderModule = createShaderModule(
+        logicalDevice,
+        computeShaderPath,
+        "main",
+        "julia.comp");
+
+    // layout(set = 0, binding = 0, rgba8) uniform writeonly image2D outputImage;
+    std::vector<std::vector<VkDescriptorSetLayoutBinding>> setBindings(1);
+    setBindings[0].resize(1);
+    setBindings[0][0].binding = 0;
+    setBindings[0][0].descriptorType = VK_DESCRIPTOR_TYPE_STORAGE_IMAGE;
+    setBindings[0][0].descriptorCount = 1;
+    setBindings[0][0].stageFlags = VK_SHADER_STAGE_COMPUTE_BIT;
+    _descriptorSetLayouts = _ctx.createDescriptorSetLayout(setBindings);
+
+    _descriptorSetPool = _ctx.createDescriptorSetPool({{VK_DESCRIPTOR_TYPE_STORAGE_IMAGE, 1}}, 1);
+    auto descriptorSets = _ctx.allocateDescriptorSet(_descriptorSetPool, {{&_descriptorSetLayouts[0], 1}});
+    _descriptorSet = descriptorSets[&_descriptorSetLayouts[0]][0];
+
+    // written in GENERAL, sampled in SHADER_READ_ONLY_OPTIMAL
+    const VkDescriptorImageInfo imageInfo{
+        .sampler = VK_NULL_HANDLE,
+        .imageView = std::get<IMAGE_ENTITY_OFFSET::IMAGE_VIEW>(_image),
+        .imageLayout = VK_IMAGE_LAYOUT_GENERAL,
+    };
+    const VkWriteDescriptorSet write{
+        .sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET,
+        .dstSet = _descriptorSet,
+        .dstBinding = 0,
+        .dstArrayElement = 0,
+        .descriptorCount = 1,
+        .descriptorType = VK_DESCRIPTOR_TYPE_STORAGE_IMAGE,
+        .pImageInfo = &imageInfo,
+    };
+    vkUpdateDescriptorSets(logicalDevice, 1, &write, 0, nullptr);
+
+    const std::string entryPoint{"main"};
+    _computePipelineEntity = _ctx.createComputePipeline(
+        {{VK_SHADER_STAGE_COMPUTE_BIT,
+          std::make_tuple(_csShaderModule, entryPoint.c_str(), nullptr)}},
+        _descriptorSetLayouts,
+        {{
+            .stageFlags = VK_SHADER_STAGE_COMPUTE_BIT,
+            .offset = 0,
+            .size = sizeof(PushConstants),
+        }});
+}
+
+JuliaTextureCompute::~JuliaTextureCompute()
+{
+    auto logicalDevice = _ctx.getLogicDevice();
+    vkDestroyPipeline(logicalDevice, std::get<0>(_computePipelineEntity), nullptr);
+    vkDestroyPipelineLayout(logicalDevice, std::get<1>(_computePipelineEntity), nullptr);
+    vkDestroyDescriptorPool(logicalDevice, _descriptorSetPool, nullptr);
+    for (const auto &descriptorSetLayout : _descriptorSetLayouts)
+    {
+        vkDestroyDescriptorSetLayout(logicalDevice, descriptorSetLayout, nullptr);
+    }
+    vkDestroyShaderModule(logicalDevice, _csShaderModule, nullptr);
+}
+
+void JuliaTextureCompute::generate(VkCommandBuffer commandBuffer, uint32_t currentFrameId)
+{
+    const auto computePipelineHandle = std::get<0>(_computePipelineEntity);
+    const auto computePipelineLayout = std::get<1>(_computePipelineEntity);
+    const PushConstants pushConstants{
+        .cr = _params.c.r,
+        .ci = _params.c.i,
+        .scaleFactor = _params.scaleFactor,
+        .numIterations = _params.numIterations,
+    };
+
+    // WAR against the sampling of the previous frames, every texel is rewritten
+    imageBarrier(commandBuffer,
+                 VK_PIPELINE_STAGE_2_FRAGMENT_SHADER_BIT, VK_ACCESS_2_SHADER_SAMPLED_READ_BIT,
+                 VK_PIPELINE_STAGE_2_COMPUTE_SHADER_BIT, VK_ACCESS_2_SHADER_STORAGE_WRITE_BIT,
+                 VK_IMAGE_LAYOUT_UNDEFINED, VK_IMAGE_LAYOUT_GENERAL);
+    vkCmdBindPipeline(commandBuffer, VK_PIPELINE_BIND_POINT_COMPUTE, computePipelineHandle);
+    vkCmdBindDescriptorSets(commandBuffer, VK_PIPELINE_BIND_POINT_COMPUTE, computePipelineLayout, 0, 1,
+                            &_descriptorSet, 0, nullptr);
+    vkCmdPushConstants(commandBuffer, computePipelineLayout, VK_SHADER_STAGE_COMPUTE_BIT, 0,
+                       sizeof(PushConstants), &pushConstants);
+    vkCmdDispatch(commandBuffer,
+                  (_width + WORKGROUP_SIZE - 1) / WORKGROUP_SIZE,
+                  (_height + WORKGROUP_SIZE - 1) / WORKGROUP_SIZE,
+                  1);
+    imageBarrier(commandBuffer,
+                 VK_PIPELINE_STAGE_2_COMPUTE_SHADER_BIT, VK_ACCESS_2_SHADER_STORAGE_WRITE_BIT,
+                 VK_PIPELINE_STAGE_2_FRAGMENT_SHADER_BIT, VK_ACCESS_2_SHADER_SAMPLED_READ_BIT,
+                 VK_IMAGE_LAYOUT_GENERAL, VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL);
+}
+
+JuliaTextureCuda::JuliaTextureCuda(VkContext &ctx, int dim, const JuliaParams &params)
+    : JuliaTexture(ctx, dim, params)
+{
+    auto logicalDevice = _ctx.getLogicDevice();
+    _image = _ctx.createExportableImage("julia texture (cuda)",
+                                        VK_IMAGE_TYPE_2D,
+                                        VK_FORMAT_R8G8B8A8_UNORM,
+                                        {static_cast<uint32_t>(dim), static_cast<uint32_t>(dim), 1},
+                                        1,
+                                        VK_SAMPLE_COUNT_1_BIT,
+                                        VK_IMAGE_USAGE_SAMPLED_BIT | VK_IMAGE_USAGE_TRANSFER_DST_BIT);
+    const auto &allocationInfo = std::get<IMAGE_ENTITY_OFFSET::IMAGE_VMA_ALLOCATION_INFO>(_image);
+    _timelineSemaphore = _ctx.createExportableSemaphore(VK_SEMAPHORE_TYPE_TIMELINE, _timelineValue);
+
+    // dedicated allocation: the whole VkDeviceMemory is the image
+#ifdef _WIN64
+    HANDLE memoryHandle = cudaEngine::getVkImageMemoryHandle(logicalDevice, allocationInfo.deviceMemory,
+                                                             VK_EXTERNAL_MEMORY_HANDLE_TYPE_OPAQUE_WIN32_BIT);
+    HANDLE semaphoreHandle = cudaEngine::getVkSemaphoreHandle(logicalDevice, VK_EXTERNAL_SEMAPHORE_HANDLE_TYPE_OPAQUE_WIN32_BIT,
+                                                              _timelineSemaphore);
+#else
+    // owned by cuda once imported
+    int memoryHandle = cudaEngine::getVkImageMemHandle(logicalDevice, allocationInfo.deviceMemory,
+                                                       VK_EXTERNAL_MEMORY_HANDLE_TYPE_OPAQUE_FD_BIT);
+    int semaphoreHandle = cudaEngine::getVkSemaphoreHandle(logicalDevice, VK_EXTERNAL_SEMAPHORE_HANDLE_TYPE_OPAQUE_FD_BIT,
+                                                           _timelineSemaphore);
+#endif
+    _externalMemory = cudaEngine::importVkMemory(memoryHandle, allocationInfo.size);
+    _externalSemaphore = cudaEngine::importVkSemaphore(semaphoreHandle, true);
+#ifdef _WIN64
+    // the imports keep their own reference
+    CloseHandle(memoryHandle);
+    CloseHandle(semaphoreHandle);
+#endif
+
+    _surface = cudaEngine::mapVkImage(_externalMemory, dim, dim, cudaCreateChannelDesc<uchar4>(), _mipmappedArray);
+    CUDA_CHECK(cudaStreamCreateWithFlags(&_stream, cudaStreamNonBlocking));
+
+    // cuda writes the texels in place: the image stays in SHADER_READ_ONLY_OPTIMAL
+    auto cmdBuffer = _ctx.getCommandBufferForIO();
+    _ctx.BeginRecordCommandBuffer(cmdBuffer);
+    imageBarrier(std::get<COMMAND_BUFFER_ENTITY_OFFSET::COMMAND_BUFFER>(cmdBuffer),
+                 VK_PIPELINE_STAGE_2_NONE, VK_ACCESS_2_NONE,
+                 VK_PIPELINE_STAGE_2_FRAGMENT_SHADER_BIT, VK_ACCESS_2_SHADER_SAMPLED_READ_BIT,
+                 VK_IMAGE_LAYOUT_UNDEFINED, VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL);
+    _ctx.EndRecordCommandBuffer(cmdBuffer);
+    waitTimelinePoints(logicalDevice, {_ctx.submitCommandBuffer(cmdBuffer)});
+}
+
+JuliaTextureCuda::~JuliaTextureCuda()
+{
+    CUDA_CHECK(cudaStreamSynchronize(_stream));
+    CUDA_CHECK(cudaDestroySurfaceObject(_surface));
+    CUDA_CHECK(cudaFreeMipmappedArray(_mipmappedArray));
+    CUDA_CHECK(cudaDestroyExternalMemory(_externalMemory));
+    CUDA_CHECK(cudaDestroyExternalSemaphore(_externalSemaphore));
+    CUDA_CHECK(cudaStreamDestroy(_stream));
+    vkDestroySemaphore(_ctx.getLogicDevice(), _timelineSemaphore, nullptr);
+}
+
+void JuliaTextureCuda::generate(VkCommandBuffer commandBuffer, uint32_t currentFrameId)
+{
+    ZoneScopedN("JuliaTextureCuda::generate");
+    // the submissions sampling the image so far are ahead of the kernel (WAR), stream ordered on the device
+    cudaEngine::waitVkSemaphore(_externalSemaphore, _timelineValue, _stream);
+    cudaEngine::launchJuliaKernel(_surface, _width, _height,
+                                  _params.scaleFactor, _params.numIterations, _params.c.r, _params.c.i,
+                                  _stream);
+    _kernelValue = ++_timelineValue;
+    cudaEngine::signalVkSemaphore(_externalSemaphore, _kernelValue, _stream);
+}
+
+void JuliaTextureCuda::appendSubmitSemaphores(std::vector<VkSemaphoreSubmitInfo> &waits,
+                                              std::vector<VkSemaphoreSubmitInfo> &signals)
+{
+    // RAW: the texels of the kernel before the sampling
+    if (_kernelValue != 0)
+    {
+        waits.push_back(timelineWait({_timelineSemaphore, _kernelValue}, VK_PIPELINE_STAGE_2_FRAGMENT_SHADER_BIT));
+        _kernelValue = 0;
+    }
+    signals.push_back(timelineSignal({_timelineSemaphore, ++_timelineValue}, VK_PIPELINE_STAGE_2_FRAGMENT_SHADER_BIT));
+}
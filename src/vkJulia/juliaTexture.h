@@ -0,0 +1,132 @@
+#pragma once
+
+#include <memory>
+#include <vector>
+
+#include <cuda.h>
+#include <cuda_runtime.h>
+
+#include <proceduralTexture.h>
+#include <julia.h>
+
+// julia set parameters, setParams() between two frames: regenerated by the next record(), no upload
+struct JuliaParams
+{
+    float scaleFactor{1.5f};
+    int numIterations{200};
+    cuComplexf c{-0.88f, 0.18f};
+};
+
+enum JULIA_BACKEND : int
+{
+    // JuliaSet simd kernel into a per-frame staging buffer, copied into the image
+    CPU_SIMD_BACKEND = 0,
+    // julia.comp, imageStore into the sampled image
+    VULKAN_COMPUTE_BACKEND,
+    // cuda kernel writing the image memory exported to cuda (opaque win32 handle / opaque fd),
+    // VULKAN_COMPUTE_BACKEND when !VkContext::isExternalInteropSupported()
+    CUDA_INTEROP_BACKEND,
+};
+
+// the julia set as a rgba8 procedural texture, one backend per generator
+class JuliaTexture : public ProceduralTexture
+{
+public:
+    static std::unique_ptr<JuliaTexture> create(VkContext &ctx, JULIA_BACKEND backend, int dim, const JuliaParams &params);
+
+    const JuliaParams &params() const
+    {
+        return _params;
+    }
+
+    void setParams(const JuliaParams &params)
+    {
+        _params = params;
+        invalidate();
+    }
+
+protected:
+    JuliaTexture(VkContext &ctx, int dim, const JuliaParams &params)
+        : ProceduralTexture(ctx, dim), _params{params}
+    {
+    }
+
+    JuliaParams _params;
+};
+
+class JuliaTextureCpu : public JuliaTexture
+{
+public:
+    JuliaTextureCpu(VkContext &ctx, int dim, const JuliaParams &params);
+    ~JuliaTextureCpu();
+
+    // the last generation
+    virtual void *data() override
+    {
+        return _julia->data();
+    }
+
+protected:
+    virtual void generate(VkCommandBuffer commandBuffer, uint32_t currentFrameId) override;
+
+private:
+    std::unique_ptr<JuliaSet> _julia;
+    // one per frame in flight, persistently mapped
+    std::vector<BufferEntity> _stagingBuffers;
+};
+
+class JuliaTextureCompute : public JuliaTexture
+{
+public:
+    JuliaTextureCompute(VkContext &ctx, int dim, const JuliaParams &params);
+    ~JuliaTextureCompute();
+
+protected:
+    virtual void generate(VkCommandBuffer commandBuffer, uint32_t currentFrameId) override;
+
+private:
+    // layout(push_constant) in julia.comp
+    struct PushConstants
+    {
+        float cr;
+        float ci;
+        float scaleFactor;
+        int32_t numIterations;
+    };
+
+    static constexpr uint32_t WORKGROUP_SIZE = 16;
+
+    VkShaderModule _csShaderModule{VK_NULL_HANDLE};
+    std::vector<VkDescriptorSetLayout> _descriptorSetLayouts;
+    VkDescriptorPool _descriptorSetPool{VK_NULL_HANDLE};
+    VkDescriptorSet _descriptorSet{VK_NULL_HANDLE};
+    std::tuple<VkPipeline, VkPipelineLayout> _computePipelineEntity;
+};
+
+// ordered against the frames by a timeline semaphore shared with cuda, the host never waits:
+// every frame sampling the image signals the next value, the kernel waits on the last one (WAR) and signals
+// the next, the frame after the kernel waits on that (RAW)
+class JuliaTextureCuda : public JuliaTexture
+{
+public:
+    JuliaTextureCuda(VkContext &ctx, int dim, const JuliaParams &params);
+    ~JuliaTextureCuda();
+
+    virtual void appendSubmitSemaphores(std::vector<VkSemaphoreSubmitInfo> &waits,
+                                        std::vector<VkSemaphoreSubmitInfo> &signals) override;
+
+protected:
+    virtual void generate(VkCommandBuffer commandBuffer, uint32_t currentFrameId) override;
+
+private:
+    VkSemaphore _timelineSemaphore{VK_NULL_HANDLE};
+    cudaExternalSemaphore_t _externalSemaphore{nullptr};
+    // last value signaled (or to be signaled) on the timeline, by the queue or by cuda
+    uint64_t _timelineValue{0};
+    // signaled by the last kernel, the next submission waits on it. 0: no kernel since
+    uint64_t _kernelValue{0};
+    cudaExternalMemory_t _externalMemory{nullptr};
+    cudaMipmappedArray_t _mipmappedArray{nullptr};
+    cudaSurfaceObject_t _surface{0};
+    cudaStream_t _stream{nullptr};
+};
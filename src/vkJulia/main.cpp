@@ -10,6 +10,9 @@
 #include <iterator>
 #include <numeric>
 #include <array>
+#include <string>
+#include <string_view>
+#include <charconv>
 #include <filesystem> // for shader
 
 #include <cuDevice.h>
@@ -31,6 +34,7 @@
 
 #include <application.h>
 #include <context.h>
+#include <julia.h>
 #include <arcballCamera.h>
 
 using namespace cudaEngine;
@@ -92,8 +96,59 @@ inline const std::set<std::string> &getInstanceExtensions()
     return instanceExtensions;
 }
 
+JuliaConfig parseJuliaConfig(int argc, char **argv)
+{
+    JuliaConfig config;
+    for (int i = 1; i < argc; ++i)
+    {
+        const std::string arg = argv[i];
+        if (arg == "--julia-backend=cpu")
+        {
+            config.backend = CPU_SIMD_BACKEND;
+        }
+        else if (arg == "--julia-backend=compute")
+        {
+            config.backend = VULKAN_COMPUTE_BACKEND;
+        }
+        else if (arg == "--julia-backend=cuda")
+        {
+            config.backend = CUDA_INTEROP_BACKEND;
+        }
+        else if (arg.starts_with("--julia-dim="))
+        {
+            // not a positive number: warned, the default dim stays
+            const auto value = std::string_view(arg).substr(std::string("--julia-dim=").size());
+            int dim = 0;
+            const auto [end, ec] = std::from_chars(value.data(), value.data() + value.size(), dim);
+            if (ec != std::errc() || end != value.data() + value.size() || dim <= 0)
+            {
+                log(Level::Warn, "ignoring ", arg, ": not a positive number, the default ", config.dim, " is kept");
+                continue;
+            }
+            config.dim = dim;
+        }
+        else if (arg == "--julia-animate")
+        {
+            config.animate = true;
+        }
+    }
+    return config;
+}
+
 int main(int argc, char **argv)
 {
+    // --julia-bench: scalar vs simd julia kernel, no window, no vulkan
+    for (int i = 1; i < argc; ++i)
+    {
+        if (std::string(argv[i]) == "--julia-bench")
+        {
+            const auto results = JuliaSet::benchmark({1024, 4096, 8192}, {64, 256, 1024}, 1.5f, cuComplexf(-0.88f, 0.18f));
+            const bool identical = std::all_of(results.begin(), results.end(), [](const auto &result)
+                                               { return result.identical; });
+            return identical ? 0 : 1;
+        }
+    }
+
     selectDevice();
     
     ArcballCamera _orbitCamera{
@@ -157,7 +212,7 @@ int main(int argc, char **argv)
                   instanceExtensions,
                   deviceExtensions);
 
-    VkApplication vkApp(ctx);
+    VkApplication vkApp(ctx, parseJuliaConfig(argc, argv));
     vkApp.init();
 
     // init();
@@ -172,6 +227,8 @@ int main(int argc, char **argv)
         gDt = static_cast<double>(
             (currTime - gLastFrame) / static_cast<double>(SDL_GetPerformanceFrequency()));
         gLastFrame = currTime;
+        // paced before the input is sampled
+        ctx.getFramePacer().beginFrame();
         window.pollEvents();
         vkApp.renderPerFrame();
     }
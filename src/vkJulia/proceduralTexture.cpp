@@ -0,0 +1,83 @@
+#include <proceduralTexture.h>
+#include <queueTimeline.h>
+
+#include <tracy/Tracy.hpp>
+
+ProceduralTexture::ProceduralTexture(VkContext &ctx, int dim)
+    : _ctx{ctx}
+{
+    _width = dim;
+    _height = dim;
+    _channels = 4;
+}
+
+ProceduralTexture::~ProceduralTexture()
+{
+    const auto image = std::get<IMAGE_ENTITY_OFFSET::IMAGE>(_image);
+    if (image == VK_NULL_HANDLE)
+    {
+        return;
+    }
+    vkDestroyImageView(_ctx.getLogicDevice(), std::get<IMAGE_ENTITY_OFFSET::IMAGE_VIEW>(_image), nullptr);
+    vmaDestroyImage(_ctx.getVmaAllocator(), image, std::get<IMAGE_ENTITY_OFFSET::IMAGE_VMA_ALLOCATION>(_image));
+}
+
+void ProceduralTexture::record(CommandBufferEntity &cmdBuffer, uint32_t currentFrameId)
+{
+    if (!_dirty)
+    {
+        return;
+    }
+    ZoneScopedN("ProceduralTexture::record");
+    generate(std::get<COMMAND_BUFFER_ENTITY_OFFSET::COMMAND_BUFFER>(cmdBuffer), currentFrameId);
+    _dirty = false;
+}
+
+void ProceduralTexture::generateNow()
+{
+    ZoneScopedN("ProceduralTexture::generateNow");
+    auto cmdBuffer = _ctx.getCommandBufferForIO();
+    _ctx.BeginRecordCommandBuffer(cmdBuffer);
+    generate(std::get<COMMAND_BUFFER_ENTITY_OFFSET::COMMAND_BUFFER>(cmdBuffer), 0);
+    _ctx.EndRecordCommandBuffer(cmdBuffer);
+    std::vector<VkSemaphoreSubmitInfo> waits;
+    std::vector<VkSemaphoreSubmitInfo> signals;
+    appendSubmitSemaphores(waits, signals);
+    waitTimelinePoints(_ctx.getLogicDevice(), {_ctx.submitCommandBuffer(cmdBuffer, waits, signals)});
+    _dirty = false;
+}
+
+void ProceduralTexture::imageBarrier(VkCommandBuffer commandBuffer,
+                                     VkPipelineStageFlags2 srcStageMask,
+                                     VkAccessFlags2 srcAccessMask,
+                                     VkPipelineStageFlags2 dstStageMask,
+                                     VkAccessFlags2 dstAccessMask,
+                                     VkImageLayout oldLayout,
+                                     VkImageLayout newLayout) const
+{
+    const VkImageMemoryBarrier2 barrier{
+        .sType = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER_2,
+        .srcStageMask = srcStageMask,
+        .srcAccessMask = srcAccessMask,
+        .dstStageMask = dstStageMask,
+        .dstAccessMask = dstAccessMask,
+        .oldLayout = oldLayout,
+        .newLayout = newLayout,
+        .srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED,
+        .dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED,
+        .image = std::get<IMAGE_ENTITY_OFFSET::IMAGE>(_image),
+        .subresourceRange = {
+            .aspectMask = VK_IMAGE_ASPECT_COLOR_BIT,
+            .baseMipLevel = 0,
+            .levelCount = 1,
+            .baseArrayLayer = 0,
+            .layerCount = 1,
+        },
+    };
+    const VkDependencyInfo dependency{
+        .sType = VK_STRUCTURE_TYPE_DEPENDENCY_INFO,
+        .imageMemoryBarrierCount = 1,
+        .pImageMemoryBarriers = &barrier,
+    };
+    vkCmdPipelineBarrier2(commandBuffer, &dependency);
+}
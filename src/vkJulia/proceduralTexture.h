@@ -0,0 +1,73 @@
+#pragma once
+
+#include <context.h>
+#include <scene.h>
+
+// texture generated on the host or on the device, sampled in place by the passes
+// 1. image(): one mip level, VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL between two generations
+// 2. invalidate() whenever the inputs of the generator change (render thread)
+// 3. record() once per frame into the frame's command buffer, ahead of the pass sampling image():
+//    an invalidated texture is regenerated there, nothing is recorded otherwise
+// generateNow(): the same through the IO command buffer, waited on: first content, prerecorded command buffers
+// 4. appendSubmitSemaphores() into the submission of every frame sampling image(): generators off the queue (cuda)
+class ProceduralTexture : public ITexture
+{
+public:
+    ProceduralTexture() = delete;
+    virtual ~ProceduralTexture();
+
+    ProceduralTexture(const ProceduralTexture &other) = delete;
+    ProceduralTexture &operator=(const ProceduralTexture &other) = delete;
+
+    // texels on the host, nullptr when they only exist on the device
+    virtual void *data() override
+    {
+        return nullptr;
+    }
+
+    const ImageEntity &image() const
+    {
+        return _image;
+    }
+
+    void invalidate()
+    {
+        _dirty = true;
+    }
+
+    bool isDirty() const
+    {
+        return _dirty;
+    }
+
+    // after BeginRecordCommandBuffer of the frame: the previous submission of currentFrameId is done
+    void record(CommandBufferEntity &cmdBuffer, uint32_t currentFrameId);
+    // no frame in flight
+    void generateNow();
+
+    // waits/signals of the shared semaphores, after record(), once per submission
+    virtual void appendSubmitSemaphores(std::vector<VkSemaphoreSubmitInfo> &waits,
+                                        std::vector<VkSemaphoreSubmitInfo> &signals)
+    {
+    }
+
+protected:
+    ProceduralTexture(VkContext &ctx, int dim);
+
+    // records the generation into commandBuffer (host work included), image() ends in SHADER_READ_ONLY_OPTIMAL
+    virtual void generate(VkCommandBuffer commandBuffer, uint32_t currentFrameId) = 0;
+
+    // whole image, one mip level
+    void imageBarrier(VkCommandBuffer commandBuffer,
+                      VkPipelineStageFlags2 srcStageMask,
+                      VkAccessFlags2 srcAccessMask,
+                      VkPipelineStageFlags2 dstStageMask,
+                      VkAccessFlags2 dstAccessMask,
+                      VkImageLayout oldLayout,
+                      VkImageLayout newLayout) const;
+
+    VkContext &_ctx;
+    // owned
+    ImageEntity _image{};
+    bool _dirty{true};
+};
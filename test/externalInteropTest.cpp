@@ -0,0 +1,272 @@
+#include <set>
+#include <string>
+#include <vector>
+#include <cstring>
+
+#include <context.h>
+#include <testing.h>
+
+#ifdef _WIN64
+#include <windows.h>
+#endif
+
+// the handle types of VkContext::createExportableBuffer / createExportableSemaphore
+#ifdef _WIN64
+constexpr VkExternalMemoryHandleTypeFlagBits MEMORY_HANDLE_TYPE = VK_EXTERNAL_MEMORY_HANDLE_TYPE_OPAQUE_WIN32_BIT;
+constexpr VkExternalSemaphoreHandleTypeFlagBits SEMAPHORE_HANDLE_TYPE = VK_EXTERNAL_SEMAPHORE_HANDLE_TYPE_OPAQUE_WIN32_BIT;
+#else
+constexpr VkExternalMemoryHandleTypeFlagBits MEMORY_HANDLE_TYPE = VK_EXTERNAL_MEMORY_HANDLE_TYPE_OPAQUE_FD_BIT;
+constexpr VkExternalSemaphoreHandleTypeFlagBits SEMAPHORE_HANDLE_TYPE = VK_EXTERNAL_SEMAPHORE_HANDLE_TYPE_OPAQUE_FD_BIT;
+#endif
+
+namespace
+{
+    constexpr VkDeviceSize BUFFER_SIZE = 4096;
+    constexpr uint32_t PATTERN = 0xC0FFEE42u;
+
+    // VkContext asserts without a physical device: a throwaway instance to skip first
+    bool hasPhysicalDevice()
+    {
+        const VkApplicationInfo appInfo{
+            .sType = VK_STRUCTURE_TYPE_APPLICATION_INFO,
+            .apiVersion = VK_API_VERSION_1_3,
+        };
+        const VkInstanceCreateInfo instanceInfo{
+            .sType = VK_STRUCTURE_TYPE_INSTANCE_CREATE_INFO,
+            .pApplicationInfo = &appInfo,
+        };
+        VkInstance instance{VK_NULL_HANDLE};
+        if (vkCreateInstance(&instanceInfo, nullptr, &instance) != VK_SUCCESS)
+        {
+            return false;
+        }
+        volkLoadInstanceOnly(instance);
+        uint32_t count = 0;
+        vkEnumeratePhysicalDevices(instance, &count, nullptr);
+        vkDestroyInstance(instance, nullptr);
+        return count > 0;
+    }
+
+    // the exported memory imported into a second VkDeviceMemory: a fill through the exported buffer
+    // is read back through the imported one
+    void testBufferRoundTrip(VkContext &ctx)
+    {
+        const auto logicalDevice = ctx.getLogicDevice();
+        const auto exported = ctx.createExportableBuffer(
+            "interop test (exported)",
+            BUFFER_SIZE,
+            VK_BUFFER_USAGE_STORAGE_BUFFER_BIT | VK_BUFFER_USAGE_TRANSFER_SRC_BIT |
+                VK_BUFFER_USAGE_TRANSFER_DST_BIT | VK_BUFFER_USAGE_SHADER_DEVICE_ADDRESS_BIT,
+            VK_SHARING_MODE_EXCLUSIVE);
+        const auto &allocationInfo = std::get<BUFFER_ENTITY_UID::VMA_ALLOCATION_INFO>(exported);
+        const auto handle = std::get<BUFFER_ENTITY_UID::EXPORT_HANDLE>(exported);
+        CHECK(handle != nullptr);
+
+        const VkExternalMemoryBufferCreateInfo externalBufferInfo{
+            .sType = VK_STRUCTURE_TYPE_EXTERNAL_MEMORY_BUFFER_CREATE_INFO,
+            .handleTypes = MEMORY_HANDLE_TYPE,
+        };
+        const VkBufferCreateInfo bufferInfo{
+            .sType = VK_STRUCTURE_TYPE_BUFFER_CREATE_INFO,
+            .pNext = &externalBufferInfo,
+            .size = BUFFER_SIZE,
+            .usage = VK_BUFFER_USAGE_TRANSFER_SRC_BIT,
+            .sharingMode = VK_SHARING_MODE_EXCLUSIVE,
+        };
+        VkBuffer imported{VK_NULL_HANDLE};
+        VK_CHECK(vkCreateBuffer(logicalDevice, &bufferInfo, nullptr, &imported));
+        VkMemoryRequirements requirements;
+        vkGetBufferMemoryRequirements(logicalDevice, imported, &requirements);
+        CHECK(requirements.memoryTypeBits & (1u << allocationInfo.memoryType));
+        CHECK(requirements.size <= allocationInfo.size);
+
+        // same size and memory type as the exporter, device address as vma allocates it
+        const VkMemoryAllocateFlagsInfo allocateFlags{
+            .sType = VK_STRUCTURE_TYPE_MEMORY_ALLOCATE_FLAGS_INFO,
+            .flags = VK_MEMORY_ALLOCATE_DEVICE_ADDRESS_BIT,
+        };
+#ifdef _WIN64
+        const VkImportMemoryWin32HandleInfoKHR importInfo{
+            .sType = VK_STRUCTURE_TYPE_IMPORT_MEMORY_WIN32_HANDLE_INFO_KHR,
+            .pNext = &allocateFlags,
+            .handleType = MEMORY_HANDLE_TYPE,
+            .handle = handle,
+        };
+#else
+        // the driver owns the fd once the import succeeds
+        const VkImportMemoryFdInfoKHR importInfo{
+            .sType = VK_STRUCTURE_TYPE_IMPORT_MEMORY_FD_INFO_KHR,
+            .pNext = &allocateFlags,
+            .handleType = MEMORY_HANDLE_TYPE,
+            .fd = static_cast<int>(reinterpret_cast<intptr_t>(handle)),
+        };
+#endif
+        const VkMemoryAllocateInfo allocateInfo{
+            .sType = VK_STRUCTURE_TYPE_MEMORY_ALLOCATE_INFO,
+            .pNext = &importInfo,
+            .allocationSize = allocationInfo.size,
+            .memoryTypeIndex = allocationInfo.memoryType,
+        };
+        VkDeviceMemory importedMemory{VK_NULL_HANDLE};
+        VK_CHECK(vkAllocateMemory(logicalDevice, &allocateInfo, nullptr, &importedMemory));
+#ifdef _WIN64
+        // the import keeps its own reference
+        CloseHandle(handle);
+#endif
+        VK_CHECK(vkBindBufferMemory(logicalDevice, imported, importedMemory, 0));
+
+        const auto readback = ctx.createPersistentBuffer(
+            "interop test (readback)",
+            BUFFER_SIZE,
+            VK_BUFFER_USAGE_TRANSFER_DST_BIT,
+            VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT,
+            VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT | VK_MEMORY_PROPERTY_HOST_CACHED_BIT);
+        auto cmdBuffer = ctx.getCommandBufferForIO();
+        ctx.BeginRecordCommandBuffer(cmdBuffer);
+        {
+            const auto commandBuffer = std::get<COMMAND_BUFFER_ENTITY_OFFSET::COMMAND_BUFFER>(cmdBuffer);
+            vkCmdFillBuffer(commandBuffer, std::get<BUFFER_ENTITY_UID::BUFFER>(exported), 0, BUFFER_SIZE, PATTERN);
+            // the two buffers alias the same memory: a global barrier orders the fill before the copy
+            const VkMemoryBarrier2 barrier{
+                .sType = VK_STRUCTURE_TYPE_MEMORY_BARRIER_2,
+                .srcStageMask = VK_PIPELINE_STAGE_2_TRANSFER_BIT,
+                .srcAccessMask = VK_ACCESS_2_TRANSFER_WRITE_BIT,
+                .dstStageMask = VK_PIPELINE_STAGE_2_TRANSFER_BIT,
+                .dstAccessMask = VK_ACCESS_2_TRANSFER_READ_BIT,
+            };
+            const VkDependencyInfo dependency{
+                .sType = VK_STRUCTURE_TYPE_DEPENDENCY_INFO,
+                .memoryBarrierCount = 1,
+                .pMemoryBarriers = &barrier,
+            };
+            vkCmdPipelineBarrier2(commandBuffer, &dependency);
+            const VkBufferCopy region{0, 0, BUFFER_SIZE};
+            vkCmdCopyBuffer(commandBuffer, imported, std::get<BUFFER_ENTITY_UID::BUFFER>(readback), 1, &region);
+        }
+        ctx.EndRecordCommandBuffer(cmdBuffer);
+        waitTimelinePoints(logicalDevice, {ctx.submitCommandBuffer(cmdBuffer)});
+
+        std::vector<uint32_t> words(BUFFER_SIZE / sizeof(uint32_t));
+        std::memcpy(words.data(), std::get<BUFFER_ENTITY_UID::MAPPING_ADDRESS>(readback), BUFFER_SIZE);
+        CHECK_EQ(words.front(), PATTERN);
+        CHECK_EQ(words.back(), PATTERN);
+
+        vkDestroyBuffer(logicalDevice, imported, nullptr);
+        vkFreeMemory(logicalDevice, importedMemory, nullptr);
+    }
+
+    // the exported timeline imported into a second semaphore: a signal on either is seen by the other
+    void testTimelineSemaphoreRoundTrip(VkContext &ctx)
+    {
+        const auto logicalDevice = ctx.getLogicDevice();
+        const auto exported = ctx.createExportableSemaphore(VK_SEMAPHORE_TYPE_TIMELINE, 0);
+
+        const VkSemaphoreTypeCreateInfo typeInfo{
+            .sType = VK_STRUCTURE_TYPE_SEMAPHORE_TYPE_CREATE_INFO,
+            .semaphoreType = VK_SEMAPHORE_TYPE_TIMELINE,
+        };
+        const VkSemaphoreCreateInfo semaphoreInfo{
+            .sType = VK_STRUCTURE_TYPE_SEMAPHORE_CREATE_INFO,
+            .pNext = &typeInfo,
+        };
+        VkSemaphore imported{VK_NULL_HANDLE};
+        VK_CHECK(vkCreateSemaphore(logicalDevice, &semaphoreInfo, nullptr, &imported));
+
+#ifdef _WIN64
+        const VkSemaphoreGetWin32HandleInfoKHR getHandleInfo{
+            .sType = VK_STRUCTURE_TYPE_SEMAPHORE_GET_WIN32_HANDLE_INFO_KHR,
+            .semaphore = exported,
+            .handleType = SEMAPHORE_HANDLE_TYPE,
+        };
+        HANDLE handle{nullptr};
+        VK_CHECK(vkGetSemaphoreWin32HandleKHR(logicalDevice, &getHandleInfo, &handle));
+        const VkImportSemaphoreWin32HandleInfoKHR importInfo{
+            .sType = VK_STRUCTURE_TYPE_IMPORT_SEMAPHORE_WIN32_HANDLE_INFO_KHR,
+            .semaphore = imported,
+            .handleType = SEMAPHORE_HANDLE_TYPE,
+            .handle = handle,
+        };
+        VK_CHECK(vkImportSemaphoreWin32HandleKHR(logicalDevice, &importInfo));
+        CloseHandle(handle);
+#else
+        const VkSemaphoreGetFdInfoKHR getFdInfo{
+            .sType = VK_STRUCTURE_TYPE_SEMAPHORE_GET_FD_INFO_KHR,
+            .semaphore = exported,
+            .handleType = SEMAPHORE_HANDLE_TYPE,
+        };
+        int fd{-1};
+        VK_CHECK(vkGetSemaphoreFdKHR(logicalDevice, &getFdInfo, &fd));
+        // the driver owns the fd once the import succeeds
+        const VkImportSemaphoreFdInfoKHR importInfo{
+            .sType = VK_STRUCTURE_TYPE_IMPORT_SEMAPHORE_FD_INFO_KHR,
+            .semaphore = imported,
+            .handleType = SEMAPHORE_HANDLE_TYPE,
+            .fd = fd,
+        };
+        VK_CHECK(vkImportSemaphoreFdKHR(logicalDevice, &importInfo));
+#endif
+
+        const VkSemaphoreSignalInfo signalExported{
+            .sType = VK_STRUCTURE_TYPE_SEMAPHORE_SIGNAL_INFO,
+            .semaphore = exported,
+            .value = 5,
+        };
+        VK_CHECK(vkSignalSemaphore(logicalDevice, &signalExported));
+        uint64_t value = 0;
+        VK_CHECK(vkGetSemaphoreCounterValue(logicalDevice, imported, &value));
+        CHECK_EQ(value, uint64_t(5));
+
+        const VkSemaphoreSignalInfo signalImported{
+            .sType = VK_STRUCTURE_TYPE_SEMAPHORE_SIGNAL_INFO,
+            .semaphore = imported,
+            .value = 9,
+        };
+        VK_CHECK(vkSignalSemaphore(logicalDevice, &signalImported));
+        VK_CHECK(vkGetSemaphoreCounterValue(logicalDevice, exported, &value));
+        CHECK_EQ(value, uint64_t(9));
+
+        vkDestroySemaphore(logicalDevice, imported, nullptr);
+        vkDestroySemaphore(logicalDevice, exported, nullptr);
+    }
+}
+
+int main()
+{
+    if (volkInitialize() != VK_SUCCESS || !hasPhysicalDevice())
+    {
+        log(Level::Warn, "no vulkan device: skipped");
+        return TEST_SKIPPED;
+    }
+
+    const std::set<std::string> instanceExtensions{
+        VK_KHR_GET_PHYSICAL_DEVICE_PROPERTIES_2_EXTENSION_NAME,
+        VK_KHR_EXTERNAL_MEMORY_CAPABILITIES_EXTENSION_NAME,
+        VK_KHR_EXTERNAL_SEMAPHORE_CAPABILITIES_EXTENSION_NAME,
+        VK_KHR_EXTERNAL_FENCE_CAPABILITIES_EXTENSION_NAME,
+        // the context always creates its debug messenger
+        VK_EXT_DEBUG_UTILS_EXTENSION_NAME,
+    };
+    // headless: the ones the device lacks are dropped, isExternalInteropSupported tells
+    const std::vector<const char *> deviceExtensions{
+        VK_KHR_EXTERNAL_MEMORY_EXTENSION_NAME,
+        VK_KHR_EXTERNAL_SEMAPHORE_EXTENSION_NAME,
+#ifdef _WIN64
+        VK_KHR_EXTERNAL_MEMORY_WIN32_EXTENSION_NAME,
+        VK_KHR_EXTERNAL_SEMAPHORE_WIN32_EXTENSION_NAME,
+#else
+        VK_KHR_EXTERNAL_MEMORY_FD_EXTENSION_NAME,
+        VK_KHR_EXTERNAL_SEMAPHORE_FD_EXTENSION_NAME,
+#endif
+    };
+    VkContext ctx(HeadlessConfig{64, 64}, {}, instanceExtensions, deviceExtensions);
+    if (!ctx.isExternalInteropSupported())
+    {
+        log(Level::Warn, "external interop not supported: skipped");
+        return TEST_SKIPPED;
+    }
+
+    testBufferRoundTrip(ctx);
+    testTimelineSemaphoreRoundTrip(ctx);
+    VK_CHECK(vkDeviceWaitIdle(ctx.getLogicDevice()));
+    return testResult();
+}
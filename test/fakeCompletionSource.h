@@ -0,0 +1,52 @@
+#pragma once
+
+#include <mutex>
+#include <unordered_map>
+#include <unordered_set>
+
+#include <gpuCompletion.h>
+
+// gpu completion flipped by hand: the test plays the gpu
+class FakeCompletionSource : public ICompletionSource
+{
+public:
+    void signalFence(VkFence fence)
+    {
+        std::scoped_lock lock{_mux};
+        _signaledFences.insert(fence);
+    }
+
+    void setTimelineValue(VkSemaphore semaphore, uint64_t value)
+    {
+        std::scoped_lock lock{_mux};
+        _timelineValues[semaphore] = value;
+    }
+
+    bool isFenceSignaled(VkFence fence) override
+    {
+        std::scoped_lock lock{_mux};
+        ++_numQueries;
+        return _signaledFences.contains(fence);
+    }
+
+    uint64_t timelineValue(VkSemaphore semaphore) override
+    {
+        std::scoped_lock lock{_mux};
+        ++_numQueries;
+        const auto it = _timelineValues.find(semaphore);
+        return it != _timelineValues.end() ? it->second : 0;
+    }
+
+    // fence and timeline queries so far
+    size_t numQueries() const
+    {
+        std::scoped_lock lock{_mux};
+        return _numQueries;
+    }
+
+private:
+    mutable std::mutex _mux;
+    std::unordered_set<VkFence> _signaledFences;
+    std::unordered_map<VkSemaphore, uint64_t> _timelineValues;
+    size_t _numQueries{0};
+};
@@ -0,0 +1,190 @@
+#include <vector>
+#include <thread>
+#include <atomic>
+#include <chrono>
+
+#include <coroutine.h>
+#include <gpuCompletion.h>
+#include <fakeCompletionSource.h>
+#include <testing.h>
+
+namespace
+{
+    const VkFence FENCE_A = fakeHandle<VkFence>(1);
+    const VkFence FENCE_B = fakeHandle<VkFence>(2);
+    const VkSemaphore TIMELINE = fakeHandle<VkSemaphore>(3);
+
+    // the resume order, one id per waiter
+    struct Trace
+    {
+        std::mutex mux;
+        std::vector<int> order;
+
+        void push(int id)
+        {
+            std::scoped_lock lock{mux};
+            order.push_back(id);
+        }
+    };
+
+    Task<void> awaitFence(GpuCompletionWatcher &watcher, VkFence fence, Trace &trace, int id)
+    {
+        co_await watcher.fence(fence);
+        trace.push(id);
+    }
+
+    Task<void> awaitTimeline(GpuCompletionWatcher &watcher, uint64_t value, Trace &trace, int id)
+    {
+        co_await watcher.timeline(TIMELINE, value);
+        trace.push(id);
+    }
+
+    // fence, then a timeline value: suspends twice
+    Task<void> awaitBoth(GpuCompletionWatcher &watcher, VkFence fence, uint64_t value, Trace &trace, int id)
+    {
+        co_await watcher.fence(fence);
+        trace.push(id);
+        co_await watcher.timeline(TIMELINE, value);
+        trace.push(id);
+    }
+
+    Task<std::thread::id> resumedOn(GpuCompletionWatcher &watcher, VkFence fence)
+    {
+        co_await watcher.fence(fence);
+        co_return std::this_thread::get_id();
+    }
+
+    // already signaled: await_ready, no suspension and no waiter
+    void testReadyWithoutSuspension()
+    {
+        FakeCompletionSource source;
+        GpuCompletionWatcher watcher(source);
+        source.signalFence(FENCE_A);
+
+        Trace trace;
+        AsyncScope scope;
+        scope.spawn(awaitFence(watcher, FENCE_A, trace, 0));
+        CHECK_EQ(trace.order.size(), size_t(1));
+        CHECK_EQ(watcher.pendingCount(), size_t(0));
+        scope.join();
+    }
+
+    // a poll only resumes the waiters whose work is done, in the order they suspended
+    void testCompletionOrder()
+    {
+        FakeCompletionSource source;
+        GpuCompletionWatcher watcher(source);
+
+        Trace trace;
+        AsyncScope scope;
+        scope.spawn(awaitTimeline(watcher, 3, trace, 3));
+        scope.spawn(awaitTimeline(watcher, 1, trace, 1));
+        scope.spawn(awaitTimeline(watcher, 2, trace, 2));
+        scope.spawn(awaitFence(watcher, FENCE_A, trace, 10));
+        CHECK_EQ(watcher.pendingCount(), size_t(4));
+
+        // nothing done: no wakeup
+        CHECK_EQ(watcher.poll(), size_t(0));
+        CHECK(trace.order.empty());
+
+        source.setTimelineValue(TIMELINE, 1);
+        CHECK_EQ(watcher.poll(), size_t(1));
+        CHECK((trace.order == std::vector<int>{1}));
+
+        // 2 and 3 at once: submission order, 3 suspended first
+        source.setTimelineValue(TIMELINE, 3);
+        CHECK_EQ(watcher.poll(), size_t(2));
+        CHECK((trace.order == std::vector<int>{1, 3, 2}));
+
+        source.signalFence(FENCE_A);
+        CHECK_EQ(watcher.poll(), size_t(1));
+        CHECK((trace.order == std::vector<int>{1, 3, 2, 10}));
+        CHECK_EQ(watcher.pendingCount(), size_t(0));
+
+        // every waiter resumed exactly once
+        CHECK_EQ(watcher.poll(), size_t(0));
+        scope.join();
+    }
+
+    // a resumed coroutine awaiting again is a new waiter, picked up by a later poll
+    void testAwaitAgain()
+    {
+        FakeCompletionSource source;
+        GpuCompletionWatcher watcher(source);
+
+        Trace trace;
+        AsyncScope scope;
+        scope.spawn(awaitBoth(watcher, FENCE_A, 5, trace, 0));
+
+        source.signalFence(FENCE_A);
+        CHECK_EQ(watcher.poll(), size_t(1));
+        CHECK_EQ(trace.order.size(), size_t(1));
+        CHECK_EQ(watcher.pendingCount(), size_t(1));
+
+        source.setTimelineValue(TIMELINE, 4);
+        CHECK_EQ(watcher.poll(), size_t(0));
+        source.setTimelineValue(TIMELINE, 5);
+        CHECK_EQ(watcher.poll(), size_t(1));
+        CHECK_EQ(trace.order.size(), size_t(2));
+        scope.join();
+    }
+
+    // polling thread, resumed on the JobSystem: a plain thread blocks in syncWait until the "gpu" is done
+    void testPollingThreadResumesOnJobSystem()
+    {
+        FakeCompletionSource source;
+        JobSystem jobSystem(2);
+        GpuCompletionWatcher watcher(source, &jobSystem);
+        watcher.startPolling(std::chrono::microseconds(100));
+
+        std::thread gpu([&source]()
+                        {
+            std::this_thread::sleep_for(std::chrono::milliseconds(5));
+            source.signalFence(FENCE_B); });
+        const auto resumedThread = syncWait(resumedOn(watcher, FENCE_B));
+        gpu.join();
+        watcher.stopPolling();
+
+        CHECK(resumedThread != std::this_thread::get_id());
+        CHECK(resumedThread != std::thread::id());
+        CHECK_EQ(watcher.pendingCount(), size_t(0));
+    }
+
+    // whenAll over several gpu waits: resumed once, after the last one
+    void testWhenAll()
+    {
+        FakeCompletionSource source;
+        GpuCompletionWatcher watcher(source);
+        watcher.startPolling(std::chrono::microseconds(100));
+
+        Trace trace;
+        std::vector<Task<void>> tasks;
+        tasks.push_back(awaitFence(watcher, FENCE_A, trace, 0));
+        tasks.push_back(awaitFence(watcher, FENCE_B, trace, 1));
+        tasks.push_back(awaitTimeline(watcher, 7, trace, 2));
+
+        std::thread gpu([&source]()
+                        {
+            source.signalFence(FENCE_B);
+            std::this_thread::sleep_for(std::chrono::milliseconds(2));
+            source.setTimelineValue(TIMELINE, 7);
+            std::this_thread::sleep_for(std::chrono::milliseconds(2));
+            source.signalFence(FENCE_A); });
+        syncWait(whenAll(std::move(tasks)));
+        gpu.join();
+        watcher.stopPolling();
+
+        CHECK_EQ(trace.order.size(), size_t(3));
+        CHECK_EQ(watcher.pendingCount(), size_t(0));
+    }
+}
+
+int main()
+{
+    testReadyWithoutSuspension();
+    testCompletionOrder();
+    testAwaitAgain();
+    testPollingThreadResumesOnJobSystem();
+    testWhenAll();
+    return testResult();
+}
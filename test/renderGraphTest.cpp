@@ -0,0 +1,312 @@
+#include <vector>
+#include <unordered_map>
+
+#include <renderGraph.h>
+#include <testing.h>
+
+namespace
+{
+    const VkImage SWAPCHAIN_IMAGE = fakeHandle<VkImage>(1);
+    const VkImageView SWAPCHAIN_VIEW = fakeHandle<VkImageView>(2);
+    const VkBuffer IMPORTED_BUFFER = fakeHandle<VkBuffer>(3);
+    constexpr VkImageSubresourceRange COLOR_RANGE{VK_IMAGE_ASPECT_COLOR_BIT, 0, 1, 0, 1};
+    // acquired image: the acquire semaphore is waited on at the color output stage
+    constexpr RenderGraphAccess ACQUIRED_ACCESS{
+        VK_PIPELINE_STAGE_2_COLOR_ATTACHMENT_OUTPUT_BIT, VK_ACCESS_2_NONE, VK_IMAGE_LAYOUT_UNDEFINED};
+
+    const RenderGraph::RecordFn NO_RECORD = [](RenderGraph &, CommandBufferEntity &, int) {};
+
+    // the device side of compile(): fixed requirements per resource, counts the queries
+    struct FakeMemoryRequirements
+    {
+        std::unordered_map<RenderGraphResource, VkMemoryRequirements> requirements;
+        std::vector<RenderGraphResource> queried;
+
+        RenderGraph::MemoryRequirementsFn fn()
+        {
+            return [this](RenderGraphResource resource)
+            {
+                queried.push_back(resource);
+                const auto it = requirements.find(resource);
+                CHECK(it != requirements.end());
+                return it != requirements.end() ? it->second : VkMemoryRequirements{};
+            };
+        }
+    };
+
+    RenderGraphResource importSwapchain(RenderGraph &graph)
+    {
+        const auto swapchain = graph.importImage("swapchain", SWAPCHAIN_IMAGE, SWAPCHAIN_VIEW, COLOR_RANGE, ACQUIRED_ACCESS);
+        graph.markOutput(swapchain, VK_IMAGE_LAYOUT_PRESENT_SRC_KHR);
+        return swapchain;
+    }
+
+    RenderGraphResource createColorTarget(RenderGraph &graph, const std::string &name)
+    {
+        return graph.createImage(name, RenderGraphImageDesc{
+                                           .format = VK_FORMAT_R16G16B16A16_SFLOAT,
+                                           .extent = {64, 64, 1},
+                                           .usage = VK_IMAGE_USAGE_COLOR_ATTACHMENT_BIT | VK_IMAGE_USAGE_SAMPLED_BIT,
+                                       });
+    }
+
+    // no transient resource: compile() without the memory requirements
+    void testPassesWithoutOutputAreCulled()
+    {
+        RenderGraph graph;
+        const auto swapchain = importSwapchain(graph);
+        const auto debug = graph.importBuffer("debug", IMPORTED_BUFFER, COMPUTE_SHADER_READ_ACCESS);
+
+        graph.addPass("debug", NO_RECORD).write(debug, COMPUTE_SHADER_WRITE_ACCESS);
+        graph.addPass("draw", NO_RECORD).write(swapchain, COLOR_ATTACHMENT_WRITE_ACCESS);
+        graph.addPass("readback", NO_RECORD).read(debug, TRANSFER_READ_ACCESS);
+        const auto &compiled = graph.compile();
+
+        // the readback reads debug but writes nothing: it goes, and so does its producer
+        CHECK_EQ(compiled.passes.size(), size_t(1));
+        CHECK_EQ(compiled.passes[0].pass, 1u);
+        CHECK((compiled.culledPasses == std::vector<uint32_t>{0, 2}));
+
+        // flagged: the readback and the pass it reads from are kept
+        RenderGraph flagged;
+        const auto flaggedSwapchain = importSwapchain(flagged);
+        const auto flaggedDebug = flagged.importBuffer("debug", IMPORTED_BUFFER, COMPUTE_SHADER_READ_ACCESS);
+        flagged.addPass("debug", NO_RECORD).write(flaggedDebug, COMPUTE_SHADER_WRITE_ACCESS);
+        flagged.addPass("draw", NO_RECORD).write(flaggedSwapchain, COLOR_ATTACHMENT_WRITE_ACCESS);
+        flagged.addPass("readback", NO_RECORD).read(flaggedDebug, TRANSFER_READ_ACCESS).sideEffects();
+        CHECK_EQ(flagged.compile().passes.size(), size_t(3));
+        CHECK(flagged.compiled().culledPasses.empty());
+    }
+
+    // gpu culling: compute writes the indirect commands, the draw reads them and renders to the swapchain
+    void testIndirectDrawBarriers()
+    {
+        RenderGraph graph;
+        const auto swapchain = importSwapchain(graph);
+        const auto commands = graph.createBuffer("indirect commands", RenderGraphBufferDesc{
+                                                                          .size = 4096,
+                                                                          .usage = VK_BUFFER_USAGE_STORAGE_BUFFER_BIT | VK_BUFFER_USAGE_INDIRECT_BUFFER_BIT,
+                                                                      });
+        graph.addPass("cull", NO_RECORD).write(commands, COMPUTE_SHADER_WRITE_ACCESS);
+        graph.addPass("draw", NO_RECORD).read(commands, INDIRECT_COMMAND_READ_ACCESS).write(swapchain, COLOR_ATTACHMENT_WRITE_ACCESS);
+
+        FakeMemoryRequirements memory;
+        memory.requirements[commands] = {4096, 256, 0x3};
+        const auto &compiled = graph.compile(memory.fn());
+
+        // only the transient is queried
+        CHECK((memory.queried == std::vector<RenderGraphResource>{commands}));
+        CHECK_EQ(compiled.passes.size(), size_t(2));
+
+        // cull: WAR against the draw of the previous frame
+        CHECK_EQ(compiled.passes[0].barriers.size(), size_t(1));
+        CHECK_EQ(compiled.passes[0].barriers[0].dstStages, VK_PIPELINE_STAGE_2_COMPUTE_SHADER_BIT);
+
+        // draw: the commands (RAW) and the swapchain layout, one batch
+        const auto &drawBarriers = compiled.passes[1].barriers;
+        CHECK_EQ(drawBarriers.size(), size_t(2));
+        for (const auto &barrier : drawBarriers)
+        {
+            if (barrier.image)
+            {
+                CHECK_EQ(barrier.resource, swapchain);
+                CHECK_EQ(barrier.oldLayout, VK_IMAGE_LAYOUT_UNDEFINED);
+                CHECK_EQ(barrier.newLayout, VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL);
+                CHECK_EQ(barrier.srcStages, VK_PIPELINE_STAGE_2_COLOR_ATTACHMENT_OUTPUT_BIT);
+            }
+            else
+            {
+                CHECK_EQ(barrier.resource, commands);
+                CHECK_EQ(barrier.srcStages, VK_PIPELINE_STAGE_2_COMPUTE_SHADER_BIT);
+                CHECK_EQ(barrier.srcAccess, VK_ACCESS_2_SHADER_STORAGE_WRITE_BIT);
+                CHECK_EQ(barrier.dstStages, VK_PIPELINE_STAGE_2_DRAW_INDIRECT_BIT);
+                CHECK_EQ(barrier.dstAccess, VK_ACCESS_2_INDIRECT_COMMAND_READ_BIT);
+            }
+        }
+
+        // present
+        CHECK_EQ(compiled.finalBarriers.size(), size_t(1));
+        CHECK_EQ(compiled.finalBarriers[0].newLayout, VK_IMAGE_LAYOUT_PRESENT_SRC_KHR);
+
+        CHECK_EQ(compiled.barrierCount(), size_t(4));
+        CHECK_EQ(compiled.barrierBatchCount(), size_t(3));
+    }
+
+    // several buffers in one batch: a single memory barrier
+    void testBuffersShareOneMemoryBarrier()
+    {
+        RenderGraph graph;
+        const auto swapchain = importSwapchain(graph);
+        const auto positions = graph.createBuffer("positions", RenderGraphBufferDesc{.size = 1024});
+        const auto normals = graph.createBuffer("normals", RenderGraphBufferDesc{.size = 1024});
+        graph.addPass("skinning", NO_RECORD)
+            .write(positions, COMPUTE_SHADER_WRITE_ACCESS)
+            .write(normals, COMPUTE_SHADER_WRITE_ACCESS);
+        graph.addPass("draw", NO_RECORD)
+            .read(positions, VERTEX_SHADER_READ_ACCESS)
+            .read(normals, VERTEX_SHADER_READ_ACCESS)
+            .write(swapchain, COLOR_ATTACHMENT_WRITE_ACCESS);
+
+        FakeMemoryRequirements memory;
+        memory.requirements[positions] = {1024, 256, 0x3};
+        memory.requirements[normals] = {1024, 256, 0x3};
+        const auto &compiled = graph.compile(memory.fn());
+
+        CHECK_EQ(compiled.passes[1].barriers.size(), size_t(3));
+        // swapchain + one memory barrier, per batch: skinning, draw, present
+        CHECK_EQ(compiled.barrierCount(), size_t(1 + 2 + 1));
+        CHECK_EQ(compiled.barrierBatchCount(), size_t(3));
+    }
+
+    // read after read in the same layout: the first read synchronized the stages already
+    void testReadAfterReadNeedsNoBarrier()
+    {
+        RenderGraph graph;
+        const auto swapchain = importSwapchain(graph);
+        const auto hdr = createColorTarget(graph, "hdr");
+        const auto bloom = createColorTarget(graph, "bloom");
+        graph.addPass("lighting", NO_RECORD).write(hdr, COLOR_ATTACHMENT_WRITE_ACCESS);
+        graph.addPass("bloom", NO_RECORD).read(hdr, FRAGMENT_SHADER_SAMPLED_ACCESS).write(bloom, COLOR_ATTACHMENT_WRITE_ACCESS);
+        graph.addPass("tonemap", NO_RECORD)
+            .read(hdr, FRAGMENT_SHADER_SAMPLED_ACCESS)
+            .read(bloom, FRAGMENT_SHADER_SAMPLED_ACCESS)
+            .write(swapchain, COLOR_ATTACHMENT_WRITE_ACCESS);
+
+        FakeMemoryRequirements memory;
+        memory.requirements[hdr] = {64 * 64 * 8, 4096, 0x1};
+        memory.requirements[bloom] = {64 * 64 * 8, 4096, 0x1};
+        const auto &compiled = graph.compile(memory.fn());
+
+        CHECK_EQ(compiled.passes.size(), size_t(3));
+        // tonemap: bloom and the swapchain, nothing for hdr
+        const auto &tonemapBarriers = compiled.passes[2].barriers;
+        CHECK_EQ(tonemapBarriers.size(), size_t(2));
+        for (const auto &barrier : tonemapBarriers)
+        {
+            CHECK(barrier.resource != hdr);
+        }
+    }
+
+    // transients whose lifetimes do not overlap share memory
+    void testDisjointLifetimesAlias()
+    {
+        RenderGraph graph;
+        const auto swapchain = importSwapchain(graph);
+        const auto a = createColorTarget(graph, "a");
+        const auto b = createColorTarget(graph, "b");
+        const auto c = createColorTarget(graph, "c");
+        // a: passes 0-1, b: 1-2, c: 2-3
+        graph.addPass("0", NO_RECORD).write(a, COLOR_ATTACHMENT_WRITE_ACCESS);
+        graph.addPass("1", NO_RECORD).read(a, FRAGMENT_SHADER_SAMPLED_ACCESS).write(b, COLOR_ATTACHMENT_WRITE_ACCESS);
+        graph.addPass("2", NO_RECORD).read(b, FRAGMENT_SHADER_SAMPLED_ACCESS).write(c, COLOR_ATTACHMENT_WRITE_ACCESS);
+        graph.addPass("3", NO_RECORD).read(c, FRAGMENT_SHADER_SAMPLED_ACCESS).write(swapchain, COLOR_ATTACHMENT_WRITE_ACCESS);
+
+        FakeMemoryRequirements memory;
+        memory.requirements[a] = {1024, 256, 0x3};
+        memory.requirements[b] = {1024, 256, 0x3};
+        memory.requirements[c] = {1024, 256, 0x6};
+        const auto &compiled = graph.compile(memory.fn());
+
+        CHECK_EQ(compiled.heaps.size(), size_t(1));
+        CHECK_EQ(compiled.heaps[0].memoryTypeBits, 0x2u);
+        CHECK(!compiled.placements[swapchain].has_value());
+        CHECK_EQ(compiled.placements[a]->offset, VkDeviceSize(0));
+        CHECK_EQ(compiled.placements[b]->offset, VkDeviceSize(1024));
+        CHECK_EQ(compiled.placements[c]->offset, VkDeviceSize(0));
+        CHECK_EQ(compiled.placements[c]->firstUse, 2u);
+        CHECK_EQ(compiled.placements[c]->lastUse, 3u);
+        CHECK_EQ(compiled.transientBytes(), VkDeviceSize(2048));
+        CHECK_EQ(compiled.transientBytesWithoutAliasing(), VkDeviceSize(3072));
+
+        // c takes over the memory of a: its first use waits on the stages of a
+        const auto &aliasBarriers = compiled.passes[2].barriers;
+        bool aliasBarrier = false;
+        for (const auto &barrier : aliasBarriers)
+        {
+            if (barrier.resource == c)
+            {
+                aliasBarrier = true;
+                CHECK_EQ(barrier.oldLayout, VK_IMAGE_LAYOUT_UNDEFINED);
+                CHECK((barrier.srcStages & VK_PIPELINE_STAGE_2_FRAGMENT_SHADER_BIT) != 0);
+            }
+        }
+        CHECK(aliasBarrier);
+    }
+
+    // buffers and images never share a heap
+    void testImagesAndBuffersInSeparateHeaps()
+    {
+        RenderGraph graph;
+        const auto swapchain = importSwapchain(graph);
+        const auto image = createColorTarget(graph, "image");
+        const auto buffer = graph.createBuffer("buffer", RenderGraphBufferDesc{.size = 512});
+        graph.addPass("0", NO_RECORD).write(image, COLOR_ATTACHMENT_WRITE_ACCESS).write(buffer, COMPUTE_SHADER_WRITE_ACCESS);
+        graph.addPass("1", NO_RECORD)
+            .read(image, FRAGMENT_SHADER_SAMPLED_ACCESS)
+            .read(buffer, VERTEX_SHADER_READ_ACCESS)
+            .write(swapchain, COLOR_ATTACHMENT_WRITE_ACCESS);
+
+        FakeMemoryRequirements memory;
+        memory.requirements[image] = {1024, 256, 0x1};
+        memory.requirements[buffer] = {512, 64, 0x1};
+        const auto &compiled = graph.compile(memory.fn());
+
+        CHECK_EQ(compiled.heaps.size(), size_t(2));
+        CHECK(compiled.placements[image]->heap != compiled.placements[buffer]->heap);
+        CHECK_EQ(compiled.transientBytes(), VkDeviceSize(1024 + 512));
+    }
+
+    // no initial access: the first write waits on what the previous execution left
+    void testStateCarriedOverToTheNextExecution()
+    {
+        RenderGraph graph;
+        const auto swapchain = importSwapchain(graph);
+        const auto particles = graph.importBuffer("particles", IMPORTED_BUFFER);
+        graph.addPass("simulate", NO_RECORD).write(particles, COMPUTE_SHADER_WRITE_ACCESS);
+        graph.addPass("draw", NO_RECORD).read(particles, VERTEX_SHADER_READ_ACCESS).write(swapchain, COLOR_ATTACHMENT_WRITE_ACCESS);
+        const auto &compiled = graph.compile();
+
+        // WAR on the draw of the previous frame, WAW on its simulation
+        CHECK_EQ(compiled.passes[0].barriers.size(), size_t(1));
+        const auto &barrier = compiled.passes[0].barriers[0];
+        CHECK_EQ(barrier.srcStages, VK_PIPELINE_STAGE_2_COMPUTE_SHADER_BIT | VK_PIPELINE_STAGE_2_VERTEX_SHADER_BIT);
+        CHECK_EQ(barrier.srcAccess, VK_ACCESS_2_SHADER_STORAGE_WRITE_BIT);
+
+        CHECK_EQ(compiled.barrierCount(), size_t(1 + 2 + 1));
+        CHECK(compiled.heaps.empty());
+        CHECK_EQ(compiled.transientBytes(), VkDeviceSize(0));
+    }
+
+    // declaring after compile() drops the compiled graph
+    void testRecompileAfterChange()
+    {
+        RenderGraph graph;
+        const auto swapchain = importSwapchain(graph);
+        graph.addPass("clear", NO_RECORD).write(swapchain, TRANSFER_WRITE_ACCESS);
+        CHECK_EQ(graph.compile().barrierCount(), size_t(2));
+
+        // blended over the clear: loads the attachment, keeps the clear alive
+        constexpr RenderGraphAccess COLOR_ATTACHMENT_BLEND_ACCESS{
+            VK_PIPELINE_STAGE_2_COLOR_ATTACHMENT_OUTPUT_BIT,
+            VK_ACCESS_2_COLOR_ATTACHMENT_READ_BIT | VK_ACCESS_2_COLOR_ATTACHMENT_WRITE_BIT,
+            VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL};
+        graph.addPass("ui", NO_RECORD).write(swapchain, COLOR_ATTACHMENT_BLEND_ACCESS);
+        const auto &compiled = graph.compile();
+        CHECK_EQ(compiled.passes.size(), size_t(2));
+        // clear -> ui: one more layout transition
+        CHECK_EQ(compiled.barrierCount(), size_t(3));
+    }
+}
+
+int main()
+{
+    testPassesWithoutOutputAreCulled();
+    testIndirectDrawBarriers();
+    testBuffersShareOneMemoryBarrier();
+    testReadAfterReadNeedsNoBarrier();
+    testDisjointLifetimesAlias();
+    testImagesAndBuffersInSeparateHeaps();
+    testStateCarriedOverToTheNextExecution();
+    testRecompileAfterChange();
+    return testResult();
+}
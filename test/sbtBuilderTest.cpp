@@ -0,0 +1,101 @@
+#include <sbtBuilder.h>
+#include <testing.h>
+
+namespace
+{
+    // a typical desktop gpu
+    VkPhysicalDeviceRayTracingPipelinePropertiesKHR fakeProperties()
+    {
+        return VkPhysicalDeviceRayTracingPipelinePropertiesKHR{
+            .sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_RAY_TRACING_PIPELINE_PROPERTIES_KHR,
+            .shaderGroupHandleSize = 32,
+            .maxRayRecursionDepth = 31,
+            .maxShaderGroupStride = 4096,
+            .shaderGroupBaseAlignment = 64,
+            .shaderGroupHandleCaptureReplaySize = 32,
+            .maxRayDispatchInvocationCount = 1 << 30,
+            .shaderGroupHandleAlignment = 32,
+            .maxRayHitAttributeSize = 32,
+        };
+    }
+
+    // what every layout must hold, whatever the records
+    void checkAlignment(const SbtBuilder::Layout &layout)
+    {
+        for (const auto *region : {&layout.raygen, &layout.miss, &layout.hit})
+        {
+            CHECK_EQ(region->offset % 64, VkDeviceSize(0));
+            CHECK_EQ(region->size % 64, VkDeviceSize(0));
+            CHECK_EQ(region->stride % 32, VkDeviceSize(0));
+        }
+        // the raygen region is a single record
+        CHECK_EQ(layout.raygen.size, layout.raygen.stride);
+        CHECK(layout.raygen.offset + layout.raygen.size <= layout.miss.offset);
+        CHECK(layout.miss.offset + layout.miss.size <= layout.hit.offset);
+        CHECK_EQ(layout.sizeInBytes, layout.hit.offset + layout.hit.size);
+    }
+
+    // handles only: the strides are the handle size, the regions the base alignment
+    void testHandlesOnly()
+    {
+        const auto layout = SbtBuilder::computeLayout(fakeProperties(), 2, 3, 0, 0);
+        checkAlignment(layout);
+
+        CHECK_EQ(layout.raygen.offset, VkDeviceSize(0));
+        CHECK_EQ(layout.raygen.stride, VkDeviceSize(64));
+        CHECK_EQ(layout.raygen.size, VkDeviceSize(64));
+
+        CHECK_EQ(layout.miss.offset, VkDeviceSize(64));
+        CHECK_EQ(layout.miss.stride, VkDeviceSize(32));
+        CHECK_EQ(layout.miss.size, VkDeviceSize(64));
+
+        // 3 x 32 rounded up to 64
+        CHECK_EQ(layout.hit.offset, VkDeviceSize(128));
+        CHECK_EQ(layout.hit.stride, VkDeviceSize(32));
+        CHECK_EQ(layout.hit.size, VkDeviceSize(128));
+
+        CHECK_EQ(layout.sizeInBytes, VkDeviceSize(256));
+    }
+
+    // inline hit data: handle + data rounded up to the handle alignment
+    void testInlineRecordData()
+    {
+        // 12 bytes: material index + uv scale
+        const auto layout = SbtBuilder::computeLayout(fakeProperties(), 1, 5, 0, 12);
+        checkAlignment(layout);
+
+        CHECK_EQ(layout.miss.offset, VkDeviceSize(64));
+        CHECK_EQ(layout.miss.stride, VkDeviceSize(32));
+        CHECK_EQ(layout.miss.size, VkDeviceSize(64));
+
+        CHECK_EQ(layout.hit.offset, VkDeviceSize(128));
+        CHECK_EQ(layout.hit.stride, VkDeviceSize(64));
+        CHECK_EQ(layout.hit.size, VkDeviceSize(320));
+
+        CHECK_EQ(layout.sizeInBytes, VkDeviceSize(448));
+
+        // exactly one handle alignment of data: no padding
+        const auto aligned = SbtBuilder::computeLayout(fakeProperties(), 1, 1, 32, 32);
+        CHECK_EQ(aligned.miss.stride, VkDeviceSize(64));
+        CHECK_EQ(aligned.hit.stride, VkDeviceSize(64));
+    }
+
+    // no hit record: an empty region after the miss records
+    void testEmptyHitRegion()
+    {
+        const auto layout = SbtBuilder::computeLayout(fakeProperties(), 1, 0, 0, 0);
+        checkAlignment(layout);
+
+        CHECK_EQ(layout.hit.offset, VkDeviceSize(128));
+        CHECK_EQ(layout.hit.size, VkDeviceSize(0));
+        CHECK_EQ(layout.sizeInBytes, VkDeviceSize(128));
+    }
+}
+
+int main()
+{
+    testHandlesOnly();
+    testInlineRecordData();
+    testEmptyHitRegion();
+    return testResult();
+}
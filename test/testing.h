@@ -0,0 +1,56 @@
+#pragma once
+
+#include <cstdint>
+
+#include <misc.h>
+
+// minimal checks for the ctest executables, no framework:
+// CHECK() logs and counts the failure, main() returns testResult()
+constexpr int TEST_SKIPPED = 77;
+
+inline int &testFailures()
+{
+    static int failures = 0;
+    return failures;
+}
+
+inline int testResult()
+{
+    if (testFailures() > 0)
+    {
+        log(Level::Error, testFailures(), " check(s) failed");
+        return 1;
+    }
+    return 0;
+}
+
+#define CHECK(expr)                                                                  \
+    do                                                                               \
+    {                                                                                \
+        if (!(expr))                                                                 \
+        {                                                                            \
+            log(Level::Error, __FILE__, ":", __LINE__, ": CHECK(" #expr ") failed"); \
+            ++testFailures();                                                        \
+        }                                                                            \
+    } while (0)
+
+#define CHECK_EQ(actual, expected)                                             \
+    do                                                                         \
+    {                                                                          \
+        const auto &actualValue = (actual);                                    \
+        const auto &expectedValue = (expected);                                \
+        if (!(actualValue == expectedValue))                                   \
+        {                                                                      \
+            log(Level::Error, __FILE__, ":", __LINE__,                         \
+                ": CHECK_EQ(" #actual ", " #expected ") failed: ",             \
+                actualValue, " != ", expectedValue);                           \
+            ++testFailures();                                                  \
+        }                                                                      \
+    } while (0)
+
+// fake non-dispatchable handle: VkFence, VkSemaphore... (pointers on 64 bit, uint64_t on 32 bit)
+template <typename Handle>
+Handle fakeHandle(uint64_t id)
+{
+    return (Handle)(uintptr_t)id;
+}